@@ -209,6 +209,10 @@ void setup() {
     
     // Initialize end-to-end dialog client
     realtimeDialog.setAudioParams(16000, 16, 1);
+    // realtimeDialog.setTTSFormat("ogg_opus");  // Optional: Opus downlink (~10x less data), decoded on device
+    // realtimeDialog.setASRFormat("ogg_opus");  // Optional: Opus uplink (~24 kbit/s instead of 256), encoded on device
+    // realtimeDialog.setCompression(true);  // Optional: gzip large JSON requests (long system roles)
+    // realtimeDialog.setBargeIn(true);  // Optional: speak over a reply to interrupt it (echo cancelled, full duplex)
     
     // Set model version
     realtimeDialog.setModelVersion(modelVersion);
@@ -340,7 +344,7 @@ void loop() {
     ttsEndedFlag = false;
     Serial.println("\n[Callback] TTS playback ended");
     
-    if (isInConversation) {
+    if (isInConversation && !realtimeDialog.isRecording()) {
       // In continuous conversation mode, automatically restart recording after TTS ends
       delay(500);
       if (!realtimeDialog.startRecording()) {
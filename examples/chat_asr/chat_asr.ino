@@ -200,6 +200,8 @@ void setup() {
 
     // Set audio parameters for ASR
     asrChat.setAudioParams(SAMPLE_RATE, 16, 1);
+    // asrChat.setAudioCodec("opus");  // Optional: Opus uplink (~24 kbit/s instead of 256), encoded on device
+    // asrChat.setCompression(true);  // Optional: gzip request, server answers with gzip compressed results
     asrChat.setSilenceDuration(1000);  // 1 second silence detection
     asrChat.setMaxRecordingSeconds(50);
 
@@ -27,6 +27,7 @@
 #include <ArduinoASRChat.h>
 #include <ArduinoGPTChat.h>
 #include <ArduinoTTSChat.h>
+#include <ChatTTSPipeline.h>
 #include <ArduinoJson.h>
 #include <Preferences.h>
 #include "Audio.h"
@@ -96,6 +97,7 @@ Audio audio;
 ArduinoASRChat* asrChat = nullptr;
 ArduinoGPTChat* gptChat = nullptr;
 ArduinoTTSChat* ttsChat = nullptr;  // WebSocket-based TTS for Pro version
+ChatTTSPipeline* ttsPipeline = nullptr;  // Streams LLM reply into WebSocket TTS (Pro version)
 Preferences preferences;
 
 // TTS completion flag for WebSocket mode
@@ -429,6 +431,7 @@ bool initializeSystem() {
   asrChat->setAudioParams(SAMPLE_RATE, 16, 1);
   asrChat->setSilenceDuration(1000);
   asrChat->setMaxRecordingSeconds(50);
+  asrChat->setPersistentSession(true);  // Reuse WebSocket between turns, skip per-turn TLS handshake
   
   asrChat->setTimeoutNoSpeechCallback([]() {
     if (continuousMode) {
@@ -460,6 +463,7 @@ bool initializeSystem() {
     ttsChat->setSpeed(tts_speed);
     ttsChat->setVolume(tts_volume);
     ttsChat->setAudioParams(tts_sample_rate, tts_bitrate);
+    ttsChat->setPersistentSession(true);  // Keep TTS connection warm between replies
 
     // Initialize I2S speaker for WebSocket TTS
     Serial.println("Initializing WebSocket TTS speaker...");
@@ -479,6 +483,13 @@ bool initializeSystem() {
       return false;
     }
 
+    // Speak the reply sentence by sentence while ChatGPT is still generating it
+    ttsPipeline = new ChatTTSPipeline(*gptChat, *ttsChat);
+    if (!ttsPipeline->begin()) {
+      Serial.println("TTS pipeline initialization failed!");
+      return false;
+    }
+
     Serial.println("TTS Mode: MiniMax WebSocket (Pro)");
     Serial.printf("Config: Voice=%s, Speed=%.1f, SampleRate=%d\n",
                   tts_voice_id.c_str(), tts_speed, tts_sample_rate);
@@ -563,20 +574,34 @@ void handleASRResult() {
     // ========== Send to ChatGPT ==========
     currentState = STATE_PROCESSING_LLM;
     Serial.println("\n[LLM] Sending to ChatGPT...");
+
+    // Pro: reply is streamed and spoken while it is generated
+    bool streamed = (subscription == "pro" && ttsPipeline != nullptr);
+    if (streamed) {
+      ttsCompleted = false;  // Reset completion flag
+    }
+    // The streamed reply is not kept as a whole, it is spoken segment by segment
+    String response = streamed ? String() : gptChat->sendMessage(transcribedText);
+    bool replied = streamed ? ttsPipeline->run(transcribedText) : response.length() > 0;
     
-    String response = gptChat->sendMessage(transcribedText);
-    
-    if (response != "" && response.length() > 0) {
+    if (replied) {
       // ========== Display ChatGPT Response ==========
-      Serial.println("\n=== ChatGPT Response ===");
-      Serial.printf("%s\n", response.c_str());
-      Serial.println("========================");
+      if (!streamed) {
+        Serial.println("\n=== ChatGPT Response ===");
+        Serial.printf("%s\n", response.c_str());
+        Serial.println("========================");
+      }
       
       // ========== Convert to Speech and Play ==========
       currentState = STATE_PLAYING_TTS;
       bool success = false;
 
-      if (subscription == "pro") {
+      if (streamed) {
+        // Pro: segments were already sent to MiniMax WebSocket TTS while streaming
+        Serial.printf("\n[MiniMax TTS] Streamed %u segments, first audio requested after %lums\n",
+                      (unsigned)ttsPipeline->segmentCount(), ttsPipeline->firstSegmentMs());
+        success = ttsChat->isPlaying() || ttsCompleted;
+      } else if (subscription == "pro") {
         // Pro: Use MiniMax WebSocket TTS
         Serial.println("\n[MiniMax TTS] Converting to speech (WebSocket)...");
         ttsCompleted = false;  // Reset completion flag
@@ -157,6 +157,10 @@ void setup() {
 
   Serial.println("\n\n----- Voice Assistant System (ASR+OpenAI+MiniMax TTS) Starting -----");
 
+  // Optional: print where each conversational turn spends its time
+  // TurnMetrics::enable(true);
+  // TurnMetrics::onReport([](const TurnReport& report) { TurnMetrics::print(report); });
+
   // Initialize BOOT button
   pinMode(BOOT_BUTTON_PIN, INPUT_PULLUP);
 
@@ -207,6 +211,12 @@ void setup() {
     minimaxTTS.setAudioFormat(tts_audio_format); // Set audio format
     minimaxTTS.setSampleRate(tts_sample_rate); // Set sample rate
     minimaxTTS.setBitrate(tts_bitrate);        // Set bitrate
+    // minimaxTTS.setDirectStreaming(true);  // Skip URL mode, play hex audio while it downloads
+
+    // Optional: replay repeated phrases from flash (add #include <LittleFS.h> and a global TTSPhraseCache phraseCache;)
+    // if (LittleFS.begin(true) && phraseCache.begin(LittleFS, "/ttscache", 512 * 1024)) {
+    //     minimaxTTS.setCache(&phraseCache);
+    // }
     
     Serial.printf("[MiniMax TTS] Configuration: Voice=%s, Format=%s, SampleRate=%d\n",
                   tts_voice_id, tts_audio_format, tts_sample_rate);
@@ -0,0 +1,337 @@
+/*
+ * ============================================================================
+ * Decoder benchmark core, shared by decoder_benchmark.ino and the host build
+ * in extras/test/decoder_benchmark.cpp
+ * ============================================================================
+ * Decoder table, feeding loop, reference comparison and report. File access
+ * stays with the includer, which defines these hooks before including this
+ * header:
+ *
+ *   #define BENCH_HEAP_REGIONS n        // 1: one heap, 2: internal RAM and PSRAM
+ *   static uint32_t benchCycles();      // CPU cycle counter, only differences are used
+ *   static uint64_t benchNanos();       // Monotonic time in nanoseconds
+ *   static size_t benchHeapInUse(int region);
+ *   static uint32_t benchCrc32(uint32_t crc, const uint8_t* buf, size_t len);  // As esp_rom_crc32_le()
+ *   static void benchPrint(const char* text);
+ * ============================================================================
+ */
+
+#pragma once
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mp3_decoder/mp3_decoder.h>
+#include <aac_decoder/aac_decoder.h>
+#include <flac_decoder/flac_decoder.h>
+#include <vorbis_decoder/vorbis_decoder.h>
+#include <opus_decoder/opus_decoder.h>
+
+enum BenchCodec { BENCH_MP3, BENCH_AAC, BENCH_FLAC, BENCH_VORBIS, BENCH_OPUS };
+
+// Output buffer, same size as Audio's (largest: HE-AAC, 2048 stereo frames)
+static int16_t pcm[4096 * 2];
+
+static const int MAX_STALLED_CALLS = 8;  // Decode calls in a row that consume nothing before giving up
+static const size_t INPUT_GUARD = 64;     // Zeros after the file: the Vorbis bit reader looks past the last packet
+
+static void benchPrintf(const char* fmt, ...) {
+  char text[256];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(text, sizeof(text), fmt, args);
+  va_end(args);
+  benchPrint(text);
+}
+
+// ============================================================================
+// Uniform decoder interface
+// ============================================================================
+
+struct Decoder {
+  const char* name;
+  bool (*allocate)();
+  void (*release)();
+  int32_t (*findSync)(uint8_t* buf, int32_t len);
+  int32_t (*decode)(uint8_t* buf, int32_t* left, int16_t* out);
+  uint32_t (*outputFrames)();   // Frames of the last decode call
+  uint32_t (*sampleRate)();
+  uint32_t (*channels)();
+  int32_t moreOutput;           // Return code: output written, call again on the same input (0: none)
+};
+
+static int32_t mp3Sync(uint8_t* b, int32_t n)  { return MP3FindSyncWord(b, n); }
+static int32_t mp3Decode(uint8_t* b, int32_t* l, int16_t* o) { return MP3Decode(b, l, o, 0); }
+static uint32_t mp3Frames() { return MP3GetOutputSamps() / (MP3GetChannels() ? MP3GetChannels() : 1); }
+static uint32_t mp3Rate()   { return MP3GetSampRate(); }
+static uint32_t mp3Ch()     { return MP3GetChannels(); }
+
+static int32_t aacSync(uint8_t* b, int32_t n)  { return AACFindSyncWord(b, n); }
+static int32_t aacDecode(uint8_t* b, int32_t* l, int16_t* o) { return AACDecode(b, l, o); }
+static uint32_t aacFrames() { return AACGetOutputSamps() / (AACGetChannels() ? AACGetChannels() : 1); }
+static uint32_t aacRate()   { return AACGetSampRate(); }
+static uint32_t aacCh()     { return AACGetChannels(); }
+
+static int32_t flacSync(uint8_t* b, int32_t n) { return FLACFindSyncWord(b, n); }
+static int32_t flacDecode(uint8_t* b, int32_t* l, int16_t* o) { return FLACDecode(b, l, o); }
+static uint32_t flacFrames() { return FLACGetOutputSamps() / (FLACGetChannels() ? FLACGetChannels() : 1); }
+static uint32_t flacRate()   { return FLACGetSampRate(); }
+static uint32_t flacCh()     { return FLACGetChannels(); }
+
+static int32_t vorbisSync(uint8_t* b, int32_t n) { return VORBISFindSyncWord(b, n); }
+static uint32_t vorbisFrames() { return VORBISGetOutputSamps(); }
+static uint32_t vorbisRate()   { return VORBISGetSampRate(); }
+static uint32_t vorbisCh()     { return VORBISGetChannels(); }
+
+static int32_t opusSync(uint8_t* b, int32_t n) { return OPUSFindSyncWord(b, n); }
+static uint32_t opusFrames() { return OPUSGetOutputSamps(); }
+static uint32_t opusRate()   { return OPUSGetSampRate(); }
+static uint32_t opusCh()     { return OPUSGetChannels(); }
+
+// Indexed by BenchCodec
+static const Decoder decoders[] = {
+  {"MP3",    MP3Decoder_AllocateBuffers,    MP3Decoder_FreeBuffers,    mp3Sync,    mp3Decode,    mp3Frames,    mp3Rate,    mp3Ch,    0},
+  {"AAC",    AACDecoder_AllocateBuffers,    AACDecoder_FreeBuffers,    aacSync,    aacDecode,    aacFrames,    aacRate,    aacCh,    0},
+  {"FLAC",   FLACDecoder_AllocateBuffers,   FLACDecoder_FreeBuffers,   flacSync,   flacDecode,   flacFrames,   flacRate,   flacCh,   GIVE_NEXT_LOOP},
+  {"Vorbis", VORBISDecoder_AllocateBuffers, VORBISDecoder_FreeBuffers, vorbisSync, VORBISDecode, vorbisFrames, vorbisRate, vorbisCh, VORBIS_CONTINUE},
+  {"Opus",   OPUSDecoder_AllocateBuffers,   OPUSDecoder_FreeBuffers,   opusSync,   OPUSDecode,   opusFrames,   opusRate,   opusCh,   0},
+};
+
+// ============================================================================
+// Native FLAC: parse the metadata blocks like Audio::read_FLAC_Header()
+// Returns the offset of the first audio frame, -1 if the header is invalid
+// ============================================================================
+static int32_t parseFlacHeader(const uint8_t* data, size_t size) {
+  if (size < 42 || memcmp(data, "fLaC", 4) != 0) return -1;
+  size_t pos = 4;
+  bool last = false;
+  bool haveInfo = false;
+  while (!last) {
+    if (pos + 4 > size) return -1;
+    last = data[pos] & 0x80;
+    uint8_t type = data[pos] & 0x7F;
+    uint32_t len = ((uint32_t)data[pos + 1] << 16) | ((uint32_t)data[pos + 2] << 8) | data[pos + 3];
+    pos += 4;
+    if (pos + len > size) return -1;
+    if (type == 0 && len >= 18) {  // STREAMINFO
+      const uint8_t* s = data + pos;
+      uint32_t rate = ((uint32_t)s[10] << 12) | ((uint32_t)s[11] << 4) | (s[12] >> 4);
+      uint8_t channels = ((s[12] >> 1) & 0x07) + 1;
+      uint8_t bits = (((s[12] & 0x01) << 4) | (s[13] >> 4)) + 1;
+      uint32_t total = ((uint32_t)s[14] << 24) | ((uint32_t)s[15] << 16) | ((uint32_t)s[16] << 8) | s[17];
+      FLACSetRawBlockParams(channels, rate, bits, total, size - pos - len);
+      haveInfo = true;
+    }
+    pos += len;
+  }
+  return haveInfo ? (int32_t)pos : -1;
+}
+
+// ============================================================================
+// Reference comparison, per frame: the output is not kept
+// ============================================================================
+
+struct Conformance {
+  // Capture mode: called with each frame instead of comparing, sets captureFailed itself
+  void (*capture)(void* arg, const int16_t* out, size_t samples) = nullptr;
+  void* captureArg = nullptr;
+  bool captureFailed = false;
+  const int16_t* ref = nullptr; // Reference PCM, loaded before decoding
+  size_t refSamples = 0;
+  bool active = false;          // Reference loaded or capture target open
+  uint32_t crc = 0;
+  uint64_t compared = 0;        // Samples compared
+  uint64_t mismatches = 0;      // Samples that differ
+  uint64_t firstMismatch = 0;   // Sample index of the first difference
+  int32_t maxDiff = 0;
+  bool refShort = false;        // Reference ended before the output
+};
+
+static void checkOutput(Conformance& c, const int16_t* out, size_t samples) {
+  c.crc = benchCrc32(c.crc, (const uint8_t*)out, samples * sizeof(int16_t));
+  if (!c.active) return;
+  if (c.capture) {
+    c.capture(c.captureArg, out, samples);
+    return;
+  }
+  const int16_t* ref = c.ref + c.compared;
+  size_t got = samples < c.refSamples - c.compared ? samples : c.refSamples - c.compared;
+  if (got < samples) c.refShort = true;
+  for (size_t i = 0; i < got; i++) {
+    int32_t d = abs((int32_t)out[i] - ref[i]);
+    if (d == 0) continue;
+    if (c.mismatches++ == 0) c.firstMismatch = c.compared + i;
+    if (d > c.maxDiff) c.maxDiff = d;
+  }
+  c.compared += got;
+}
+
+// ============================================================================
+// One decode pass over a file in memory, same feeding pattern as
+// Audio::sendBytes(): find the sync word, decode, skip a byte and search
+// again after an error. The decoder is left allocated for the report,
+// release it afterwards. data needs INPUT_GUARD zeros after size
+// ============================================================================
+
+struct BenchRun {
+  uint32_t frames = 0;          // Decode calls that produced output
+  uint64_t samples = 0;         // Output frames (per channel)
+  uint32_t errors = 0;
+  uint64_t cycles = 0;
+  uint32_t worstCycles = 0;
+  uint64_t ns = 0;              // Time spent in the decoder, without the comparison or capture writes
+  size_t peakHeap[BENCH_HEAP_REGIONS] = {};
+  uint32_t rate = 0;            // Stream format, taken while decoding: Vorbis resets it at the last page
+  uint8_t channels = 0;
+  bool ok = true;               // Decoder initialized
+  bool badHeader = false;       // Native FLAC metadata could not be parsed
+};
+
+// conf may be nullptr, e.g. for a repeat whose output is the same
+static BenchRun benchDecode(const Decoder& dec, BenchCodec codec, uint8_t* data, int32_t size, Conformance* conf) {
+  BenchRun run;
+  // Heap baseline: everything the decoder allocates from here on counts
+  size_t baseHeap[BENCH_HEAP_REGIONS];
+  for (int r = 0; r < BENCH_HEAP_REGIONS; r++) baseHeap[r] = benchHeapInUse(r);
+  if (!dec.allocate()) {
+    run.ok = false;
+    return run;
+  }
+  if (codec == BENCH_OPUS) OPUSResetDecodeStats();
+
+  uint8_t* p = data;
+  int32_t left = size;
+  if (codec == BENCH_FLAC && memcmp(data, "fLaC", 4) == 0) {
+    int32_t start = parseFlacHeader(data, size);
+    if (start < 0) {
+      run.badHeader = true;
+      left = 0;
+    } else {
+      p += start;
+      left -= start;
+    }
+  }
+
+  bool synced = false;
+  int stalls = 0;
+  while (left > 0) {
+    if (!synced) {
+      int32_t sync = dec.findSync(p, left);
+      if (sync < 0) break;
+      p += sync;
+      left -= sync;
+      synced = true;
+    }
+
+    int32_t before = left;
+    uint64_t t0 = benchNanos();
+    uint32_t c0 = benchCycles();
+    int32_t ret = dec.decode(p, &left, pcm);
+    uint32_t c = benchCycles() - c0;
+    run.ns += benchNanos() - t0;
+
+    for (int r = 0; r < BENCH_HEAP_REGIONS; r++) {
+      size_t heap = benchHeapInUse(r);
+      if (heap > baseHeap[r] && heap - baseHeap[r] > run.peakHeap[r]) run.peakHeap[r] = heap - baseHeap[r];
+    }
+
+    if (ret < 0) {
+      run.errors++;
+      synced = false;
+      p++;
+      left--;
+      continue;
+    }
+    bool more = dec.moreOutput != 0 && ret == dec.moreOutput;
+    if (ret == 0 || more) {  // 0 is "no error" for every decoder
+      uint32_t n = dec.outputFrames();
+      if (n > 0) {
+        run.frames++;
+        run.samples += n;
+        run.rate = dec.sampleRate();
+        run.channels = dec.channels();
+        run.cycles += c;
+        if (c > run.worstCycles) run.worstCycles = c;
+        if (conf) checkOutput(*conf, pcm, n * (dec.channels() ? dec.channels() : 1));
+      }
+    }
+    // Nothing consumed: a state change of the Ogg parser (Vorbis returns VORBIS_PARSE_OGG_DONE between
+    // headers), or the truncated end of the file if it keeps happening
+    if (before == left && !more) {
+      if (++stalls > MAX_STALLED_CALLS) break;
+    } else {
+      stalls = 0;
+    }
+    p += before - left;
+  }
+  return run;
+}
+
+// ============================================================================
+// Report of a run, call before releasing the decoder (Opus mode statistics).
+// Returns false if the decoder failed or the output differs from the reference
+// ============================================================================
+static bool benchReport(const char* path, BenchCodec codec, const BenchRun& run, const Conformance& conf,
+                        const char* refPath) {
+  const Decoder& dec = decoders[codec];
+  if (!run.ok) {
+    benchPrintf("%s: %s decoder could not be initialized\n", path, dec.name);
+    return false;
+  }
+  if (run.badHeader) benchPrintf("%s: invalid FLAC header\n", path);
+
+  uint32_t rate = run.rate ? run.rate : 48000;
+  uint32_t audioMs = run.samples * 1000 / rate;
+  double ms = run.ns / 1e6;
+  benchPrintf("%s (%s, %u Hz, %u ch): %u ms audio decoded in %.1f ms (%.2f%% of real time)\n", path, dec.name,
+              (unsigned)rate, (unsigned)run.channels, (unsigned)audioMs, ms, audioMs ? 100.0 * ms / audioMs : 0.0);
+  if (run.frames) {
+    benchPrintf("  %u frames, %.1f frames/s, %llu cycles/frame (worst %u), %u errors\n", (unsigned)run.frames,
+                run.ns ? run.frames * 1e9 / run.ns : 0.0, (unsigned long long)(run.cycles / run.frames),
+                (unsigned)run.worstCycles, (unsigned)run.errors);
+  }
+#if BENCH_HEAP_REGIONS > 1
+  benchPrintf("  peak heap: %u bytes internal, %u bytes PSRAM\n", (unsigned)run.peakHeap[0], (unsigned)run.peakHeap[1]);
+#else
+  benchPrintf("  peak heap: %u bytes\n", (unsigned)run.peakHeap[0]);
+#endif
+  if (codec == BENCH_OPUS) {
+    const char* modeNames[] = {"SILK", "CELT", "hybrid"};
+    const OPUSDecodeStats_t* stats = OPUSGetDecodeStats();
+    for (int m = 0; m < 3; m++) {
+      if (!stats->frames[m]) continue;
+      if (m == 2) {  // Hybrid frames are skipped undecoded, there is nothing to time
+        benchPrintf("  %-6s %6u frames, not decoded\n", modeNames[m], (unsigned)stats->frames[m]);
+        continue;
+      }
+      benchPrintf("  %-6s %6u frames, %8llu cycles/frame\n", modeNames[m], (unsigned)stats->frames[m],
+                  (unsigned long long)(stats->cycles[m] / stats->frames[m]));
+    }
+  }
+
+  benchPrintf("  PCM CRC32 %08x", (unsigned)conf.crc);
+  if (conf.capture) {
+    bool written = conf.active && !conf.captureFailed;
+    benchPrintf(", reference %s %s\n", refPath, written ? "written" : "could not be created");
+    return written;
+  }
+  if (!conf.active) {
+    benchPrintf(", no reference %s\n", refPath);
+    return true;
+  }
+  bool refLong = conf.compared < conf.refSamples;
+  if (conf.mismatches == 0 && !conf.refShort && !refLong) {
+    benchPrintf(", bit-exact (%llu samples)\n", (unsigned long long)conf.compared);
+    return true;
+  }
+  benchPrintf(", MISMATCH: %llu of %llu samples differ", (unsigned long long)conf.mismatches,
+              (unsigned long long)conf.compared);
+  if (conf.mismatches) {
+    benchPrintf(", first at sample %llu, max diff %d", (unsigned long long)conf.firstMismatch, (int)conf.maxDiff);
+  }
+  if (conf.refShort) benchPrint(", output longer than reference");
+  if (refLong) benchPrint(", output shorter than reference");
+  benchPrint("\n");
+  return false;
+}
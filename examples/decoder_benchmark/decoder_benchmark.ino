@@ -0,0 +1,187 @@
+/*
+ * ============================================================================
+ * ESP32 Decoder Benchmark and Conformance Test
+ * ============================================================================
+ * Features: Runs every audio decoder on reference files without I2S or network
+ * - MP3, AAC (ADTS), FLAC (native and Ogg), Vorbis and Opus, all from memory
+ * - Reports frames/s, CPU cycles per frame (mean and worst) and peak heap use,
+ *   internal RAM and PSRAM separately
+ * - Compares the decoded PCM against a reference file next to each input
+ *   (same name plus ".pcm") and prints a CRC32 of the output, so a change to
+ *   a decoder can be shown to be faster and still bit-exact. The reference is
+ *   loaded before decoding and only the decode calls are timed, SD access
+ *   does not show in the figures
+ *
+ * Reference files are the decoder's own output as Audio consumes it:
+ * interleaved 16-bit little endian PCM. Create them once from a known-good
+ * build with CAPTURE_REFERENCE set to 1, or with an external decoder, e.g.
+ *   ffmpeg -i speech.mp3 -f s16le speech.mp3.pcm
+ * (external decoders may differ by rounding, the report shows the largest
+ * difference as well as the first mismatch).
+ *
+ * The decoder table, feeding loop and report are in DecoderBench.h, which
+ * extras/test/decoder_benchmark.cpp builds for a PC as well: the same
+ * benchmark and CRC32, for profiling a decoder change on the host before
+ * measuring it here. This sketch only adds SD access and the ESP32 counters.
+ *
+ * Hardware Requirements:
+ * - ESP32 or ESP32-S3 development board (PSRAM recommended)
+ * - SD card with the files listed in benchFiles[], missing ones are skipped
+ * ============================================================================
+ */
+
+#include <SD.h>
+#include <esp_heap_caps.h>
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+#include <AudioMemory.h>
+
+// ============================================================================
+// Hardware Pin Definitions
+// ============================================================================
+
+// SD card (SPI)
+#define SD_CS   10
+#define SD_SCK  12
+#define SD_MISO 13
+#define SD_MOSI 11
+
+// ============================================================================
+// Benchmark Configuration
+// ============================================================================
+
+// 1: write the output of this build as the reference instead of comparing
+#define CAPTURE_REFERENCE 0
+
+// ============================================================================
+// Platform hooks of DecoderBench.h
+// ============================================================================
+
+#define BENCH_HEAP_REGIONS 2  // 0: internal RAM, 1: PSRAM
+
+static uint32_t benchCycles() { return ESP.getCycleCount(); }
+static uint64_t benchNanos()  { return esp_timer_get_time() * 1000ULL; }
+
+static size_t benchHeapInUse(int region) {
+  uint32_t caps = region == 0 ? MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT : MALLOC_CAP_SPIRAM;
+  return heap_caps_get_total_size(caps) - heap_caps_get_free_size(caps);
+}
+
+static uint32_t benchCrc32(uint32_t crc, const uint8_t* buf, size_t len) { return esp_rom_crc32_le(crc, buf, len); }
+static void benchPrint(const char* text) { Serial.print(text); }
+
+#include "DecoderBench.h"
+
+// ============================================================================
+// Files
+// ============================================================================
+
+struct BenchFile {
+  const char* path;
+  BenchCodec codec;
+};
+
+const BenchFile benchFiles[] = {
+  {"/bench/music.mp3",  BENCH_MP3},
+  {"/bench/music.aac",  BENCH_AAC},
+  {"/bench/music.flac", BENCH_FLAC},
+  {"/bench/music.oga",  BENCH_FLAC},    // FLAC in Ogg
+  {"/bench/music.ogg",  BENCH_VORBIS},
+  {"/bench/music.opus", BENCH_OPUS},
+  {"/bench/speech.mp3", BENCH_MP3},
+  {"/bench/speech.opus", BENCH_OPUS},
+};
+
+struct CaptureFile {
+  File file;
+  Conformance* conf;
+};
+
+// CAPTURE_REFERENCE: write each frame to the reference file
+static void captureWrite(void* arg, const int16_t* out, size_t samples) {
+  CaptureFile* c = (CaptureFile*)arg;
+  size_t bytes = samples * sizeof(int16_t);
+  if (c->file.write((const uint8_t*)out, bytes) != bytes) c->conf->captureFailed = true;
+}
+
+// ============================================================================
+// Read a file into memory and decode it, return false if it could not be
+// decoded or differs from its reference
+// ============================================================================
+bool benchmarkFile(const char* path, int codec) {
+  const Decoder& dec = decoders[codec];
+  File f = SD.open(path);
+  if (!f) {
+    Serial.printf("%s: not found, skipped\n", path);
+    return false;
+  }
+  size_t size = f.size();
+  uint8_t* data = (uint8_t*)AudioMemory::calloc(size + INPUT_GUARD, 1, AUDIO_MEM_PSRAM_PREFERRED);
+  if (!data) {
+    Serial.printf("%s: out of memory (%u bytes)\n", path, (unsigned)(size + INPUT_GUARD));
+    f.close();
+    return false;
+  }
+  f.read(data, size);
+  f.close();
+
+  Conformance conf;
+  String refPath = String(path) + ".pcm";
+  int16_t* refData = nullptr;
+  CaptureFile captureFile = {File(), &conf};
+#if CAPTURE_REFERENCE
+  captureFile.file = SD.open(refPath, FILE_WRITE);
+  conf.capture = captureWrite;
+  conf.captureArg = &captureFile;
+  conf.active = (bool)captureFile.file;
+#else
+  // Read the whole reference now, no SD access while decoding
+  File refFile = SD.open(refPath);
+  if (refFile) {
+    size_t refSize = refFile.size();
+    refData = (int16_t*)AudioMemory::alloc(refSize ? refSize : 1, AUDIO_MEM_PSRAM_PREFERRED);
+    if (refData && refFile.read((uint8_t*)refData, refSize) == refSize) {
+      conf.ref = refData;
+      conf.refSamples = refSize / sizeof(int16_t);
+      conf.active = true;
+    } else {
+      Serial.printf("%s: reference %s does not fit into memory, not compared\n", path, refPath.c_str());
+    }
+    refFile.close();
+  }
+#endif
+
+  BenchRun run = benchDecode(dec, (BenchCodec)codec, data, size, &conf);
+  if (captureFile.file) captureFile.file.close();
+  bool ok = benchReport(path, (BenchCodec)codec, run, conf, refPath.c_str());
+
+  dec.release();
+  AudioMemory::release(refData);
+  AudioMemory::release(data);
+  return ok;
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println("\n=== Decoder benchmark ===");
+  Serial.printf("CPU: %u MHz, PSRAM: %u bytes\n", (unsigned)getCpuFrequencyMhz(), (unsigned)ESP.getPsramSize());
+#if CAPTURE_REFERENCE
+  Serial.println("Capturing reference PCM");
+#endif
+
+  SPI.begin(SD_SCK, SD_MISO, SD_MOSI, SD_CS);
+  if (!SD.begin(SD_CS)) {
+    Serial.println("SD card mount failed");
+    return;
+  }
+
+  for (size_t i = 0; i < sizeof(benchFiles) / sizeof(benchFiles[0]); i++) {
+    benchmarkFile(benchFiles[i].path, benchFiles[i].codec);
+  }
+  Serial.println("=== done ===");
+}
+
+void loop() {
+  delay(1000);
+}
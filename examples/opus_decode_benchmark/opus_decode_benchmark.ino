@@ -0,0 +1,141 @@
+/*
+ * ============================================================================
+ * ESP32 Opus Decode Benchmark
+ * ============================================================================
+ * Features: Measures the on-device Opus decoder without I2S or network
+ * - Decodes .opus files from the SD card as fast as possible
+ * - Reports CPU cycles per frame and real-time load for SILK, CELT and hybrid
+ * - Build once normally and once with -DOPUS_GENERIC_C (e.g. build_flags in
+ *   platformio.ini) to compare the Xtensa fast path against the exact C multiplies
+ *
+ * Hardware Requirements:
+ * - ESP32 or ESP32-S3 development board (PSRAM recommended)
+ * - SD card with test files, e.g. encoded with opus-tools:
+ *     opusenc --bitrate 16  --framesize 20 speech.wav /silk.opus
+ *     opusenc --bitrate 64  --framesize 20 music.wav  /celt.opus
+ *     opusenc --bitrate 24  --framesize 20 speech.wav /hybrid.opus
+ *   (the encoder picks the mode from the bitrate; the stats show which was used)
+ * ============================================================================
+ */
+
+#include <SD.h>
+#include <AudioMemory.h>
+#include <opus_decoder/opus_decoder.h>
+
+// ============================================================================
+// Hardware Pin Definitions
+// ============================================================================
+
+// SD card (SPI)
+#define SD_CS   10
+#define SD_SCK  12
+#define SD_MISO 13
+#define SD_MOSI 11
+
+// ============================================================================
+// Benchmark Configuration
+// ============================================================================
+
+const char* testFiles[] = {"/silk.opus", "/celt.opus", "/hybrid.opus"};
+const char* modeNames[] = {"SILK", "CELT", "hybrid"};
+
+// Output buffer, large enough for one 60 ms stereo frame at 48 kHz
+static int16_t pcm[2880 * 2];
+
+// ============================================================================
+// Decode one file from memory, return false if it could not be decoded
+// ============================================================================
+bool benchmarkFile(const char* path) {
+  File f = SD.open(path);
+  if (!f) {
+    Serial.printf("%s: not found, skipped\n", path);
+    return false;
+  }
+  size_t size = f.size();
+  uint8_t* data = (uint8_t*)AudioMemory::alloc(size, AUDIO_MEM_PSRAM_PREFERRED);
+  if (!data) {
+    Serial.printf("%s: out of memory (%u bytes)\n", path, (unsigned)size);
+    f.close();
+    return false;
+  }
+  f.read(data, size);
+  f.close();
+
+  if (!OPUSDecoder_AllocateBuffers()) {
+    Serial.println("OPUSDecoder could not be initialized");
+    AudioMemory::release(data);
+    return false;
+  }
+  OPUSResetDecodeStats();
+
+  // Same feeding pattern as Audio::sendBytes(): find the Ogg sync, then decode until the input is used up
+  uint8_t* p = data;
+  int32_t left = size;
+  int32_t sync = OPUSFindSyncWord(p, left);
+  if (sync < 0) {
+    Serial.printf("%s: no Ogg sync word\n", path);
+    OPUSDecoder_FreeBuffers();
+    AudioMemory::release(data);
+    return false;
+  }
+  p += sync;
+  left -= sync;
+
+  uint32_t samples = 0;
+  uint32_t t0 = millis();
+  while (left > 0) {
+    int32_t before = left;
+    int32_t ret = OPUSDecode(p, &left, pcm);
+    if (ret < 0) {
+      Serial.printf("%s: decode error %d at offset %u\n", path, (int)ret, (unsigned)(p - data));
+      break;
+    }
+    if (ret == ERR_OPUS_NONE) samples += OPUSGetOutputSamps();
+    if (before == left) break;  // no progress, truncated last page
+    p += before - left;
+  }
+  uint32_t ms = millis() - t0;
+
+  uint32_t rate = OPUSGetSampRate() ? OPUSGetSampRate() : 48000;
+  uint32_t audioMs = (uint64_t)samples * 1000 / rate;
+  Serial.printf("%s: %u bytes, %u ms audio decoded in %u ms (%.1f%% of real time)\n", path, (unsigned)size,
+                (unsigned)audioMs, (unsigned)ms, audioMs ? 100.0f * ms / audioMs : 0.0f);
+
+  const OPUSDecodeStats_t* stats = OPUSGetDecodeStats();
+  for (int m = 0; m < 3; m++) {
+    if (!stats->frames[m]) continue;
+    Serial.printf("  %-6s %6u frames, %8u cycles/frame\n", modeNames[m], (unsigned)stats->frames[m],
+                  (unsigned)(stats->cycles[m] / stats->frames[m]));
+  }
+
+  OPUSDecoder_FreeBuffers();
+  AudioMemory::release(data);
+  return true;
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println("\n=== Opus decode benchmark ===");
+#ifdef OPUS_GENERIC_C
+  Serial.println("Multiplies: generic C");
+#else
+  Serial.println("Multiplies: Xtensa MULSH fast path");
+#endif
+  Serial.printf("CPU: %u MHz\n", (unsigned)getCpuFrequencyMhz());
+
+  SPI.begin(SD_SCK, SD_MISO, SD_MOSI, SD_CS);
+  if (!SD.begin(SD_CS)) {
+    Serial.println("SD card mount failed");
+    return;
+  }
+
+  for (size_t i = 0; i < sizeof(testFiles) / sizeof(testFiles[0]); i++) {
+    benchmarkFile(testFiles[i]);
+  }
+  Serial.println("=== done ===");
+}
+
+void loop() {
+  delay(1000);
+}
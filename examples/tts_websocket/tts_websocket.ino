@@ -128,6 +128,7 @@ void setup() {
   ttsChat.setVolume(tts_volume);
   ttsChat.setPitch(tts_pitch);
   ttsChat.setAudioParams(tts_sample_rate, tts_bitrate);  // Set sample rate first!
+  // ttsChat.setAudioFormat("mp3");  // Optional: mp3 downlink at tts_bitrate, decoded on device
 
   // ========== Initialize Speaker ==========
   Serial.println("\nInitializing speaker...");
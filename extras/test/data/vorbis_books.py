@@ -0,0 +1,276 @@
+#!/usr/bin/env python3
+"""Writes vorbis_books.ogg, the stream of vorbis_decoder_test.
+
+A synthetic stereo Vorbis stream (44.1 kHz, blocks of 256 and 2048) whose
+setup header holds one codebook of every kind src/vorbis_decoder unpacks:
+maptype 0, ordered lengths, sparse, dec_type 1 from maptype 1 and 2,
+dec_type 2 with 8 and 16 bit values, dec_type 3, a sequential floor0 book
+and an 8-dimensional one. Both floor types, all three residue types, channel
+coupling and a two-submap mapping are used. The audio packets are seeded
+random bytes: the output is noise, but every floor, residue and codebook
+path is taken and the PCM is fully determined by the file.
+
+Usage: vorbis_books.py [out.ogg]
+"""
+
+import random
+import struct
+import sys
+
+
+class BitWriter:
+    """LSB first, as in the Vorbis bitstream."""
+
+    def __init__(self):
+        self.bits = []
+
+    def put(self, value, n):
+        for i in range(n):
+            self.bits.append((value >> i) & 1)
+
+    def bytes(self):
+        out = bytearray((len(self.bits) + 7) // 8)
+        for i, bit in enumerate(self.bits):
+            if bit:
+                out[i >> 3] |= 1 << (i & 7)
+        return bytes(out)
+
+
+def ilog(v):
+    r = 0
+    while v:
+        r += 1
+        v >>= 1
+    return r
+
+
+def complete_lengths(n, rnd):
+    """Codeword lengths of a complete prefix code for n entries."""
+    if n == 1:
+        return [1]
+    k = n.bit_length() - 1
+    if (1 << k) == n:
+        lengths = [k] * n
+    else:
+        longer = 2 * (n - (1 << k))
+        lengths = [k + 1] * longer + [k] * (n - longer)
+    rnd.shuffle(lengths)
+    return lengths
+
+
+def vorbis_float(mantissa, exponent, negative=False):
+    return (mantissa & 0x1fffff) | ((exponent + 788) & 0x3ff) << 21 | (0x80000000 if negative else 0)
+
+
+def codebook(bw, rnd, dim, entries, maptype=0, ordered=False, sparse=False, q_bits=4, q_seq=0, quantvals=None):
+    bw.put(0x564342, 24)
+    bw.put(dim, 16)
+    bw.put(entries, 24)
+    if sparse:
+        used = [rnd.random() < 0.7 for _ in range(entries)]
+        used[0] = used[1] = True
+        it = iter(complete_lengths(sum(used), rnd))
+        lengths = [next(it) if u else 0 for u in used]
+    else:
+        lengths = complete_lengths(entries, rnd)
+        if ordered:
+            lengths.sort()
+    if ordered:
+        bw.put(1, 1)
+        bw.put(lengths[0] - 1, 5)
+        i, cur = 0, lengths[0]
+        while i < entries:
+            count = sum(1 for x in lengths[i:] if x == cur)
+            bw.put(count, ilog(entries - i))
+            i += count
+            cur += 1
+    else:
+        bw.put(0, 1)
+        bw.put(1 if sparse else 0, 1)
+        for length in lengths:
+            if sparse:
+                bw.put(1 if length else 0, 1)
+                if length:
+                    bw.put(length - 1, 5)
+            else:
+                bw.put(length - 1, 5)
+    bw.put(maptype, 4)
+    if maptype:
+        bw.put(vorbis_float(0x100000 + rnd.randrange(1 << 19), -20 - rnd.randrange(4), True), 32)  # minimum
+        bw.put(vorbis_float(0x100000 + rnd.randrange(1 << 19), -22 - rnd.randrange(4)), 32)        # delta
+        bw.put(q_bits - 1, 4)
+        bw.put(q_seq, 1)
+        for _ in range(quantvals if maptype == 1 else entries * dim):
+            bw.put(rnd.randrange(1 << q_bits), q_bits)
+
+
+def floor1(bw, rnd, partition_classes, classes, multiplier, rangebits):
+    bw.put(1, 16)
+    bw.put(len(partition_classes), 5)
+    for c in partition_classes:
+        bw.put(c, 4)
+    for dim, subclasses, masterbook, subbooks in classes:
+        bw.put(dim - 1, 3)
+        bw.put(subclasses, 2)
+        if subclasses:
+            bw.put(masterbook, 8)
+        for k in range(1 << subclasses):
+            bw.put(subbooks[k] + 1, 8)
+    bw.put(multiplier - 1, 2)
+    bw.put(rangebits, 4)
+    count = sum(classes[c][0] for c in partition_classes)
+    for x in rnd.sample(range(1, 1 << rangebits), count):
+        bw.put(x, rangebits)
+
+
+def floor0(bw, order, rate, bark_map_size, amplitude_bits, amplitude_offset, books):
+    bw.put(0, 16)
+    bw.put(order, 8)
+    bw.put(rate, 16)
+    bw.put(bark_map_size, 16)
+    bw.put(amplitude_bits, 6)
+    bw.put(amplitude_offset, 8)
+    bw.put(len(books) - 1, 4)
+    for b in books:
+        bw.put(b, 8)
+
+
+def residue(bw, rtype, begin, end, grouping, classbook, cascades):
+    """cascades: per partition class a dict stage -> codebook."""
+    bw.put(rtype, 16)
+    bw.put(begin, 24)
+    bw.put(end, 24)
+    bw.put(grouping - 1, 24)
+    bw.put(len(cascades) - 1, 6)
+    bw.put(classbook, 8)
+    for stages in cascades:
+        mask = sum(1 << s for s in stages)
+        bw.put(mask & 7, 3)
+        bw.put(1 if mask >> 3 else 0, 1)
+        if mask >> 3:
+            bw.put(mask >> 3, 5)
+    for stages in cascades:
+        for s in range(8):
+            if s in stages:
+                bw.put(stages[s], 8)
+
+
+def mapping(bw, channels, coupling, submaps, mux):
+    """submaps: list of (floor, residue); mux: submap per channel if there are several."""
+    bw.put(0, 16)
+    bw.put(1 if len(submaps) > 1 else 0, 1)
+    if len(submaps) > 1:
+        bw.put(len(submaps) - 1, 4)
+    bw.put(1 if coupling else 0, 1)
+    if coupling:
+        bw.put(len(coupling) - 1, 8)
+        for magnitude, angle in coupling:
+            bw.put(magnitude, ilog(channels - 1))
+            bw.put(angle, ilog(channels - 1))
+    bw.put(0, 2)
+    if len(submaps) > 1:
+        for m in mux:
+            bw.put(m, 4)
+    for f, r in submaps:
+        bw.put(0, 8)
+        bw.put(f, 8)
+        bw.put(r, 8)
+
+
+def ogg_crc(data):
+    crc = 0
+    for b in data:
+        crc ^= b << 24
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x04c11db7 if crc & 0x80000000 else crc << 1) & 0xffffffff
+    return crc
+
+
+def ogg_page(packets, header_type, sequence, granule, serial=0x1234):
+    segments, body = [], b''
+    for p in packets:
+        n = len(p)
+        while n >= 255:
+            segments.append(255)
+            n -= 255
+        segments.append(n)
+        body += p
+    assert len(segments) <= 255
+    page = bytearray(b'OggS' + bytes([0, header_type]) + struct.pack('<qIII', granule, serial, sequence, 0) +
+                     bytes([len(segments)]) + bytes(segments) + body)
+    page[22:26] = struct.pack('<I', ogg_crc(page))
+    return bytes(page)
+
+
+def vorbis_books(seed=7, audio_packets=64):
+    rnd = random.Random(seed)
+    channels, rate = 2, 44100
+    short_exp, long_exp = 8, 11
+    ident = b'\x01vorbis' + struct.pack('<IBIiiiB', 0, channels, rate, 0, 128000, 0,
+                                        (long_exp << 4) | short_exp) + b'\x01'
+    vendor, tag = b'vorbis_books.py', b'TITLE=codebook test'
+    comment = (b'\x03vorbis' + struct.pack('<I', len(vendor)) + vendor + struct.pack('<I', 1) +
+               struct.pack('<I', len(tag)) + tag + b'\x01')
+
+    bw = BitWriter()
+    books = [
+        dict(dim=2, entries=4),                                        # 0 floor1 class book
+        dict(dim=1, entries=16),                                       # 1 floor1 values
+        dict(dim=1, entries=8, ordered=True),                          # 2 ordered lengths
+        dict(dim=2, entries=9),                                        # 3 residue class book
+        dict(dim=2, entries=81, maptype=1, q_bits=4, quantvals=9),     # 4 dec_type 1
+        dict(dim=4, entries=256, maptype=1, q_bits=8, quantvals=4),    # 5 dec_type 2, 8 bit values
+        dict(dim=2, entries=20, maptype=2, q_bits=5),                  # 6 maptype 2, dec_type 1
+        dict(dim=4, entries=12, maptype=2, q_bits=9),                  # 7 dec_type 3, 16 bit values
+        dict(dim=2, entries=25, maptype=1, q_bits=3, quantvals=5, sparse=True),  # 8 sparse
+        dict(dim=2, entries=64, maptype=1, q_bits=6, quantvals=8, q_seq=1),      # 9 floor0, sequential
+        dict(dim=8, entries=256, maptype=1, q_bits=1, quantvals=2),    # 10 wide vector
+        dict(dim=2, entries=49, maptype=1, q_bits=10, quantvals=7),    # 11 dec_type 2, 16 bit values
+        dict(dim=1, entries=300, sparse=True),                         # 12 never used
+    ]
+    bw.put(len(books) - 1, 8)
+    for b in books:
+        codebook(bw, rnd, **b)
+    bw.put(0, 6)   # time domain transforms
+    bw.put(0, 16)
+
+    bw.put(2 - 1, 6)
+    floor1(bw, rnd, [0, 1, 0], [(2, 1, 0, [1, 2]), (3, 0, 0, [1])], 2, 8)
+    floor0(bw, 10, rate, 256, 6, 60, [9])
+
+    half = (1 << long_exp) // 2
+    bw.put(3 - 1, 6)
+    residue(bw, 1, 0, half, 16, 3, [{}, {0: 4}, {0: 5, 1: 8}])
+    residue(bw, 2, 0, half * channels, 32, 3, [{}, {0: 6, 2: 7}, {0: 10, 1: 11}])
+    residue(bw, 0, 32, half // 2, 8, 3, [{0: 4}, {0: 7}, {1: 11}])
+
+    bw.put(2 - 1, 6)
+    mapping(bw, channels, [(0, 1)], [(0, 1)], None)
+    mapping(bw, channels, [], [(0, 0), (1, 2)], [0, 1])
+
+    bw.put(2 - 1, 6)   # modes: short blocks on mapping 0, long blocks on mapping 1
+    for blockflag, m in ((0, 0), (1, 1)):
+        bw.put(blockflag, 1)
+        bw.put(0, 16)
+        bw.put(0, 16)
+        bw.put(m, 8)
+    bw.put(1, 1)       # framing
+    setup = b'\x05vorbis' + bw.bytes()
+
+    out = ogg_page([ident], 0x02, 0, 0) + ogg_page([comment, setup], 0, 1, 0)
+    sequence, pending = 2, []
+    for i in range(audio_packets):
+        p = bytearray(rnd.randrange(256) for _ in range(rnd.randrange(20, 250)))
+        p[0] &= 0xfe   # audio packet
+        pending.append(bytes(p))
+        if len(pending) == 8 or i == audio_packets - 1:
+            last = i == audio_packets - 1
+            out += ogg_page(pending, 0x04 if last else 0, sequence, 0)
+            sequence += 1
+            pending = []
+    return out
+
+
+if __name__ == '__main__':
+    with open(sys.argv[1] if len(sys.argv) > 1 else 'vorbis_books.ogg', 'wb') as f:
+        f.write(vorbis_books())
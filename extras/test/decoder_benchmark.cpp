@@ -0,0 +1,181 @@
+/**
+ * @file decoder_benchmark.cpp
+ * @brief Host build of examples/decoder_benchmark: speed, memory and conformance of the decoders in src/
+ *
+ * Usage: decoder_benchmark [-c] [-r repeats] file...
+ *   The codec follows the extension (.mp3 .aac .flac .oga .ogg .opus). The
+ *   reference is the file name plus ".pcm", interleaved 16-bit little endian
+ *   PCM as Audio consumes it, the same files the sketch reads from SD. -c
+ *   writes the output of this build as the reference instead of comparing.
+ *   With -r the file is decoded several times and the fastest run is shown.
+ *
+ * The decoder table, feeding loop and report are the sketch's, from
+ * examples/decoder_benchmark/DecoderBench.h; this file only supplies the
+ * host counters and file access. The CRC32 is the one esp_rom_crc32_le()
+ * prints, so a host run and a device run of the same file can be compared
+ * directly. Cycles are TSC ticks on x86 and nanoseconds elsewhere; peak
+ * memory is what the decoder holds on the heap at most.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include <vector>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//----------------------------------------------------------------------------------------------------------------------
+// Platform hooks of DecoderBench.h
+
+#define BENCH_HEAP_REGIONS 1
+
+static uint32_t benchCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return (uint32_t)__rdtsc();
+#else
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+#endif
+}
+
+static uint64_t benchNanos() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static size_t benchHeapInUse(int region) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  struct mallinfo2 mi = mallinfo2();
+  return mi.uordblks + mi.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+// Same polynomial and conditioning as esp_rom_crc32_le()
+static uint32_t benchCrc32(uint32_t crc, const uint8_t* p, size_t n) {
+  crc = ~crc;
+  while (n--) {
+    crc ^= *p++;
+    for (int i = 0; i < 8; i++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+  }
+  return ~crc;
+}
+
+static void benchPrint(const char* text) { fputs(text, stdout); }
+
+#include "../../examples/decoder_benchmark/DecoderBench.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+// File access
+
+static bool codecOf(const char* path, BenchCodec& codec) {
+  const char* ext = strrchr(path, '.');
+  if (!ext) return false;
+  if (!strcmp(ext, ".mp3")) codec = BENCH_MP3;
+  else if (!strcmp(ext, ".aac")) codec = BENCH_AAC;
+  else if (!strcmp(ext, ".flac") || !strcmp(ext, ".oga")) codec = BENCH_FLAC;   // .oga: FLAC in Ogg
+  else if (!strcmp(ext, ".ogg")) codec = BENCH_VORBIS;
+  else if (!strcmp(ext, ".opus")) codec = BENCH_OPUS;
+  else return false;
+  return true;
+}
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& data) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data.resize(size > 0 ? size : 0);
+  bool ok = fread(data.data(), 1, data.size(), f) == data.size();
+  fclose(f);
+  return ok;
+}
+
+struct CaptureFile {
+  FILE* file;
+  Conformance* conf;
+};
+
+static void captureWrite(void* arg, const int16_t* out, size_t samples) {
+  CaptureFile* c = (CaptureFile*)arg;
+  if (fwrite(out, sizeof(int16_t), samples, c->file) != samples) c->conf->captureFailed = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static bool benchmarkFile(const char* path, bool capture, int repeats) {
+  BenchCodec codec;
+  if (!codecOf(path, codec)) {
+    printf("%s: unknown extension, skipped\n", path);
+    return false;
+  }
+  const Decoder& dec = decoders[codec];
+  std::vector<uint8_t> data;
+  if (!readFile(path, data) || data.empty()) {
+    printf("%s: not found, skipped\n", path);
+    return false;
+  }
+  const int32_t size = (int32_t)data.size();
+  data.resize(size + INPUT_GUARD);
+
+  Conformance conf;
+  std::string refPath = std::string(path) + ".pcm";
+  std::vector<uint8_t> refBytes;  // Read the whole reference now, no file access while decoding
+  CaptureFile captureFile = {nullptr, &conf};
+  if (capture) {
+    captureFile.file = fopen(refPath.c_str(), "wb");
+    conf.capture = captureWrite;
+    conf.captureArg = &captureFile;
+    conf.active = captureFile.file != nullptr;
+  } else if (readFile(refPath, refBytes)) {
+    conf.ref = (const int16_t*)refBytes.data();
+    conf.refSamples = refBytes.size() / sizeof(int16_t);
+    conf.active = true;
+  }
+
+  // Every run decodes a fresh copy, a decoder may work on its input in place
+  BenchRun best;
+  for (int r = 0; r < repeats; r++) {
+    std::vector<uint8_t> input = data;
+    BenchRun run = benchDecode(dec, codec, input.data(), size, r == 0 ? &conf : nullptr);
+    if (r == 0 || !run.ok || run.ns < best.ns) best = run;
+    if (!run.ok) break;
+    if (r < repeats - 1) dec.release();
+  }
+  if (captureFile.file && fclose(captureFile.file) != 0) conf.captureFailed = true;
+
+  bool ok = benchReport(path, codec, best, conf, refPath.c_str());
+  dec.release();
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  bool capture = false;
+  int repeats = 1;
+  int first = 1;
+  for (; first < argc && argv[first][0] == '-'; first++) {
+    if (!strcmp(argv[first], "-c")) {
+      capture = true;
+    } else if (!strcmp(argv[first], "-r") && first + 1 < argc) {
+      repeats = atoi(argv[++first]);
+      if (repeats < 1) repeats = 1;
+    } else {
+      break;
+    }
+  }
+  if (first >= argc) {
+    fprintf(stderr, "usage: %s [-c] [-r repeats] file...\n", argv[0]);
+    return 2;
+  }
+
+  bool ok = true;
+  for (int i = first; i < argc; i++) ok = benchmarkFile(argv[i], capture, repeats) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,662 @@
+/**
+ * @file flac_decoder_test.cpp
+ * @brief Host regression test for src/flac_decoder
+ *
+ * Every frame is assembled here bit by bit from known PCM, decoded by the
+ * library decoder and compared sample by sample. Building the frames by hand
+ * covers each subframe type, residual coding, stereo mode and block size code
+ * on purpose, together with the edge cases an encoder rarely produces: Rice
+ * residuals that need all 32 bits, 31 bit escaped partitions and wasted bits
+ * up to the full sample depth.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include "flac_decoder/flac_decoder.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+// Bit writer, MSB first as in the FLAC bitstream
+
+struct BitWriter {
+  std::vector<uint8_t> bytes;
+  uint32_t acc = 0;
+  int bits = 0;
+
+  void bit(uint32_t b) {
+    acc = (acc << 1) | (b & 1);
+    if (++bits == 8) {
+      bytes.push_back((uint8_t)acc);
+      acc = 0;
+      bits = 0;
+    }
+  }
+  void put(uint64_t v, int n) {
+    for (int i = n - 1; i >= 0; i--) bit((uint32_t)(v >> i));
+  }
+  void putSigned(int64_t v, int n) { put((uint64_t)v, n); }
+  void putUnary(uint32_t q) {
+    for (; q; q--) bit(0);
+    bit(1);
+  }
+  void align() {
+    while (bits) bit(0);
+  }
+};
+
+static uint8_t crc8(const uint8_t* p, size_t n) {
+  uint8_t crc = 0;
+  while (n--) {
+    crc ^= *p++;
+    for (int i = 0; i < 8; i++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+static uint16_t crc16(const uint8_t* p, size_t n) {
+  uint16_t crc = 0;
+  while (n--) {
+    crc ^= (uint16_t)(*p++) << 8;
+    for (int i = 0; i < 8; i++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x8005) : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Frame description
+
+enum SubframeType { SUB_CONSTANT, SUB_VERBATIM, SUB_FIXED, SUB_LPC };
+
+struct SubframeSpec {
+  SubframeType type = SUB_FIXED;
+  int order = 2;                 // FIXED 0..4, LPC 1..32
+  int wasted = 0;                // wasted bits-per-sample, the samples must be multiples of 1 << wasted
+  int method = 0;                // 0: 4 bit Rice parameters, 1: 5 bit
+  int partitionOrder = 0;
+  int param = -1;                // Rice parameter for every partition, -1: chosen from the residuals
+  uint32_t escapeMask = 0;       // partitions sent as escaped binary
+  int escapeBits = -1;           // bits per escaped residual, -1: smallest that fits
+  int precision = 14;            // LPC coefficient precision
+  std::vector<int32_t> coefs;    // LPC coefficients, newest sample first; empty: computed from the signal
+  int shift = 0;                 // LPC shift, used with explicit coefs
+};
+
+struct FrameSpec {
+  int chanAsgn = 0;              // 0: mono, 1: left/right, 8: left/side, 9: side/right, 10: mid/side
+  std::vector<int32_t> left, right;
+  SubframeSpec sub[2];
+};
+
+struct StreamSpec {
+  const char* name;
+  int channels;
+  int bps;
+  std::vector<FrameSpec> frames;
+};
+
+static bool s_failed = false;
+
+static void fail(const char* stream, const char* what) {
+  printf("FAIL %s: %s\n", stream, what);
+  s_failed = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Encoder
+
+static uint32_t zigzag(int32_t v) {
+  return v >= 0 ? (uint32_t)v << 1 : ((uint32_t)(-(int64_t)v) << 1) - 1;
+}
+
+static int signedBits(const int64_t* v, int n) {
+  int bits = 0;
+  for (int i = 0; i < n; i++) {
+    int b = 1;
+    while (v[i] < -(1LL << (b - 1)) || v[i] >= (1LL << (b - 1))) b++;
+    if (v[i] != 0 && b > bits) bits = b;
+  }
+  return bits;
+}
+
+static bool writeResiduals(BitWriter& bw, const std::vector<int64_t>& res, int warmup, int blockSize,
+                           const SubframeSpec& spec) {
+  int paramBits = spec.method == 0 ? 4 : 5;
+  int escape = (1 << paramBits) - 1;
+  int partitions = 1 << spec.partitionOrder;
+  if (blockSize % partitions || blockSize / partitions < warmup) return false;
+  int partitionSize = blockSize / partitions;
+
+  bw.put(spec.method, 2);
+  bw.put(spec.partitionOrder, 4);
+  size_t idx = 0;
+  for (int p = 0; p < partitions; p++) {
+    int count = partitionSize - (p == 0 ? warmup : 0);
+    const int64_t* part = res.data() + idx;
+    idx += count;
+
+    if (spec.escapeMask & (1u << p)) {
+      int bits = spec.escapeBits >= 0 ? spec.escapeBits : signedBits(part, count);
+      if (bits > 31 || bits < signedBits(part, count)) return false;
+      bw.put(escape, paramBits);
+      bw.put(bits, 5);
+      for (int i = 0; i < count; i++) bw.putSigned(part[i], bits);
+      continue;
+    }
+
+    int param = spec.param;
+    if (param < 0) {
+      double mean = 0;
+      for (int i = 0; i < count; i++) mean += zigzag((int32_t)part[i]);
+      mean /= count ? count : 1;
+      param = mean >= 1 ? (int)log2(mean) : 0;
+      if (param > escape - 1) param = escape - 1;
+    }
+    if (param >= escape) return false;
+    bw.put(param, paramBits);
+    for (int i = 0; i < count; i++) {
+      uint32_t u = zigzag((int32_t)part[i]);
+      bw.putUnary(u >> param);
+      bw.put(u & ((1ULL << param) - 1), param);
+    }
+  }
+  return true;
+}
+
+// Prediction the way the decoder computes it: every partial sum must fit 32 bits
+static bool predict(const std::vector<int64_t>& x, size_t i, const std::vector<int32_t>& coefs, int shift,
+                    int64_t& prediction) {
+  int64_t sum = 0;
+  for (size_t j = 0; j < coefs.size(); j++) {
+    sum += x[i - 1 - j] * coefs[j];
+    if (sum < INT32_MIN || sum > INT32_MAX) return false;
+  }
+  prediction = sum >> shift;
+  return true;
+}
+
+static bool residualsFor(const std::vector<int64_t>& x, const std::vector<int32_t>& coefs, int shift,
+                         std::vector<int64_t>& res) {
+  res.clear();
+  for (size_t i = coefs.size(); i < x.size(); i++) {
+    int64_t prediction;
+    if (!predict(x, i, coefs, shift, prediction)) return false;
+    int64_t r = x[i] - prediction;
+    if (r < INT32_MIN || r > INT32_MAX) return false;
+    res.push_back(r);
+  }
+  return true;
+}
+
+// Levinson-Durbin on the autocorrelation, quantized like a reference encoder
+static bool lpcCoefs(const std::vector<int64_t>& x, int order, int precision, std::vector<int32_t>& coefs,
+                     int& shift) {
+  std::vector<double> r(order + 1, 0.0), a(order + 1, 0.0), tmp(order + 1);
+  for (int lag = 0; lag <= order; lag++) {
+    for (size_t i = lag; i < x.size(); i++) r[lag] += (double)x[i] * (double)x[i - lag];
+  }
+  r[0] *= 1.0 + 1e-9;
+  double err = r[0];
+  if (err <= 0) return false;
+  for (int i = 1; i <= order; i++) {
+    double k = r[i];
+    for (int j = 1; j < i; j++) k -= a[j] * r[i - j];
+    k /= err;
+    tmp = a;
+    a[i] = k;
+    for (int j = 1; j < i; j++) a[j] = tmp[j] - k * tmp[i - j];
+    err *= 1.0 - k * k;
+    if (err <= 0) break;
+  }
+  double cmax = 0;
+  for (int i = 1; i <= order; i++) cmax = fmax(cmax, fabs(a[i]));
+  int limit = (1 << (precision - 1)) - 1;
+  shift = precision - 2 - (cmax > 0 ? (int)ceil(log2(cmax)) : 0);
+  if (shift > 15) shift = 15;
+  for (; shift >= 0; shift--) {
+    coefs.clear();
+    for (int i = 1; i <= order; i++) {
+      long q = lround(a[i] * (1 << shift));
+      coefs.push_back((int32_t)(q > limit ? limit : q < -limit ? -limit : q));
+    }
+    std::vector<int64_t> res;
+    if (residualsFor(x, coefs, shift, res)) return true;
+  }
+  return false;
+}
+
+static bool writeSubframe(BitWriter& bw, const std::vector<int64_t>& samples, int depth, const SubframeSpec& spec) {
+  int n = (int)samples.size();
+  std::vector<int64_t> x(n);
+  for (int i = 0; i < n; i++) {
+    if (samples[i] & ((1LL << spec.wasted) - 1)) return false;
+    x[i] = samples[i] >> spec.wasted;
+  }
+  int d = depth - spec.wasted;
+  for (int i = 0; i < n; i++) {
+    if (x[i] < -(1LL << (d - 1)) || x[i] >= (1LL << (d - 1))) return false;
+  }
+
+  int type = spec.type == SUB_CONSTANT ? 0 : spec.type == SUB_VERBATIM ? 1
+           : spec.type == SUB_FIXED ? 8 + spec.order : 31 + spec.order;
+  bw.put(0, 1);
+  bw.put(type, 6);
+  if (spec.wasted) {
+    bw.put(1, 1);
+    bw.putUnary(spec.wasted - 1);
+  } else {
+    bw.put(0, 1);
+  }
+
+  if (spec.type == SUB_CONSTANT) {
+    for (int i = 1; i < n; i++) {
+      if (x[i] != x[0]) return false;
+    }
+    bw.putSigned(x[0], d);
+    return true;
+  }
+  if (spec.type == SUB_VERBATIM) {
+    for (int i = 0; i < n; i++) bw.putSigned(x[i], d);
+    return true;
+  }
+
+  std::vector<int32_t> coefs;
+  int shift = 0;
+  if (spec.type == SUB_FIXED) {
+    static const int32_t fixedCoefs[5][4] = {{0}, {1}, {2, -1}, {3, -3, 1}, {4, -6, 4, -1}};
+    if (spec.order > 4) return false;
+    coefs.assign(fixedCoefs[spec.order], fixedCoefs[spec.order] + spec.order);
+  } else if (!spec.coefs.empty()) {
+    coefs = spec.coefs;
+    shift = spec.shift;
+  } else if (!lpcCoefs(x, spec.order, spec.precision, coefs, shift)) {
+    return false;
+  }
+  if ((int)coefs.size() != spec.order || n < spec.order) return false;
+
+  std::vector<int64_t> res;
+  if (!residualsFor(x, coefs, shift, res)) return false;
+  for (int i = 0; i < spec.order; i++) bw.putSigned(x[i], d);
+  if (spec.type == SUB_LPC) {
+    bw.put(spec.precision - 1, 4);
+    bw.putSigned(shift, 5);
+    for (int32_t c : coefs) bw.putSigned(c, spec.precision);
+  }
+  return writeResiduals(bw, res, spec.order, n, spec);
+}
+
+static int blockSizeCode(int blockSize, int& extraBits) {
+  extraBits = 0;
+  if (blockSize == 192) return 1;
+  for (int code = 2; code <= 5; code++) {
+    if (blockSize == 576 << (code - 2)) return code;
+  }
+  for (int code = 8; code <= 15; code++) {
+    if (blockSize == 256 << (code - 8)) return code;
+  }
+  extraBits = blockSize <= 256 ? 8 : 16;
+  return blockSize <= 256 ? 6 : 7;
+}
+
+static bool writeFrame(BitWriter& bw, const FrameSpec& f, int bps, int frameNumber) {
+  int n = (int)f.left.size();
+  int extraBits;
+  int code = blockSizeCode(n, extraBits);
+  int sizeCode = bps == 8 ? 1 : bps == 12 ? 2 : 4;
+  size_t start = bw.bytes.size();
+
+  bw.put(0x3FFE, 14);
+  bw.put(0, 1);                  // reserved
+  bw.put(0, 1);                  // fixed block size
+  bw.put(code, 4);
+  bw.put(9, 4);                  // 44.1 kHz
+  bw.put(f.chanAsgn, 4);
+  bw.put(sizeCode, 3);
+  bw.put(0, 1);                  // reserved
+  if (frameNumber > 127) return false;
+  bw.put(frameNumber, 8);        // one byte UTF-8 frame number
+  if (extraBits) bw.put(n - 1, extraBits);
+  bw.put(crc8(bw.bytes.data() + start, bw.bytes.size() - start), 8);
+
+  std::vector<int64_t> l(f.left.begin(), f.left.end());
+  std::vector<int64_t> r(f.right.begin(), f.right.end()), side(n), mid(n);
+  if (f.chanAsgn != 0 && (int)r.size() != n) return false;
+  for (int i = 0; f.chanAsgn >= 8 && i < n; i++) {
+    side[i] = l[i] - r[i];
+    mid[i] = (l[i] + r[i]) >> 1;
+  }
+
+  bool ok;
+  switch (f.chanAsgn) {
+    case 0:  ok = writeSubframe(bw, l, bps, f.sub[0]); break;
+    case 1:  ok = writeSubframe(bw, l, bps, f.sub[0]) && writeSubframe(bw, r, bps, f.sub[1]); break;
+    case 8:  ok = writeSubframe(bw, l, bps, f.sub[0]) && writeSubframe(bw, side, bps + 1, f.sub[1]); break;
+    case 9:  ok = writeSubframe(bw, side, bps + 1, f.sub[0]) && writeSubframe(bw, r, bps, f.sub[1]); break;
+    case 10: ok = writeSubframe(bw, mid, bps, f.sub[0]) && writeSubframe(bw, side, bps + 1, f.sub[1]); break;
+    default: ok = false; break;
+  }
+  if (!ok) return false;
+  bw.align();
+  bw.put(crc16(bw.bytes.data() + start, bw.bytes.size() - start), 16);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Decode with the library and compare
+
+static void runStream(const StreamSpec& s) {
+  BitWriter bw;
+  std::vector<int16_t> expected;
+  for (size_t f = 0; f < s.frames.size(); f++) {
+    const FrameSpec& frame = s.frames[f];
+    if ((frame.chanAsgn == 0) != (s.channels == 1) || !writeFrame(bw, frame, s.bps, (int)f)) {
+      char msg[64];
+      snprintf(msg, sizeof(msg), "frame %d cannot be encoded as specified", (int)f);
+      fail(s.name, msg);
+      return;
+    }
+    for (size_t i = 0; i < frame.left.size(); i++) {
+      expected.push_back((int16_t)(frame.left[i] + (s.bps == 8 ? 128 : 0)));
+      if (s.channels == 2) expected.push_back((int16_t)(frame.right[i] + (s.bps == 8 ? 128 : 0)));
+    }
+  }
+
+  // The decoder wants a full block of input behind every frame header, as the player keeps its buffer filled
+  size_t streamBytes = bw.bytes.size();
+  std::vector<uint8_t> input(bw.bytes);
+  input.resize(streamBytes + MAX_BLOCKSIZE + 64, 0);
+
+  static int16_t out[MAX_OUTBUFFSIZE * 2];
+  std::vector<int16_t> decoded;
+  if (!FLACDecoder_AllocateBuffers()) {
+    fail(s.name, "buffer allocation failed");
+    return;
+  }
+  FLACSetRawBlockParams(s.channels, 44100, s.bps, 0, streamBytes);
+
+  uint8_t* p = input.data();
+  int32_t left = (int32_t)input.size();
+  while ((size_t)(p - input.data()) < streamBytes) {
+    int32_t before = left;
+    int8_t ret = FLACDecode(p, &left, out);
+    if (ret < 0) {
+      char msg[64];
+      snprintf(msg, sizeof(msg), "decoder error %d at byte %d", ret, (int)(p - input.data()));
+      fail(s.name, msg);
+      FLACDecoder_FreeBuffers();
+      return;
+    }
+    if (ret == ERR_FLAC_NONE || ret == GIVE_NEXT_LOOP) {
+      int n = FLACGetOutputSamps() / s.channels;
+      for (int i = 0; i < n; i++) {
+        for (int ch = 0; ch < s.channels; ch++) decoded.push_back(out[2 * i + ch]);
+      }
+    }
+    if (before == left && ret != GIVE_NEXT_LOOP) {
+      fail(s.name, "decoder stalled");
+      FLACDecoder_FreeBuffers();
+      return;
+    }
+    p += before - left;
+  }
+  FLACDecoder_FreeBuffers();
+
+  if (decoded.size() != expected.size()) {
+    char msg[80];
+    snprintf(msg, sizeof(msg), "%d samples decoded, %d expected", (int)decoded.size(), (int)expected.size());
+    fail(s.name, msg);
+    return;
+  }
+  for (size_t i = 0; i < expected.size(); i++) {
+    if (decoded[i] != expected[i]) {
+      char msg[96];
+      snprintf(msg, sizeof(msg), "sample %d channel %d: got %d, want %d", (int)(i / s.channels),
+               (int)(i % s.channels), decoded[i], expected[i]);
+      fail(s.name, msg);
+      return;
+    }
+  }
+  printf("ok   %s (%d frames, %d samples)\n", s.name, (int)s.frames.size(), (int)(expected.size() / s.channels));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test signals
+
+static uint32_t s_seed = 12345;
+
+static int32_t noise(int32_t amplitude) {
+  s_seed ^= s_seed << 13;
+  s_seed ^= s_seed >> 17;
+  s_seed ^= s_seed << 5;
+  return amplitude ? (int32_t)(s_seed % (2 * (uint32_t)amplitude + 1)) - amplitude : 0;
+}
+
+// Two tones plus noise, clipped to the sample depth, low 'wasted' bits cleared
+static std::vector<int32_t> tone(int n, int bps, double amplitude, double freq, int32_t noiseAmp = 8,
+                                 int wasted = 0) {
+  std::vector<int32_t> x(n);
+  int32_t hi = (1 << (bps - 1)) - 1, lo = -(1 << (bps - 1));
+  for (int i = 0; i < n; i++) {
+    double t = i / 44100.0;
+    double v = amplitude * (0.8 * sin(2 * M_PI * freq * t) + 0.2 * sin(2 * M_PI * freq * 6.3 * t + 1.0));
+    int32_t s = (int32_t)lrint(v) + noise(noiseAmp);
+    s = s > hi ? hi : s < lo ? lo : s;
+    x[i] = (int32_t)((uint32_t)s & ~((1u << wasted) - 1));
+  }
+  return x;
+}
+
+static SubframeSpec sub(SubframeType type, int order, int wasted = 0) {
+  SubframeSpec s;
+  s.type = type;
+  s.order = order;
+  s.wasted = wasted;
+  return s;
+}
+
+static FrameSpec mono(const std::vector<int32_t>& x, const SubframeSpec& s) {
+  FrameSpec f;
+  f.chanAsgn = 0;
+  f.left = x;
+  f.sub[0] = s;
+  return f;
+}
+
+static FrameSpec stereo(int chanAsgn, const std::vector<int32_t>& l, const std::vector<int32_t>& r,
+                        const SubframeSpec& s0, const SubframeSpec& s1) {
+  FrameSpec f;
+  f.chanAsgn = chanAsgn;
+  f.left = l;
+  f.right = r;
+  f.sub[0] = s0;
+  f.sub[1] = s1;
+  return f;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static StreamSpec subframeTypes() {
+  StreamSpec s = {"subframe types", 1, 16, {}};
+  s.frames.push_back(mono(std::vector<int32_t>(4096, -1234), sub(SUB_CONSTANT, 0)));
+  s.frames.push_back(mono(std::vector<int32_t>(4096, 0), sub(SUB_CONSTANT, 0)));
+  s.frames.push_back(mono(tone(4096, 16, 0, 0, 32767), sub(SUB_VERBATIM, 0)));
+  for (int order = 0; order <= 4; order++) {
+    s.frames.push_back(mono(tone(4096, 16, 12000, 440 + 50 * order), sub(SUB_FIXED, order)));
+  }
+  static const int lpcOrders[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 16, 20, 31, 32};
+  for (int i = 0; i < (int)(sizeof(lpcOrders) / sizeof(lpcOrders[0])); i++) {
+    SubframeSpec lpc = sub(SUB_LPC, lpcOrders[i]);
+    lpc.precision = 12 + i % 4;
+    lpc.partitionOrder = i % 5;
+    s.frames.push_back(mono(tone(4096, 16, 20000, 300 + 37 * i, 40), lpc));
+  }
+  return s;
+}
+
+static StreamSpec residualCoding() {
+  StreamSpec s = {"residual coding", 1, 16, {}};
+  for (int method = 0; method <= 1; method++) {
+    for (int po = 0; po <= 6; po++) {
+      SubframeSpec lpc = sub(SUB_LPC, 8);
+      lpc.method = method;
+      lpc.partitionOrder = po;
+      s.frames.push_back(mono(tone(4608, 16, 16000, 500, 200), lpc));
+    }
+    SubframeSpec esc = sub(SUB_LPC, 8);             // escaped and Rice partitions mixed
+    esc.method = method;
+    esc.partitionOrder = 3;
+    esc.escapeMask = 0xA5;
+    s.frames.push_back(mono(tone(4608, 16, 16000, 700, 300), esc));
+
+    SubframeSpec silent = sub(SUB_FIXED, 2);        // a ramp leaves no residual: 0 bit escapes
+    silent.method = method;
+    silent.partitionOrder = 2;
+    silent.escapeMask = 0xF;
+    std::vector<int32_t> ramp(4608);
+    for (int i = 0; i < 4608; i++) ramp[i] = i * 7 - 16000;
+    s.frames.push_back(mono(ramp, silent));
+
+    SubframeSpec zero = silent;                     // and Rice parameter 0
+    zero.escapeMask = 0;
+    zero.param = 0;
+    s.frames.push_back(mono(ramp, zero));
+
+    SubframeSpec maxParam = sub(SUB_FIXED, 1);      // largest parameter of each method
+    maxParam.method = method;
+    maxParam.param = method == 0 ? 14 : 30;
+    s.frames.push_back(mono(tone(4608, 16, 30000, 900, 2000), maxParam));
+
+    SubframeSpec longUnary = sub(SUB_FIXED, 0);     // parameter far too small: long unary runs
+    longUnary.method = method;
+    longUnary.param = 2;
+    s.frames.push_back(mono(tone(576, 16, 0, 0, 600), longUnary));
+  }
+  return s;
+}
+
+static StreamSpec stereoModes() {
+  StreamSpec s = {"stereo modes", 2, 16, {}};
+  static const int modes[] = {1, 8, 9, 10};
+  for (int m = 0; m < 4; m++) {
+    std::vector<int32_t> l = tone(4096, 16, 20000, 440, 500);
+    std::vector<int32_t> r = tone(4096, 16, 14000, 660, 500);
+    s.frames.push_back(stereo(modes[m], l, r, sub(SUB_FIXED, 2), sub(SUB_LPC, 8)));
+    s.frames.push_back(stereo(modes[m], l, r, sub(SUB_LPC, 12), sub(SUB_FIXED, 3)));
+    std::vector<int32_t> full = tone(1152, 16, 0, 0, 32767);       // extreme side values, odd mid sums
+    std::vector<int32_t> inverted(full);
+    for (int32_t& v : inverted) v = -1 - v;
+    s.frames.push_back(stereo(modes[m], full, inverted, sub(SUB_VERBATIM, 0), sub(SUB_VERBATIM, 0)));
+    s.frames.push_back(stereo(modes[m], std::vector<int32_t>(192, 32767), std::vector<int32_t>(192, -32768),
+                              sub(SUB_CONSTANT, 0), sub(SUB_CONSTANT, 0)));
+  }
+  return s;
+}
+
+static StreamSpec blockSizes() {
+  StreamSpec s = {"block sizes", 2, 16, {}};
+  static const int sizes[] = {192, 576, 1152, 2304, 4608, 256, 512, 1024, 2048, 4096, 8192, 2049, 16, 1, 255, 257,
+                              3001, 8191};
+  for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+    int n = sizes[i];
+    SubframeSpec a = n >= 32 ? sub(SUB_LPC, 8) : sub(SUB_VERBATIM, 0);
+    SubframeSpec b = n >= 32 ? sub(SUB_FIXED, 2) : sub(SUB_VERBATIM, 0);
+    s.frames.push_back(stereo(i % 2 ? 10 : 8, tone(n, 16, 18000, 523), tone(n, 16, 9000, 784), a, b));
+  }
+  return s;
+}
+
+static StreamSpec wastedBits() {
+  StreamSpec s = {"wasted bits", 1, 16, {}};
+  for (int k = 1; k <= 15; k++) {
+    SubframeType type = k % 3 == 0 ? SUB_VERBATIM : k % 3 == 1 ? SUB_FIXED : SUB_LPC;
+    int order = type == SUB_FIXED ? 1 + k % 4 : type == SUB_LPC ? 4 : 0;
+    s.frames.push_back(mono(tone(2048, 16, 25000, 330, 64 << k, k), sub(type, order, k)));
+  }
+  s.frames.push_back(mono(std::vector<int32_t>(2048, -32768), sub(SUB_CONSTANT, 0, 15)));
+  s.frames.push_back(mono(std::vector<int32_t>(2048, 0x4000), sub(SUB_CONSTANT, 0, 14)));
+  return s;
+}
+
+static StreamSpec wastedBitsStereo() {
+  StreamSpec s = {"wasted bits stereo", 2, 16, {}};
+  for (int k = 1; k <= 12; k++) {
+    std::vector<int32_t> l = tone(2048, 16, 24000, 440, 32 << k, k);
+    std::vector<int32_t> r = tone(2048, 16, 12000, 220, 32 << k, k);
+    int mode = k % 4 == 0 ? 1 : k % 4 == 1 ? 8 : k % 4 == 2 ? 9 : 10;
+    int midWasted = mode == 10 ? k - 1 : k;     // (l + r) >> 1 keeps one bit less
+    SubframeSpec s0 = sub(SUB_LPC, 6, mode == 9 ? k : midWasted);
+    SubframeSpec s1 = sub(SUB_FIXED, 2, k);
+    s.frames.push_back(stereo(mode, l, r, s0, s1));
+  }
+  std::vector<int32_t> sq(1152), zero(1152, 0);    // side of -32768 / 0: 15 wasted bits on a 17 bit channel
+  for (int i = 0; i < 1152; i++) sq[i] = (i / 64) % 2 ? -32768 : 0;
+  s.frames.push_back(stereo(8, sq, zero, sub(SUB_FIXED, 1, 15), sub(SUB_FIXED, 1, 15)));
+  return s;
+}
+
+// Residuals at the limits of the 32 bit and 31 bit codes: the 17 bit side channel is predicted with coefficients of
+// the opposite sign, so each residual is about as large as the prediction itself. Their upper bits never reach the
+// 16 bit output, what these frames catch is a bit reader that loses its place on the longest codes.
+static StreamSpec largeResiduals() {
+  StreamSpec s = {"32 bit residuals", 2, 16, {}};
+  const int n = 1152;
+  std::vector<int32_t> l(n), r(n);
+  for (int i = 0; i < n; i++) {
+    bool up = (i / 37) % 2 == 0;          // side +65535 / -65535 in runs
+    l[i] = up ? 32767 : -32768;
+    r[i] = up ? -32768 : 32767;
+  }
+
+  // Side * (-16384 - 16383): residuals up to +-2147450880, zigzag codes above 2^32 - 2^17
+  for (int param = 28; param <= 30; param++) {
+    SubframeSpec side = sub(SUB_LPC, 2);
+    side.precision = 15;
+    side.coefs = {-16384, -16383};
+    side.shift = 0;
+    side.method = 1;
+    side.param = param;
+    side.partitionOrder = param - 28;
+    s.frames.push_back(stereo(8, l, r, sub(SUB_FIXED, 1), side));
+  }
+
+  // Side * -16383: residuals up to +-1073725440, escaped with the full 31 bits
+  SubframeSpec esc = sub(SUB_LPC, 1);
+  esc.precision = 15;
+  esc.coefs = {-16383};
+  esc.shift = 0;
+  esc.method = 1;
+  esc.partitionOrder = 1;
+  esc.escapeMask = 0x3;
+  esc.escapeBits = 31;
+  s.frames.push_back(stereo(9, l, r, esc, sub(SUB_FIXED, 1)));
+  esc.method = 0;
+  esc.escapeBits = -1;
+  s.frames.push_back(stereo(10, l, r, sub(SUB_FIXED, 2), esc));
+  return s;
+}
+
+static StreamSpec sampleDepth(int bps) {
+  StreamSpec s = {bps == 8 ? "8 bit samples" : "12 bit samples", 2, bps, {}};
+  double amplitude = 0.6 * (1 << (bps - 1));
+  std::vector<int32_t> l = tone(4096, bps, amplitude, 440, 2);
+  std::vector<int32_t> r = tone(4096, bps, amplitude, 550, 2);
+  s.frames.push_back(stereo(1, l, r, sub(SUB_LPC, 8), sub(SUB_FIXED, 2)));
+  s.frames.push_back(stereo(10, l, r, sub(SUB_FIXED, 3), sub(SUB_LPC, 4)));
+  s.frames.push_back(stereo(8, l, r, sub(SUB_VERBATIM, 0), sub(SUB_VERBATIM, 0)));
+  s.frames.push_back(stereo(9, std::vector<int32_t>(576, (1 << (bps - 1)) - 1), std::vector<int32_t>(576, -(1 << (bps - 1))),
+                            sub(SUB_CONSTANT, 0), sub(SUB_CONSTANT, 0)));
+  return s;
+}
+
+int main() {
+  runStream(subframeTypes());
+  runStream(residualCoding());
+  runStream(stereoModes());
+  runStream(blockSizes());
+  runStream(wastedBits());
+  runStream(wastedBitsStereo());
+  runStream(largeResiduals());
+  runStream(sampleDepth(8));
+  runStream(sampleDepth(12));
+  printf(s_failed ? "FLAC decoder test FAILED\n" : "FLAC decoder test passed\n");
+  return s_failed ? 1 : 0;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino core for the host tests, only what the tested decoders use
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <assert.h>
+
+typedef bool boolean;
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define __unused __attribute__((unused))
+
+#define _min(a, b) ((a) < (b) ? (a) : (b))
+#define _max(a, b) ((a) > (b) ? (a) : (b))
+
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT  (1 << 12)
+
+bool psramFound();
+void* ps_malloc(size_t size);
+void* ps_calloc(size_t count, size_t size);
+unsigned long millis();
+unsigned long micros();
+uint32_t esp_random();
+
+#define log_e(...) do {} while (0)
+#define log_w(...) do {} while (0)
+#define log_i(...) do {} while (0)
+#define log_d(...) do {} while (0)
+#define log_v(...) do {} while (0)
@@ -0,0 +1,10 @@
+/**
+ * @file esp_cpu.h
+ * @brief Host stand-in, the cycle count is the TSC on x86 and nanoseconds elsewhere
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+uint32_t esp_cpu_get_cycle_count();
@@ -0,0 +1,50 @@
+/**
+ * @file host_stubs.cpp
+ * @brief Host replacements for the ESP32 core functions and AudioMemory, every allocation goes to malloc()
+ */
+
+#include <time.h>
+#include <malloc.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "Arduino.h"
+#include "AudioMemory.h"
+#include "esp_cpu.h"
+
+bool psramFound() { return false; }
+void* ps_malloc(size_t size) { return malloc(size); }
+void* ps_calloc(size_t count, size_t size) { return calloc(count, size); }
+
+unsigned long micros() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+unsigned long millis() { return micros() / 1000; }
+
+// TSC ticks on x86, like the cycle counts of decoder_benchmark, nanoseconds elsewhere
+uint32_t esp_cpu_get_cycle_count() {
+#if defined(__x86_64__) || defined(__i386__)
+  return (uint32_t)__rdtsc();
+#else
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+#endif
+}
+
+uint32_t esp_random() { return (uint32_t)rand(); }
+
+bool AudioMemory::begin(size_t, size_t) { return true; }
+void AudioMemory::setStrict(bool) {}
+void* AudioMemory::alloc(size_t size, AudioMemRegion) { return size ? malloc(size) : nullptr; }
+void* AudioMemory::calloc(size_t count, size_t size, AudioMemRegion) { return ::calloc(count, size); }
+void AudioMemory::release(void* ptr) { free(ptr); }
+bool AudioMemory::owns(const void*) { return false; }
+bool AudioMemory::inPSRAM(const void*) { return false; }
+size_t AudioMemory::sizeOf(const void* ptr) { return ptr ? malloc_usable_size((void*)ptr) : 0; }  // As heap_caps_get_allocated_size()
+AudioMemStats AudioMemory::getStats(bool) { return AudioMemStats(); }
+uint32_t AudioMemory::heapFallbacks() { return 0; }
+void AudioMemory::printReport() {}
@@ -0,0 +1,226 @@
+/**
+ * @file opus_encoder_test.cpp
+ * @brief Host test for src/opus_encoder, round trip through the in-tree Opus decoder
+ *
+ * A synthetic speech-like signal is encoded at several bitrates, the Ogg
+ * stream is checked page by page (capture pattern, sequence numbers, CRC,
+ * granule positions) and decoded with src/opus_decoder. The encoder codes
+ * every frame unvoiced, so the check is on what it promises: the bitrate
+ * follows the target, the level is kept and the decoded waveform still
+ * correlates with the input.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include "opus_encoder/opus_encoder.h"
+#include "opus_decoder/opus_decoder.h"
+
+static bool s_failed = false;
+
+static void check(bool ok, const char* name, const char* what, double value) {
+  if (!ok) {
+    printf("FAIL %s: %s (%.3f)\n", name, what, value);
+    s_failed = true;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test signal: glottal pulses through two formant resonators, then a noise burst, then near silence, once a second
+
+static std::vector<int16_t> speech(int n) {
+  std::vector<int16_t> x(n);
+  double phase = 0, s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+  uint32_t seed = 1;
+  const double f1 = 700, f2 = 1800;
+  const double a1 = 2 * 0.97 * cos(2 * M_PI * f1 / 16000), a2 = -0.97 * 0.97;
+  const double b1 = 2 * 0.95 * cos(2 * M_PI * f2 / 16000), b2 = -0.95 * 0.95;
+  for (int i = 0; i < n; i++) {
+    double t = i / 16000.0, seg = fmod(t, 1.0), e = 0;
+    seed = seed * 1664525 + 1013904223;
+    double rnd = (seed >> 8) / 16777216.0 - 0.5;
+    if (seg < 0.5) {
+      phase += (120 + 40 * sin(2 * M_PI * t)) / 16000;
+      if (phase >= 1) {
+        phase -= 1;
+        e = 20000;
+      }
+    } else if (seg < 0.7) {
+      e = rnd * 2000;
+    }
+    double y1 = e + a1 * s1 + a2 * s2;
+    s2 = s1;
+    s1 = y1;
+    double y2 = y1 * 0.1 + b1 * s3 + b2 * s4;
+    s4 = s3;
+    s3 = y2;
+    double v = seg < 0.85 ? y2 * 0.5 + y1 * 0.05 : rnd * 20;
+    x[i] = (int16_t)(v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+  }
+  return x;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Ogg page checks (RFC 3533)
+
+static uint32_t oggCrc(const uint8_t* p, size_t n) {
+  uint32_t crc = 0;
+  while (n--) {
+    crc ^= (uint32_t)(*p++) << 24;
+    for (int i = 0; i < 8; i++) crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+  }
+  return crc;
+}
+
+// Walk the pages, returns the number of audio packets or -1
+static int checkOggPages(const char* name, std::vector<uint8_t> ogg, uint64_t expectedGranule) {
+  size_t pos = 0;
+  uint32_t sequence = 0;
+  uint64_t granule = 0;
+  int packets = 0;
+  while (pos < ogg.size()) {
+    uint8_t* page = ogg.data() + pos;
+    if (ogg.size() - pos < 27 || memcmp(page, "OggS", 4) != 0) {
+      check(false, name, "Ogg capture pattern missing at byte", pos);
+      return -1;
+    }
+    uint32_t seq = page[18] | (page[19] << 8) | (page[20] << 16) | ((uint32_t)page[21] << 24);
+    uint32_t crc = page[22] | (page[23] << 8) | (page[24] << 16) | ((uint32_t)page[25] << 24);
+    uint8_t nSegments = page[26];
+    size_t size = 27 + nSegments;
+    int pagePackets = 0;
+    for (int i = 0; i < nSegments; i++) {
+      size += page[27 + i];
+      if (page[27 + i] < 255) pagePackets++;
+    }
+    if (pos + size > ogg.size()) {
+      check(false, name, "truncated Ogg page at byte", pos);
+      return -1;
+    }
+    memset(page + 22, 0, 4);
+    check(oggCrc(page, size) == crc, name, "Ogg CRC mismatch in page", seq);
+    check(seq == sequence++, name, "Ogg page out of sequence", seq);
+    if (seq >= 2) {                             // pages 0 and 1 hold OpusHead and OpusTags
+      granule = 0;
+      for (int i = 0; i < 8; i++) granule |= (uint64_t)page[6 + i] << (8 * i);
+      packets += pagePackets;
+    }
+    pos += size;
+  }
+  check(granule == expectedGranule, name, "last granule position", (double)granule);
+  return packets;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static void roundTrip(uint32_t bitrate) {
+  char name[32];
+  snprintf(name, sizeof(name), "%u bit/s", (unsigned)bitrate);
+  const int seconds = 4;
+  const int n = OPUS_ENC_SAMPLE_RATE * seconds;
+  const int frames = n / OPUS_ENC_FRAME_SAMPLES;
+  bool failedBefore = s_failed;
+  s_failed = false;
+  std::vector<int16_t> x = speech(n);
+
+  // Encode, one page per 5 packets as StreamEncoder batches them
+  OPUSEncoder_t* enc = OPUSEncoder_CreateContext(bitrate);
+  std::vector<uint8_t> ogg(OPUS_ENC_HEADERS_SIZE);
+  int32_t len = OPUSWriteOggHeaders(enc, ogg.data(), ogg.size());
+  check(len > 0, name, "OPUSWriteOggHeaders", len);
+  ogg.resize(len > 0 ? len : 0);
+  uint8_t packets[5 * OPUS_ENC_MAX_PACKET];
+  uint16_t packetLen[5];
+  int nPackets = 0, packetPos = 0;
+  long packetBytes = 0;
+  for (int f = 0; f < frames; f++) {
+    int32_t r = OPUSEncode(enc, &x[f * OPUS_ENC_FRAME_SAMPLES], packets + packetPos, OPUS_ENC_MAX_PACKET);
+    if (r <= 0) {
+      check(false, name, "OPUSEncode failed in frame", f);
+      OPUSEncoder_DestroyContext(enc);
+      return;
+    }
+    packetLen[nPackets++] = r;
+    packetPos += r;
+    packetBytes += r;
+    if (nPackets == 5 || f == frames - 1) {
+      uint8_t page[27 + 5 + sizeof(packets)];
+      r = OPUSWriteOggPage(enc, packets, packetLen, nPackets, f == frames - 1, page, sizeof(page));
+      check(r > 0, name, "OPUSWriteOggPage", r);
+      if (r > 0) ogg.insert(ogg.end(), page, page + r);
+      nPackets = packetPos = 0;
+    }
+  }
+  check(OPUSEncoderGetFrames(enc) == (uint32_t)frames, name, "frames counted", OPUSEncoderGetFrames(enc));
+  OPUSEncoder_DestroyContext(enc);
+
+  double kbps = packetBytes * 8.0 / seconds / 1000;
+  check(fabs(kbps * 1000 - bitrate) < 0.15 * bitrate, name, "bitrate off target, kbit/s", kbps);
+  check(checkOggPages(name, ogg, (uint64_t)frames * 960) == frames, name, "audio packets in the Ogg stream", frames);
+
+  // Decode, the decoder runs at 48 kHz: keep every third sample
+  std::vector<uint8_t> in(ogg);
+  std::vector<double> y;
+  static int16_t pcm[5760 * 2];
+  OPUSDecoder_AllocateBuffers();
+  uint8_t* p = in.data();
+  int32_t left = (int32_t)in.size();
+  int32_t sync = OPUSFindSyncWord(p, left);
+  p += sync;
+  left -= sync;
+  int phase = 0;
+  while (left > 0) {
+    int32_t before = left;
+    int32_t ret = OPUSDecode(p, &left, pcm);
+    if (ret < 0) {
+      check(false, name, "OPUSDecode error at byte", p - in.data());
+      break;
+    }
+    if (ret == ERR_OPUS_NONE || ret == OPUS_CONTINUE) {
+      for (int i = 0; i < OPUSGetOutputSamps(); i++, phase = (phase + 1) % 3) {
+        if (phase == 0) y.push_back(pcm[2 * i]);
+      }
+    }
+    if (before == left) break;
+    p += before - left;
+  }
+  OPUSDecoder_FreeBuffers();
+  check((int)y.size() >= n - 2 * OPUS_ENC_FRAME_SAMPLES, name, "decoded samples", y.size());
+
+  // Best aligned correlation and SNR, the decoder delay is not known up front
+  double bestCorr = -1, bestSnr = 0, ex = 0, ey = 0;
+  for (int d = -400; d < 400; d++) {
+    double xy = 0, xx = 0, yy = 0, ee = 0;
+    for (int i = 0; i < n; i++) {
+      int j = i + d;
+      if (j < 0 || j >= (int)y.size()) continue;
+      xy += x[i] * y[j];
+      xx += (double)x[i] * x[i];
+      yy += y[j] * y[j];
+      ee += (x[i] - y[j]) * (x[i] - y[j]);
+    }
+    double corr = xy / sqrt(xx * yy + 1);
+    if (corr > bestCorr) {
+      bestCorr = corr;
+      bestSnr = 10 * log10(xx / (ee + 1));
+    }
+  }
+  for (int i = 0; i < n; i++) ex += (double)x[i] * x[i];
+  for (double v : y) ey += v * v;
+  double levelDb = 10 * log10((ey / y.size()) / (ex / n));
+
+  check(bestCorr > 0.9, name, "correlation", bestCorr);
+  check(bestSnr > 8, name, "SNR dB", bestSnr);
+  check(fabs(levelDb) < 1.5, name, "level change dB", levelDb);
+  printf("%s %s: %.1f kbit/s, correlation %.3f, SNR %.1f dB, level %+.2f dB\n", s_failed ? "    " : "ok  ", name,
+         kbps, bestCorr, bestSnr, levelDb);
+  s_failed = s_failed || failedBefore;
+}
+
+int main() {
+  roundTrip(16000);
+  roundTrip(24000);
+  roundTrip(32000);
+  printf(s_failed ? "Opus encoder test FAILED\n" : "Opus encoder test passed\n");
+  return s_failed ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file vorbis_decoder_test.cpp
+ * @brief Host regression test for src/vorbis_decoder, built once as is and once with -DVORBIS_LOW_MEMORY
+ *
+ * data/vorbis_books.ogg (written by data/vorbis_books.py) carries one
+ * codebook of every kind the decoder unpacks, dec_type 2 and 3 included,
+ * and uses floor0 and floor1 and all three residue types. Its PCM CRC32 is
+ * fixed below: both builds must reproduce it, so the lazy codebook tables of
+ * the lean setup decode exactly what the tables built at stream start do.
+ * The stream is decoded twice to cover the tables of a second stream.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "vorbis_decoder/vorbis_decoder.h"
+
+#ifdef VORBIS_LOW_MEMORY
+static const char* BUILD_NAME = "lazy codebooks";
+#else
+static const char* BUILD_NAME = "codebooks at stream start";
+#endif
+
+static const uint32_t EXPECTED_CRC = 0xaabbde43;   // PCM CRC32 of data/vorbis_books.ogg, same for both builds
+static const uint32_t EXPECTED_PACKETS = 62;       // Audio packets with output, the first one only primes the overlap
+static const uint64_t EXPECTED_FRAMES = 38848;     // Output frames per channel
+
+static const int MAX_STALLED_CALLS = 8;  // Decode calls in a row that consume nothing before giving up
+static const size_t INPUT_GUARD = 64;     // Zeros after the file: the bit reader looks past the last packet
+
+static bool s_failed = false;
+static int16_t s_pcm[4096 * 2];
+
+// Same polynomial and conditioning as esp_rom_crc32_le(), the value decoder_benchmark prints
+static uint32_t crc32le(uint32_t crc, const uint8_t* p, size_t n) {
+  crc = ~crc;
+  while (n--) {
+    crc ^= *p++;
+    for (int i = 0; i < 8; i++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+  }
+  return ~crc;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& data) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return false;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data.resize(size > 0 ? size : 0);
+  bool ok = fread(data.data(), 1, data.size(), f) == data.size();
+  fclose(f);
+  return ok;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Decode the whole stream from memory, same feeding pattern as Audio::sendBytes()
+
+struct StreamResult {
+  uint32_t packets = 0;
+  uint64_t frames = 0;
+  uint32_t errors = 0;
+  uint32_t crc = 0;
+  uint32_t rate = 0;             // Taken while decoding: the decoder resets it at the last page
+  uint8_t channels = 0;
+};
+
+static StreamResult decodeStream(std::vector<uint8_t> data, int32_t size) {
+  StreamResult r;
+  uint8_t* p = data.data();
+  int32_t left = size;
+  bool synced = false;
+  int stalls = 0;
+  while (left > 0) {
+    if (!synced) {
+      int32_t sync = VORBISFindSyncWord(p, left);
+      if (sync < 0) break;
+      p += sync;
+      left -= sync;
+      synced = true;
+    }
+    int32_t before = left;
+    int32_t ret = VORBISDecode(p, &left, s_pcm);
+    if (ret < 0) {
+      r.errors++;
+      synced = false;
+      p++;
+      left--;
+      continue;
+    }
+    bool more = ret == VORBIS_CONTINUE;
+    if (ret == ERR_VORBIS_NONE || more) {
+      uint32_t n = VORBISGetOutputSamps();
+      if (n > 0) {
+        r.packets++;
+        r.frames += n;
+        r.rate = VORBISGetSampRate();
+        r.channels = VORBISGetChannels();
+        r.crc = crc32le(r.crc, (const uint8_t*)s_pcm, n * r.channels * sizeof(int16_t));
+      }
+    }
+    if (before == left && !more) {  // VORBIS_PARSE_OGG_DONE between headers, or a truncated end
+      if (++stalls > MAX_STALLED_CALLS) break;
+    } else {
+      stalls = 0;
+    }
+    p += before - left;
+  }
+  return r;
+}
+
+static void testStream(const char* path, const std::vector<uint8_t>& data, int32_t size, int pass) {
+  if (!VORBISDecoder_AllocateBuffers()) {
+    printf("FAIL %s pass %d: decoder could not be initialized\n", path, pass);
+    s_failed = true;
+    return;
+  }
+  StreamResult r = decodeStream(data, size);
+  uint32_t peakMemory = VORBISGetPeakMemory();
+  VORBISDecoder_FreeBuffers();
+
+  char msg[160] = "";
+  if (r.errors) snprintf(msg, sizeof(msg), "%u decoder errors", (unsigned)r.errors);
+  else if (r.rate != 44100 || r.channels != 2) snprintf(msg, sizeof(msg), "format %u Hz, %u ch", (unsigned)r.rate, r.channels);
+  else if (r.packets != EXPECTED_PACKETS || r.frames != EXPECTED_FRAMES)
+    snprintf(msg, sizeof(msg), "%u packets, %llu frames, want %u, %llu", (unsigned)r.packets,
+             (unsigned long long)r.frames, (unsigned)EXPECTED_PACKETS, (unsigned long long)EXPECTED_FRAMES);
+  else if (r.crc != EXPECTED_CRC) snprintf(msg, sizeof(msg), "PCM CRC32 %08x, want %08x", (unsigned)r.crc, (unsigned)EXPECTED_CRC);
+  if (msg[0]) {
+    printf("FAIL %s pass %d (%s): %s\n", path, pass, BUILD_NAME, msg);
+    s_failed = true;
+    return;
+  }
+  printf("ok   %s pass %d (%s): %u packets, CRC32 %08x, peak memory %u bytes\n", path, pass, BUILD_NAME,
+         (unsigned)r.packets, (unsigned)r.crc, (unsigned)peakMemory);
+}
+
+int main(int argc, char** argv) {
+  const char* path = argc > 1 ? argv[1] : "data/vorbis_books.ogg";  // make test runs from extras/test
+  std::vector<uint8_t> data;
+  if (!readFile(path, data) || data.empty()) {
+    printf("FAIL %s: cannot be read\n", path);
+    printf("Vorbis decoder test FAILED\n");
+    return 1;
+  }
+  const int32_t size = (int32_t)data.size();
+  data.resize(size + INPUT_GUARD);
+
+  for (int pass = 1; pass <= 2; pass++) testStream(path, data, size, pass);
+
+  printf(s_failed ? "Vorbis decoder test FAILED\n" : "Vorbis decoder test passed\n");
+  return s_failed ? 1 : 0;
+}
@@ -17,6 +17,18 @@ ArduinoASRChat::ArduinoASRChat(const char* apiKey, const char* cluster) {
 
   // Allocate audio send buffer (3200 bytes = 200ms of 16kHz 16bit mono audio)
   _sendBuffer = new int16_t[_sendBatchSize / 2];
+
+  // Responses are assembled in one reusable buffer, allocated on first use
+  _ws.setMessageLimit(WS_MAX_MESSAGE, AUDIO_MEM_PSRAM_PREFERRED);
+  _ws.onMessage(wsMessage, this);
+}
+
+/**
+ * @brief Destructor - Release the response decompression buffer
+ */
+ArduinoASRChat::~ArduinoASRChat() {
+  AudioMemory::release(_inflateBuffer);
+  _inflateBuffer = nullptr;
 }
 
 /**
@@ -53,6 +65,33 @@ void ArduinoASRChat::setAudioParams(int sampleRate, int bitsPerSample, int chann
   _channels = channels;
 }
 
+/**
+ * @brief Set uplink audio codec
+ * @param codec "raw" or "opus"
+ * @param bitrate Opus target bitrate in bit/s
+ * @return Whether the codec is supported and its encoder could be allocated
+ */
+bool ArduinoASRChat::setAudioCodec(const char* codec, uint32_t bitrate) {
+  StreamCodec streamCodec;
+  if (strcmp(codec, "raw") == 0) {
+    streamCodec = STREAM_CODEC_PCM;
+  } else if (strcmp(codec, "opus") == 0) {
+    streamCodec = STREAM_CODEC_OPUS;
+  } else {
+    Serial.printf("Unsupported audio codec: %s (use raw or opus)\n", codec);
+    return false;
+  }
+
+  if (_isRecording) {
+    Serial.println("Cannot change audio codec while recording");
+    return false;
+  }
+  if (streamCodec == STREAM_CODEC_OPUS && (_sampleRate != 16000 || _channels != 1)) {
+    Serial.println("Opus uplink needs 16kHz mono audio, keeping raw");
+  }
+  return _uplinkEncoder.begin(streamCodec, bitrate);
+}
+
 /**
  * @brief Set silence detection duration
  * @param duration Silence duration in milliseconds, recording stops automatically after this time
@@ -135,13 +174,7 @@ bool ArduinoASRChat::initM5CoreS3Microphone() {
 
   // Allocate microphone buffer if not already allocated
   if (_m5MicBuffer == nullptr) {
-    if (psramFound()) {
-      _m5MicBuffer = (int16_t*)ps_malloc(_m5MicBufferSize * sizeof(int16_t));
-      Serial.println("Using PSRAM for M5CoreS3 mic buffer");
-    } else {
-      _m5MicBuffer = new int16_t[_m5MicBufferSize];
-      Serial.println("Using heap for M5CoreS3 mic buffer");
-    }
+    _m5MicBuffer = (int16_t*)AudioMemory::alloc(_m5MicBufferSize * sizeof(int16_t), AUDIO_MEM_PSRAM_PREFERRED);
   }
 
   if (_m5MicBuffer == nullptr) {
@@ -155,6 +188,271 @@ bool ArduinoASRChat::initM5CoreS3Microphone() {
   return true;
 }
 
+/**
+ * @brief Enable dedicated capture task
+ * @param enable true to capture from a pinned FreeRTOS task
+ * @param coreId Core the capture task is pinned to
+ * @details Task is created on the first startRecording() after enabling
+ */
+void ArduinoASRChat::setCaptureTask(bool enable, int coreId) {
+  _useCaptureTask = enable;
+  _captureCore = coreId;
+}
+
+/**
+ * @brief Allocate capture ring and create capture task
+ * @return true if capture task is running
+ */
+bool ArduinoASRChat::startCaptureTask() {
+  if (_captureTaskHandle != nullptr) {
+    return true;
+  }
+
+  // Allocate ring buffer (prefer PSRAM)
+  if (_captureRing.data() == nullptr) {
+    if (!_captureRing.begin(CAPTURE_RING_SAMPLES * sizeof(int16_t), AUDIO_MEM_PSRAM_PREFERRED)) {
+      Serial.println("Capture ring allocation failed!");
+      return false;
+    }
+  }
+
+  _captureRing.reset();
+  _captureOverruns.store(0);
+
+  // Runs above the loop task, on the core loop() does not use unless overridden
+  _captureTaskHandle = AudioTasks::create(AUDIO_TASK_CAPTURE, captureTaskWrapper, "ASRCapture", this, _captureCore);
+
+  if (_captureTaskHandle == nullptr) {
+    Serial.println("Capture task creation failed!");
+    return false;
+  }
+
+  Serial.printf("Capture task created on core %d\n",
+                _captureCore != AUDIO_CORE_DEFAULT ? _captureCore : AudioTasks::get(AUDIO_TASK_CAPTURE).core);
+  return true;
+}
+
+/**
+ * @brief Static wrapper for FreeRTOS task
+ * @param param Pointer to ArduinoASRChat instance
+ */
+void ArduinoASRChat::captureTaskWrapper(void* param) {
+  ArduinoASRChat* instance = static_cast<ArduinoASRChat*>(param);
+  instance->captureTaskLoop();
+}
+
+/**
+ * @brief Capture task main loop
+ * @details Reads one DMA block per call (blocks until I2S has it), so the task is paced by the microphone.
+ *          Keeps reading while idle so the DMA never holds stale audio when recording starts.
+ */
+void ArduinoASRChat::captureTaskLoop() {
+  int16_t block[CAPTURE_BLOCK_SAMPLES];  // Used while idle or when the ring is full
+
+  while (true) {
+    // Read straight into the ring when it has room for a block (span may be shorter at the wrap point)
+    size_t span = 0;
+    char* dst = (char*)block;
+    size_t want = sizeof(block);
+    if (_captureActive) {
+      if (_captureRing.space() >= sizeof(block)) {
+        dst = (char*)_captureRing.writeSpan(span);
+        want = min(span, sizeof(block));
+      } else {
+        _captureOverruns.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    size_t bytes = _I2S.readBytes(dst, want);
+    bytes &= ~(size_t)1;  // Whole samples only
+
+    if (bytes == 0) {
+      vTaskDelay(1);
+      continue;
+    }
+
+    if (span > 0 && _captureActive) {
+      _captureRing.commitWrite(bytes);
+    }
+  }
+}
+
+/**
+ * @brief Move captured samples from the ring into the send path
+ * @return Number of samples consumed
+ * @details Samples are batched into _sendBuffer, a chunk is sent each time _sendBatchSize fills
+ */
+size_t ArduinoASRChat::drainCaptureRing() {
+  size_t available = 0;
+  TurnMetrics::ringFill(_captureRing.available(), _captureRing.capacity());
+
+  // Consume in up to two contiguous spans across the wrap point
+  for (int part = 0; part < 2; part++) {
+    size_t len;
+    const uint8_t* span = _captureRing.readSpan(len);
+    if (len == 0) {
+      break;
+    }
+    queueSamples((const int16_t*)span, len / sizeof(int16_t));
+    _captureRing.commitRead(len);
+    available += len / sizeof(int16_t);
+  }
+
+  uint32_t overruns = _captureOverruns.exchange(0, std::memory_order_relaxed);
+  if (overruns > 0) {
+    TurnMetrics::overrun();
+    Serial.printf("\n[Warning] Capture ring overrun, %u blocks dropped\n", (unsigned)overruns);
+  }
+
+  return available;
+}
+
+/**
+ * @brief Enable on-device voice activity detection
+ * @param enable true to gate audio with the energy VAD
+ */
+void ArduinoASRChat::setVADEnabled(bool enable) {
+  _vadEnabled = enable;
+}
+
+/**
+ * @brief Set VAD parameters
+ * @param speechRatio Speech threshold relative to noise floor
+ * @param minRms Absolute RMS threshold
+ * @param hangoverMs Hangover time in milliseconds
+ */
+void ArduinoASRChat::setVADParams(float speechRatio, float minRms, unsigned long hangoverMs) {
+  _vad.setThresholds(speechRatio, minRms);
+  _vad.setTiming(60, hangoverMs);
+}
+
+/**
+ * @brief Allocate VAD frame and pre-roll buffers
+ * @return true if buffers are available
+ */
+bool ArduinoASRChat::allocateVADBuffers() {
+  _vad.begin(_sampleRate);
+  size_t frame = _vad.frameSamples();
+
+  if (_vadFrame != nullptr) {
+    return true;
+  }
+
+  _vadFrame = (int16_t*)AudioMemory::alloc(frame * sizeof(int16_t), AUDIO_MEM_INTERNAL_PREFERRED);
+  _vadPreroll = (int16_t*)AudioMemory::alloc(frame * VAD_PREROLL_FRAMES * sizeof(int16_t), AUDIO_MEM_PSRAM_PREFERRED);
+  if (_vadFrame == nullptr || _vadPreroll == nullptr) {
+    AudioMemory::release(_vadFrame);
+    AudioMemory::release(_vadPreroll);
+    _vadFrame = nullptr;
+    _vadPreroll = nullptr;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Send path entry point
+ * @param samples PCM samples
+ * @param count Number of samples
+ * @details Without VAD samples go straight to the batch buffer, with VAD they are framed and gated
+ */
+void ArduinoASRChat::queueSamples(const int16_t* samples, size_t count) {
+  if (!_vadEnabled) {
+    appendSendBuffer(samples, count);
+    return;
+  }
+
+  size_t frame = _vad.frameSamples();
+  while (count > 0) {
+    size_t n = frame - _vadFramePos;
+    if (n > count) n = count;
+    memcpy(_vadFrame + _vadFramePos, samples, n * sizeof(int16_t));
+    _vadFramePos += n;
+    samples += n;
+    count -= n;
+
+    if (_vadFramePos == frame) {
+      processVADFrame();
+      _vadFramePos = 0;
+    }
+  }
+}
+
+/**
+ * @brief Classify accumulated frame and gate it
+ * @details Non-speech frames go to the pre-roll ring, which is flushed ahead of the onset frame
+ *          so the start of the first word reaches the server
+ */
+void ArduinoASRChat::processVADFrame() {
+  size_t frame = _vad.frameSamples();
+  bool speech = _vad.processFrame(_vadFrame, frame);
+
+  if (_vad.speechStarted()) {
+    if (!_hasSpeech) {
+      _hasSpeech = true;
+      Serial.println("\nSpeech detected...");
+    }
+
+    // Flush pre-roll, oldest frame first
+    size_t slot = (_vadPrerollHead + VAD_PREROLL_FRAMES - _vadPrerollCount) % VAD_PREROLL_FRAMES;
+    for (size_t i = 0; i < _vadPrerollCount; i++) {
+      appendSendBuffer(_vadPreroll + slot * frame, frame);
+      slot = (slot + 1) % VAD_PREROLL_FRAMES;
+    }
+    _vadPrerollCount = 0;
+  }
+
+  if (speech) {
+    appendSendBuffer(_vadFrame, frame);
+  } else {
+    memcpy(_vadPreroll + _vadPrerollHead * frame, _vadFrame, frame * sizeof(int16_t));
+    _vadPrerollHead = (_vadPrerollHead + 1) % VAD_PREROLL_FRAMES;
+    if (_vadPrerollCount < VAD_PREROLL_FRAMES) _vadPrerollCount++;
+  }
+}
+
+/**
+ * @brief Batch samples and send full chunks
+ * @param samples PCM samples
+ * @param count Number of samples
+ */
+void ArduinoASRChat::appendSendBuffer(const int16_t* samples, size_t count) {
+  const size_t batch = _sendBatchSize / 2;
+  while (count > 0) {
+    size_t n = batch - _sendBufferPos;
+    if (n > count) n = count;
+    memcpy(_sendBuffer + _sendBufferPos, samples, n * sizeof(int16_t));
+    _sendBufferPos += n;
+    samples += n;
+    count -= n;
+
+    // Buffer full, send batch immediately
+    if (_sendBufferPos >= batch) {
+      sendAudioSamples(_sendBuffer, _sendBufferPos, false);
+      _sendBufferPos = 0;
+    }
+  }
+}
+
+/**
+ * @brief Send a batch of samples, Opus encoded if enabled
+ * @param samples PCM samples
+ * @param count Number of samples
+ * @param last Last batch of the utterance (Opus: pads the final frame and ends the Ogg stream)
+ */
+void ArduinoASRChat::sendAudioSamples(const int16_t* samples, size_t count, bool last) {
+  if (!useOpus()) {
+    if (count > 0) {
+      sendAudioChunk((uint8_t*)samples, count * 2);
+    }
+    return;
+  }
+  size_t len = _uplinkEncoder.encode(samples, count, last);
+  if (len > 0) {
+    sendAudioChunk((uint8_t*)_uplinkEncoder.data(), len);
+  }
+}
+
 /**
  * @brief Generate WebSocket handshake key
  * @return Base64 encoded random key string
@@ -176,9 +474,33 @@ String ArduinoASRChat::generateWebSocketKey() {
 /**
  * @brief Connect to ByteDance ASR WebSocket server
  * @return true if connection successful, false if failed
- * @details Performs WebSocket handshake protocol, establishes SSL encrypted connection
+ * @details Performs the handshake and records its duration in the session statistics
  */
 bool ArduinoASRChat::connectWebSocket() {
+  unsigned long start = millis();
+
+  if (!performHandshake()) {
+    _stats.failedHandshakes++;
+    return false;
+  }
+
+  _stats.handshakes++;
+  _stats.lastHandshakeMs = millis() - start;
+  _stats.totalHandshakeMs += _stats.lastHandshakeMs;
+  Serial.printf("Handshake took %lums\n", _stats.lastHandshakeMs);
+
+  _lastRxTime = millis();
+  _pingOutstanding = false;
+  _awaitingFinal = false;
+  _manualDisconnect = false;
+  return true;
+}
+
+/**
+ * @brief Establish SSL connection and perform WebSocket upgrade
+ * @return true if handshake succeeded
+ */
+bool ArduinoASRChat::performHandshake() {
   Serial.println("Connecting WebSocket...");
 
   // Skip SSL certificate verification (for testing, production should verify certificates)
@@ -189,6 +511,7 @@ bool ArduinoASRChat::connectWebSocket() {
     Serial.println("SSL connection failed");
     return false;
   }
+  TurnMetrics::mark(TURN_TLS_CONNECT);
 
   // Disable Nagle algorithm, ensure data is sent immediately (reduce latency)
   _client.setNoDelay(true);
@@ -231,8 +554,10 @@ bool ArduinoASRChat::connectWebSocket() {
   // Check if handshake succeeded (HTTP 101 Switching Protocols)
   if (response.indexOf("101") >= 0 && response.indexOf("Switching Protocols") >= 0) {
     Serial.println("WebSocket connected");
+    TurnMetrics::mark(TURN_WS_UPGRADE);
     _wsConnected = true;
     _endMarkerSent = false;  // Reset end marker flag
+    _ws.reset();             // Drop any frame left over from the previous connection
     return true;
   } else {
     Serial.println("WebSocket handshake failed");
@@ -246,6 +571,7 @@ bool ArduinoASRChat::connectWebSocket() {
  * @brief Disconnect WebSocket connection
  */
 void ArduinoASRChat::disconnectWebSocket() {
+  _manualDisconnect = true;
   if (_wsConnected) {
     _client.stop();
     _wsConnected = false;
@@ -261,21 +587,149 @@ bool ArduinoASRChat::isWebSocketConnected() {
   return _wsConnected && _client.connected();
 }
 
+/**
+ * @brief Enable persistent session mode
+ * @param enable true to keep the connection open between utterances
+ * @param pingIntervalMs Keepalive ping interval in milliseconds
+ */
+void ArduinoASRChat::setPersistentSession(bool enable, unsigned long pingIntervalMs) {
+  _persistentSession = enable;
+  _pingInterval = pingIntervalMs;
+}
+
+/**
+ * @brief Enable GZIP payload compression
+ * @param enable true to gzip the full client request (and get gzip compressed responses)
+ */
+void ArduinoASRChat::setCompression(bool enable) {
+  _gzipRequests = enable;
+  if (!enable) {
+    _deflater.end();
+  }
+}
+
+/**
+ * @brief Send keepalive ping while idle and detect dead connections
+ * @details Any received frame counts as a reply; an unanswered ping drops the connection,
+ *          which loop() then re-establishes in the background
+ */
+void ArduinoASRChat::serviceKeepAlive() {
+  unsigned long now = millis();
+
+  if (_pingOutstanding && now - _lastPingTime > PONG_TIMEOUT_MS) {
+    Serial.println("Keepalive ping unanswered, dropping connection");
+    _client.stop();
+    _wsConnected = false;
+    _pingOutstanding = false;
+    return;
+  }
+
+  if (!_pingOutstanding && now - _lastRxTime >= _pingInterval && now - _lastPingTime >= _pingInterval) {
+    sendPing();
+    _lastPingTime = now;
+    _pingOutstanding = true;
+  }
+}
+
+/**
+ * @brief Start background reconnect task
+ * @details Runs the TLS handshake outside loop(); loop() skips socket work until it finishes
+ */
+void ArduinoASRChat::startBackgroundReconnect() {
+  if (_reconnecting || (_lastReconnectAttempt != 0 && millis() - _lastReconnectAttempt < RECONNECT_INTERVAL_MS)) {
+    return;
+  }
+  _lastReconnectAttempt = millis();
+  _reconnecting = true;
+
+  // TLS handshake needs a larger stack than the audio tasks
+  if (AudioTasks::create(AUDIO_TASK_RECONNECT, reconnectTaskWrapper, "ASRReconnect", this) == nullptr) {
+    Serial.println("Reconnect task creation failed!");
+    _reconnecting = false;
+  }
+}
+
+/**
+ * @brief Background reconnect task
+ * @param param Pointer to ArduinoASRChat instance
+ */
+void ArduinoASRChat::reconnectTaskWrapper(void* param) {
+  ArduinoASRChat* instance = static_cast<ArduinoASRChat*>(param);
+  Serial.println("Reconnecting WebSocket in background...");
+  instance->_client.stop();
+  instance->connectWebSocket();
+  instance->_reconnecting = false;
+  AudioTasks::exit();
+}
+
+/**
+ * @brief Wait for background reconnect to finish
+ * @param timeoutMs Maximum wait time in milliseconds
+ * @return true if no reconnect is running any more
+ */
+bool ArduinoASRChat::waitForReconnect(unsigned long timeoutMs) {
+  unsigned long start = millis();
+  while (_reconnecting && millis() - start < timeoutMs) {
+    delay(10);
+  }
+  return !_reconnecting;
+}
+
+/**
+ * @brief Process responses until the final result of the previous request arrives
+ * @param timeoutMs Maximum wait time in milliseconds
+ * @return true if the connection is idle and can take a new request
+ */
+bool ArduinoASRChat::waitForFinalResult(unsigned long timeoutMs) {
+  unsigned long start = millis();
+  while (_awaitingFinal && isWebSocketConnected() && millis() - start < timeoutMs) {
+    if (_client.available()) {
+      handleWebSocketData();
+    } else {
+      delay(5);
+    }
+  }
+  return !_awaitingFinal && isWebSocketConnected();
+}
+
 /**
  * @brief Start recording and real-time recognition
  * @return true if started successfully, false if failed
  * @details Initialize recording state, send session configuration to ASR server
  */
 bool ArduinoASRChat::startRecording() {
-  // If end marker was sent, need to reconnect WebSocket (start new session)
-  if (_endMarkerSent) {
-    Serial.println("Reconnecting WebSocket for new session...");
-    disconnectWebSocket();
-    delay(100);
+  TurnMetrics::beginTurn();  // A turn starts with the user speaking
+
+  // Let a background reconnect finish before touching the socket
+  if (_reconnecting && !waitForReconnect(10000)) {
+    Serial.println("Background reconnect still running!");
+    return false;
+  }
+
+  // Persistent session: lost connection is re-established here if the background attempt failed
+  if (_persistentSession && !isWebSocketConnected()) {
+    _wsConnected = false;
     if (!connectWebSocket()) {
       Serial.println("Failed to reconnect WebSocket!");
       return false;
     }
+  }
+
+  // If end marker was sent, need a fresh recognition request
+  if (_endMarkerSent) {
+    if (_persistentSession && waitForFinalResult(1500)) {
+      // Previous request finished, start the next one on the same connection
+      Serial.println("Reusing WebSocket session");
+      _stats.reusedSessions++;
+    } else {
+      Serial.println("Reconnecting WebSocket for new session...");
+      disconnectWebSocket();
+      delay(100);
+      if (!connectWebSocket()) {
+        Serial.println("Failed to reconnect WebSocket!");
+        return false;
+      }
+    }
     _endMarkerSent = false;
   }
 
@@ -303,13 +757,35 @@ bool ArduinoASRChat::startRecording() {
   _lastSpeechTime = 0;          // Last time speech was detected
   _recordingStartTime = millis(); // Recording start time
   _sendBufferPos = 0;           // Send buffer position
+  _uplinkEncoder.reset();       // Each request carries its own Ogg stream
   _sameResultCount = 0;         // Same result count (for stability detection)
   _lastDotTime = millis();      // Last time progress dot was printed
 
+  // Prepare VAD for a new utterance
+  if (_vadEnabled && !allocateVADBuffers()) {
+    Serial.println("VAD buffer allocation failed, sending all audio");
+    _vadEnabled = false;
+  }
+  _vadFramePos = 0;
+  _vadPrerollHead = 0;
+  _vadPrerollCount = 0;
+
+  // Start capture task on first use, fall back to polling if it cannot run
+  if (_useCaptureTask && _micType != MIC_TYPE_M5CORES3 && !startCaptureTask()) {
+    Serial.println("Falling back to polled capture");
+    _useCaptureTask = false;
+  }
+
   // Send new session request, start new recognition session
   sendFullRequest();
   delay(50);  // Wait for server confirmation
 
+  // Discard audio captured before the session started, then let capture task store samples
+  if (_useCaptureTask && _captureTaskHandle != nullptr && _micType != MIC_TYPE_M5CORES3) {
+    _captureRing.discard();
+    _captureActive = true;
+  }
+
   return true;
 }
 
@@ -322,11 +798,21 @@ void ArduinoASRChat::stopRecording() {
     return;
   }
 
-  // Send remaining audio data in buffer
-  if (_sendBufferPos > 0) {
-    sendAudioChunk((uint8_t*)_sendBuffer, _sendBufferPos * 2);
-    _sendBufferPos = 0;
+  // Stop capture task from storing samples and flush what is left in the ring
+  if (_captureActive) {
+    _captureActive = false;
+    drainCaptureRing();
+  }
+
+  // Partial VAD frame is only worth sending while still in speech
+  if (_vadEnabled && _vadFramePos > 0 && _vad.isSpeech()) {
+    appendSendBuffer(_vadFrame, _vadFramePos);
   }
+  _vadFramePos = 0;
+
+  // Send remaining audio data in buffer (Opus: always, the last page closes the stream)
+  sendAudioSamples(_sendBuffer, _sendBufferPos, true);
+  _sendBufferPos = 0;
 
   Serial.println("\n========================================");
   Serial.println("Recording stopped");
@@ -361,6 +847,11 @@ bool ArduinoASRChat::isRecording() {
  * @details Handle audio sending, receive recognition results, check timeout and silence
  */
 void ArduinoASRChat::loop() {
+  // Socket belongs to the reconnect task until it finishes
+  if (_reconnecting) {
+    return;
+  }
+
   // Check connection status - mark as disconnected if connection lost
   if (_wsConnected && !_client.connected()) {
     Serial.println("Connection lost");
@@ -368,11 +859,19 @@ void ArduinoASRChat::loop() {
     _isRecording = false;
   }
 
-  // If not connected, return directly
+  // If not connected, return directly (persistent mode reconnects in background)
   if (!_wsConnected) {
+    if (_persistentSession && !_manualDisconnect) {
+      startBackgroundReconnect();
+    }
     return;
   }
 
+  // Keep idle connection warm
+  if (_persistentSession && !_isRecording) {
+    serviceKeepAlive();
+  }
+
   // Handle audio sending during recording
   if (_isRecording && !_shouldStop) {
     processAudioSending();      // Read microphone data and send
@@ -387,9 +886,8 @@ void ArduinoASRChat::loop() {
       handleWebSocketData();
     } else {
       // Process all pending responses after recording ends
-      while (_client.available()) {
+      while (_client.available() && _wsConnected) {
         handleWebSocketData();
-        delay(10);
       }
     }
   }
@@ -414,26 +912,30 @@ void ArduinoASRChat::processAudioSending() {
     return;
   }
 
+  // Capture task mode: samples are already in the ring, send complete batches only
+  if (_captureActive) {
+    drainCaptureRing();
+    return;
+  }
+
   // Tight loop to read audio samples, keep in sync with I2S data rate
   // Must read fast enough to avoid buffer overflow and send data timely
+  int16_t block[CAPTURE_BLOCK_SAMPLES];
+  size_t count = 0;
   for (int i = 0; i < _samplesPerRead; i++) {
     if (!_I2S.available()) {
       break;  // No more data available
     }
 
-    int sample = _I2S.read();
-
-    // Filter invalid data (0, -1, 1 are usually noise or initialization values)
-    if (sample != 0 && sample != -1 && sample != 1) {
-      _sendBuffer[_sendBufferPos++] = (int16_t)sample;
-
-      // Buffer full, send batch immediately
-      if (_sendBufferPos >= _sendBatchSize / 2) {
-        sendAudioChunk((uint8_t*)_sendBuffer, _sendBufferPos * 2);
-        _sendBufferPos = 0;
-      }
+    block[count++] = (int16_t)_I2S.read();
+    if (count == CAPTURE_BLOCK_SAMPLES) {
+      queueSamples(block, count);
+      count = 0;
     }
   }
+  if (count > 0) {
+    queueSamples(block, count);
+  }
 
   yield();  // Yield CPU to other tasks
 }
@@ -449,21 +951,7 @@ void ArduinoASRChat::feedAudioData(const int16_t* data, size_t samples) {
     return;
   }
 
-  // Process samples
-  for (size_t i = 0; i < samples; i++) {
-    int16_t sample = data[i];
-
-    // Filter invalid data
-    if (sample != 0 && sample != -1 && sample != 1) {
-      _sendBuffer[_sendBufferPos++] = sample;
-
-      // Buffer full, send batch immediately
-      if (_sendBufferPos >= _sendBatchSize / 2) {
-        sendAudioChunk((uint8_t*)_sendBuffer, _sendBufferPos * 2);
-        _sendBufferPos = 0;
-      }
-    }
-  }
+  queueSamples(data, samples);
 }
 
 /**
@@ -494,11 +982,22 @@ void ArduinoASRChat::checkRecordingTimeout() {
  *          This is the core function of VAD (Voice Activity Detection)
  */
 void ArduinoASRChat::checkSilence() {
+  // VAD mode: silence is measured in audio time since the last speech frame
+  if (_vadEnabled) {
+    if (_vad.speechDetected() && _vad.silenceMs() >= _silenceDuration) {
+      Serial.printf("\nSilence detected by VAD (%lums), stopping\n", (unsigned long)_vad.silenceMs());
+      TurnMetrics::mark(TURN_VAD_END);
+      stopRecording();
+    }
+    return;
+  }
+
   // Check silence - if speech detected and silence duration exceeded
   if (_hasSpeech && _lastSpeechTime > 0) {
     unsigned long silence = millis() - _lastSpeechTime;
     if (silence >= _silenceDuration) {
       Serial.printf("\nSilence detected (%.1fs), stopping\n", silence / 1000.0);
+      TurnMetrics::mark(TURN_VAD_END);
       stopRecording();
     }
   }
@@ -565,11 +1064,11 @@ void ArduinoASRChat::sendFullRequest() {
   doc["request"]["workflow"] = "audio_in,resample,partition,vad,fe,decode,itn,nlu_punctuate";  // Processing workflow
   doc["request"]["result_type"] = "full";              // Result type
   doc["request"]["sequence"] = 1;                      // Sequence number
-  doc["audio"]["format"] = "raw";                      // Audio format
+  doc["audio"]["format"] = useOpus() ? "ogg" : "raw";  // Audio format
   doc["audio"]["rate"] = _sampleRate;                  // Sample rate
   doc["audio"]["bits"] = _bitsPerSample;               // Bit depth
   doc["audio"]["channel"] = _channels;                 // Number of channels
-  doc["audio"]["codec"] = "raw";                       // Codec
+  doc["audio"]["codec"] = useOpus() ? "opus" : "raw";  // Codec
 
   String json_str;
   serializeJson(doc, json_str);
@@ -579,9 +1078,23 @@ void ArduinoASRChat::sendFullRequest() {
   Serial.println("Sending config:");
   Serial.println(json_str);
 
-  // ByteDance ASR protocol header (4 bytes)
-  uint8_t header[4] = {0x11, (CLIENT_FULL_REQUEST << 4) | NO_SEQUENCE, 0x10, 0x00};
+  // Optional GZIP, only kept if it actually shrinks the payload
+  const uint8_t* payload = (const uint8_t*)json_str.c_str();
   uint32_t payload_len = json_str.length();
+  uint8_t compression = COMPRESS_NONE;
+  uint8_t* compressed = nullptr;
+  if (_gzipRequests) {
+    compressed = new uint8_t[payload_len];
+    size_t n = _deflater.compress(payload, payload_len, compressed, payload_len);
+    if (n > 0) {
+      payload = compressed;
+      payload_len = n;
+      compression = COMPRESS_GZIP;
+    }
+  }
+
+  // ByteDance ASR protocol header (4 bytes)
+  uint8_t header[4] = {0x11, (CLIENT_FULL_REQUEST << 4) | NO_SEQUENCE, (uint8_t)(0x10 | compression), 0x00};
   // Length field (4 bytes, big-endian)
   uint8_t len_bytes[4];
   len_bytes[0] = (payload_len >> 24) & 0xFF;
@@ -593,10 +1106,11 @@ void ArduinoASRChat::sendFullRequest() {
   uint8_t* full_request = new uint8_t[8 + payload_len];
   memcpy(full_request, header, 4);
   memcpy(full_request + 4, len_bytes, 4);
-  memcpy(full_request + 8, json_str.c_str(), payload_len);
+  memcpy(full_request + 8, payload, payload_len);
 
   sendWebSocketFrame(full_request, 8 + payload_len, 0x02);  // 0x02 = binary frame
   delete[] full_request;
+  delete[] compressed;
 }
 
 /**
@@ -623,6 +1137,7 @@ void ArduinoASRChat::sendAudioChunk(uint8_t* data, size_t len) {
 
   sendWebSocketFrame(audio_request, 8 + len, 0x02);
   delete[] audio_request;
+  TurnMetrics::mark(TURN_FIRST_AUDIO_SENT);  // Only the first of the turn is kept
 }
 
 /**
@@ -638,132 +1153,57 @@ void ArduinoASRChat::sendEndMarker() {
   memcpy(end_request + 4, len_bytes, 4);
 
   sendWebSocketFrame(end_request, 8, 0x02);
+  _awaitingFinal = true;
   Serial.println("End marker sent");
 }
 
 /**
- * @brief Send Pong response
- * @details Respond to server's Ping message, keep connection alive
+ * @brief Send Ping frame
+ * @details Keepalive for persistent sessions, any server frame clears the outstanding ping
  */
-void ArduinoASRChat::sendPong() {
-  uint8_t pong_data[1] = {0};
-  sendWebSocketFrame(pong_data, 0, 0x0A);  // 0x0A = Pong frame
+void ArduinoASRChat::sendPing() {
+  uint8_t ping_data[1] = {0};
+  sendWebSocketFrame(ping_data, 0, 0x09);  // 0x09 = Ping frame
 }
 
 /**
  * @brief Send WebSocket frame
- * @param data Data to send
+ * @param data Data to send (not modified)
  * @param len Data length
  * @param opcode WebSocket opcode (0x01=text, 0x02=binary, 0x08=close, 0x09=Ping, 0x0A=Pong)
- * @details Encapsulate data frame according to WebSocket protocol, including frame header, mask, data
+ * @details Masking and framing are done by the shared WebSocketEngine in its send buffer
  */
-void ArduinoASRChat::sendWebSocketFrame(uint8_t* data, size_t len, uint8_t opcode) {
+void ArduinoASRChat::sendWebSocketFrame(const uint8_t* data, size_t len, uint8_t opcode) {
   if (!_wsConnected || !_client.connected()) return;
-
-  // Build WebSocket frame header
-  uint8_t header[10];
-  int header_len = 2;
-
-  header[0] = 0x80 | opcode;  // FIN=1 + opcode
-  header[1] = 0x80;           // MASK=1
-
-  // Length encoding (use different format based on data length)
-  if (len < 126) {
-    header[1] |= len;  // 7-bit length
-  } else if (len < 65536) {
-    header[1] |= 126;  // Use 16-bit extended length
-    header[2] = (len >> 8) & 0xFF;
-    header[3] = len & 0xFF;
-    header_len = 4;
-  } else {
-    header[1] |= 127;  // Use 64-bit extended length
-    for (int i = 0; i < 8; i++) {
-      header[2 + i] = (len >> (56 - i * 8)) & 0xFF;
-    }
-    header_len = 10;
-  }
-
-  // Generate random mask key (client to server must be masked)
-  uint8_t mask_key[4];
-  for (int i = 0; i < 4; i++) {
-    mask_key[i] = random(0, 256);
-  }
-  memcpy(header + header_len, mask_key, 4);
-  header_len += 4;
-
-  // Send frame header
-  _client.write(header, header_len);
-
-  // Mask data and send
-  for (size_t i = 0; i < len; i++) {
-    data[i] ^= mask_key[i % 4];
-  }
-  _client.write(data, len);
+  _ws.sendFrame(_client, opcode, data, len);
 }
 
 /**
  * @brief Handle received WebSocket data
- * @details Parse WebSocket frame, handle different types of messages (text/binary/control frames)
+ * @details Feeds whatever the socket has to the frame parser without waiting, complete
+ *          messages arrive in wsMessage(). Pings are answered by the engine.
  */
 void ArduinoASRChat::handleWebSocketData() {
-  // Read WebSocket frame header (2 bytes)
-  uint8_t header[2];
-  if (_client.readBytes(header, 2) != 2) {
+  int consumed = _ws.poll(_client);
+  if (consumed < 0) {
+    Serial.println("Server closed connection");
+    _wsConnected = false;
+    _client.stop();
     return;
   }
 
-  bool fin = header[0] & 0x80;           // FIN flag
-  uint8_t opcode = header[0] & 0x0F;     // Opcode
-  bool masked = header[1] & 0x80;        // MASK flag
-  uint64_t payload_len = header[1] & 0x7F;  // Payload length
-  
-  // Handle extended length
-  if (payload_len == 126) {
-    uint8_t len_bytes[2];
-    _client.readBytes(len_bytes, 2);
-    payload_len = (len_bytes[0] << 8) | len_bytes[1];
-  } else if (payload_len == 127) {
-    uint8_t len_bytes[8];
-    _client.readBytes(len_bytes, 8);
-    payload_len = 0;
-    for (int i = 0; i < 8; i++) {
-      payload_len = (payload_len << 8) | len_bytes[i];
-    }
-  }
-
-  // Read mask key (if present)
-  uint8_t mask_key[4] = {0};
-  if (masked) {
-    _client.readBytes(mask_key, 4);
+  // Any data proves the connection is alive
+  if (consumed > 0) {
+    _lastRxTime = millis();
+    _pingOutstanding = false;
   }
+}
 
-  // Read payload data
-  if (payload_len > 0 && payload_len < 100000) {  // Limit maximum length to prevent memory overflow
-    uint8_t* payload = new uint8_t[payload_len];
-    size_t bytes_read = _client.readBytes(payload, payload_len);
-
-    if (bytes_read == payload_len) {
-      // Unmask
-      if (masked) {
-        for (size_t i = 0; i < payload_len; i++) {
-          payload[i] ^= mask_key[i % 4];
-        }
-      }
-
-      // Handle different opcodes
-      if (opcode == 0x01 || opcode == 0x02) {  // Text or binary data
-        parseResponse(payload, payload_len);
-      } else if (opcode == 0x08) {  // Close connection
-        Serial.println("Server closed connection");
-        _wsConnected = false;
-        _client.stop();
-      } else if (opcode == 0x09) {  // Ping
-        sendPong();
-      }
-    }
-
-    delete[] payload;
-  }
+/**
+ * @brief WebSocketEngine message callback
+ */
+void ArduinoASRChat::wsMessage(uint8_t opcode, uint8_t* data, size_t len, void* user) {
+  ((ArduinoASRChat*)user)->parseResponse(data, len);
 }
 
 /**
@@ -779,6 +1219,7 @@ void ArduinoASRChat::parseResponse(uint8_t* data, size_t len) {
   // Parse ByteDance ASR protocol header
   uint8_t msg_type = data[1] >> 4;      // Message type
   uint8_t header_size = data[0] & 0x0f; // Header size (in 4-byte units)
+  uint8_t compression = data[2] & 0x0f; // Payload compression
 
   if (len < header_size * 4) return;
 
@@ -798,6 +1239,20 @@ void ArduinoASRChat::parseResponse(uint8_t* data, size_t len) {
     payload_len -= 8;
   }
 
+  // Decompress GZIP payload into the reusable buffer
+  if (compression == COMPRESS_GZIP) {
+    if (_inflateBuffer == nullptr) {
+      _inflateBuffer = (uint8_t*)AudioMemory::alloc(INFLATE_BUFFER_SIZE, AUDIO_MEM_PSRAM_PREFERRED);
+    }
+    int32_t ret = _inflateBuffer != nullptr ? _inflater.inflate(payload, payload_len, _inflateBuffer, INFLATE_BUFFER_SIZE) : GZIP_ERR_MEMORY;
+    if (ret < 0) {
+      Serial.printf("\nResponse GZIP decode failed (%d)\n", (int)ret);
+      return;
+    }
+    payload = _inflateBuffer;
+    payload_len = ret;
+  }
+
   // Parse JSON response
   StaticJsonDocument<2048> doc;
   DeserializationError error = deserializeJson(doc, payload, payload_len);
@@ -806,11 +1261,18 @@ void ArduinoASRChat::parseResponse(uint8_t* data, size_t len) {
     return;
   }
 
+  // Negative sequence marks the final response of a request
+  if (doc.containsKey("sequence") && doc["sequence"].as<int>() < 0) {
+    _awaitingFinal = false;
+    TurnMetrics::mark(TURN_ASR_FINAL);
+  }
+
   // Check error code
   if (doc.containsKey("code")) {
     int code = doc["code"];
     if (code != 1000 && code != 1013) {
       // Ignore 1000 (success) and 1013 (silence detection)
+      _awaitingFinal = false;  // Request failed, no final result will follow
       Serial.print("\nError: ");
       serializeJson(doc, Serial);
       Serial.println();
@@ -849,6 +1311,7 @@ void ArduinoASRChat::parseResponse(uint8_t* data, size_t len) {
         // Result stable (10 consecutive same results), automatically stop recording
         if (_sameResultCount >= 10 && _isRecording && !_shouldStop) {
           Serial.println("\nResult stable, stopping recording");
+          TurnMetrics::mark(TURN_VAD_END);
           stopRecording();
         }
       } else {
@@ -7,6 +7,15 @@
 #include <ESP_I2S.h>
 #include <mbedtls/base64.h>
 #include <mbedtls/sha1.h>
+#include <atomic>
+#include "EnergyVAD.h"
+#include "AudioMemory.h"
+#include "AudioRingBuffer.h"
+#include "AudioTasks.h"
+#include "StreamEncoder.h"
+#include "GzipCodec.h"
+#include "WebSocketEngine.h"
+#include "TurnMetrics.h"
 
 /**
  * @file ArduinoASRChat.h
@@ -26,6 +35,18 @@ enum MicrophoneType {
 };
 #endif
 
+// WebSocket session statistics (if not defined)
+#ifndef WS_SESSION_STATS_DEFINED
+#define WS_SESSION_STATS_DEFINED
+struct WSSessionStats {
+  uint32_t handshakes = 0;             // Successful TLS + WebSocket handshakes
+  uint32_t failedHandshakes = 0;       // Failed connection attempts
+  uint32_t reusedSessions = 0;         // Requests started on an already open connection
+  unsigned long lastHandshakeMs = 0;   // Duration of the last successful handshake
+  unsigned long totalHandshakeMs = 0;  // Sum of all successful handshake durations
+};
+#endif
+
 // ByteDance ASR protocol message types
 #define CLIENT_FULL_REQUEST 0b0001      // Client full request (including handshake info)
 #define CLIENT_AUDIO_ONLY_REQUEST 0b0010 // Client audio-only request
@@ -37,6 +58,12 @@ enum MicrophoneType {
 #define NO_SEQUENCE 0b0000             // No sequence
 #define NEG_SEQUENCE 0b0010            // Negative sequence
 
+// Payload compression (low nibble of the third header byte, shared with ArduinoRealtimeDialog)
+#ifndef COMPRESS_NONE
+#define COMPRESS_NONE 0b0000
+#define COMPRESS_GZIP 0b0001
+#endif
+
 /**
  * @class ArduinoASRChat
  * @brief ByteDance speech recognition chat class
@@ -58,6 +85,11 @@ class ArduinoASRChat {
      */
     ArduinoASRChat(const char* apiKey, const char* cluster = "volcengine_input_en");
 
+    /**
+     * @brief Destructor - Release the response decompression buffer
+     */
+    ~ArduinoASRChat();
+
     /**
      * @brief Configure API settings
      * @param apiKey API key
@@ -79,6 +111,15 @@ class ArduinoASRChat {
      */
     void setAudioParams(int sampleRate = 16000, int bitsPerSample = 16, int channels = 1);
 
+    /**
+     * @brief Set uplink audio codec
+     * @param codec "raw" (default, 16-bit PCM) or "opus" (Ogg Opus encoded on device)
+     * @param bitrate Opus target bitrate in bit/s (default 24000, raw 16kHz PCM is 256000)
+     * @return Whether the codec is supported and its encoder could be allocated
+     * @note Opus requires 16kHz mono (see setAudioParams()), other settings fall back to raw
+     */
+    bool setAudioCodec(const char* codec, uint32_t bitrate = StreamEncoder::DEFAULT_BITRATE);
+
     /**
      * @brief Set silence duration
      * @param duration Silence duration (milliseconds)
@@ -116,6 +157,31 @@ class ArduinoASRChat {
      */
     bool initM5CoreS3Microphone();
 
+    /**
+     * @brief Enable dedicated capture task
+     * @param enable true to read the microphone from a pinned FreeRTOS task, false to poll from loop()
+     * @param coreId Core to pin the capture task to (default: AUDIO_TASK_CAPTURE core, the one loop() does not use)
+     * @note Not used for MIC_TYPE_M5CORES3, audio is fed via feedAudioData() there
+     * @note Priority and stack size follow AudioTasks::set(AUDIO_TASK_CAPTURE, ...)
+     */
+    void setCaptureTask(bool enable, int coreId = AUDIO_CORE_DEFAULT);
+
+    /**
+     * @brief Enable on-device voice activity detection
+     * @param enable true to gate audio with the energy VAD
+     * @note When enabled, only speech frames (plus a 200ms pre-roll) are sent, and recording stops
+     *       once setSilenceDuration() of non-speech audio follows detected speech
+     */
+    void setVADEnabled(bool enable);
+
+    /**
+     * @brief Set VAD parameters
+     * @param speechRatio Speech threshold relative to the adaptive noise floor (default 3.0)
+     * @param minRms Absolute RMS threshold for speech (default 200)
+     * @param hangoverMs Time frames are still sent after speech drops (default 300ms)
+     */
+    void setVADParams(float speechRatio, float minRms, unsigned long hangoverMs);
+
     /**
      * @brief Connect to WebSocket server
      * @return Whether connection was successful
@@ -133,6 +199,28 @@ class ArduinoASRChat {
      */
     bool isWebSocketConnected();
 
+    /**
+     * @brief Enable persistent session mode
+     * @param enable true to keep the WebSocket open between utterances
+     * @param pingIntervalMs Idle time before a keepalive ping is sent (milliseconds)
+     * @note New recognition requests are started on the open connection; if the server closes it,
+     *       loop() reconnects in a background task so the next startRecording() finds it warm
+     */
+    void setPersistentSession(bool enable, unsigned long pingIntervalMs = 15000);
+
+    /**
+     * @brief Enable GZIP payload compression
+     * @param enable true to gzip the full client request, the server then answers with gzip compressed results
+     * @note Audio is sent as is; compressed responses are decoded whatever this setting
+     */
+    void setCompression(bool enable);
+
+    /**
+     * @brief Get connection statistics
+     * @return Handshake count and timing, number of reused sessions
+     */
+    WSSessionStats getSessionStats() const { return _stats; }
+
     /**
      * @brief Start recording
      * @return Whether start was successful
@@ -227,12 +315,34 @@ class ArduinoASRChat {
     MicrophoneType _micType = MIC_TYPE_INMP441;  // Microphone type
     I2SClass _I2S;                              // I2S object
 
+    // Capture task (SPSC ring: capture task is the producer, loop() the consumer)
+    static const size_t CAPTURE_RING_SAMPLES = 16384;  // Ring size (~1s at 16kHz, power of two)
+    static const size_t CAPTURE_BLOCK_SAMPLES = 240;   // Samples per read (one default I2S DMA frame block)
+    bool _useCaptureTask = false;               // Capture from dedicated task
+    int _captureCore = AUDIO_CORE_DEFAULT;      // Capture task core override
+    TaskHandle_t _captureTaskHandle = nullptr;  // Capture task handle
+    AudioRingBuffer _captureRing;               // Capture ring buffer
+    std::atomic<uint32_t> _captureOverruns{0};  // Blocks dropped because ring was full
+    volatile bool _captureActive = false;       // Capture task should store samples
+
+    // Voice activity detection
+    static const size_t VAD_PREROLL_FRAMES = 10;  // Frames kept before speech onset (200ms at 20ms frames)
+    bool _vadEnabled = false;                   // VAD gating enabled
+    EnergyVAD _vad;                             // Energy VAD
+    int16_t* _vadFrame = nullptr;               // Frame accumulator
+    size_t _vadFramePos = 0;                    // Samples in frame accumulator
+    int16_t* _vadPreroll = nullptr;             // Pre-roll ring (VAD_PREROLL_FRAMES frames)
+    size_t _vadPrerollHead = 0;                 // Next pre-roll slot
+    size_t _vadPrerollCount = 0;                // Frames in pre-roll
+
     // M5CoreS3 microphone buffer (only used when _micType == MIC_TYPE_M5CORES3)
     int16_t* _m5MicBuffer = nullptr;            // M5CoreS3 microphone buffer
     static const size_t _m5MicBufferSize = 320; // Buffer size (samples)
 
     // WiFi client
+    static const size_t WS_MAX_MESSAGE = 100000;  // Largest response assembled
     WiFiClientSecure _client;                  // Secure WiFi client
+    WebSocketEngine _ws;                       // Frame parser and sender
 
     // Status flags
     bool _wsConnected = false;                 // WebSocket connection status
@@ -242,6 +352,20 @@ class ArduinoASRChat {
     bool _hasNewResult = false;                // Has new result flag
     bool _endMarkerSent = false;               // Track if end marker has been sent
 
+    // Persistent session
+    static const unsigned long PONG_TIMEOUT_MS = 5000;      // Ping unanswered for this long = dead connection
+    static const unsigned long RECONNECT_INTERVAL_MS = 5000; // Minimum time between background reconnects
+    bool _persistentSession = false;           // Keep connection between utterances
+    unsigned long _pingInterval = 15000;       // Keepalive ping interval
+    unsigned long _lastRxTime = 0;             // Last frame received
+    unsigned long _lastPingTime = 0;           // Last ping sent
+    bool _pingOutstanding = false;             // Ping sent, nothing received since
+    bool _awaitingFinal = false;               // End marker sent, final response pending
+    volatile bool _reconnecting = false;       // Background reconnect running
+    bool _manualDisconnect = false;            // disconnectWebSocket() called, don't reconnect
+    unsigned long _lastReconnectAttempt = 0;   // Last background reconnect start
+    WSSessionStats _stats;                     // Connection statistics
+
     // Recording state
     String _lastResultText = "";               // Previous result text
     String _recognizedText = "";               // Recognized text
@@ -253,21 +377,46 @@ class ArduinoASRChat {
     // Audio buffer
     int16_t* _sendBuffer;                     // Send buffer
     int _sendBufferPos = 0;                    // Send buffer position
+    StreamEncoder _uplinkEncoder;              // Ogg Opus encoder, codec PCM when sending raw
+
+    // GZIP payloads (window and buffer allocated on first use, reused for every response)
+    static const size_t INFLATE_BUFFER_SIZE = 4096;  // Largest decompressed response
+    bool _gzipRequests = false;                // Compress the full client request
+    GzipInflater _inflater;                    // Response decompression
+    GzipDeflater _deflater;                    // Request compression
+    uint8_t* _inflateBuffer = nullptr;         // Decompressed response
 
     // Callback functions
     ResultCallback _resultCallback = nullptr;           // Result callback function
     TimeoutNoSpeechCallback _timeoutNoSpeechCallback = nullptr;  // Timeout no speech callback function
 
     // Private helper methods
+    bool performHandshake();                  // TLS connect + WebSocket upgrade
+    void serviceKeepAlive();                  // Send keepalive ping, detect dead connection
+    void startBackgroundReconnect();          // Reconnect in a FreeRTOS task
+    static void reconnectTaskWrapper(void* param);  // Reconnect task
+    bool waitForReconnect(unsigned long timeoutMs); // Wait for background reconnect
+    bool waitForFinalResult(unsigned long timeoutMs); // Drain responses until final result
+    void sendPing();                           // Send Ping frame
     String generateWebSocketKey();            // Generate WebSocket key
     void handleWebSocketData();                // Handle WebSocket data
-    void sendWebSocketFrame(uint8_t* data, size_t len, uint8_t opcode);  // Send WebSocket frame
+    static void wsMessage(uint8_t opcode, uint8_t* data, size_t len, void* user);  // WebSocketEngine message callback
+    void sendWebSocketFrame(const uint8_t* data, size_t len, uint8_t opcode);  // Send WebSocket frame
     void sendFullRequest();                   // Send full request
     void sendAudioChunk(uint8_t* data, size_t len);  // Send audio chunk
+    void sendAudioSamples(const int16_t* samples, size_t count, bool last);  // Encode (if enabled) and send a batch
+    bool useOpus() const { return _uplinkEncoder.codec() == STREAM_CODEC_OPUS && _sampleRate == 16000 && _channels == 1; }  // Send ogg/opus
     void sendEndMarker();                      // Send end marker
-    void sendPong();                           // Send Pong response
     void parseResponse(uint8_t* data, size_t len);   // Parse response
     void processAudioSending();                // Process audio sending
+    bool startCaptureTask();                   // Allocate ring and create capture task
+    size_t drainCaptureRing();                 // Move captured samples into the send path
+    void queueSamples(const int16_t* samples, size_t count);  // Send path entry (VAD gating)
+    void appendSendBuffer(const int16_t* samples, size_t count);  // Batch samples and send full chunks
+    void processVADFrame();                    // Classify accumulated frame and gate it
+    bool allocateVADBuffers();                 // Allocate VAD frame and pre-roll buffers
+    static void captureTaskWrapper(void* param); // Static wrapper for task
+    void captureTaskLoop();                    // Capture task main loop
     void checkRecordingTimeout();             // Check recording timeout
     void checkSilence();                       // Check silence
 };
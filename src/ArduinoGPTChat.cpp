@@ -11,6 +11,292 @@ String g_api_host = "";
 // Base64 encoding table
 const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
+/**
+ * @brief Byte reader for an HTTP response
+ *
+ * Buffers socket reads and strips chunked transfer framing so the SSE parser
+ * sees the plain event stream. Returns -1 on timeout, disconnect or the end
+ * of the body. The body end is known from Content-Length or the last chunk,
+ * so a completely read response leaves a kept connection ready for the next.
+ */
+struct HttpBodyReader {
+  WiFiClient* client = nullptr;
+  bool chunked = false;
+  long contentLeft = -1;           // Body bytes left, -1: until the server closes
+  size_t chunkLeft = 0;
+  bool done = false;
+  bool complete = false;           // Body end reached, not a timeout or disconnect
+  bool keepAlive = true;           // Server keeps the connection after this response
+  bool received = false;           // Any response byte arrived
+  unsigned long timeoutMs = 0;
+  unsigned long lastRx = 0;
+  uint8_t raw[512];
+  size_t rawLen = 0;
+  size_t rawPos = 0;
+
+  void begin(WiFiClient* c, unsigned long timeout) {
+    client = c;
+    timeoutMs = timeout;
+    lastRx = millis();
+  }
+
+  /**
+   * @brief Read status line and headers
+   * @return HTTP status code, 0 on timeout or disconnect
+   */
+  int readHeaders(char* line, size_t size) {
+    int status = 0;
+    size_t len = 0;
+    int c;
+    while ((c = readRaw()) >= 0) {
+      if (c == '\r') continue;
+      if (c != '\n') {
+        if (len < size - 1) line[len++] = (char)c;
+        continue;
+      }
+      line[len] = '\0';
+      if (len == 0) {
+        if (contentLeft == 0) complete = done = true;
+        return status;
+      }
+      if (status == 0 && strncmp(line, "HTTP/", 5) == 0) {
+        keepAlive = strncmp(line, "HTTP/1.0", 8) != 0;
+        const char* sp = strchr(line, ' ');
+        status = sp ? atoi(sp + 1) : 0;
+      } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0 && strstr(line + 18, "chunked")) {
+        chunked = true;
+      } else if (strncasecmp(line, "Content-Length:", 15) == 0) {
+        contentLeft = atol(line + 15);
+      } else if (strncasecmp(line, "Connection:", 11) == 0 && (strstr(line + 11, "close") || strstr(line + 11, "Close"))) {
+        keepAlive = false;
+      }
+      len = 0;
+    }
+    return 0;
+  }
+
+  bool reusable() const {
+    return keepAlive && complete && rawPos >= rawLen;
+  }
+
+  String readString() {
+    String body;
+    body.reserve(contentLeft > 0 ? contentLeft : 1024);
+    int c;
+    while ((c = read()) >= 0) {
+      body += (char)c;
+    }
+    return body;
+  }
+
+  // Read the rest of the body so the connection can be kept
+  void drain(unsigned long timeout) {
+    if (!keepAlive || (!chunked && contentLeft < 0)) return;
+    timeoutMs = timeout;
+    while (read() >= 0) {}
+  }
+
+  int readRaw() {
+    while (rawPos >= rawLen) {
+      int avail = client->available();
+      if (avail > 0) {
+        int n = client->read(raw, min((size_t)avail, sizeof(raw)));
+        if (n > 0) {
+          rawLen = n;
+          rawPos = 0;
+          lastRx = millis();
+          received = true;
+          break;
+        }
+      } else if (!client->connected() || millis() - lastRx > timeoutMs) {
+        return -1;
+      } else {
+        delay(1);
+      }
+    }
+    return raw[rawPos++];
+  }
+
+  int read() {
+    if (done) return -1;
+    if (!chunked) {
+      if (contentLeft == 0) {
+        complete = done = true;
+        return -1;
+      }
+      int c = readRaw();
+      if (c < 0) {
+        done = true;
+      } else if (contentLeft > 0) {
+        contentLeft--;
+      }
+      return c;
+    }
+
+    if (chunkLeft == 0) {
+      // Chunk size line: hex digits, optional extensions, CRLF
+      size_t size = 0;
+      bool inSize = true;
+      int c;
+      while ((c = readRaw()) >= 0 && c != '\n') {
+        int digit = -1;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        if (inSize && digit >= 0) size = (size << 4) | digit;
+        else inSize = false;
+      }
+      if (c < 0) {
+        done = true;
+        return -1;
+      }
+      if (size == 0) {
+        // Last chunk: skip trailers up to the blank line
+        size_t trailer = 0;
+        while ((c = readRaw()) >= 0) {
+          if (c == '\n') {
+            if (trailer == 0) break;
+            trailer = 0;
+          } else if (c != '\r') {
+            trailer++;
+          }
+        }
+        complete = c >= 0;
+        done = true;
+        return -1;
+      }
+      chunkLeft = size;
+    }
+
+    int c = readRaw();
+    if (c < 0) {
+      done = true;
+      return -1;
+    }
+    if (--chunkLeft == 0) {
+      // Skip CRLF trailing the chunk data
+      readRaw();
+      readRaw();
+    }
+    return c;
+  }
+};
+
+/**
+ * @brief Print sink that batches small writes into socket-sized blocks
+ *
+ * TLS sends one record per write() call, so the payload's many small prints
+ * are collected first. Without a client it only counts: the same code then
+ * measures the body for Content-Length and streams it, and the payload never
+ * exists as a String.
+ */
+class BufferedSocketPrint : public Print {
+public:
+  explicit BufferedSocketPrint(WiFiClient* out) : _out(out) {}
+
+  size_t write(uint8_t c) override {
+    return write(&c, 1);
+  }
+
+  size_t write(const uint8_t* data, size_t len) override {
+    _total += len;
+    if (_out == nullptr) {
+      return len;
+    }
+    if (len >= sizeof(_buf)) {
+      // Large blocks (audio) go out directly
+      flush();
+      if (_out->write(data, len) != len) _failed = true;
+      return len;
+    }
+    size_t left = len;
+    while (left > 0) {
+      size_t n = min(left, sizeof(_buf) - _len);
+      memcpy(_buf + _len, data, n);
+      _len += n;
+      data += n;
+      left -= n;
+      if (_len == sizeof(_buf)) flush();
+    }
+    return len;
+  }
+
+  void flush() override {
+    if (_out != nullptr && _len > 0) {
+      if (_out->write(_buf, _len) != _len) _failed = true;
+      _len = 0;
+    }
+  }
+
+  size_t total() const { return _total; }
+  bool failed() const { return _failed; }
+
+private:
+  WiFiClient* _out;
+  uint8_t _buf[1024];
+  size_t _len = 0;
+  size_t _total = 0;
+  bool _failed = false;
+};
+
+/**
+ * @brief Write a JSON string literal with escaping
+ * @param out Destination
+ * @param s UTF-8 text, passed through except quotes, backslash and control characters
+ */
+static void writeJsonString(Print& out, const char* s) {
+  out.write('"');
+  const char* run = s;
+  for (; *s; s++) {
+    unsigned char c = (unsigned char)*s;
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+    out.write((const uint8_t*)run, s - run);
+    switch (c) {
+      case '"':  out.print("\\\""); break;
+      case '\\': out.print("\\\\"); break;
+      case '\n': out.print("\\n"); break;
+      case '\r': out.print("\\r"); break;
+      case '\t': out.print("\\t"); break;
+      case '\b': out.print("\\b"); break;
+      case '\f': out.print("\\f"); break;
+      default: {
+        char esc[8];
+        snprintf(esc, sizeof(esc), "\\u%04x", c);
+        out.print(esc);
+      }
+    }
+    run = s + 1;
+  }
+  out.write((const uint8_t*)run, s - run);
+  out.write('"');
+}
+
+/**
+ * @brief Write one chat message object
+ * @param first true for the first array element, cleared on return
+ */
+static void writeChatMessage(Print& out, const char* role, const char* content, bool& first) {
+  if (!first) out.write(',');
+  first = false;
+  out.print("{\"role\":\"");
+  out.print(role);
+  out.print("\",\"content\":");
+  writeJsonString(out, content);
+  out.write('}');
+}
+
+/**
+ * @brief Write the image request JSON up to the start of the base64 data
+ */
+static void writeImagePrefix(Print& out, const char* question, const char* mimeType) {
+  out.print("{\"model\":\"gpt-4.1-nano\",\"messages\":[{\"role\":\"user\",\"content\":[");
+  out.print("{\"type\":\"text\",\"text\":");
+  writeJsonString(out, question);
+  out.print("},{\"type\":\"image_url\",\"image_url\":{\"url\":\"data:");
+  out.print(mimeType);
+  out.print(";base64,");
+}
+
 /**
  * @brief Base64 encoding function
  * @param input Input data pointer
@@ -88,11 +374,7 @@ size_t ArduinoGPTChat::base64_encode_length(size_t input_length) {
  * @param question Question about the image
  * @return GPT response text
  *
- * This function implements a memory-efficient image processing workflow:
- * 1. Read image file in chunks and encode to Base64
- * 2. Save Base64 data to temporary file
- * 3. Build JSON request containing image and text
- * 4. Use streaming HTTP send to avoid memory overflow
+ * The image is base64 encoded while it is read and sent, see _postImage()
  */
 String ArduinoGPTChat::sendImageMessage(const char* imageFilePath, String question) {
   Serial.println("Opening image file...");
@@ -104,364 +386,135 @@ String ArduinoGPTChat::sendImageMessage(const char* imageFilePath, String questi
 
   size_t fileSize = imageFile.size();
   Serial.printf("File size: %d bytes\n", fileSize);
-  
-  // Solution 2: Use flash space to store Base64 encoded data
-  const char* tempBase64File = "/temp_base64.txt";
-
-  // Delete possibly existing temporary file
-  if (SPIFFS.exists(tempBase64File)) {
-    SPIFFS.remove(tempBase64File);
-  }
-
-  // Create temporary file to store Base64 data
-  File base64File = SPIFFS.open(tempBase64File, FILE_WRITE);
-  if (!base64File) {
-    Serial.println("Failed to create temp base64 file");
-    imageFile.close();
-    return "Error: Failed to create temp file";
-  }
-
-  // Write Base64 prefix (MIME type)
-  base64File.print("data:image/png;base64,");
-  
-  Serial.println("Starting base64 encoding and writing to SD...");
 
-  // Use smaller chunk size and dynamic memory allocation to avoid stack overflow
-  const size_t chunkSize = 1500; // Reduced to 1.5KB chunks (must be multiple of 3 for Base64 encoding)
-  
-  uint8_t* buffer = (uint8_t*)malloc(chunkSize);
-  if (!buffer) {
-    Serial.println("Failed to allocate buffer memory");
-    imageFile.close();
-    base64File.close();
-    SPIFFS.remove(tempBase64File);
-    return "Error: Failed to allocate buffer";
-  }
-  
-  char* encodedChunk = (char*)malloc(chunkSize * 4 / 3 + 10); // Base64 expansion + padding
-  if (!encodedChunk) {
-    Serial.println("Failed to allocate encoded buffer memory");
-    free(buffer);
-    imageFile.close();
-    base64File.close();
-    SPIFFS.remove(tempBase64File);
-    return "Error: Failed to allocate encoded buffer";
-  }
-  
-  size_t totalProcessed = 0;
-  while (totalProcessed < fileSize) {
-    size_t currentChunkSize = min(chunkSize, fileSize - totalProcessed);
-    size_t bytesRead = imageFile.read(buffer, currentChunkSize);
-    
-    if (bytesRead != currentChunkSize) {
-      Serial.println("Error reading file chunk");
-      free(buffer);
-      free(encodedChunk);
-      imageFile.close();
-      base64File.close();
-      SPIFFS.remove(tempBase64File);
-      return "Error: Failed to read file chunk";
-    }
-    
-    // Encode current chunk
-    base64_encode(buffer, bytesRead, encodedChunk);
-
-    // Write encoded data to SPIFFS
-    base64File.print(encodedChunk);
-
-    totalProcessed += bytesRead;
-
-    // Display progress
-    if (totalProcessed % 15000 == 0 || totalProcessed == fileSize) {
-      Serial.printf("Processed: %d/%d bytes (%.1f%%)\n",
-                   totalProcessed, fileSize,
-                   (float)totalProcessed / fileSize * 100);
-    }
-
-    // Add small delay to give system time to handle other tasks
-    delay(10);
-  }
-  
-  // Free buffer memory
-  free(buffer);
-  free(encodedChunk);
+  String path = imageFilePath;
+  path.toLowerCase();
+  const char* mimeType = (path.endsWith(".jpg") || path.endsWith(".jpeg")) ? "image/jpeg" : "image/png";
 
+  String reply = _postImage(&imageFile, nullptr, fileSize, mimeType, question);
   imageFile.close();
-  base64File.close();
-
-  Serial.println("Base64 encoding completed and saved to SPIFFS");
-
-  // Check generated base64 file size
-  File checkFile = SPIFFS.open(tempBase64File);
-  if (!checkFile) {
-    Serial.println("Failed to open temp base64 file for reading");
-    return "Error: Failed to open temp base64 file";
-  }
-  
-  size_t base64FileSize = checkFile.size();
-  Serial.printf("Base64 file size: %d bytes\n", base64FileSize);
-  checkFile.close();
-  
-  // Now build JSON using smaller buffer
-  DynamicJsonDocument doc(2048); // Only need small buffer since Base64 data not included
-  doc["model"] = "gpt-4.1-nano";
-  doc["messages"] = JsonArray();
-  JsonObject message = doc["messages"].createNestedObject();
-  message["role"] = "user";
-  JsonArray content = message.createNestedArray("content");
-  
-  // Add text part
-  JsonObject textPart = content.createNestedObject();
-  textPart["type"] = "text";
-  textPart["text"] = question;
-
-  // Add image part
-  JsonObject imagePart = content.createNestedObject();
-  imagePart["type"] = "image_url";
-  JsonObject imageUrl = imagePart.createNestedObject("image_url");
-
-  // Set placeholder, replace later
-  imageUrl["url"] = "PLACEHOLDER_FOR_BASE64_DATA";
-  
-  doc["max_tokens"] = 300;
-
-  // Serialize JSON to string
-  String jsonTemplate;
-  serializeJson(doc, jsonTemplate);
-
-  Serial.println("JSON template created");
-  Serial.printf("Template size: %d bytes\n", jsonTemplate.length());
-
-  // Build complete JSON, but read Base64 data in chunks to save memory
-  Serial.println("Building JSON with chunked base64 reading...");
-
-  // Calculate final JSON size
-  int placeholderPos = jsonTemplate.indexOf("PLACEHOLDER_FOR_BASE64_DATA");
-  String jsonPart1 = jsonTemplate.substring(0, placeholderPos);
-  String jsonPart2 = jsonTemplate.substring(placeholderPos + strlen("PLACEHOLDER_FOR_BASE64_DATA"));
-  
-  Serial.printf("JSON part 1 size: %d bytes\n", jsonPart1.length());
-  Serial.printf("JSON part 2 size: %d bytes\n", jsonPart2.length());
-  Serial.printf("Base64 data size: %d bytes\n", base64FileSize);
-  
-  // Create temporary file to store complete JSON
-  const char* tempJsonFile = "/temp_json.txt";
-  if (SPIFFS.exists(tempJsonFile)) {
-    SPIFFS.remove(tempJsonFile);
-  }
-
-  File jsonFile = SPIFFS.open(tempJsonFile, FILE_WRITE);
-  if (!jsonFile) {
-    Serial.println("Failed to create temp JSON file");
-    SPIFFS.remove(tempBase64File);
-    return "Error: Failed to create temp JSON file";
-  }
-
-  // Write first part of JSON
-  jsonFile.print(jsonPart1);
-
-  // Read Base64 data in chunks and write to JSON file
-  Serial.println("Copying base64 data to JSON file...");
-  File base64ReadFile = SPIFFS.open(tempBase64File);
-  if (!base64ReadFile) {
-    Serial.println("Failed to open base64 file for reading");
-    jsonFile.close();
-    SPIFFS.remove(tempBase64File);
-    SPIFFS.remove(tempJsonFile);
-    return "Error: Failed to read base64 file";
-  }
-  
-  const size_t copyChunkSize = 2048;
-  uint8_t* copyBuffer = (uint8_t*)malloc(copyChunkSize);
-  if (!copyBuffer) {
-    Serial.println("Failed to allocate copy buffer");
-    base64ReadFile.close();
-    jsonFile.close();
-    SPIFFS.remove(tempBase64File);
-    SPIFFS.remove(tempJsonFile);
-    return "Error: Failed to allocate copy buffer";
-  }
-  
-  size_t totalCopied = 0;
-  while (base64ReadFile.available()) {
-    size_t bytesToRead = min(copyChunkSize, (size_t)base64ReadFile.available());
-    size_t bytesRead = base64ReadFile.read(copyBuffer, bytesToRead);
-    
-    jsonFile.write(copyBuffer, bytesRead);
-    totalCopied += bytesRead;
-    
-    if (totalCopied % 20480 == 0) { // Display progress every 20KB
-      Serial.printf("Copied: %d/%d bytes\n", totalCopied, base64FileSize);
-    }
-  }
-  
-  free(copyBuffer);
-  base64ReadFile.close();
-  
-  // Write second part of JSON
-  jsonFile.print(jsonPart2);
-  jsonFile.close();
-
-  // Clean up Base64 temporary file
-  SPIFFS.remove(tempBase64File);
+  return reply;
+}
 
-  // Check JSON file size
-  File checkJsonFile = SPIFFS.open(tempJsonFile);
-  if (!checkJsonFile) {
-    Serial.println("Failed to open JSON file for size check");
-  SPIFFS.remove(tempJsonFile);
-    return "Error: Failed to open JSON file";
+/**
+ * @brief Send image message to GPT API from memory
+ * @param image Encoded image (e.g. the JPEG of an esp_camera frame buffer)
+ * @param imageSize Image size in bytes
+ * @param question Question about the image
+ * @param mimeType MIME type of the image
+ * @return GPT response text
+ */
+String ArduinoGPTChat::sendImageMessage(const uint8_t* image, size_t imageSize, String question, const char* mimeType) {
+  if (image == nullptr || imageSize == 0) {
+    Serial.println("Invalid image buffer or size!");
+    return "Error: Invalid image buffer";
   }
-  
-  size_t jsonFileSize = checkJsonFile.size();
-  Serial.printf("Final JSON file size: %d bytes\n", jsonFileSize);
-  checkJsonFile.close();
-  
-  // Use real streaming HTTP send to avoid loading large JSON into memory
-  Serial.println("Starting streaming HTTP POST...");
+  return _postImage(nullptr, image, imageSize, mimeType, question);
+}
 
-  WiFiClientSecure client;
-  client.setInsecure(); // Skip SSL certificate verification
-
-  if (!client.connect("api.chatanywhere.tech", 443)) {
-    Serial.println("Failed to connect to server");
-    SPIFFS.remove(tempJsonFile);
-    return "Error: Failed to connect to server";
-  }
-
-  // Send HTTP request headers
-  client.print("POST /v1/chat/completions HTTP/1.1\r\n");
-  client.print("Host: api.chatanywhere.tech\r\n");
-  client.print("Content-Type: application/json\r\n");
-  client.print("Authorization: Bearer ");
-  client.print(_apiKey);
-  client.print("\r\n");
-  client.print("Content-Length: ");
-  client.print(jsonFileSize);
-  client.print("\r\n");
-  client.print("Connection: close\r\n");
-  client.print("\r\n");
-
-  Serial.println("Streaming JSON file...");
-  
-  // Stream send JSON file
-  File sendJsonFile = SPIFFS.open(tempJsonFile);
-  if (!sendJsonFile) {
-    Serial.println("Failed to open JSON file for streaming");
-    client.stop();
-    SPIFFS.remove(tempJsonFile);
-    return "Error: Failed to open JSON file for streaming";
+// JSON after the base64 data
+static const char* const IMAGE_JSON_TAIL = "\"}}]}],\"max_tokens\":300}";
+
+struct ImageRequestBody {
+  ArduinoGPTChat* chat;
+  File* file;                 // Image source, nullptr to read from image
+  const uint8_t* image;
+  size_t imageSize;
+  const char* mimeType;
+  const char* question;
+  uint8_t* buffer;            // IMAGE_READ_CHUNK bytes read from file
+  char* encoded;              // base64 of one chunk
+  const char* error;          // Set when the image could not be read
+};
+
+bool ArduinoGPTChat::_writeImageBody(BufferedSocketPrint& out, void* context) {
+  ImageRequestBody* body = (ImageRequestBody*)context;
+  writeImagePrefix(out, body->question, body->mimeType);
+  out.flush();
+
+  if (body->file) {
+    body->file->seek(0);
   }
-  
-  const size_t streamChunkSize = 1024;
-  uint8_t* streamBuffer = (uint8_t*)malloc(streamChunkSize);
-  if (!streamBuffer) {
-    Serial.println("Failed to allocate stream buffer");
-    sendJsonFile.close();
-    client.stop();
-    SPIFFS.remove(tempJsonFile);
-    return "Error: Failed to allocate stream buffer";
-  }
-  
-  size_t totalStreamed = 0;
-  while (sendJsonFile.available()) {
-    size_t bytesToRead = min(streamChunkSize, (size_t)sendJsonFile.available());
-    size_t bytesRead = sendJsonFile.read(streamBuffer, bytesToRead);
-    
-    client.write(streamBuffer, bytesRead);
-    totalStreamed += bytesRead;
-    
-    if (totalStreamed % 10240 == 0) { // Display progress every 10KB
-      Serial.printf("Streamed: %d/%d bytes\n", totalStreamed, jsonFileSize);
+  size_t sent = 0;
+  while (sent < body->imageSize && !out.failed()) {
+    size_t n = min(IMAGE_READ_CHUNK, body->imageSize - sent);
+    const uint8_t* chunk = body->image + sent;
+    if (body->file) {
+      if (body->file->read(body->buffer, n) != n) {
+        body->error = "Error: Failed to read file chunk";
+        return false;
+      }
+      chunk = body->buffer;
     }
-
-    delay(1); // Small delay to ensure stable data transmission
+    body->chat->base64_encode(chunk, n, body->encoded);
+    out.write((const uint8_t*)body->encoded, (n + 2) / 3 * 4);  // Whole block, bypasses the small-write buffer
+    sent += n;
   }
-  
-  free(streamBuffer);
-  sendJsonFile.close();
-  SPIFFS.remove(tempJsonFile);
-  
-  Serial.printf("Total streamed: %d bytes\n", totalStreamed);
-  Serial.println("Waiting for response...");
+  out.print(IMAGE_JSON_TAIL);
+  out.flush();
+  Serial.printf("Total streamed: %d bytes\n", out.total());
+  return true;
+}
 
-  // Wait for response
-  unsigned long timeout = millis() + 30000; // 30 second timeout
-  while (!client.available() && millis() < timeout) {
-    delay(100);
-  }
-  
-  if (millis() >= timeout) {
-    Serial.println("HTTP response timeout");
-    client.stop();
-    return "Error: HTTP response timeout";
+/**
+ * @brief Post an image question to the chat completion endpoint
+ * @param file Image source, nullptr to read from image
+ * @param image Image data when file is nullptr
+ * @param imageSize Image size in bytes
+ * @param mimeType MIME type of the data URL
+ * @param question Question about the image
+ * @return GPT response text, "Error: ..." on failure
+ *
+ * Single pass: the base64 length follows from the image size, so
+ * Content-Length is known before the first byte is read. The image is then
+ * read in IMAGE_READ_CHUNK blocks and each is encoded straight into one
+ * socket write, nothing is staged in flash or held as a whole in memory.
+ */
+String ArduinoGPTChat::_postImage(File* file, const uint8_t* image, size_t imageSize, const char* mimeType,
+                                  const String& question) {
+  ImageRequestBody body = {this, file, image, imageSize, mimeType, question.c_str(), nullptr, nullptr, nullptr};
+
+  BufferedSocketPrint counter(nullptr);
+  writeImagePrefix(counter, body.question, mimeType);
+  const size_t encodedSize = base64_encode_length(imageSize) - 1;
+  const size_t length = counter.total() + encodedSize + strlen(IMAGE_JSON_TAIL);
+  Serial.printf("Request size: %d bytes (base64 %d bytes)\n", length, encodedSize);
+
+  body.buffer = file ? (uint8_t*)malloc(IMAGE_READ_CHUNK) : nullptr;
+  body.encoded = (char*)malloc(IMAGE_READ_CHUNK / 3 * 4 + 1);
+  if ((file && !body.buffer) || !body.encoded) {
+    Serial.println("Failed to allocate image buffers");
+    free(body.buffer);
+    free(body.encoded);
+    return "Error: Failed to allocate buffer";
   }
-  
-  // Read response
-  String response = "";
-  String line = "";
-  bool headersPassed = false;
-  int statusCode = 0;
 
-  Serial.println("Reading response headers...");
-  
-  while (client.available()) {
-    char c = client.read();
-    if (c == '\n') {
-      if (line.length() <= 1) { // Empty line or only \r, indicates end of headers
-        if (!headersPassed) {
-          headersPassed = true;
-          Serial.println("Headers passed, reading body...");
-        }
-        line = "";
-        continue;
-      }
-      if (headersPassed) {
-        response += line + "\n";
-      } else {
-        // Parse response headers
-        if (line.startsWith("HTTP/1.1 ")) {
-          statusCode = line.substring(9, 12).toInt();
-          Serial.printf("HTTP Response code: %d\n", statusCode);
-        }
-        Serial.println("Header: " + line);
-      }
-      line = "";
-    } else if (c != '\r') {
-      line += c;
-    }
-  }
-  
-  // Handle last line
-  if (line.length() > 0) {
-    if (headersPassed) {
-      response += line;
-    } else {
-      Serial.println("Last header: " + line);
+  Serial.println("Starting streaming HTTP POST...");
+  HttpBodyReader reader;
+  char line[256];
+  int statusCode = _sendRequest(_apiUrl, "application/json", nullptr, length, _writeImageBody, &body, reader, line,
+                                sizeof(line));
+  free(body.buffer);
+  free(body.encoded);
+
+  if (statusCode == 0) {
+    if (body.error) {
+      Serial.println(body.error);
     }
+    return body.error ? body.error : "Error: HTTP request failed";
   }
 
-  client.stop();
+  reader.timeoutMs = SSE_IDLE_TIMEOUT_MS;
+  String response = reader.readString();
+  _releaseConnection(reader.client, reader.reusable());
+  Serial.printf("HTTP Response code: %d\n", statusCode);
 
   if (statusCode == 200 && response.length() > 0) {
-    Serial.println("Raw response:");
-    Serial.println(response);
-
-    // Handle chunked transfer encoding - find JSON start position
-    String cleanResponse = response;
-    int jsonStart = cleanResponse.indexOf('{');
-    if (jsonStart > 0) {
-      cleanResponse = cleanResponse.substring(jsonStart);
-      Serial.println("Cleaned JSON response:");
-      Serial.println(cleanResponse);
-    }
-
-    return _processResponse(cleanResponse);
-  } else {
-    Serial.println("Error response:");
-    Serial.println(response);
-    return "Error: HTTP request failed with code " + String(statusCode);
+    return _processResponse(response);
   }
+  Serial.println("Error response:");
+  Serial.println(response);
+  return "Error: HTTP request failed with code " + String(statusCode);
 }
 
 /**
@@ -478,6 +531,20 @@ ArduinoGPTChat::ArduinoGPTChat(const char* apiKey, const char* apiBaseUrl) {
   _updateApiUrls();
 }
 
+/**
+ * @brief Destructor
+ *
+ * Stop a running recording and release the recording buffer
+ */
+ArduinoGPTChat::~ArduinoGPTChat() {
+  if (_isRecording) {
+    _recordingI2S.end();
+    _isRecording = false;
+  }
+  AudioMemory::release(_audioBuffer);
+  _audioBuffer = nullptr;
+}
+
 /**
  * @brief Set API configuration
  * @param apiKey API key
@@ -527,10 +594,110 @@ void ArduinoGPTChat::enableMemory(bool enable) {
  * Clear all saved conversation history
  */
 void ArduinoGPTChat::clearMemory() {
-  _conversationHistory.clear();
+  for (int i = 0; i < MAX_HISTORY_PAIRS; i++) {
+    _historyUser[i] = String();
+    _historyAssistant[i] = String();
+  }
+  _historyStart = 0;
+  _historyCount = 0;
   Serial.println("Conversation memory cleared");
 }
 
+/**
+ * @brief Enable or disable HTTP keep-alive
+ * @param enable true to keep the connection open between requests
+ *
+ * A kept connection saves the TCP and TLS handshake of the next request to
+ * the same host, at the cost of the TLS buffers staying allocated
+ */
+void ArduinoGPTChat::setKeepAlive(bool enable) {
+  _keepAlive = enable;
+  if (!enable) {
+    closeConnections();
+  }
+}
+
+/**
+ * @brief Close all pooled connections
+ */
+void ArduinoGPTChat::closeConnections() {
+  for (int i = 0; i < CONNECTION_POOL_SIZE; i++) {
+    _pool[i].client()->stop();
+    _pool[i].host = "";
+  }
+}
+
+/**
+ * @brief Get a connected client for a host, reusing a kept connection
+ * @param host Host name
+ * @param port Port
+ * @param secure true for TLS
+ * @param reused Output true if an existing connection is returned
+ * @return Connected client, nullptr if the connection failed
+ */
+WiFiClient* ArduinoGPTChat::_acquireConnection(const String& host, uint16_t port, bool secure, bool& reused) {
+  unsigned long now = millis();
+  PooledConnection* slot = nullptr;
+  for (int i = 0; i < CONNECTION_POOL_SIZE; i++) {
+    if (_pool[i].host == host && _pool[i].port == port && _pool[i].secure == secure) {
+      slot = &_pool[i];
+      break;
+    }
+  }
+
+  // Unread bytes on an idle socket mean it is out of step with the requests
+  if (slot != nullptr && slot->client()->connected() && slot->client()->available() == 0 &&
+      now - slot->lastUsed < KEEP_ALIVE_IDLE_MS) {
+    reused = true;
+    return slot->client();
+  }
+
+  if (slot == nullptr) {
+    // Least recently used slot, unused ones first
+    slot = &_pool[0];
+    for (int i = 1; i < CONNECTION_POOL_SIZE; i++) {
+      if (_pool[i].host.length() == 0 || _pool[i].lastUsed < slot->lastUsed) {
+        slot = &_pool[i];
+        if (slot->host.length() == 0) break;
+      }
+    }
+  }
+
+  slot->client()->stop();
+  slot->host = host;
+  slot->port = port;
+  slot->secure = secure;
+  if (secure) {
+    slot->secureClient.setInsecure(); // Skip SSL certificate verification
+  }
+  reused = false;
+  if (!slot->client()->connect(host.c_str(), port)) {
+    slot->host = "";
+    return nullptr;
+  }
+  slot->lastUsed = now;
+  return slot->client();
+}
+
+/**
+ * @brief Return a client after its response was read
+ * @param client Client from _acquireConnection()
+ * @param reusable true if the response was read completely and the server keeps the connection
+ */
+void ArduinoGPTChat::_releaseConnection(WiFiClient* client, bool reusable) {
+  for (int i = 0; i < CONNECTION_POOL_SIZE; i++) {
+    if (_pool[i].host.length() > 0 && _pool[i].client() == client) {
+      if (reusable && _keepAlive) {
+        _pool[i].lastUsed = millis();
+      } else {
+        client->stop();
+        _pool[i].host = "";
+      }
+      return;
+    }
+  }
+}
+
 /**
  * @brief Update API URLs
  *
@@ -560,85 +727,369 @@ void ArduinoGPTChat::_updateApiUrls() {
  * Build HTTP request to send to GPT API, process response and manage conversation history
  */
 String ArduinoGPTChat::sendMessage(String message) {
-  HTTPClient http;
-  http.begin(_apiUrl);
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("Authorization", "Bearer " + String(_apiKey));
+  TurnMetrics::beginTurn(false);  // Part of the running turn if ASR began one
+  char* line = (char*)malloc(SSE_LINE_BUFFER_SIZE);
+  if (!line) {
+    Serial.println("Failed to allocate response line buffer");
+    return "";
+  }
 
-  String payload = _buildPayload(message);
-  int httpResponseCode = http.POST(payload);
+  HttpBodyReader reader;
+  int statusCode = _postChat(message, false, reader, line);
+  free(line);
+  if (statusCode == 0) {
+    return "";
+  }
 
-  if (httpResponseCode == 200) {
-    String response = http.getString();
-    String assistantResponse = _processResponse(response);
+  String response = reader.readString();
+  _releaseConnection(reader.client, reader.reusable());
+  if (statusCode != 200) {
+    Serial.printf("HTTP Response code: %d\n", statusCode);
+    Serial.println(response);
+    return "";
+  }
 
-    // If memory enabled, save to conversation history
-    if (_memoryEnabled && assistantResponse.length() > 0) {
-      _conversationHistory.push_back(std::make_pair(message, assistantResponse));
+  TurnMetrics::mark(TURN_LLM_FIRST_TOKEN);  // Whole reply arrives at once
+  String assistantResponse = _processResponse(response);
+  _saveToHistory(message, assistantResponse);
+  return assistantResponse;
+}
 
-      // Only keep last N conversation pairs to avoid memory overflow
-      while (_conversationHistory.size() > _maxHistoryPairs) {
-        _conversationHistory.erase(_conversationHistory.begin());
+/**
+ * @brief Send text message to GPT and stream the reply
+ * @param message User message
+ * @param onToken Callback invoked for every content fragment as it arrives (may be nullptr)
+ * @param userData Pointer passed through to the callback
+ * @return true if reply text arrived, false on failure
+ *
+ * Requests the completion with "stream": true and parses the server-sent events
+ * line by line from the socket. Only the current SSE line is buffered, so the
+ * response JSON is never held in memory and the first tokens are delivered
+ * while the model is still generating. The reply is collected only while
+ * conversation memory is enabled, for the history.
+ */
+bool ArduinoGPTChat::sendMessageStream(String message, StreamTokenCallback onToken, void* userData) {
+  TurnMetrics::beginTurn(false);
+  char* line = (char*)malloc(SSE_LINE_BUFFER_SIZE);
+  if (!line) {
+    Serial.println("Failed to allocate SSE line buffer");
+    return false;
+  }
+
+  HttpBodyReader reader;
+  int statusCode = _postChat(message, true, reader, line);
+  if (statusCode == 0) {
+    free(line);
+    return false;
+  }
+  WiFiClient* client = reader.client;
+  reader.timeoutMs = SSE_IDLE_TIMEOUT_MS;
+
+  size_t len = 0;
+  int c;
+  if (statusCode != 200) {
+    // Error body is a regular JSON document, print what fits in the line buffer
+    len = 0;
+    while (len < SSE_LINE_BUFFER_SIZE - 1 && (c = reader.read()) >= 0) {
+      line[len++] = (char)c;
+    }
+    line[len] = '\0';
+    Serial.printf("HTTP Response code: %d\n", statusCode);
+    Serial.println(line);
+    free(line);
+    _releaseConnection(client, false);
+    return false;
+  }
+
+  // Keep only the delta text from each event
+  StaticJsonDocument<128> filter;
+  filter["choices"][0]["delta"]["content"] = true;
+  filter["error"]["message"] = true;
+  DynamicJsonDocument event(1024);
+
+  String reply;                 // Only with memory enabled, for the history
+  bool received = false;
+  bool overflow = false;
+  bool finished = false;
+  len = 0;
+
+  while (!finished && (c = reader.read()) >= 0) {
+    if (c == '\r') continue;
+    if (c != '\n') {
+      if (len < SSE_LINE_BUFFER_SIZE - 1) {
+        line[len++] = (char)c;
+      } else {
+        overflow = true;
       }
+      continue;
+    }
+    line[len] = '\0';
+    size_t lineLen = len;
+    len = 0;
+
+    if (overflow) {
+      Serial.println("SSE line too long, skipped");
+      overflow = false;
+      continue;
+    }
+    if (lineLen < 5 || strncmp(line, "data:", 5) != 0) {
+      continue; // Blank separator, comment or other SSE field
+    }
+
+    const char* data = line + 5;
+    if (*data == ' ') data++;
+    if (strcmp(data, "[DONE]") == 0) {
+      finished = true;
+      break;
+    }
 
-      Serial.printf("Memory: %d/%d conversation pairs stored\n",
-                    _conversationHistory.size(), _maxHistoryPairs);
+    DeserializationError err = deserializeJson(event, data, DeserializationOption::Filter(filter));
+    if (err) {
+      Serial.print("SSE JSON parse failed: ");
+      Serial.println(err.c_str());
+      continue;
     }
 
-    return assistantResponse;
+    const char* errorMessage = event["error"]["message"];
+    if (errorMessage) {
+      Serial.print("API error: ");
+      Serial.println(errorMessage);
+      break;
+    }
+
+    const char* content = event["choices"][0]["delta"]["content"];
+    if (content && *content) {
+      TurnMetrics::mark(TURN_LLM_FIRST_TOKEN);
+      received = true;
+      if (_memoryEnabled) {
+        reply += content;
+      }
+      if (onToken) {
+        onToken(content, userData);  // Line breaks are kept, TextSegmenter ends segments at them
+      }
+    }
   }
-  return "";
+
+  free(line);
+  if (finished) {
+    reader.drain(DRAIN_TIMEOUT_MS);  // Last chunk follows [DONE]
+  } else {
+    Serial.println("SSE stream ended before [DONE]");
+  }
+  _releaseConnection(client, reader.reusable());
+
+  _saveToHistory(message, reply);
+  return received;
 }
 
 /**
- * @brief Build JSON payload for HTTP request
- * @param message Current user message
- * @return JSON formatted request string
+ * @brief Save a completed exchange to conversation history
+ * @param message User message
+ * @param reply Assistant reply
  *
- * Build complete GPT request JSON based on system prompt and conversation history
- * Contains system message, conversation history and current user message
+ * Does nothing when memory is disabled or the reply is empty
  */
-String ArduinoGPTChat::_buildPayload(String message) {
-  // Calculate required buffer size based on history
-  size_t bufferSize = 768;
-  if (_memoryEnabled && _conversationHistory.size() > 0) {
-    bufferSize = 768 + (_conversationHistory.size() * 512);  // Reserve extra space for history
+void ArduinoGPTChat::_saveToHistory(const String& message, const String& reply) {
+  if (!_memoryEnabled || reply.length() == 0) {
+    return;
   }
 
-  DynamicJsonDocument doc(bufferSize);
-  doc["model"] = "gpt-4.1-nano";
-  JsonArray messages = doc.createNestedArray("messages");
+  // Full ring: the oldest pair is overwritten, its Strings keep their buffers
+  int slot = (_historyStart + _historyCount) % MAX_HISTORY_PAIRS;
+  if (_historyCount == MAX_HISTORY_PAIRS) {
+    _historyStart = (_historyStart + 1) % MAX_HISTORY_PAIRS;
+  } else {
+    _historyCount++;
+  }
+  _historyUser[slot] = message;
+  _historyAssistant[slot] = reply;
+
+  Serial.printf("Memory: %d/%d conversation pairs stored\n", _historyCount, MAX_HISTORY_PAIRS);
+}
+
+/**
+ * @brief Split an http(s) URL into connection parts
+ * @param url Full URL
+ * @param host Output host name
+ * @param port Output port (explicit or scheme default)
+ * @param path Output path including leading '/'
+ * @param secure Output true for https
+ * @return true if the URL could be parsed
+ */
+bool ArduinoGPTChat::_parseUrl(const String& url, String& host, uint16_t& port, String& path, bool& secure) {
+  int hostStart;
+  if (url.startsWith("https://")) {
+    secure = true;
+    hostStart = 8;
+  } else if (url.startsWith("http://")) {
+    secure = false;
+    hostStart = 7;
+  } else {
+    return false;
+  }
+
+  int pathStart = url.indexOf('/', hostStart);
+  String authority = (pathStart < 0) ? url.substring(hostStart) : url.substring(hostStart, pathStart);
+  path = (pathStart < 0) ? String("/") : url.substring(pathStart);
+
+  int colon = authority.indexOf(':');
+  if (colon >= 0) {
+    host = authority.substring(0, colon);
+    port = authority.substring(colon + 1).toInt();
+  } else {
+    host = authority;
+    port = secure ? 443 : 80;
+  }
+  return host.length() > 0 && port > 0;
+}
+
+/**
+ * @brief Write the chat completion request JSON
+ * @param out Destination, a counting or socket sink
+ * @param message Current user message
+ * @param stream true to request a server-sent event stream
+ *
+ * Contains system message, conversation history and current user message.
+ * Written straight from the stored strings, no JSON document is built
+ */
+void ArduinoGPTChat::_writePayload(Print& out, const String& message, bool stream) {
+  out.print("{\"model\":\"gpt-4.1-nano\",\"messages\":[");
+  bool first = true;
 
   // If system prompt configured, add system message
   if (_systemPrompt.length() > 0) {
-    JsonObject sysMsg = messages.createNestedObject();
-    sysMsg["role"] = "system";
-    sysMsg["content"] = _systemPrompt;
+    writeChatMessage(out, "system", _systemPrompt.c_str(), first);
   }
 
-  // If memory enabled, add conversation history
+  // If memory enabled, add conversation history, oldest first
   if (_memoryEnabled) {
-    for (size_t i = 0; i < _conversationHistory.size(); i++) {
-      // Add user message from history
-      JsonObject historyUserMsg = messages.createNestedObject();
-      historyUserMsg["role"] = "user";
-      historyUserMsg["content"] = _conversationHistory[i].first;
-
-      // Add assistant reply from history
-      JsonObject historyAssistantMsg = messages.createNestedObject();
-      historyAssistantMsg["role"] = "assistant";
-      historyAssistantMsg["content"] = _conversationHistory[i].second;
+    for (int i = 0; i < _historyCount; i++) {
+      int slot = (_historyStart + i) % MAX_HISTORY_PAIRS;
+      writeChatMessage(out, "user", _historyUser[slot].c_str(), first);
+      writeChatMessage(out, "assistant", _historyAssistant[slot].c_str(), first);
     }
   }
 
   // Add current user message
-  JsonObject userMsg = messages.createNestedObject();
-  userMsg["role"] = "user";
-  userMsg["content"] = message;
+  writeChatMessage(out, "user", message.c_str(), first);
+  out.print(stream ? "],\"stream\":true}" : "]}");
+}
+
+/**
+ * @brief Write request line and headers of a POST
+ * @param accept Accept header value, nullptr to omit
+ */
+void ArduinoGPTChat::_writeRequestHead(Print& out, const String& host, const String& path, const char* contentType,
+                                       const char* accept, size_t contentLength) {
+  out.print("POST ");
+  out.print(path);
+  out.print(" HTTP/1.1\r\nHost: ");
+  out.print(host);
+  out.print("\r\nContent-Type: ");
+  out.print(contentType);
+  if (accept) {
+    out.print("\r\nAccept: ");
+    out.print(accept);
+  }
+  out.print("\r\nAuthorization: Bearer ");
+  out.print(_apiKey);
+  out.print("\r\nContent-Length: ");
+  out.print(contentLength);
+  out.print(_keepAlive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n");
+}
+
+/**
+ * @brief Send a POST over a pooled connection and read the response headers
+ * @param url Endpoint
+ * @param contentType Content-Type header value
+ * @param accept Accept header value, nullptr to omit
+ * @param length Content-Length
+ * @param writeBody Writes the body, called again when the request is repeated
+ * @param context Passed to writeBody
+ * @param reader Positioned at the response body on success
+ * @param line Scratch buffer for header lines
+ * @param lineSize Size of line
+ * @return HTTP status code, 0 if the request failed
+ *
+ * A kept connection the server closed while it was idle is found closed
+ * before any response byte arrived; only then is the request repeated, once,
+ * on a new connection. A timeout on a live connection is not retried, the
+ * server may already be working on the request.
+ */
+int ArduinoGPTChat::_sendRequest(const String& url, const char* contentType, const char* accept, size_t length,
+                                 BodyWriter writeBody, void* context, HttpBodyReader& reader, char* line,
+                                 size_t lineSize) {
+  String host, path;
+  uint16_t port;
+  bool secure;
+  if (!_parseUrl(url, host, port, path, secure)) {
+    Serial.println("Invalid URL: " + url);
+    return 0;
+  }
+
+  for (int attempt = 0; attempt < 2; attempt++) {
+    bool reused = false;
+    WiFiClient* client = _acquireConnection(host, port, secure, reused);
+    if (!client) {
+      Serial.println("Failed to connect to " + host);
+      return 0;
+    }
+    if (!reused) {
+      TurnMetrics::mark(TURN_TLS_CONNECT);  // A kept connection had its handshake in an earlier request
+    }
+
+    BufferedSocketPrint out(client);
+    _writeRequestHead(out, host, path, contentType, accept, length);
+    if (!writeBody(out, context)) {
+      _releaseConnection(client, false);
+      return 0;
+    }
+    out.flush();
+
+    reader = HttpBodyReader();
+    reader.begin(client, SSE_FIRST_BYTE_TIMEOUT_MS);
+    int statusCode = out.failed() ? 0 : reader.readHeaders(line, lineSize);
+    if (statusCode > 0) {
+      return statusCode;
+    }
+    bool closed = reused && !reader.received && !client->connected();
+    _releaseConnection(client, false);
+    if (!closed) {
+      break;
+    }
+    Serial.println("Kept connection was closed, reconnecting");
+  }
+  Serial.println("HTTP response timeout");
+  return 0;
+}
+
+struct ChatRequestBody {
+  ArduinoGPTChat* chat;
+  const String* message;
+  bool stream;
+};
 
-  String output;
-  serializeJson(doc, output);
-  return output;
+bool ArduinoGPTChat::_writeChatBody(BufferedSocketPrint& out, void* context) {
+  ChatRequestBody* body = (ChatRequestBody*)context;
+  body->chat->_writePayload(out, *body->message, body->stream);
+  return true;
+}
+
+/**
+ * @brief Send a chat completion request and read the response headers
+ * @param message Current user message
+ * @param stream true to request a server-sent event stream
+ * @param reader Positioned at the response body on success
+ * @param line Scratch buffer of SSE_LINE_BUFFER_SIZE bytes
+ * @return HTTP status code, 0 if the request failed
+ */
+int ArduinoGPTChat::_postChat(const String& message, bool stream, HttpBodyReader& reader, char* line) {
+  BufferedSocketPrint counter(nullptr);
+  _writePayload(counter, message, stream);
+
+  ChatRequestBody body = {this, &message, stream};
+  return _sendRequest(_apiUrl, "application/json", stream ? "text/event-stream" : nullptr, counter.total(),
+                      _writeChatBody, &body, reader, line, SSE_LINE_BUFFER_SIZE);
 }
 
 /**
@@ -743,146 +1194,8 @@ String ArduinoGPTChat::speechToText(const char* audioFilePath) {
   
   Serial.println("File read into memory successfully.");
 
-  // Use same boundary as Python example
-  String boundary = "wL36Yn8afVp8Ag7AmP8qZ0SA4n1v9T";
-
-  // Build multipart/form-data request body parts
-  // File part
-  String part1 = "--" + boundary + "\r\n";
-  part1 += "Content-Disposition: form-data; name=file; filename=audio.wav\r\n";
-  part1 += "Content-Type: audio/wav\r\n\r\n";
-
-  // Model part
-  String part2 = "\r\n--" + boundary + "\r\n";
-  part2 += "Content-Disposition: form-data; name=model;\r\n";
-  part2 += "Content-Type: text/plain\r\n\r\n";
-  part2 += "whisper-1";
-
-  // Prompt part (matching Python example)
-  String part3 = "\r\n--" + boundary + "\r\n";
-  part3 += "Content-Disposition: form-data; name=prompt;\r\n";
-  part3 += "Content-Type: text/plain\r\n\r\n";
-  part3 += "eiusmod nulla";
-
-  // Response format part
-  String part4 = "\r\n--" + boundary + "\r\n";
-  part4 += "Content-Disposition: form-data; name=response_format;\r\n";
-  part4 += "Content-Type: text/plain\r\n\r\n";
-  part4 += "json";
-
-  // Temperature part
-  String part5 = "\r\n--" + boundary + "\r\n";
-  part5 += "Content-Disposition: form-data; name=temperature;\r\n";
-  part5 += "Content-Type: text/plain\r\n\r\n";
-  part5 += "0";
-
-  // Language part (matching Python example)
-  String part6 = "\r\n--" + boundary + "\r\n";
-  part6 += "Content-Disposition: form-data; name=language;\r\n";
-  part6 += "Content-Type: text/plain\r\n\r\n";
-  part6 += "";
-
-  // End boundary
-  String part7 = "\r\n--" + boundary + "--\r\n";
-
-  // Calculate total content length
-  size_t totalLength = part1.length() + fileSize + part2.length() + part3.length() +
-                      part4.length() + part5.length() + part6.length() + part7.length();
-  
-  // Initialize HTTP client
-  HTTPClient http;
-  http.begin(_sttApiUrl);
-
-  // Set request headers
-  http.addHeader("Content-Type", "multipart/form-data; boundary=" + boundary);
-  http.addHeader("Authorization", "Bearer " + String(_apiKey));
-  http.addHeader("Content-Length", String(totalLength));
-
-  // Merge all parts into complete request body
-  Serial.println("Preparing request body...");
-  uint8_t* requestBody = (uint8_t*)malloc(totalLength);
-  if (!requestBody) {
-    Serial.println("Failed to allocate memory for request body!");
-    free(fileData);
-    return response;
-  }
-
-  // Copy each part to request body
-  size_t pos = 0;
-
-  // Copy part1
-  memcpy(requestBody + pos, part1.c_str(), part1.length());
-  pos += part1.length();
-
-  // Copy file data
-  memcpy(requestBody + pos, fileData, fileSize);
-  pos += fileSize;
-  free(fileData); // Free file data memory
-
-  // Copy remaining parts
-  memcpy(requestBody + pos, part2.c_str(), part2.length());
-  pos += part2.length();
-
-  memcpy(requestBody + pos, part3.c_str(), part3.length());
-  pos += part3.length();
-
-  memcpy(requestBody + pos, part4.c_str(), part4.length());
-  pos += part4.length();
-
-  memcpy(requestBody + pos, part5.c_str(), part5.length());
-  pos += part5.length();
-
-  memcpy(requestBody + pos, part6.c_str(), part6.length());
-  pos += part6.length();
-
-  memcpy(requestBody + pos, part7.c_str(), part7.length());
-  pos += part7.length();
-
-  // Confirm total length matches
-  if (pos != totalLength) {
-    Serial.println("Warning: actual body length doesn't match calculated length");
-    Serial.println("Calculated: " + String(totalLength) + ", Actual: " + String(pos));
-  }
-
-  // Send request
-  Serial.println("Sending STT request...");
-  int httpCode = http.POST(requestBody, totalLength);
-
-  // Free request body memory
-  free(requestBody);
-  
-  Serial.print("HTTP Response Code: ");
-  Serial.println(httpCode);
-  
-  if (httpCode == 200) {
-    // Get response body
-    response = http.getString();
-    Serial.println("Got STT response: " + response);
-
-    // Parse JSON response
-    DynamicJsonDocument jsonDoc(1024);
-    DeserializationError error = deserializeJson(jsonDoc, response);
-
-    if (!error) {
-      // Extract transcribed text
-      response = jsonDoc["text"].as<String>();
-    } else {
-      Serial.print("JSON parsing error: ");
-      Serial.println(error.c_str());
-      response = "";
-    }
-  } else {
-    Serial.print("HTTP Error: ");
-    Serial.println(httpCode);
-    // Try to get error response content
-    String errorResponse = http.getString();
-    if (errorResponse.length() > 0) {
-      Serial.println("Error response: " + errorResponse);
-    }
-    response = "";
-  }
-  
-  http.end();
+  response = _postTranscription(nullptr, 0, fileData, fileSize);
+  free(fileData);
   return response;
 }
 
@@ -914,6 +1227,28 @@ void ArduinoGPTChat::initializeRecording(int micClkPin, int micWsPin, int micDat
   _isRecording = false;
 }
 
+/**
+ * @brief Set recording length limit
+ * @param seconds Maximum recording length (default 30)
+ *
+ * The recording buffer is reserved for this length on the next startRecording()
+ * and reused afterwards; recording stops storing samples when it is full
+ */
+void ArduinoGPTChat::setMaxRecordingSeconds(uint32_t seconds) {
+  if (seconds == 0) seconds = 1;
+  if (seconds == _maxRecordingSeconds) {
+    return;
+  }
+  _maxRecordingSeconds = seconds;
+
+  // Reallocate with the new size on next start
+  if (!_isRecording && _audioBuffer != nullptr) {
+    AudioMemory::release(_audioBuffer);
+    _audioBuffer = nullptr;
+    _audioCapacity = 0;
+  }
+}
+
 /**
  * @brief Start recording
  * @return Whether recording started successfully
@@ -924,11 +1259,33 @@ bool ArduinoGPTChat::startRecording() {
   if (_isRecording) {
     return false; // Already recording
   }
+  TurnMetrics::beginTurn();
 
   Serial.println("Starting recording...");
 
+  // Reserve recording buffer once (prefer PSRAM), halve the length until it fits
+  if (_audioBuffer == nullptr) {
+    size_t wanted = (size_t)_sampleRate * _maxRecordingSeconds;
+    size_t samples = wanted;
+    while (_audioBuffer == nullptr && samples >= (size_t)_sampleRate) {
+      _audioBuffer = (int16_t*)AudioMemory::alloc(samples * sizeof(int16_t), AUDIO_MEM_PSRAM_PREFERRED);
+      if (_audioBuffer == nullptr) {
+        samples /= 2;
+      }
+    }
+    if (_audioBuffer == nullptr) {
+      Serial.println("Failed to allocate recording buffer!");
+      return false;
+    }
+    _audioCapacity = samples;
+    if (samples < wanted) {
+      Serial.printf("Recording limited to %d seconds by available memory\n", (int)(samples / _sampleRate));
+    }
+  }
+
   // Clear audio buffer
-  _audioBuffer.clear();
+  _recordedSamples = 0;
+  _bufferFullLogged = false;
 
   // Set microphone I2S pins
   _recordingI2S.setPins(_micClkPin, _micWsPin, -1, _micDataPin);
@@ -946,32 +1303,35 @@ bool ArduinoGPTChat::startRecording() {
 /**
  * @brief Continue recording
  *
- * Read audio samples from I2S and add to buffer
+ * Read audio samples from I2S directly into the recording buffer
  * Should be called in loop to continue recording
  */
 void ArduinoGPTChat::continueRecording() {
   if (!_isRecording) return;
 
-  int16_t samples[_bufferSize];
-
-  // Read audio samples
-  size_t bytesRead = _recordingI2S.readBytes((char*)samples, _bufferSize * sizeof(int16_t));
-
-  if (bytesRead > 0) {
-    // Add samples to buffer
-    size_t samplesRead = bytesRead / sizeof(int16_t);
-    for (size_t i = 0; i < samplesRead; i++) {
-      _audioBuffer.push_back(samples[i]);
+  size_t room = _audioCapacity - _recordedSamples;
+  if (room == 0) {
+    // Buffer full: keep draining I2S so the DMA never overflows, drop samples
+    int16_t samples[_bufferSize];
+    _recordingI2S.readBytes((char*)samples, _bufferSize * sizeof(int16_t));
+    if (!_bufferFullLogged) {
+      Serial.println("Recording buffer full, further audio is dropped");
+      _bufferFullLogged = true;
     }
+    return;
   }
+
+  size_t toRead = min(room, (size_t)_bufferSize);
+  size_t bytesRead = _recordingI2S.readBytes((char*)(_audioBuffer + _recordedSamples), toRead * sizeof(int16_t));
+  _recordedSamples += bytesRead / sizeof(int16_t);
 }
 
 /**
  * @brief Stop recording and process audio
  * @return Transcribed text
  *
- * Stop I2S recording, convert audio data to WAV format,
- * then process audio using speech-to-text function
+ * Stop I2S recording, then upload the recorded PCM as WAV
+ * using the speech-to-text function
  */
 String ArduinoGPTChat::stopRecordingAndProcess() {
   if (!_isRecording) {
@@ -982,30 +1342,16 @@ String ArduinoGPTChat::stopRecordingAndProcess() {
   _recordingI2S.end();
   _isRecording = false;
 
-  if (_audioBuffer.empty()) {
+  if (_recordedSamples == 0) {
     Serial.println("No audio data recorded!");
     return "";
   }
 
-  Serial.println("Recording completed, samples: " + String(_audioBuffer.size()));
+  Serial.println("Recording completed, samples: " + String(_recordedSamples));
   Serial.println("Converting speech to text...");
 
-  // Convert audio buffer to WAV format
-  uint8_t* wavBuffer = createWAVBuffer(_audioBuffer.data(), _audioBuffer.size());
-  size_t wavSize = calculateWAVSize(_audioBuffer.size());
-
-  if (wavBuffer == nullptr) {
-    Serial.println("Failed to create WAV buffer!");
-    return "";
-  }
-
-  // Convert speech to text
-  String transcribedText = speechToTextFromBuffer(wavBuffer, wavSize);
-
-  // Free buffer memory
-  free(wavBuffer);
-
-  return transcribedText;
+  // Upload straight from the recording buffer, no WAV copy
+  return speechToTextFromPCM(_audioBuffer, _recordedSamples);
 }
 
 /**
@@ -1021,29 +1367,19 @@ bool ArduinoGPTChat::isRecording() {
  * @return Number of audio samples
  */
 size_t ArduinoGPTChat::getRecordedSampleCount() {
-  return _audioBuffer.size();
+  return _recordedSamples;
 }
 
 // WAV file handling functions
 /**
- * @brief Create WAV file buffer
- * @param samples Audio sample data
- * @param numSamples Number of samples
- * @return WAV format data buffer
+ * @brief Write WAV file header
+ * @param header Output buffer (WAV_HEADER_SIZE bytes)
+ * @param numSamples Number of samples that follow the header
  *
- * Convert 16-bit PCM audio samples to WAV format file
- * Contains standard WAV file header and audio data
+ * Standard 44-byte header for 16-bit mono PCM at the recording sample rate
  */
-uint8_t* ArduinoGPTChat::createWAVBuffer(int16_t* samples, size_t numSamples) {
-  size_t wavSize = calculateWAVSize(numSamples);
-  uint8_t* wavBuffer = (uint8_t*)malloc(wavSize);
-
-  if (wavBuffer == nullptr) {
-    return nullptr;
-  }
-
-  // WAV file header
-  uint8_t header[44] = {
+void ArduinoGPTChat::writeWAVHeader(uint8_t* header, size_t numSamples) {
+  static const uint8_t templ[WAV_HEADER_SIZE] = {
     'R','I','F','F',  // ChunkID
     0,0,0,0,          // ChunkSize (to be filled)
     'W','A','V','E',  // Format
@@ -1058,9 +1394,10 @@ uint8_t* ArduinoGPTChat::createWAVBuffer(int16_t* samples, size_t numSamples) {
     'd','a','t','a',  // Subchunk2ID
     0,0,0,0           // Subchunk2Size (to be filled)
   };
+  memcpy(header, templ, WAV_HEADER_SIZE);
 
   // Fill in values
-  uint32_t chunkSize = wavSize - 8;
+  uint32_t chunkSize = calculateWAVSize(numSamples) - 8;
   uint32_t sampleRate = _sampleRate;
   uint32_t byteRate = sampleRate * 2; // 16-bit mono
   uint32_t dataSize = numSamples * 2;
@@ -1069,14 +1406,6 @@ uint8_t* ArduinoGPTChat::createWAVBuffer(int16_t* samples, size_t numSamples) {
   memcpy(&header[24], &sampleRate, 4);
   memcpy(&header[28], &byteRate, 4);
   memcpy(&header[40], &dataSize, 4);
-
-  // Copy file header
-  memcpy(wavBuffer, header, 44);
-
-  // Copy audio data
-  memcpy(wavBuffer + 44, samples, numSamples * 2);
-
-  return wavBuffer;
 }
 
 /**
@@ -1088,7 +1417,7 @@ uint8_t* ArduinoGPTChat::createWAVBuffer(int16_t* samples, size_t numSamples) {
  * Header 44 bytes + 16-bit sample data (2 bytes per sample)
  */
 size_t ArduinoGPTChat::calculateWAVSize(size_t numSamples) {
-  return 44 + (numSamples * 2); // Header + 16-bit samples
+  return WAV_HEADER_SIZE + (numSamples * 2); // Header + 16-bit samples
 }
 
 /**
@@ -1114,127 +1443,132 @@ String ArduinoGPTChat::_buildMultipartForm(const char* audioFilePath, String bou
  * no need to save to file first, suitable for real-time processing
  */
 String ArduinoGPTChat::speechToTextFromBuffer(uint8_t* audioBuffer, size_t bufferSize) {
-  String response = "";
-  
   if (audioBuffer == NULL || bufferSize == 0) {
     Serial.println("Invalid audio buffer or size!");
-    return response;
+    return "";
   }
-  
+
   Serial.println("Audio buffer size: " + String(bufferSize) + " bytes");
-  
+  return _postTranscription(nullptr, 0, audioBuffer, bufferSize);
+}
+
+/**
+ * @brief Speech to text from raw PCM samples
+ * @param samples 16-bit mono PCM at the recording sample rate
+ * @param numSamples Number of samples
+ * @return Transcribed text
+ *
+ * The WAV header is generated on the fly and the samples are uploaded
+ * in place, so only the recording itself has to fit in memory
+ */
+String ArduinoGPTChat::speechToTextFromPCM(const int16_t* samples, size_t numSamples) {
+  if (samples == nullptr || numSamples == 0) {
+    Serial.println("Invalid audio buffer or size!");
+    return "";
+  }
+
+  uint8_t header[WAV_HEADER_SIZE];
+  writeWAVHeader(header, numSamples);
+
+  Serial.println("Audio buffer size: " + String(calculateWAVSize(numSamples)) + " bytes");
+  return _postTranscription(header, WAV_HEADER_SIZE, (const uint8_t*)samples, numSamples * sizeof(int16_t));
+}
+
+struct TranscriptionRequestBody {
+  const String* preamble;
+  const uint8_t* header;
+  size_t headerSize;
+  const uint8_t* audio;
+  size_t audioSize;
+  const String* trailer;
+};
+
+bool ArduinoGPTChat::_writeTranscriptionBody(BufferedSocketPrint& out, void* context) {
+  TranscriptionRequestBody* body = (TranscriptionRequestBody*)context;
+  out.print(*body->preamble);
+  out.write(body->header, body->headerSize);
+  out.write(body->audio, body->audioSize);
+  out.print(*body->trailer);
+  return true;
+}
+
+/**
+ * @brief Upload audio to the transcription endpoint
+ * @param header Bytes sent before the audio (WAV header), may be nullptr
+ * @param headerSize Header size
+ * @param audio Audio file data (or PCM following header)
+ * @param audioSize Audio data size
+ * @return Transcribed text
+ *
+ * The multipart body is written from the caller's buffers over a pooled
+ * connection, nothing is copied
+ */
+String ArduinoGPTChat::_postTranscription(const uint8_t* header, size_t headerSize, const uint8_t* audio, size_t audioSize) {
+  String response = "";
+
   // Use same boundary as Python example
   String boundary = "wL36Yn8afVp8Ag7AmP8qZ0SA4n1v9T";
 
   // Build multipart/form-data request body parts
   // File part
-  String part1 = "--" + boundary + "\r\n";
-  part1 += "Content-Disposition: form-data; name=file; filename=audio.wav\r\n";
-  part1 += "Content-Type: audio/wav\r\n\r\n";
+  String preamble = "--" + boundary + "\r\n";
+  preamble += "Content-Disposition: form-data; name=file; filename=audio.wav\r\n";
+  preamble += "Content-Type: audio/wav\r\n\r\n";
 
   // Model part
-  String part2 = "\r\n--" + boundary + "\r\n";
-  part2 += "Content-Disposition: form-data; name=model;\r\n";
-  part2 += "Content-Type: text/plain\r\n\r\n";
-  part2 += "whisper-1";
+  String trailer = "\r\n--" + boundary + "\r\n";
+  trailer += "Content-Disposition: form-data; name=model;\r\n";
+  trailer += "Content-Type: text/plain\r\n\r\n";
+  trailer += "whisper-1";
 
   // Prompt part (matching Python example)
-  String part3 = "\r\n--" + boundary + "\r\n";
-  part3 += "Content-Disposition: form-data; name=prompt;\r\n";
-  part3 += "Content-Type: text/plain\r\n\r\n";
-  part3 += "eiusmod nulla";
+  trailer += "\r\n--" + boundary + "\r\n";
+  trailer += "Content-Disposition: form-data; name=prompt;\r\n";
+  trailer += "Content-Type: text/plain\r\n\r\n";
+  trailer += "eiusmod nulla";
 
   // Response format part
-  String part4 = "\r\n--" + boundary + "\r\n";
-  part4 += "Content-Disposition: form-data; name=response_format;\r\n";
-  part4 += "Content-Type: text/plain\r\n\r\n";
-  part4 += "json";
+  trailer += "\r\n--" + boundary + "\r\n";
+  trailer += "Content-Disposition: form-data; name=response_format;\r\n";
+  trailer += "Content-Type: text/plain\r\n\r\n";
+  trailer += "json";
 
   // Temperature part
-  String part5 = "\r\n--" + boundary + "\r\n";
-  part5 += "Content-Disposition: form-data; name=temperature;\r\n";
-  part5 += "Content-Type: text/plain\r\n\r\n";
-  part5 += "0";
+  trailer += "\r\n--" + boundary + "\r\n";
+  trailer += "Content-Disposition: form-data; name=temperature;\r\n";
+  trailer += "Content-Type: text/plain\r\n\r\n";
+  trailer += "0";
 
   // Language part (matching Python example)
-  String part6 = "\r\n--" + boundary + "\r\n";
-  part6 += "Content-Disposition: form-data; name=language;\r\n";
-  part6 += "Content-Type: text/plain\r\n\r\n";
-  part6 += "";
+  trailer += "\r\n--" + boundary + "\r\n";
+  trailer += "Content-Disposition: form-data; name=language;\r\n";
+  trailer += "Content-Type: text/plain\r\n\r\n";
+  trailer += "";
 
   // End boundary
-  String part7 = "\r\n--" + boundary + "--\r\n";
-
-  // Calculate total content length
-  size_t totalLength = part1.length() + bufferSize + part2.length() + part3.length() +
-                      part4.length() + part5.length() + part6.length() + part7.length();
-  
-  // Initialize HTTP client
-  HTTPClient http;
-  http.begin(_sttApiUrl);
-
-  // Set request headers
-  http.addHeader("Content-Type", "multipart/form-data; boundary=" + boundary);
-  http.addHeader("Authorization", "Bearer " + String(_apiKey));
-  http.addHeader("Content-Length", String(totalLength));
-
-  // Merge all parts into complete request body
-  Serial.println("Preparing request body...");
-  uint8_t* requestBody = (uint8_t*)malloc(totalLength);
-  if (!requestBody) {
-    Serial.println("Failed to allocate memory for request body!");
-    return response;
-  }
-
-  // Copy each part to request body
-  size_t pos = 0;
-
-  // Copy part1
-  memcpy(requestBody + pos, part1.c_str(), part1.length());
-  pos += part1.length();
-
-  // Copy audio data
-  memcpy(requestBody + pos, audioBuffer, bufferSize);
-  pos += bufferSize;
-
-  // Copy remaining parts
-  memcpy(requestBody + pos, part2.c_str(), part2.length());
-  pos += part2.length();
+  trailer += "\r\n--" + boundary + "--\r\n";
 
-  memcpy(requestBody + pos, part3.c_str(), part3.length());
-  pos += part3.length();
+  const String contentType = "multipart/form-data; boundary=" + boundary;
+  TranscriptionRequestBody body = {&preamble, header, headerSize, audio, audioSize, &trailer};
+  const size_t length = preamble.length() + headerSize + audioSize + trailer.length();
 
-  memcpy(requestBody + pos, part4.c_str(), part4.length());
-  pos += part4.length();
-
-  memcpy(requestBody + pos, part5.c_str(), part5.length());
-  pos += part5.length();
-
-  memcpy(requestBody + pos, part6.c_str(), part6.length());
-  pos += part6.length();
-
-  memcpy(requestBody + pos, part7.c_str(), part7.length());
-  pos += part7.length();
-
-  // Confirm total length matches
-  if (pos != totalLength) {
-    Serial.println("Warning: actual body length doesn't match calculated length");
-    Serial.println("Calculated: " + String(totalLength) + ", Actual: " + String(pos));
-  }
-
-  // Send request
+  // Send request, body is written to the socket straight from the buffers
   Serial.println("Sending STT request...");
-  int httpCode = http.POST(requestBody, totalLength);
+  HttpBodyReader reader;
+  char line[256];
+  int httpCode = _sendRequest(_sttApiUrl, contentType.c_str(), nullptr, length, _writeTranscriptionBody, &body, reader,
+                              line, sizeof(line));
 
-  // Free request body memory
-  free(requestBody);
-  
   Serial.print("HTTP Response Code: ");
   Serial.println(httpCode);
-  
+  if (httpCode == 0) {
+    return response;
+  }
+  reader.timeoutMs = SSE_IDLE_TIMEOUT_MS;
+  response = reader.readString();
+  _releaseConnection(reader.client, reader.reusable());
+
   if (httpCode == 200) {
-    // Get response body
-    response = http.getString();
     Serial.println("Got STT response: " + response);
 
     // Parse JSON response
@@ -1244,6 +1578,7 @@ String ArduinoGPTChat::speechToTextFromBuffer(uint8_t* audioBuffer, size_t buffe
     if (!error) {
       // Extract transcribed text
       response = jsonDoc["text"].as<String>();
+      TurnMetrics::mark(TURN_ASR_FINAL);
     } else {
       Serial.print("JSON parsing error: ");
       Serial.println(error.c_str());
@@ -1252,14 +1587,11 @@ String ArduinoGPTChat::speechToTextFromBuffer(uint8_t* audioBuffer, size_t buffe
   } else {
     Serial.print("HTTP Error: ");
     Serial.println(httpCode);
-    // Try to get error response content
-    String errorResponse = http.getString();
-    if (errorResponse.length() > 0) {
-      Serial.println("Error response: " + errorResponse);
+    if (response.length() > 0) {
+      Serial.println("Error response: " + response);
     }
     response = "";
   }
-  
-  http.end();
+
   return response;
 }
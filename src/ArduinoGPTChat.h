@@ -3,30 +3,50 @@
 
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include <WiFiClientSecure.h>
 #include <ArduinoJson.h>
 #include "Audio.h"
 #include "FS.h"
 #include "SD.h"
 #include "ESP_I2S.h"
-#include <vector>
+#include "AudioMemory.h"
+#include "TurnMetrics.h"
+
+struct HttpBodyReader;
+class BufferedSocketPrint;
 
 class ArduinoGPTChat {
   public:
+    /**
+     * @brief Streamed token callback
+     * @param token Text fragment of the reply, line breaks included
+     * @param userData Pointer passed to sendMessageStream()
+     */
+    typedef void (*StreamTokenCallback)(const char* token, void* userData);
+
     ArduinoGPTChat(const char* apiKey = nullptr, const char* apiBaseUrl = nullptr);
+    ~ArduinoGPTChat();
     void setApiConfig(const char* apiKey = nullptr, const char* apiBaseUrl = nullptr);
     void setSystemPrompt(const char* systemPrompt);
     void enableMemory(bool enable);
     void clearMemory();
+    void setKeepAlive(bool enable);  // Reuse the TLS connection between requests (default on)
+    void closeConnections();         // Drop pooled connections, frees their TLS buffers
     String sendMessage(String message);
+    bool sendMessageStream(String message, StreamTokenCallback onToken, void* userData = nullptr);
     bool textToSpeech(String text);
     String speechToText(const char* audioFilePath);
     String speechToTextFromBuffer(uint8_t* audioBuffer, size_t bufferSize);
+    String speechToTextFromPCM(const int16_t* samples, size_t numSamples);
     String sendImageMessage(const char* imageFilePath, String question);
+    String sendImageMessage(const uint8_t* image, size_t imageSize, String question,
+                            const char* mimeType = "image/jpeg");  // In-memory image, e.g. an esp_camera fb
 
     // Recording control functions
     void initializeRecording(int micClkPin, int micWsPin, int micDataPin, int sampleRate = 8000,
                              i2s_mode_t mode = I2S_MODE_STD, i2s_data_bit_width_t bitWidth = I2S_DATA_BIT_WIDTH_16BIT,
                              i2s_slot_mode_t slotMode = I2S_SLOT_MODE_MONO, i2s_std_slot_mask_t slotMask = I2S_STD_SLOT_LEFT);
+    void setMaxRecordingSeconds(uint32_t seconds);
     bool startRecording();
     void continueRecording();
     String stopRecordingAndProcess();
@@ -42,24 +62,69 @@ class ArduinoGPTChat {
     String _ttsApiUrl;
     String _sttApiUrl;
     String _systemPrompt;
-    String _buildPayload(String message);
+    void _writePayload(Print& out, const String& message, bool stream);
+    void _writeRequestHead(Print& out, const String& host, const String& path, const char* contentType,
+                           const char* accept, size_t contentLength);
+    typedef bool (*BodyWriter)(BufferedSocketPrint& out, void* context);  // false aborts the request
+    int _sendRequest(const String& url, const char* contentType, const char* accept, size_t length,
+                     BodyWriter writeBody, void* context, HttpBodyReader& reader, char* line, size_t lineSize);
+    int _postChat(const String& message, bool stream, HttpBodyReader& reader, char* line);
+    static bool _writeChatBody(BufferedSocketPrint& out, void* context);
+    static bool _writeTranscriptionBody(BufferedSocketPrint& out, void* context);
+    static bool _writeImageBody(BufferedSocketPrint& out, void* context);
     String _processResponse(String response);
+    void _saveToHistory(const String& message, const String& reply);
+    bool _parseUrl(const String& url, String& host, uint16_t& port, String& path, bool& secure);
     String _buildTTSPayload(String text);
     String _buildMultipartForm(const char* audioFilePath, String boundary);
+    String _postImage(File* file, const uint8_t* image, size_t imageSize, const char* mimeType, const String& question);
+    String _postTranscription(const uint8_t* header, size_t headerSize, const uint8_t* audio, size_t audioSize);
     void _updateApiUrls();
 
-    // Conversation memory
+    // Conversation memory, a ring that overwrites the oldest pair in place
+    static const int MAX_HISTORY_PAIRS = 5;      // Maximum conversation pairs to keep
     bool _memoryEnabled = false;
-    std::vector<std::pair<String, String>> _conversationHistory;  // pair<user_msg, assistant_msg>
-    const int _maxHistoryPairs = 5;  // Maximum conversation pairs to keep
+    String _historyUser[MAX_HISTORY_PAIRS];      // User messages, oldest at _historyStart
+    String _historyAssistant[MAX_HISTORY_PAIRS]; // Matching assistant replies
+    int _historyStart = 0;
+    int _historyCount = 0;
+
+    // Persistent connections (HTTP keep-alive), one per host
+    struct PooledConnection {
+      WiFiClientSecure secureClient;
+      WiFiClient plainClient;
+      String host;                   // Empty: slot unused
+      uint16_t port = 0;
+      bool secure = false;
+      unsigned long lastUsed = 0;    // millis() when the last response was complete
+      WiFiClient* client() { return secure ? &secureClient : &plainClient; }
+    };
+    static const int CONNECTION_POOL_SIZE = 2;
+    static const unsigned long KEEP_ALIVE_IDLE_MS = 50000;  // Servers drop idle sockets, reconnect instead
+    static const unsigned long DRAIN_TIMEOUT_MS = 1000;     // Wait for the end of a body to keep the socket
+    static const size_t IMAGE_READ_CHUNK = 3072;            // Image bytes per base64 block (4 KB socket write)
+    PooledConnection _pool[CONNECTION_POOL_SIZE];
+    bool _keepAlive = true;
+    WiFiClient* _acquireConnection(const String& host, uint16_t port, bool secure, bool& reused);
+    void _releaseConnection(WiFiClient* client, bool reusable);
+
+    // Streaming (SSE) response handling
+    static const size_t SSE_LINE_BUFFER_SIZE = 2048;  // Longest SSE line kept, longer lines are dropped
+    static const unsigned long SSE_FIRST_BYTE_TIMEOUT_MS = 30000;  // Wait for response headers
+    static const unsigned long SSE_IDLE_TIMEOUT_MS = 15000;  // Max gap between streamed bytes
 
     // WAV file handling
-    uint8_t* createWAVBuffer(int16_t* samples, size_t numSamples);
     size_t calculateWAVSize(size_t numSamples);
+    void writeWAVHeader(uint8_t* header, size_t numSamples);
+    static const size_t WAV_HEADER_SIZE = 44;
 
-    // Recording variables
+    // Recording variables (buffer is reserved once and reused, PSRAM preferred)
     I2SClass _recordingI2S;
-    std::vector<int16_t> _audioBuffer;
+    int16_t* _audioBuffer = nullptr;       // Recording buffer
+    size_t _audioCapacity = 0;             // Recording buffer size in samples
+    size_t _recordedSamples = 0;           // Samples recorded
+    uint32_t _maxRecordingSeconds = 30;    // Recording length limit
+    bool _bufferFullLogged = false;        // Limit reached message printed
     int _sampleRate;
     int _micClkPin, _micWsPin, _micDataPin;
     const int _bufferSize = 512;
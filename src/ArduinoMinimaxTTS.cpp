@@ -23,7 +23,10 @@ ArduinoMinimaxTTS::ArduinoMinimaxTTS(const char* apiKey, const char* groupId, Au
  * @brief Destructor
  */
 ArduinoMinimaxTTS::~ArduinoMinimaxTTS() {
-  // Cleanup resources
+  if (_streamBuffer != nullptr) {
+    AudioMemory::release(_streamBuffer);
+    _streamBuffer = nullptr;
+  }
 }
 
 /**
@@ -121,29 +124,28 @@ void ArduinoMinimaxTTS::setModel(const char* model) {
 }
 
 /**
- * @brief Save audio data directly to file
- * @param text Text to synthesize
- * @param filepath File path to save
- * @return Success status
+ * @brief Enable direct streaming playback
+ * @param enable true: decode the hex response straight into Audio, skip URL mode
  */
-bool ArduinoMinimaxTTS::saveAudioToFile(const String& text, const char* filepath) {
-  HTTPClient http;
-  http.setTimeout(30000);  // 30 second timeout
-  
-  // Add GroupId parameter
-  String urlWithParams = String(_url) + "?GroupId=" + _groupId;
-  http.begin(urlWithParams);
-  http.addHeader("Content-Type", "application/json");
-  
-  String token_key = String("Bearer ") + _apiKey;
-  http.addHeader("Authorization", token_key);
+void ArduinoMinimaxTTS::setDirectStreaming(bool enable) {
+  _directStreaming = enable;
+}
 
-  // Create JSON document
+/**
+ * @brief Build the t2a_v2 request body
+ * @param text Text to synthesize
+ * @param urlOutput Ask for an audio URL instead of hex data
+ * @return Serialized JSON
+ */
+String ArduinoMinimaxTTS::buildRequestJson(const String& text, bool urlOutput) {
   DynamicJsonDocument doc(1024);
   doc["model"] = _model;
   doc["text"] = text;
-  doc["stream"] = false;  // Non-streaming
-  
+  doc["stream"] = false;  // Non-streaming, the single response body is still read as it arrives
+  if (urlOutput) {
+    doc["output_format"] = "url";  // Return URL instead of hex data
+  }
+
   // voice_setting object
   JsonObject voice_setting = doc.createNestedObject("voice_setting");
   voice_setting["voice_id"] = _voiceId;
@@ -153,7 +155,7 @@ bool ArduinoMinimaxTTS::saveAudioToFile(const String& text, const char* filepath
   if (_emotion != nullptr && strlen(_emotion) > 0) {
     voice_setting["emotion"] = _emotion;
   }
-  
+
   // audio_setting object
   JsonObject audio_setting = doc.createNestedObject("audio_setting");
   audio_setting["sample_rate"] = _sampleRate;
@@ -161,9 +163,30 @@ bool ArduinoMinimaxTTS::saveAudioToFile(const String& text, const char* filepath
   audio_setting["format"] = _audioFormat;
   audio_setting["channel"] = _channel;
 
-  // Serialize JSON
   String jsonString;
   serializeJson(doc, jsonString);
+  return jsonString;
+}
+
+/**
+ * @brief Save audio data directly to file
+ * @param text Text to synthesize
+ * @param filepath File path to save
+ * @return Success status
+ */
+bool ArduinoMinimaxTTS::saveAudioToFile(const String& text, const char* filepath) {
+  HTTPClient http;
+  http.setTimeout(30000);  // 30 second timeout
+  
+  // Add GroupId parameter
+  String urlWithParams = String(_url) + "?GroupId=" + _groupId;
+  http.begin(urlWithParams);
+  http.addHeader("Content-Type", "application/json");
+  
+  String token_key = String("Bearer ") + _apiKey;
+  http.addHeader("Authorization", token_key);
+
+  String jsonString = buildRequestJson(text, false);
   
   Serial.println("[MiniMax TTS] Sending request:");
   Serial.println(jsonString);
@@ -318,29 +341,7 @@ bool ArduinoMinimaxTTS::getAudioDataToPSRAM(const String& text, uint8_t** outBuf
   String token_key = String("Bearer ") + _apiKey;
   http.addHeader("Authorization", token_key);
 
-  // Create request JSON
-  DynamicJsonDocument doc(1024);
-  doc["model"] = _model;
-  doc["text"] = text;
-  doc["stream"] = false;
-  
-  JsonObject voice_setting = doc.createNestedObject("voice_setting");
-  voice_setting["voice_id"] = _voiceId;
-  voice_setting["speed"] = _speed;
-  voice_setting["vol"] = _volume;
-  voice_setting["pitch"] = _pitch;
-  if (_emotion != nullptr && strlen(_emotion) > 0) {
-    voice_setting["emotion"] = _emotion;
-  }
-  
-  JsonObject audio_setting = doc.createNestedObject("audio_setting");
-  audio_setting["sample_rate"] = _sampleRate;
-  audio_setting["bitrate"] = _bitrate;
-  audio_setting["format"] = _audioFormat;
-  audio_setting["channel"] = _channel;
-
-  String jsonString;
-  serializeJson(doc, jsonString);
+  String jsonString = buildRequestJson(text, false);
   
   Serial.println("[MiniMax TTS] Sending request (PSRAM mode)");
 
@@ -447,6 +448,291 @@ bool ArduinoMinimaxTTS::getAudioDataToPSRAM(const String& text, uint8_t** outBuf
   return totalDecoded > 0;
 }
 
+// Hex digit value for 0-9, a-f, A-F (bit 6 is set for letters only)
+static inline uint8_t hexNibble(uint8_t c) {
+  return (c & 0x0F) + (c >> 6) * 9;
+}
+
+// Chunked transfer encoding parser states
+enum {
+  CHUNK_SIZE,      // Hex chunk size
+  CHUNK_EXT,       // Rest of the size line (extensions)
+  CHUNK_DATA,      // Chunk payload
+  CHUNK_DATA_END,  // CRLF after the payload
+  CHUNK_DONE       // Last (empty) chunk seen
+};
+
+/**
+ * @brief Strip chunked transfer framing in place
+ * @param data Raw body bytes, payload is moved to the front
+ * @param len Number of raw bytes
+ * @return Payload bytes at the front of data
+ */
+size_t ArduinoMinimaxTTS::dechunk(uint8_t* data, size_t len) {
+  if (!_chunked) {
+    return len;
+  }
+
+  size_t out = 0;
+  size_t i = 0;
+  while (i < len) {
+    switch (_chunkState) {
+      case CHUNK_DATA: {
+        size_t n = min(len - i, _chunkRemaining);
+        memmove(data + out, data + i, n);
+        out += n;
+        i += n;
+        _chunkRemaining -= n;
+        if (_chunkRemaining == 0) {
+          _chunkState = CHUNK_DATA_END;
+        }
+        break;
+      }
+      case CHUNK_SIZE: {
+        uint8_t c = data[i++];
+        if (isxdigit(c)) {
+          _chunkRemaining = (_chunkRemaining << 4) | hexNibble(c);
+        } else if (c == '\n') {
+          _chunkState = _chunkRemaining > 0 ? CHUNK_DATA : CHUNK_DONE;
+        } else if (c != '\r') {
+          _chunkState = CHUNK_EXT;
+        }
+        break;
+      }
+      case CHUNK_EXT:
+        if (data[i++] == '\n') {
+          _chunkState = _chunkRemaining > 0 ? CHUNK_DATA : CHUNK_DONE;
+        }
+        break;
+      case CHUNK_DATA_END:
+        if (data[i++] == '\n') {
+          _chunkState = CHUNK_SIZE;
+          _chunkRemaining = 0;
+        }
+        break;
+      default:
+        i = len;  // Trailers after the last chunk are ignored
+        break;
+    }
+  }
+  return out;
+}
+
+/**
+ * @brief Find the "audio" value and hex-decode it in place
+ * @param data Body bytes, decoded audio is written to the front (never ahead of the read position)
+ * @param len Number of body bytes
+ * @return Decoded audio bytes at the front of data
+ */
+size_t ArduinoMinimaxTTS::decodeAudioHex(uint8_t* data, size_t len) {
+  static const char AUDIO_KEY[] = "\"audio\":\"";
+  static const uint8_t AUDIO_KEY_LEN = sizeof(AUDIO_KEY) - 1;
+
+  size_t out = 0;
+  for (size_t i = 0; i < len && !_audioDone; i++) {
+    uint8_t c = data[i];
+    if (!_inAudio) {
+      if (c == AUDIO_KEY[_audioKeyMatch]) {
+        if (++_audioKeyMatch == AUDIO_KEY_LEN) {
+          _inAudio = true;
+        }
+      } else {
+        _audioKeyMatch = (c == AUDIO_KEY[0]) ? 1 : 0;
+      }
+      continue;
+    }
+
+    if (c == '"') {
+      _audioDone = true;  // Closing quote
+    } else if (isxdigit(c)) {
+      if (_pendingNibble < 0) {
+        _pendingNibble = hexNibble(c);
+      } else {
+        data[out++] = (_pendingNibble << 4) | hexNibble(c);
+        _pendingNibble = -1;
+      }
+    }
+  }
+  return out;
+}
+
+/**
+ * @brief Write decoded audio into Audio's input buffer, running the Audio loop while it is full
+ * @return false if playback stopped or no space became free in time
+ */
+bool ArduinoMinimaxTTS::pushToAudio(const uint8_t* data, size_t len) {
+  unsigned long start = millis();
+  while (len > 0) {
+    size_t n = _audio->writeBuffer(data, len);
+    data += n;
+    len -= n;
+    if (len == 0) {
+      break;
+    }
+    if (!_audio->isRunning()) {
+      Serial.println("[MiniMax TTS] Playback stopped, download aborted");
+      return false;
+    }
+    if (n > 0) {
+      start = millis();
+    } else if (millis() - start > STREAM_TIMEOUT_MS) {
+      Serial.println("[MiniMax TTS] Audio buffer stayed full, download aborted");
+      return false;
+    }
+    _audio->loop();  // Playback drains the buffer while we wait
+    delay(1);
+  }
+  _audio->loop();  // Start the stream as soon as the first frame is in
+  return true;
+}
+
+/**
+ * @brief Synthesize and play while downloading: hex audio is decoded in place and pushed into Audio
+ * @param text Text to synthesize
+ * @param started Set to true once playback was started (no fallback may follow then)
+ * @return Success status
+ */
+bool ArduinoMinimaxTTS::synthesizeAndStream(const String& text, bool* started) {
+  *started = false;
+  if (_streamBuffer == nullptr) {
+    _streamBuffer = (uint8_t*)AudioMemory::alloc(STREAM_CHUNK_SIZE, AUDIO_MEM_INTERNAL_PREFERRED);
+    if (_streamBuffer == nullptr) {
+      Serial.println("[MiniMax TTS] Stream buffer allocation failed");
+      return false;
+    }
+  }
+
+  HTTPClient http;
+  http.setTimeout(30000);
+
+  String urlWithParams = String(_url) + "?GroupId=" + _groupId;
+  http.begin(urlWithParams);
+  http.addHeader("Content-Type", "application/json");
+
+  String token_key = String("Bearer ") + _apiKey;
+  http.addHeader("Authorization", token_key);
+
+  // The raw body stream still carries the chunk framing, see dechunk()
+  const char* headerKeys[] = {"Transfer-Encoding"};
+  http.collectHeaders(headerKeys, 1);
+
+  String jsonString = buildRequestJson(text, false);
+
+  Serial.println("[MiniMax TTS] Sending request (streaming mode)");
+
+  int httpResponseCode = http.POST(jsonString);
+
+  if (httpResponseCode != 200) {
+    Serial.printf("[MiniMax TTS] HTTP request failed: %d\n", httpResponseCode);
+    if (http.connected()) {
+      String errorResponse = http.getString();
+      Serial.println("[MiniMax TTS] Error response:");
+      Serial.println(errorResponse);
+    }
+    http.end();
+    return false;
+  }
+
+  _chunked = http.header("Transfer-Encoding").equalsIgnoreCase("chunked");
+  _chunkState = CHUNK_SIZE;
+  _chunkRemaining = 0;
+  _audioKeyMatch = 0;
+  _inAudio = false;
+  _audioDone = false;
+  _pendingNibble = -1;
+
+  WiFiClient* stream = http.getStreamPtr();
+  String errorText = "";      // Start of a response without audio, for the log
+  size_t scanned = 0;
+  size_t totalDecoded = 0;
+  unsigned long lastData = millis();
+
+  while (!_audioDone && _chunkState != CHUNK_DONE) {
+    int avail = stream->available();
+    if (avail <= 0) {
+      if (!http.connected()) {
+        break;
+      }
+      if (millis() - lastData > STREAM_TIMEOUT_MS) {
+        Serial.println("[MiniMax TTS] Response stalled, download aborted");
+        break;
+      }
+      if (*started) {
+        _audio->loop();
+      }
+      delay(1);
+      continue;
+    }
+
+    int got = stream->read(_streamBuffer, min((size_t)avail, STREAM_CHUNK_SIZE));
+    if (got <= 0) {
+      continue;
+    }
+    lastData = millis();
+
+    size_t n = dechunk(_streamBuffer, got);
+    if (!_inAudio) {
+      scanned += n;
+      if (errorText.length() < 512) {
+        errorText.concat((const char*)_streamBuffer, min(n, (size_t)(512 - errorText.length())));
+      }
+    }
+
+    size_t decoded = decodeAudioHex(_streamBuffer, n);
+    if (_inAudio && !*started) {
+      Serial.println("[MiniMax TTS] Found audio data, streaming to Audio...");
+      TurnMetrics::mark(TURN_TTS_FIRST_BYTE);
+      if (!_audio->connecttobuffer(_audioFormat)) {
+        Serial.println("[MiniMax TTS] Audio playback start failed");
+        http.end();
+        return false;
+      }
+      *started = true;
+      if (_cache) {
+        _cache->beginWrite(_cacheKey, _audioFormat);  // Written through while it plays
+      }
+    }
+    if (decoded > 0) {
+      if (!pushToAudio(_streamBuffer, decoded)) {
+        if (_cache) {
+          _cache->abortWrite();
+        }
+        break;
+      }
+      if (_cache && _cache->writing()) {
+        _cache->write(_streamBuffer, decoded);
+      }
+      totalDecoded += decoded;
+    }
+
+    if (!_inAudio && scanned > 10000) {
+      break;  // Audio field is near the start of the response
+    }
+  }
+
+  http.end();
+
+  if (!*started) {
+    Serial.println("[MiniMax TTS] Audio field not found");
+    Serial.println(errorText);
+    return false;
+  }
+
+  // Only a phrase whose closing quote arrived is complete
+  if (_cache && _cache->writing()) {
+    if (_audioDone) {
+      _cache->commitWrite();
+    } else {
+      _cache->abortWrite();
+    }
+  }
+
+  // Whatever is left in Audio's buffer is played by the caller's Audio loop
+  _audio->finishBuffer();
+  Serial.printf("[MiniMax TTS] Streamed %d bytes\n", totalDecoded);
+  return totalDecoded > 0;
+}
+
 /**
  * @brief Synthesize and play using URL mode (fastest, no hex decoding needed)
  * @param text Text to synthesize
@@ -463,30 +749,7 @@ bool ArduinoMinimaxTTS::synthesizeAndPlayFromURL(const String& text) {
   String token_key = String("Bearer ") + _apiKey;
   http.addHeader("Authorization", token_key);
 
-  // Create request JSON - Key: set output_format to "url"
-  DynamicJsonDocument doc(1024);
-  doc["model"] = _model;
-  doc["text"] = text;
-  doc["stream"] = false;
-  doc["output_format"] = "url";  // Key parameter: return URL instead of hex data
-  
-  JsonObject voice_setting = doc.createNestedObject("voice_setting");
-  voice_setting["voice_id"] = _voiceId;
-  voice_setting["speed"] = _speed;
-  voice_setting["vol"] = _volume;
-  voice_setting["pitch"] = _pitch;
-  if (_emotion != nullptr && strlen(_emotion) > 0) {
-    voice_setting["emotion"] = _emotion;
-  }
-  
-  JsonObject audio_setting = doc.createNestedObject("audio_setting");
-  audio_setting["sample_rate"] = _sampleRate;
-  audio_setting["bitrate"] = _bitrate;
-  audio_setting["format"] = _audioFormat;
-  audio_setting["channel"] = _channel;
-
-  String jsonString;
-  serializeJson(doc, jsonString);
+  String jsonString = buildRequestJson(text, true);
   
   Serial.println("[MiniMax TTS] Sending request (URL mode - no decoding needed)");
 
@@ -549,6 +812,24 @@ bool ArduinoMinimaxTTS::synthesizeAndPlayFromURL(const String& text) {
   }
 }
 
+/**
+ * @brief Set phrase cache
+ * @param cache Opened cache, nullptr to disable
+ */
+void ArduinoMinimaxTTS::setCache(TTSPhraseCache* cache) {
+  _cache = cache;
+}
+
+/**
+ * @brief Phrase cache key: text plus every setting that changes the audio
+ */
+uint64_t ArduinoMinimaxTTS::cacheKey(const String& text) {
+  char extra[96];
+  snprintf(extra, sizeof(extra), "%s|%.2f|%s|%d|%d|%d", _model, _volume, _emotion ? _emotion : "",
+           _sampleRate, _bitrate, _channel);
+  return TTSPhraseCache::makeKey(text.c_str(), _voiceId, _speed, _pitch, _audioFormat, extra);
+}
+
 /**
  * @brief Synthesize text to speech and play (intelligently select optimal method)
  * @param text Text to synthesize
@@ -567,15 +848,42 @@ bool ArduinoMinimaxTTS::synthesizeAndPlay(const String& text) {
 
   Serial.println("[MiniMax TTS] Starting speech synthesis...");
   Serial.printf("[MiniMax TTS] Text: %s\n", text.c_str());
+  TurnMetrics::beginTurn(false);  // Part of the running turn if ASR began one
+
+  // Repeated phrase: play the cached file, no request at all
+  if (_cache) {
+    _cacheKey = cacheKey(text);
+    String cachedPath;
+    if (_cache->lookup(_cacheKey, cachedPath)) {
+      Serial.printf("[MiniMax TTS] Cache hit: %s\n", cachedPath.c_str());
+      if (_audio->connecttoFS(_cache->fileSystem(), cachedPath.c_str())) {
+        return true;
+      }
+      Serial.println("[MiniMax TTS] Cached file playback failed, synthesizing");
+    }
+  }
+
+  // Prefer URL mode (fastest, no decoding needed), skipped when misses are written to the cache
+  if (!_directStreaming && !_cache) {
+    Serial.println("[MiniMax TTS] Trying URL mode (fastest, no hex decoding needed)");
+    if (synthesizeAndPlayFromURL(text)) {
+      return true;
+    }
+    Serial.println("[MiniMax TTS] URL mode failed, trying direct streaming");
+  }
 
-  // Prefer URL mode (fastest, no decoding needed)
-  Serial.println("[MiniMax TTS] Trying URL mode (fastest, no hex decoding needed)");
-  if (synthesizeAndPlayFromURL(text)) {
+  // Decode the hex response while it downloads and play as it arrives
+  bool started = false;
+  if (synthesizeAndStream(text, &started)) {
     return true;
   }
-  
-  // URL mode failed, use fallback
-  Serial.println("[MiniMax TTS] URL mode failed, switching to fallback");
+  if (started) {
+    // Playback already began, replaying from a fallback would repeat the start
+    return false;
+  }
+
+  // Streaming failed, use fallback
+  Serial.println("[MiniMax TTS] Direct streaming failed, switching to fallback");
   
   // Initialize SPIFFS
   if (!SPIFFS.begin(true)) {
@@ -593,6 +901,10 @@ bool ArduinoMinimaxTTS::synthesizeAndPlay(const String& text) {
     size_t audioSize = 0;
     
     if (getAudioDataToPSRAM(text, &audioBuffer, &audioSize)) {
+      if (_cache) {
+        _cache->store(_cacheKey, _audioFormat, audioBuffer, audioSize);
+      }
+
       // Write from PSRAM to file
       File file = SPIFFS.open(tempFile, FILE_WRITE);
       if (file) {
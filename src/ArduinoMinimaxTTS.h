@@ -6,6 +6,7 @@
 #include <ArduinoJson.h>
 #include <SPIFFS.h>
 #include "Audio.h"
+#include "TTSPhraseCache.h"
 
 /**
  * @file ArduinoMinimaxTTS.h
@@ -106,6 +107,22 @@ class ArduinoMinimaxTTS {
      */
     void setModel(const char* model);
 
+    /**
+     * @brief Decode the hex audio of the response straight into Audio instead of trying URL mode first
+     * @param enable true: playback starts while the response is still downloading, no SPIFFS / PSRAM staging
+     * @details Streaming is also the first fallback when URL mode fails. The Audio loop must keep running
+     *          after synthesizeAndPlay() returns, as in the other modes.
+     */
+    void setDirectStreaming(bool enable);
+
+    /**
+     * @brief Serve repeated phrases from a phrase cache
+     * @param cache Opened cache (nullptr to disable), must outlive this object
+     * @details Hits play from the cache file without a request. Misses are synthesized with
+     *          direct streaming and written to the cache while they play, so URL mode is skipped.
+     */
+    void setCache(TTSPhraseCache* cache);
+
     /**
      * @brief Synthesize text to speech and play
      * @param text Text to synthesize
@@ -134,10 +151,33 @@ class ArduinoMinimaxTTS {
     // Audio player
     Audio* _audio;                                 // Audio object pointer
 
+    // Direct streaming (hex decoded in place and pushed into Audio's input buffer)
+    static const size_t STREAM_CHUNK_SIZE = 2048;  // Socket read size
+    static const unsigned long STREAM_TIMEOUT_MS = 10000;  // No data / no buffer space for this long = abort
+    bool _directStreaming = false;                 // Skip URL mode
+    uint8_t* _streamBuffer = nullptr;              // Read buffer, decoded in place
+    bool _chunked = false;                         // Response uses chunked transfer encoding
+    uint8_t _chunkState = 0;                       // Chunk framing parser state
+    size_t _chunkRemaining = 0;                    // Payload bytes left in the current chunk
+    uint8_t _audioKeyMatch = 0;                    // Progress matching "audio":"
+    bool _inAudio = false;                         // Inside the hex audio value
+    bool _audioDone = false;                       // Closing quote of the audio value seen
+    int16_t _pendingNibble = -1;                   // High nibble of a byte split across reads
+
+    // Phrase cache
+    TTSPhraseCache* _cache = nullptr;              // Optional, not owned
+    uint64_t _cacheKey = 0;                        // Key of the phrase being synthesized
+
     // Private helper methods
+    String buildRequestJson(const String& text, bool urlOutput);  // t2a_v2 request body
+    uint64_t cacheKey(const String& text);         // Phrase cache key for the current settings
     bool synthesizeAndPlayFromURL(const String& text);  // Use URL mode (fastest, no decoding needed)
     bool saveAudioToFile(const String& text, const char* filepath);  // Stream save audio to file
     bool getAudioDataToPSRAM(const String& text, uint8_t** outBuffer, size_t* outSize);  // Get audio data to PSRAM
+    bool synthesizeAndStream(const String& text, bool* started);  // Decode hex response straight into Audio
+    size_t dechunk(uint8_t* data, size_t len);     // Strip chunked transfer framing in place
+    size_t decodeAudioHex(uint8_t* data, size_t len);  // Find the audio value, hex-decode it in place
+    bool pushToAudio(const uint8_t* data, size_t len);  // Write into Audio's input buffer, wait for space
     uint8_t hexCharToByte(char high, char low);    // Hex character to byte
 };
 
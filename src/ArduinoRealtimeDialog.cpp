@@ -15,20 +15,31 @@ ArduinoRealtimeDialog::ArduinoRealtimeDialog(const char* appId, const char* acce
   // Delay memory allocation until after WebSocket connection
   // This leaves enough heap memory for SSL handshake
   _sendBuffer = nullptr;
-  _ttsBuffer = nullptr;
+
+  // Frame buffers are allocated by the first send, the message buffer grows with the largest response
+  _ws.setMessageLimit(WS_MAX_MESSAGE, AUDIO_MEM_PSRAM_PREFERRED);
+  _ws.onMessage(wsMessage, this);
+}
+
+/**
+ * @brief Destructor
+ */
+ArduinoRealtimeDialog::~ArduinoRealtimeDialog() {
+  AudioMemory::release(_inflateBuffer);
+  _inflateBuffer = nullptr;
 }
 
 /**
  * @brief Allocate audio buffer memory
  */
 bool ArduinoRealtimeDialog::allocateBuffers() {
-  if (_sendBuffer != nullptr && _ttsBuffer != nullptr) {
+  if (_sendBuffer != nullptr && _ttsRing.data() != nullptr) {
     return true;
   }
   
   // Allocate audio send buffer (small, 3.2KB)
   if (_sendBuffer == nullptr) {
-    _sendBuffer = (int16_t*)malloc(_sendBatchSize);
+    _sendBuffer = (int16_t*)AudioMemory::alloc(_sendBatchSize, AUDIO_MEM_INTERNAL_PREFERRED);
     if (_sendBuffer == nullptr) {
       Serial.println("[Error] Send buffer allocation failed!");
       return false;
@@ -36,7 +47,7 @@ bool ArduinoRealtimeDialog::allocateBuffers() {
   }
   
   // Allocate TTS buffer (prefer PSRAM, try from large to small)
-  if (_ttsBuffer == nullptr) {
+  if (_ttsRing.data() == nullptr) {
     // Print memory status
     Serial.printf("[Memory] Heap available: %d bytes\n", ESP.getFreeHeap());
     if (psramFound()) {
@@ -45,58 +56,21 @@ bool ArduinoRealtimeDialog::allocateBuffers() {
       Serial.println("[Warning] PSRAM not detected");
     }
     
-    // First try to allocate 1MB from PSRAM (about 20 seconds of audio)
-    if (psramFound()) {
-      _ttsBufferSize = 1024 * 1024;  // 1MB
-      _ttsBuffer = (uint8_t*)ps_malloc(_ttsBufferSize);
-      if (_ttsBuffer != nullptr) {
-        Serial.printf("[Success] TTS buffer allocated: %d KB (PSRAM)\n", _ttsBufferSize / 1024);
+    // Try 1MB first (about 20 seconds of audio), then smaller buffers
+    // AudioMemory places it in the PSRAM arena/heap when available, else internal RAM
+    static const size_t sizesKB[] = {1024, 512, 256, 128, 64};
+    for (size_t i = 0; i < sizeof(sizesKB) / sizeof(sizesKB[0]) && _ttsRing.data() == nullptr; i++) {
+      if (_ttsRing.begin(sizesKB[i] * 1024, AUDIO_MEM_PSRAM_PREFERRED)) {
+        Serial.printf("[Success] TTS buffer allocated: %d KB\n", (int)sizesKB[i]);
       } else {
-        Serial.printf("[Failed] PSRAM 1MB allocation failed\n");
-      }
-    }
-    
-    // PSRAM allocation failed, try smaller buffer from heap
-    if (_ttsBuffer == nullptr) {
-      Serial.println("[Trying] Allocating 512KB from heap...");
-      _ttsBufferSize = 512 * 1024;
-      _ttsBuffer = (uint8_t*)malloc(_ttsBufferSize);
-      if (_ttsBuffer != nullptr) {
-        Serial.printf("[Success] TTS buffer allocated: %d KB (heap)\n", _ttsBufferSize / 1024);
+        Serial.printf("[Failed] %d KB allocation failed\n", (int)sizesKB[i]);
       }
     }
     
-    if (_ttsBuffer == nullptr) {
-      Serial.println("[Trying] Allocating 256KB from heap...");
-      _ttsBufferSize = 256 * 1024;
-      _ttsBuffer = (uint8_t*)malloc(_ttsBufferSize);
-      if (_ttsBuffer != nullptr) {
-        Serial.printf("[Success] TTS buffer allocated: %d KB (heap)\n", _ttsBufferSize / 1024);
-      }
-    }
-    
-    if (_ttsBuffer == nullptr) {
-      Serial.println("[Trying] Allocating 128KB from heap...");
-      _ttsBufferSize = 128 * 1024;
-      _ttsBuffer = (uint8_t*)malloc(_ttsBufferSize);
-      if (_ttsBuffer != nullptr) {
-        Serial.printf("[Success] TTS buffer allocated: %d KB (heap)\n", _ttsBufferSize / 1024);
-      }
-    }
-    
-    if (_ttsBuffer == nullptr) {
-      Serial.println("[Trying] Allocating 64KB from heap...");
-      _ttsBufferSize = 64 * 1024;
-      _ttsBuffer = (uint8_t*)malloc(_ttsBufferSize);
-      if (_ttsBuffer != nullptr) {
-        Serial.printf("[Success] TTS buffer allocated: %d KB (heap)\n", _ttsBufferSize / 1024);
-      }
-    }
-    
-    if (_ttsBuffer == nullptr) {
+    if (_ttsRing.data() == nullptr) {
       Serial.println("[Error] TTS buffer allocation failed! All attempts failed");
       Serial.printf("[Memory] Current heap available: %d bytes\n", ESP.getFreeHeap());
-      free(_sendBuffer);
+      AudioMemory::release(_sendBuffer);
       _sendBuffer = nullptr;
       return false;
     }
@@ -171,7 +145,106 @@ bool ArduinoRealtimeDialog::initINMP441Microphone(int i2sSckPin, int i2sWsPin, i
  * @brief Initialize I2S audio output
  */
 bool ArduinoRealtimeDialog::initI2SAudioOutput(int bclk, int lrc, int dout) {
-  return _i2sPlayer.init(bclk, lrc, dout, 24000);
+  // Create TTS playback task on the core the WebSocket (loop()) does not use
+  if (_streamingPlayback && _playbackTaskHandle == nullptr) {
+    _playbackTaskHandle = AudioTasks::create(AUDIO_TASK_PLAYBACK, playbackTaskWrapper, "TTSPlayback", this);
+    if (_playbackTaskHandle == nullptr) {
+      Serial.println("[Warning] Playback task creation failed, using buffered playback");
+    } else {
+      Serial.printf("TTS streaming playback enabled (pre-roll %lu ms)\n", (unsigned long)_prerollMs);
+    }
+  }
+
+  // The Opus decoder always outputs 48kHz, PCM is requested at 24kHz
+  if (!_i2sPlayer.init(bclk, lrc, dout, useOpus() ? 48000 : 24000)) {
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Configure streaming TTS playback
+ */
+void ArduinoRealtimeDialog::setStreamingPlayback(bool enable, uint32_t prerollMs) {
+  _streamingPlayback = enable;
+  _prerollMs = prerollMs;
+}
+
+/**
+ * @brief Set TTS audio format
+ */
+bool ArduinoRealtimeDialog::setTTSFormat(const char* format) {
+  StreamCodec codec;
+  if (strcmp(format, "pcm_s16le") == 0) {
+    codec = STREAM_CODEC_PCM;
+  } else if (strcmp(format, "ogg_opus") == 0) {
+    codec = STREAM_CODEC_OPUS;
+  } else {
+    Serial.printf("[Error] Unsupported TTS format: %s (use pcm_s16le or ogg_opus)\n", format);
+    return false;
+  }
+
+  if (_isPlayingTTS) {
+    Serial.println("[Error] Cannot change TTS format while playing");
+    return false;
+  }
+  if (!_ttsDecoder.begin(codec)) {
+    return false;
+  }
+  _decodedLen = 0;
+  _decodedPos = 0;
+  return true;
+}
+
+/**
+ * @brief Set microphone audio format
+ */
+bool ArduinoRealtimeDialog::setASRFormat(const char* format, uint32_t bitrate) {
+  StreamCodec codec;
+  if (strcmp(format, "pcm") == 0) {
+    codec = STREAM_CODEC_PCM;
+  } else if (strcmp(format, "ogg_opus") == 0) {
+    codec = STREAM_CODEC_OPUS;
+  } else {
+    Serial.printf("[Error] Unsupported ASR format: %s (use pcm or ogg_opus)\n", format);
+    return false;
+  }
+
+  if (_sessionStarted) {
+    Serial.println("[Error] Cannot change ASR format during a session");
+    return false;
+  }
+  if (codec == STREAM_CODEC_OPUS && (_sampleRate != 16000 || _channels != 1)) {
+    Serial.println("[Warning] ogg_opus uplink needs 16kHz mono audio, sending PCM");
+  }
+  return _asrEncoder.begin(codec, bitrate);
+}
+
+/**
+ * @brief Enable gzip compression of JSON requests
+ */
+void ArduinoRealtimeDialog::setCompression(bool enable, size_t minRequestSize) {
+  _gzipRequests = enable;
+  _gzipMinSize = minRequestSize;
+  if (!enable) {
+    _deflater.end();
+  }
+}
+
+/**
+ * @brief Enable full-duplex barge-in
+ */
+bool ArduinoRealtimeDialog::setBargeIn(bool enable, uint16_t echoTaps, uint16_t echoDelayMs) {
+  _bargeIn = enable;
+  if (!enable || echoTaps == 0) {
+    _echo.end();
+    return true;
+  }
+  if (!_streamingPlayback) {
+    Serial.println("[Warning] Barge-in needs streaming playback, buffered replies play to the end");
+  }
+  return _echo.begin(_sampleRate, echoTaps, echoDelayMs);
 }
 
 /**
@@ -218,6 +291,7 @@ bool ArduinoRealtimeDialog::connectWebSocket() {
   }
   
   Serial.println("SSL connection successful");
+  TurnMetrics::mark(TURN_TLS_CONNECT);
   _client.setNoDelay(true);
   
   // After SSL connection succeeds, allocate audio buffers
@@ -268,7 +342,9 @@ bool ArduinoRealtimeDialog::connectWebSocket() {
   // Check if handshake succeeded
   if (response.indexOf("101") >= 0 && response.indexOf("Switching Protocols") >= 0) {
     Serial.println("WebSocket connection successful");
+    TurnMetrics::mark(TURN_WS_UPGRADE);
     _wsConnected = true;
+    _ws.reset();  // Drop any frame left over from the previous connection
     
     // Send StartConnection event
     sendStartConnection();
@@ -328,6 +404,7 @@ bool ArduinoRealtimeDialog::startSession() {
   
   // Generate new session ID
   _sessionId = generateSessionId();
+  _asrEncoder.reset();  // New session, new Ogg stream
   
   Serial.println("Starting session: " + _sessionId);
   
@@ -372,12 +449,14 @@ bool ArduinoRealtimeDialog::startRecording() {
   }
   
   Serial.println("\n[System] Listening... Please speak");
+  TurnMetrics::beginTurn();
   
   _isRecording = true;
   _userSpeaking = false;
   _recognizedText = "";
   _lastASRText = "";
   _sendBufferPos = 0;
+  _echo.reset();
   
   return true;
 }
@@ -390,9 +469,12 @@ void ArduinoRealtimeDialog::stopRecording() {
     return;
   }
   
-  // Send remaining audio data in buffer
+  // Send remaining audio data in buffer (Opus: a partial frame waits for the next recording of this session)
   if (_sendBufferPos > 0) {
-    sendAudioChunk((uint8_t*)_sendBuffer, _sendBufferPos * 2);
+    if (_bargeIn) {
+      _echo.process(_sendBuffer, _sendBufferPos);
+    }
+    sendAudioSamples(_sendBuffer, _sendBufferPos);
     _sendBufferPos = 0;
   }
   
@@ -471,8 +553,19 @@ void ArduinoRealtimeDialog::loop() {
     _wsConnected = false;
     _sessionStarted = false;
     _isRecording = false;
+    _ttsDropAudio = false;
   }
   
+  // Streaming playback finished in the playback task, report on the loop thread
+  if (_ttsPlaybackDone) {
+    _ttsPlaybackDone = false;
+    _isPlayingTTS = false;
+
+    if (_ttsEndedCallback != nullptr) {
+      _ttsEndedCallback();
+    }
+  }
+
   if (!_wsConnected) {
     return;
   }
@@ -508,7 +601,10 @@ void ArduinoRealtimeDialog::processAudioSending() {
       
       // Buffer full, send immediately
       if (_sendBufferPos >= _sendBatchSize / 2) {
-        sendAudioChunk((uint8_t*)_sendBuffer, _sendBufferPos * 2);
+        if (_bargeIn) {
+          _echo.process(_sendBuffer, _sendBufferPos);  // The reply playing right now is in this audio
+        }
+        sendAudioSamples(_sendBuffer, _sendBufferPos);
         _sendBufferPos = 0;
       }
     }
@@ -518,50 +614,27 @@ void ArduinoRealtimeDialog::processAudioSending() {
 }
 
 /**
- * @brief Send WebSocket frame
+ * @brief Send a batch of samples, Opus encoded if enabled
  */
-void ArduinoRealtimeDialog::sendWebSocketFrame(uint8_t* data, size_t len, uint8_t opcode) {
-  if (!_wsConnected || !_client.connected()) return;
-  
-  // Build WebSocket frame header
-  uint8_t header[10];
-  int header_len = 2;
-  
-  header[0] = 0x80 | opcode;  // FIN=1 + opcode
-  header[1] = 0x80;           // MASK=1
-  
-  // Length encoding
-  if (len < 126) {
-    header[1] |= len;
-  } else if (len < 65536) {
-    header[1] |= 126;
-    header[2] = (len >> 8) & 0xFF;
-    header[3] = len & 0xFF;
-    header_len = 4;
-  } else {
-    header[1] |= 127;
-    for (int i = 0; i < 8; i++) {
-      header[2 + i] = (len >> (56 - i * 8)) & 0xFF;
-    }
-    header_len = 10;
-  }
-  
-  // Generate random mask key
-  uint8_t mask_key[4];
-  for (int i = 0; i < 4; i++) {
-    mask_key[i] = random(0, 256);
+void ArduinoRealtimeDialog::sendAudioSamples(const int16_t* samples, size_t count) {
+  if (!useOpusUplink()) {
+    sendAudioChunk((uint8_t*)samples, count * 2);
+    return;
   }
-  memcpy(header + header_len, mask_key, 4);
-  header_len += 4;
-  
-  // Send frame header
-  _client.write(header, header_len);
-  
-  // Mask data and send
-  for (size_t i = 0; i < len; i++) {
-    data[i] ^= mask_key[i % 4];
+  size_t len = _asrEncoder.encode(samples, count, false);
+  if (len > 0) {
+    sendAudioChunk((uint8_t*)_asrEncoder.data(), len);
   }
-  _client.write(data, len);
+}
+
+/**
+ * @brief Send WebSocket frame
+ * @details Masking and framing are done by the shared WebSocketEngine in its send buffer,
+ *          data is not modified
+ */
+void ArduinoRealtimeDialog::sendWebSocketFrame(const uint8_t* data, size_t len, uint8_t opcode) {
+  if (!_wsConnected || !_client.connected()) return;
+  _ws.sendFrame(_client, opcode, data, len);
 }
 /**
  * @brief Send StartConnection event
@@ -637,12 +710,21 @@ void ArduinoRealtimeDialog::sendStartSession() {
   
   // ASR configuration
   doc["asr"]["extra"]["end_smooth_window_ms"] = 1500;
+  if (useOpusUplink()) {
+    // Microphone audio as Ogg Opus pages, same format naming as the TTS side
+    doc["asr"]["audio_info"]["format"] = "ogg_opus";
+    doc["asr"]["audio_info"]["sample_rate"] = 16000;
+    doc["asr"]["audio_info"]["channel"] = 1;
+  }
   
-  // TTS configuration - Use PCM format for direct I2S playback
+  // TTS configuration - PCM for direct I2S playback, or Ogg Opus decoded by the playback task
   doc["tts"]["speaker"] = _ttsSpeaker;
   doc["tts"]["audio_config"]["channel"] = 1;
-  doc["tts"]["audio_config"]["format"] = "pcm_s16le";  // 16-bit PCM, little-endian
+  doc["tts"]["audio_config"]["format"] = useOpus() ? "ogg_opus" : "pcm_s16le";  // pcm_s16le: 16-bit PCM, little-endian
   doc["tts"]["audio_config"]["sample_rate"] = 24000;
+  if (_ttsDecoder.codec() == STREAM_CODEC_OPUS && !useOpus()) {
+    Serial.println("[Warning] ogg_opus needs streaming playback, requesting PCM");
+  }
   
   // Dialog configuration - Use different config based on model version
   if (_modelVersion == "SC") {
@@ -674,8 +756,24 @@ void ArduinoRealtimeDialog::sendStartSession() {
   serializeJson(doc, json_str);
   // Serial.println("StartSession config:");
   // Serial.println(json_str);  
+
+  // Optional GZIP, only kept if it actually shrinks the payload
+  const uint8_t* payload = (const uint8_t*)json_str.c_str();
+  uint32_t payload_len = json_str.length();
+  uint8_t compression = COMPRESS_NONE;
+  uint8_t* compressed = nullptr;
+  if (_gzipRequests && payload_len >= _gzipMinSize) {
+    compressed = new uint8_t[payload_len];
+    size_t n = _deflater.compress(payload, payload_len, compressed, payload_len);
+    if (n > 0) {
+      payload = compressed;
+      payload_len = n;
+      compression = COMPRESS_GZIP;
+    }
+  }
+
   // Protocol header
-  uint8_t header[4] = {0x11, (MSG_TYPE_CLIENT_FULL << 4) | MSG_FLAG_WITH_EVENT, (SERIAL_JSON << 4) | COMPRESS_NONE, 0x00};
+  uint8_t header[4] = {0x11, (MSG_TYPE_CLIENT_FULL << 4) | MSG_FLAG_WITH_EVENT, (uint8_t)((SERIAL_JSON << 4) | compression), 0x00};
   
   // Event ID
   uint8_t event_bytes[4];
@@ -693,7 +791,6 @@ void ArduinoRealtimeDialog::sendStartSession() {
   session_id_len_bytes[3] = session_id_len & 0xFF;
   
   // Payload
-  uint32_t payload_len = json_str.length();
   uint8_t payload_len_bytes[4];
   payload_len_bytes[0] = (payload_len >> 24) & 0xFF;
   payload_len_bytes[1] = (payload_len >> 16) & 0xFF;
@@ -710,10 +807,11 @@ void ArduinoRealtimeDialog::sendStartSession() {
   memcpy(request + pos, session_id_len_bytes, 4); pos += 4;
   memcpy(request + pos, _sessionId.c_str(), session_id_len); pos += session_id_len;
   memcpy(request + pos, payload_len_bytes, 4); pos += 4;
-  memcpy(request + pos, json_str.c_str(), payload_len);
+  memcpy(request + pos, payload, payload_len);
   
   sendWebSocketFrame(request, total_len, 0x02);
   delete[] request;
+  delete[] compressed;
 }
 
 /**
@@ -801,159 +899,29 @@ void ArduinoRealtimeDialog::sendAudioChunk(uint8_t* data, size_t len) {
   
   sendWebSocketFrame(request, total_len, 0x02);
   delete[] request;
+  TurnMetrics::mark(TURN_FIRST_AUDIO_SENT);  // Only the first of the turn is kept
 }
 
 /**
- * @brief Send Pong response
+ * @brief Handle received WebSocket data
+ * @details Feeds whatever the socket has to the frame parser without waiting, so a server
+ *          pausing mid-frame no longer stalls audio sending. Complete messages arrive in
+ *          wsMessage(), pings are answered by the engine.
  */
-void ArduinoRealtimeDialog::sendPong() {
-  uint8_t pong_data[1] = {0};
-  sendWebSocketFrame(pong_data, 0, 0x0A);
+void ArduinoRealtimeDialog::handleWebSocketData() {
+  if (_ws.poll(_client) < 0) {
+    Serial.println("Server closed connection");
+    _wsConnected = false;
+    _client.stop();
+  }
 }
 
 /**
- * @brief Handle received WebSocket data
+ * @brief WebSocketEngine message callback, binary messages carry the custom protocol
  */
-void ArduinoRealtimeDialog::handleWebSocketData() {
-  // Only process one complete WebSocket frame
-  if (_client.available() < 2) {
-    return;  // Insufficient data, wait for more
-  }
-  
-  // Read WebSocket frame header (2 bytes)
-  uint8_t header[2];
-  if (_client.readBytes(header, 2) != 2) {
-    return;
-  }
-  
-  bool fin = header[0] & 0x80;
-  uint8_t opcode = header[0] & 0x0F;
-  bool masked = header[1] & 0x80;
-  uint64_t payload_len = header[1] & 0x7F;
-  
-  // Handle extended length
-  if (payload_len == 126) {
-    uint8_t len_bytes[2];
-    if (_client.readBytes(len_bytes, 2) != 2) {
-      return;
-    }
-    payload_len = (len_bytes[0] << 8) | len_bytes[1];
-  } else if (payload_len == 127) {
-    uint8_t len_bytes[8];
-    if (_client.readBytes(len_bytes, 8) != 8) {
-      return;
-    }
-    payload_len = 0;
-    for (int i = 0; i < 8; i++) {
-      payload_len = (payload_len << 8) | len_bytes[i];
-    }
-  }
- Serial.printf("[WS Frame] opcode=0x%X, masked=%d, payload_len=%llu\n", opcode, masked, payload_len);  
-  // Read mask key (if present)
-  uint8_t mask_key[4] = {0};
-  if (masked) {
-    if (_client.readBytes(mask_key, 4) != 4) {
-      return;
-    }
-  }
-  
-  // Read payload data - Critical fix: must fully consume payload to maintain frame sync
-  if (payload_len > 0 && payload_len < 1000000) {  // Increased to 1MB limit, fully utilize 8MB PSRAM
-    uint8_t* payload = nullptr;
-    
-    // Try to allocate from PSRAM first
-    if (psramFound()) {
-      payload = (uint8_t*)ps_malloc(payload_len);
-      if (payload == nullptr) {
-        Serial.printf("[Warning] PSRAM allocation of %llu bytes failed, trying heap\n", payload_len);
-      }
-    }
-    
-    // If PSRAM unavailable or allocation failed, try heap allocation
-    if (payload == nullptr) {
-      payload = (uint8_t*)malloc(payload_len);
-      if (payload == nullptr) {
-Serial.printf("[Error] Memory allocation failed! Must skip %llu bytes byte-by-byte to maintain sync\n", payload_len);
-        // Even if allocation fails, must consume payload to maintain frame sync
-        for (size_t i = 0; i < payload_len; i++) {
-          _client.read();
-        }
-        return;
-      }
-    }
-    
-    // Read payload - Ultimate optimization: streaming read, read as much as available, don't wait for complete block
-    size_t bytes_read = 0;
-    size_t remaining = payload_len;
-    uint8_t* write_ptr = payload;
-    
-    unsigned long read_start = millis();
-    
-    while (remaining > 0) {
-      // Check if data is available to read
-      int available = _client.available();
-      
-      if (available > 0) {
-        // Read immediately if data available, don't wait for complete block
-        size_t to_read = (available < remaining) ? available : remaining;
-        size_t read_this_time = _client.readBytes(write_ptr, to_read);
-        
-        if (read_this_time > 0) {
-          bytes_read += read_this_time;
-          write_ptr += read_this_time;
-          remaining -= read_this_time;
-        }
-      } else {
-        // Only yield when no data, avoid busy waiting
-        yield();
-        
-        // Timeout check (5 second timeout)
-        if (millis() - read_start > 5000) {
-          // Try to skip remaining bytes
-          for (size_t i = 0; i < remaining; i++) {
-            if (_client.available()) {
-              _client.read();
-            } else {
-              break;
-            }
-          }
-          free(payload);
-          return;
-        }
-      }
-    }
-    
-    if (bytes_read != payload_len) {
-      free(payload);
-      return;
-    }
-    
-    // Process after successfully reading complete payload
-    // Unmask
-    if (masked) {
-      for (size_t i = 0; i < payload_len; i++) {
-        payload[i] ^= mask_key[i % 4];
-      }
-    }
-    
-    // Handle different opcodes
-    if (opcode == 0x02) {  // Binary data - custom protocol
-      parseResponse(payload, payload_len);
-    } else if (opcode == 0x08) {  // Close connection
-      Serial.println("Server closed connection");
-      _wsConnected = false;
-      _client.stop();
-    } else if (opcode == 0x09) {  // Ping
-      sendPong();
-    }
-    
-    // Free memory (memory allocated by ps_malloc is also freed with free)
-    free(payload);
-  } else if (payload_len >= 1000000) {
-    // Payload too large (over 1MB), must consume to maintain sync
-    for (size_t i = 0; i < payload_len; i++) {
-      _client.read();
-    }
+void ArduinoRealtimeDialog::wsMessage(uint8_t opcode, uint8_t* data, size_t len, void* user) {
+  if (opcode == WS_OP_BINARY) {
+    ((ArduinoRealtimeDialog*)user)->parseResponse(data, len);
   }
 }
 
@@ -1018,13 +986,26 @@ void ArduinoRealtimeDialog::parseResponse(uint8_t* data, size_t len) {
       
       // Process payload data
       if (message_type == MSG_TYPE_SERVER_ACK && serialization == SERIAL_RAW) {
-        // This is TTS audio data
+        // This is TTS audio data, decompressed in window-sized pieces straight into the TTS buffer
         if (compression == COMPRESS_GZIP) {
-          Serial.println("TTS audio uses GZIP compression, not supported yet");
+          int32_t ret = _inflater.inflate(payload, payload_len, inflatedTTSAudio, this);
+          if (ret < 0) {
+            Serial.printf("[Error] TTS audio GZIP decode failed (%d)\n", (int)ret);
+          }
         } else {
           processTTSAudio(payload, payload_len);
         }
       } else if (serialization == SERIAL_JSON && payload_len > 0) {
+        if (compression == COMPRESS_GZIP) {
+          int32_t ret = inflateJson(payload, payload_len);
+          if (ret < 0) {
+            Serial.printf("[Error] JSON GZIP decode failed (%d)\n", (int)ret);
+            return;
+          }
+          payload = _inflateBuffer;
+          payload_len = ret;
+        }
+
         // Parse JSON data
         StaticJsonDocument<2048> doc;
         DeserializationError error = deserializeJson(doc, payload, payload_len);
@@ -1045,6 +1026,26 @@ void ArduinoRealtimeDialog::parseResponse(uint8_t* data, size_t len) {
   }
 }
 
+/**
+ * @brief Pass decompressed TTS audio on (GzipInflater output callback)
+ */
+void ArduinoRealtimeDialog::inflatedTTSAudio(const uint8_t* data, size_t len, void* user) {
+  ((ArduinoRealtimeDialog*)user)->processTTSAudio(data, len);
+}
+
+/**
+ * @brief Decompress a GZIP JSON payload into _inflateBuffer
+ */
+int32_t ArduinoRealtimeDialog::inflateJson(const uint8_t* data, size_t len) {
+  if (_inflateBuffer == nullptr) {
+    _inflateBuffer = (uint8_t*)AudioMemory::alloc(INFLATE_BUFFER_SIZE, AUDIO_MEM_PSRAM_PREFERRED);
+    if (_inflateBuffer == nullptr) {
+      return GZIP_ERR_MEMORY;
+    }
+  }
+  return _inflater.inflate(data, len, _inflateBuffer, INFLATE_BUFFER_SIZE);
+}
+
 /**
  * @brief Handle server events
  */
@@ -1065,6 +1066,10 @@ void ArduinoRealtimeDialog::handleServerEvent(int eventId, JsonObject& payload)
     case EVENT_ASR_INFO:
       // ASR detected speech start
       Serial.println("\n[ASR] Speech detected!");
+      if (_bargeIn && _isPlayingTTS) {
+        interruptTTS();
+      }
+      TurnMetrics::beginTurn(false);  // Continuous listening: a new utterance after the last reply played
       _userSpeaking = true;
       if (_asrDetectedCallback != nullptr) {
         _asrDetectedCallback();
@@ -1083,6 +1088,9 @@ void ArduinoRealtimeDialog::handleServerEvent(int eventId, JsonObject& payload)
             _lastASRText = text;
             Serial.print("[ASR] ");
             Serial.print(is_interim ? "Interim" : "Final");
+            if (!is_interim) {
+              TurnMetrics::mark(TURN_ASR_FINAL);
+            }
             Serial.print(": ");
             Serial.println(text);
           }
@@ -1093,7 +1101,9 @@ void ArduinoRealtimeDialog::handleServerEvent(int eventId, JsonObject& payload)
     case EVENT_ASR_ENDED:
       // ASR recognition ended
       Serial.println("\n[ASR] Recognition ended");
+      TurnMetrics::mark(TURN_VAD_END);
       _userSpeaking = false;
+      _ttsDropAudio = false;  // The reply to this utterance follows
       _recognizedText = _lastASRText;
       
       if (_asrEndedCallback != nullptr && _recognizedText.length() > 0) {
@@ -1103,6 +1113,9 @@ void ArduinoRealtimeDialog::handleServerEvent(int eventId, JsonObject& payload)
       
     case EVENT_TTS_SENTENCE_START:
       // TTS sentence start
+      if (_ttsDropAudio) {
+        break;  // Late sentence of an interrupted reply
+      }
       if (payload.containsKey("text")) {
         String ttsText = payload["text"].as<String>();
         Serial.println("\n[TTS] Starting playback: " + ttsText);
@@ -1113,6 +1126,11 @@ void ArduinoRealtimeDialog::handleServerEvent(int eventId, JsonObject& payload)
       if (!_isPlayingTTS) {
         _isPlayingTTS = true;
         _ttsBufferPos = 0;
+        _ttsStreamEnded = false;
+        _ttsPrerolled = false;
+        _ttsOverrunLogged = false;
+        _ttsStarved = false;
+        _ttsFirstAudioMs = 0;
         
         if (_ttsStartedCallback != nullptr) {
           _ttsStartedCallback();
@@ -1121,11 +1139,22 @@ void ArduinoRealtimeDialog::handleServerEvent(int eventId, JsonObject& payload)
       break;
       
     case EVENT_TTS_ENDED:
+      if (_ttsDropAudio) {
+        break;  // Interrupted reply, already reported as ended
+      }
+
+      // Streaming mode: playback task drains remaining audio and reports completion via loop()
+      if (isStreamingActive()) {
+        _ttsStreamEnded = true;
+        break;
+      }
+
       // TTS audio reception complete, now play the complete sentence at once
       
       // Play complete audio from buffer
       if (_ttsBufferPos > 0) {
-        _i2sPlayer.play(_ttsBuffer, _ttsBufferPos);
+        TurnMetrics::mark(TURN_FIRST_SAMPLE);
+        _i2sPlayer.play(_ttsRing.data(), _ttsBufferPos);
         
         // Calculate playback duration: bytes / (sample_rate * bytes_per_sample * channels)
         // For 24kHz, 16-bit (2 bytes), mono: duration_ms = bytes / (24000 * 2) * 1000
@@ -1139,6 +1168,7 @@ void ArduinoRealtimeDialog::handleServerEvent(int eventId, JsonObject& payload)
       
       // Stop I2S playback after audio finishes
       _i2sPlayer.stop();
+      TurnMetrics::mark(TURN_LAST_SAMPLE);
       
       // Reset state
       _isPlayingTTS = false;
@@ -1151,6 +1181,7 @@ void ArduinoRealtimeDialog::handleServerEvent(int eventId, JsonObject& payload)
       
     case EVENT_CHAT_RESPONSE:
       // Chat response text
+      TurnMetrics::mark(TURN_LLM_FIRST_TOKEN);
       if (payload.containsKey("content")) {
         String content = payload["content"].as<String>();
         Serial.print("[Chat] ");
@@ -1172,21 +1203,240 @@ void ArduinoRealtimeDialog::handleServerEvent(int eventId, JsonObject& payload)
 /**
  * @brief Process TTS audio data (PCM format)
  */
-void ArduinoRealtimeDialog::processTTSAudio(uint8_t* data, size_t len) {
-  // Check if buffer is allocated
-  if (_ttsBuffer == nullptr) {
+void ArduinoRealtimeDialog::processTTSAudio(const uint8_t* data, size_t len) {
+  // Check if buffer is allocated, drop the remainder of an interrupted reply
+  if (_ttsRing.data() == nullptr || _ttsDropAudio) {
+    return;
+  }
+  TurnMetrics::mark(TURN_TTS_FIRST_BYTE);
+
+  // Streaming mode: append to jitter buffer, playback task consumes it
+  if (isStreamingActive()) {
+    size_t space_available = _ttsRing.space();
+    size_t to_copy = (len < space_available) ? len : space_available;
+    if (!useOpus()) {
+      to_copy &= ~(size_t)1;  // Keep 16-bit sample alignment
+    } else if (_ttsFirstAudioMs == 0) {
+      _ttsFirstAudioMs = millis();
+    }
+
+    if (to_copy < len) {
+      TurnMetrics::overrun();
+      if (!_ttsOverrunLogged) {
+        Serial.printf("[Warning] TTS jitter buffer full, dropping %u bytes\n", (unsigned)(len - to_copy));
+        _ttsOverrunLogged = true;
+      }
+    }
+
+    _ttsRing.write(data, to_copy);
+    TurnMetrics::ringFill(_ttsRing.buffered(), _ttsRing.capacity());
     return;
   }
   
   // Add received PCM data to buffer
-  size_t space_available = _ttsBufferSize - _ttsBufferPos;
+  size_t space_available = _ttsRing.capacity() - _ttsBufferPos;
   size_t to_copy = (len < space_available) ? len : space_available;
   
   if (to_copy > 0) {
-    memcpy(_ttsBuffer + _ttsBufferPos, data, to_copy);
+    memcpy(_ttsRing.data() + _ttsBufferPos, data, to_copy);
     _ttsBufferPos += to_copy;
   }
   
   // Don't play immediately, wait for EVENT_TTS_ENDED event to play complete sentence at once
   // This avoids segmented playback, making speech more coherent and smooth
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Drain jitter buffer into I2S (runs in playback task)
+ */
+void ArduinoRealtimeDialog::processTTSPlayback() {
+  if (_ttsDecoder.codec() == STREAM_CODEC_OPUS) {
+    processOpusPlayback();
+    return;
+  }
+
+  const size_t bytes_per_ms = (24000 * 2) / 1000;  // 24kHz, 16-bit, mono
+  size_t available = _ttsRing.available();
+
+  // Wait for pre-roll unless the reply is already complete
+  if (!_ttsPrerolled) {
+    if (available < _prerollMs * bytes_per_ms && !_ttsStreamEnded) {
+      return;
+    }
+    _ttsPrerolled = true;
+  }
+
+  // Read the flag first: audio received before EVENT_TTS_ENDED is then already in the ring
+  bool streamEnded = _ttsStreamEnded;
+
+  // Barge-in: smaller writes let an interruption cut in sooner
+  const size_t max_write = _bargeIn ? 1024 : 4096;
+  while (available >= 2) {
+    if (_ttsAbort) {
+      return;
+    }
+
+    // Write contiguous block from read position
+    size_t to_write;
+    const uint8_t* span = _ttsRing.readSpan(to_write);
+    if (to_write > max_write) to_write = max_write;
+    to_write &= ~(size_t)1;  // Align to 16-bit boundary
+
+    // Blocks (up to 100ms) while DMA is full, which paces this task
+    size_t written = _i2sPlayer.play(span, to_write);
+    if (written == 0) {
+      return;
+    }
+    TurnMetrics::mark(TURN_FIRST_SAMPLE);
+    if (_bargeIn && _isRecording) {
+      _echo.pushReference((const int16_t*)span, written / 2, 24000);
+    }
+    _ttsStarved = false;
+    _ttsRing.commitRead(written);
+    available = _ttsRing.available();
+  }
+
+  // Drained before the reply is complete: the network fell behind playback
+  if (!streamEnded && !_ttsStarved) {
+    _ttsStarved = true;
+    TurnMetrics::underrun();
+  }
+
+  // Buffer drained after EVENT_TTS_ENDED: drop an odd trailing byte so nothing carries into the
+  // next reply, let DMA flush, then report completion
+  if (streamEnded && _ttsRing.available() < 2) {
+    _ttsRing.discard();
+    finishTTSPlayback();
+  }
+}
+
+/**
+ * @brief Decode Ogg Opus from the jitter buffer into I2S (runs in playback task)
+ */
+void ArduinoRealtimeDialog::processOpusPlayback() {
+  // Compressed size says little about duration, so pre-roll by arrival time instead
+  if (!_ttsPrerolled) {
+    if ((_ttsFirstAudioMs == 0 || millis() - _ttsFirstAudioMs < _prerollMs) && !_ttsStreamEnded) {
+      return;
+    }
+    _ttsPrerolled = true;
+  }
+
+  // Read the flag first: audio received before EVENT_TTS_ENDED is then already in the ring
+  bool streamEnded = _ttsStreamEnded;
+  while (!_ttsAbort) {
+    if (_decodedPos >= _decodedLen) {
+      _decodedLen = _ttsDecoder.decode(_ttsRing, streamEnded);
+      _decodedPos = 0;
+      if (_decodedLen == 0) {
+        break;
+      }
+    }
+
+    // Blocks while DMA is full, which paces this task
+    const uint8_t* pcm = (const uint8_t*)(_ttsDecoder.pcm() + _decodedPos);
+    size_t written = _i2sPlayer.play(pcm, (_decodedLen - _decodedPos) * 2);
+    if (written == 0) {
+      return;
+    }
+    TurnMetrics::mark(TURN_FIRST_SAMPLE);
+    if (_bargeIn && _isRecording) {
+      _echo.pushReference((const int16_t*)pcm, written / 2, 48000);
+    }
+    _ttsStarved = false;
+    _decodedPos += written / 2;
+  }
+  if (_ttsAbort) {
+    return;
+  }
+
+  if (!streamEnded && !_ttsStarved) {
+    _ttsStarved = true;
+    TurnMetrics::underrun();
+  }
+
+  if (streamEnded && _ttsRing.available() == 0 && _ttsDecoder.pending() == 0) {
+    _ttsDecoder.reset();
+    finishTTSPlayback();
+  }
+}
+
+/**
+ * @brief Let DMA flush after the last sample, then report completion (runs in playback task)
+ */
+void ArduinoRealtimeDialog::finishTTSPlayback() {
+  uint32_t latency = _i2sPlayer.getBufferLatencyMs();
+  for (uint32_t waited = 0; waited < latency && !_ttsAbort; waited += 10) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  if (_ttsAbort) {
+    return;  // Interrupted while draining, abortTTSPlayback() silences DMA
+  }
+  _i2sPlayer.stop();
+  TurnMetrics::mark(TURN_LAST_SAMPLE);
+  _ttsStreamEnded = false;
+  _ttsPrerolled = false;
+  _ttsPlaybackDone = true;
+}
+
+/**
+ * @brief Stop the current reply because the user started speaking (loop thread)
+ * @details The loop side state is reset at once, DMA and decoder belong to the playback task
+ *          and are cleared there through _ttsAbort
+ */
+void ArduinoRealtimeDialog::interruptTTS() {
+  Serial.println("[TTS] Interrupted by user speech");
+  _ttsDropAudio = true;
+  _ttsRing.discard();
+  _ttsBufferPos = 0;
+  if (isStreamingActive()) {
+    _ttsAbort = true;
+  }
+  _isPlayingTTS = false;
+  _ttsStreamEnded = false;
+  _ttsPlaybackDone = false;
+  TurnMetrics::mark(TURN_LAST_SAMPLE);
+
+  if (_ttsEndedCallback != nullptr) {
+    _ttsEndedCallback();
+  }
+}
+
+/**
+ * @brief Silence the speaker and drop partly played audio after an interruption (runs in playback task)
+ */
+void ArduinoRealtimeDialog::abortTTSPlayback() {
+  _i2sPlayer.flush();
+  _echo.flushReference();
+  _ttsRing.discard();
+  _ttsDecoder.reset();
+  _decodedLen = 0;
+  _decodedPos = 0;
+  _ttsPrerolled = false;
+  _ttsPlaybackDone = false;
+  _ttsAbort = false;
+}
+
+/**
+ * @brief Static wrapper for FreeRTOS task
+ * @param param Pointer to ArduinoRealtimeDialog instance
+ */
+void ArduinoRealtimeDialog::playbackTaskWrapper(void* param) {
+  ArduinoRealtimeDialog* instance = static_cast<ArduinoRealtimeDialog*>(param);
+  instance->playbackTaskLoop();
+}
+
+/**
+ * @brief TTS playback task main loop (runs on separate core)
+ */
+void ArduinoRealtimeDialog::playbackTaskLoop() {
+  while (true) {
+    if (_ttsAbort) {
+      abortTTSPlayback();
+    } else if (_isPlayingTTS && !_ttsPlaybackDone && _ttsRing.data() != nullptr) {
+      processTTSPlayback();
+    }
+    // Small delay to prevent starving other tasks
+    vTaskDelay(1);  // 1 tick = ~1ms
+  }
+}
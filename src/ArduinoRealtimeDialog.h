@@ -7,6 +7,15 @@
 #include <ESP_I2S.h>
 #include <mbedtls/base64.h>
 #include "I2SAudioPlayer.h"
+#include "AudioMemory.h"
+#include "AudioRingBuffer.h"
+#include "StreamDecoder.h"
+#include "StreamEncoder.h"
+#include "GzipCodec.h"
+#include "WebSocketEngine.h"
+#include "TurnMetrics.h"
+#include "EchoCanceller.h"
+#include "AudioTasks.h"
 
 /**
  * @file ArduinoRealtimeDialog.h
@@ -86,6 +95,11 @@ class ArduinoRealtimeDialog {
      */
     ArduinoRealtimeDialog(const char* appId, const char* accessKey);
 
+    /**
+     * @brief Destructor, releases the JSON decompression buffer
+     */
+    ~ArduinoRealtimeDialog();
+
     /**
      * @brief Allocate audio buffer memory
      */
@@ -138,6 +152,49 @@ class ArduinoRealtimeDialog {
      */
     bool initI2SAudioOutput(int bclk, int lrc, int dout);
 
+    /**
+     * @brief Configure streaming TTS playback
+     * @param enable true to play TTS audio as it arrives, false to buffer the whole reply and play it at EVENT_TTS_ENDED
+     * @param prerollMs Audio to accumulate before playback starts (milliseconds), absorbs network jitter
+     * @note Call before initI2SAudioOutput(); streaming is enabled by default with 200ms pre-roll
+     */
+    void setStreamingPlayback(bool enable, uint32_t prerollMs = 200);
+
+    /**
+     * @brief Set TTS audio format requested from the server
+     * @param format "pcm_s16le" (default, 24kHz PCM) or "ogg_opus" (decoded on device, played at 48kHz)
+     * @return Whether the format is supported and its decoder could be allocated
+     * @note Call before initI2SAudioOutput(); ogg_opus needs streaming playback, buffered playback falls back to PCM
+     */
+    bool setTTSFormat(const char* format);
+
+    /**
+     * @brief Set microphone audio format sent to the server
+     * @param format "pcm" (default, 16kHz 16-bit PCM) or "ogg_opus" (encoded on device)
+     * @param bitrate Opus target bitrate in bit/s (default 24000, PCM is 256000)
+     * @return Whether the format is supported and its encoder could be allocated
+     * @note Call before startSession(); ogg_opus requires 16kHz mono, other settings fall back to PCM
+     */
+    bool setASRFormat(const char* format, uint32_t bitrate = StreamEncoder::DEFAULT_BITRATE);
+
+    /**
+     * @brief Enable gzip compression of JSON requests
+     * @param enable true to gzip JSON payloads of at least minRequestSize bytes (e.g. StartSession with a long system role)
+     * @param minRequestSize Smaller payloads are sent uncompressed, gzip overhead outweighs the gain
+     * @note GZIP compressed server payloads (JSON and TTS audio) are always decoded
+     */
+    void setCompression(bool enable, size_t minRequestSize = 512);
+
+    /**
+     * @brief Enable full-duplex barge-in
+     * @param enable true to keep the microphone streaming while TTS plays and stop playback as soon as the server detects new speech
+     * @param echoTaps Echo canceller length in samples (default 256, 16ms at 16kHz), 0 sends the raw microphone signal
+     * @param echoDelayMs Delay from I2S write to microphone (default 16ms), raise it if replies still trigger the server's VAD
+     * @return Whether the echo canceller could be allocated
+     * @note Call after setAudioParams() while idle; needs streaming playback, buffered playback blocks loop() while a reply plays
+     */
+    bool setBargeIn(bool enable, uint16_t echoTaps = 256, uint16_t echoDelayMs = 16);
+
     /**
      * @brief Connect to WebSocket server
      */
@@ -257,7 +314,9 @@ class ArduinoRealtimeDialog {
     I2SAudioPlayer _i2sPlayer; // I2S audio player
 
     // WiFi client
+    static const size_t WS_MAX_MESSAGE = 1000000; // Largest response assembled (PSRAM preferred)
     WiFiClientSecure _client; // WiFi client
+    WebSocketEngine _ws; // Frame parser and sender
 
     // Status flags
     bool _wsConnected = false; // WebSocket connected
@@ -279,9 +338,45 @@ class ArduinoRealtimeDialog {
     int _sendBufferPos = 0; // Send buffer position
 
     // TTS audio buffer (for receiving and playing PCM data, preferably allocated 1MB from PSRAM)
-    uint8_t* _ttsBuffer = nullptr; // TTS buffer
-    size_t _ttsBufferSize = 0; // TTS buffer size
-    size_t _ttsBufferPos = 0; // TTS buffer position
+    AudioRingBuffer _ttsRing; // TTS buffer (jitter ring in streaming mode, linear otherwise)
+    size_t _ttsBufferPos = 0; // TTS buffer position (non-streaming mode)
+
+    // Streaming playback (producer: network side, consumer: playback task)
+    bool _streamingPlayback = true; // Play TTS audio as it arrives
+    uint32_t _prerollMs = 200; // Pre-roll before playback starts
+    volatile bool _ttsStreamEnded = false; // EVENT_TTS_ENDED received
+    volatile bool _ttsPrerolled = false; // Pre-roll reached, playback running
+    volatile bool _ttsPlaybackDone = false; // Playback task drained the buffer
+    bool _ttsOverrunLogged = false; // Overrun already reported for this reply
+    bool _ttsStarved = false;       // Jitter buffer ran dry mid-reply (playback task)
+
+    // Barge-in (microphone keeps streaming during playback)
+    bool _bargeIn = false; // Interrupt TTS when the server detects new speech
+    EchoCanceller _echo; // Removes the reply from microphone audio, fed by the playback task
+    volatile bool _ttsAbort = false; // Interrupted, playback task drops decoded audio and DMA
+    bool _ttsDropAudio = false; // Discard the rest of the interrupted reply until the utterance ends
+
+    // Compressed TTS (decoder state owned by the playback task)
+    StreamDecoder _ttsDecoder; // Ogg Opus decoder, codec PCM when unused
+    size_t _decodedLen = 0; // Samples in the current decoded frame
+    size_t _decodedPos = 0; // Samples of that frame already played
+    volatile uint32_t _ttsFirstAudioMs = 0; // Arrival time of the first audio of this reply (compressed pre-roll)
+
+    // Compressed microphone uplink (one Ogg stream per session)
+    StreamEncoder _asrEncoder; // Ogg Opus encoder, codec PCM when unused
+
+    // GZIP payloads (window and buffers allocated on first use, reused for every message)
+    static const size_t INFLATE_BUFFER_SIZE = 8192; // Largest decompressed JSON payload
+    GzipInflater _inflater; // Server payload decompression
+    GzipDeflater _deflater; // Request compression
+    uint8_t* _inflateBuffer = nullptr; // Decompressed JSON
+    bool _gzipRequests = false; // Compress JSON requests
+    size_t _gzipMinSize = 512; // Smallest JSON request worth compressing
+
+    // FreeRTOS TTS playback task
+    TaskHandle_t _playbackTaskHandle = nullptr; // Playback task handle
+    static void playbackTaskWrapper(void* param); // Static wrapper for task
+    void playbackTaskLoop(); // Playback task main loop
 
     // Callback functions
     ASRDetectedCallback _asrDetectedCallback = nullptr; // ASR detected callback
@@ -293,7 +388,8 @@ class ArduinoRealtimeDialog {
     String generateWebSocketKey(); // Generate WebSocket key
     String generateSessionId(); // Generate session ID
     void handleWebSocketData(); // Handle WebSocket data
-    void sendWebSocketFrame(uint8_t* data, size_t len, uint8_t opcode); // Send WebSocket frame
+    static void wsMessage(uint8_t opcode, uint8_t* data, size_t len, void* user); // WebSocketEngine message callback
+    void sendWebSocketFrame(const uint8_t* data, size_t len, uint8_t opcode); // Send WebSocket frame
     
     // Protocol related
     void sendStartConnection(); // Send start connection
@@ -301,7 +397,7 @@ class ArduinoRealtimeDialog {
     void sendStartSession(); // Send start session
     void sendFinishSession(); // Send finish session
     void sendAudioChunk(uint8_t* data, size_t len); // Send audio chunk
-    void sendPong(); // Send pong
+    void sendAudioSamples(const int16_t* samples, size_t count); // Encode (if enabled) and send a batch
     
     // Parse response
     void parseResponse(uint8_t* data, size_t len); // Parse response
@@ -309,7 +405,17 @@ class ArduinoRealtimeDialog {
     
     // Audio processing
     void processAudioSending(); // Process audio sending
-    void processTTSAudio(uint8_t* data, size_t len); // Process TTS audio
+    void processTTSAudio(const uint8_t* data, size_t len); // Process TTS audio
+    static void inflatedTTSAudio(const uint8_t* data, size_t len, void* user); // GzipInflater output for TTS audio
+    int32_t inflateJson(const uint8_t* data, size_t len); // Decompress into _inflateBuffer, size or <0
+    void processTTSPlayback(); // Drain jitter buffer to I2S (playback task)
+    void processOpusPlayback(); // Decode jitter buffer to I2S (playback task)
+    void finishTTSPlayback(); // Let DMA flush and report completion (playback task)
+    void interruptTTS(); // Stop the reply for barge-in (loop thread)
+    void abortTTSPlayback(); // Silence DMA and reset the decoder after an interruption (playback task)
+    bool useOpus() const { return _ttsDecoder.codec() == STREAM_CODEC_OPUS && isStreamingActive(); } // Request ogg_opus
+    bool useOpusUplink() const { return _asrEncoder.codec() == STREAM_CODEC_OPUS && _sampleRate == 16000 && _channels == 1; } // Send ogg_opus
+    bool isStreamingActive() const { return _streamingPlayback && _playbackTaskHandle != nullptr; } // Streaming mode usable
 };
 
 #endif
\ No newline at end of file
@@ -14,15 +14,14 @@ ArduinoTTSChat::ArduinoTTSChat(const char* apiKey) {
   _apiKey = apiKey;
 
   // Allocate audio buffer - prefer PSRAM for larger buffer
-  if (psramFound()) {
-    _audioBuffer = (uint8_t*)ps_malloc(AUDIO_BUFFER_SIZE);
-    Serial.printf("Using PSRAM for audio buffer (%d bytes)\n", AUDIO_BUFFER_SIZE);
-  } else {
-    _audioBuffer = new uint8_t[AUDIO_BUFFER_SIZE];
-    Serial.printf("Using heap for audio buffer (%d bytes)\n", AUDIO_BUFFER_SIZE);
+  if (!_audioRing.begin(AUDIO_BUFFER_SIZE, AUDIO_MEM_PSRAM_PREFERRED)) {
+    Serial.printf("Failed to allocate audio buffer (%d bytes)\n", AUDIO_BUFFER_SIZE);
   }
 
-  _msgBuffer = new uint8_t[MSG_BUFFER_SIZE];
+  _metaBuffer = (char*)AudioMemory::alloc(META_BUFFER_SIZE, AUDIO_MEM_INTERNAL_PREFERRED);
+
+  // Messages are parsed while they arrive, the engine never assembles them
+  _ws.onFragment(wsFragment, this);
 }
 
 /**
@@ -31,16 +30,13 @@ ArduinoTTSChat::ArduinoTTSChat(const char* apiKey) {
 ArduinoTTSChat::~ArduinoTTSChat() {
   // Delete audio task if running
   if (_audioTaskHandle != nullptr) {
-    vTaskDelete(_audioTaskHandle);
+    AudioTasks::remove(_audioTaskHandle);
     _audioTaskHandle = nullptr;
   }
-  if (_audioBuffer != nullptr) {
-    delete[] _audioBuffer;
-    _audioBuffer = nullptr;
-  }
-  if (_msgBuffer != nullptr) {
-    delete[] _msgBuffer;
-    _msgBuffer = nullptr;
+  _audioRing.end();
+  if (_metaBuffer != nullptr) {
+    AudioMemory::release(_metaBuffer);
+    _metaBuffer = nullptr;
   }
 }
 
@@ -100,6 +96,38 @@ void ArduinoTTSChat::setAudioParams(int sampleRate, int bitrate) {
   _bitrate = bitrate;
 }
 
+/**
+ * @brief Set audio format requested from the server
+ * @param format "pcm" or "mp3"
+ * @return Whether the format is supported
+ */
+bool ArduinoTTSChat::setAudioFormat(const char* format) {
+  StreamCodec codec;
+  if (strcmp(format, "pcm") == 0) {
+    codec = STREAM_CODEC_PCM;
+  } else if (strcmp(format, "mp3") == 0) {
+    codec = STREAM_CODEC_MP3;
+  } else {
+    // The t2a_v2 WebSocket also offers flac, but there is no streaming decoder for it here
+    Serial.printf("Unsupported audio format: %s (use pcm or mp3)\n", format);
+    return false;
+  }
+
+  if (_isPlaying) {
+    Serial.println("Cannot change audio format while playing");
+    return false;
+  }
+  if (!_decoder.begin(codec)) {
+    _format = "pcm";
+    return false;
+  }
+  _format = format;
+  _decodedLen = 0;
+  _decodedPos = 0;
+  _rateMismatchLogged = false;
+  return true;
+}
+
 /**
  * @brief Initialize MAX98357 I2S speaker
  * @param bclkPin Bit clock pin
@@ -120,19 +148,7 @@ bool ArduinoTTSChat::initMAX98357Speaker(int bclkPin, int lrclkPin, int doutPin)
   Serial.printf("MAX98357 speaker initialized at %d Hz\n", _sampleRate);
   _speakerInitialized = true;
 
-  // Create audio playback task on core 0 (WebSocket runs on core 1)
-  xTaskCreatePinnedToCore(
-    audioTaskWrapper,      // Task function
-    "AudioTask",           // Task name
-    4096,                  // Stack size
-    this,                  // Parameter (this pointer)
-    1,                     // Priority (low)
-    &_audioTaskHandle,     // Task handle
-    0                      // Core 0
-  );
-  Serial.println("Audio playback task created on core 0");
-
-  return true;
+  return startAudioTask();
 }
 
 /**
@@ -167,18 +183,24 @@ bool ArduinoTTSChat::initM5CoreS3Speaker() {
   Serial.printf("M5CoreS3 speaker mode enabled at %d Hz\n", _sampleRate);
   _speakerInitialized = true;
 
-  // Create audio playback task on core 0
-  xTaskCreatePinnedToCore(
-    audioTaskWrapper,
-    "AudioTask",
-    4096,
-    this,
-    1,
-    &_audioTaskHandle,
-    0
-  );
-  Serial.println("Audio playback task created on core 0");
+  return startAudioTask();
+}
 
+/**
+ * @brief Create the audio playback task
+ * @details Scheduled as AUDIO_TASK_PLAYBACK, by default on the core loop() (WebSocket) does not use
+ * @return true if the task is running
+ */
+bool ArduinoTTSChat::startAudioTask() {
+  if (_audioTaskHandle != nullptr) {
+    return true;
+  }
+  _audioTaskHandle = AudioTasks::create(AUDIO_TASK_PLAYBACK, audioTaskWrapper, "AudioTask", this);
+  if (_audioTaskHandle == nullptr) {
+    Serial.println("Audio playback task creation failed!");
+    return false;
+  }
+  Serial.printf("Audio playback task created on core %d\n", AudioTasks::get(AUDIO_TASK_PLAYBACK).core);
   return true;
 }
 
@@ -202,8 +224,32 @@ String ArduinoTTSChat::generateWebSocketKey() {
 /**
  * @brief Connect to MiniMax TTS WebSocket server
  * @return true if connection successful
+ * @details Performs the handshake and records its duration in the session statistics
  */
 bool ArduinoTTSChat::connectWebSocket() {
+  unsigned long start = millis();
+
+  if (!performHandshake()) {
+    _stats.failedHandshakes++;
+    return false;
+  }
+
+  _stats.handshakes++;
+  _stats.lastHandshakeMs = millis() - start;
+  _stats.totalHandshakeMs += _stats.lastHandshakeMs;
+  Serial.printf("Handshake took %lums\n", _stats.lastHandshakeMs);
+
+  _lastRxTime = millis();
+  _pingOutstanding = false;
+  _manualDisconnect = false;
+  return true;
+}
+
+/**
+ * @brief Establish SSL connection and perform WebSocket upgrade
+ * @return true if handshake succeeded
+ */
+bool ArduinoTTSChat::performHandshake() {
   Serial.println("Connecting to MiniMax TTS WebSocket...");
 
   // Skip SSL certificate verification (for testing)
@@ -214,6 +260,7 @@ bool ArduinoTTSChat::connectWebSocket() {
     Serial.println("SSL connection failed");
     return false;
   }
+  TurnMetrics::mark(TURN_TLS_CONNECT);
 
   // Disable Nagle algorithm for low latency
   _client.setNoDelay(true);
@@ -256,8 +303,10 @@ bool ArduinoTTSChat::connectWebSocket() {
   // Check if handshake succeeded
   if (response.indexOf("101") >= 0 && response.indexOf("Switching Protocols") >= 0) {
     Serial.println("WebSocket connected");
+    TurnMetrics::mark(TURN_WS_UPGRADE);
     _wsConnected = true;
     _taskStarted = false;
+    _ws.reset();  // Drop any frame left over from the previous connection
 
     // Wait for connected_success message
     delay(100);
@@ -278,6 +327,7 @@ bool ArduinoTTSChat::connectWebSocket() {
  * @brief Disconnect WebSocket connection
  */
 void ArduinoTTSChat::disconnectWebSocket() {
+  _manualDisconnect = true;
   if (_wsConnected) {
     sendTaskFinish();
     delay(100);
@@ -296,6 +346,84 @@ bool ArduinoTTSChat::isWebSocketConnected() {
   return _wsConnected && _client.connected();
 }
 
+/**
+ * @brief Enable persistent session mode
+ * @param enable true to keep the connection open between utterances
+ * @param pingIntervalMs Keepalive ping interval in milliseconds
+ */
+void ArduinoTTSChat::setPersistentSession(bool enable, unsigned long pingIntervalMs) {
+  _persistentSession = enable;
+  _pingInterval = pingIntervalMs;
+}
+
+/**
+ * @brief Send keepalive ping while idle and detect dead connections
+ * @details Any received frame counts as a reply; an unanswered ping drops the connection,
+ *          which loop() then re-establishes in the background
+ */
+void ArduinoTTSChat::serviceKeepAlive() {
+  unsigned long now = millis();
+
+  if (_pingOutstanding && now - _lastPingTime > PONG_TIMEOUT_MS) {
+    Serial.println("Keepalive ping unanswered, dropping connection");
+    _client.stop();
+    _wsConnected = false;
+    _taskStarted = false;
+    _pingOutstanding = false;
+    return;
+  }
+
+  if (!_pingOutstanding && now - _lastRxTime >= _pingInterval && now - _lastPingTime >= _pingInterval) {
+    sendPing();
+    _lastPingTime = now;
+    _pingOutstanding = true;
+  }
+}
+
+/**
+ * @brief Start background reconnect task
+ * @details Runs the TLS handshake outside loop(); loop() skips socket work until it finishes
+ */
+void ArduinoTTSChat::startBackgroundReconnect() {
+  if (_reconnecting || (_lastReconnectAttempt != 0 && millis() - _lastReconnectAttempt < RECONNECT_INTERVAL_MS)) {
+    return;
+  }
+  _lastReconnectAttempt = millis();
+  _reconnecting = true;
+
+  // TLS handshake needs a larger stack than the audio task
+  if (AudioTasks::create(AUDIO_TASK_RECONNECT, reconnectTaskWrapper, "TTSReconnect", this) == nullptr) {
+    Serial.println("Reconnect task creation failed!");
+    _reconnecting = false;
+  }
+}
+
+/**
+ * @brief Background reconnect task
+ * @param param Pointer to ArduinoTTSChat instance
+ */
+void ArduinoTTSChat::reconnectTaskWrapper(void* param) {
+  ArduinoTTSChat* instance = static_cast<ArduinoTTSChat*>(param);
+  Serial.println("Reconnecting WebSocket in background...");
+  instance->_client.stop();
+  instance->connectWebSocket();
+  instance->_reconnecting = false;
+  AudioTasks::exit();
+}
+
+/**
+ * @brief Wait for background reconnect to finish
+ * @param timeoutMs Maximum wait time in milliseconds
+ * @return true if no reconnect is running any more
+ */
+bool ArduinoTTSChat::waitForReconnect(unsigned long timeoutMs) {
+  unsigned long start = millis();
+  while (_reconnecting && millis() - start < timeoutMs) {
+    delay(10);
+  }
+  return !_reconnecting;
+}
+
 /**
  * @brief Start TTS task
  * @return true if task started successfully
@@ -332,11 +460,115 @@ bool ArduinoTTSChat::startTask() {
  * @return true if synthesis started successfully
  */
 bool ArduinoTTSChat::speak(const char* text) {
+  TurnMetrics::beginTurn(false);  // Part of the running turn if ASR began one
+
+  if (_cache != nullptr && playCached(text)) {
+    return true;
+  }
+
+  if (!prepareSession()) {
+    return false;
+  }
+
+  Serial.printf("Synthesizing: %s\n", text);
+
+  resetPlaybackState();
+  _pendingSegments = 1;
+  if (_cache != nullptr) {
+    _cache->beginWrite(cacheKey(text), _format);  // Committed on is_final
+  }
+
+  // Send task_continue with text
+  sendTaskContinue(text);
+
+  return true;
+}
+
+/**
+ * @brief Open an incremental text stream
+ * @return true if the stream is open and appendText() may be called
+ */
+bool ArduinoTTSChat::beginTextStream() {
+  TurnMetrics::beginTurn(false);
+
+  if (!prepareSession()) {
+    return false;
+  }
+
+  Serial.println("Text stream opened");
+
+  resetPlaybackState();
+  _pendingSegments = 0;
+  _textStreamOpen = true;
+  return true;
+}
+
+/**
+ * @brief Append text to the open stream
+ * @param text Text segment to synthesize after the previous ones
+ * @return true if the segment was sent
+ */
+bool ArduinoTTSChat::appendText(const char* text) {
+  if (!_textStreamOpen || !_wsConnected) {
+    Serial.println("Text stream not open!");
+    return false;
+  }
+
+  Serial.printf("Appending: %s\n", text);
+
+  _pendingSegments++;
+  sendTaskContinue(text);
+  return true;
+}
+
+/**
+ * @brief Close the text stream
+ *
+ * Playback completes (and the completion callback fires) once every appended
+ * segment has been synthesized and played.
+ */
+void ArduinoTTSChat::endTextStream() {
+  if (!_textStreamOpen) {
+    return;
+  }
+  _textStreamOpen = false;
+
+  // Nothing was appended, there is no audio to wait for
+  if (_isPlaying && _pendingSegments == 0 && _chunksReceived == 0) {
+    Serial.println("Text stream closed without text");
+    _isPlaying = false;
+    if (_completionCallback != nullptr) {
+      _completionCallback();
+    }
+  }
+}
+
+/**
+ * @brief Make sure the connection and TTS task are ready for new text
+ * @return true if task_continue messages can be sent
+ */
+bool ArduinoTTSChat::prepareSession() {
+  // Let a background reconnect finish before touching the socket
+  if (_reconnecting && !waitForReconnect(10000)) {
+    Serial.println("Background reconnect still running!");
+    return false;
+  }
+
+  // Persistent session: lost connection is re-established here if the background attempt failed
+  if (_persistentSession && !isWebSocketConnected()) {
+    _wsConnected = false;
+    _taskStarted = false;
+    if (!connectWebSocket()) {
+      return false;
+    }
+  }
+
   if (!_wsConnected) {
     Serial.println("WebSocket not connected!");
     return false;
   }
 
+  bool reused = _taskStarted;
   if (!_taskStarted) {
     if (!startTask()) {
       return false;
@@ -348,22 +580,101 @@ bool ArduinoTTSChat::speak(const char* text) {
     return false;
   }
 
-  Serial.printf("Synthesizing: %s\n", text);
+  if (reused) {
+    _stats.reusedSessions++;
+  }
+
+  return true;
+}
 
-  // Reset ring buffer state
+/**
+ * @brief Set phrase cache
+ * @param cache Opened cache, nullptr to disable
+ */
+void ArduinoTTSChat::setCache(TTSPhraseCache* cache) {
+  _cache = cache;
+}
+
+/**
+ * @brief Phrase cache key: text plus every setting that changes the audio
+ */
+uint64_t ArduinoTTSChat::cacheKey(const char* text) {
+  char extra[96];
+  snprintf(extra, sizeof(extra), "%s|%.2f|%d|%d|%d|%d", _model, _volume, _sampleRate, _bitrate, _channels,
+           _englishNorm ? 1 : 0);
+  return TTSPhraseCache::makeKey(text, _voiceId, _speed, _pitch, _format, extra);
+}
+
+/**
+ * @brief Play a cached phrase through the ring buffer, no connection needed
+ * @param text Text to look up
+ * @return true if the phrase was cached and playback started
+ */
+bool ArduinoTTSChat::playCached(const char* text) {
+  if (_isPlaying || !_speakerInitialized) {
+    return false;
+  }
+
+  String path;
+  if (!_cache->lookup(cacheKey(text), path)) {
+    return false;
+  }
+  _cacheFile = _cache->fileSystem().open(path, FILE_READ);
+  if (!_cacheFile) {
+    return false;
+  }
+
+  Serial.printf("Playing cached: %s\n", text);
+
+  resetPlaybackState();
+  _pendingSegments = 1;  // Cleared once the whole file is in the ring
+  _chunksReceived = 1;
+  _receivingAudio = true;
+  _playingCached = true;
+  pumpCachedAudio();
+  return true;
+}
+
+/**
+ * @brief Move cached phrase data into the ring, as much as fits
+ *
+ * Called from speak() and loop(); reads are bounded so loop() stays responsive
+ * while a long phrase is fed in.
+ */
+void ArduinoTTSChat::pumpCachedAudio() {
+  for (int i = 0; i < 8; i++) {
+    size_t span;
+    uint8_t* dst = _audioRing.writeSpan(span);
+    if (span == 0) {
+      return;  // Ring full, continue on the next loop()
+    }
+    int n = _cacheFile.read(dst, min(span, CACHE_READ_SIZE));
+    if (n <= 0) {
+      _cacheFile.close();
+      _playingCached = false;
+      _receivingAudio = false;
+      _pendingSegments = 0;
+      return;
+    }
+    _audioRing.commitWrite(n);
+  }
+}
+
+/**
+ * @brief Reset ring buffer and mark playback as started
+ */
+void ArduinoTTSChat::resetPlaybackState() {
   _isPlaying = true;
   _shouldStop = false;
   _receivingAudio = false;
-  _audioWritePos = 0;
-  _audioReadPos = 0;
-  _audioDataSize = 0;
+  _textStreamOpen = false;
+  _decoderResetPending = true;
+  _audioRing.discard();
   _chunksReceived = 0;
   _playStartTime = millis();
-
-  // Send task_continue with text
-  sendTaskContinue(text);
-
-  return true;
+  if (_cache != nullptr) {
+    _cache->abortWrite();
+  }
 }
 
 /**
@@ -381,27 +692,58 @@ void ArduinoTTSChat::stop() {
   _shouldStop = true;
   _isPlaying = false;
   _receivingAudio = false;
-  _audioWritePos = 0;
-  _audioReadPos = 0;
-  _audioDataSize = 0;
+  _textStreamOpen = false;
+  _pendingSegments = 0;
+  _decoderResetPending = true;
+  _audioRing.discard();
+  if (_playingCached) {
+    _playingCached = false;
+    _cacheFile.close();
+  }
+  if (_cache != nullptr) {
+    _cache->abortWrite();
+  }
 }
 
 /**
  * @brief Main loop processing function
  */
 void ArduinoTTSChat::loop() {
+  // Cached phrase plays without the connection
+  if (_playingCached) {
+    pumpCachedAudio();
+  }
+
+  // Socket belongs to the reconnect task until it finishes
+  if (_reconnecting) {
+    return;
+  }
+
   // Check connection status
   if (_wsConnected && !_client.connected()) {
     Serial.println("Connection lost");
+    if (_cache != nullptr) {
+      _cache->abortWrite();
+    }
     _wsConnected = false;
     _isPlaying = false;
     _taskStarted = false;
+    _textStreamOpen = false;
   }
 
+  // If not connected, return directly (persistent mode reconnects in background)
   if (!_wsConnected) {
+    if (_persistentSession && !_manualDisconnect) {
+      startBackgroundReconnect();
+    }
     return;
   }
 
+  // Keep idle connection warm
+  if (_persistentSession && !_isPlaying) {
+    serviceKeepAlive();
+  }
+
   // Process incoming WebSocket data only
   // Audio playback is handled by separate FreeRTOS task
   while (_client.available()) {
@@ -500,199 +842,261 @@ void ArduinoTTSChat::sendTaskFinish() {
  */
 void ArduinoTTSChat::sendTextFrame(const char* text) {
   size_t len = strlen(text);
-  sendWebSocketFrame((uint8_t*)text, len, 0x01);  // 0x01 = text frame
+  sendWebSocketFrame((const uint8_t*)text, len, 0x01);  // 0x01 = text frame
 }
 
 /**
  * @brief Send WebSocket frame
- * @param data Data to send
+ * @param data Data to send (not modified)
  * @param len Data length
  * @param opcode WebSocket opcode
  */
-void ArduinoTTSChat::sendWebSocketFrame(uint8_t* data, size_t len, uint8_t opcode) {
+void ArduinoTTSChat::sendWebSocketFrame(const uint8_t* data, size_t len, uint8_t opcode) {
   if (!_wsConnected || !_client.connected()) return;
+  _ws.sendFrame(_client, opcode, data, len);
+}
 
-  // Build WebSocket frame header
-  uint8_t header[14];
-  int header_len = 2;
-
-  header[0] = 0x80 | opcode;  // FIN=1 + opcode
-  header[1] = 0x80;           // MASK=1
-
-  // Length encoding
-  if (len < 126) {
-    header[1] |= len;
-  } else if (len < 65536) {
-    header[1] |= 126;
-    header[2] = (len >> 8) & 0xFF;
-    header[3] = len & 0xFF;
-    header_len = 4;
-  } else {
-    header[1] |= 127;
-    for (int i = 0; i < 8; i++) {
-      header[2 + i] = (len >> (56 - i * 8)) & 0xFF;
-    }
-    header_len = 10;
-  }
+/**
+ * @brief Send Ping frame
+ * @details Keepalive for persistent sessions, any server frame clears the outstanding ping
+ */
+void ArduinoTTSChat::sendPing() {
+  uint8_t ping_data[1] = {0};
+  sendWebSocketFrame(ping_data, 0, 0x09);  // 0x09 = Ping frame
+}
 
-  // Generate random mask key
-  uint8_t mask_key[4];
-  for (int i = 0; i < 4; i++) {
-    mask_key[i] = random(0, 256);
+/**
+ * @brief Handle received WebSocket data
+ * @details Feeds whatever the socket has to the frame parser without waiting. Message
+ *          bytes go through wsFragment() to the streaming parser as they arrive, so a
+ *          message of any size never has to be held in memory.
+ */
+void ArduinoTTSChat::handleWebSocketData() {
+  int consumed = _ws.poll(_client);
+  if (consumed < 0) {
+    Serial.println("Server closed connection");
+    _wsConnected = false;
+    _client.stop();
+    return;
   }
-  memcpy(header + header_len, mask_key, 4);
-  header_len += 4;
 
-  // Send frame header
-  _client.write(header, header_len);
+  // Any data proves the connection is alive
+  if (consumed > 0) {
+    _lastRxTime = millis();
+    _pingOutstanding = false;
+  }
+}
 
-  // Mask data and send
-  uint8_t* masked_data = new uint8_t[len];
-  for (size_t i = 0; i < len; i++) {
-    masked_data[i] = data[i] ^ mask_key[i % 4];
+/**
+ * @brief WebSocketEngine fragment callback, drives beginMessage / feedMessage / endMessage
+ */
+void ArduinoTTSChat::wsFragment(uint8_t opcode, const uint8_t* data, size_t len, bool first, bool last, void* user) {
+  ArduinoTTSChat* self = (ArduinoTTSChat*)user;
+  if (first) {
+    self->beginMessage();
+  }
+  if (len > 0) {
+    self->feedMessage(data, len);
+  }
+  if (last) {
+    self->endMessage();
   }
-  _client.write(masked_data, len);
-  delete[] masked_data;
 }
 
+// Hex digit value lookup, non-hex characters decode as 0
+static const uint8_t HEX_NIBBLE[256] = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
 /**
- * @brief Send Pong response
+ * @brief Start parsing a new WebSocket text message
  */
-void ArduinoTTSChat::sendPong() {
-  uint8_t pong_data[1] = {0};
-  sendWebSocketFrame(pong_data, 0, 0x0A);  // 0x0A = Pong frame
+void ArduinoTTSChat::beginMessage() {
+  _msgInProgress = true;
+  _metaLen = 0;
+  _metaOverflow = false;
+  _audioKeyMatch = 0;
+  _inAudioValue = false;
+  _dropAudio = false;
+  _pendingNibble = -1;
+  _msgAudioBytes = 0;
 }
 
 /**
- * @brief Read exact number of bytes with timeout
- * @param buffer Buffer to read into
- * @param len Number of bytes to read
- * @param timeout_ms Timeout in milliseconds
- * @return Number of bytes actually read
+ * @brief Feed message bytes to the streaming parser
+ * @param data Unmasked payload bytes
+ * @param len Number of bytes
+ *
+ * Everything except the value of the "audio" field is copied to the metadata
+ * buffer; the hex audio value is decoded straight into the ring buffer.
  */
-size_t ArduinoTTSChat::readBytesWithTimeout(uint8_t* buffer, size_t len, unsigned long timeout_ms) {
-  size_t total_read = 0;
-  unsigned long start = millis();
+void ArduinoTTSChat::feedMessage(const uint8_t* data, size_t len) {
+  static const char AUDIO_KEY[] = "\"audio\"";
+  static const uint8_t AUDIO_KEY_LEN = sizeof(AUDIO_KEY) - 1;
+
+  size_t i = 0;
+  while (i < len) {
+    if (_inAudioValue) {
+      // Hex run up to the closing quote
+      const char* run = (const char*)data + i;
+      const char* quote = (const char*)memchr(run, '"', len - i);
+      size_t runLen = quote ? (size_t)(quote - run) : len - i;
+      decodeAudioHex(run, runLen);
+      i += runLen;
+      if (quote) {
+        _inAudioValue = false;
+        _pendingNibble = -1;
+        appendMeta('"');
+        i++;
+      }
+      continue;
+    }
 
-  while (total_read < len && (millis() - start) < timeout_ms) {
-    if (_client.available()) {
-      size_t to_read = min(len - total_read, (size_t)_client.available());
-      size_t read_now = _client.readBytes(buffer + total_read, to_read);
-      total_read += read_now;
-      start = millis();  // Reset timeout on successful read
+    char c = (char)data[i++];
+    appendMeta(c);
+
+    // Match "audio" then ':' then the opening quote, whitespace allowed around ':'
+    if (_audioKeyMatch < AUDIO_KEY_LEN) {
+      if (c == AUDIO_KEY[_audioKeyMatch]) {
+        _audioKeyMatch++;
+      } else {
+        _audioKeyMatch = (c == '"') ? 1 : 0;
+      }
+    } else if (_audioKeyMatch == AUDIO_KEY_LEN) {
+      if (c == ':') _audioKeyMatch++;
+      else if (c != ' ') _audioKeyMatch = (c == '"') ? 1 : 0;
     } else {
-      delay(1);
+      if (c == '"') {
+        _inAudioValue = true;
+        _audioKeyMatch = 0;
+      } else if (c != ' ') {
+        _audioKeyMatch = 0;  // Not a string value (e.g. null)
+      }
     }
   }
+}
+
+/**
+ * @brief Finish a message and parse its metadata
+ */
+void ArduinoTTSChat::endMessage() {
+  _msgInProgress = false;
+  if (_metaOverflow) {
+    Serial.printf("Message metadata truncated (%d bytes kept)\n", (int)_metaLen);
+  }
+  _metaBuffer[_metaLen] = '\0';
+  parseJsonResponse(_metaBuffer, _metaLen);
+}
 
-  return total_read;
+/**
+ * @brief Append a metadata character, dropping input beyond the buffer size
+ */
+void ArduinoTTSChat::appendMeta(char c) {
+  if (_metaLen < META_BUFFER_SIZE - 1) {
+    _metaBuffer[_metaLen++] = c;
+  } else {
+    _metaOverflow = true;
+  }
 }
 
 /**
- * @brief Handle received WebSocket data
+ * @brief Decode a run of hex characters into the audio ring buffer
+ * @param hex Hex characters (may start or end in the middle of a byte)
+ * @param len Number of characters
+ *
+ * Waits for the playback task to free space while playing, so a fast server is
+ * throttled by the socket instead of overrunning the ring.
  */
-void ArduinoTTSChat::handleWebSocketData() {
-  // Read WebSocket frame header (2 bytes)
-  uint8_t header[2];
-  if (readBytesWithTimeout(header, 2, 1000) != 2) {
+void ArduinoTTSChat::decodeAudioHex(const char* hex, size_t len) {
+  if (len == 0 || _dropAudio) {
     return;
   }
 
-  bool fin = header[0] & 0x80;              // FIN flag - 1 means final frame
-  uint8_t opcode = header[0] & 0x0F;        // Opcode
-  bool masked = header[1] & 0x80;
-  uint64_t payload_len = header[1] & 0x7F;
-
-  // Handle extended length
-  if (payload_len == 126) {
-    uint8_t len_bytes[2];
-    if (readBytesWithTimeout(len_bytes, 2, 1000) != 2) return;
-    payload_len = (len_bytes[0] << 8) | len_bytes[1];
-  } else if (payload_len == 127) {
-    uint8_t len_bytes[8];
-    if (readBytesWithTimeout(len_bytes, 8, 1000) != 8) return;
-    payload_len = 0;
-    for (int i = 0; i < 8; i++) {
-      payload_len = (payload_len << 8) | len_bytes[i];
+  if (_msgAudioBytes == 0) {
+    _chunksReceived++;
+    _receivingAudio = true;
+    if (_chunksReceived == 1) {
+      TurnMetrics::mark(TURN_TTS_FIRST_BYTE);
+      unsigned long delay_ms = millis() - _playStartTime;
+      Serial.printf("First audio chunk received (delay: %lums)\n", delay_ms);
     }
   }
 
-  // Read mask key (if present)
-  uint8_t mask_key[4] = {0};
-  if (masked) {
-    if (readBytesWithTimeout(mask_key, 4, 1000) != 4) return;
+  size_t pos = 0;
+
+  // Finish a byte split across reads
+  if (_pendingNibble >= 0) {
+    uint8_t value = (uint8_t)((_pendingNibble << 4) | HEX_NIBBLE[(uint8_t)hex[0]]);
+    pos = 1;
+    _pendingNibble = -1;
+    if (!writeAudioBytes(&value, 1)) return;
   }
 
-  // Read payload data
-  if (payload_len > 0 && payload_len < 200000) {
-    uint8_t* payload = (uint8_t*)malloc(payload_len + 1);
-    if (payload == nullptr) {
-      Serial.println("Failed to allocate payload buffer");
-      return;
+  while (len - pos >= 2) {
+    size_t span;
+    uint8_t* dst = _audioRing.writeSpan(span);
+    if (span == 0) {
+      if (!writeAudioBytes(nullptr, 0)) return;  // Wait for space
+      continue;
     }
+    size_t n = min((len - pos) / 2, span);
+    size_t written = hexToBytes(hex + pos, n * 2, dst, n);
+    _audioRing.commitWrite(written);
+    _msgAudioBytes += written;
+    if (_cache != nullptr && _cache->writing()) {
+      _cache->write(dst, written);
+    }
+    pos += n * 2;
+  }
 
-    size_t bytes_read = readBytesWithTimeout(payload, payload_len, 10000);
-
-    if (bytes_read == payload_len) {
-      // Unmask
-      if (masked) {
-        for (size_t i = 0; i < payload_len; i++) {
-          payload[i] ^= mask_key[i % 4];
-        }
-      }
+  if (pos < len) {
+    _pendingNibble = HEX_NIBBLE[(uint8_t)hex[pos]];
+  }
+  TurnMetrics::ringFill(_audioRing.buffered(), _audioRing.capacity());
+}
 
-      // Handle message fragmentation
-      // opcode 0x00 = continuation frame
-      // opcode 0x01 = text frame (start of new message)
-      // opcode 0x02 = binary frame
-      // FIN=1 means this is the final fragment
-
-      if (opcode == 0x01 || opcode == 0x02) {
-        // Start of a new message
-        if (fin) {
-          // Complete message in one frame
-          payload[payload_len] = '\0';
-          parseJsonResponse((char*)payload, payload_len);
-        } else {
-          // First fragment of multi-frame message
-          _msgInProgress = true;
-          _msgBufferPos = 0;
-          if (payload_len < MSG_BUFFER_SIZE) {
-            memcpy(_msgBuffer, payload, payload_len);
-            _msgBufferPos = payload_len;
-          }
-        }
-      } else if (opcode == 0x00) {
-        // Continuation frame
-        if (_msgInProgress && _msgBuffer != nullptr) {
-          if (_msgBufferPos + payload_len < MSG_BUFFER_SIZE) {
-            memcpy(_msgBuffer + _msgBufferPos, payload, payload_len);
-            _msgBufferPos += payload_len;
-          }
-
-          if (fin) {
-            // Final fragment - process complete message
-            _msgBuffer[_msgBufferPos] = '\0';
-            parseJsonResponse((char*)_msgBuffer, _msgBufferPos);
-            _msgInProgress = false;
-            _msgBufferPos = 0;
-          }
-        }
-      } else if (opcode == 0x08) {  // Close
-        Serial.println("Server closed connection");
-        _wsConnected = false;
-        _client.stop();
-      } else if (opcode == 0x09) {  // Ping
-        sendPong();
+/**
+ * @brief Write decoded bytes to the ring buffer, waiting for space if needed
+ * @param data Bytes to write (nullptr to only wait for free space)
+ * @param len Number of bytes
+ * @return false if the rest of this audio value is dropped
+ */
+bool ArduinoTTSChat::writeAudioBytes(const uint8_t* data, size_t len) {
+  unsigned long start = millis();
+  while (_audioRing.space() < (len > 0 ? len : 1)) {
+    if (!_isPlaying || _shouldStop || millis() - start > AUDIO_SPACE_TIMEOUT_MS) {
+      Serial.printf("Buffer full: dropping audio (%d bytes free)\n", (int)_audioRing.space());
+      _dropAudio = true;
+      TurnMetrics::overrun();
+      if (_cache != nullptr) {
+        _cache->abortWrite();  // Phrase is incomplete
       }
-    } else {
-      Serial.printf("Incomplete read: got %d of %d bytes\n", (int)bytes_read, (int)payload_len);
+      return false;
     }
+    vTaskDelay(1);
+  }
 
-    free(payload);
-  } else if (payload_len >= 200000) {
-    Serial.printf("Payload too large: %d bytes\n", (int)payload_len);
+  _audioRing.write(data, len);
+  _msgAudioBytes += len;
+  if (len > 0 && _cache != nullptr && _cache->writing()) {
+    _cache->write(data, len);
   }
+  return true;
 }
 
 /**
@@ -701,13 +1105,8 @@ void ArduinoTTSChat::handleWebSocketData() {
  * @param len String length
  */
 void ArduinoTTSChat::parseJsonResponse(const char* json, size_t len) {
-  // Use dynamic JSON document - audio responses can be very large (hex encoded)
-  // Allocate based on input length + overhead
-  size_t docSize = len + 1024;
-  if (docSize < 4096) docSize = 4096;
-  if (docSize > 200000) docSize = 200000;  // Cap at 200KB
-
-  DynamicJsonDocument doc(docSize);
+  // Audio was already decoded by the message parser, only metadata remains
+  DynamicJsonDocument doc(4096);
   DeserializationError error = deserializeJson(doc, json, len);
 
   if (error) {
@@ -738,59 +1137,25 @@ void ArduinoTTSChat::parseJsonResponse(const char* json, size_t len) {
     } else if (strcmp(event, "error") == 0) {
       const char* errMsg = doc["message"] | "Unknown error";
       Serial.printf("Error: %s\n", errMsg);
+      if (_cache != nullptr) {
+        _cache->abortWrite();
+      }
       if (_errorCallback != nullptr) {
         _errorCallback(errMsg);
       }
     }
   }
 
-  // Check for audio data
-  if (doc.containsKey("data") && doc["data"].containsKey("audio")) {
-    const char* audioHex = doc["data"]["audio"];
-    if (audioHex != nullptr && strlen(audioHex) > 0) {
-      _chunksReceived++;
-      _receivingAudio = true;
-
-      if (_chunksReceived == 1) {
-        unsigned long delay_ms = millis() - _playStartTime;
-        Serial.printf("First audio chunk received (delay: %lums)\n", delay_ms);
-      }
-
-      // Convert hex to bytes
-      size_t hexLen = strlen(audioHex);
-      size_t bytesNeeded = hexLen / 2;
-
-      // Check if we have enough space in ring buffer
-      size_t freeSpace = AUDIO_BUFFER_SIZE - _audioDataSize;
-
-      if (bytesNeeded <= freeSpace) {
-        // Write to ring buffer (may wrap around)
-        for (size_t i = 0; i < hexLen; i += 2) {
-          uint8_t high = 0, low = 0;
-          char c = audioHex[i];
-          if (c >= '0' && c <= '9') high = c - '0';
-          else if (c >= 'a' && c <= 'f') high = c - 'a' + 10;
-          else if (c >= 'A' && c <= 'F') high = c - 'A' + 10;
-
-          c = audioHex[i + 1];
-          if (c >= '0' && c <= '9') low = c - '0';
-          else if (c >= 'a' && c <= 'f') low = c - 'a' + 10;
-          else if (c >= 'A' && c <= 'F') low = c - 'A' + 10;
-
-          _audioBuffer[_audioWritePos] = (high << 4) | low;
-          _audioWritePos = (_audioWritePos + 1) % AUDIO_BUFFER_SIZE;
-        }
-        _audioDataSize += bytesNeeded;
-      } else {
-        Serial.printf("Buffer full: need %d, free %d\n", (int)bytesNeeded, (int)freeSpace);
-      }
-    }
-  }
-
   // Check if final
   if (doc.containsKey("is_final") && doc["is_final"].as<bool>()) {
     Serial.printf("Audio synthesis completed: %d chunks received\n", _chunksReceived);
-    _receivingAudio = false;
+    if (_pendingSegments > 0) {
+      _pendingSegments--;
+    }
+    _receivingAudio = _pendingSegments > 0;
+    if (_pendingSegments == 0 && _cache != nullptr && _cache->writing()) {
+      _cache->commitWrite();
+    }
   }
 }
 
@@ -803,21 +1168,11 @@ void ArduinoTTSChat::parseJsonResponse(const char* json, size_t len) {
  * @return Number of bytes converted
  */
 size_t ArduinoTTSChat::hexToBytes(const char* hex, size_t hexLen, uint8_t* output, size_t outputSize) {
-  size_t byteCount = 0;
-  for (size_t i = 0; i < hexLen && byteCount < outputSize; i += 2) {
-    uint8_t high = 0, low = 0;
-
-    char c = hex[i];
-    if (c >= '0' && c <= '9') high = c - '0';
-    else if (c >= 'a' && c <= 'f') high = c - 'a' + 10;
-    else if (c >= 'A' && c <= 'F') high = c - 'A' + 10;
-
-    c = hex[i + 1];
-    if (c >= '0' && c <= '9') low = c - '0';
-    else if (c >= 'a' && c <= 'f') low = c - 'a' + 10;
-    else if (c >= 'A' && c <= 'F') low = c - 'A' + 10;
-
-    output[byteCount++] = (high << 4) | low;
+  size_t byteCount = min(hexLen / 2, outputSize);
+  const uint8_t* in = (const uint8_t*)hex;
+  for (size_t i = 0; i < byteCount; i++) {
+    output[i] = (uint8_t)((HEX_NIBBLE[in[0]] << 4) | HEX_NIBBLE[in[1]]);
+    in += 2;
   }
   return byteCount;
 }
@@ -826,50 +1181,49 @@ size_t ArduinoTTSChat::hexToBytes(const char* hex, size_t hexLen, uint8_t* outpu
  * @brief Process audio playback from ring buffer
  */
 void ArduinoTTSChat::processAudioPlayback() {
-  // Play available audio data from ring buffer
-  while (_audioDataSize > 0) {
-    // Calculate contiguous bytes available from read position
-    size_t contiguous = AUDIO_BUFFER_SIZE - _audioReadPos;
-    size_t dataSize = _audioDataSize;  // Copy volatile to local
-    size_t toRead = min(dataSize, contiguous);
+  if (_decoder.codec() != STREAM_CODEC_PCM) {
+    playDecodedAudio();
+  }
+
+  // Play available audio data straight from the ring
+  while (_decoder.codec() == STREAM_CODEC_PCM) {
+    // Contiguous bytes available from read position
+    size_t toRead;
+    const uint8_t* span = _audioRing.readSpan(toRead);
     toRead = min(toRead, (size_t)4096);  // Max 4KB per write
     toRead = (toRead / 2) * 2;  // Align to 16-bit boundary
 
     if (toRead > 0) {
-      size_t written = 0;
-
-      if (_speakerType == SPEAKER_TYPE_M5CORES3) {
-        // M5CoreS3 mode: use callback to play audio
-        if (_audioPlayCallback != nullptr) {
-          // Convert bytes to samples (16-bit audio = 2 bytes per sample)
-          size_t samples = toRead / 2;
-          if (_audioPlayCallback((const int16_t*)(_audioBuffer + _audioReadPos), samples, _sampleRate)) {
-            written = toRead;
-          }
-        }
-      } else {
-        // MAX98357 or Internal DAC mode: use I2S write
-        written = _I2S.write(_audioBuffer + _audioReadPos, toRead);
-      }
+      size_t written = playPCM(span, toRead, _sampleRate);
 
       if (written == 0) {
         // Buffer full or callback failed, try again next loop
         break;
       }
-      _audioReadPos = (_audioReadPos + written) % AUDIO_BUFFER_SIZE;
-      _audioDataSize -= written;
+      _audioRing.commitRead(written);
     } else {
       break;
     }
   }
 
+  // Count each time playback runs dry while the server is still sending
+  bool dry = _decoder.codec() == STREAM_CODEC_PCM ? _audioRing.available() < 2 : _decodedPos >= _decodedLen;
+  if (!dry) {
+    _starved = false;
+  } else if (_isPlaying && _receivingAudio && _chunksReceived > 0 && !_starved) {
+    _starved = true;
+    TurnMetrics::underrun();
+  }
+
   // Check if playback is complete
-  if (!_receivingAudio && _audioDataSize == 0 && _chunksReceived > 0) {
+  // Open text stream may still deliver segments, keep waiting through gaps
+  if (!_textStreamOpen && _pendingSegments == 0 && _audioRing.available() < 2 && _chunksReceived > 0 &&
+      _decoder.pending() == 0 && _decodedPos >= _decodedLen) {
     Serial.println("Playback complete");
+    TurnMetrics::mark(TURN_LAST_SAMPLE);
     _isPlaying = false;
-    _audioWritePos = 0;
-    _audioReadPos = 0;
-    _audioDataSize = 0;
+    _audioRing.discard();
+    _decoder.reset();
     _chunksReceived = 0;
 
 	// Keep task alive for subsequent speak() calls
@@ -881,6 +1235,84 @@ void ArduinoTTSChat::processAudioPlayback() {
   }
 }
 
+/**
+ * @brief Decode compressed audio from the ring and play it
+ *
+ * Runs in the audio task, which owns the decoder context. A frame that the
+ * speaker does not take at once is kept and finished on the next pass.
+ */
+void ArduinoTTSChat::playDecodedAudio() {
+  // Once all segments are final nothing more arrives, so a truncated last frame is dropped
+  bool flush = !_textStreamOpen && _pendingSegments == 0;
+
+  for (int frames = 0; frames < 8; frames++) {
+    if (_decodedPos >= _decodedLen) {
+      _decodedLen = _decoder.decode(_audioRing, flush);
+      _decodedPos = 0;
+      if (_decodedLen == 0) {
+        break;
+      }
+      if (_decoder.sampleRate() != (uint32_t)_sampleRate && !_rateMismatchLogged) {
+        Serial.printf("Decoded audio is %u Hz, resampling to the speaker's %d Hz\n", (unsigned)_decoder.sampleRate(), _sampleRate);
+        _rateMismatchLogged = true;
+      }
+    }
+
+    const uint8_t* pcm = (const uint8_t*)(_decoder.pcm() + _decodedPos);
+    size_t written = playPCM(pcm, (_decodedLen - _decodedPos) * 2, _decoder.sampleRate());
+    if (written == 0) {
+      break;
+    }
+    _decodedPos += written / 2;
+  }
+}
+
+/**
+ * @brief Write 16-bit mono PCM to the speaker
+ * @param data PCM bytes
+ * @param len Number of bytes (even)
+ * @param sampleRate Sample rate of data, passed to the playback callback or resampled to the I2S rate
+ * @return Bytes accepted, 0 if the speaker is busy
+ */
+size_t ArduinoTTSChat::playPCM(const uint8_t* data, size_t len, int sampleRate) {
+  if (_speakerType == SPEAKER_TYPE_M5CORES3) {
+    // M5CoreS3 mode: use callback to play audio
+    if (_audioPlayCallback != nullptr) {
+      // Convert bytes to samples (16-bit audio = 2 bytes per sample)
+      size_t samples = len / 2;
+      if (_audioPlayCallback((const int16_t*)data, samples, sampleRate)) {
+        TurnMetrics::mark(TURN_FIRST_SAMPLE);
+        return len;
+      }
+    }
+    return 0;
+  }
+  // MAX98357 or Internal DAC mode: use I2S write
+  size_t written = 0;
+  if (sampleRate == _sampleRate || !_resampler.begin(sampleRate, _sampleRate, 1)) {
+    written = _I2S.write(data, len);
+  } else {
+    // I2S keeps running at the configured rate, streams of another rate are converted
+    written = _resampler.processTo((const int16_t*)data, len / 2, writeResampled, this) * 2;
+  }
+  if (written > 0) {
+    TurnMetrics::mark(TURN_FIRST_SAMPLE);  // Only the first of the turn is kept
+  }
+  return written;
+}
+
+/**
+ * @brief AudioResampler sink, writes converted mono frames to the I2S speaker
+ * @param frames Resampled PCM
+ * @param count Number of frames
+ * @param user Pointer to ArduinoTTSChat instance
+ * @return Frames written
+ */
+size_t ArduinoTTSChat::writeResampled(const int16_t* frames, size_t count, void* user) {
+  ArduinoTTSChat* instance = static_cast<ArduinoTTSChat*>(user);
+  return instance->_I2S.write((const uint8_t*)frames, count * 2) / 2;
+}
+
 /**
  * @brief Static wrapper for FreeRTOS task
  * @param param Pointer to ArduinoTTSChat instance
@@ -895,6 +1327,14 @@ void ArduinoTTSChat::audioTaskWrapper(void* param) {
  */
 void ArduinoTTSChat::audioTaskLoop() {
   while (true) {
+    if (_decoderResetPending) {
+      // Decoder state belongs to this task, so stop()/speak() only request the reset
+      _decoderResetPending = false;
+      _decoder.reset();
+      _resampler.reset();
+      _decodedLen = 0;
+      _decodedPos = 0;
+    }
     if (_isPlaying && _speakerInitialized) {
       processAudioPlayback();
     }
@@ -6,6 +6,14 @@
 #include <ArduinoJson.h>
 #include <ESP_I2S.h>
 #include <mbedtls/base64.h>
+#include "AudioMemory.h"
+#include "AudioRingBuffer.h"
+#include "AudioTasks.h"
+#include "StreamDecoder.h"
+#include "AudioResampler.h"
+#include "WebSocketEngine.h"
+#include "TTSPhraseCache.h"
+#include "TurnMetrics.h"
 
 /**
  * @file ArduinoTTSChat.h
@@ -25,6 +33,18 @@ enum SpeakerType {
 };
 #endif
 
+// WebSocket session statistics (if not defined)
+#ifndef WS_SESSION_STATS_DEFINED
+#define WS_SESSION_STATS_DEFINED
+struct WSSessionStats {
+  uint32_t handshakes = 0;             // Successful TLS + WebSocket handshakes
+  uint32_t failedHandshakes = 0;       // Failed connection attempts
+  uint32_t reusedSessions = 0;         // Requests started on an already open connection
+  unsigned long lastHandshakeMs = 0;   // Duration of the last successful handshake
+  unsigned long totalHandshakeMs = 0;  // Sum of all successful handshake durations
+};
+#endif
+
 /**
  * @class ArduinoTTSChat
  * @brief MiniMax text-to-speech class
@@ -85,6 +105,14 @@ class ArduinoTTSChat {
      */
     void setAudioParams(int sampleRate = 32000, int bitrate = 128000);
 
+    /**
+     * @brief Set audio format requested from the server
+     * @param format "pcm" (default, played directly) or "mp3" (decoded on device, bitrate from setAudioParams())
+     * @return Whether the format is supported and its decoder could be allocated
+     * @note Call before starting a task; mp3 at 32 kbps needs about 1/8 of the downlink of 16 kHz PCM
+     */
+    bool setAudioFormat(const char* format);
+
     /**
      * @brief Initialize MAX98357 I2S speaker
      * @param bclkPin Bit clock pin
@@ -125,6 +153,29 @@ class ArduinoTTSChat {
      */
     bool isWebSocketConnected();
 
+    /**
+     * @brief Enable persistent session mode
+     * @param enable true to keep the WebSocket and TTS task open between utterances
+     * @param pingIntervalMs Idle time before a keepalive ping is sent (milliseconds)
+     * @note If the server closes the connection, loop() reconnects in a background task
+     *       and the next speak() starts a new TTS task on it
+     */
+    void setPersistentSession(bool enable, unsigned long pingIntervalMs = 15000);
+
+    /**
+     * @brief Get connection statistics
+     * @return Handshake count and timing, number of reused sessions
+     */
+    WSSessionStats getSessionStats() const { return _stats; }
+
+    /**
+     * @brief Serve repeated speak() phrases from a phrase cache
+     * @param cache Opened cache (nullptr to disable), must outlive this object
+     * @note Hits play from the cache file without touching the connection; misses are
+     *       written to the cache while they play. Text streams are not cached.
+     */
+    void setCache(TTSPhraseCache* cache);
+
     /**
      * @brief Start TTS task (send task_start)
      * @return Whether start was successful
@@ -138,6 +189,26 @@ class ArduinoTTSChat {
      */
     bool speak(const char* text);
 
+    /**
+     * @brief Open an incremental text stream on the TTS task
+     * @return Whether the stream was opened
+     * @note Use appendText() for each segment and endTextStream() after the last one;
+     *       segments sent while earlier audio is playing continue seamlessly
+     */
+    bool beginTextStream();
+
+    /**
+     * @brief Append a text segment to the open stream
+     * @param text Text segment to synthesize
+     * @return Whether the segment was sent
+     */
+    bool appendText(const char* text);
+
+    /**
+     * @brief Close the text stream, playback completes after the last segment
+     */
+    void endTextStream();
+
     /**
      * @brief Check if currently playing audio
      * @return true if playing, false if not playing
@@ -216,6 +287,15 @@ class ArduinoTTSChat {
     const char* _format = "pcm";            // Audio format (pcm for direct playback)
     int _channels = 1;                      // Number of channels
 
+    // Compressed playback (audio task only)
+    StreamDecoder _decoder;                 // Decodes the ring contents when format is not pcm
+    size_t _decodedLen = 0;                 // Samples in the current decoded frame
+    size_t _decodedPos = 0;                 // Samples of that frame already played
+    volatile bool _decoderResetPending = false;  // New stream, drop decoder state before the next frame
+    bool _rateMismatchLogged = false;       // Decoded sample rate differs from the speaker rate
+    AudioResampler _resampler;              // Decoded rate -> speaker rate (I2S speakers only)
+    bool _starved = false;                  // Ring ran dry while audio was still arriving (audio task)
+
     // Speaker configuration
     SpeakerType _speakerType = SPEAKER_TYPE_MAX98357;  // Speaker type
     I2SClass _I2S;                          // I2S object
@@ -223,6 +303,7 @@ class ArduinoTTSChat {
 
     // WiFi client
     WiFiClientSecure _client;               // Secure WiFi client
+    WebSocketEngine _ws;                    // Frame parser and sender
 
     // Status flags (volatile for multi-task access)
     bool _wsConnected = false;              // WebSocket connection status
@@ -230,19 +311,44 @@ class ArduinoTTSChat {
     volatile bool _isPlaying = false;       // Playing status
     volatile bool _shouldStop = false;      // Should stop flag
     volatile bool _receivingAudio = false;  // Receiving audio flag
+    volatile bool _textStreamOpen = false;  // More text segments may follow
+    volatile int _pendingSegments = 0;      // task_continue sent, is_final not yet received
+
+    // Persistent session
+    static const unsigned long PONG_TIMEOUT_MS = 5000;      // Ping unanswered for this long = dead connection
+    static const unsigned long RECONNECT_INTERVAL_MS = 5000; // Minimum time between background reconnects
+    bool _persistentSession = false;        // Keep connection between utterances
+    unsigned long _pingInterval = 15000;    // Keepalive ping interval
+    unsigned long _lastRxTime = 0;          // Last frame received
+    unsigned long _lastPingTime = 0;        // Last ping sent
+    bool _pingOutstanding = false;          // Ping sent, nothing received since
+    volatile bool _reconnecting = false;    // Background reconnect running
+    bool _manualDisconnect = false;         // disconnectWebSocket() called, don't reconnect
+    unsigned long _lastReconnectAttempt = 0; // Last background reconnect start
+    WSSessionStats _stats;                  // Connection statistics
 
     // Audio ring buffer - use PSRAM if available for larger buffer
     static const size_t AUDIO_BUFFER_SIZE = 524288;  // 512KB for long sentences
-    uint8_t* _audioBuffer;                  // Audio ring buffer
-    volatile size_t _audioWritePos = 0;     // Write position (producer)
-    volatile size_t _audioReadPos = 0;      // Read position (consumer)
-    volatile size_t _audioDataSize = 0;     // Current data size in buffer
-
-    // WebSocket message reassembly buffer
-    static const size_t MSG_BUFFER_SIZE = 65536;  // Max message size
-    uint8_t* _msgBuffer = nullptr;          // Message reassembly buffer
-    size_t _msgBufferPos = 0;               // Current position in message buffer
-    bool _msgInProgress = false;            // Whether we're assembling a fragmented message
+    AudioRingBuffer _audioRing;             // Audio ring (producer: loop task, consumer: audio task)
+
+    // Streaming message parser (hex audio goes straight to the ring, only metadata is kept for JSON)
+    static const size_t META_BUFFER_SIZE = 2048;  // Message text without the audio value
+    static const unsigned long AUDIO_SPACE_TIMEOUT_MS = 3000;  // Max wait for ring space before dropping
+    char* _metaBuffer = nullptr;            // Metadata buffer
+    size_t _metaLen = 0;                    // Metadata length
+    bool _metaOverflow = false;             // Metadata did not fit
+    bool _msgInProgress = false;            // Message started, final fragment not yet received
+    uint8_t _audioKeyMatch = 0;             // Progress matching "audio":"
+    bool _inAudioValue = false;             // Inside the hex audio string
+    bool _dropAudio = false;                // Ring stayed full, discard rest of this value
+    int16_t _pendingNibble = -1;            // High nibble of a byte split across reads
+    size_t _msgAudioBytes = 0;              // Audio bytes decoded from the current message
+
+    // Phrase cache
+    static const size_t CACHE_READ_SIZE = 4096;  // File bytes moved to the ring per read
+    TTSPhraseCache* _cache = nullptr;       // Optional, not owned
+    File _cacheFile;                        // Cached phrase being played
+    volatile bool _playingCached = false;   // Ring is fed from _cacheFile instead of the socket
 
     // Statistics (volatile for multi-task access)
     unsigned long _playStartTime = 0;       // Playback start time
@@ -250,6 +356,7 @@ class ArduinoTTSChat {
 
     // FreeRTOS audio playback task
     TaskHandle_t _audioTaskHandle = nullptr;  // Audio playback task handle
+    bool startAudioTask();                    // Create the playback task (AUDIO_TASK_PLAYBACK)
     static void audioTaskWrapper(void* param);  // Static wrapper for task
     void audioTaskLoop();                     // Audio task main loop
 
@@ -259,18 +366,37 @@ class ArduinoTTSChat {
     AudioPlayCallback _audioPlayCallback = nullptr;    // Audio playback callback for M5CoreS3
 
     // Private helper methods
+    bool prepareSession();                  // Connect / start task before sending text
+    uint64_t cacheKey(const char* text);    // Phrase cache key for the current settings
+    bool playCached(const char* text);      // Start playback of a cached phrase
+    void pumpCachedAudio();                 // Move cached file data into the ring
+    void resetPlaybackState();              // Reset ring buffer for a new utterance
+    bool performHandshake();                // TLS connect + WebSocket upgrade
+    void serviceKeepAlive();                // Send keepalive ping, detect dead connection
+    void startBackgroundReconnect();        // Reconnect in a FreeRTOS task
+    static void reconnectTaskWrapper(void* param);  // Reconnect task
+    bool waitForReconnect(unsigned long timeoutMs); // Wait for background reconnect
+    void sendPing();                        // Send Ping frame
     String generateWebSocketKey();          // Generate WebSocket key
     void handleWebSocketData();             // Handle WebSocket data
-    void sendWebSocketFrame(uint8_t* data, size_t len, uint8_t opcode);  // Send WebSocket frame
+    static void wsFragment(uint8_t opcode, const uint8_t* data, size_t len, bool first, bool last, void* user);  // WebSocketEngine fragment callback
+    void sendWebSocketFrame(const uint8_t* data, size_t len, uint8_t opcode);  // Send WebSocket frame
     void sendTextFrame(const char* text);   // Send text WebSocket frame
     void sendTaskStart();                   // Send task_start message
     void sendTaskContinue(const char* text); // Send task_continue message
     void sendTaskFinish();                  // Send task_finish message
-    void sendPong();                        // Send Pong response
     void parseJsonResponse(const char* json, size_t len);  // Parse JSON response
+    void beginMessage();                    // Reset streaming parser
+    void feedMessage(const uint8_t* data, size_t len);  // Parse message bytes
+    void endMessage();                      // Parse collected metadata
+    void appendMeta(char c);                // Append to metadata buffer
+    void decodeAudioHex(const char* hex, size_t len);  // Hex run to ring buffer
+    bool writeAudioBytes(const uint8_t* data, size_t len);  // Write to ring, wait for space
     void processAudioPlayback();            // Process audio playback
+    void playDecodedAudio();                // Decode compressed ring contents and play them
+    size_t playPCM(const uint8_t* data, size_t len, int sampleRate);  // Write PCM to I2S or the callback
+    static size_t writeResampled(const int16_t* frames, size_t count, void* user);  // AudioResampler sink, I2S
     size_t hexToBytes(const char* hex, size_t hexLen, uint8_t* output, size_t outputSize);  // Convert hex to bytes
-    size_t readBytesWithTimeout(uint8_t* buffer, size_t len, unsigned long timeout_ms); // Reliable read helper
 };
 
 #endif
@@ -22,7 +22,7 @@ AudioBuffer::AudioBuffer(size_t maxBlockSize) {
 }
 
 AudioBuffer::~AudioBuffer() {
-    if(m_buffer) free(m_buffer);
+    if(m_buffer) AudioMemory::release(m_buffer);
     m_buffer = NULL;
 }
 
@@ -35,17 +35,17 @@ void AudioBuffer::setBufsize(int ram, int psram) {
 int32_t AudioBuffer::getBufsize() { return m_buffSize; }
 
 size_t AudioBuffer::init() {
-    if(m_buffer) free(m_buffer);
+    if(m_buffer) AudioMemory::release(m_buffer);
     m_buffer = NULL;
     if(psramInit() && m_buffSizePSRAM > 0) { // PSRAM found, AudioBuffer will be allocated in PSRAM
         m_f_psram = true;
         m_buffSize = m_buffSizePSRAM;
-        m_buffer = (uint8_t*)ps_calloc(m_buffSize, sizeof(uint8_t));
+        m_buffer = (uint8_t*)AudioMemory::calloc(m_buffSize, sizeof(uint8_t), AUDIO_MEM_PSRAM_PREFERRED);
         m_buffSize = m_buffSizePSRAM - m_resBuffSizePSRAM;
     }
     if(m_buffer == NULL) { // PSRAM not found, not configured or not enough available
         m_f_psram = false;
-        m_buffer = (uint8_t*)heap_caps_calloc(m_buffSizeRAM, sizeof(uint8_t), MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL);
+        m_buffer = (uint8_t*)AudioMemory::calloc(m_buffSizeRAM, sizeof(uint8_t), AUDIO_MEM_INTERNAL);
         m_buffSize = m_buffSizeRAM - m_resBuffSizeRAM;
     }
     if(!m_buffer) return 0;
@@ -158,11 +158,22 @@ uint32_t AudioBuffer::getWritePos() { return m_writePtr - m_buffer; }
 uint32_t AudioBuffer::getReadPos() { return m_readPtr - m_buffer; }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 // clang-format off
+uint8_t Audio::m_instances = 0;
+
 Audio::Audio(uint8_t i2sPort) {
 
     mutex_playAudioData = xSemaphoreCreateMutex();
     mutex_audioTask     = xSemaphoreCreateMutex();
 
+    if(m_instances++) { // more than one Audio object, each one decodes with its own contexts
+        m_mp3Ctx    = MP3Decoder_CreateContext();
+        m_aacCtx    = AACDecoder_CreateContext();
+        m_flacCtx   = FLACDecoder_CreateContext();
+        m_opusCtx   = OPUSDecoder_CreateContext();
+        m_vorbisCtx = VORBISDecoder_CreateContext();
+        if(!m_mp3Ctx || !m_aacCtx || !m_flacCtx || !m_opusCtx || !m_vorbisCtx) log_e("oom, decoder contexts");
+    }
+
     m_chbufSize = 512 + 64;
     m_ibuffSize = 512 + 64;
 
@@ -170,6 +181,7 @@ Audio::Audio(uint8_t i2sPort) {
     m_ibuff    = (char*) malloc(m_ibuffSize);
     m_outBuff  = (int16_t*)malloc(m_outbuffSize * sizeof(int16_t));
     if(!m_chbuf || !m_outBuff || !m_ibuff) log_e("oom");
+    if(!m_pcmQueue.begin(m_pcmQueueSize, AUDIO_MEM_PSRAM_PREFERRED)) log_w("no PCM queue, writing I2S directly");
 
 #ifdef AUDIO_LOG
     m_f_Log = true;
@@ -200,6 +212,11 @@ Audio::Audio(uint8_t i2sPort) {
     m_i2s_std_cfg.clk_cfg.clk_src        = I2S_CLK_SRC_DEFAULT;        // Select PLL_F160M as the default source clock
     m_i2s_std_cfg.clk_cfg.mclk_multiple  = I2S_MCLK_MULTIPLE_512;      // mclk = sample_rate * 256
     i2s_channel_init_std_mode(m_i2s_tx_handle, &m_i2s_std_cfg);
+
+    i2s_event_callbacks_t i2s_callbacks = {};
+    i2s_callbacks.on_sent = &Audio::i2sOnSent; // a DMA buffer was sent: room for more samples, wake the audio task
+    i2s_channel_register_event_callback(m_i2s_tx_handle, &i2s_callbacks, this);
+
     I2Sstart(m_i2s_num);
     m_sampleRate = 44100;
 
@@ -229,10 +246,19 @@ Audio::~Audio() {
     x_ps_free(&m_ibuff);
     x_ps_free(&m_lastM3U8host);
     x_ps_free(&m_speechtxt);
+    clearQueue();
 
     stopAudioTask();
+    AudioMemory::release(m_audioTaskStack);
     vSemaphoreDelete(mutex_playAudioData);
     vSemaphoreDelete(mutex_audioTask);
+
+    MP3Decoder_DestroyContext(m_mp3Ctx);
+    AACDecoder_DestroyContext(m_aacCtx);
+    FLACDecoder_DestroyContext(m_flacCtx);
+    OPUSDecoder_DestroyContext(m_opusCtx);
+    VORBISDecoder_DestroyContext(m_vorbisCtx); // the calling task falls back to the default contexts
+    m_instances--;
 }
 // clang-format on
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -262,6 +288,7 @@ esp_err_t Audio::I2Sstop(uint8_t i2s_num) {
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void Audio::setDefaults() {
+    bindDecoders();
     stopSong();
     initInBuff(); // initialize InputBuffer if not already done
     InBuff.resetBuffer();
@@ -280,6 +307,7 @@ void Audio::setDefaults() {
     // client.clear(); // delete all leftovers in the receive buffer
     clientsecure.stop();
     // clientsecure.clear(); // delete all leftovers in the receive buffer
+    if(m_queueClient) {m_queueClient->stop(); delete m_queueClient; m_queueClient = NULL;} // prefetched connection of the last queued item
     _client = static_cast<WiFiClient*>(&client); /* default to *something* so that no NULL deref can happen */
     ts_parsePacket(0, 0, 0);                     // reset ts routine
     x_ps_free(&m_lastM3U8host);
@@ -310,6 +338,7 @@ void Audio::setDefaults() {
     m_f_stream = false;
     m_f_decode_ready = false;
     m_f_eof = false;
+    m_f_bufferEnded = false;
     m_f_ID3v1TagFound = false;
     m_f_lockInBuffer = false;
     m_f_acceptRanges = false;
@@ -337,6 +366,7 @@ void Audio::setDefaults() {
     m_ID3Size = 0;
     m_haveNewFilePos = 0;
     m_validSamples = 0;
+    m_f_reconfigPending = false;
     m_M4A_chConfig = 0;
     m_M4A_objectType = 0;
     m_M4A_sampleRate = 0;
@@ -457,6 +487,7 @@ bool Audio::connecttohost(const char* host, const char* user, const char* pwd) {
     int16_t  pos_ampersand = 0;     // position of "&" in hostname
     uint32_t timestamp     = 0;     // timeout surveillance
     uint16_t hostwoext_begin = 0;
+    bool     f_prefetched    = false; // connection was opened by prefetchQueued()
 
     // char*    authorization = NULL;  // authorization
     char*    rqh           = NULL;  // request header
@@ -507,33 +538,27 @@ bool Audio::connecttohost(const char* host, const char* user, const char* pwd) {
     }
 
     setDefaults();
-    rqh = x_ps_calloc(lenHost + strlen(authorization) + 300, 1); // http request header
+    rqh = buildGetRequest(h_host, pos_slash, hostwoext_begin, authorization); // http request header
     if(!rqh) {AUDIO_INFO("out of memory"); stopSong(); goto exit;}
 
-                       strcat(rqh, "GET /");
-    if(pos_slash > 0){ strcat(rqh, h_host + pos_slash + 1);}
-                       strcat(rqh, " HTTP/1.1\r\n");
-                       strcat(rqh, "Host: ");
-                       strcat(rqh, h_host + hostwoext_begin);
-                       strcat(rqh, "\r\n");
-                       strcat(rqh, "Icy-MetaData:1\r\n");
-                       strcat(rqh, "Icy-MetaData:2\r\n");
-                       strcat(rqh, "Accept:*/*\r\n");
-                       strcat(rqh, "User-Agent: VLC/3.0.21 LibVLC/3.0.21\r\n");
-    if(authLen > 0) {  strcat(rqh, "Authorization: Basic ");
-                       strcat(rqh, authorization);
-                       strcat(rqh, "\r\n"); }
-                       strcat(rqh, "Accept-Encoding: identity;q=1,*;q=0\r\n");
-                       strcat(rqh, "Connection: keep-alive\r\n\r\n");
-
-    if(m_f_ssl) { _client = static_cast<WiFiClient*>(&clientsecure);}
-    else        { _client = static_cast<WiFiClient*>(&client); }
-
     timestamp = millis();
-    _client->setTimeout(m_f_ssl ? m_timeout_ms_ssl : m_timeout_ms);
+    if(m_prefetchClient && m_prefetchURL && !strcmp(m_prefetchURL, host) && m_prefetchClient->connected()) { // queued item, request already sent
+        m_queueClient = m_prefetchClient;
+        m_prefetchClient = NULL;
+        x_ps_free(&m_prefetchURL);
+        _client = m_queueClient;
+        f_prefetched = true;
+        res = true;
+    }
+    else {
+        if(m_f_ssl) { _client = static_cast<WiFiClient*>(&clientsecure);}
+        else        { _client = static_cast<WiFiClient*>(&client); }
+
+        _client->setTimeout(m_f_ssl ? m_timeout_ms_ssl : m_timeout_ms);
 
-    AUDIO_INFO("connect to: \"%s\" on port %d path \"/%s\"", h_host + hostwoext_begin, port, h_host + pos_slash + 1);
-    res = _client->connect(h_host + hostwoext_begin, port);
+        AUDIO_INFO("connect to: \"%s\" on port %d path \"/%s\"", h_host + hostwoext_begin, port, h_host + pos_slash + 1);
+        res = _client->connect(h_host + hostwoext_begin, port);
+    }
 
     if(pos_slash > 0) h_host[pos_slash] = '/';
     if(pos_colon > 0) h_host[pos_colon] = ':';
@@ -547,7 +572,7 @@ bool Audio::connecttohost(const char* host, const char* user, const char* pwd) {
         m_lastHost = x_ps_strdup(host);
         AUDIO_INFO("%s has been established in %lu ms, free Heap: %lu bytes", m_f_ssl ? "SSL" : "Connection", (long unsigned int)dt, (long unsigned int)ESP.getFreeHeap());
         m_f_running = true;
-        _client->print(rqh);
+        if(!f_prefetched) _client->print(rqh);
         if(endsWith(h_host, ".mp3" )) m_expectedCodec  = CODEC_MP3;
         if(endsWith(h_host, ".aac" )) m_expectedCodec  = CODEC_AAC;
         if(endsWith(h_host, ".wav" )) m_expectedCodec  = CODEC_WAV;
@@ -584,6 +609,30 @@ exit:
     return res;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+char* Audio::buildGetRequest(const char* h_host, int16_t pos_slash, uint16_t hostwoext_begin, const char* authorization) {
+    // h_host is the encoded URL, terminated at pos_slash (if > 0) and at the port colon
+    char* rqh = x_ps_calloc(strlen(h_host) + strlen(h_host + pos_slash + 1) + strlen(authorization) + 300, 1);
+    if(!rqh) return NULL;
+
+                       strcat(rqh, "GET /");
+    if(pos_slash > 0){ strcat(rqh, h_host + pos_slash + 1);}
+                       strcat(rqh, " HTTP/1.1\r\n");
+                       strcat(rqh, "Host: ");
+                       strcat(rqh, h_host + hostwoext_begin);
+                       strcat(rqh, "\r\n");
+                       strcat(rqh, "Icy-MetaData:1\r\n");
+                       strcat(rqh, "Icy-MetaData:2\r\n");
+                       strcat(rqh, "Accept:*/*\r\n");
+                       strcat(rqh, "User-Agent: VLC/3.0.21 LibVLC/3.0.21\r\n");
+    if(authorization[0]) {
+                       strcat(rqh, "Authorization: Basic ");
+                       strcat(rqh, authorization);
+                       strcat(rqh, "\r\n"); }
+                       strcat(rqh, "Accept-Encoding: identity;q=1,*;q=0\r\n");
+                       strcat(rqh, "Connection: keep-alive\r\n\r\n");
+    return rqh;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 bool Audio::httpPrint(const char* host) {
     // user and pwd for authentification only, can be empty
     if(!m_f_running) return false;
@@ -855,9 +904,16 @@ bool Audio::connecttoFS(fs::FS& fs, const char* path, int32_t fileStartPos) {
     if(path[0] != '/')audioPath[0] = '/';
     strcat(audioPath, path);
 
-    if(!fs.exists(audioPath)) {printProcessLog(AUDIOLOG_FILE_NOT_FOUND, audioPath); goto exit;}
+    if(m_prefetchFile && m_prefetchURL && !strcmp(m_prefetchURL, audioPath)) { // queued item, opened by prefetchQueued()
+        audiofile = m_prefetchFile;
+        m_prefetchFile = File();
+        x_ps_free(&m_prefetchURL);
+    }
+    else {
+        if(!fs.exists(audioPath)) {printProcessLog(AUDIOLOG_FILE_NOT_FOUND, audioPath); goto exit;}
+        audiofile = fs.open(audioPath);
+    }
     AUDIO_INFO("Reading file: \"%s\"", audioPath);
-    audiofile = fs.open(audioPath);
     m_dataMode = AUDIO_LOCALFILE;
     m_fileSize = audiofile.size();
 
@@ -872,6 +928,232 @@ exit:
     return res;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+bool Audio::connecttobuffer(const char* format) {
+    // The caller pushes the data (e.g. decoded from an HTTP API response) while it arrives, playback starts with the
+    // first complete frame and overlaps the download. No file, no staging buffer.
+    xSemaphoreTakeRecursive(mutex_playAudioData, 0.3 * configTICK_RATE_HZ);
+    bool res = false;
+    uint8_t codec = CODEC_NONE;
+
+    if(!format) {AUDIO_INFO("Buffer format is NULL"); goto exit;}  // guard
+    if(!strcasecmp(format, "mp3"))  codec = CODEC_MP3;
+    if(!strcasecmp(format, "aac"))  codec = CODEC_AAC;
+    if(!strcasecmp(format, "wav"))  codec = CODEC_WAV;
+    if(!strcasecmp(format, "flac")) codec = CODEC_FLAC;
+    if(!strcasecmp(format, "opus")) codec = CODEC_OPUS;
+    if(!strcasecmp(format, "ogg"))  codec = CODEC_OGG;
+    if(codec == CODEC_NONE) {AUDIO_INFO("The %s format is not supported", format); goto exit;}   // guard
+    setDefaults(); // free buffers an set defaults
+
+    AUDIO_INFO("Reading pushed %s data", format);
+    m_dataMode = AUDIO_BUFFER;
+    res = initializeDecoder(codec);
+    m_codec = codec;
+    if(codec != CODEC_WAV) m_controlCounter = 100; // as in a webstream the decoder syncs itself, WAV needs its header (rate, bits)
+    if(res) m_f_running = true;
+    else m_dataMode = AUDIO_NONE;
+
+exit:
+    xSemaphoreGiveRecursive(mutex_playAudioData);
+    return res;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+size_t Audio::writeBuffer(const uint8_t* data, size_t len) {
+    if(m_dataMode != AUDIO_BUFFER || m_f_bufferEnded) return 0; // guard
+    size_t written = 0;
+    while(written < len) { // at most twice, the free space may wrap around the end of the buffer
+        size_t n = min(len - written, InBuff.writeSpace());
+        if(!n) break;
+        memcpy(InBuff.getWritePtr(), data + written, n);
+        inBuffWritten(n);
+        written += n;
+    }
+    return written;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::finishBuffer() {
+    if(m_dataMode != AUDIO_BUFFER) return; // guard
+    m_f_bufferEnded = true;
+    notifyAudioTask(); // the last frame may be shorter than maxBlockSize, let playAudioData() take it now
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+bool Audio::queueHost(const char* host) {
+    if(!host || !startsWith(host, "http")) {AUDIO_INFO("Hostaddress is not valid"); return false;}
+    char* url = x_ps_strdup(host);
+    if(!url) {printProcessLog(AUDIOLOG_OUT_OF_MEMORY); return false;}
+    xSemaphoreTakeRecursive(mutex_playAudioData, 0.3 * configTICK_RATE_HZ);
+    m_playQueue.push_back({url, NULL});
+    xSemaphoreGiveRecursive(mutex_playAudioData);
+    return true;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+bool Audio::queueFS(fs::FS& fs, const char* path) {
+    if(!path) {printProcessLog(AUDIOLOG_PATH_IS_NULL); return false;}
+    char* audioPath = (char *)x_ps_calloc(strlen(path) + 2, sizeof(char));
+    if(!audioPath) {printProcessLog(AUDIOLOG_OUT_OF_MEMORY); return false;}
+    if(path[0] != '/') audioPath[0] = '/';
+    strcat(audioPath, path); // same form as in connecttoFS(), the prefetched file is matched by name
+    xSemaphoreTakeRecursive(mutex_playAudioData, 0.3 * configTICK_RATE_HZ);
+    m_playQueue.push_back({audioPath, &fs});
+    xSemaphoreGiveRecursive(mutex_playAudioData);
+    return true;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::clearQueue() {
+    xSemaphoreTakeRecursive(mutex_playAudioData, 0.3 * configTICK_RATE_HZ);
+    for(int i = 0; i < m_playQueue.size(); i++) x_ps_free(&m_playQueue[i].url);
+    m_playQueue.clear();
+    m_playQueue.shrink_to_fit();
+    abandonPrefetch();
+    if(m_prefetchClient) {m_prefetchClient->stop(); delete m_prefetchClient; m_prefetchClient = NULL;}
+    if(m_prefetchFile) m_prefetchFile.close();
+    x_ps_free(&m_prefetchURL);
+    m_f_prefetched = false;
+    xSemaphoreGiveRecursive(mutex_playAudioData);
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::setGaplessLeadTime(uint8_t sec) {
+    m_gaplessLeadTime = sec;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::setHLSPrefetch(uint8_t depth) {
+    m_hlsDepth = min(depth, HLSPrefetcher::MAX_DEPTH); // takes effect with the next m3u8 stream
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::prefetchQueued() {
+    // Open the next queued item while the current one plays its last seconds. For a host the connection is made
+    // and the GET request sent, so at the hand-over the response header is already waiting in the socket. The
+    // connect runs in prefetchTask() on the network core, a TLS handshake would stall loop() for a second or more.
+    if(m_prefetchJob) collectPrefetch();
+    if(m_playQueue.empty() || m_f_prefetched) return;
+    if(m_dataMode != AUDIO_LOCALFILE && m_streamType != ST_WEBFILE) return; // only files come to an end
+    if(!m_f_eof) {
+        if(!m_audioFileDuration) return;                                     // length still unknown
+        if(m_audioCurrentTime + m_gaplessLeadTime < m_audioFileDuration) return;
+    }
+    m_f_prefetched = true;
+
+    queueItem_t& item = m_playQueue[0];
+    if(item.fs) {
+        m_prefetchFile = item.fs->open(item.url);
+        if(!m_prefetchFile) return;
+        m_prefetchURL = x_ps_strdup(item.url);
+        AUDIO_INFO("next queued file opened: \"%s\"", item.url);
+        return;
+    }
+
+    // split the address the same way as connecttohost() does
+    char* h_host = urlencode(item.url, true);
+    if(!h_host) return;
+    trim(h_host);
+    bool     ssl = startsWith(h_host, "https");
+    uint16_t hostwoext_begin = ssl ? 8 : 7;
+    uint16_t port = ssl ? 443 : 80;
+    int16_t  pos_slash     = indexOf(h_host, "/", 10);
+    int16_t  pos_colon     = indexOf(h_host, ":", 10); if(isalpha(item.url[pos_colon + 1])) pos_colon = -1;
+    int16_t  pos_ampersand = indexOf(h_host, "&", 10);
+    if(pos_slash > 0) h_host[pos_slash] = '\0';
+    if((pos_colon > 0) && ((pos_ampersand == -1) || (pos_ampersand > pos_colon))) {
+        port = atoi(item.url + pos_colon + 1);
+        h_host[pos_colon] = '\0';
+    }
+    char* rqh = buildGetRequest(h_host, pos_slash, hostwoext_begin, "");
+    memmove(h_host, h_host + hostwoext_begin, strlen(h_host + hostwoext_begin) + 1); // host name only
+
+    queuePrefetch_t* job = (queuePrefetch_t*)calloc(1, sizeof(queuePrefetch_t));
+    if(!job) {log_e("oom"); x_ps_free(&h_host); x_ps_free(&rqh); return;}
+    if(ssl) {auto* cs = new decltype(clientsecure); cs->setInsecure(); job->client = static_cast<WiFiClient*>(cs);}
+    else    {job->client = static_cast<WiFiClient*>(new decltype(client));}
+    job->client->setTimeout(ssl ? m_timeout_ms_ssl : m_timeout_ms);
+    job->host = h_host;
+    job->port = port;
+    job->request = rqh;
+    job->url = x_ps_strdup(item.url);
+    job->state = PREFETCH_CONNECTING;
+
+    if(!rqh || !job->url || !AudioTasks::create(AUDIO_TASK_HLS_PREFETCH, prefetchTask, "QueuePrefetch", job)) {
+        log_w("prefetch of %s failed, connecting at the hand-over", item.url);
+        freePrefetch(job);
+        return;
+    }
+    m_prefetchJob = job;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+static portMUX_TYPE s_prefetchMux = portMUX_INITIALIZER_UNLOCKED; // job->state and job->abandoned
+
+void Audio::prefetchTask(void* param) {
+    queuePrefetch_t* job = (queuePrefetch_t*)param;
+    uint32_t t = millis();
+    bool ok = job->client->connect(job->host, job->port);
+    if(ok) job->client->print(job->request);
+    job->connectTime = millis() - t;
+
+    portENTER_CRITICAL(&s_prefetchMux);
+    job->state = ok ? PREFETCH_CONNECTED : PREFETCH_FAILED;
+    bool abandoned = job->abandoned;
+    portEXIT_CRITICAL(&s_prefetchMux);
+    if(abandoned) freePrefetch(job); // the queue changed meanwhile, nobody takes the connection
+    AudioTasks::exit();
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::collectPrefetch() {
+    // take over the connection once prefetchTask() is done with it
+    portENTER_CRITICAL(&s_prefetchMux);
+    uint8_t state = m_prefetchJob->state;
+    portEXIT_CRITICAL(&s_prefetchMux);
+    if(state == PREFETCH_CONNECTING) return;
+
+    queuePrefetch_t* job = m_prefetchJob;
+    m_prefetchJob = NULL;
+    if(state == PREFETCH_CONNECTED) {
+        m_prefetchClient = job->client;
+        m_prefetchURL = job->url;
+        job->client = NULL;
+        job->url = NULL;
+        AUDIO_INFO("next queued host connected in %lu ms: \"%s\"", (long unsigned int)job->connectTime, job->host);
+    }
+    else {
+        log_w("prefetch of %s failed, connecting at the hand-over", job->url);
+    }
+    freePrefetch(job);
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::abandonPrefetch() {
+    // drop the job, a connect still in progress is cleaned up by prefetchTask() itself
+    if(!m_prefetchJob) return;
+    portENTER_CRITICAL(&s_prefetchMux);
+    bool running = m_prefetchJob->state == PREFETCH_CONNECTING;
+    m_prefetchJob->abandoned = running;
+    portEXIT_CRITICAL(&s_prefetchMux);
+    if(!running) freePrefetch(m_prefetchJob);
+    m_prefetchJob = NULL;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::freePrefetch(queuePrefetch_t* job) {
+    if(job->client) {job->client->stop(); delete job->client;}
+    free(job->host);
+    free(job->request);
+    free(job->url);
+    free(job);
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+bool Audio::playNextQueued() {
+    // called at EOF with m_f_gapless set: the PCM queue keeps playing the tail of the item before
+    queueItem_t item = m_playQueue.front();
+    m_playQueue.erase(m_playQueue.begin());
+    m_f_prefetched = false;
+    if(m_prefetchJob) collectPrefetch();
+    abandonPrefetch(); // still connecting, connecttohost() makes its own connection
+
+    bool res = item.fs ? connecttoFS(*item.fs, item.url) : connecttohost(item.url);
+
+    if(m_prefetchClient) {m_prefetchClient->stop(); delete m_prefetchClient; m_prefetchClient = NULL;} // not taken over
+    if(m_prefetchFile) m_prefetchFile.close();
+    x_ps_free(&m_prefetchURL);
+    x_ps_free(&item.url);
+    return res;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 bool Audio::connecttospeech(const char* speech, const char* lang) {
     xSemaphoreTakeRecursive(mutex_playAudioData, 0.3 * configTICK_RATE_HZ);
 
@@ -2204,6 +2486,11 @@ uint32_t Audio::stopSong() {
         static uint8_t maxWait = 0;
         while(m_f_audioTaskIsDecoding) {vTaskDelay(1); maxWait++; if(maxWait > 100) break;} // in case of error wait max 100ms
         maxWait = 0;
+        if(m_f_hlsPrefetch) {
+            m_f_hlsPrefetch = false;
+            m_hlsData = NULL;
+            m_hls.end();
+        }
         uint32_t pos = 0;
         if(m_f_running) {
             m_f_running = false;
@@ -2218,8 +2505,12 @@ uint32_t Audio::stopSong() {
             AUDIO_INFO("Closing audio file \"%s\"", audiofile.name());
             audiofile.close();
         }
-        memset(m_filterBuff, 0, sizeof(m_filterBuff)); // Clear FilterBuffer
         m_validSamples = 0;
+        if(!m_f_gapless) {
+            memset(m_filterBuff, 0, sizeof(m_filterBuff)); // Clear FilterBuffer
+            m_pcmQueue.discard(); // drop queued PCM, the audio task skips it on its next feedI2S()
+            m_resampler.reset();
+        }
         m_audioCurrentTime = 0;
         m_audioFileDuration = 0;
         m_codec = CODEC_NONE;
@@ -2237,6 +2528,8 @@ bool Audio::pauseResume() {
         if(!m_f_running) {
             memset(m_outBuff, 0, m_outbuffSize * sizeof(int16_t)); // Clear OutputBuffer
             m_validSamples = 0;
+            m_pcmQueue.discard();
+            m_resampler.reset();
         }
     }
     xSemaphoreGive(mutex_audioTask);
@@ -2244,53 +2537,32 @@ bool Audio::pauseResume() {
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void Audio::playChunk() {
+    // m_outBuff -> DSP -> PCM queue -> I2S
+    // A frame that does not fit into the queue stays in m_outBuff (m_validSamples > 0), decoding pauses
+    // until I2S has taken enough of the queue, see performAudioTask()
 
     int16_t validSamples = 0;
     static uint16_t count = 0;
     size_t i2s_bytesConsumed = 0;
-    int16_t* sample[2] = {0};
-    int16_t* s2;
     int sampleSize = 4; // 2 bytes per sample (int16_t) * 2 channels
     esp_err_t err = ESP_OK;
-    int i= 0;
-
-    if(count > 0) goto i2swrite;
 
-    if(getChannels() == 1){
-        for (int i = m_validSamples - 1; i >= 0; --i) {
-            int16_t sample = m_outBuff[i];
-            m_outBuff[2 * i] = sample;
-            m_outBuff[2 * i + 1] = sample;
-        }
-    //    m_validSamples *= 2;
+    if(m_f_reconfigPending) {
+        if(m_pcmQueue.buffered()) return; // rate change waits for the previous item's tail, the frame stays
+        m_f_reconfigPending = false;
+        reconfigI2S();
     }
+    if(count > 0) goto i2swrite;
 
     validSamples = m_validSamples;
 
-    while(validSamples) {
-        *sample = m_outBuff + i;
-        computeVUlevel(*sample);
-
-        //---------- Filterchain, can commented out if not used-------------
-        {
-            if(m_corr > 1) {
-                s2 = *sample;
-                s2[LEFTCHANNEL] /= m_corr;
-                s2[RIGHTCHANNEL] /= m_corr;
-            }
-            IIR_filterChain0(*sample);
-            IIR_filterChain1(*sample);
-            IIR_filterChain2(*sample);
-        }
-        //------------------------------------------------------------------
-        if(m_f_forceMono && m_channels == 2){
-            int32_t xy = ((*sample)[RIGHTCHANNEL] + (*sample)[LEFTCHANNEL]) / 2;
-            (*sample)[RIGHTCHANNEL] = (int16_t)xy;
-            (*sample)[LEFTCHANNEL]  = (int16_t)xy;
-        }
-        Gain(*sample);
-        i += 2;
-        validSamples -= 1;
+    // Block processing over the whole frame. Mono stays mono through VU and filters,
+    // Gain() upmixes it to the interleaved L/R layout expected by I2S.
+    {
+        uint8_t channels = (getChannels() == 1) ? 1 : 2;
+        computeVUlevel(m_outBuff, validSamples, channels);
+        IIR_filterBlock(m_outBuff, validSamples, channels); // tone control incl. level correction, neutral stages skipped
+        Gain(m_outBuff, validSamples, channels);            // force mono, balance and volume in one pass
     }
     if(audio_process_i2s) {
         // processing the audio samples from external before forwarding them to i2s
@@ -2307,8 +2579,26 @@ i2swrite:
 
     validSamples = m_validSamples;
 
-    err = i2s_channel_write(m_i2s_tx_handle, (int16_t*)m_outBuff + count, validSamples * sampleSize, &i2s_bytesConsumed, 10);
-    if( ! (err == ESP_OK || err == ESP_ERR_TIMEOUT)) goto exit;
+    if(m_resampler.converting()) {
+        // count and m_validSamples stay in source frames, the output has a different length
+        i2s_bytesConsumed = resampleChunk((int16_t*)m_outBuff + count, validSamples) * sampleSize;
+    }
+    else if(m_mixer.active()) {
+        i2s_bytesConsumed = mixToQueue((int16_t*)m_outBuff + count, validSamples) * sampleSize;
+        feedI2S();
+    }
+    else if(m_pcmQueue.data()) {
+        // whole stereo frames only
+        size_t room = m_pcmQueue.space() & ~(size_t)(sampleSize - 1);
+        size_t bytes = min(room, (size_t)validSamples * sampleSize);
+        i2s_bytesConsumed = m_pcmQueue.write((int16_t*)m_outBuff + count, bytes);
+        feedI2S();
+    }
+    else {
+        err = i2s_channel_write(m_i2s_tx_handle, (int16_t*)m_outBuff + count, validSamples * sampleSize, &i2s_bytesConsumed, 10);
+        if( ! (err == ESP_OK || err == ESP_ERR_TIMEOUT)) goto exit;
+    }
+    if(i2s_bytesConsumed) TurnMetrics::mark(TURN_FIRST_SAMPLE); // only the first of a turn is kept
     m_validSamples -= i2s_bytesConsumed / sampleSize;
     count += i2s_bytesConsumed / 2;
     if(m_validSamples < 0) { m_validSamples = 0; }
@@ -2336,13 +2626,94 @@ exit:
     else log_e("i2s err %i", err);
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+size_t Audio::resampleChunk(const int16_t* in, size_t frames) {
+    // stereo frames in -> resampler -> PCM queue (I2S directly without one), returns the frames consumed
+    size_t used = 0;
+
+    if(!m_pcmQueue.data()) return m_resampler.processTo(in, frames, resampledToI2S, this);
+
+    while(used < frames) {
+        size_t len = 0;
+        int16_t* p = (int16_t*)m_pcmQueue.writeSpan(len);
+        size_t room = len / 4;
+        if(!room) break;
+        // no more input than the output fits, or it would linger in the resampler when the stream ends
+        size_t take = min(frames - used, m_resampler.inputFramesFor(room));
+        size_t n = m_resampler.process(in + used * 2, take, p, room);
+        if(m_mixer.active()) m_mixer.mix(p, n);
+        m_pcmQueue.commitWrite(n * 4);
+        used += take;
+        if(!n && !take) break;
+    }
+    feedI2S();
+    return used;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+size_t Audio::resampledToI2S(const int16_t* frames, size_t count, void* user) {
+    // AudioResampler sink without a PCM queue: stereo frames straight to I2S, returns the frames written
+    // a short write is continued, the resampled block cannot be handed back; only a stall of 20 ticks ends it
+    Audio* audio = (Audio*)user;
+    const uint8_t* p = (const uint8_t*)frames;
+    size_t bytes = count * 4, done = 0;
+    while(done < bytes) {
+        size_t written = 0;
+        esp_err_t err = i2s_channel_write(audio->m_i2s_tx_handle, p + done, bytes - done, &written, 20);
+        done += written;
+        if(err != ESP_OK && err != ESP_ERR_TIMEOUT) { log_e("i2s err %i", err); break; }
+        if(!written) break;
+    }
+    return done / 4;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+size_t Audio::mixToQueue(const int16_t* in, size_t frames) {
+    // stereo frames (nullptr: silence) + mixer sources -> PCM queue, returns the frames written
+    size_t done = 0;
+    while(done < frames) {
+        size_t len = 0;
+        int16_t* p = (int16_t*)m_pcmQueue.writeSpan(len);
+        size_t n = min(len / 4, frames - done);
+        if(!n) break;
+        if(in) memcpy(p, in + done * 2, n * 4);
+        else   memset(p, 0, n * 4);
+        m_mixer.mix(p, n);
+        m_pcmQueue.commitWrite(n * 4);
+        done += n;
+    }
+    return done;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::pumpMixer() {
+    // without decoded PCM the sources are mixed over silence, half a queue ahead keeps the latency of the next stream low
+    m_f_mixing = m_mixer.pending();
+    if(!m_f_mixing || !m_pcmQueue.data() || m_f_reconfigPending) return; // the queue drains for a rate change
+    size_t ahead = m_pcmQueueSize / 2;
+    size_t buffered = m_pcmQueue.buffered();
+    if(buffered < ahead) mixToQueue(nullptr, (ahead - buffered) / 4);
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::feedI2S() {
+    // move queued PCM into the DMA buffers without blocking, straight from the queue memory
+    size_t len = 0, consumed = 0;
+    while(true) {
+        const uint8_t* p = m_pcmQueue.readSpan(len);
+        if(!len) return;
+        esp_err_t err = i2s_channel_write(m_i2s_tx_handle, p, len, &consumed, 0);
+        m_pcmQueue.commitRead(consumed);
+        if(consumed < len) return; // DMA full, on_sent will wake us
+        if(err != ESP_OK && err != ESP_ERR_TIMEOUT) {log_e("i2s err %i", err); return;}
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void Audio::loop() {
     if(!m_f_running) return;
+    bindDecoders(); // several Audio objects may share the loop task
 
     if(m_playlistFormat != FORMAT_M3U8) { // normal process
         switch(m_dataMode) {
             case AUDIO_LOCALFILE:
                 processLocalFile(); break;
+            case AUDIO_BUFFER:
+                processBufferStream(); break;
             case HTTP_RESPONSE_HEADER:
                 static uint8_t count = 0;
                 if(!parseHttpResponseHeader()) {
@@ -2363,8 +2734,10 @@ void Audio::loop() {
                 if(m_streamType == ST_WEBFILE) processWebFile();
                 break;
         }
+        if(!m_playQueue.empty()) prefetchQueued();
     }
     else { // m3u8 datastream only
+        if(m_f_hlsPrefetch) {processHLSPrefetch(); return;}
         const char* host = NULL;
         static uint8_t no_host_cnt = 0;
         static uint32_t no_host_timer = millis();
@@ -2385,6 +2758,7 @@ void Audio::loop() {
                 if(!host) no_host_cnt++; else {no_host_cnt = 0; no_host_timer = millis();}
                 if(no_host_cnt == 2){no_host_timer = millis() + 2000;} // no new url? wait 2 seconds
                 if(host) { // host contains the next playlist URL
+                    if(host == m_playlistBuff && startHLSPrefetch(host)) break; // a media segment, from now on prefetched
                     httpPrint(host);
                     m_dataMode = HTTP_RESPONSE_HEADER;
                 }
@@ -2690,6 +3064,11 @@ const char* Audio::parsePlaylist_M3U8() {
             if(startsWith(m_playlistContent[i], "##")) continue;
             if(startsWith(m_playlistContent[i], "#EXT-X-INDEPENDENT-SEGMENTS")) continue;
             if(startsWith(m_playlistContent[i], "#EXT-X-PROGRAM-DATE-TIME:")) continue;
+            if(startsWith(m_playlistContent[i], "#EXT-X-TARGETDURATION:")) {
+                int td = atoi(m_playlistContent[i] + 22);
+                if(td > 0) m_m3u8_targetDuration = td;
+                continue;
+            }
 
             if(!f_mediaSeq_found) {
                 xMedSeq = m3u8_findMediaSeqInURL();
@@ -3069,7 +3448,7 @@ void Audio::processLocalFile() {
     }
     availableBytes = InBuff.writeSpace();
     int32_t bytesAddedToBuffer = audiofile.read(InBuff.getWritePtr(), availableBytes);
-    if(bytesAddedToBuffer > 0) {InBuff.bytesWritten(bytesAddedToBuffer);}
+    if(bytesAddedToBuffer > 0) {inBuffWritten(bytesAddedToBuffer);}
     if(!m_f_stream) {
         if(m_codec == CODEC_OGG) { // log_i("determine correct codec here");
             uint8_t codec = determineOggCodec(InBuff.getReadPtr(), maxFrameSize);
@@ -3132,10 +3511,13 @@ void Audio::processLocalFile() {
             m_f_eof = false;
             return;
         }
+        if(m_validSamples) return;
+        if(m_pcmQueue.buffered() && m_playQueue.empty()) return; // let the audio task play out the PCM queue first
         if(m_f_ID3v1TagFound) readID3V1Tag();
 exit:
         char* afn = NULL;
         if(audiofile) afn = strdup(audiofile.name()); // store temporary the name
+        m_f_gapless = !m_playQueue.empty(); // the next item follows directly, keep the PCM queue playing
         stopSong();
 
         if(m_codec == CODEC_MP3) MP3Decoder_FreeBuffers();
@@ -3151,12 +3533,14 @@ exit:
         m_haveNewFilePos = 0;
         m_codec = CODEC_NONE;
 
+        TurnMetrics::mark(TURN_LAST_SAMPLE);
         if(afn) {
             if(audio_eof_mp3) audio_eof_mp3(afn);
             AUDIO_INFO("End of file \"%s\"", afn);
             x_ps_free(&afn);
         }
-
+        if(!m_f_running && !m_playQueue.empty()) playNextQueued(); // unless audio_eof_mp3() started something else
+        m_f_gapless = false;
         return;
     }
 }
@@ -3205,7 +3589,7 @@ void Audio::processWebStream() {
 
             if(m_f_metadata) m_metacount -= bytesAddedToBuffer;
             if(m_f_chunked) chunkSize -= bytesAddedToBuffer;
-            InBuff.bytesWritten(bytesAddedToBuffer);
+            inBuffWritten(bytesAddedToBuffer);
         }
     }
 
@@ -3269,7 +3653,7 @@ void Audio::processWebFile() {
         byteCounter += bytesAddedToBuffer;
         if(m_f_chunked) m_chunkcount -= bytesAddedToBuffer;
         if(m_controlCounter == 100) audioDataCount += bytesAddedToBuffer;
-        InBuff.bytesWritten(bytesAddedToBuffer);
+        inBuffWritten(bytesAddedToBuffer);
     }
 
     // we have a webfile, read the file header first - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -3298,8 +3682,11 @@ void Audio::processWebFile() {
 
     // end of webfile reached? - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
     if(m_f_eof) { // m_f_eof and m_f_ID3v1TagFound will be set in playAudioData()
+        if(m_validSamples) return;
+        if(m_pcmQueue.buffered() && m_playQueue.empty()) return; // let the audio task play out the PCM queue first
         if(m_f_ID3v1TagFound) readID3V1Tag();
 
+        m_f_gapless = !m_playQueue.empty(); // the next item follows directly, keep the PCM queue playing
         m_f_running = false;
         m_streamType = ST_NONE;
         if(m_codec == CODEC_MP3) MP3Decoder_FreeBuffers();
@@ -3309,6 +3696,7 @@ void Audio::processWebFile() {
         if(m_codec == CODEC_OPUS) OPUSDecoder_FreeBuffers();
         if(m_codec == CODEC_VORBIS) VORBISDecoder_FreeBuffers();
         m_codec = CODEC_NONE;
+        TurnMetrics::mark(TURN_LAST_SAMPLE);
         if(m_f_tts) {
             AUDIO_INFO("End of speech \"%s\"", m_speechtxt);
             if(audio_eof_speech) audio_eof_speech(m_speechtxt);
@@ -3318,11 +3706,70 @@ void Audio::processWebFile() {
             AUDIO_INFO("End of webstream: \"%s\"", m_lastHost);
             if(audio_eof_stream) audio_eof_stream(m_lastHost);
         }
+        if(!m_f_running && !m_playQueue.empty()) playNextQueued(); // unless a callback started something else
+        m_f_gapless = false;
         return;
     }
     return;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::processBufferStream() {
+    if(m_dataMode != AUDIO_BUFFER) return; // guard, the data itself arrives through writeBuffer()
+    const uint32_t maxFrameSize = InBuff.getMaxBlockSize(); // every mp3/aac frame is not bigger
+
+    if(m_f_firstCall) { // runs only one time per connection, prepare for start
+        m_f_firstCall = false;
+        m_f_stream = false;
+        m_t0 = millis();
+    }
+
+    if(!m_f_stream) {
+        uint32_t filled = InBuff.bufferFilled();
+        if(m_f_bufferEnded && filled == 0) {m_f_eof = true;}           // nothing (left) to play
+        else if(filled <= maxFrameSize && !m_f_bufferEnded) {return;}  // wait for at least one complete frame
+        else if(m_controlCounter != 100) {                             // WAV header
+            size_t bytesRead = readAudioHeader(InBuff.getMaxAvailableBytes());
+            if(bytesRead > 0) InBuff.bytesWasRead(bytesRead);
+            else if(m_f_bufferEnded) m_controlCounter = 100;           // truncated header, play what is there
+            return;
+        }
+        else if(m_codec == CODEC_OGG) {
+            uint8_t codec = determineOggCodec(InBuff.getReadPtr(), maxFrameSize);
+            if     (codec == CODEC_FLAC)   {initializeDecoder(codec); m_codec = codec; return;}
+            else if(codec == CODEC_OPUS)   {initializeDecoder(codec); m_codec = codec; return;}
+            else if(codec == CODEC_VORBIS) {initializeDecoder(codec); m_codec = codec; return;}
+            else {stopSong(); return;}
+        }
+        else {
+            m_f_stream = true; // ready to play the audio data
+            uint16_t filltime = millis() - m_t0;
+            AUDIO_INFO("Buffer: stream ready, buffer filled in %d ms", filltime);
+            return;
+        }
+    }
+
+    // end of pushed data reached? - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    if(m_f_eof) { // m_f_eof will be set in playAudioData() once finishBuffer() was called and everything is decoded
+        if(m_validSamples) return;
+        if(m_pcmQueue.buffered() && m_playQueue.empty()) return; // let the audio task play out the PCM queue first
+
+        m_f_gapless = !m_playQueue.empty(); // the next item follows directly, keep the PCM queue playing
+        m_f_running = false;
+        m_dataMode = AUDIO_NONE;
+        if(m_codec == CODEC_MP3) MP3Decoder_FreeBuffers();
+        if(m_codec == CODEC_AAC) AACDecoder_FreeBuffers();
+        if(m_codec == CODEC_FLAC) FLACDecoder_FreeBuffers();
+        if(m_codec == CODEC_OPUS) OPUSDecoder_FreeBuffers();
+        if(m_codec == CODEC_VORBIS) VORBISDecoder_FreeBuffers();
+        m_codec = CODEC_NONE;
+        TurnMetrics::mark(TURN_LAST_SAMPLE);
+        AUDIO_INFO("End of pushed data");
+        if(audio_eof_stream) audio_eof_stream("buffer");
+        if(!m_f_running && !m_playQueue.empty()) playNextQueued(); // unless a callback started something else
+        m_f_gapless = false;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void Audio::processWebStreamTS() {
     uint32_t        availableBytes;                          // available bytes in stream
     static bool     f_firstPacket;
@@ -3349,7 +3796,7 @@ void Audio::processWebStreamTS() {
 
     if(m_dataMode != AUDIO_DATA) return; // guard
 
-    availableBytes = _client->available();
+    availableBytes = hlsAvailable();
     if(availableBytes) {
 
         /* If the m3u8 stream uses 'chunked data transfer' no content length is supplied. Then the chunk size determines the audio data to be processed.
@@ -3362,7 +3809,7 @@ void Audio::processWebStreamTS() {
         if(chunkSize) minBytes = min3(availableBytes, ts_packetsize - ts_packetPtr, chunkSize - byteCounter);
         else          minBytes = min(availableBytes, (uint32_t)(ts_packetsize - ts_packetPtr));
 
-        int res = _client->read(ts_packet + ts_packetPtr, minBytes);
+        int res = hlsRead(ts_packet + ts_packetPtr, minBytes);
         if(res > 0) {
             ts_packetPtr += res;
             byteCounter += res;
@@ -3389,13 +3836,13 @@ void Audio::processWebStreamTS() {
                 size_t ws = InBuff.writeSpace();
                 if(ws >= ts_packetLength) {
                     memcpy(InBuff.getWritePtr(), ts_packet + ts_packetStart, ts_packetLength);
-                    InBuff.bytesWritten(ts_packetLength);
+                    inBuffWritten(ts_packetLength);
                 }
                 else {
                     memcpy(InBuff.getWritePtr(), ts_packet + ts_packetStart, ws);
-                    InBuff.bytesWritten(ws);
+                    inBuffWritten(ws);
                     memcpy(InBuff.getWritePtr(), &ts_packet[ws + ts_packetStart], ts_packetLength - ws);
-                    InBuff.bytesWritten(ts_packetLength - ws);
+                    inBuffWritten(ts_packetLength - ws);
                 }
             }
             if (byteCounter == m_contentlength || byteCounter == chunkSize) {
@@ -3468,7 +3915,7 @@ void Audio::processWebStreamHLS() {
 
     if(m_dataMode != AUDIO_DATA) return; // guard
 
-    availableBytes = _client->available();
+    availableBytes = hlsAvailable();
     if(availableBytes) { // an ID3 header could come here
         uint8_t readedBytes = 0;
 
@@ -3479,7 +3926,8 @@ void Audio::processWebStreamHLS() {
 
         if(firstBytes) {
             if(ID3WritePtr < ID3BuffSize) {
-                ID3WritePtr += _client->readBytes(&ID3Buff[ID3WritePtr], ID3BuffSize - ID3WritePtr);
+                ID3WritePtr += m_f_hlsPrefetch ? hlsRead(&ID3Buff[ID3WritePtr], ID3BuffSize - ID3WritePtr)
+                                               : _client->readBytes(&ID3Buff[ID3WritePtr], ID3BuffSize - ID3WritePtr);
                 return;
             }
             if(m_controlCounter < 100) {
@@ -3497,13 +3945,13 @@ void Audio::processWebStreamHLS() {
             size_t ws = InBuff.writeSpace();
             if(ws >= ID3BuffSize - ID3ReadPtr) {
                 memcpy(InBuff.getWritePtr(), &ID3Buff[ID3ReadPtr], ID3BuffSize - ID3ReadPtr);
-                InBuff.bytesWritten(ID3BuffSize - ID3ReadPtr);
+                inBuffWritten(ID3BuffSize - ID3ReadPtr);
             }
             else {
                 memcpy(InBuff.getWritePtr(), &ID3Buff[ID3ReadPtr], ws);
-                InBuff.bytesWritten(ws);
+                inBuffWritten(ws);
                 memcpy(InBuff.getWritePtr(), &ID3Buff[ws + ID3ReadPtr], ID3BuffSize - (ID3ReadPtr + ws));
-                InBuff.bytesWritten(ID3BuffSize - (ID3ReadPtr + ws));
+                inBuffWritten(ID3BuffSize - (ID3ReadPtr + ws));
             }
             x_ps_free(&ID3Buff);
             byteCounter += ID3BuffSize;
@@ -3514,10 +3962,10 @@ void Audio::processWebStreamHLS() {
         size_t bytesWasWritten = 0;
         if(InBuff.writeSpace() >= availableBytes) {
         //    if(availableBytes > 1024) availableBytes = 1024; // 1K throttle
-            bytesWasWritten = _client->read(InBuff.getWritePtr(), availableBytes);
+            bytesWasWritten = hlsRead(InBuff.getWritePtr(), availableBytes);
         }
-        else { bytesWasWritten = _client->read(InBuff.getWritePtr(), InBuff.writeSpace()); }
-        InBuff.bytesWritten(bytesWasWritten);
+        else { bytesWasWritten = hlsRead(InBuff.getWritePtr(), InBuff.writeSpace()); }
+        inBuffWritten(bytesWasWritten);
 
         byteCounter += bytesWasWritten;
 
@@ -3554,6 +4002,133 @@ void Audio::processWebStreamHLS() {
     return;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+bool Audio::startHLSPrefetch(const char* segment) {
+    // From the first media segment on, m_hls downloads the next segments and refreshes the playlist in the
+    // background, so a high-latency link no longer stalls the stream at every segment boundary.
+    if(!m_hlsDepth || !m_f_psramFound) return false;
+    const char* playlist = m_lastM3U8host ? m_lastM3U8host : m_lastHost;
+    if(!m_hls.begin(m_hlsDepth, playlist, 5000)) return false;
+    m_hls.setRefreshInterval(m_m3u8_targetDuration * 500); // half the target duration (RFC 8216, 6.3.4)
+    m_hls.queueSegment(segment);
+    feedHLSPrefetcher();
+    if(_client->connected()) _client->stop(); // m_hls keeps its own connection to the segment host
+    m_f_hlsPrefetch = true;
+    m_hlsData = NULL;
+    m_hlsWaitSince = 0;
+    m_dataMode = AUDIO_PLAYLISTDATA;
+    AUDIO_INFO("HLS prefetch, %u segments ahead", m_hls.depth());
+    return true;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::feedHLSPrefetcher() {
+    // m_playlistURL holds the parsed segments, the next one to play at the back
+    while(m_playlistURL.size() && m_hls.freeSlots()) {
+        char* url = m_playlistURL[m_playlistURL.size() - 1];
+        if(!m_hls.queueSegment(url)) break;
+        if(endsWith(url, "ts")) m_f_ts = true;
+        if(indexOf(url, ".ts?") > 0) m_f_ts = true;
+        x_ps_free(&m_playlistURL[m_playlistURL.size() - 1]);
+        m_playlistURL.pop_back();
+    }
+    if(m_playlistURL.size() == 0) m_hls.requestPlaylist(); // fetched once the refresh interval has passed
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::readPlayListText(char* text) {
+    // playlist fetched by m_hls -> m_playlistContent, same line rules as readPlayListData()
+    vector_clear_and_shrink(m_playlistContent);
+    char* line = text;
+    while(line && *line) {
+        char* end = strchr(line, '\n');
+        if(end) *end = '\0';
+        size_t len = strlen(line);
+        if(len && line[len - 1] == '\r') line[--len] = '\0';
+        if(len > 509) line[509] = '\0';
+        if(len) m_playlistContent.push_back(x_ps_strdup(line));
+        line = end ? end + 1 : NULL;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+bool Audio::openHLSSegment() {
+    // a prefetched segment takes the place of the response header and body of the segment request
+    HLSPrefetcher::Segment seg;
+    if(!m_hls.takeSegment(seg)) return false;
+
+    uint8_t codec = m_codec;
+    char    ct[48];
+    strlcpy(ct, seg.contentType, sizeof(ct));
+    if(ct[0]) parseContentType(ct);
+    if(m_codec == CODEC_NONE) m_codec = codec; // no audio content type, keep the codec of the playlist
+
+    m_contentlength = seg.size;
+    m_f_chunked = false;
+    m_streamType = ST_WEBFILE;
+    m_hlsData = seg.data;
+    m_hlsSize = seg.size;
+    m_hlsPos = 0;
+    if(m_codec != CODEC_OGG && !initializeDecoder(m_codec)) {
+        m_hlsData = NULL;
+        m_hls.releaseSegment();
+        stopSong();
+        return false;
+    }
+    m_dataMode = AUDIO_DATA;
+    m_controlCounter = 0;
+    m_f_firstCall = true;
+    if(m_f_Log) log_i("now playing %s, %lu bytes", seg.url, (long unsigned int)seg.size);
+    return true;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+int Audio::hlsRead(uint8_t* buf, size_t len) {
+    if(!m_f_hlsPrefetch) return _client->read(buf, len);
+    size_t n = min(len, (size_t)(m_hlsSize - m_hlsPos));
+    memcpy(buf, m_hlsData + m_hlsPos, n);
+    m_hlsPos += n;
+    return n;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::processHLSPrefetch() {
+    // m3u8 stream with m_hls: playlist refreshes arrive as text and are parsed as before, the segments
+    // are read from PSRAM by processWebStreamTS() / processWebStreamHLS()
+    char* text = m_hls.takePlaylist();
+    if(text) {
+        readPlayListText(text);
+        AudioMemory::release(text);
+        const char* url = parsePlaylist_M3U8();                               // new segments -> m_playlistURL, the next one is returned
+        if(!m_f_hlsPrefetch) return;                                          // parsing gave up and reconnected
+        if(url == m_playlistBuff) m_playlistURL.push_back(x_ps_strdup(url));  // put it back, it plays next
+        else if(url) {m_hls.setPlaylist(url); m_hls.requestPlaylist();}       // a variant playlist, follow it
+        m_hls.setRefreshInterval(m_m3u8_targetDuration * 500);
+    }
+    feedHLSPrefetcher();
+
+    if(!m_hlsData) {
+        if(!openHLSSegment()) {
+            if(!m_f_hlsPrefetch) return;
+            if(!m_hlsWaitSince) m_hlsWaitSince = millis() | 1;
+            else if(millis() - m_hlsWaitSince > m_m3u8_targetDuration * 3000UL) { // nothing arrives, start over
+                AUDIO_INFO("Stream lost -> try new connection");
+                connecttohost(m_lastHost);
+            }
+            return;
+        }
+        if(m_f_stream && m_hlsWaitSince && InBuff.bufferFilled() < InBuff.getMaxBlockSize()) { // input ran dry while waiting
+            AUDIO_INFO("HLS segment %lu ms late", (long unsigned int)(millis() - m_hlsWaitSince));
+            TurnMetrics::underrun();
+        }
+        m_hlsWaitSince = 0;
+    }
+
+    if(m_f_ts) processWebStreamTS();
+    else       processWebStreamHLS();
+
+    if(m_f_continue && m_hlsData) { // segment handed to InBuff completely, its slot takes the next URL
+        m_f_continue = false;
+        m_hlsData = NULL;
+        m_hls.releaseSegment();
+        m_dataMode = AUDIO_PLAYLISTDATA;
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void Audio::playAudioData() {
 
     if(!m_f_stream) return; // guard
@@ -3582,6 +4157,10 @@ void Audio::playAudioData() {
         if(bytesToDecode < InBuff.getMaxBlockSize()) {lastFrame = true;}
         if(m_sumBytesDecoded >= m_audioDataSize && m_sumBytesDecoded != 0) { m_f_eof = true; goto exit; }
     }
+    else if(m_dataMode == AUDIO_BUFFER && m_f_bufferEnded) { // pushed data: the end is known once finishBuffer() was called
+        if(InBuff.bufferFilled() == 0) { m_f_eof = true; goto exit; }
+        if(InBuff.bufferFilled() < InBuff.getMaxBlockSize()) {lastFrame = true;}
+    }
     if(!lastFrame) if(InBuff.bufferFilled() < InBuff.getMaxBlockSize()) goto exit;;
 
     bytesDecoded = sendBytes(InBuff.getReadPtr(), InBuff.getMaxBlockSize());
@@ -3603,6 +4182,7 @@ void Audio::playAudioData() {
             }
             goto exit;
         }
+        if(bytesDecoded == 0 && lastFrame && m_dataMode == AUDIO_BUFFER) { m_f_eof = true; goto exit; } // incomplete last frame
         if(bytesDecoded == 0) goto exit; // syncword at pos0
     }
 exit:
@@ -4334,6 +4914,8 @@ void Audio::setDecoderItems() {
             m_audioDataStart = VORBISGetAudioDataStart();
             if(getFileSize()) m_audioDataSize = getFileSize() - m_audioDataStart;
         }
+        AUDIO_INFO("VORBIS setup took %lu us, decoder memory peak %lu bytes", (long unsigned int)VORBISGetSetupTime(),
+                   (long unsigned int)VORBISGetPeakMemory());
     }
     if(getBitsPerSample() != 8 && getBitsPerSample() != 16) {
         AUDIO_INFO("Bits per sample must be 8 or 16, found %i", getBitsPerSample());
@@ -4343,7 +4925,18 @@ void Audio::setDecoderItems() {
         AUDIO_INFO("Num of channels must be 1 or 2, found %i", getChannels());
         stopSong();
     }
-    reconfigI2S();
+    uint32_t i2sRate = (getBitsPerSample() == 8 && getChannels() == 2) ? getSampleRate() * 2 : getSampleRate();
+    if(m_outputRate) {
+        // keeps its state while the rate stays, a gapless hand-over continues the filter
+        if(m_resampler.begin(i2sRate, m_outputRate, 2, m_resampleQuality)) i2sRate = m_outputRate;
+        else AUDIO_INFO("Resampler unavailable, I2S follows the source rate");
+    }
+    else m_resampler.end();
+    if(i2sRate != m_i2sSampleRate) {
+        // the previous item's tail plays at its own rate, playChunk() switches once the audio task has sent it
+        if(m_pcmQueue.data() && m_pcmQueue.buffered()) m_f_reconfigPending = true;
+        else reconfigI2S();
+    }
     showCodecParams();
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -4816,6 +5409,8 @@ bool Audio::setFilePos(uint32_t pos) {
     if(m_codec == CODEC_AAC) return false;   // not impl. yet
     memset(m_outBuff, 0, m_outbuffSize * sizeof(int16_t));
     m_validSamples = 0;
+    m_pcmQueue.discard();
+    m_resampler.reset();
     m_haveNewFilePos = pos; // used in computeAudioCurrentTime()
     if(m_dataMode == AUDIO_LOCALFILE){
         m_resumeFilePos = pos;  // used in processLocalFile()
@@ -4858,8 +5453,11 @@ void Audio::reconfigI2S(){
 
     I2Sstop(0);
 
-    if(getBitsPerSample() == 8 && getChannels() == 2) m_i2s_std_cfg.clk_cfg.sample_rate_hz = getSampleRate() * 2;
+    if(m_resampler.converting()) m_i2s_std_cfg.clk_cfg.sample_rate_hz = m_resampler.outRate();
+    else if(getBitsPerSample() == 8 && getChannels() == 2) m_i2s_std_cfg.clk_cfg.sample_rate_hz = getSampleRate() * 2;
     else m_i2s_std_cfg.clk_cfg.sample_rate_hz = getSampleRate();
+    m_i2sSampleRate = m_i2s_std_cfg.clk_cfg.sample_rate_hz; // setDecoderItems() skips the reconfiguration while it matches
+    m_mixer.setOutputRate(m_i2sSampleRate);                 // mixer sources follow the new clock
 
     if(!m_f_commFMT) m_i2s_std_cfg.slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_STEREO);
     else             m_i2s_std_cfg.slot_cfg = I2S_STD_MSB_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_STEREO);
@@ -4906,7 +5504,7 @@ void Audio::setI2SCommFMT_LSB(bool commFMT) {
     i2s_channel_enable(m_i2s_tx_handle);
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-void Audio::computeVUlevel(int16_t sample[2]) {
+void Audio::computeVUlevel(const int16_t* buff, int frames, uint8_t channels) {
     static uint8_t sampleArray[2][4][8] = {0};
     static uint8_t cnt0 = 0, cnt1 = 0, cnt2 = 0, cnt3 = 0, cnt4 = 0;
     static bool    f_vu = false;
@@ -4925,47 +5523,52 @@ void Audio::computeVUlevel(int16_t sample[2]) {
         return maxValue;
     };
 
-    if(cnt0 == 64) {
-        cnt0 = 0;
-        cnt1++;
-    }
-    if(cnt1 == 8) {
-        cnt1 = 0;
-        cnt2++;
-    }
-    if(cnt2 == 8) {
-        cnt2 = 0;
-        cnt3++;
-    }
-    if(cnt3 == 8) {
-        cnt3 = 0;
-        cnt4++;
-        f_vu = true;
-    }
-    if(cnt4 == 8) { cnt4 = 0; }
+    for(int i = 0; i < frames; i++) {
+        const int16_t* sample = buff + i * channels;
+        const int      right = (channels == 2) ? RIGHTCHANNEL : LEFTCHANNEL; // mono: same sample on both sides
 
-    if(!cnt0) { // store every 64th sample in the array[0]
-        sampleArray[LEFTCHANNEL][0][cnt1] = abs(sample[LEFTCHANNEL] >> 7);
-        sampleArray[RIGHTCHANNEL][0][cnt1] = abs(sample[RIGHTCHANNEL] >> 7);
-    }
-    if(!cnt1) { // store argest from 64 * 8 samples in the array[1]
-        sampleArray[LEFTCHANNEL][1][cnt2] = largest(sampleArray[LEFTCHANNEL][0]);
-        sampleArray[RIGHTCHANNEL][1][cnt2] = largest(sampleArray[RIGHTCHANNEL][0]);
-    }
-    if(!cnt2) { // store avg from 64 * 8 * 8 samples in the array[2]
-        sampleArray[LEFTCHANNEL][2][cnt3] = largest(sampleArray[LEFTCHANNEL][1]);
-        sampleArray[RIGHTCHANNEL][2][cnt3] = largest(sampleArray[RIGHTCHANNEL][1]);
-    }
-    if(!cnt3) { // store avg from 64 * 8 * 8 * 8 samples in the array[3]
-        sampleArray[LEFTCHANNEL][3][cnt4] = avg(sampleArray[LEFTCHANNEL][2]);
-        sampleArray[RIGHTCHANNEL][3][cnt4] = avg(sampleArray[RIGHTCHANNEL][2]);
-    }
-    if(f_vu) {
-        f_vu = false;
-        m_vuLeft = avg(sampleArray[LEFTCHANNEL][3]);
-        m_vuRight = avg(sampleArray[RIGHTCHANNEL][3]);
+        if(cnt0 == 64) {
+            cnt0 = 0;
+            cnt1++;
+        }
+        if(cnt1 == 8) {
+            cnt1 = 0;
+            cnt2++;
+        }
+        if(cnt2 == 8) {
+            cnt2 = 0;
+            cnt3++;
+        }
+        if(cnt3 == 8) {
+            cnt3 = 0;
+            cnt4++;
+            f_vu = true;
+        }
+        if(cnt4 == 8) { cnt4 = 0; }
+
+        if(!cnt0) { // store every 64th sample in the array[0]
+            sampleArray[LEFTCHANNEL][0][cnt1] = abs(sample[LEFTCHANNEL] >> 7);
+            sampleArray[RIGHTCHANNEL][0][cnt1] = abs(sample[right] >> 7);
+        }
+        if(!cnt1) { // store argest from 64 * 8 samples in the array[1]
+            sampleArray[LEFTCHANNEL][1][cnt2] = largest(sampleArray[LEFTCHANNEL][0]);
+            sampleArray[RIGHTCHANNEL][1][cnt2] = largest(sampleArray[RIGHTCHANNEL][0]);
+        }
+        if(!cnt2) { // store avg from 64 * 8 * 8 samples in the array[2]
+            sampleArray[LEFTCHANNEL][2][cnt3] = largest(sampleArray[LEFTCHANNEL][1]);
+            sampleArray[RIGHTCHANNEL][2][cnt3] = largest(sampleArray[RIGHTCHANNEL][1]);
+        }
+        if(!cnt3) { // store avg from 64 * 8 * 8 * 8 samples in the array[3]
+            sampleArray[LEFTCHANNEL][3][cnt4] = avg(sampleArray[LEFTCHANNEL][2]);
+            sampleArray[RIGHTCHANNEL][3][cnt4] = avg(sampleArray[RIGHTCHANNEL][2]);
+        }
+        if(f_vu) {
+            f_vu = false;
+            m_vuLeft = avg(sampleArray[LEFTCHANNEL][3]);
+            m_vuRight = avg(sampleArray[RIGHTCHANNEL][3]);
+        }
+        cnt1++;
     }
-    cnt1++;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 uint16_t Audio::getVUlevel() {
@@ -4993,14 +5596,54 @@ void Audio::setTone(int8_t gainLowPass, int8_t gainBandPass, int8_t gainHighPass
           Because when the EQ is adjusted, the IIR filter will be cleared and played,
           mixed in the audio data frame, and a click-like sound will be produced.
 
-          int16_t tmp[2]; tmp[0] = 0; tmp[1]= 0;
-
-          IIR_filterChain0(tmp, true ); // flush the filter
-          IIR_filterChain1(tmp, true ); // flush the filter
-          IIR_filterChain2(tmp, true ); // flush the filter
+          memset(m_filterBuff, 0, sizeof(m_filterBuff)); // flush the filter
         */
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::setOutputSampleRate(uint32_t rate, ResampleQuality quality) {
+    // I2S stays at this rate, so items of different rates follow each other without draining and reconfiguring
+    m_outputRate = rate;
+    m_resampleQuality = quality;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+bool Audio::openMixSource(uint8_t id, uint32_t sampleRate, uint8_t channels, bool ducker, size_t bufferBytes) {
+    if(!m_pcmQueue.data()) {log_e("the mixer needs the PCM queue"); return false;}
+    xSemaphoreTake(mutex_audioTask, 0.3 * configTICK_RATE_HZ);
+    m_mixer.setOutputRate(m_i2s_std_cfg.clk_cfg.sample_rate_hz); // no-op once a stream has set the clock
+    bool ok = m_mixer.openSource(id, sampleRate, channels, bufferBytes);
+    m_mixer.setDucker(id, ducker);
+    xSemaphoreGive(mutex_audioTask);
+    return ok;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::closeMixSource(uint8_t id) {
+    xSemaphoreTake(mutex_audioTask, 0.3 * configTICK_RATE_HZ);
+    m_mixer.closeSource(id);
+    xSemaphoreGive(mutex_audioTask);
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+size_t Audio::writeMixSource(uint8_t id, const int16_t* pcm, size_t frames) {
+    size_t n = m_mixer.write(id, pcm, frames);
+    if(n) notifyAudioTask(); // plays even if no stream wakes the task
+    return n;
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+size_t Audio::mixSourceWritable(uint8_t id) {
+    return m_mixer.writable(id);
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::flushMixSource(uint8_t id) {
+    m_mixer.flush(id);
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::setMixGain(uint8_t id, float gain) {
+    m_mixer.setGain(id, gain);
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void Audio::setDucking(float attenuationDb, uint16_t attackMs, uint16_t releaseMs) {
+    m_mixer.setDucking(attenuationDb, attackMs, releaseMs);
+}
+//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void Audio::forceMono(bool m) { // #100 mono option
     m_f_forceMono = m;          // false stereo, true mono
 }
@@ -5053,10 +5696,32 @@ void Audio::computeLimit() {    // is calculated when the volume or balance chan
     // log_i("m_limit_left %f,  m_limit_right %f ",m_limit_left, m_limit_right);
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-void Audio::Gain(int16_t* sample) {
+void Audio::Gain(int16_t* buff, int frames, uint8_t channels) {
+    // volume curve and balance as Q16 factors (<= 1.0, so the result always fits int16)
     /* important: these multiplications must all be signed ints, or the result will be invalid */
-    sample[LEFTCHANNEL]  *= m_limit_left ;
-    sample[RIGHTCHANNEL] *= m_limit_right;
+    const int32_t gainL = (int32_t)(m_limit_left  * 65536);
+    const int32_t gainR = (int32_t)(m_limit_right * 65536);
+
+    if(channels == 1) {
+        // upmix mono in place, back to front so no sample is overwritten before it is read
+        for(int i = frames - 1; i >= 0; --i) {
+            int32_t s = buff[i];
+            buff[2 * i + RIGHTCHANNEL] = (int16_t)((s * gainR) >> 16);
+            buff[2 * i + LEFTCHANNEL]  = (int16_t)((s * gainL) >> 16);
+        }
+        return;
+    }
+
+    const bool mono = m_f_forceMono && m_channels == 2;
+    if(!mono && gainL == 65536 && gainR == 65536) return; // full volume, centered: nothing to do
+
+    for(int i = 0; i < frames * 2; i += 2) {
+        int32_t l = buff[i + LEFTCHANNEL];
+        int32_t r = buff[i + RIGHTCHANNEL];
+        if(mono) { l = r = (l + r) / 2; }
+        buff[i + LEFTCHANNEL]  = (int16_t)((l * gainL) >> 16);
+        buff[i + RIGHTCHANNEL] = (int16_t)((r * gainR) >> 16);
+    }
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 uint32_t Audio::inBufferFilled() {
@@ -5177,150 +5842,81 @@ void Audio::IIR_calculateCoefficients(int8_t G0, int8_t G1, int8_t G2) { // Infi
     //                                                  m_filter[1].b1, m_filter[1].b2);
     //    log_i("HS a0=%f, a1=%f, a2=%f, b1=%f, b2=%f", m_filter[2].a0, m_filter[2].a1, m_filter[2].a2,
     //                                                  m_filter[2].b1, m_filter[2].b2);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // coefficients for IIR_filterBlock(): a 0 dB stage has unity transfer and is skipped,
+    // the level correction (1 / m_corr) is folded into the feed forward part of the first active stage
+    const int8_t G[3] = {G0, G1, G2};
+    float        corr = (m_corr > 1) ? 1 / m_corr : 1;
+    for(int i = 0; i < 3; i++) {
+        m_filterActive[i] = (G[i] != 0);
+        float scale = 1;
+        if(m_filterActive[i]) {
+            scale = corr;
+            corr = 1;
+        }
+        const float Q28 = 268435456.0f;
+        m_filterQ[i].a0 = (int32_t)lrintf(m_filter[i].a0 * scale * Q28);
+        m_filterQ[i].a1 = (int32_t)lrintf(m_filter[i].a1 * scale * Q28);
+        m_filterQ[i].a2 = (int32_t)lrintf(m_filter[i].a2 * scale * Q28);
+        m_filterQ[i].b1 = (int32_t)lrintf(m_filter[i].b1 * Q28);
+        m_filterQ[i].b2 = (int32_t)lrintf(m_filter[i].b2 * Q28);
+#ifdef AUDIO_USE_ESP_DSP
+        m_filterCoef[i][0] = m_filter[i].a0 * scale;
+        m_filterCoef[i][1] = m_filter[i].a1 * scale;
+        m_filterCoef[i][2] = m_filter[i].a2 * scale;
+        m_filterCoef[i][3] = m_filter[i].b1;
+        m_filterCoef[i][4] = m_filter[i].b2;
+#endif
+    }
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-// clang-format off
-void Audio::IIR_filterChain0(int16_t iir_in[2], bool clear) { // Infinite Impulse Response (IIR) filters
-
-    uint8_t z1 = 0, z2 = 1;
-    enum : uint8_t { in = 0, out = 1 };
-    float          inSample[2];
-    float          outSample[2];
-    static int16_t iir_out[2];
-
-    if(clear) {
-        memset(m_filterBuff, 0, sizeof(m_filterBuff)); // zero IIR filterbuffer
-        iir_out[0] = 0;
-        iir_out[1] = 0;
-        iir_in[0] = 0;
-        iir_in[1] = 0;
-    }
-
-    inSample[LEFTCHANNEL] = (float)(iir_in[LEFTCHANNEL]);
-    inSample[RIGHTCHANNEL] = (float)(iir_in[RIGHTCHANNEL]);
-
-    outSample[LEFTCHANNEL] =
-        m_filter[0].a0 * inSample[LEFTCHANNEL] + m_filter[0].a1 * m_filterBuff[0][z1][in][LEFTCHANNEL] +
-        m_filter[0].a2 * m_filterBuff[0][z2][in][LEFTCHANNEL] - m_filter[0].b1 * m_filterBuff[0][z1][out][LEFTCHANNEL] -
-        m_filter[0].b2 * m_filterBuff[0][z2][out][LEFTCHANNEL];
-
-    m_filterBuff[0][z2][in][LEFTCHANNEL] = m_filterBuff[0][z1][in][LEFTCHANNEL];
-    m_filterBuff[0][z1][in][LEFTCHANNEL] = inSample[LEFTCHANNEL];
-    m_filterBuff[0][z2][out][LEFTCHANNEL] = m_filterBuff[0][z1][out][LEFTCHANNEL];
-    m_filterBuff[0][z1][out][LEFTCHANNEL] = outSample[LEFTCHANNEL];
-    iir_out[LEFTCHANNEL] = (int16_t)outSample[LEFTCHANNEL];
-
-    outSample[RIGHTCHANNEL] = m_filter[0].a0 * inSample[RIGHTCHANNEL] +
-                              m_filter[0].a1 * m_filterBuff[0][z1][in][RIGHTCHANNEL] +
-                              m_filter[0].a2 * m_filterBuff[0][z2][in][RIGHTCHANNEL] -
-                              m_filter[0].b1 * m_filterBuff[0][z1][out][RIGHTCHANNEL] -
-                              m_filter[0].b2 * m_filterBuff[0][z2][out][RIGHTCHANNEL];
-
-    m_filterBuff[0][z2][in][RIGHTCHANNEL] = m_filterBuff[0][z1][in][RIGHTCHANNEL];
-    m_filterBuff[0][z1][in][RIGHTCHANNEL] = inSample[RIGHTCHANNEL];
-    m_filterBuff[0][z2][out][RIGHTCHANNEL] = m_filterBuff[0][z1][out][RIGHTCHANNEL];
-    m_filterBuff[0][z1][out][RIGHTCHANNEL] = outSample[RIGHTCHANNEL];
-    iir_out[RIGHTCHANNEL] = (int16_t)outSample[RIGHTCHANNEL];
-
-    iir_in[LEFTCHANNEL] = iir_out[LEFTCHANNEL];
-    iir_in[RIGHTCHANNEL] = iir_out[RIGHTCHANNEL];
-    return;
-}
-//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-void Audio::IIR_filterChain1(int16_t iir_in[2], bool clear) { // Infinite Impulse Response (IIR) filters
-
-    uint8_t z1 = 0, z2 = 1;
-    enum : uint8_t { in = 0, out = 1 };
-    float          inSample[2];
-    float          outSample[2];
-    static int16_t iir_out[2];
-
-    if(clear) {
-        memset(m_filterBuff, 0, sizeof(m_filterBuff)); // zero IIR filterbuffer
-        iir_out[0] = 0;
-        iir_out[1] = 0;
-        iir_in[0] = 0;
-        iir_in[1] = 0;
-    }
-
-    inSample[LEFTCHANNEL] = (float)(iir_in[LEFTCHANNEL]);
-    inSample[RIGHTCHANNEL] = (float)(iir_in[RIGHTCHANNEL]);
-
-    outSample[LEFTCHANNEL] =
-        m_filter[1].a0 * inSample[LEFTCHANNEL] + m_filter[1].a1 * m_filterBuff[1][z1][in][LEFTCHANNEL] +
-        m_filter[1].a2 * m_filterBuff[1][z2][in][LEFTCHANNEL] - m_filter[1].b1 * m_filterBuff[1][z1][out][LEFTCHANNEL] -
-        m_filter[1].b2 * m_filterBuff[1][z2][out][LEFTCHANNEL];
-
-    m_filterBuff[1][z2][in][LEFTCHANNEL] = m_filterBuff[1][z1][in][LEFTCHANNEL];
-    m_filterBuff[1][z1][in][LEFTCHANNEL] = inSample[LEFTCHANNEL];
-    m_filterBuff[1][z2][out][LEFTCHANNEL] = m_filterBuff[1][z1][out][LEFTCHANNEL];
-    m_filterBuff[1][z1][out][LEFTCHANNEL] = outSample[LEFTCHANNEL];
-    iir_out[LEFTCHANNEL] = (int16_t)outSample[LEFTCHANNEL];
-
-    outSample[RIGHTCHANNEL] = m_filter[1].a0 * inSample[RIGHTCHANNEL] +
-                              m_filter[1].a1 * m_filterBuff[1][z1][in][RIGHTCHANNEL] +
-                              m_filter[1].a2 * m_filterBuff[1][z2][in][RIGHTCHANNEL] -
-                              m_filter[1].b1 * m_filterBuff[1][z1][out][RIGHTCHANNEL] -
-                              m_filter[1].b2 * m_filterBuff[1][z2][out][RIGHTCHANNEL];
-
-    m_filterBuff[1][z2][in][RIGHTCHANNEL] = m_filterBuff[1][z1][in][RIGHTCHANNEL];
-    m_filterBuff[1][z1][in][RIGHTCHANNEL] = inSample[RIGHTCHANNEL];
-    m_filterBuff[1][z2][out][RIGHTCHANNEL] = m_filterBuff[1][z1][out][RIGHTCHANNEL];
-    m_filterBuff[1][z1][out][RIGHTCHANNEL] = outSample[RIGHTCHANNEL];
-    iir_out[RIGHTCHANNEL] = (int16_t)outSample[RIGHTCHANNEL];
-
-    iir_in[LEFTCHANNEL] = iir_out[LEFTCHANNEL];
-    iir_in[RIGHTCHANNEL] = iir_out[RIGHTCHANNEL];
-    return;
-}
-//------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-void Audio::IIR_filterChain2(int16_t iir_in[2], bool clear) { // Infinite Impulse Response (IIR) filters
-
-    uint8_t z1 = 0, z2 = 1;
-    enum : uint8_t { in = 0, out = 1 };
-    float          inSample[2];
-    float          outSample[2];
-    static int16_t iir_out[2];
-
-    if(clear) {
-        memset(m_filterBuff, 0, sizeof(m_filterBuff)); // zero IIR filterbuffer
-        iir_out[0] = 0;
-        iir_out[1] = 0;
-        iir_in[0] = 0;
-        iir_in[1] = 0;
-    }
-
-    inSample[LEFTCHANNEL] = (float)(iir_in[LEFTCHANNEL]);
-    inSample[RIGHTCHANNEL] = (float)(iir_in[RIGHTCHANNEL]);
-
-    outSample[LEFTCHANNEL] =
-        m_filter[2].a0 * inSample[LEFTCHANNEL] + m_filter[2].a1 * m_filterBuff[2][z1][in][LEFTCHANNEL] +
-        m_filter[2].a2 * m_filterBuff[2][z2][in][LEFTCHANNEL] - m_filter[2].b1 * m_filterBuff[2][z1][out][LEFTCHANNEL] -
-        m_filter[2].b2 * m_filterBuff[2][z2][out][LEFTCHANNEL];
-
-    m_filterBuff[2][z2][in][LEFTCHANNEL] = m_filterBuff[2][z1][in][LEFTCHANNEL];
-    m_filterBuff[2][z1][in][LEFTCHANNEL] = inSample[LEFTCHANNEL];
-    m_filterBuff[2][z2][out][LEFTCHANNEL] = m_filterBuff[2][z1][out][LEFTCHANNEL];
-    m_filterBuff[2][z1][out][LEFTCHANNEL] = outSample[LEFTCHANNEL];
-    iir_out[LEFTCHANNEL] = (int16_t)outSample[LEFTCHANNEL];
-
-    outSample[RIGHTCHANNEL] = m_filter[2].a0 * inSample[RIGHTCHANNEL] +
-                              m_filter[2].a1 * m_filterBuff[2][z1][in][RIGHTCHANNEL] +
-                              m_filter[2].a2 * m_filterBuff[2][z2][in][RIGHTCHANNEL] -
-                              m_filter[2].b1 * m_filterBuff[2][z1][out][RIGHTCHANNEL] -
-                              m_filter[2].b2 * m_filterBuff[2][z2][out][RIGHTCHANNEL];
-
-    m_filterBuff[2][z2][in][RIGHTCHANNEL] = m_filterBuff[2][z1][in][RIGHTCHANNEL];
-    m_filterBuff[2][z1][in][RIGHTCHANNEL] = inSample[RIGHTCHANNEL];
-    m_filterBuff[2][z2][out][RIGHTCHANNEL] = m_filterBuff[2][z1][out][RIGHTCHANNEL];
-    m_filterBuff[2][z1][out][RIGHTCHANNEL] = outSample[RIGHTCHANNEL];
-    iir_out[RIGHTCHANNEL] = (int16_t)outSample[RIGHTCHANNEL];
-
-    iir_in[LEFTCHANNEL] = iir_out[LEFTCHANNEL];
-    iir_in[RIGHTCHANNEL] = iir_out[RIGHTCHANNEL];
-    return;
+void Audio::IIR_filterBlock(int16_t* buff, int frames, uint8_t channels) { // Infinite Impulse Response (IIR) filters
+    // lowshelf, peakEQ and highshelf biquads over a whole block, one stage at a time per channel
+
+    if(!m_filterActive[0] && !m_filterActive[1] && !m_filterActive[2]) return; // tone neutral
+
+    for(int ch = 0; ch < channels; ch++) {
+#ifdef AUDIO_USE_ESP_DSP
+        const int blockLen = sizeof(m_dspScratch) / sizeof(m_dspScratch[0]);
+        for(int pos = 0; pos < frames; pos += blockLen) {
+            int n = min(blockLen, frames - pos);
+            int16_t* p = buff + pos * channels + ch;
+            for(int i = 0; i < n; i++) m_dspScratch[i] = (float)p[i * channels];
+            for(int f = 0; f < 3; f++) {
+                if(!m_filterActive[f]) continue;
+                dsps_biquad_f32(m_dspScratch, m_dspScratch, n, m_filterCoef[f], m_filterBuff[f][ch].w);
+            }
+            for(int i = 0; i < n; i++) {
+                int32_t out = lrintf(m_dspScratch[i]);
+                p[i * channels] = out > 32767 ? 32767 : (out < -32768 ? -32768 : out);
+            }
+        }
+#else
+        for(int f = 0; f < 3; f++) {
+            if(!m_filterActive[f]) continue;
+
+            const filter_q_t& q = m_filterQ[f];
+            iir_state_t&      s = m_filterBuff[f][ch];
+            int32_t x1 = s.x1, x2 = s.x2, y1 = s.y1, y2 = s.y2;
+            int16_t* p = buff + ch;
+
+            for(int i = 0; i < frames; i++, p += channels) {
+                int32_t x = *p;
+                // Q28 coefficients, inputs Q0, outputs kept with 8 fractional bits for the feedback path
+                int64_t acc = ((int64_t)q.a0 * x + (int64_t)q.a1 * x1 + (int64_t)q.a2 * x2) << 8;
+                acc -= (int64_t)q.b1 * y1 + (int64_t)q.b2 * y2;
+                int32_t y = (int32_t)(acc >> 28);
+                x2 = x1; x1 = x;
+                y2 = y1; y1 = y;
+                int32_t out = (y + 128) >> 8;
+                *p = out > 32767 ? 32767 : (out < -32768 ? -32768 : out);
+            }
+            s.x1 = x1; s.x2 = x2; s.y1 = y1; s.y2 = y2;
+        }
+#endif
+    }
 }
-// clang-format on
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 //    AAC - T R A N S P O R T S T R E A M
 //-------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -5728,7 +6324,7 @@ boolean Audio::streamDetection(uint32_t bytesAvail) {
     // issue a message
     if(tmr_slow + 1000 < millis()) {
         tmr_slow = millis();
-        if(cnt_slow > 100) AUDIO_INFO("slow stream, dropouts are possible");
+        if(cnt_slow > 100) {AUDIO_INFO("slow stream, dropouts are possible"); TurnMetrics::underrun();}
         cnt_slow = 0;
     }
     if(InBuff.bufferFilled() < InBuff.getMaxBlockSize()) cnt_slow++;
@@ -6149,11 +6745,13 @@ uint8_t Audio::determineOggCodec(uint8_t* data, uint16_t len) {
     return CODEC_NONE;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-// separate task for decoding and outputting the data. 'playAudioData()' is started periodically and fetches the data from the InBuffer. This ensures
-// that the I2S-DMA is always sufficiently filled, even if the Arduino 'loop' is stuck.
+// separate task for decoding and outputting the data. The task sleeps on a task notification, given from the I2S 'on_sent' DMA callback and
+// whenever new data is written to the InBuffer. 'playAudioData()' then decodes a few frames ahead into the PCM queue, which feeds the I2S-DMA.
+// This ensures that the I2S-DMA is always sufficiently filled, even if the Arduino 'loop' is stuck.
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 
 void Audio::setAudioTaskCore(uint8_t coreID){  // Recommendation:If the ARDUINO RUNNING CORE is 1, the audio task should be core 0 or vice versa
+                                               // restarts the task, priority and stack follow AudioTasks::set(AUDIO_TASK_DECODE, ...)
     if(coreID > 1) return;
     stopAudioTask();
     xSemaphoreTake(mutex_audioTask, 0.3 * configTICK_RATE_HZ);
@@ -6167,21 +6765,60 @@ void Audio::startAudioTask() {
         log_i("Task is already running.");
         return;
     }
+    AudioTaskConfig cfg = AudioTasks::get(AUDIO_TASK_DECODE);
+    if(m_audioTaskCoreId != AUDIO_CORE_DEFAULT) cfg.core = m_audioTaskCoreId;
+    // the stack is kept across restarts, it only changes with the configuration (a PSRAM stack: no SPIFFS/FFat playback)
+    bool psram = cfg.psramStack && psramFound();
+    if(m_audioTaskStack && (m_audioTaskStackSize != cfg.stackBytes || AudioMemory::inPSRAM(m_audioTaskStack) != psram)) {
+        AudioMemory::release(m_audioTaskStack);
+        m_audioTaskStack = nullptr;
+    }
+    if(!m_audioTaskStack) {
+        m_audioTaskStack = (StackType_t*)AudioMemory::alloc(cfg.stackBytes, psram ? AUDIO_MEM_PSRAM_PREFERRED : AUDIO_MEM_INTERNAL);
+        m_audioTaskStackSize = cfg.stackBytes;
+    }
+    if(!m_audioTaskStack) {log_e("oom, audio task stack"); return;}
     m_f_audioTaskIsRunning = true;
 
-
     m_audioTaskHandle = xTaskCreateStaticPinnedToCore(
         &Audio::taskWrapper,    /* Function to implement the task */
         "PeriodicTask",         /* Name of the task */
-        AUDIO_STACK_SIZE,       /* Stack size in words */
+        cfg.stackBytes,         /* Stack size in bytes */
         this,                   /* Task input parameter */
-        2,                      /* Priority of the task */
-        xAudioStack,            /* Task stack */
-        &xAudioTaskBuffer,      /* Memory for the task's control block */
-        m_audioTaskCoreId       /* Core where the task should run */
+        cfg.priority,           /* Priority of the task */
+        m_audioTaskStack,       /* Task stack */
+        &m_audioTaskBuffer,     /* Memory for the task's control block */
+        cfg.core < 0 ? tskNO_AFFINITY : cfg.core /* Core where the task should run */
     );
 }
 
+void Audio::bindDecoders() {
+    MP3Decoder_SetContext(m_mp3Ctx);
+    AACDecoder_SetContext(m_aacCtx);
+    FLACDecoder_SetContext(m_flacCtx);
+    OPUSDecoder_SetContext(m_opusCtx);
+    VORBISDecoder_SetContext(m_vorbisCtx);
+}
+
+void Audio::notifyAudioTask() {
+    if(m_audioTaskHandle) xTaskNotifyGive(m_audioTaskHandle);
+}
+
+void Audio::inBuffWritten(size_t bytes) {
+    InBuff.bytesWritten(bytes);
+    TurnMetrics::ringFill(InBuff.bufferFilled(), InBuff.getBufsize());
+    notifyAudioTask(); // new input, decode can go on
+}
+
+bool IRAM_ATTR Audio::i2sOnSent(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx) {
+    Audio* self = static_cast<Audio*>(user_ctx);
+    // only while playing, with auto_clear the DMA keeps sending silence when idle
+    if(!self->m_audioTaskHandle || !(self->m_f_running || self->m_f_mixing)) return false;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(self->m_audioTaskHandle, &woken);
+    return woken == pdTRUE;
+}
+
 void Audio::stopAudioTask()  {
     if (!m_f_audioTaskIsRunning) {
         log_i("audio task is not running.");
@@ -6202,21 +6839,35 @@ void Audio::taskWrapper(void *param) {
 }
 
 void Audio::audioTask() {
+    bindDecoders(); // the task decodes this instance's streams only
     while (m_f_audioTaskIsRunning) {
-        vTaskDelay(1 / portTICK_PERIOD_MS);  // periodically every x ms
+        // sleep until I2S has sent a DMA buffer or new input arrived, the timeout is only a fallback
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(m_audioTaskIdleMs));
         performAudioTask();
     }
     vTaskDelete(nullptr);  // Delete this task
 }
 
 void Audio::performAudioTask() {
-    if(!m_f_running) return;
-    if(!m_f_stream) return;
-    if(m_codec == CODEC_NONE) return; // wait for codec is  set
-    if(m_codec == CODEC_OGG)  return; // wait for FLAC, VORBIS or OPUS
+    if(!m_f_running || !m_f_stream || m_codec == CODEC_NONE || m_codec == CODEC_OGG) { // wait for stream, codec, or FLAC, VORBIS, OPUS
+        if(m_mixer.active()) { // mixer sources play without a stream
+            xSemaphoreTake(mutex_audioTask, 0.3 * configTICK_RATE_HZ);
+            pumpMixer();
+            xSemaphoreGive(mutex_audioTask);
+        }
+        if(m_pcmQueue.data()) feedI2S(); // plays the tail of the previous item during a gapless hand-over
+        return;
+    }
     xSemaphoreTake(mutex_audioTask, 0.3 * configTICK_RATE_HZ);
-    while(m_validSamples) {vTaskDelay(20 / portTICK_PERIOD_MS); playChunk();} // I2S buffer full
-    playAudioData();
+    // decode ahead into the PCM queue until it is full or the input runs dry, then sleep
+    for(uint8_t i = 0; i < m_decodeAhead; i++) {
+        uint32_t filled = InBuff.bufferFilled();
+        playAudioData();                                       // plays a pending frame first, else decodes one
+        if(!m_f_running || m_validSamples) break;              // stopped, or queue full: the frame waits for on_sent
+        if(InBuff.bufferFilled() == filled) break;             // nothing decoded, wait for more input
+    }
+    if(m_mixer.active()) pumpMixer();                          // stream starved, mixer sources go on over silence
+    if(m_pcmQueue.data()) feedI2S();
     xSemaphoreGive(mutex_audioTask);
 }
 uint32_t Audio::getHighWatermark(){
@@ -24,6 +24,13 @@
 #include <FS.h>
 #include <FFat.h>
 #include <atomic>
+#include "AudioMemory.h"
+#include "AudioRingBuffer.h"
+#include "TurnMetrics.h"
+#include "AudioResampler.h"
+#include "AudioMixer.h"
+#include "HLSPrefetcher.h"
+#include "AudioTasks.h"
 #include <codecvt>
 #include <locale>
 
@@ -32,6 +39,13 @@
 #include <NetworkClientSecure.h>
 #endif
 
+#if defined(__has_include)
+  #if __has_include(<dsps_biquad.h>)
+    #include <dsps_biquad.h>
+    #define AUDIO_USE_ESP_DSP  // tone filters run on the ESP-DSP biquad kernels (PIE SIMD on ESP32-S3)
+  #endif
+#endif
+
 #if ESP_IDF_VERSION_MAJOR == 5
 #include <driver/i2s_std.h>
 #else
@@ -133,9 +147,12 @@ protected:
 };
 //----------------------------------------------------------------------------------------------------------------------
 
-static const size_t AUDIO_STACK_SIZE = 3300;
-static StaticTask_t __attribute__((unused)) xAudioTaskBuffer;
-static StackType_t  __attribute__((unused)) xAudioStack[AUDIO_STACK_SIZE];
+// decoder contexts, see e.g. MP3Decoder_CreateContext()
+struct MP3Decoder_t;
+struct AACDecoder_t;
+struct FLACDecoder_t;
+struct OPUSDecoder_t;
+struct VORBISDecoder_t;
 
 class Audio : private AudioBuffer{
 
@@ -149,6 +166,23 @@ public:
     bool connecttohost(const char* host, const char* user = "", const char* pwd = "");
     bool connecttospeech(const char* speech, const char* lang);
     bool connecttoFS(fs::FS &fs, const char* path, int32_t m_fileStartPos = -1);
+    bool connecttobuffer(const char* format);    // push input: "mp3", "aac", "wav", "flac", "opus" or "ogg", data follows via writeBuffer()
+    size_t writeBuffer(const uint8_t* data, size_t len); // copy pushed data into the input buffer, returns the bytes that fitted
+    void finishBuffer();                         // no more pushed data, the rest is decoded and audio_eof_stream("buffer") follows
+    bool queueHost(const char* host);            // play after the current item, gapless if the formats match
+    bool queueFS(fs::FS &fs, const char* path);  // as queueHost(), for a local file
+    void clearQueue();
+    uint8_t getQueueSize() {return m_playQueue.size();}
+    void setGaplessLeadTime(uint8_t sec);        // open the next queued item this many seconds before the end
+    void setHLSPrefetch(uint8_t depth);          // m3u8: segments downloaded ahead into PSRAM in the background, 0: one after the other (default 2)
+    // mixer: PCM sources (TTS, earcons) played over the stream or alone, id 0 ... AudioMixer::MAX_SOURCES - 1
+    bool openMixSource(uint8_t id, uint32_t sampleRate, uint8_t channels, bool ducker = false, size_t bufferBytes = 16384);
+    void closeMixSource(uint8_t id);             // queued audio of the source is dropped
+    size_t writeMixSource(uint8_t id, const int16_t* pcm, size_t frames); // one producer task per source, returns the frames that fitted
+    size_t mixSourceWritable(uint8_t id);        // free frames in the ring of the source
+    void flushMixSource(uint8_t id);             // drop queued audio, e.g. on barge-in
+    void setMixGain(uint8_t id, float gain);     // linear, ramped
+    void setDucking(float attenuationDb, uint16_t attackMs = 30, uint16_t releaseMs = 400); // while a ducker plays, the stream and the other sources duck
     bool setFileLoop(bool input);//TEST loop
     void setConnectionTimeout(uint16_t timeout_ms, uint16_t timeout_ms_ssl);
     bool setAudioPlayPosition(uint16_t sec);
@@ -183,6 +217,9 @@ public:
     uint32_t inBufferFree();   // returns the number of free bytes in the inputbuffer
     uint32_t inBufferSize();   // returns the size of the inputbuffer in bytes
     void setTone(int8_t gainLowPass, int8_t gainBandPass, int8_t gainHighPass);
+    // Keep I2S at a fixed rate and resample every stream to it (0: follow the source, default)
+    // takes effect with the next stream
+    void setOutputSampleRate(uint32_t rate, ResampleQuality quality = RESAMPLE_MEDIUM);
     void setI2SCommFMT_LSB(bool commFMT);
     int getCodec() {return m_codec;}
     const char *getCodecname() {return codecname[m_codec];}
@@ -207,8 +244,16 @@ private:
   void            processLocalFile();
   void            processWebStream();
   void            processWebFile();
+  void            processBufferStream();
   void            processWebStreamTS();
   void            processWebStreamHLS();
+  void            processHLSPrefetch();
+  bool            startHLSPrefetch(const char* segment);
+  void            feedHLSPrefetcher();
+  bool            openHLSSegment();
+  void            readPlayListText(char* text);
+  inline uint32_t hlsAvailable() { return m_f_hlsPrefetch ? m_hlsSize - m_hlsPos : _client->available(); }
+  int             hlsRead(uint8_t* buf, size_t len);
   void            playAudioData();
   bool            readPlayListData();
   const char*     parsePlaylist_M3U();
@@ -236,20 +281,28 @@ private:
   bool            setBitsPerSample(int bits);
   bool            setChannels(int channels);
   void            reconfigI2S();
+  size_t          resampleChunk(const int16_t* in, size_t frames);
+  static size_t   resampledToI2S(const int16_t* frames, size_t count, void* user);
   bool            setBitrate(int br);
   void            playChunk();
-  void            computeVUlevel(int16_t sample[2]);
+  void            computeVUlevel(const int16_t* buff, int frames, uint8_t channels);
   void            computeLimit();
-  void            Gain(int16_t* sample);
+  void            Gain(int16_t* buff, int frames, uint8_t channels);
   void            showstreamtitle(const char* ml);
   bool            parseContentType(char* ct);
   bool            parseHttpResponseHeader();
   bool            initializeDecoder(uint8_t codec);
+  char*           buildGetRequest(const char* h_host, int16_t pos_slash, uint16_t hostwoext_begin, const char* authorization);
+  struct          _queuePrefetch; // queuePrefetch_t
+  void            prefetchQueued();
+  void            collectPrefetch();
+  void            abandonPrefetch();
+  static void     prefetchTask(void* param);
+  static void     freePrefetch(_queuePrefetch* job);
+  bool            playNextQueued();
   esp_err_t       I2Sstart(uint8_t i2s_num);
   esp_err_t       I2Sstop(uint8_t i2s_num);
-  void            IIR_filterChain0(int16_t iir_in[2], bool clear = false);
-  void            IIR_filterChain1(int16_t iir_in[2], bool clear = false);
-  void            IIR_filterChain2(int16_t iir_in[2], bool clear = false);
+  void            IIR_filterBlock(int16_t* buff, int frames, uint8_t channels);
   inline uint32_t streamavail() { return _client ? _client->available() : 0; }
   void            IIR_calculateCoefficients(int8_t G1, int8_t G2, int8_t G3);
   bool            ts_parsePacket(uint8_t* packet, uint8_t* packetStart, uint8_t* packetLength);
@@ -265,6 +318,15 @@ private:
   static void     taskWrapper(void *param);
   void            audioTask();
   void            performAudioTask();
+  void            notifyAudioTask();
+  void            inBuffWritten(size_t bytes); // InBuff.bytesWritten() + wake the audio task
+  void            feedI2S();
+  size_t          mixToQueue(const int16_t* in, size_t frames);
+  void            pumpMixer();
+  void            bindDecoders(); // make this instance's decoder contexts current for the calling task
+#if ESP_IDF_VERSION_MAJOR == 5
+  static bool IRAM_ATTR i2sOnSent(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx);
+#endif
 
   //+++ W E B S T R E A M  -  H E L P   F U N C T I O N S +++
   uint16_t readMetadata(uint16_t b, bool first = false);
@@ -532,7 +594,7 @@ private:
     enum : int { EXTERNAL_I2S = 0, INTERNAL_DAC = 1, INTERNAL_PDM = 2 };
     enum : int { FORMAT_NONE = 0, FORMAT_M3U = 1, FORMAT_PLS = 2, FORMAT_ASX = 3, FORMAT_M3U8 = 4};
     enum : int { AUDIO_NONE, HTTP_RESPONSE_HEADER, AUDIO_DATA, AUDIO_LOCALFILE,
-                 AUDIO_PLAYLISTINIT, AUDIO_PLAYLISTHEADER,  AUDIO_PLAYLISTDATA};
+                 AUDIO_PLAYLISTINIT, AUDIO_PLAYLISTHEADER,  AUDIO_PLAYLISTDATA, AUDIO_BUFFER};
     enum : int { FLAC_BEGIN = 0, FLAC_MAGIC = 1, FLAC_MBH =2, FLAC_SINFO = 3, FLAC_PADDING = 4, FLAC_APP = 5,
                  FLAC_SEEK = 6, FLAC_VORBIS = 7, FLAC_CUESHEET = 8, FLAC_PICTURE = 9, FLAC_OKAY = 100};
     enum : int { M4A_BEGIN = 0, M4A_FTYP = 1, M4A_CHK = 2, M4A_MOOV = 3, M4A_FREE = 4, M4A_TRAK = 5, M4A_MDAT = 6,
@@ -551,6 +613,37 @@ private:
         float b2;
     } filter_t;
 
+    typedef struct _filter_q{       // filter_t in Q28 fixed point, level correction folded in
+        int32_t a0;
+        int32_t a1;
+        int32_t a2;
+        int32_t b1;
+        int32_t b2;
+    } filter_q_t;
+
+    typedef struct _iir_state{      // per stage and channel
+        int32_t x1, x2;             // previous inputs
+        int32_t y1, y2;             // previous outputs, Q8
+        float   w[2];               // ESP-DSP delay line (direct form II)
+    } iir_state_t;
+
+    typedef struct _queueItem{
+        char*   url;     // web address, or path if fs is set
+        fs::FS* fs;
+    } queueItem_t;
+
+    enum : uint8_t {PREFETCH_CONNECTING, PREFETCH_CONNECTED, PREFETCH_FAILED};
+    typedef struct _queuePrefetch{ // connect of the next queued host, done by prefetchTask()
+        WiFiClient* client;
+        char*       host;
+        uint16_t    port;
+        char*       request;       // GET request sent once connected
+        char*       url;           // queued item the connection belongs to
+        uint32_t    connectTime;   // ms
+        uint8_t     state;         // PREFETCH_..., set by the task
+        bool        abandoned;     // owner gave up on it, the task cleans up
+    } queuePrefetch_t;
+
     typedef struct _pis_array{
         int number;
         int pids[4];
@@ -561,14 +654,44 @@ private:
     WiFiClient            client;
     WiFiClientSecure      clientsecure;
     WiFiClient*           _client = nullptr;
+    WiFiClient*           m_prefetchClient = nullptr;   // next queued host, connected and request sent
+    WiFiClient*           m_queueClient = nullptr;      // prefetched connection in use as _client
 #else
     NetworkClient	      client;
     NetworkClientSecure	  clientsecure;
     NetworkClient*       _client = nullptr;
+    NetworkClient*        m_prefetchClient = nullptr;   // next queued host, connected and request sent
+    NetworkClient*        m_queueClient = nullptr;      // prefetched connection in use as _client
 #endif
+    std::vector<queueItem_t> m_playQueue;               // items to play after the current one
+    File                  m_prefetchFile;               // next queued file, already opened
+    char*                 m_prefetchURL = NULL;         // item m_prefetchClient / m_prefetchFile belongs to
+    queuePrefetch_t*      m_prefetchJob = NULL;         // connect in progress on the network core
+    HLSPrefetcher         m_hls;                        // m3u8 segments and playlist refreshes, fetched in the background
+    const uint8_t*        m_hlsData = NULL;             // prefetched segment being read, NULL: waiting for the next one
+    uint32_t              m_hlsSize = 0;
+    uint32_t              m_hlsPos = 0;                 // bytes of m_hlsData passed to the decoder side
     SemaphoreHandle_t     mutex_playAudioData;
     SemaphoreHandle_t     mutex_audioTask;
     TaskHandle_t          m_audioTaskHandle = nullptr;
+    StaticTask_t          m_audioTaskBuffer;            // control block of the audio task
+    StackType_t*          m_audioTaskStack = nullptr;   // stack of the audio task, one per instance
+    uint32_t              m_audioTaskStackSize = 0;     // bytes of m_audioTaskStack
+    static uint8_t        m_instances;                  // the first instance uses the default decoder contexts
+    MP3Decoder_t*         m_mp3Ctx    = nullptr;        // decoder contexts of this instance, nullptr: default context
+    AACDecoder_t*         m_aacCtx    = nullptr;
+    FLACDecoder_t*        m_flacCtx   = nullptr;
+    OPUSDecoder_t*        m_opusCtx   = nullptr;
+    VORBISDecoder_t*      m_vorbisCtx = nullptr;
+    AudioRingBuffer       m_pcmQueue;                   // decoded, processed PCM waiting for I2S (decode ahead)
+    static const size_t   m_pcmQueueSize = 16384;       // bytes, ~90ms at 44.1kHz stereo
+    AudioResampler        m_resampler;                  // source rate -> m_outputRate, between DSP and PCM queue
+    uint32_t              m_outputRate = 0;             // fixed I2S rate, 0: I2S follows the source
+    ResampleQuality       m_resampleQuality = RESAMPLE_MEDIUM;
+    AudioMixer            m_mixer;                      // sources added to the PCM going into the queue
+    volatile bool         m_f_mixing = false;           // sources are queued, on_sent wakes the task even without a stream
+    static const uint8_t  m_decodeAhead  = 8;           // max frames decoded per wakeup
+    static const uint8_t  m_audioTaskIdleMs = 20;       // wakeup without notification (fallback)
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wmissing-field-initializers"
@@ -607,6 +730,12 @@ private:
     char*           m_speechtxt = NULL;             // stores tts text
     const uint16_t  m_plsBuffEntryLen = 256;        // length of each entry in playlistBuff
     filter_t        m_filter[3];                    // digital filters
+    filter_q_t      m_filterQ[3];                   // fixed point coefficients used by IIR_filterBlock()
+    bool            m_filterActive[3] = {false, false, false}; // false: 0 dB, stage is bypassed
+#ifdef AUDIO_USE_ESP_DSP
+    float           m_filterCoef[3][5];             // b0 b1 b2 a1 a2 for dsps_biquad_f32
+    float           m_dspScratch[128];              // one channel block in float
+#endif
     int             m_LFcount = 0;                  // Detection of end of header
     uint32_t        m_sampleRate=16000;
     uint32_t        m_bitRate=0;                    // current bitrate given fom decoder
@@ -633,7 +762,7 @@ private:
     uint8_t         m_ID3Size = 0;                  // lengt of ID3frame - ID3header
     uint8_t         m_vuLeft = 0;                   // average value of samples, left channel
     uint8_t         m_vuRight = 0;                  // average value of samples, right channel
-    uint8_t         m_audioTaskCoreId = 0;
+    int8_t          m_audioTaskCoreId = AUDIO_CORE_DEFAULT; // set by setAudioTaskCore(), else AudioTasks decides
     uint8_t         m_M4A_objectType = 0;           // set in read_M4A_Header
     uint8_t         m_M4A_chConfig = 0;             // set in read_M4A_Header
     uint16_t        m_M4A_sampleRate = 0;           // set in read_M4A_Header
@@ -694,15 +823,24 @@ private:
     bool            m_f_stream = false;             // stream ready for output?
     bool            m_f_decode_ready = false;       // if true data for decode are ready
     bool            m_f_eof = false;                // end of file
+    bool            m_f_bufferEnded = false;        // finishBuffer() called, no more pushed data follows
     bool            m_f_lockInBuffer = false;       // lock inBuffer for manipulation
     bool            m_f_audioTaskIsDecoding = false;
     bool            m_f_acceptRanges = false;
     uint8_t         m_f_channelEnabled = 3;         //
+    uint8_t         m_gaplessLeadTime = 5;          // seconds before the end the next queued item is opened
+    bool            m_f_prefetched = false;         // next queued item is opened (or was tried)
+    bool            m_f_gapless = false;            // hand-over to the next queued item, keep PCM queue and I2S running
+    bool            m_f_reconfigPending = false;    // new item's I2S rate is set once the PCM queue has played out
+    uint8_t         m_hlsDepth = 2;                 // m3u8 segments prefetched ahead, 0: serial fetching
+    bool            m_f_hlsPrefetch = false;        // m3u8 data comes from m_hls instead of _client
+    uint32_t        m_hlsWaitSince = 0;             // millis() since the next segment is awaited, 0: not waiting
+    uint32_t        m_i2sSampleRate = 0;            // rate the I2S clock is set to, 0: not yet configured
     uint32_t        m_audioFileDuration = 0;
     float           m_audioCurrentTime = 0;
     uint32_t        m_audioDataStart = 0;           // in bytes
     size_t          m_audioDataSize = 0;            //
-    float           m_filterBuff[3][2][2][2];       // IIR filters memory for Audio DSP
+    iir_state_t     m_filterBuff[3][2];             // IIR filters memory for Audio DSP [stage][channel]
     float           m_corr = 1.0;					// correction factor for level adjustment
     size_t          m_i2s_bytesWritten = 0;         // set in i2s_write() but not used
     size_t          m_fileSize = 0;                 // size of the file
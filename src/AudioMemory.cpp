@@ -0,0 +1,310 @@
+/**
+ * @file AudioMemory.cpp
+ * @brief Shared arena allocator Implementation
+ */
+
+#include "AudioMemory.h"
+
+/*
+ * Each arena is a list of physically adjacent blocks. A block starts with an
+ * 8-byte header holding its own size (bit 0 = in use) and the size of the
+ * previous block, so release() can merge with both neighbours in O(1).
+ * Allocation is first-fit.
+ *
+ * The first-fit walk grows with the number of blocks, so the arenas are
+ * guarded by a mutex rather than a critical section, which would keep
+ * interrupts off for the whole walk. The mutex exists once begin() reserved
+ * an arena; before that every call goes straight to the heap.
+ */
+
+struct AudioMemBlock {
+  uint32_t size;      // Block size including header, bit 0 set when in use
+  uint32_t prevSize;  // Size of the previous block, 0 for the first block
+};
+
+struct AudioMemArena {
+  uint8_t* base = nullptr;
+  size_t capacity = 0;
+  AudioMemStats stats;
+};
+
+static const size_t BLOCK_HEADER = sizeof(AudioMemBlock);
+static const size_t MIN_BLOCK = BLOCK_HEADER + 8;
+
+static AudioMemArena s_psram;
+static AudioMemArena s_internal;
+static bool s_strict = false;
+static uint32_t s_heapFallbacks = 0;
+static StaticSemaphore_t s_lockBuffer;
+static SemaphoreHandle_t s_lock = nullptr;
+
+static inline AudioMemBlock* blockAt(uint8_t* p) { return (AudioMemBlock*)p; }
+static inline size_t blockSize(const AudioMemBlock* b) { return b->size & ~(uint32_t)1; }
+static inline bool blockUsed(const AudioMemBlock* b) { return b->size & 1; }
+
+static inline void lock() {
+  if (s_lock) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+  }
+}
+
+static inline void unlock() {
+  if (s_lock) {
+    xSemaphoreGive(s_lock);
+  }
+}
+
+static bool arenaInit(AudioMemArena& arena, size_t bytes, uint32_t caps) {
+  bytes &= ~(size_t)7;
+  if (bytes < MIN_BLOCK) {
+    return false;
+  }
+  arena.base = (uint8_t*)heap_caps_malloc(bytes, caps);
+  if (!arena.base) {
+    return false;
+  }
+  arena.capacity = bytes;
+  arena.stats = AudioMemStats();
+  arena.stats.capacity = bytes;
+
+  AudioMemBlock* first = blockAt(arena.base);
+  first->size = bytes;
+  first->prevSize = 0;
+  return true;
+}
+
+static bool arenaOwns(const AudioMemArena& arena, const void* ptr) {
+  return arena.base && (const uint8_t*)ptr >= arena.base && (const uint8_t*)ptr < arena.base + arena.capacity;
+}
+
+static void* arenaAlloc(AudioMemArena& arena, size_t size) {
+  if (!arena.base || size == 0 || size > arena.capacity) {
+    return nullptr;
+  }
+  size_t need = ((size + 7) & ~(size_t)7) + BLOCK_HEADER;
+  uint8_t* end = arena.base + arena.capacity;
+
+  for (uint8_t* p = arena.base; p < end; p += blockSize(blockAt(p))) {
+    AudioMemBlock* b = blockAt(p);
+    size_t bsize = blockSize(b);
+    if (blockUsed(b) || bsize < need) {
+      continue;
+    }
+
+    // Split off the tail if it can hold another block
+    if (bsize - need >= MIN_BLOCK) {
+      AudioMemBlock* tail = blockAt(p + need);
+      tail->size = bsize - need;
+      tail->prevSize = need;
+      uint8_t* next = p + bsize;
+      if (next < end) {
+        blockAt(next)->prevSize = tail->size;
+      }
+      bsize = need;
+    }
+    b->size = bsize | 1;
+
+    arena.stats.used += bsize;
+    arena.stats.allocations++;
+    if (arena.stats.used > arena.stats.peak) {
+      arena.stats.peak = arena.stats.used;
+    }
+    return p + BLOCK_HEADER;
+  }
+  return nullptr;
+}
+
+static void arenaFree(AudioMemArena& arena, void* ptr) {
+  uint8_t* p = (uint8_t*)ptr - BLOCK_HEADER;
+  uint8_t* end = arena.base + arena.capacity;
+  AudioMemBlock* b = blockAt(p);
+  if (!blockUsed(b)) {
+    return;  // Double release
+  }
+
+  size_t bsize = blockSize(b);
+  arena.stats.used -= bsize;
+  arena.stats.allocations--;
+
+  // Merge with next block
+  uint8_t* next = p + bsize;
+  if (next < end && !blockUsed(blockAt(next))) {
+    bsize += blockSize(blockAt(next));
+  }
+
+  // Merge with previous block
+  if (b->prevSize != 0) {
+    uint8_t* prev = p - b->prevSize;
+    if (!blockUsed(blockAt(prev))) {
+      bsize += blockSize(blockAt(prev));
+      p = prev;
+      b = blockAt(p);
+    }
+  }
+
+  b->size = bsize;
+  next = p + bsize;
+  if (next < end) {
+    blockAt(next)->prevSize = bsize;
+  }
+}
+
+static size_t arenaLargestFree(const AudioMemArena& arena) {
+  size_t largest = 0;
+  uint8_t* end = arena.base + arena.capacity;
+  for (uint8_t* p = arena.base; arena.base && p < end; p += blockSize(blockAt(p))) {
+    AudioMemBlock* b = blockAt(p);
+    if (!blockUsed(b) && blockSize(b) > largest) {
+      largest = blockSize(b);
+    }
+  }
+  return largest > BLOCK_HEADER ? largest - BLOCK_HEADER : 0;
+}
+
+bool AudioMemory::begin(size_t psramBytes, size_t internalBytes) {
+  bool ok = true;
+  if (!s_lock) {
+    s_lock = xSemaphoreCreateMutexStatic(&s_lockBuffer);
+  }
+
+  if (psramBytes > 0 && !s_psram.base) {
+    if (psramFound() && arenaInit(s_psram, psramBytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)) {
+      Serial.printf("AudioMemory: PSRAM arena %d bytes\n", (int)s_psram.capacity);
+    } else {
+      Serial.println("AudioMemory: PSRAM arena not available");
+      ok = false;
+    }
+  }
+
+  if (internalBytes > 0 && !s_internal.base) {
+    if (arenaInit(s_internal, internalBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)) {
+      Serial.printf("AudioMemory: internal arena %d bytes\n", (int)s_internal.capacity);
+    } else {
+      Serial.println("AudioMemory: internal arena allocation failed");
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+void AudioMemory::setStrict(bool strict) {
+  s_strict = strict;
+}
+
+void* AudioMemory::alloc(size_t size, AudioMemRegion region) {
+  if (size == 0) {
+    return nullptr;
+  }
+
+  AudioMemArena* first = (region == AUDIO_MEM_PSRAM_PREFERRED) ? &s_psram : &s_internal;
+  AudioMemArena* second = (region == AUDIO_MEM_PSRAM_PREFERRED) ? &s_internal
+                        : (region == AUDIO_MEM_INTERNAL_PREFERRED) ? &s_psram : nullptr;
+
+  void* ptr = nullptr;
+  bool haveArena = first->base || (second && second->base);
+
+  lock();
+  ptr = arenaAlloc(*first, size);
+  if (!ptr && first->base) first->stats.failures++;
+  if (!ptr && second) {
+    ptr = arenaAlloc(*second, size);
+    if (!ptr && second->base) second->stats.failures++;
+  }
+  unlock();
+
+  if (ptr || (haveArena && s_strict)) {
+    return ptr;
+  }
+
+  // No arena for this region or budget exceeded: use the system heap
+  switch (region) {
+    case AUDIO_MEM_PSRAM_PREFERRED:
+      ptr = heap_caps_malloc_prefer(size, 2, MALLOC_CAP_DEFAULT | MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL);
+      break;
+    case AUDIO_MEM_INTERNAL_PREFERRED:
+      ptr = heap_caps_malloc_prefer(size, 2, MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL, MALLOC_CAP_DEFAULT | MALLOC_CAP_SPIRAM);
+      break;
+    default:
+      ptr = heap_caps_malloc(size, MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL);
+      break;
+  }
+  if (ptr && haveArena) {
+    s_heapFallbacks++;
+  }
+  return ptr;
+}
+
+void* AudioMemory::calloc(size_t count, size_t size, AudioMemRegion region) {
+  if (size != 0 && count > SIZE_MAX / size) {
+    return nullptr;
+  }
+  void* ptr = alloc(count * size, region);
+  if (ptr) {
+    memset(ptr, 0, count * size);
+  }
+  return ptr;
+}
+
+void AudioMemory::release(void* ptr) {
+  if (!ptr) {
+    return;
+  }
+
+  AudioMemArena* arena = arenaOwns(s_psram, ptr) ? &s_psram
+                       : arenaOwns(s_internal, ptr) ? &s_internal : nullptr;
+  if (!arena) {
+    free(ptr);
+    return;
+  }
+
+  lock();
+  arenaFree(*arena, ptr);
+  unlock();
+}
+
+bool AudioMemory::owns(const void* ptr) {
+  return arenaOwns(s_psram, ptr) || arenaOwns(s_internal, ptr);
+}
+
+bool AudioMemory::inPSRAM(const void* ptr) {
+  return arenaOwns(s_psram, ptr);
+}
+
+size_t AudioMemory::sizeOf(const void* ptr) {
+  if (!ptr) {
+    return 0;
+  }
+  if (!owns(ptr)) {
+    return heap_caps_get_allocated_size((void*)ptr);
+  }
+  return blockSize(blockAt((uint8_t*)ptr - BLOCK_HEADER)) - BLOCK_HEADER;
+}
+
+AudioMemStats AudioMemory::getStats(bool psram) {
+  AudioMemArena& arena = psram ? s_psram : s_internal;
+  lock();
+  AudioMemStats stats = arena.stats;
+  stats.largestFree = arenaLargestFree(arena);
+  unlock();
+  return stats;
+}
+
+uint32_t AudioMemory::heapFallbacks() {
+  return s_heapFallbacks;
+}
+
+void AudioMemory::printReport() {
+  const bool regions[2] = {true, false};
+  Serial.println("=== AudioMemory ===");
+  for (int i = 0; i < 2; i++) {
+    AudioMemStats s = getStats(regions[i]);
+    if (s.capacity == 0) {
+      Serial.printf("%-8s: not reserved\n", regions[i] ? "PSRAM" : "Internal");
+      continue;
+    }
+    Serial.printf("%-8s: used %d / %d bytes, peak %d (%.1f%%), largest free %d, %u blocks, %u failed\n",
+                  regions[i] ? "PSRAM" : "Internal", (int)s.used, (int)s.capacity, (int)s.peak,
+                  100.0f * s.peak / s.capacity, (int)s.largestFree, (unsigned)s.allocations, (unsigned)s.failures);
+  }
+  Serial.printf("Heap fallbacks: %u\n", (unsigned)s_heapFallbacks);
+}
@@ -0,0 +1,119 @@
+/**
+ * @file AudioMemory.h
+ * @brief Shared PSRAM / internal RAM arena allocator for audio clients and decoders
+ */
+
+#ifndef AudioMemory_h
+#define AudioMemory_h
+
+#include <Arduino.h>
+
+/**
+ * @brief Placement preference for an allocation
+ */
+enum AudioMemRegion {
+  AUDIO_MEM_PSRAM_PREFERRED,     // PSRAM arena first, then internal arena (large buffers)
+  AUDIO_MEM_INTERNAL_PREFERRED,  // Internal arena first, then PSRAM arena (hot decoder state)
+  AUDIO_MEM_INTERNAL             // Internal RAM only (DMA / latency critical)
+};
+
+/**
+ * @brief Usage of one arena
+ */
+struct AudioMemStats {
+  size_t capacity = 0;       // Arena size in bytes (0 if not reserved)
+  size_t used = 0;           // Bytes in use, including block headers
+  size_t peak = 0;           // High-water mark of used
+  size_t largestFree = 0;    // Largest allocation that currently fits
+  uint32_t allocations = 0;  // Live allocations
+  uint32_t failures = 0;     // Requests that did not fit
+};
+
+/**
+ * @class AudioMemory
+ * @brief Budgeted arena allocator shared by all library classes
+ *
+ * begin() reserves one PSRAM and one internal RAM arena up front; every client
+ * buffer and decoder state block is then carved from them, so memory use is
+ * fixed by the budgets and fragmentation of the system heap no longer depends
+ * on which services run together. Without begin(), or when an arena is full
+ * and strict mode is off, allocations fall back to the system heap.
+ *
+ * release() accepts any pointer; memory not owned by an arena is passed to free().
+ * The arenas are guarded by a mutex, so no method may be called from an ISR.
+ */
+class AudioMemory {
+public:
+  /**
+   * @brief Reserve arenas
+   * @param psramBytes PSRAM budget (ignored if no PSRAM is present)
+   * @param internalBytes Internal RAM budget
+   * @return Whether all requested arenas were reserved
+   * @note Call once in setup() before creating clients or starting playback
+   */
+  static bool begin(size_t psramBytes, size_t internalBytes = 0);
+
+  /**
+   * @brief Fail allocations that do not fit the budgets instead of using the heap
+   * @param strict true for deterministic memory use (default false)
+   */
+  static void setStrict(bool strict);
+
+  /**
+   * @brief Allocate memory
+   * @param size Bytes
+   * @param region Placement preference
+   * @return Pointer (8-byte aligned) or nullptr
+   */
+  static void* alloc(size_t size, AudioMemRegion region = AUDIO_MEM_PSRAM_PREFERRED);
+
+  /**
+   * @brief Allocate zeroed memory
+   * @param count Number of elements
+   * @param size Element size
+   * @param region Placement preference
+   * @return Pointer or nullptr
+   */
+  static void* calloc(size_t count, size_t size, AudioMemRegion region = AUDIO_MEM_PSRAM_PREFERRED);
+
+  /**
+   * @brief Release memory returned by alloc()/calloc() or any heap pointer
+   * @param ptr Pointer (nullptr is ignored)
+   */
+  static void release(void* ptr);
+
+  /**
+   * @brief Check if a pointer lies in one of the arenas
+   */
+  static bool owns(const void* ptr);
+
+  /**
+   * @brief Check if a pointer lies in the PSRAM arena
+   */
+  static bool inPSRAM(const void* ptr);
+
+  /**
+   * @brief Get the usable size of an allocation
+   * @param ptr Pointer returned by alloc()/calloc() or the heap (nullptr gives 0)
+   * @return Block size, at least the requested size
+   */
+  static size_t sizeOf(const void* ptr);
+
+  /**
+   * @brief Get arena statistics
+   * @param psram true for the PSRAM arena, false for the internal arena
+   */
+  static AudioMemStats getStats(bool psram);
+
+  /**
+   * @brief Get number of allocations served by the system heap (budget exceeded or no arena)
+   */
+  static uint32_t heapFallbacks();
+
+  /**
+   * @brief Print arena usage and high-water marks to Serial
+   */
+  static void printReport();
+};
+
+#endif
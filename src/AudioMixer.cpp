@@ -0,0 +1,267 @@
+/**
+ * @file AudioMixer.cpp
+ * @brief Multi-source PCM mixer Implementation
+ */
+
+#include "AudioMixer.h"
+
+// Highest gain, keeps a full scale sample times gain (Q14) inside 32 bits
+static const float MAX_GAIN = 4.0f;
+
+// Add a block to the accumulator with the gain ramping linearly from g0 to g1
+static void accumulate(int32_t* acc, const int16_t* in, size_t frames, uint8_t channels, float g0, float g1) {
+  if (g0 == 1.0f && g1 == 1.0f) {
+    if (channels == 1) {
+      for (size_t i = 0; i < frames; i++) {
+        acc[2 * i] += in[i];
+        acc[2 * i + 1] += in[i];
+      }
+    } else {
+      for (size_t i = 0; i < frames * 2; i++) {
+        acc[i] += in[i];
+      }
+    }
+    return;
+  }
+
+  int32_t g = (int32_t)(g0 * 16384.0f) << 8;  // Q22, the extra bits carry the ramp fraction
+  int32_t dg = (int32_t)((g1 - g0) * 16384.0f * 256.0f / (float)frames);
+  for (size_t i = 0; i < frames; i++) {
+    int32_t q = g >> 8;
+    if (channels == 1) {
+      int32_t v = ((int32_t)in[i] * q) >> 14;
+      acc[2 * i] += v;
+      acc[2 * i + 1] += v;
+    } else {
+      acc[2 * i] += ((int32_t)in[2 * i] * q) >> 14;
+      acc[2 * i + 1] += ((int32_t)in[2 * i + 1] * q) >> 14;
+    }
+    g += dg;
+  }
+}
+
+AudioMixer::AudioMixer()
+  : _openCount(0)
+  , _outRate(0)
+  , _duckGain(0.25f)
+  , _attackMs(30)
+  , _releaseMs(400)
+  , _duckHold(0)
+{
+  _main.gain = 1.0f;
+  _main.current = 1.0f;
+  for (uint8_t i = 0; i < MAX_SOURCES; i++) {
+    _src[i].sampleRate = 0;
+    _src[i].channels = 1;
+    _src[i].quality = RESAMPLE_MEDIUM;
+    _src[i].open = false;
+    _src[i].ducker = false;
+    _src[i].gain = 1.0f;
+    _src[i].current = 1.0f;
+  }
+}
+
+AudioMixer::~AudioMixer() {
+  for (uint8_t i = 0; i < MAX_SOURCES; i++) {
+    closeSource(i);
+  }
+}
+
+void AudioMixer::setOutputRate(uint32_t rate) {
+  if (rate == 0 || rate == _outRate) {
+    return;
+  }
+  _outRate = rate;
+  for (uint8_t i = 0; i < MAX_SOURCES; i++) {
+    Source& s = _src[i];
+    if (s.open && !s.resampler.begin(s.sampleRate, rate, s.channels, s.quality)) {
+      Serial.printf("[Mixer] Source %u cannot follow %u Hz, closed\n", (unsigned)i, (unsigned)rate);
+      closeSource(i);
+    }
+  }
+}
+
+bool AudioMixer::openSource(uint8_t id, uint32_t sampleRate, uint8_t channels, size_t bufferBytes,
+                            ResampleQuality quality) {
+  if (id >= MAX_SOURCES || sampleRate == 0 || (channels != 1 && channels != 2)) {
+    return false;
+  }
+  if (_outRate == 0) {
+    Serial.println("[Mixer] Output rate not set");
+    return false;
+  }
+  closeSource(id);
+
+  Source& s = _src[id];
+  if (!s.ring.begin(bufferBytes, AUDIO_MEM_PSRAM_PREFERRED) ||
+      !s.resampler.begin(sampleRate, _outRate, channels, quality)) {
+    Serial.println("[Mixer] Allocation failed");
+    s.ring.end();
+    s.resampler.end();
+    return false;
+  }
+  s.resampler.reset();
+  s.sampleRate = sampleRate;
+  s.channels = channels;
+  s.quality = quality;
+  s.current = s.gain;
+  s.open = true;
+  _openCount++;
+  return true;
+}
+
+void AudioMixer::closeSource(uint8_t id) {
+  if (id >= MAX_SOURCES || !_src[id].open) {
+    return;
+  }
+  Source& s = _src[id];
+  s.open = false;
+  s.ring.end();
+  s.resampler.end();
+  _openCount--;
+}
+
+bool AudioMixer::pending() {
+  for (uint8_t i = 0; i < MAX_SOURCES; i++) {
+    if (_src[i].open && _src[i].ring.available() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t AudioMixer::write(uint8_t id, const int16_t* pcm, size_t frames) {
+  if (!isOpen(id) || pcm == nullptr) {
+    return 0;
+  }
+  const size_t frameBytes = _src[id].channels * sizeof(int16_t);
+  size_t bytes = frames * frameBytes;
+  size_t room = _src[id].ring.space() / frameBytes * frameBytes;  // Whole frames only
+  if (bytes > room) {
+    bytes = room;
+  }
+  return _src[id].ring.write(pcm, bytes) / frameBytes;
+}
+
+size_t AudioMixer::writable(uint8_t id) const {
+  if (!isOpen(id)) {
+    return 0;
+  }
+  return _src[id].ring.space() / (_src[id].channels * sizeof(int16_t));
+}
+
+void AudioMixer::flush(uint8_t id) {
+  if (isOpen(id)) {
+    _src[id].ring.discard();
+  }
+}
+
+void AudioMixer::setGain(uint8_t id, float gain) {
+  if (id < MAX_SOURCES) {
+    _src[id].gain = gain < 0.0f ? 0.0f : (gain > MAX_GAIN ? MAX_GAIN : gain);
+  }
+}
+
+void AudioMixer::setMainGain(float gain) {
+  _main.gain = gain < 0.0f ? 0.0f : (gain > MAX_GAIN ? MAX_GAIN : gain);
+}
+
+void AudioMixer::setDucker(uint8_t id, bool ducker) {
+  if (id < MAX_SOURCES) {
+    _src[id].ducker = ducker;
+  }
+}
+
+void AudioMixer::setDucking(float attenuationDb, uint16_t attackMs, uint16_t releaseMs) {
+  _duckGain = attenuationDb > 0.0f ? powf(10.0f, -attenuationDb / 20.0f) : 1.0f;
+  _attackMs = attackMs;
+  _releaseMs = releaseMs;
+}
+
+float AudioMixer::ramp(float current, float target, size_t frames) const {
+  // Full scale in attackMs going down, in releaseMs going up
+  uint16_t ms = target < current ? _attackMs : _releaseMs;
+  float step = ms > 0 ? (float)frames * 1000.0f / ((float)ms * _outRate) : MAX_GAIN;
+  if (target < current) {
+    return current - step < target ? target : current - step;
+  }
+  return current + step > target ? target : current + step;
+}
+
+size_t AudioMixer::pull(Source& s, size_t frames) {
+  const size_t frameBytes = s.channels * sizeof(int16_t);
+  size_t got = 0;
+  while (got < frames) {
+    size_t len = 0;
+    const uint8_t* p = s.ring.readSpan(len);
+    size_t inFrames = len / frameBytes;
+    // Runs without input too: the resampler still holds the end of the last burst
+    size_t n = s.resampler.process(inFrames > 0 ? (const int16_t*)p : _scratch, inFrames,
+                                   _scratch + got * s.channels, frames - got);
+    s.ring.commitRead(inFrames * frameBytes);
+    got += n;
+    if (n == 0 && inFrames == 0) {
+      break;
+    }
+  }
+  return got;
+}
+
+void AudioMixer::mix(int16_t* out, size_t frames) {
+  if (_openCount == 0 || _outRate == 0 || out == nullptr) {
+    return;
+  }
+  const uint32_t hold = _outRate * DUCK_HOLD_MS / 1000;
+
+  while (frames > 0) {
+    size_t block = frames < BLOCK_FRAMES ? frames : BLOCK_FRAMES;
+
+    bool queued = false;
+    bool duckerPlaying = false;
+    for (uint8_t i = 0; i < MAX_SOURCES; i++) {
+      if (_src[i].open && _src[i].ring.available() > 0) {
+        queued = true;
+        duckerPlaying |= _src[i].ducker;
+      }
+    }
+    _duckHold = duckerPlaying ? hold : (_duckHold > block ? _duckHold - block : 0);
+    const float duck = _duckHold > 0 ? _duckGain : 1.0f;
+
+    float mainTarget = _main.gain * duck;
+    float mainNext = ramp(_main.current, mainTarget, block);
+    if (queued || _main.current != 1.0f || mainNext != 1.0f) {
+      for (size_t i = 0; i < block * 2; i++) {
+        _acc[i] = 0;
+      }
+      accumulate(_acc, out, block, 2, _main.current, mainNext);
+
+      for (uint8_t i = 0; i < MAX_SOURCES; i++) {
+        Source& s = _src[i];
+        if (!s.open) {
+          continue;
+        }
+        float target = s.gain * (s.ducker ? 1.0f : duck);
+        float next = ramp(s.current, target, block);
+        size_t got = pull(s, block);
+        if (got > 0) {
+          accumulate(_acc, _scratch, got, s.channels, s.current, next);
+        }
+        s.current = next;
+      }
+
+      // Saturate once, after all sources are summed
+      for (size_t i = 0; i < block * 2; i++) {
+        int32_t v = _acc[i];
+        out[i] = (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+      }
+    } else {
+      for (uint8_t i = 0; i < MAX_SOURCES; i++) {
+        _src[i].current = ramp(_src[i].current, _src[i].gain * (_src[i].ducker ? 1.0f : duck), block);
+      }
+    }
+    _main.current = mainNext;
+
+    out += block * 2;
+    frames -= block;
+  }
+}
@@ -0,0 +1,181 @@
+/**
+ * @file AudioMixer.h
+ * @brief Multi-source PCM mixer - per-source rings, resampling, gain and ducking
+ */
+
+#ifndef AudioMixer_h
+#define AudioMixer_h
+
+#include <Arduino.h>
+#include "AudioMemory.h"
+#include "AudioRingBuffer.h"
+#include "AudioResampler.h"
+
+/**
+ * @class AudioMixer
+ * @brief Adds auxiliary PCM sources (TTS, earcons) to a stereo output stream
+ *
+ * Every source has its own lock-free ring, written by one producer task at the
+ * source's rate and channel count, and its own resampler to the output rate.
+ * mix() runs on the output side: it scales the main stream already in the
+ * block (e.g. decoded music), adds each source at its gain and saturates
+ * once at the end, so no source clips another.
+ *
+ * A source marked as ducker (setDucker()) pulls every other source and the
+ * main stream down while it plays, with attack, hold and release ramps, so a
+ * prompt can be spoken over music without stopping the stream.
+ *
+ * write() is safe from the producer task. openSource(), closeSource() and
+ * setOutputRate() must not overlap mix(); the owner serializes them.
+ */
+class AudioMixer {
+public:
+  static const uint8_t MAX_SOURCES = 3;   ///< Auxiliary sources besides the main stream
+
+  /**
+   * @brief Constructor
+   */
+  AudioMixer();
+
+  /**
+   * @brief Destructor
+   */
+  ~AudioMixer();
+
+  /**
+   * @brief Set the output sample rate, resamplers of open sources follow
+   * @param rate Output rate in Hz
+   */
+  void setOutputRate(uint32_t rate);
+
+  /**
+   * @brief Get the output sample rate (0 before setOutputRate())
+   */
+  uint32_t outputRate() const { return _outRate; }
+
+  /**
+   * @brief Allocate a source
+   * @param id Source index, 0 to MAX_SOURCES - 1
+   * @param sampleRate Rate of the data passed to write()
+   * @param channels 1 (mono, played on both sides) or 2 (interleaved)
+   * @param bufferBytes Ring size, rounded down to a power of two
+   * @param quality Resampling quality
+   * @return Whether the parameters are valid and memory could be allocated
+   */
+  bool openSource(uint8_t id, uint32_t sampleRate, uint8_t channels, size_t bufferBytes = 16384,
+                  ResampleQuality quality = RESAMPLE_MEDIUM);
+
+  /**
+   * @brief Release a source, queued audio is dropped
+   */
+  void closeSource(uint8_t id);
+
+  /**
+   * @brief Check if a source is open
+   */
+  bool isOpen(uint8_t id) const { return id < MAX_SOURCES && _src[id].open; }
+
+  /**
+   * @brief Check if any source is open (mix() does nothing otherwise)
+   */
+  bool active() const { return _openCount > 0; }
+
+  /**
+   * @brief Check if any source has queued audio (consumer side)
+   */
+  bool pending();
+
+  /**
+   * @brief Queue audio (producer side)
+   * @param id Source index
+   * @param pcm Interleaved 16-bit PCM at the source rate
+   * @param frames Number of frames
+   * @return Frames accepted, less than frames when the ring is full
+   */
+  size_t write(uint8_t id, const int16_t* pcm, size_t frames);
+
+  /**
+   * @brief Get free ring space of a source in frames (producer side)
+   */
+  size_t writable(uint8_t id) const;
+
+  /**
+   * @brief Drop queued audio of a source (either side)
+   */
+  void flush(uint8_t id);
+
+  /**
+   * @brief Set source gain
+   * @param id Source index
+   * @param gain Linear gain, 1.0 = unchanged (ramped, no zipper noise)
+   */
+  void setGain(uint8_t id, float gain);
+
+  /**
+   * @brief Set the main stream gain (ramped like the sources)
+   */
+  void setMainGain(float gain);
+
+  /**
+   * @brief Make a source duck the others while it plays
+   */
+  void setDucker(uint8_t id, bool ducker);
+
+  /**
+   * @brief Configure ducking
+   * @param attenuationDb Reduction of the other sources while a ducker plays (default 12dB)
+   * @param attackMs Ramp down time (default 30ms)
+   * @param releaseMs Ramp up time after the hold (default 400ms)
+   */
+  void setDucking(float attenuationDb, uint16_t attackMs = 30, uint16_t releaseMs = 400);
+
+  /**
+   * @brief Check if a ducker is currently playing (or within its hold time)
+   */
+  bool ducking() const { return _duckHold > 0; }
+
+  /**
+   * @brief Mix all sources into a block in place (output side)
+   * @param out Interleaved stereo output frames, holding the main stream (or silence)
+   * @param frames Number of frames
+   */
+  void mix(int16_t* out, size_t frames);
+
+private:
+  static const size_t BLOCK_FRAMES = 128;     ///< Frames mixed per pass
+  static const uint32_t DUCK_HOLD_MS = 250;    ///< Ducking outlasts short gaps between sentences
+
+  struct Source {
+    AudioRingBuffer ring;       ///< Queued PCM at the source rate
+    AudioResampler resampler;   ///< Source rate -> output rate
+    uint32_t sampleRate;        ///< Rate of the queued PCM
+    uint8_t channels;           ///< Channels of the queued PCM
+    ResampleQuality quality;    ///< Resampling quality
+    bool open;                  ///< Allocated and mixed
+    bool ducker;                ///< Ducks the others while playing
+    float gain;                 ///< User gain
+    float current;              ///< Ramped gain in use
+  };
+
+  struct Channel {
+    float gain;                 ///< User gain
+    float current;              ///< Ramped gain in use
+  };
+
+  Source _src[MAX_SOURCES];     ///< Auxiliary sources
+  Channel _main;                ///< Main stream already in the output block
+  uint8_t _openCount;           ///< Open sources
+  uint32_t _outRate;            ///< Output sample rate
+  float _duckGain;              ///< Gain of the others while a ducker plays
+  uint16_t _attackMs;           ///< Ramp down time
+  uint16_t _releaseMs;          ///< Ramp up time
+  uint32_t _duckHold;           ///< Output frames left before the release starts
+
+  int16_t _scratch[BLOCK_FRAMES * 2];   ///< One source's resampled block
+  int32_t _acc[BLOCK_FRAMES * 2];       ///< Sum of all sources
+
+  size_t pull(Source& s, size_t frames);
+  float ramp(float current, float target, size_t frames) const;
+};
+
+#endif
@@ -0,0 +1,255 @@
+/**
+ * @file AudioResampler.cpp
+ * @brief Fixed-point polyphase resampler Implementation
+ */
+
+#include "AudioResampler.h"
+
+// Taps, Kaiser beta and passband edge (fraction of the lower Nyquist) per quality
+static const uint16_t QUALITY_TAPS[] = {8, 16, 32};
+static const float QUALITY_BETA[] = {5.0f, 7.0f, 8.5f};
+static const float QUALITY_ROLLOFF[] = {0.80f, 0.90f, 0.94f};
+
+// Zeroth order modified Bessel function of the first kind (Kaiser window)
+static float besselI0(float x) {
+  float sum = 1.0f;
+  float term = 1.0f;
+  float q = x * x / 4.0f;
+  for (int k = 1; k < 24 && term > sum * 1e-8f; k++) {
+    term *= q / ((float)k * k);
+    sum += term;
+  }
+  return sum;
+}
+
+AudioResampler::AudioResampler()
+  : _inRate(0)
+  , _outRate(0)
+  , _channels(1)
+  , _quality(RESAMPLE_MEDIUM)
+  , _taps(0)
+  , _coeffs(nullptr)
+  , _buf(nullptr)
+  , _capacity(0)
+  , _fill(0)
+  , _pos(0)
+  , _step(0)
+{
+}
+
+AudioResampler::~AudioResampler() {
+  end();
+}
+
+bool AudioResampler::begin(uint32_t inRate, uint32_t outRate, uint8_t channels, ResampleQuality quality) {
+  if (inRate == 0 || outRate == 0 || (channels != 1 && channels != 2)) {
+    return false;
+  }
+  if (inRate == _inRate && outRate == _outRate && channels == _channels && quality == _quality) {
+    return true;
+  }
+
+  end();
+  _inRate = inRate;
+  _outRate = outRate;
+  _channels = channels;
+  _quality = quality;
+  _step = ((uint64_t)inRate << 32) / outRate;
+
+  if (inRate == outRate) {
+    return true;  // Copy only, no filter
+  }
+
+  // Decimation: the cutoff drops with the output rate, keep the transition band as wide in output terms
+  uint32_t widen = (inRate + outRate - 1) / outRate;
+  uint32_t taps = (uint32_t)QUALITY_TAPS[quality] * widen;
+  _taps = (uint16_t)(taps > MAX_TAPS ? MAX_TAPS : taps);
+
+  _capacity = _taps + BLOCK_FRAMES;
+  _coeffs = (int16_t*)AudioMemory::alloc((((size_t)1 << PHASE_BITS) + 1) * _taps * sizeof(int16_t), AUDIO_MEM_INTERNAL_PREFERRED);
+  _buf = (int16_t*)AudioMemory::alloc(_capacity * _channels * sizeof(int16_t), AUDIO_MEM_INTERNAL_PREFERRED);
+  if (_coeffs == nullptr || _buf == nullptr || !buildFilter()) {
+    Serial.println("[Resampler] Allocation failed");
+    end();
+    return false;
+  }
+
+  reset();
+  return true;
+}
+
+void AudioResampler::end() {
+  AudioMemory::release(_coeffs);
+  AudioMemory::release(_buf);
+  _coeffs = nullptr;
+  _buf = nullptr;
+  _inRate = 0;
+  _outRate = 0;
+  _taps = 0;
+  _capacity = 0;
+  _fill = 0;
+  _pos = 0;
+}
+
+void AudioResampler::reset() {
+  if (_buf == nullptr) {
+    return;
+  }
+  // Half a window of silence centres the first output on the first input frame
+  _fill = _taps / 2 - 1;
+  memset(_buf, 0, _fill * _channels * sizeof(int16_t));
+  _pos = 0;
+}
+
+bool AudioResampler::buildFilter() {
+  const uint32_t phases = 1UL << PHASE_BITS;
+  const float lower = (float)(_inRate < _outRate ? _inRate : _outRate);
+  const float cutoff = 0.5f * QUALITY_ROLLOFF[_quality] * lower / _inRate;  // Cycles per input sample
+  const float beta = QUALITY_BETA[_quality];
+  const float i0Beta = besselI0(beta);
+  const float half = _taps / 2.0f;
+
+  float* h = (float*)AudioMemory::alloc(_taps * sizeof(float), AUDIO_MEM_PSRAM_PREFERRED);
+  if (h == nullptr) {
+    return false;
+  }
+
+  // One extra phase (a full input frame later) so rounding and interpolation need no wrap
+  for (uint32_t p = 0; p <= phases; p++) {
+    // Output time of this phase, in taps from the window start
+    float centre = half - 1.0f + (float)p / phases;
+    float sum = 0.0f;
+    for (uint16_t k = 0; k < _taps; k++) {
+      float t = k - centre;
+      float x = 2.0f * cutoff * t;
+      float sinc = fabsf(x) < 1e-6f ? 1.0f : sinf(PI * x) / (PI * x);
+      float u = t / half;
+      float w = u * u < 1.0f ? besselI0(beta * sqrtf(1.0f - u * u)) / i0Beta : 0.0f;
+      h[k] = sinc * w;
+      sum += h[k];
+    }
+
+    // Unity gain per phase, rounding error goes to the largest tap
+    int16_t* c = _coeffs + p * _taps;
+    int32_t total = 0;
+    uint16_t peak = 0;
+    for (uint16_t k = 0; k < _taps; k++) {
+      c[k] = (int16_t)lrintf(h[k] / sum * 32768.0f);
+      total += c[k];
+      if (c[k] > c[peak]) {
+        peak = k;
+      }
+    }
+    c[peak] = (int16_t)(c[peak] + 32768 - total);
+  }
+
+  AudioMemory::release(h);
+  return true;
+}
+
+// Phases sum to 1.0 and taps stay far below 2.0 in magnitude, so 32 bits cannot overflow
+int32_t AudioResampler::dot(const int16_t* c, const int16_t* x) const {
+  int32_t acc = 0;
+  if (_channels == 1) {
+    for (uint16_t k = 0; k < _taps; k++) {
+      acc += (int32_t)c[k] * x[k];
+    }
+  } else {
+    for (uint16_t k = 0; k < _taps; k++) {
+      acc += (int32_t)c[k] * x[2 * k];
+    }
+  }
+  return acc;
+}
+
+size_t AudioResampler::process(const int16_t* in, size_t& inFrames, int16_t* out, size_t outFrames) {
+  if (_inRate == 0 || in == nullptr || out == nullptr) {
+    inFrames = 0;
+    return 0;
+  }
+
+  if (_inRate == _outRate) {
+    size_t n = inFrames < outFrames ? inFrames : outFrames;
+    memcpy(out, in, n * _channels * sizeof(int16_t));
+    inFrames = n;
+    return n;
+  }
+
+  size_t used = 0;
+  size_t produced = 0;
+  while (true) {
+    // Top up the window buffer
+    size_t take = _capacity - _fill;
+    if (take > inFrames - used) {
+      take = inFrames - used;
+    }
+    memcpy(_buf + _fill * _channels, in + used * _channels, take * _channels * sizeof(int16_t));
+    _fill += take;
+    used += take;
+
+    while (produced < outFrames) {
+      uint32_t start = (uint32_t)(_pos >> 32);
+      if (start + _taps > _fill) {
+        break;
+      }
+      const int16_t* x = _buf + start * _channels;
+      uint32_t frac = (uint32_t)_pos;
+      if (_quality == RESAMPLE_HIGH) {
+        // Blend the two nearest phases, the timing error of 256 phases alone limits the SNR to ~60dB
+        const int16_t* c = _coeffs + (frac >> (32 - PHASE_BITS)) * _taps;
+        int32_t blend = (int32_t)((frac >> (32 - PHASE_BITS - 15)) & 0x7FFF);
+        for (uint8_t ch = 0; ch < _channels; ch++) {
+          int32_t a = dot(c, x + ch);
+          int32_t b = dot(c + _taps, x + ch);
+          out[produced * _channels + ch] = saturate((((int64_t)a << 15) + (int64_t)(b - a) * blend + (1LL << 29)) >> 30);
+        }
+      } else {
+        // Nearest phase, may round up to the extra one
+        const int16_t* c = _coeffs + (size_t)(((uint64_t)frac + (1UL << (31 - PHASE_BITS))) >> (32 - PHASE_BITS)) * _taps;
+        for (uint8_t ch = 0; ch < _channels; ch++) {
+          out[produced * _channels + ch] = saturate(((int64_t)dot(c, x + ch) + (1 << 14)) >> 15);
+        }
+      }
+      produced++;
+      _pos += _step;
+    }
+
+    // Drop frames no window needs any more
+    size_t drop = (size_t)(_pos >> 32);
+    if (drop > _fill) {
+      drop = _fill;
+    }
+    memmove(_buf, _buf + drop * _channels, (_fill - drop) * _channels * sizeof(int16_t));
+    _fill -= drop;
+    _pos -= (uint64_t)drop << 32;
+
+    if (produced == outFrames || used == inFrames) {
+      break;
+    }
+  }
+
+  inFrames = used;
+  return produced;
+}
+
+size_t AudioResampler::processTo(const int16_t* in, size_t inFrames, Sink sink, void* userData) {
+  int16_t out[SINK_BLOCK];
+  const size_t block = SINK_BLOCK / _channels;
+  const size_t maxTake = inputFramesFor(block);
+  size_t used = 0;
+  while (used < inFrames) {
+    size_t take = inFrames - used;
+    if (take > maxTake) {
+      take = maxTake;
+    }
+    size_t n = process(in + used * _channels, take, out, block);
+    used += take;
+    if (n > 0 && sink(out, n, userData) < n) {
+      break;  // Sink stalled, the rest of this block is lost
+    }
+    if (n == 0 && take == 0) {
+      break;
+    }
+  }
+  return used;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file AudioResampler.h
+ * @brief Fixed-point polyphase resampler - windowed-sinc sample rate conversion for 16-bit PCM
+ */
+
+#ifndef AudioResampler_h
+#define AudioResampler_h
+
+#include <Arduino.h>
+#include "AudioMemory.h"
+
+/**
+ * @brief Resampling quality, trades stopband attenuation against taps per output sample
+ */
+enum ResampleQuality {
+  RESAMPLE_FAST,    // 8 taps, ~50dB stopband: speech, earcons
+  RESAMPLE_MEDIUM,  // 16 taps, ~70dB stopband: default
+  RESAMPLE_HIGH     // 32 taps, ~85dB stopband: music
+};
+
+/**
+ * @class AudioResampler
+ * @brief Converts interleaved 16-bit PCM between arbitrary sample rates
+ *
+ * Kaiser-windowed sinc with a table of 256 phases in Q15, picked by the top
+ * bits of a 32.32 input position (RESAMPLE_HIGH interpolates between the two
+ * nearest phases). Every phase is normalized to unity gain, the
+ * cutoff follows the lower of both rates and the filter is widened when
+ * decimating so it still removes aliases. Equal rates are a plain copy.
+ *
+ * Input is buffered internally, so process() can be fed blocks of any size
+ * and asked for as much output as the sink takes. The output lags the input
+ * by half the filter length (< 1ms).
+ */
+class AudioResampler {
+public:
+  /**
+   * @brief Output callback for processTo()
+   * @param frames Interleaved output frames
+   * @param count Number of frames
+   * @param userData Pointer passed to processTo()
+   * @return Frames accepted, fewer stops processTo()
+   */
+  typedef size_t (*Sink)(const int16_t* frames, size_t count, void* userData);
+
+  /**
+   * @brief Constructor
+   */
+  AudioResampler();
+
+  /**
+   * @brief Destructor
+   */
+  ~AudioResampler();
+
+  /**
+   * @brief Configure conversion and build the filter
+   * @param inRate Input sample rate in Hz
+   * @param outRate Output sample rate in Hz
+   * @param channels 1 (mono) or 2 (interleaved stereo)
+   * @param quality Filter length
+   * @return Whether the parameters are valid and memory could be allocated
+   * @note Does nothing if called again with the same parameters
+   */
+  bool begin(uint32_t inRate, uint32_t outRate, uint8_t channels, ResampleQuality quality = RESAMPLE_MEDIUM);
+
+  /**
+   * @brief Release filter and buffer memory
+   */
+  void end();
+
+  /**
+   * @brief Drop buffered input, e.g. between streams
+   */
+  void reset();
+
+  /**
+   * @brief Convert a block
+   * @param in Interleaved input frames
+   * @param inFrames In: frames available, out: frames consumed
+   * @param out Interleaved output frames
+   * @param outFrames Output capacity in frames
+   * @return Frames written to out
+   */
+  size_t process(const int16_t* in, size_t& inFrames, int16_t* out, size_t outFrames);
+
+  /**
+   * @brief Convert a block and hand the output to a sink in pieces
+   * @param in Interleaved input frames
+   * @param inFrames Frames available
+   * @param sink Called with each piece of output
+   * @param userData Passed to sink
+   * @return Frames consumed; output the sink did not accept is lost
+   * @note Input is taken in inputFramesFor() steps, so nothing is left in the buffer after the last block
+   */
+  size_t processTo(const int16_t* in, size_t inFrames, Sink sink, void* userData);
+
+  /**
+   * @brief Get the input that yields no more than outFrames of output (at least 1)
+   */
+  size_t inputFramesFor(size_t outFrames) const {
+    size_t n = _outRate ? (size_t)((uint64_t)outFrames * _inRate / _outRate) : 0;
+    return n > 0 ? n : 1;
+  }
+
+  /**
+   * @brief Get the largest output for a given input
+   */
+  size_t maxOutputFrames(size_t inFrames) const {
+    return (size_t)(((uint64_t)inFrames * _outRate + _inRate - 1) / _inRate) + 1;
+  }
+
+  /**
+   * @brief Check if begin() succeeded
+   */
+  bool ready() const { return _inRate != 0; }
+
+  /**
+   * @brief Check if the rates differ (otherwise process() copies)
+   */
+  bool converting() const { return _inRate != _outRate; }
+
+  /**
+   * @brief Get input sample rate (0 before begin())
+   */
+  uint32_t inRate() const { return _inRate; }
+
+  /**
+   * @brief Get output sample rate
+   */
+  uint32_t outRate() const { return _outRate; }
+
+  /**
+   * @brief Get number of interleaved channels
+   */
+  uint8_t channels() const { return _channels; }
+
+private:
+  static const uint8_t PHASE_BITS = 8;       ///< 256 filter phases
+  static const size_t BLOCK_FRAMES = 256;    ///< Input frames buffered beyond one filter length
+  static const uint16_t MAX_TAPS = 128;      ///< Longest filter (decimation widens it)
+  static const size_t SINK_BLOCK = 256;      ///< Samples per processTo() sink call (stack)
+
+  uint32_t _inRate;           ///< Input sample rate, 0 before begin()
+  uint32_t _outRate;          ///< Output sample rate
+  uint8_t _channels;          ///< Interleaved channels
+  ResampleQuality _quality;   ///< Quality of the current filter
+  uint16_t _taps;             ///< Filter length in input frames
+  int16_t* _coeffs;           ///< (1 << PHASE_BITS) + 1 phases of _taps Q15 coefficients
+  int16_t* _buf;              ///< Buffered input (_capacity frames)
+  size_t _capacity;           ///< Buffer size in frames
+  size_t _fill;               ///< Frames in _buf
+  uint64_t _pos;              ///< Position of the next filter window in _buf (32.32 frames)
+  uint64_t _step;             ///< Input frames per output frame (32.32)
+
+  bool buildFilter();
+  int32_t dot(const int16_t* c, const int16_t* x) const;  ///< Q15 filter output of one channel
+  static int16_t saturate(int64_t v) { return (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v)); }
+};
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * @file AudioRingBuffer.cpp
+ * @brief Lock-free SPSC ring Implementation
+ */
+
+#include "AudioRingBuffer.h"
+
+AudioRingBuffer::AudioRingBuffer()
+  : _buffer(nullptr)
+  , _capacity(0)
+  , _mask(0)
+  , _head(0)
+  , _tail(0)
+  , _discardMark(0)
+  , _discardPending(false)
+{
+}
+
+AudioRingBuffer::~AudioRingBuffer() {
+  end();
+}
+
+bool AudioRingBuffer::begin(size_t capacity, AudioMemRegion region) {
+  end();
+  if (capacity == 0) {
+    return false;
+  }
+
+  // Round down to a power of two so free-running indices wrap correctly
+  size_t size = 1;
+  while (size <= capacity / 2) {
+    size <<= 1;
+  }
+
+  _buffer = (uint8_t*)AudioMemory::alloc(size, region);
+  if (_buffer == nullptr) {
+    return false;
+  }
+  _capacity = size;
+  _mask = size - 1;
+  reset();
+  return true;
+}
+
+void AudioRingBuffer::end() {
+  if (_buffer != nullptr) {
+    AudioMemory::release(_buffer);
+    _buffer = nullptr;
+  }
+  _capacity = 0;
+  _mask = 0;
+  reset();
+}
+
+void AudioRingBuffer::reset() {
+  _head.store(0, std::memory_order_relaxed);
+  _tail.store(0, std::memory_order_relaxed);
+  _discardPending.store(false, std::memory_order_release);
+}
+
+void AudioRingBuffer::discard() {
+  _discardMark.store(_head.load(std::memory_order_acquire), std::memory_order_relaxed);
+  _discardPending.store(true, std::memory_order_release);
+}
+
+void AudioRingBuffer::applyDiscard() {
+  if (!_discardPending.exchange(false, std::memory_order_acquire)) {
+    return;
+  }
+  size_t mark = _discardMark.load(std::memory_order_relaxed);
+  size_t tail = _tail.load(std::memory_order_relaxed);
+  // Never move backwards (mark may predate reads already done)
+  size_t ahead = mark - tail;
+  if (ahead > 0 && ahead <= _capacity) {
+    _tail.store(mark, std::memory_order_release);
+  }
+}
+
+size_t AudioRingBuffer::buffered() const {
+  size_t tail = _tail.load(std::memory_order_acquire);
+  return _head.load(std::memory_order_acquire) - tail;
+}
+
+size_t AudioRingBuffer::space() const {
+  size_t head = _head.load(std::memory_order_relaxed);
+  size_t tail = _tail.load(std::memory_order_acquire);
+  return _capacity - (head - tail);
+}
+
+uint8_t* AudioRingBuffer::writeSpan(size_t& len) {
+  size_t head = _head.load(std::memory_order_relaxed);
+  size_t index = head & _mask;
+  size_t room = space();
+  size_t contiguous = _capacity - index;
+  len = (room < contiguous) ? room : contiguous;
+  return _buffer + index;
+}
+
+void AudioRingBuffer::commitWrite(size_t len) {
+  // Release: data written before this store is visible to the consumer
+  _head.store(_head.load(std::memory_order_relaxed) + len, std::memory_order_release);
+}
+
+size_t AudioRingBuffer::write(const void* data, size_t len) {
+  const uint8_t* src = (const uint8_t*)data;
+  size_t total = 0;
+
+  // Copy in up to two parts across the wrap point
+  while (total < len) {
+    size_t span;
+    uint8_t* dst = writeSpan(span);
+    if (span == 0) {
+      break;
+    }
+    size_t n = (len - total < span) ? len - total : span;
+    memcpy(dst, src + total, n);
+    commitWrite(n);
+    total += n;
+  }
+  return total;
+}
+
+size_t AudioRingBuffer::available() {
+  applyDiscard();
+  size_t tail = _tail.load(std::memory_order_relaxed);
+  return _head.load(std::memory_order_acquire) - tail;
+}
+
+const uint8_t* AudioRingBuffer::readSpan(size_t& len) {
+  size_t avail = available();
+  size_t index = _tail.load(std::memory_order_relaxed) & _mask;
+  size_t contiguous = _capacity - index;
+  len = (avail < contiguous) ? avail : contiguous;
+  return _buffer + index;
+}
+
+void AudioRingBuffer::commitRead(size_t len) {
+  // Release: reads from the span complete before the producer may overwrite it
+  _tail.store(_tail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+}
+
+size_t AudioRingBuffer::read(void* out, size_t len) {
+  uint8_t* dst = (uint8_t*)out;
+  size_t total = 0;
+
+  while (total < len) {
+    size_t span;
+    const uint8_t* src = readSpan(span);
+    if (span == 0) {
+      break;
+    }
+    size_t n = (len - total < span) ? len - total : span;
+    memcpy(dst + total, src, n);
+    commitRead(n);
+    total += n;
+  }
+  return total;
+}
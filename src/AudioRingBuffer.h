@@ -0,0 +1,151 @@
+/**
+ * @file AudioRingBuffer.h
+ * @brief Lock-free single-producer / single-consumer byte ring for audio streams
+ */
+
+#ifndef AudioRingBuffer_h
+#define AudioRingBuffer_h
+
+#include <Arduino.h>
+#include <atomic>
+#include "AudioMemory.h"
+
+/**
+ * @class AudioRingBuffer
+ * @brief SPSC ring with atomic free-running indices
+ *
+ * One task writes (producer), one task reads (consumer). The write index is
+ * only stored by the producer and the read index only by the consumer, so
+ * neither side does a read-modify-write on shared state. Both indices run
+ * freely and wrap modulo the capacity, which is a power of two.
+ *
+ * Span APIs give direct access to the contiguous region at either index, so
+ * data can be decoded into or written to I2S from the ring without a copy:
+ * @code
+ * size_t len;
+ * const uint8_t* p = ring.readSpan(len);
+ * ring.commitRead(i2s.write(p, len));
+ * @endcode
+ */
+class AudioRingBuffer {
+public:
+  /**
+   * @brief Constructor
+   */
+  AudioRingBuffer();
+
+  /**
+   * @brief Destructor
+   */
+  ~AudioRingBuffer();
+
+  /**
+   * @brief Allocate ring storage
+   * @param capacity Size in bytes, rounded down to a power of two
+   * @param region Memory placement preference
+   * @return Whether allocation succeeded
+   */
+  bool begin(size_t capacity, AudioMemRegion region = AUDIO_MEM_PSRAM_PREFERRED);
+
+  /**
+   * @brief Release ring storage
+   */
+  void end();
+
+  /**
+   * @brief Empty the ring (only while neither side is running)
+   */
+  void reset();
+
+  /**
+   * @brief Drop all buffered data (safe from either side)
+   * @details The consumer moves its read index to the write index seen here on
+   *          its next available()/readSpan() call
+   */
+  void discard();
+
+  /**
+   * @brief Get number of buffered bytes as seen from any task
+   * @details Does not apply a pending discard(), use available() on the consumer side
+   */
+  size_t buffered() const;
+
+  // Producer side
+
+  /**
+   * @brief Get free space in bytes (producer)
+   */
+  size_t space() const;
+
+  /**
+   * @brief Copy data into the ring (producer)
+   * @param data Source bytes
+   * @param len Number of bytes
+   * @return Bytes written, less than len if the ring is full
+   */
+  size_t write(const void* data, size_t len);
+
+  /**
+   * @brief Get the contiguous free region at the write index (producer)
+   * @param len Set to the region length
+   * @return Pointer to the region
+   */
+  uint8_t* writeSpan(size_t& len);
+
+  /**
+   * @brief Publish bytes filled through writeSpan() (producer)
+   * @param len Number of bytes, at most the span length
+   */
+  void commitWrite(size_t len);
+
+  // Consumer side
+
+  /**
+   * @brief Get number of buffered bytes (consumer)
+   */
+  size_t available();
+
+  /**
+   * @brief Copy data out of the ring (consumer)
+   * @param out Destination buffer
+   * @param len Buffer size
+   * @return Bytes read
+   */
+  size_t read(void* out, size_t len);
+
+  /**
+   * @brief Get the contiguous buffered region at the read index (consumer)
+   * @param len Set to the region length
+   * @return Pointer to the region
+   */
+  const uint8_t* readSpan(size_t& len);
+
+  /**
+   * @brief Release bytes consumed through readSpan() (consumer)
+   * @param len Number of bytes, at most the span length
+   */
+  void commitRead(size_t len);
+
+  /**
+   * @brief Get ring storage (for linear use while no stream is running)
+   */
+  uint8_t* data() const { return _buffer; }
+
+  /**
+   * @brief Get capacity in bytes
+   */
+  size_t capacity() const { return _capacity; }
+
+private:
+  void applyDiscard();  ///< Consumer: honour a pending discard()
+
+  uint8_t* _buffer;                   ///< Ring storage
+  size_t _capacity;                   ///< Size in bytes (power of two)
+  size_t _mask;                       ///< capacity - 1
+  std::atomic<size_t> _head;          ///< Write index (stored by producer only)
+  std::atomic<size_t> _tail;          ///< Read index (stored by consumer only)
+  std::atomic<size_t> _discardMark;   ///< Write index at the time of discard()
+  std::atomic<bool> _discardPending;  ///< discard() not yet applied by the consumer
+};
+
+#endif
@@ -0,0 +1,242 @@
+/**
+ * @file AudioTasks.cpp
+ * @brief Task configuration Implementation
+ */
+
+#include "AudioTasks.h"
+#include "AudioMemory.h"
+
+/*
+ * Tasks with a PSRAM stack are created statically, with the stack and control
+ * block kept in s_ext. FreeRTOS frees nothing for them, so they are only
+ * deleted while suspended (never running on the other core) and their memory
+ * is released right after. exit() suspends such a task instead of deleting it,
+ * reap() finishes the job from the next caller. The handle of a static task is
+ * its control block, so the entry is complete before the task first runs.
+ */
+
+struct ExtStackTask {
+  TaskHandle_t task;    // nullptr when the entry is free
+  StackType_t* stack;   // PSRAM stack
+  StaticTask_t* tcb;    // Control block, internal RAM
+  bool exited;          // Suspended itself in exit(), waiting for reap()
+};
+
+static const uint8_t MAX_EXT_TASKS = 8;
+
+static ExtStackTask s_ext[MAX_EXT_TASKS];
+static AudioTaskConfig s_roles[AUDIO_TASK_ROLE_COUNT];
+static bool s_init = false;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char* const ROLE_NAMES[AUDIO_TASK_ROLE_COUNT] = {
+  "decode", "HLS prefetch", "playback", "capture", "reconnect"
+};
+
+int8_t AudioTasks::networkCore() {
+#if portNUM_PROCESSORS > 1 && defined(ARDUINO_RUNNING_CORE)
+  return ARDUINO_RUNNING_CORE == 0 ? 0 : 1;
+#elif portNUM_PROCESSORS > 1
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+int8_t AudioTasks::audioCore() {
+#if portNUM_PROCESSORS > 1
+  return networkCore() == 0 ? 1 : 0;
+#else
+  return 0;
+#endif
+}
+
+static void makeConfig(AudioTaskRole role, int8_t core, UBaseType_t priority, uint32_t stackBytes) {
+  s_roles[role].core = core;
+  s_roles[role].priority = priority;
+  s_roles[role].stackBytes = stackBytes;
+  s_roles[role].psramStack = false;
+}
+
+static void initDefaults() {
+  if (s_init) {
+    return;
+  }
+  s_init = true;
+  const int8_t net = AudioTasks::networkCore();
+  const int8_t audio = AudioTasks::audioCore();
+  // Decode and capture run above loop() so a busy sketch cannot starve the I2S side
+  makeConfig(AUDIO_TASK_DECODE, audio, 2, 3300);
+  makeConfig(AUDIO_TASK_HLS_PREFETCH, net, 1, 8192);
+  makeConfig(AUDIO_TASK_PLAYBACK, audio, 1, 4096);
+  makeConfig(AUDIO_TASK_CAPTURE, audio, 2, 4096);
+  makeConfig(AUDIO_TASK_RECONNECT, net, 1, 8192);  // TLS handshake needs the larger stack
+}
+
+// Delete PSRAM-stack tasks that ended themselves, called without s_lock held
+static void reap() {
+  for (uint8_t i = 0; i < MAX_EXT_TASKS; i++) {
+    portENTER_CRITICAL(&s_lock);
+    ExtStackTask e = s_ext[i];
+    if (e.task != nullptr && e.exited) {
+      s_ext[i].exited = false;  // Claimed, a concurrent reap() skips it
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (e.task == nullptr || !e.exited) {
+      continue;
+    }
+    if (eTaskGetState(e.task) != eSuspended) {
+      portENTER_CRITICAL(&s_lock);
+      s_ext[i].exited = true;   // Not parked yet, next time
+      portEXIT_CRITICAL(&s_lock);
+      continue;
+    }
+    vTaskDelete(e.task);
+    AudioMemory::release(e.stack);
+    AudioMemory::release(e.tcb);
+    portENTER_CRITICAL(&s_lock);
+    s_ext[i] = ExtStackTask();
+    portEXIT_CRITICAL(&s_lock);
+  }
+}
+
+AudioTaskConfig AudioTasks::get(AudioTaskRole role) {
+  initDefaults();
+  if (role >= AUDIO_TASK_ROLE_COUNT) {
+    return AudioTaskConfig();
+  }
+  return s_roles[role];
+}
+
+void AudioTasks::set(AudioTaskRole role, const AudioTaskConfig& config) {
+  initDefaults();
+  if (role >= AUDIO_TASK_ROLE_COUNT) {
+    return;
+  }
+  s_roles[role] = config;
+  if (s_roles[role].core >= portNUM_PROCESSORS) {
+    s_roles[role].core = AUDIO_CORE_ANY;
+  }
+}
+
+void AudioTasks::setCores(int8_t networkCore, int8_t audioCore) {
+  initDefaults();
+  if (networkCore >= portNUM_PROCESSORS) {
+    networkCore = AUDIO_CORE_ANY;
+  }
+  if (audioCore >= portNUM_PROCESSORS) {
+    audioCore = AUDIO_CORE_ANY;
+  }
+  s_roles[AUDIO_TASK_DECODE].core = audioCore;
+  s_roles[AUDIO_TASK_PLAYBACK].core = audioCore;
+  s_roles[AUDIO_TASK_CAPTURE].core = audioCore;
+  s_roles[AUDIO_TASK_HLS_PREFETCH].core = networkCore;
+  s_roles[AUDIO_TASK_RECONNECT].core = networkCore;
+}
+
+static TaskHandle_t createExt(const AudioTaskConfig& cfg, TaskFunction_t fn, const char* name, void* param,
+                              BaseType_t affinity) {
+  int8_t slot = -1;
+  portENTER_CRITICAL(&s_lock);
+  for (uint8_t i = 0; i < MAX_EXT_TASKS && slot < 0; i++) {
+    if (s_ext[i].task == nullptr && s_ext[i].stack == nullptr) {
+      slot = i;
+      s_ext[i].stack = (StackType_t*)1;  // Reserved until the task exists
+    }
+  }
+  portEXIT_CRITICAL(&s_lock);
+  if (slot < 0) {
+    return nullptr;
+  }
+
+  StackType_t* stack = (StackType_t*)AudioMemory::alloc(cfg.stackBytes, AUDIO_MEM_PSRAM_PREFERRED);
+  StaticTask_t* tcb = (StaticTask_t*)AudioMemory::alloc(sizeof(StaticTask_t), AUDIO_MEM_INTERNAL);
+  TaskHandle_t task = nullptr;
+  if (stack && tcb) {
+    portENTER_CRITICAL(&s_lock);
+    s_ext[slot].task = (TaskHandle_t)tcb;
+    s_ext[slot].stack = stack;
+    s_ext[slot].tcb = tcb;
+    s_ext[slot].exited = false;
+    portEXIT_CRITICAL(&s_lock);
+    task = xTaskCreateStaticPinnedToCore(fn, name, cfg.stackBytes, param, cfg.priority, stack, tcb, affinity);
+  }
+  if (task == nullptr) {
+    AudioMemory::release(stack);
+    AudioMemory::release(tcb);
+    portENTER_CRITICAL(&s_lock);
+    s_ext[slot] = ExtStackTask();
+    portEXIT_CRITICAL(&s_lock);
+  }
+  return task;
+}
+
+TaskHandle_t AudioTasks::create(AudioTaskRole role, TaskFunction_t fn, const char* name, void* param, int8_t core) {
+  reap();
+  AudioTaskConfig cfg = get(role);
+  if (core != AUDIO_CORE_DEFAULT) {
+    cfg.core = core < portNUM_PROCESSORS ? core : AUDIO_CORE_ANY;
+  }
+  const BaseType_t affinity = cfg.core < 0 ? tskNO_AFFINITY : cfg.core;
+
+  TaskHandle_t task = nullptr;
+  if (cfg.psramStack && psramFound()) {
+    task = createExt(cfg, fn, name, param, affinity);
+    if (task != nullptr) {
+      return task;
+    }
+    Serial.printf("[Tasks] No PSRAM stack for %s, using internal RAM\n", name);
+  }
+  if (xTaskCreatePinnedToCore(fn, name, cfg.stackBytes, param, cfg.priority, &task, affinity) != pdPASS) {
+    Serial.printf("[Tasks] %s (%s) creation failed\n", name, ROLE_NAMES[role]);
+    return nullptr;
+  }
+  return task;
+}
+
+void AudioTasks::remove(TaskHandle_t task) {
+  if (task == nullptr) {
+    return;
+  }
+  int8_t slot = -1;
+  portENTER_CRITICAL(&s_lock);
+  for (uint8_t i = 0; i < MAX_EXT_TASKS; i++) {
+    if (s_ext[i].task == task) {
+      slot = i;
+    }
+  }
+  portEXIT_CRITICAL(&s_lock);
+
+  if (slot < 0) {
+    vTaskDelete(task);
+  } else if (task == xTaskGetCurrentTaskHandle()) {
+    exit();
+  } else {
+    // Suspending a task running on the other core takes effect at its next switch
+    vTaskSuspend(task);
+    while (eTaskGetState(task) != eSuspended) {
+      vTaskDelay(1);
+    }
+    portENTER_CRITICAL(&s_lock);
+    s_ext[slot].exited = true;
+    portEXIT_CRITICAL(&s_lock);
+  }
+  reap();
+}
+
+void AudioTasks::exit() {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  bool ext = false;
+  portENTER_CRITICAL(&s_lock);
+  for (uint8_t i = 0; i < MAX_EXT_TASKS; i++) {
+    if (s_ext[i].task == self) {
+      s_ext[i].exited = true;
+      ext = true;
+    }
+  }
+  portEXIT_CRITICAL(&s_lock);
+  if (ext) {
+    vTaskSuspend(nullptr);  // Never resumed, reap() deletes it
+  }
+  vTaskDelete(nullptr);
+}
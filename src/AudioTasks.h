@@ -0,0 +1,116 @@
+/**
+ * @file AudioTasks.h
+ * @brief Core, priority and stack configuration for every task the library creates
+ */
+
+#ifndef AudioTasks_h
+#define AudioTasks_h
+
+#include <Arduino.h>
+
+/**
+ * @brief What a task does, each role has one configuration
+ */
+enum AudioTaskRole {
+  AUDIO_TASK_DECODE,        // Audio decode and I2S feed ("PeriodicTask")
+  AUDIO_TASK_HLS_PREFETCH,  // HLS segment and playlist downloads ("HLSPrefetch"), next queued host ("QueuePrefetch")
+  AUDIO_TASK_PLAYBACK,      // TTS / dialog playback from the jitter buffer ("AudioTask", "TTSPlayback")
+  AUDIO_TASK_CAPTURE,       // Microphone capture into the ASR ring ("ASRCapture")
+  AUDIO_TASK_RECONNECT,     // WebSocket reconnects with TLS handshake ("ASRReconnect", "TTSReconnect")
+  AUDIO_TASK_ROLE_COUNT
+};
+
+/**
+ * @brief Special core values
+ */
+enum : int8_t {
+  AUDIO_CORE_ANY = -1,      // No affinity, the scheduler picks a core
+  AUDIO_CORE_DEFAULT = -2   // Per-call override not set, use the role's core
+};
+
+/**
+ * @brief Scheduling of one role
+ */
+struct AudioTaskConfig {
+  int8_t core = AUDIO_CORE_ANY;  // Core the task is pinned to (0, 1 or AUDIO_CORE_ANY)
+  UBaseType_t priority = 1;      // FreeRTOS priority, loop() runs at 1
+  uint32_t stackBytes = 4096;    // Stack size
+  bool psramStack = false;       // Place the stack in PSRAM, see AudioTasks
+};
+
+/**
+ * @class AudioTasks
+ * @brief One table that decides where and how the library's tasks run
+ *
+ * Every client creates its tasks through create(), so the placement of network
+ * I/O and audio work is set in one place rather than per class. By default the
+ * network side (reconnects, HLS downloads) stays on the Arduino core next to
+ * loop(), which also runs the WebSocket and HTTP clients, and decode, playback
+ * and capture move to the other core, so a TLS handshake or a slow read never
+ * delays the I2S feed. On single-core chips everything runs on core 0.
+ *
+ * Settings apply to tasks created afterwards. Audio starts its decode task in
+ * its constructor; Audio::setAudioTaskCore() restarts it with the current table.
+ *
+ * A PSRAM stack saves internal RAM but the task must not run while the flash
+ * cache is disabled: no SPIFFS / FFat / NVS access and no flash writes from
+ * that task. Such stacks are released by remove(), or for tasks that end
+ * themselves with exit(), by the next create() or remove() call.
+ */
+class AudioTasks {
+public:
+  /**
+   * @brief Get the configuration of a role
+   */
+  static AudioTaskConfig get(AudioTaskRole role);
+
+  /**
+   * @brief Set the configuration of a role
+   * @param role Task role
+   * @param config Core, priority, stack size and placement
+   * @note Call in setup() before the clients start their tasks
+   */
+  static void set(AudioTaskRole role, const AudioTaskConfig& config);
+
+  /**
+   * @brief Move all roles to two cores
+   * @param networkCore Core for reconnects and downloads
+   * @param audioCore Core for decode, playback and capture
+   */
+  static void setCores(int8_t networkCore, int8_t audioCore);
+
+  /**
+   * @brief Get the core loop() and the network roles run on by default
+   */
+  static int8_t networkCore();
+
+  /**
+   * @brief Get the core the audio roles run on by default
+   */
+  static int8_t audioCore();
+
+  /**
+   * @brief Create a task with the configuration of its role
+   * @param role Task role
+   * @param fn Task function, ends with exit() if it returns at all
+   * @param name Task name
+   * @param param Passed to fn
+   * @param core AUDIO_CORE_DEFAULT for the role's core, else a per-call override
+   * @return Task handle, or nullptr if the task could not be created
+   */
+  static TaskHandle_t create(AudioTaskRole role, TaskFunction_t fn, const char* name, void* param,
+                             int8_t core = AUDIO_CORE_DEFAULT);
+
+  /**
+   * @brief Delete a task returned by create() from another task
+   * @param task Task handle (nullptr is ignored)
+   */
+  static void remove(TaskHandle_t task);
+
+  /**
+   * @brief End the calling task (instead of vTaskDelete(nullptr))
+   */
+  static void exit();
+};
+
+#endif
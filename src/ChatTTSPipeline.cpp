@@ -0,0 +1,68 @@
+/**
+ * @file ChatTTSPipeline.cpp
+ * @brief Sentence-pipelined LLM to TTS bridge Implementation
+ */
+
+#include "ChatTTSPipeline.h"
+
+ChatTTSPipeline::ChatTTSPipeline(ArduinoGPTChat& gpt, ArduinoTTSChat& tts)
+  : _gpt(gpt)
+  , _tts(tts)
+  , _streamOpen(false)
+  , _startTime(0)
+  , _firstSegmentMs(0)
+{
+}
+
+bool ChatTTSPipeline::begin(size_t maxSegmentBytes) {
+  if (!_segmenter.begin(maxSegmentBytes)) {
+    return false;
+  }
+  _segmenter.setCallback(onSegment, this);
+  return true;
+}
+
+void ChatTTSPipeline::setClauseBreak(size_t minBytes, size_t firstMinBytes) {
+  _segmenter.setClauseBreak(minBytes, firstMinBytes);
+}
+
+bool ChatTTSPipeline::run(String message) {
+  _segmenter.reset();
+  _firstSegmentMs = 0;
+  _startTime = millis();
+
+  _streamOpen = _tts.beginTextStream();
+  if (!_streamOpen) {
+    Serial.println("TTS text stream unavailable");
+    return false;
+  }
+
+  bool replied = _gpt.sendMessageStream(message, onToken, this);
+
+  _segmenter.flush();
+  _tts.endTextStream();
+  _streamOpen = false;
+
+  Serial.printf("Pipeline: %u segments, first after %lums, stream done after %lums\n",
+                (unsigned)_segmenter.segmentCount(), _firstSegmentMs, millis() - _startTime);
+  return replied;
+}
+
+void ChatTTSPipeline::onToken(const char* token, void* userData) {
+  ChatTTSPipeline* self = static_cast<ChatTTSPipeline*>(userData);
+  self->_segmenter.feed(token);
+
+  // Drain TTS audio frames between tokens so the socket does not back up while the LLM streams
+  self->_tts.loop();
+}
+
+void ChatTTSPipeline::onSegment(const char* segment, void* userData) {
+  ChatTTSPipeline* self = static_cast<ChatTTSPipeline*>(userData);
+  if (!self->_streamOpen) {
+    return;
+  }
+  if (self->_firstSegmentMs == 0) {
+    self->_firstSegmentMs = millis() - self->_startTime;
+  }
+  self->_tts.appendText(segment);
+}
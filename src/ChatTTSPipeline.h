@@ -0,0 +1,74 @@
+/**
+ * @file ChatTTSPipeline.h
+ * @brief Sentence-pipelined LLM to TTS bridge - speaks a streamed ChatGPT reply while it is generated
+ */
+
+#ifndef ChatTTSPipeline_h
+#define ChatTTSPipeline_h
+
+#include <Arduino.h>
+#include "ArduinoGPTChat.h"
+#include "ArduinoTTSChat.h"
+#include "TextSegmenter.h"
+
+/**
+ * @class ChatTTSPipeline
+ * @brief Connects ArduinoGPTChat::sendMessageStream() to an ArduinoTTSChat text stream
+ *
+ * Streamed tokens are segmented on punctuation and every segment is sent to the
+ * open MiniMax task as task_continue while earlier segments are still being
+ * synthesized and played, so generation, synthesis and playback overlap.
+ */
+class ChatTTSPipeline {
+public:
+  /**
+   * @brief Constructor
+   * @param gpt Chat client used for the streamed completion
+   * @param tts TTS client (speaker initialized, connected or in persistent session mode)
+   */
+  ChatTTSPipeline(ArduinoGPTChat& gpt, ArduinoTTSChat& tts);
+
+  /**
+   * @brief Allocate segmenter buffer
+   * @param maxSegmentBytes Longest text sent in one task_continue (default 300)
+   * @return Whether initialization succeeded
+   */
+  bool begin(size_t maxSegmentBytes = 300);
+
+  /**
+   * @brief Set clause break length, see TextSegmenter::setClauseBreak()
+   */
+  void setClauseBreak(size_t minBytes, size_t firstMinBytes = 24);
+
+  /**
+   * @brief Send a message and speak the reply as it streams in
+   * @param message User message
+   * @return true if reply text arrived, false on failure
+   * @note Returns when the completion has finished streaming; audio keeps playing,
+   *       keep calling ArduinoTTSChat::loop() until isPlaying() is false
+   */
+  bool run(String message);
+
+  /**
+   * @brief Get time from run() to the first segment sent to TTS (ms)
+   */
+  unsigned long firstSegmentMs() const { return _firstSegmentMs; }
+
+  /**
+   * @brief Get number of segments sent during the last run()
+   */
+  uint32_t segmentCount() const { return _segmenter.segmentCount(); }
+
+private:
+  static void onToken(const char* token, void* userData);     ///< GPT stream callback
+  static void onSegment(const char* segment, void* userData); ///< Segmenter callback
+
+  ArduinoGPTChat& _gpt;          ///< Chat client
+  ArduinoTTSChat& _tts;          ///< TTS client
+  TextSegmenter _segmenter;      ///< Token to segment splitter
+  bool _streamOpen;              ///< TTS text stream opened for this run
+  unsigned long _startTime;      ///< run() start time
+  unsigned long _firstSegmentMs; ///< Latency of the first segment
+};
+
+#endif
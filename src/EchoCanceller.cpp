@@ -0,0 +1,260 @@
+/**
+ * @file EchoCanceller.cpp
+ * @brief Acoustic echo canceller Implementation
+ */
+
+#include "EchoCanceller.h"
+
+// Mean reference power below which the speaker counts as idle (RMS ~8)
+static const float MIN_REFERENCE_POWER = 64.0f;
+
+// Adaptation needs a reference this far above the idle level (~12dB), else noise dominates
+static const float ADAPT_FACTOR = 16.0f;
+
+// Residual above this multiple of the expected echo is near-end speech (~6dB)
+static const float NEAR_END_FACTOR = 4.0f;
+
+EchoCanceller::EchoCanceller()
+  : _sampleRate(16000)
+  , _taps(0)
+  , _delay(0)
+  , _span(0)
+  , _weights(nullptr)
+  , _history(nullptr)
+  , _pos(0)
+  , _windowEnergy(0.0f)
+  , _mu(0.3f)
+  , _residualGain(0.125f)
+  , _refRate(0)
+  , _refPhase(0)
+  , _refPrev(0)
+  , _refLast(0)
+{
+  reset();
+}
+
+EchoCanceller::~EchoCanceller() {
+  end();
+}
+
+bool EchoCanceller::begin(int sampleRate, uint16_t taps, uint16_t delayMs) {
+  end();
+  if (sampleRate <= 0 || taps == 0) {
+    return false;
+  }
+
+  _sampleRate = sampleRate;
+  _taps = taps;
+  _delay = (uint16_t)((uint32_t)sampleRate * delayMs / 1000);
+  _span = (size_t)_delay + _taps + 1;
+
+  // Touched for every sample, keep them in internal RAM
+  _weights = (float*)AudioMemory::calloc(_taps, sizeof(float), AUDIO_MEM_INTERNAL_PREFERRED);
+  _history = (float*)AudioMemory::calloc(_span * 2, sizeof(float), AUDIO_MEM_INTERNAL_PREFERRED);
+  if (_weights == nullptr || _history == nullptr || !_reference.begin(REFERENCE_BYTES, AUDIO_MEM_PSRAM_PREFERRED)) {
+    Serial.println("[AEC] Allocation failed");
+    end();
+    return false;
+  }
+
+  reset();
+  Serial.printf("[AEC] %u taps, %u ms delay\n", (unsigned)_taps, (unsigned)delayMs);
+  return true;
+}
+
+void EchoCanceller::end() {
+  AudioMemory::release(_weights);
+  AudioMemory::release(_history);
+  _weights = nullptr;
+  _history = nullptr;
+  _reference.end();
+}
+
+void EchoCanceller::setSuppression(float attenuationDb) {
+  _residualGain = attenuationDb > 0.0f ? powf(10.0f, -attenuationDb / 20.0f) : 1.0f;
+}
+
+void EchoCanceller::reset() {
+  if (_weights != nullptr) {
+    memset(_weights, 0, _taps * sizeof(float));
+    memset(_history, 0, _span * 2 * sizeof(float));
+  }
+  _reference.discard();
+  _pos = 0;
+  _windowEnergy = 0.0f;
+  _refLevel = 0.0f;
+  _refPow = 0.0f;
+  _micPow = 0.0f;
+  _errPow = 0.0f;
+  _echoRatio = 1.0f;
+  _residualRatio = 1.0f;
+  _gain = 1.0f;
+  _nearEndHold = 0;
+  _freezeHold = 0;
+  _stepScale = 1.0f;
+  _active = false;
+  _nearEnd = false;
+}
+
+void EchoCanceller::pushReference(const int16_t* pcm, size_t count, int sampleRate) {
+  if (_weights == nullptr || pcm == nullptr || sampleRate <= 0) {
+    return;
+  }
+  if (sampleRate == _sampleRate) {
+    _reference.write(pcm, count * sizeof(int16_t));
+    return;
+  }
+
+  if (sampleRate != _refRate) {
+    _refRate = sampleRate;
+    _refPhase = 0;
+    _refPrev = 0;
+    _refLast = 0;
+  }
+  const uint32_t step = (uint32_t)(((uint64_t)sampleRate << 16) / _sampleRate);
+  const bool decimate = sampleRate > _sampleRate;
+
+  // Linear interpolation; when decimating, a 2-tap average first takes the edge off aliasing
+  int16_t out[BLOCK_SAMPLES];
+  size_t n = 0;
+  for (size_t i = 0; i < count; i++) {
+    int32_t x = pcm[i];
+    int32_t s = decimate ? (x + _refLast) >> 1 : x;
+    _refLast = x;
+    while (_refPhase < 65536) {
+      out[n++] = (int16_t)(_refPrev + (((s - _refPrev) * (int32_t)(_refPhase >> 1)) >> 15));
+      if (n == BLOCK_SAMPLES) {
+        _reference.write(out, sizeof(out));  // Full ring: the microphone side is not running, drop
+        n = 0;
+      }
+      _refPhase += step;
+    }
+    _refPhase -= 65536;
+    _refPrev = s;
+  }
+  if (n > 0) {
+    _reference.write(out, n * sizeof(int16_t));
+  }
+}
+
+void EchoCanceller::process(int16_t* mic, size_t count) {
+  if (_weights == nullptr || mic == nullptr) {
+    return;
+  }
+
+  const float release = 1.0f - 10.0f / _sampleRate;      // Echo tail, ~100ms time constant
+  const float smooth = 50.0f / _sampleRate;              // Power smoothing, ~20ms
+  const float fall = 10.0f / _sampleRate;                // Echo ratio follows lower levels in ~100ms
+  const float rise = 1.0f + 2.0f / _sampleRate;          // and creeps up ~+8dB/s
+  const uint32_t hold = (uint32_t)_sampleRate * NEAR_END_HOLD_MS / 1000;
+  const float activeEnergy = MIN_REFERENCE_POWER * _taps;
+
+  int16_t ref[BLOCK_SAMPLES];
+  while (count > 0) {
+    size_t block = count < BLOCK_SAMPLES ? count : BLOCK_SAMPLES;
+    // Reference not (yet) available: the speaker is playing silence
+    size_t got = _reference.read(ref, block * sizeof(int16_t)) / sizeof(int16_t);
+    if (got < block) {
+      memset(ref + got, 0, (block - got) * sizeof(int16_t));
+    }
+
+    for (size_t i = 0; i < block; i++) {
+      // Shift the reference history, newest sample first
+      _pos = (_pos == 0) ? _span - 1 : _pos - 1;
+      float x = ref[i];
+      _history[_pos] = x;
+      _history[_pos + _span] = x;
+      const float* window = _history + _pos + _delay;
+      float enter = window[0];
+      float leave = window[_taps];
+      _windowEnergy += enter * enter - leave * leave;
+      if (_pos == 0) {
+        recomputeEnergy();  // Rounding drift of the running sum
+      }
+      if (_windowEnergy < 0.0f) {
+        _windowEnergy = 0.0f;
+      }
+      _active = _windowEnergy > activeEnergy;
+
+      float d = mic[i];
+      float e = d;
+      if (_active) {
+        float y = 0.0f;
+        for (uint16_t k = 0; k < _taps; k++) {
+          y += _weights[k] * window[k];
+        }
+        e = d - y;
+
+        // Double talk would drag the filter towards the user's voice
+        if (_freezeHold == 0 && _windowEnergy > ADAPT_FACTOR * activeEnergy) {
+          float g = _mu * _stepScale * e / (_windowEnergy + activeEnergy);  // Regularized, quiet reference is mostly noise
+          for (uint16_t k = 0; k < _taps; k++) {
+            _weights[k] += g * window[k];
+          }
+        }
+      }
+
+      // Double talk: the microphone is louder than the echo path explains
+      float refPow = _windowEnergy / _taps;
+      _refLevel = refPow > _refLevel ? refPow : _refLevel * release;
+      _refPow += (refPow - _refPow) * smooth;
+      _micPow += (d * d - _micPow) * smooth;
+      _errPow += (e * e - _errPow) * smooth;
+
+      if (_refLevel > MIN_REFERENCE_POWER) {
+        float refLevel = _refLevel;  // Held level: the echo tail outlasts a drop of the reference
+        trackRatio(_echoRatio, _micPow / refLevel, fall, rise);
+        trackRatio(_residualRatio, _errPow / refLevel, fall, rise);
+        bool loud = _micPow > NEAR_END_FACTOR * _echoRatio * refLevel;
+        // Once the filter has converged, the residual also reveals speech quieter than the echo
+        float residualLimit = NEAR_END_FACTOR * _residualRatio * refLevel;
+        bool residual = _errPow > residualLimit;
+        _nearEndHold = (loud || residual) ? hold : (_nearEndHold > 0 ? _nearEndHold - 1 : 0);
+        // Only the raw signal stops adaptation, so a disturbed filter cannot freeze itself;
+        // a large residual slows adaptation down instead
+        _freezeHold = loud ? hold : (_freezeHold > 0 ? _freezeHold - 1 : 0);
+        _stepScale = residual ? residualLimit / _errPow : 1.0f;
+        _nearEnd = _nearEndHold > 0;
+      } else {
+        _nearEnd = false;
+        _nearEndHold = 0;
+        _freezeHold = 0;
+        _stepScale = 1.0f;
+      }
+
+      // Speaker alone: attenuate the residual. Open quickly so word onsets survive, close slowly
+      float target = (_refLevel > MIN_REFERENCE_POWER && !_nearEnd) ? _residualGain : 1.0f;
+      _gain += (target - _gain) * (target > _gain ? 0.05f : 0.002f);
+
+      float out = e * _gain;
+      mic[i] = (int16_t)(out > 32767.0f ? 32767 : (out < -32768.0f ? -32768 : (int32_t)out));
+    }
+
+    mic += block;
+    count -= block;
+  }
+}
+
+float EchoCanceller::erleDb() const {
+  if (_refLevel <= MIN_REFERENCE_POWER || _errPow <= 0.0f) {
+    return 0.0f;
+  }
+  return 10.0f * log10f((_micPow + 1.0f) / (_errPow + 1.0f));
+}
+
+void EchoCanceller::trackRatio(float& tracked, float ratio, float fall, float rise) {
+  if (ratio < tracked) {
+    tracked += (ratio - tracked) * fall;
+  } else if (tracked < 100.0f) {
+    tracked *= rise;
+  }
+}
+
+void EchoCanceller::recomputeEnergy() {
+  const float* window = _history + _pos + _delay;
+  float sum = 0.0f;
+  for (uint16_t k = 0; k < _taps; k++) {
+    sum += window[k] * window[k];
+  }
+  _windowEnergy = sum;
+}
@@ -0,0 +1,151 @@
+/**
+ * @file EchoCanceller.h
+ * @brief Acoustic echo canceller - NLMS filter with residual echo suppression
+ */
+
+#ifndef EchoCanceller_h
+#define EchoCanceller_h
+
+#include <Arduino.h>
+#include "AudioMemory.h"
+#include "AudioRingBuffer.h"
+
+/**
+ * @class EchoCanceller
+ * @brief Removes the speaker's own playback from microphone audio
+ *
+ * The playback side hands every block it writes to I2S to pushReference(), which
+ * resamples it to the microphone rate into a lock-free ring. process() pairs each
+ * microphone sample with the next reference sample, subtracts the echo predicted
+ * by an NLMS filter and attenuates what is left while only the speaker is active.
+ * Near-end speech (double talk) freezes adaptation and opens the suppressor, so
+ * the user can still be heard while the device is talking.
+ *
+ * pushReference() and process() may run in different tasks. The echo path
+ * covered is [delayMs, delayMs + taps / sampleRate); raise delayMs when
+ * erleDb() stays near 0 dB during playback.
+ */
+class EchoCanceller {
+public:
+  /**
+   * @brief Constructor
+   */
+  EchoCanceller();
+
+  /**
+   * @brief Destructor
+   */
+  ~EchoCanceller();
+
+  /**
+   * @brief Allocate the filter and reference ring
+   * @param sampleRate Microphone sample rate in Hz
+   * @param taps Filter length in samples (default 256, 16ms at 16kHz)
+   * @param delayMs Bulk delay from writing a sample to I2S until the microphone hears it (default 16ms)
+   * @return Whether memory could be allocated
+   */
+  bool begin(int sampleRate, uint16_t taps = 256, uint16_t delayMs = 16);
+
+  /**
+   * @brief Release all memory
+   */
+  void end();
+
+  /**
+   * @brief Check if begin() succeeded
+   */
+  bool ready() const { return _weights != nullptr; }
+
+  /**
+   * @brief Set NLMS step size
+   * @param mu Adaptation speed, 0-1 (default 0.3, higher converges faster but is noisier)
+   */
+  void setStepSize(float mu) { _mu = mu; }
+
+  /**
+   * @brief Set residual echo attenuation
+   * @param attenuationDb Gain reduction while only the speaker is active (default 18dB, 0 disables)
+   */
+  void setSuppression(float attenuationDb);
+
+  /**
+   * @brief Clear filter state and drop buffered reference (microphone side)
+   */
+  void reset();
+
+  /**
+   * @brief Drop buffered reference, e.g. after playback was cut off (either side)
+   */
+  void flushReference() { _reference.discard(); }
+
+  /**
+   * @brief Add audio that was just written to the speaker (playback side)
+   * @param pcm 16-bit mono PCM
+   * @param count Number of samples
+   * @param sampleRate Playback sample rate in Hz, resampled to the microphone rate
+   */
+  void pushReference(const int16_t* pcm, size_t count, int sampleRate);
+
+  /**
+   * @brief Remove echo from microphone audio in place (microphone side)
+   * @param mic 16-bit mono PCM
+   * @param count Number of samples
+   */
+  void process(int16_t* mic, size_t count);
+
+  /**
+   * @brief Check if reference audio is in the filter window (speaker active)
+   */
+  bool active() const { return _active; }
+
+  /**
+   * @brief Check if near-end speech is detected (with a short hangover)
+   */
+  bool nearEnd() const { return _nearEnd; }
+
+  /**
+   * @brief Get echo return loss enhancement of the filter
+   * @return Smoothed microphone / residual power in dB, 0 while the speaker is idle
+   */
+  float erleDb() const;
+
+private:
+  static const size_t REFERENCE_BYTES = 32768;  ///< Reference ring (1s at 16kHz)
+  static const size_t BLOCK_SAMPLES = 64;        ///< Reference samples read per ring access
+  static const uint32_t NEAR_END_HOLD_MS = 60;   ///< Near-end state hangover
+
+  int _sampleRate;          ///< Microphone sample rate
+  uint16_t _taps;           ///< Filter length (samples)
+  uint16_t _delay;          ///< Bulk delay (samples)
+  size_t _span;             ///< History length: delay + taps + 1
+  float* _weights;          ///< NLMS coefficients
+  float* _history;          ///< Reference history, stored twice so the window is contiguous
+  size_t _pos;              ///< Index of the newest reference sample
+  float _windowEnergy;      ///< Sum of squares in the filter window
+  float _mu;                ///< Step size
+  float _residualGain;      ///< Gain while only the speaker is active
+
+  float _refLevel;          ///< Reference power with slow release (covers the echo tail)
+  float _refPow;            ///< Smoothed reference power in the filter window
+  float _micPow;            ///< Smoothed microphone power
+  float _errPow;            ///< Smoothed residual power
+  float _echoRatio;         ///< Tracked microphone / reference power ratio of pure echo (echo path gain)
+  float _residualRatio;     ///< Tracked residual / reference power ratio of pure echo
+  float _gain;              ///< Current suppressor gain
+  uint32_t _nearEndHold;    ///< Samples left in near-end state
+  uint32_t _freezeHold;     ///< Samples left with adaptation stopped
+  float _stepScale;         ///< Step reduction while the residual is unexpectedly large
+  bool _active;             ///< Reference present in window
+  bool _nearEnd;            ///< Near-end speech detected
+
+  AudioRingBuffer _reference;  ///< Resampled reference (playback task -> microphone task)
+  int _refRate;                ///< Input rate of the resampler state
+  uint32_t _refPhase;          ///< Resampler position between the last two inputs (16.16)
+  int32_t _refPrev;            ///< Previous smoothed input sample
+  int32_t _refLast;            ///< Previous raw input sample (anti-alias average)
+
+  void recomputeEnergy();
+  static void trackRatio(float& tracked, float ratio, float fall, float rise);
+};
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * @file EnergyVAD.cpp
+ * @brief Energy-based Voice Activity Detector Implementation
+ */
+
+#include "EnergyVAD.h"
+
+EnergyVAD::EnergyVAD()
+  : _frameSamples(320)
+  , _frameMs(20)
+  , _speechRatio(3.0f)
+  , _minRms(200.0f)
+  , _maxZcr(0.4f)
+  , _onsetMs(60)
+  , _hangoverMs(300)
+  , _onsetFrames(3)
+  , _hangoverFrames(15)
+{
+  reset();
+}
+
+void EnergyVAD::begin(int sampleRate, uint16_t frameMs) {
+  _frameMs = frameMs > 0 ? frameMs : 20;
+  _frameSamples = (size_t)sampleRate * _frameMs / 1000;
+  setTiming(_onsetMs, _hangoverMs);
+  reset();
+}
+
+void EnergyVAD::setThresholds(float speechRatio, float minRms, float maxZcr) {
+  _speechRatio = speechRatio;
+  _minRms = minRms;
+  _maxZcr = maxZcr;
+}
+
+void EnergyVAD::setTiming(uint32_t onsetMs, uint32_t hangoverMs) {
+  _onsetMs = onsetMs;
+  _hangoverMs = hangoverMs;
+  _onsetFrames = (onsetMs + _frameMs - 1) / _frameMs;
+  if (_onsetFrames == 0) _onsetFrames = 1;
+  _hangoverFrames = (hangoverMs + _frameMs - 1) / _frameMs;
+}
+
+void EnergyVAD::reset() {
+  _noiseFloor = 0.0f;
+  _lastRms = 0.0f;
+  _lastZcr = 0.0f;
+  _calibrated = 0;
+  _speechRun = 0;
+  _silentFrames = 0;
+  _inSpeech = false;
+  _started = false;
+  _speechDetected = false;
+}
+
+bool EnergyVAD::processFrame(const int16_t* samples, size_t count) {
+  _started = false;
+  if (samples == nullptr || count == 0) {
+    return _inSpeech;
+  }
+
+  // Frame energy and zero crossings
+  int64_t sumSquares = 0;
+  uint32_t crossings = 0;
+  int16_t prev = samples[0];
+  for (size_t i = 0; i < count; i++) {
+    int32_t s = samples[i];
+    sumSquares += s * s;
+    crossings += (uint32_t)((s ^ prev) < 0);
+    prev = (int16_t)s;
+  }
+  _lastRms = sqrtf((float)sumSquares / count);
+  _lastZcr = (float)crossings / count;
+
+  // Learn initial noise floor from the first frames
+  if (_calibrated < CALIBRATION_FRAMES) {
+    _noiseFloor += (_lastRms - _noiseFloor) / (_calibrated + 1);
+    _calibrated++;
+    return _inSpeech;
+  }
+
+  float threshold = _noiseFloor * _speechRatio;
+  if (threshold < _minRms) threshold = _minRms;
+
+  // Loud frames are speech regardless of ZCR (fricatives), quiet high-ZCR frames are hiss
+  bool speechFrame = _lastRms > threshold && (_lastZcr <= _maxZcr || _lastRms > threshold * 2.0f);
+
+  if (speechFrame) {
+    _speechRun++;
+    _silentFrames = 0;
+    if (!_inSpeech && _speechRun >= _onsetFrames) {
+      _inSpeech = true;
+      _started = true;
+      _speechDetected = true;
+    }
+  } else {
+    _speechRun = 0;
+    _silentFrames++;
+    if (_inSpeech && _silentFrames > _hangoverFrames) {
+      _inSpeech = false;
+    }
+
+    // Track noise floor outside speech: falls fast, rises slowly
+    if (!_inSpeech) {
+      float alpha = (_lastRms < _noiseFloor) ? 0.1f : 0.005f;
+      _noiseFloor += (_lastRms - _noiseFloor) * alpha;
+      if (_noiseFloor < 1.0f) _noiseFloor = 1.0f;
+    }
+  }
+
+  return _inSpeech;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file EnergyVAD.h
+ * @brief Energy-based Voice Activity Detector - frame RMS / zero-crossing classification
+ */
+
+#ifndef EnergyVAD_h
+#define EnergyVAD_h
+
+#include <Arduino.h>
+
+/**
+ * @class EnergyVAD
+ * @brief Lightweight on-device VAD for 16-bit PCM
+ *
+ * Classifies fixed-size frames by RMS against an adaptive noise floor, using the
+ * zero-crossing rate to reject hiss. Onset and hangover smooth the decision so
+ * word beginnings are not clipped and short pauses do not end the utterance.
+ */
+class EnergyVAD {
+public:
+  /**
+   * @brief Constructor
+   */
+  EnergyVAD();
+
+  /**
+   * @brief Configure frame size and reset state
+   * @param sampleRate Sample rate in Hz
+   * @param frameMs Frame length in milliseconds (default 20ms)
+   */
+  void begin(int sampleRate, uint16_t frameMs = 20);
+
+  /**
+   * @brief Set detection thresholds
+   * @param speechRatio Frame is speech when RMS exceeds noise floor by this factor (default 3.0, ~10dB)
+   * @param minRms Absolute RMS floor for speech, guards against very quiet rooms (default 200)
+   * @param maxZcr Zero-crossing rate (0-1) above which quiet frames are treated as noise (default 0.4)
+   */
+  void setThresholds(float speechRatio, float minRms, float maxZcr = 0.4f);
+
+  /**
+   * @brief Set decision smoothing
+   * @param onsetMs Consecutive speech required before entering speech state (default 60ms)
+   * @param hangoverMs Time speech state is held after the last speech frame (default 300ms)
+   */
+  void setTiming(uint32_t onsetMs, uint32_t hangoverMs);
+
+  /**
+   * @brief Reset detection state and re-learn noise floor
+   */
+  void reset();
+
+  /**
+   * @brief Classify one frame
+   * @param samples PCM samples
+   * @param count Number of samples (normally frameSamples())
+   * @return true if in speech state after this frame (including hangover)
+   */
+  bool processFrame(const int16_t* samples, size_t count);
+
+  /**
+   * @brief Check if in speech state (including hangover)
+   */
+  bool isSpeech() const { return _inSpeech; }
+
+  /**
+   * @brief Check if the last frame entered speech state
+   */
+  bool speechStarted() const { return _started; }
+
+  /**
+   * @brief Check if any speech was detected since reset()
+   */
+  bool speechDetected() const { return _speechDetected; }
+
+  /**
+   * @brief Get audio time since the last speech frame
+   * @return Milliseconds of non-speech audio, 0 while speech frames are arriving
+   */
+  uint32_t silenceMs() const { return _silentFrames * _frameMs; }
+
+  /**
+   * @brief Get frame size in samples
+   */
+  size_t frameSamples() const { return _frameSamples; }
+
+  /**
+   * @brief Get current noise floor (RMS)
+   */
+  float noiseFloor() const { return _noiseFloor; }
+
+  /**
+   * @brief Get RMS of the last frame
+   */
+  float lastRms() const { return _lastRms; }
+
+  /**
+   * @brief Get zero-crossing rate of the last frame
+   */
+  float lastZcr() const { return _lastZcr; }
+
+private:
+  static const uint8_t CALIBRATION_FRAMES = 5;  ///< Frames averaged for the initial noise floor
+
+  size_t _frameSamples;      ///< Samples per frame
+  uint16_t _frameMs;         ///< Frame length (ms)
+  float _speechRatio;        ///< Speech / noise floor ratio
+  float _minRms;             ///< Absolute speech RMS threshold
+  float _maxZcr;             ///< Zero-crossing rate limit for quiet frames
+  uint32_t _onsetMs;         ///< Onset time (ms)
+  uint32_t _hangoverMs;      ///< Hangover time (ms)
+  uint32_t _onsetFrames;     ///< Onset in frames
+  uint32_t _hangoverFrames;  ///< Hangover in frames
+
+  float _noiseFloor;         ///< Adaptive noise floor (RMS)
+  float _lastRms;            ///< Last frame RMS
+  float _lastZcr;            ///< Last frame zero-crossing rate
+  uint8_t _calibrated;       ///< Frames used for calibration so far
+  uint32_t _speechRun;       ///< Consecutive speech frames
+  uint32_t _silentFrames;    ///< Frames since last speech frame
+  bool _inSpeech;            ///< Speech state (with hangover)
+  bool _started;             ///< Speech state entered on last frame
+  bool _speechDetected;      ///< Speech seen since reset
+};
+
+#endif
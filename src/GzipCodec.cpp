@@ -0,0 +1,582 @@
+/**
+ * @file GzipCodec.cpp
+ * @brief Fixed-buffer gzip inflater and deflater Implementation
+ * @details The inflater follows the structure of zlib's puff.c reference decoder, with a
+ *          FAST_BITS lookup table in front of the canonical decode
+ */
+
+#include "GzipCodec.h"
+
+// DEFLATE length / distance symbol tables (RFC 1951 section 3.2.5)
+static const uint16_t LEN_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                      35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LEN_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                      3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                       257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                       7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+// Order of the code length code lengths in a dynamic block header
+static const uint8_t CLEN_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+uint32_t gzipCrc32(uint32_t crc, const uint8_t* data, size_t len) {
+  // Nibble table: 64 bytes of flash instead of 1KB
+  static const uint32_t table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ table[crc & 0x0F];
+    crc = (crc >> 4) ^ table[crc & 0x0F];
+  }
+  return ~crc;
+}
+
+static uint32_t reverseBits(uint32_t code, int n) {
+  uint32_t r = 0;
+  for (int i = 0; i < n; i++) {
+    r = (r << 1) | (code & 1);
+    code >>= 1;
+  }
+  return r;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+//                                               I N F L A T E R
+//----------------------------------------------------------------------------------------------------------------------
+
+GzipInflater::GzipInflater()
+  : _window(nullptr)
+  , _in(nullptr)
+  , _inLen(0)
+  , _inPos(0)
+  , _bitBuf(0)
+  , _bitCnt(0)
+  , _outPos(0)
+  , _flushed(0)
+  , _crc(0)
+  , _zlib(false)
+  , _output(nullptr)
+  , _user(nullptr)
+{
+}
+
+GzipInflater::~GzipInflater() {
+  end();
+}
+
+bool GzipInflater::begin() {
+  if (_window == nullptr) {
+    _window = (uint8_t*)AudioMemory::alloc(WINDOW_SIZE, AUDIO_MEM_PSRAM_PREFERRED);
+  }
+  return _window != nullptr;
+}
+
+void GzipInflater::end() {
+  if (_window != nullptr) {
+    AudioMemory::release(_window);
+    _window = nullptr;
+  }
+}
+
+bool GzipInflater::build(Huffman& h, const uint8_t* lengths, int n) {
+  uint16_t offs[16];
+
+  memset(h.count, 0, sizeof(h.count));
+  for (int s = 0; s < n; s++) {
+    h.count[lengths[s]]++;
+  }
+  if (h.count[0] == n) {
+    memset(h.fast, 0, sizeof(h.fast));
+    return true;  // No codes, fine as long as none is used
+  }
+
+  // Over-subscribed sets are invalid, incomplete ones are allowed (single distance code)
+  int left = 1;
+  for (int len = 1; len < 16; len++) {
+    left <<= 1;
+    left -= h.count[len];
+    if (left < 0) {
+      return false;
+    }
+  }
+
+  offs[1] = 0;
+  for (int len = 1; len < 15; len++) {
+    offs[len + 1] = offs[len] + h.count[len];
+  }
+  for (int s = 0; s < n; s++) {
+    if (lengths[s] != 0) {
+      h.symbol[offs[lengths[s]]++] = s;
+    }
+  }
+
+  // Lookup table for the short codes, indexed by the next FAST_BITS input bits
+  memset(h.fast, 0, sizeof(h.fast));
+  uint32_t code = 0;
+  int index = 0;
+  for (int len = 1; len <= FAST_BITS; len++) {
+    for (int i = 0; i < h.count[len]; i++) {
+      uint32_t rev = reverseBits(code + i, len);
+      for (uint32_t j = rev; j < (1u << FAST_BITS); j += (1u << len)) {
+        h.fast[j] = (uint16_t)((h.symbol[index + i] << 4) | len);
+      }
+    }
+    index += h.count[len];
+    code = (code + h.count[len]) << 1;
+  }
+  return true;
+}
+
+bool GzipInflater::need(int n) {
+  while (_bitCnt < n) {
+    if (_inPos >= _inLen) {
+      return false;
+    }
+    _bitBuf |= (uint32_t)_in[_inPos++] << _bitCnt;
+    _bitCnt += 8;
+  }
+  return true;
+}
+
+uint32_t GzipInflater::bits(int n) {
+  uint32_t v = _bitBuf & ((1u << n) - 1);
+  _bitBuf >>= n;
+  _bitCnt -= n;
+  return v;
+}
+
+int GzipInflater::decode(const Huffman& h) {
+  // Fast path: top up to FAST_BITS if the input allows, the code must fit in what is there
+  while (_bitCnt < FAST_BITS && _inPos < _inLen) {
+    _bitBuf |= (uint32_t)_in[_inPos++] << _bitCnt;
+    _bitCnt += 8;
+  }
+  uint16_t entry = h.fast[_bitBuf & ((1u << FAST_BITS) - 1)];
+  if (entry != 0 && (int)(entry & 0x0F) <= _bitCnt) {
+    bits(entry & 0x0F);
+    return entry >> 4;
+  }
+
+  // Canonical decode one bit at a time (puff.c)
+  int code = 0, first = 0, index = 0;
+  for (int len = 1; len < 16; len++) {
+    if (!need(1)) {
+      return -1;
+    }
+    code |= bits(1);
+    int count = h.count[len];
+    if (code - count < first) {
+      return h.symbol[index + (code - first)];
+    }
+    index += count;
+    first += count;
+    first <<= 1;
+    code <<= 1;
+  }
+  return -1;
+}
+
+void GzipInflater::flush() {
+  uint32_t start = _flushed & (WINDOW_SIZE - 1);
+  uint32_t len = _outPos - _flushed;
+  if (len == 0) {
+    return;
+  }
+  if (!_zlib) {
+    _crc = gzipCrc32(_crc, _window + start, len);
+  }
+  _output(_window + start, len, _user);
+  _flushed = _outPos;
+}
+
+inline void GzipInflater::put(uint8_t c) {
+  _window[_outPos & (WINDOW_SIZE - 1)] = c;
+  _outPos++;
+  if ((_outPos & (WINDOW_SIZE - 1)) == 0) {
+    flush();
+  }
+}
+
+int32_t GzipInflater::parseHeader() {
+  if (_inLen >= 2 && (_in[0] & 0x0F) == 8 && ((_in[0] << 8) | _in[1]) % 31 == 0) {
+    // zlib (RFC 1950): CMF, FLG, no preset dictionary
+    if (_in[1] & 0x20) {
+      return GZIP_ERR_HEADER;
+    }
+    _zlib = true;
+    _inPos = 2;
+    return 0;
+  }
+  if (_inLen < 10 || !isGzip(_in, _inLen) || _in[2] != 8) {
+    return GZIP_ERR_HEADER;
+  }
+  uint8_t flags = _in[3];
+  size_t pos = 10;  // ID1 ID2 CM FLG MTIME(4) XFL OS
+  if (flags & 0x04) {  // FEXTRA
+    if (pos + 2 > _inLen) return GZIP_ERR_TRUNCATED;
+    pos += 2 + (_in[pos] | (_in[pos + 1] << 8));
+  }
+  if (flags & 0x08) {  // FNAME
+    while (pos < _inLen && _in[pos] != 0) pos++;
+    pos++;
+  }
+  if (flags & 0x10) {  // FCOMMENT
+    while (pos < _inLen && _in[pos] != 0) pos++;
+    pos++;
+  }
+  if (flags & 0x02) {  // FHCRC
+    pos += 2;
+  }
+  if (pos > _inLen) {
+    return GZIP_ERR_TRUNCATED;
+  }
+  _zlib = false;
+  _inPos = pos;
+  return 0;
+}
+
+int32_t GzipInflater::stored() {
+  // Skip to the byte boundary, LEN and NLEN follow
+  bits(_bitCnt & 7);
+  if (!need(32)) {
+    return GZIP_ERR_TRUNCATED;
+  }
+  uint32_t len = bits(16);
+  if ((bits(16) ^ 0xFFFF) != len) {
+    return GZIP_ERR_DATA;
+  }
+  // _bitBuf is empty now (32 bits were read at a byte boundary)
+  if (_inPos + len > _inLen) {
+    return GZIP_ERR_TRUNCATED;
+  }
+  while (len--) {
+    put(_in[_inPos++]);
+  }
+  return 0;
+}
+
+int32_t GzipInflater::codes() {
+  while (true) {
+    int symbol = decode(_lencode);
+    if (symbol < 0) {
+      return _inPos >= _inLen ? GZIP_ERR_TRUNCATED : GZIP_ERR_DATA;
+    }
+    if (symbol < 256) {
+      put((uint8_t)symbol);
+      continue;
+    }
+    if (symbol == 256) {
+      return 0;  // End of block
+    }
+
+    symbol -= 257;
+    if (symbol >= 29) {
+      return GZIP_ERR_DATA;
+    }
+    if (!need(LEN_EXTRA[symbol])) {
+      return GZIP_ERR_TRUNCATED;
+    }
+    int len = LEN_BASE[symbol] + bits(LEN_EXTRA[symbol]);
+
+    symbol = decode(_distcode);
+    if (symbol < 0 || symbol >= 30) {
+      return symbol < 0 && _inPos >= _inLen ? GZIP_ERR_TRUNCATED : GZIP_ERR_DATA;
+    }
+    if (!need(DIST_EXTRA[symbol])) {
+      return GZIP_ERR_TRUNCATED;
+    }
+    uint32_t dist = DIST_BASE[symbol] + bits(DIST_EXTRA[symbol]);
+    if (dist > _outPos) {
+      return GZIP_ERR_DATA;  // Before the start of the stream
+    }
+    while (len--) {
+      put(_window[(_outPos - dist) & (WINDOW_SIZE - 1)]);
+    }
+  }
+}
+
+int32_t GzipInflater::fixed() {
+  uint8_t lengths[288];
+  int s = 0;
+  for (; s < 144; s++) lengths[s] = 8;
+  for (; s < 256; s++) lengths[s] = 9;
+  for (; s < 280; s++) lengths[s] = 7;
+  for (; s < 288; s++) lengths[s] = 8;
+  build(_lencode, lengths, 288);
+  for (s = 0; s < 30; s++) lengths[s] = 5;
+  build(_distcode, lengths, 30);
+  return codes();
+}
+
+int32_t GzipInflater::dynamic() {
+  uint8_t lengths[288 + 32];
+
+  if (!need(14)) {
+    return GZIP_ERR_TRUNCATED;
+  }
+  int nlen = bits(5) + 257;
+  int ndist = bits(5) + 1;
+  int ncode = bits(4) + 4;
+  if (nlen > 286 || ndist > 30) {
+    return GZIP_ERR_DATA;
+  }
+
+  // Code length code, in its own permuted order
+  for (int i = 0; i < 19; i++) {
+    if (i < ncode) {
+      if (!need(3)) return GZIP_ERR_TRUNCATED;
+      lengths[CLEN_ORDER[i]] = bits(3);
+    } else {
+      lengths[CLEN_ORDER[i]] = 0;
+    }
+  }
+  if (!build(_lencode, lengths, 19)) {
+    return GZIP_ERR_DATA;
+  }
+
+  // Literal/length and distance code lengths, run-length coded
+  int index = 0;
+  while (index < nlen + ndist) {
+    int symbol = decode(_lencode);
+    if (symbol < 0) {
+      return GZIP_ERR_DATA;
+    }
+    if (symbol < 16) {
+      lengths[index++] = symbol;
+      continue;
+    }
+    int len = 0, repeat;
+    if (symbol == 16) {
+      if (index == 0) return GZIP_ERR_DATA;
+      len = lengths[index - 1];
+      if (!need(2)) return GZIP_ERR_TRUNCATED;
+      repeat = 3 + bits(2);
+    } else if (symbol == 17) {
+      if (!need(3)) return GZIP_ERR_TRUNCATED;
+      repeat = 3 + bits(3);
+    } else {
+      if (!need(7)) return GZIP_ERR_TRUNCATED;
+      repeat = 11 + bits(7);
+    }
+    if (index + repeat > nlen + ndist) {
+      return GZIP_ERR_DATA;
+    }
+    while (repeat--) {
+      lengths[index++] = len;
+    }
+  }
+  if (lengths[256] == 0) {
+    return GZIP_ERR_DATA;  // No end-of-block code
+  }
+
+  if (!build(_lencode, lengths, nlen) || !build(_distcode, lengths + nlen, ndist)) {
+    return GZIP_ERR_DATA;
+  }
+  return codes();
+}
+
+int32_t GzipInflater::inflate(const uint8_t* in, size_t len, OutputCallback output, void* user) {
+  if (!begin()) {
+    return GZIP_ERR_MEMORY;
+  }
+  _in = in;
+  _inLen = len;
+  _bitBuf = 0;
+  _bitCnt = 0;
+  _outPos = 0;
+  _flushed = 0;
+  _crc = 0;
+  _output = output;
+  _user = user;
+
+  int32_t err = parseHeader();
+  bool last = false;
+  while (err == 0 && !last) {
+    if (!need(3)) {
+      err = GZIP_ERR_TRUNCATED;
+      break;
+    }
+    last = bits(1);
+    switch (bits(2)) {
+      case 0: err = stored(); break;
+      case 1: err = fixed(); break;
+      case 2: err = dynamic(); break;
+      default: err = GZIP_ERR_DATA; break;
+    }
+  }
+  flush();
+  if (err != 0) {
+    return err;
+  }
+
+  // Trailer starts at the next byte boundary; give back whole bytes still in the bit buffer
+  _inPos -= _bitCnt >> 3;
+  if (_zlib) {
+    return _outPos;  // Adler-32 not checked, TLS already protects the payload
+  }
+  if (_inPos + 8 > _inLen) {
+    return GZIP_ERR_TRUNCATED;
+  }
+  const uint8_t* t = _in + _inPos;
+  uint32_t crc = t[0] | (t[1] << 8) | (t[2] << 16) | ((uint32_t)t[3] << 24);
+  uint32_t size = t[4] | (t[5] << 8) | (t[6] << 16) | ((uint32_t)t[7] << 24);
+  if (crc != _crc || size != _outPos) {
+    return GZIP_ERR_CHECKSUM;
+  }
+  return _outPos;
+}
+
+namespace {
+struct BufferSink {
+  uint8_t* out;
+  size_t size;
+  size_t len;
+  bool overflow;
+};
+
+void bufferOutput(const uint8_t* data, size_t len, void* user) {
+  BufferSink* sink = (BufferSink*)user;
+  size_t n = min(len, sink->size - sink->len);
+  memcpy(sink->out + sink->len, data, n);
+  sink->len += n;
+  sink->overflow |= (n < len);
+}
+}  // namespace
+
+int32_t GzipInflater::inflate(const uint8_t* in, size_t len, uint8_t* out, size_t outSize) {
+  BufferSink sink = {out, outSize, 0, false};
+  int32_t ret = inflate(in, len, bufferOutput, &sink);
+  if (ret >= 0 && sink.overflow) {
+    return GZIP_ERR_OVERFLOW;
+  }
+  return ret;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+//                                               D E F L A T E R
+//----------------------------------------------------------------------------------------------------------------------
+
+GzipDeflater::GzipDeflater()
+  : _head(nullptr)
+  , _out(nullptr)
+  , _outSize(0)
+  , _outPos(0)
+  , _bitBuf(0)
+  , _bitCnt(0)
+{
+}
+
+GzipDeflater::~GzipDeflater() {
+  end();
+}
+
+bool GzipDeflater::begin() {
+  if (_head == nullptr) {
+    _head = (uint16_t*)AudioMemory::alloc((1 << HASH_BITS) * sizeof(uint16_t), AUDIO_MEM_INTERNAL_PREFERRED);
+  }
+  return _head != nullptr;
+}
+
+void GzipDeflater::end() {
+  if (_head != nullptr) {
+    AudioMemory::release(_head);
+    _head = nullptr;
+  }
+}
+
+bool GzipDeflater::putBits(uint32_t value, int n) {
+  _bitBuf |= value << _bitCnt;
+  _bitCnt += n;
+  while (_bitCnt >= 8) {
+    if (_outPos >= _outSize) {
+      return false;
+    }
+    _out[_outPos++] = (uint8_t)_bitBuf;
+    _bitBuf >>= 8;
+    _bitCnt -= 8;
+  }
+  return true;
+}
+
+bool GzipDeflater::putCode(uint32_t code, int n) {
+  return putBits(reverseBits(code, n), n);
+}
+
+bool GzipDeflater::putLiteral(int lit) {
+  // Fixed literal/length code (RFC 1951 section 3.2.6)
+  if (lit < 144) return putCode(0x30 + lit, 8);
+  if (lit < 256) return putCode(0x190 + lit - 144, 9);
+  if (lit < 280) return putCode(lit - 256, 7);
+  return putCode(0xC0 + lit - 280, 8);
+}
+
+bool GzipDeflater::putMatch(int len, int dist) {
+  int l = 28;
+  while (LEN_BASE[l] > len) l--;
+  int d = 29;
+  while (DIST_BASE[d] > dist) d--;
+  return putLiteral(257 + l) && putBits(len - LEN_BASE[l], LEN_EXTRA[l]) &&
+         putCode(d, 5) && putBits(dist - DIST_BASE[d], DIST_EXTRA[d]);
+}
+
+size_t GzipDeflater::compress(const uint8_t* in, size_t len, uint8_t* out, size_t outSize) {
+  static const uint8_t header[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF};  // No flags, no mtime, OS unknown
+
+  if (len > MAX_INPUT_LENGTH || outSize < sizeof(header) + 8 || !begin()) {
+    return 0;
+  }
+  memcpy(out, header, sizeof(header));
+  memset(_head, 0, (1 << HASH_BITS) * sizeof(uint16_t));
+  _out = out;
+  _outSize = outSize - 8;  // Keep room for the trailer
+  _outPos = sizeof(header);
+  _bitBuf = 0;
+  _bitCnt = 0;
+
+  // One final block with the fixed codes
+  bool ok = putBits(1, 1) && putBits(1, 2);
+  size_t pos = 0;
+  while (ok && pos < len) {
+    int bestLen = 0, bestDist = 0;
+    if (pos + 3 <= len) {
+      uint32_t h = ((in[pos] << 16 | in[pos + 1] << 8 | in[pos + 2]) * 2654435761u) >> (32 - HASH_BITS);
+      size_t cand = _head[h];
+      _head[h] = (uint16_t)(pos + 1);
+      if (cand != 0 && pos - (cand - 1) <= GzipInflater::WINDOW_SIZE) {
+        cand--;
+        size_t maxLen = min((size_t)258, len - pos);
+        size_t n = 0;
+        while (n < maxLen && in[cand + n] == in[pos + n]) n++;
+        if (n >= 3) {
+          bestLen = n;
+          bestDist = pos - cand;
+        }
+      }
+    }
+    if (bestLen == 0) {
+      ok = putLiteral(in[pos]);
+      pos++;
+      continue;
+    }
+    ok = putMatch(bestLen, bestDist);
+
+    // Index the positions inside the match so later repeats find them
+    size_t end = pos + bestLen;
+    for (pos++; pos < end && pos + 3 <= len; pos++) {
+      uint32_t h = ((in[pos] << 16 | in[pos + 1] << 8 | in[pos + 2]) * 2654435761u) >> (32 - HASH_BITS);
+      _head[h] = (uint16_t)(pos + 1);
+    }
+    pos = end;
+  }
+  ok = ok && putLiteral(256) && putBits(0, 7);  // End of block, pad to a byte
+  if (!ok) {
+    return 0;
+  }
+
+  uint32_t crc = gzipCrc32(0, in, len);
+  for (int i = 0; i < 4; i++) out[_outPos++] = (uint8_t)(crc >> (8 * i));
+  for (int i = 0; i < 4; i++) out[_outPos++] = (uint8_t)(len >> (8 * i));
+  return _outPos;
+}
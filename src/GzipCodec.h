@@ -0,0 +1,193 @@
+/**
+ * @file GzipCodec.h
+ * @brief Fixed-buffer gzip (RFC 1952 / DEFLATE RFC 1951) inflater and deflater for protocol payloads
+ */
+
+#ifndef GzipCodec_h
+#define GzipCodec_h
+
+#include <Arduino.h>
+#include "AudioMemory.h"
+
+/**
+ * @brief Inflate result codes (negative return values)
+ */
+enum GzipError {
+  GZIP_ERR_HEADER = -1,     // Not a gzip / zlib stream
+  GZIP_ERR_TRUNCATED = -2,  // Input ended inside the stream
+  GZIP_ERR_DATA = -3,       // Invalid block, code or distance
+  GZIP_ERR_CHECKSUM = -4,   // CRC-32 / ISIZE trailer mismatch
+  GZIP_ERR_OVERFLOW = -5,   // Output buffer too small
+  GZIP_ERR_MEMORY = -6      // Window could not be allocated
+};
+
+/**
+ * @class GzipInflater
+ * @brief Decompresses gzip (or zlib) payloads through a 32KB sliding window
+ *
+ * The window is allocated once by begin() and reused for every message, the
+ * Huffman tables live in the object. Output leaves through a callback in
+ * chunks of at most WINDOW_SIZE bytes, so payloads of any size can be decoded
+ * without a buffer for the whole result.
+ * @code
+ * int32_t n = inflater.inflate(payload, len, json, sizeof(json));
+ * if (n >= 0) deserializeJson(doc, json, n);
+ * @endcode
+ */
+class GzipInflater {
+public:
+  /**
+   * @brief Output callback, called with consecutive pieces of the decompressed data
+   */
+  typedef void (*OutputCallback)(const uint8_t* data, size_t len, void* user);
+
+  /**
+   * @brief Constructor
+   */
+  GzipInflater();
+
+  /**
+   * @brief Destructor
+   */
+  ~GzipInflater();
+
+  /**
+   * @brief Allocate the sliding window (PSRAM preferred)
+   * @return Whether allocation succeeded, true if already allocated
+   */
+  bool begin();
+
+  /**
+   * @brief Release the sliding window
+   */
+  void end();
+
+  /**
+   * @brief Decompress a complete gzip or zlib stream
+   * @param in Compressed payload
+   * @param len Payload length
+   * @param output Receives the decompressed data
+   * @param user Passed to output
+   * @return Decompressed size, or a negative GzipError
+   * @note Data already passed to output stays valid output even if an error follows
+   */
+  int32_t inflate(const uint8_t* in, size_t len, OutputCallback output, void* user);
+
+  /**
+   * @brief Decompress a complete gzip or zlib stream into a buffer
+   * @return Decompressed size, or a negative GzipError (GZIP_ERR_OVERFLOW if it does not fit)
+   */
+  int32_t inflate(const uint8_t* in, size_t len, uint8_t* out, size_t outSize);
+
+  /**
+   * @brief Check for the gzip magic bytes
+   */
+  static bool isGzip(const uint8_t* data, size_t len) { return len >= 2 && data[0] == 0x1F && data[1] == 0x8B; }
+
+  static const size_t WINDOW_SIZE = 32768;  ///< DEFLATE maximum distance
+
+private:
+  static const int FAST_BITS = 9;  ///< Codes up to this length are decoded with one table lookup
+
+  /**
+   * @brief Canonical Huffman code (counts per length, symbols in code order) plus lookup table
+   */
+  struct Huffman {
+    uint16_t count[16];
+    uint16_t symbol[288];
+    uint16_t fast[1 << FAST_BITS];  // symbol << 4 | length, 0 for longer codes
+  };
+
+  bool build(Huffman& h, const uint8_t* lengths, int n);   ///< Build a code, false if over-subscribed
+  bool need(int n);                                         ///< Make n bits available, false at end of input
+  uint32_t bits(int n);                                     ///< Take n bits (need() first)
+  int decode(const Huffman& h);                             ///< Next symbol, -1 on error
+  int32_t parseHeader();                                    ///< Skip gzip / zlib header, 0 or error
+  int32_t stored();                                         ///< Copy a stored block
+  int32_t codes();                                          ///< Decode a compressed block with _lencode / _distcode
+  int32_t dynamic();                                        ///< Read dynamic tables, then codes()
+  int32_t fixed();                                          ///< Fixed tables, then codes()
+  void put(uint8_t c);                                      ///< Append to window, flush when full
+  void flush();                                             ///< Pass window data not yet output to the callback
+
+  uint8_t* _window;           ///< Sliding window (WINDOW_SIZE)
+  Huffman _lencode;           ///< Literal / length code of the current block
+  Huffman _distcode;          ///< Distance code of the current block
+  const uint8_t* _in;         ///< Compressed input
+  size_t _inLen;              ///< Input length
+  size_t _inPos;              ///< Next input byte
+  uint32_t _bitBuf;           ///< Bits read but not taken
+  int _bitCnt;                ///< Bits in _bitBuf
+  uint32_t _outPos;           ///< Total bytes produced
+  uint32_t _flushed;          ///< Bytes passed to the callback
+  uint32_t _crc;              ///< CRC-32 of the output (gzip)
+  bool _zlib;                 ///< zlib container instead of gzip
+  OutputCallback _output;     ///< Current callback
+  void* _user;                ///< Current callback argument
+};
+
+/**
+ * @class GzipDeflater
+ * @brief Compresses small payloads (JSON requests) into a gzip stream
+ *
+ * Greedy LZ77 over the input buffer with a single-entry hash table and
+ * fixed Huffman codes: no window copy, one 8KB table allocated by begin().
+ * Good enough for repetitive JSON, where it typically saves half or more.
+ */
+class GzipDeflater {
+public:
+  /**
+   * @brief Constructor
+   */
+  GzipDeflater();
+
+  /**
+   * @brief Destructor
+   */
+  ~GzipDeflater();
+
+  /**
+   * @brief Allocate the hash table
+   * @return Whether allocation succeeded, true if already allocated
+   */
+  bool begin();
+
+  /**
+   * @brief Release the hash table
+   */
+  void end();
+
+  /**
+   * @brief Compress a buffer into a gzip stream
+   * @param in Data to compress, at most MAX_INPUT_LENGTH bytes
+   * @param len Data length
+   * @param out Output buffer
+   * @param outSize Output buffer size
+   * @return Compressed size, 0 if it would not fit in outSize (send uncompressed instead)
+   */
+  size_t compress(const uint8_t* in, size_t len, uint8_t* out, size_t outSize);
+
+  static const size_t MAX_INPUT_LENGTH = 65535;  ///< Positions are kept in 16 bits
+
+private:
+  static const int HASH_BITS = 12;
+
+  bool putBits(uint32_t value, int n);    ///< Append bits LSB first, false when out is full
+  bool putCode(uint32_t code, int n);     ///< Append a Huffman code (MSB first)
+  bool putLiteral(int lit);               ///< Fixed code for a literal / length symbol
+  bool putMatch(int len, int dist);       ///< Length and distance codes with extra bits
+
+  uint16_t* _head;            ///< Last position + 1 for each hash, 0 if none
+  uint8_t* _out;              ///< Output buffer
+  size_t _outSize;            ///< Output buffer size
+  size_t _outPos;             ///< Bytes written
+  uint32_t _bitBuf;           ///< Bits not yet written
+  int _bitCnt;                ///< Bits in _bitBuf
+};
+
+/**
+ * @brief CRC-32 (gzip polynomial), continue with the previous value for consecutive pieces
+ */
+uint32_t gzipCrc32(uint32_t crc, const uint8_t* data, size_t len);
+
+#endif
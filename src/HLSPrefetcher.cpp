@@ -0,0 +1,552 @@
+/**
+ * @file HLSPrefetcher.cpp
+ * @brief HLS segment prefetcher Implementation
+ */
+
+#include "HLSPrefetcher.h"
+
+static char* dupString(const char* s) {
+  size_t len = strlen(s) + 1;
+  char* d = (char*)AudioMemory::alloc(len, AUDIO_MEM_PSRAM_PREFERRED);
+  if (d) {
+    memcpy(d, s, len);
+  }
+  return d;
+}
+
+HLSPrefetcher::HLSPrefetcher()
+  : _depth(0)
+  , _slotCount(0)
+  , _head(0)
+  , _tail(0)
+  , _count(0)
+  , _lock(xSemaphoreCreateMutex())
+  , _task(nullptr)
+  , _running(false)
+  , _stop(false)
+  , _timeoutMs(5000)
+  , _playlistUrl(nullptr)
+  , _playlistText(nullptr)
+  , _playlistWanted(false)
+  , _refreshMs(2000)
+  , _lastRefresh(0)
+  , _conn(nullptr)
+  , _connPort(0)
+{
+  memset(_slots, 0, sizeof(_slots));
+  _connHost[0] = '\0';
+}
+
+HLSPrefetcher::~HLSPrefetcher() {
+  end();
+  vSemaphoreDelete(_lock);
+}
+
+bool HLSPrefetcher::begin(uint8_t depth, const char* playlistUrl, uint32_t timeoutMs) {
+  end();
+  if (depth == 0 || playlistUrl == nullptr) {
+    return false;
+  }
+  _depth = depth > MAX_DEPTH ? MAX_DEPTH : depth;
+  _slotCount = _depth + 1;
+  _head = _tail = _count = 0;
+  _timeoutMs = timeoutMs;
+  _playlistUrl = dupString(playlistUrl);
+  _playlistWanted = false;
+  _lastRefresh = millis();  // the owner has just read the playlist
+  _stop = false;
+  _running = true;
+  if (_playlistUrl != nullptr) {
+    _task = AudioTasks::create(AUDIO_TASK_HLS_PREFETCH, taskWrapper, "HLSPrefetch", this);
+  }
+  if (_task == nullptr) {
+    Serial.println("[HLS] Prefetch task creation failed");
+    _running = false;
+    end();
+    return false;
+  }
+  return true;
+}
+
+void HLSPrefetcher::end() {
+  if (_task != nullptr) {
+    _stop = true;
+    xTaskNotifyGive(_task);
+    while (_running) {
+      vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    _task = nullptr;
+  }
+  closeConnection();
+  for (uint8_t i = 0; i <= MAX_DEPTH; i++) {
+    AudioMemory::release(_slots[i].url);
+    AudioMemory::release(_slots[i].data);
+  }
+  memset(_slots, 0, sizeof(_slots));
+  _head = _tail = _count = 0;
+  _depth = _slotCount = 0;
+  AudioMemory::release(_playlistUrl);
+  AudioMemory::release(_playlistText);
+  _playlistUrl = nullptr;
+  _playlistText = nullptr;
+}
+
+uint8_t HLSPrefetcher::freeSlots() {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  uint8_t n = _slotCount - _count;
+  xSemaphoreGive(_lock);
+  return n;
+}
+
+bool HLSPrefetcher::pending() {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  bool p = _count > 0;
+  xSemaphoreGive(_lock);
+  return p;
+}
+
+bool HLSPrefetcher::queueSegment(const char* url) {
+  if (_task == nullptr || url == nullptr) {
+    return false;
+  }
+  char* copy = dupString(url);
+  if (copy == nullptr) {
+    return false;
+  }
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  if (_count >= _slotCount) {
+    xSemaphoreGive(_lock);
+    AudioMemory::release(copy);
+    return false;
+  }
+  Slot& s = _slots[_tail];
+  s.url = copy;
+  s.size = 0;
+  s.state = SLOT_QUEUED;
+  _tail = (_tail + 1) % _slotCount;
+  _count++;
+  xSemaphoreGive(_lock);
+  xTaskNotifyGive(_task);
+  return true;
+}
+
+bool HLSPrefetcher::takeSegment(Segment& seg) {
+  bool ok = false;
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  while (_count > 0) {
+    Slot& s = _slots[_head];
+    if (s.state == SLOT_FAILED) {  // skip it, the stream goes on with the next one
+      Serial.printf("[HLS] Segment lost: %s\n", s.url);
+      AudioMemory::release(s.url);
+      s.url = nullptr;
+      s.state = SLOT_FREE;
+      _head = (_head + 1) % _slotCount;
+      _count--;
+      continue;
+    }
+    if (s.state == SLOT_READY) {
+      seg.data = s.data;
+      seg.size = s.size;
+      seg.contentType = s.contentType;
+      seg.url = s.url;
+      ok = true;
+    }
+    break;
+  }
+  xSemaphoreGive(_lock);
+  return ok;
+}
+
+void HLSPrefetcher::releaseSegment() {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  if (_count > 0 && _slots[_head].state == SLOT_READY) {
+    Slot& s = _slots[_head];
+    AudioMemory::release(s.url);
+    s.url = nullptr;
+    s.state = SLOT_FREE;
+    _head = (_head + 1) % _slotCount;
+    _count--;
+  }
+  xSemaphoreGive(_lock);
+}
+
+void HLSPrefetcher::setPlaylist(const char* url) {
+  char* copy = url ? dupString(url) : nullptr;
+  if (copy == nullptr) {
+    return;
+  }
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  AudioMemory::release(_playlistUrl);
+  _playlistUrl = copy;
+  xSemaphoreGive(_lock);
+}
+
+void HLSPrefetcher::requestPlaylist() {
+  if (_task != nullptr && !_playlistWanted) {
+    _playlistWanted = true;
+    xTaskNotifyGive(_task);
+  }
+}
+
+char* HLSPrefetcher::takePlaylist() {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  char* text = _playlistText;
+  _playlistText = nullptr;
+  xSemaphoreGive(_lock);
+  return text;
+}
+
+void HLSPrefetcher::taskWrapper(void* param) {
+  static_cast<HLSPrefetcher*>(param)->taskLoop();
+}
+
+void HLSPrefetcher::taskLoop() {
+  while (!_stop) {
+    uint32_t wait = 100;
+    if (_playlistWanted) {
+      uint32_t since = millis() - _lastRefresh;
+      if (since >= _refreshMs) {
+        fetchPlaylist();
+        continue;
+      }
+      wait = _refreshMs - since;
+    }
+
+    // Oldest queued slot first, so segments become ready in play order
+    Slot* next = nullptr;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < _count; i++) {
+      Slot& s = _slots[(_head + i) % _slotCount];
+      if (s.state == SLOT_QUEUED) {
+        s.state = SLOT_FILLING;
+        next = &s;
+        break;
+      }
+    }
+    xSemaphoreGive(_lock);
+
+    if (next != nullptr) {
+      bool ok = fetchSegment(*next);
+      xSemaphoreTake(_lock, portMAX_DELAY);
+      next->state = ok ? SLOT_READY : SLOT_FAILED;
+      xSemaphoreGive(_lock);
+      continue;
+    }
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+  }
+  closeConnection();
+  _running = false;
+  AudioTasks::exit();
+}
+
+bool HLSPrefetcher::fetchSegment(Slot& slot) {
+  // The slot is FILLING, nobody else touches it until the state changes
+  slot.size = 0;
+  slot.contentType[0] = '\0';
+  if (get(slot.url, &slot.data, &slot.capacity, &slot.size, slot.contentType, sizeof(slot.contentType))) {
+    return true;
+  }
+  if (_stop) {
+    return false;
+  }
+  slot.size = 0;  // one retry on a fresh connection
+  closeConnection();
+  return get(slot.url, &slot.data, &slot.capacity, &slot.size, slot.contentType, sizeof(slot.contentType));
+}
+
+bool HLSPrefetcher::fetchPlaylist() {
+  _playlistWanted = false;
+  _lastRefresh = millis();
+
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  char* url = _playlistUrl ? dupString(_playlistUrl) : nullptr;
+  xSemaphoreGive(_lock);
+  if (url == nullptr) {
+    return false;
+  }
+
+  uint8_t* buf = nullptr;
+  size_t capacity = 0;
+  size_t size = 0;
+  char contentType[48];
+  bool ok = get(url, &buf, &capacity, &size, contentType, sizeof(contentType)) &&
+            reserve(&buf, &capacity, size, size + 1);
+  AudioMemory::release(url);
+  if (!ok) {
+    AudioMemory::release(buf);
+    Serial.println("[HLS] Playlist refresh failed");
+    return false;
+  }
+  buf[size] = '\0';
+
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  AudioMemory::release(_playlistText);  // not taken yet, the newer one supersedes it
+  _playlistText = (char*)buf;
+  xSemaphoreGive(_lock);
+  return true;
+}
+
+bool HLSPrefetcher::get(const char* url, uint8_t** buf, size_t* capacity, size_t* size, char* contentType, size_t ctLen) {
+  char location[512];
+  char redirect[sizeof(location)];  // target after a redirect, location is reused for the next response
+  char host[sizeof(_connHost)];
+  char line[512];
+  const char* target = url;
+
+  for (uint8_t redirects = 0; redirects <= MAX_REDIRECTS; redirects++) {
+    // split http(s)://host[:port]/path
+    bool ssl = strncmp(target, "https://", 8) == 0;
+    if (!ssl && strncmp(target, "http://", 7) != 0) {
+      Serial.printf("[HLS] Not an http(s) URL: %s\n", target);
+      return false;
+    }
+    const char* h = target + (ssl ? 8 : 7);
+    const char* path = strchr(h, '/');
+    size_t hostLen = path ? (size_t)(path - h) : strlen(h);
+    if (hostLen == 0 || hostLen >= sizeof(host)) {
+      return false;
+    }
+    memcpy(host, h, hostLen);
+    host[hostLen] = '\0';
+    uint16_t port = ssl ? 443 : 80;
+    char* colon = strchr(host, ':');
+    if (colon) {
+      port = atoi(colon + 1);
+      *colon = '\0';
+    }
+    if (path == nullptr) {
+      path = "/";
+    }
+
+    // A kept-alive connection may have been closed by the server meanwhile, then try once on a new one
+    bool statusOk = false;
+    for (uint8_t attempt = 0; attempt < 2 && !statusOk; attempt++) {
+      bool reused = _conn != nullptr && _conn->connected() && _connPort == port &&
+                    (_conn == &_secure) == ssl && strcmp(_connHost, host) == 0;
+      Client_t* c = connect(host, port, ssl);
+      if (c == nullptr) {
+        return false;
+      }
+      c->printf("GET %s HTTP/1.1\r\nHost: %s\r\nAccept: */*\r\nUser-Agent: VLC/3.0.21 LibVLC/3.0.21\r\n"
+                "Accept-Encoding: identity;q=1,*;q=0\r\nConnection: keep-alive\r\n\r\n", path, host);
+      statusOk = readLine(line, sizeof(line));
+      if (!statusOk) {
+        closeConnection();
+        if (!reused || _stop) {
+          return false;
+        }
+      }
+    }
+    if (!statusOk) {
+      return false;
+    }
+    int status = strncmp(line, "HTTP/", 5) == 0 && strchr(line, ' ') ? atoi(strchr(line, ' ') + 1) : 0;
+
+    int32_t length = -1;
+    bool chunked = false;
+    bool close = false;
+    location[0] = '\0';
+    contentType[0] = '\0';
+    while (true) {
+      if (!readLine(line, sizeof(line))) {
+        closeConnection();
+        return false;
+      }
+      if (line[0] == '\0') {
+        break;  // end of header
+      }
+      char* colonPos = strchr(line, ':');
+      if (colonPos == nullptr) {
+        continue;
+      }
+      *colonPos = '\0';
+      char* value = colonPos + 1;
+      while (*value == ' ') value++;
+      if (!strcasecmp(line, "content-length")) {
+        length = atol(value);
+      } else if (!strcasecmp(line, "transfer-encoding")) {
+        chunked = strcasestr(value, "chunked") != nullptr;
+      } else if (!strcasecmp(line, "connection")) {
+        close = strcasestr(value, "close") != nullptr;
+      } else if (!strcasecmp(line, "content-type")) {
+        size_t n = strcspn(value, "; ");
+        if (n >= ctLen) n = ctLen - 1;
+        memcpy(contentType, value, n);
+        contentType[n] = '\0';
+      } else if (!strcasecmp(line, "location")) {
+        strlcpy(location, value, sizeof(location));
+      }
+    }
+
+    if (status >= 300 && status < 400 && location[0]) {
+      closeConnection();  // the body of a redirect is not needed
+      if (strncmp(location, "http", 4) != 0) {
+        Serial.printf("[HLS] Relative redirect not supported: %s\n", location);
+        return false;
+      }
+      strlcpy(redirect, location, sizeof(redirect));
+      target = redirect;
+      continue;
+    }
+
+    if (status != 200) {
+      Serial.printf("[HLS] HTTP %d for %s\n", status, target);
+      closeConnection();
+      return false;
+    }
+
+    *size = 0;
+    bool ok = readBody(buf, capacity, size, length, chunked);
+    if (!ok || close || (length < 0 && !chunked)) {
+      closeConnection();
+    }
+    return ok;
+  }
+  Serial.println("[HLS] Too many redirects");
+  return false;
+}
+
+HLSPrefetcher::Client_t* HLSPrefetcher::connect(const char* host, uint16_t port, bool ssl) {
+  if (_conn != nullptr && _conn->connected() && _connPort == port && (_conn == &_secure) == ssl &&
+      strcmp(_connHost, host) == 0) {
+    return _conn;  // keep-alive
+  }
+  closeConnection();
+  Client_t* c = &_plain;
+  if (ssl) {
+    _secure.setInsecure();
+    c = static_cast<Client_t*>(&_secure);
+  }
+  c->setTimeout(_timeoutMs);
+  if (!c->connect(host, port, _timeoutMs)) {
+    Serial.printf("[HLS] Connect to %s:%u failed\n", host, (unsigned)port);
+    return nullptr;
+  }
+  _conn = c;
+  strlcpy(_connHost, host, sizeof(_connHost));
+  _connPort = port;
+  return c;
+}
+
+void HLSPrefetcher::closeConnection() {
+  if (_conn != nullptr) {
+    _conn->stop();
+    _conn = nullptr;
+  }
+  _connHost[0] = '\0';
+}
+
+bool HLSPrefetcher::readLine(char* line, size_t len) {
+  // Line without CR LF, longer lines are cut
+  size_t pos = 0;
+  uint32_t last = millis();
+  while (!_stop) {
+    if (_conn->available()) {
+      int b = _conn->read();
+      last = millis();
+      if (b < 0) continue;
+      if (b == '\n') {
+        line[pos] = '\0';
+        return true;
+      }
+      if (b != '\r' && pos < len - 1) {
+        line[pos++] = (char)b;
+      }
+    } else if (!_conn->connected() || millis() - last > _timeoutMs) {
+      return false;
+    } else {
+      vTaskDelay(1);
+    }
+  }
+  return false;
+}
+
+size_t HLSPrefetcher::readFully(uint8_t* dst, size_t len) {
+  size_t got = 0;
+  uint32_t last = millis();
+  while (got < len && !_stop) {
+    int avail = _conn->available();
+    if (avail > 0) {
+      size_t want = len - got < (size_t)avail ? len - got : (size_t)avail;
+      int n = _conn->read(dst + got, want);
+      if (n > 0) {
+        got += n;
+        last = millis();
+      }
+    } else if (!_conn->connected() || millis() - last > _timeoutMs) {
+      break;
+    } else {
+      vTaskDelay(1);
+    }
+  }
+  return got;
+}
+
+bool HLSPrefetcher::reserve(uint8_t** buf, size_t* capacity, size_t used, size_t need) {
+  if (need <= *capacity) {
+    return true;
+  }
+  if (need > MAX_SEGMENT + 1) {
+    Serial.printf("[HLS] Body of %u bytes too large\n", (unsigned)need);
+    return false;
+  }
+  size_t cap = *capacity * 2;
+  if (cap < need) cap = need;
+  cap = (cap + 16383) & ~(size_t)16383;
+  uint8_t* p = (uint8_t*)AudioMemory::alloc(cap, AUDIO_MEM_PSRAM_PREFERRED);
+  if (p == nullptr) {
+    Serial.printf("[HLS] Out of memory for %u bytes\n", (unsigned)cap);
+    return false;
+  }
+  if (used > 0) {
+    memcpy(p, *buf, used);
+  }
+  AudioMemory::release(*buf);
+  *buf = p;
+  *capacity = cap;
+  return true;
+}
+
+bool HLSPrefetcher::readBody(uint8_t** buf, size_t* capacity, size_t* size, int32_t length, bool chunked) {
+  if (chunked) {
+    char line[32];
+    while (true) {
+      if (!readLine(line, sizeof(line))) {
+        return false;
+      }
+      size_t chunk = strtoul(line, nullptr, 16);
+      if (chunk == 0) {
+        while (readLine(line, sizeof(line)) && line[0] != '\0') {}  // trailer
+        return true;
+      }
+      if (!reserve(buf, capacity, *size, *size + chunk) || readFully(*buf + *size, chunk) != chunk) {
+        return false;
+      }
+      *size += chunk;
+      if (!readLine(line, sizeof(line))) {  // CR LF after the chunk
+        return false;
+      }
+    }
+  }
+
+  if (length >= 0) {
+    if (!reserve(buf, capacity, 0, length)) {
+      return false;
+    }
+    *size = readFully(*buf, length);
+    return *size == (size_t)length;
+  }
+
+  // Neither length nor chunks, the body ends when the server closes
+  while (!_stop) {
+    if (!reserve(buf, capacity, *size, *size + 16384)) {
+      return false;
+    }
+    size_t n = readFully(*buf + *size, *capacity - *size);
+    *size += n;
+    if (n == 0 || (!_conn->connected() && !_conn->available())) {
+      return *size > 0;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file HLSPrefetcher.h
+ * @brief HLS segment prefetcher - downloads media segments and playlist refreshes in a background task
+ */
+
+#ifndef HLSPrefetcher_h
+#define HLSPrefetcher_h
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+#include "AudioMemory.h"
+#include "AudioTasks.h"
+
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+#include <NetworkClient.h>
+#include <NetworkClientSecure.h>
+#endif
+
+/**
+ * @class HLSPrefetcher
+ * @brief Keeps the next media segments of an HLS stream downloaded into PSRAM
+ *
+ * The owner hands in segment URLs in play order with queueSegment(). A task
+ * keeps depth() segments ahead of the one the owner decodes: it fetches them one after the other into slot
+ * buffers over a keep-alive connection (one plain, one TLS, reconnected only
+ * when the host changes or the server closed), while the owner decodes the
+ * segment it took with takeSegment(). Playlist refreshes requested with
+ * requestPlaylist() run in the same task, between segments, at most once per
+ * refresh interval; the text is picked up with takePlaylist() and parsed by
+ * the owner.
+ *
+ * Bodies are stored de-chunked. All methods except begin() and end() are
+ * safe while the task runs; begin() and end() belong to the owner's task.
+ */
+class HLSPrefetcher {
+public:
+  static const uint8_t MAX_DEPTH = 4;   ///< Segments ahead at most
+
+#ifndef ETHERNET_IF
+  typedef WiFiClient Client_t;
+  typedef WiFiClientSecure SecureClient_t;
+#else
+  typedef NetworkClient Client_t;
+  typedef NetworkClientSecure SecureClient_t;
+#endif
+
+  /**
+   * @brief Downloaded segment, valid until releaseSegment()
+   */
+  struct Segment {
+    const uint8_t* data;        ///< Body
+    size_t size;                ///< Body length
+    const char* contentType;    ///< Content-Type without parameters, may be empty
+    const char* url;            ///< Segment URL
+  };
+
+  /**
+   * @brief Constructor
+   */
+  HLSPrefetcher();
+
+  /**
+   * @brief Destructor
+   */
+  ~HLSPrefetcher();
+
+  /**
+   * @brief Start the fetch task
+   * @param depth Segments downloaded ahead, 1 to MAX_DEPTH
+   * @param playlistUrl Media playlist fetched by requestPlaylist()
+   * @param timeoutMs Connect and read timeout
+   * @return Whether the task could be created
+   * @note The task is scheduled as AUDIO_TASK_HLS_PREFETCH, see AudioTasks
+   */
+  bool begin(uint8_t depth, const char* playlistUrl, uint32_t timeoutMs = 5000);
+
+  /**
+   * @brief Stop the task, close the connections and free the slots
+   * @note Waits for a running request to notice, at most one timeout
+   */
+  void end();
+
+  /**
+   * @brief Check if the task runs
+   */
+  bool active() const { return _task != nullptr; }
+
+  /**
+   * @brief Get the number of segments downloaded ahead
+   */
+  uint8_t depth() const { return _depth; }
+
+  /**
+   * @brief Get the number of slots that can take a URL (depth() + 1 with the one being decoded)
+   */
+  uint8_t freeSlots();
+
+  /**
+   * @brief Queue the next segment in play order
+   * @return false if all slots are in use
+   */
+  bool queueSegment(const char* url);
+
+  /**
+   * @brief Get the oldest segment once it is downloaded
+   * @param seg Filled on success, failed downloads are skipped
+   * @return false if the next segment is still being fetched (or none is queued)
+   */
+  bool takeSegment(Segment& seg);
+
+  /**
+   * @brief Hand the segment from takeSegment() back, its slot takes the next URL
+   */
+  void releaseSegment();
+
+  /**
+   * @brief Check if segments are queued or downloaded but not yet taken
+   */
+  bool pending();
+
+  /**
+   * @brief Set the media playlist URL (after a variant redirection)
+   */
+  void setPlaylist(const char* url);
+
+  /**
+   * @brief Set the shortest time between two playlist fetches (default 2000ms)
+   */
+  void setRefreshInterval(uint32_t ms) { _refreshMs = ms; }
+
+  /**
+   * @brief Fetch the playlist again, once the refresh interval has passed
+   */
+  void requestPlaylist();
+
+  /**
+   * @brief Get a refreshed playlist
+   * @return Null-terminated text, release with AudioMemory::release(), or nullptr if none arrived
+   */
+  char* takePlaylist();
+
+private:
+  enum SlotState : uint8_t { SLOT_FREE, SLOT_QUEUED, SLOT_FILLING, SLOT_READY, SLOT_FAILED };
+
+  struct Slot {
+    char* url;                  ///< Segment URL, set while not free
+    uint8_t* data;              ///< Body buffer, kept for the next segment
+    size_t capacity;            ///< Size of data
+    size_t size;                ///< Body length
+    char contentType[48];       ///< Content-Type of the response
+    volatile SlotState state;
+  };
+
+  static const size_t MAX_SEGMENT = 4 * 1024 * 1024;   ///< Larger bodies are refused
+  static const uint8_t MAX_REDIRECTS = 3;
+
+  Slot _slots[MAX_DEPTH + 1];
+  uint8_t _depth;               ///< Segments ahead
+  uint8_t _slotCount;           ///< _depth + the segment being decoded
+  uint8_t _head;                ///< Next slot to take, in play order
+  uint8_t _tail;                ///< Next slot to queue
+  uint8_t _count;               ///< Slots not free
+  SemaphoreHandle_t _lock;      ///< Guards slot states, playlist URL and text
+  TaskHandle_t _task;
+  volatile bool _running;       ///< Task has not yet left its loop
+  volatile bool _stop;          ///< end() asks the task to quit
+  uint32_t _timeoutMs;
+
+  char* _playlistUrl;           ///< Media playlist
+  char* _playlistText;          ///< Fetched, not yet taken
+  volatile bool _playlistWanted;
+  uint32_t _refreshMs;
+  uint32_t _lastRefresh;        ///< millis() of the last playlist fetch
+
+  Client_t _plain;              ///< Keep-alive connection, http
+  SecureClient_t _secure;       ///< Keep-alive connection, https
+  Client_t* _conn;              ///< The one that is connected
+  char _connHost[128];          ///< Host of _conn
+  uint16_t _connPort;
+
+  static void taskWrapper(void* param);
+  void taskLoop();
+  bool fetchSegment(Slot& slot);
+  bool fetchPlaylist();
+  bool get(const char* url, uint8_t** buf, size_t* capacity, size_t* size, char* contentType, size_t ctLen);
+  Client_t* connect(const char* host, uint16_t port, bool ssl);
+  bool readLine(char* line, size_t len);
+  bool readBody(uint8_t** buf, size_t* capacity, size_t* size, int32_t length, bool chunked);
+  bool reserve(uint8_t** buf, size_t* capacity, size_t used, size_t need);
+  size_t readFully(uint8_t* dst, size_t len);
+  void closeConnection();
+};
+
+#endif
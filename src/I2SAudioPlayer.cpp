@@ -12,6 +12,8 @@ I2SAudioPlayer::I2SAudioPlayer()
   , _isPlaying(false)
   , _initialized(false)
   , _sampleRate(24000)
+  , _sourceRate(0)
+  , _quality(RESAMPLE_MEDIUM)
 {
 }
 
@@ -30,8 +32,8 @@ bool I2SAudioPlayer::init(int bclk, int lrc, int dout, int sample_rate) {
   // Create I2S channel configuration
   i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_1, I2S_ROLE_MASTER);
   chan_cfg.auto_clear = true;
-  chan_cfg.dma_desc_num = 8;
-  chan_cfg.dma_frame_num = 1024;
+  chan_cfg.dma_desc_num = DMA_DESC_NUM;
+  chan_cfg.dma_frame_num = DMA_FRAME_NUM;
   
   // Create new I2S TX channel
   esp_err_t err = i2s_new_channel(&chan_cfg, &_tx_handle, NULL);
@@ -77,10 +79,34 @@ bool I2SAudioPlayer::init(int bclk, int lrc, int dout, int sample_rate) {
   _initialized = true;
   Serial.printf("[I2S] Initialized successfully (BCLK=%d, LRC=%d, DOUT=%d, SR=%d)\n",
                 bclk, lrc, dout, _sampleRate);
+
+  if (_sourceRate != 0) {
+    setSourceRate(_sourceRate, _quality);
+  }
   
   return true;
 }
 
+bool I2SAudioPlayer::setSourceRate(int rate, ResampleQuality quality) {
+  _sourceRate = rate > 0 ? rate : 0;
+  _quality = quality;
+  if (!_initialized) {
+    return true;  // Applied in init(), once the output rate is known
+  }
+
+  if (_sourceRate == 0 || _sourceRate == _sampleRate) {
+    _resampler.end();
+    return true;
+  }
+  if (!_resampler.begin(_sourceRate, _sampleRate, 1, quality)) {
+    Serial.printf("[I2S] Resampler %d -> %d Hz failed\n", _sourceRate, _sampleRate);
+    return false;
+  }
+  _resampler.reset();
+  Serial.printf("[I2S] Resampling %d -> %d Hz\n", _sourceRate, _sampleRate);
+  return true;
+}
+
 size_t I2SAudioPlayer::play(const uint8_t* data, size_t len) {
   if (!_initialized || _tx_handle == NULL) {
     Serial.println("[I2S] Not initialized!");
@@ -91,6 +117,10 @@ size_t I2SAudioPlayer::play(const uint8_t* data, size_t len) {
     return 0;
   }
   
+  if (_resampler.converting()) {
+    return _resampler.processTo((const int16_t*)data, len / 2, writeResampled, this) * 2;
+  }
+  
   size_t bytes_written = 0;
   // Use shorter timeout (100ms) to avoid blocking WebSocket heartbeat
   esp_err_t err = i2s_channel_write(_tx_handle, data, len, &bytes_written, pdMS_TO_TICKS(100));
@@ -106,6 +136,17 @@ size_t I2SAudioPlayer::play(const uint8_t* data, size_t len) {
   return bytes_written;
 }
 
+size_t I2SAudioPlayer::writeResampled(const int16_t* frames, size_t count, void* user) {
+  I2SAudioPlayer* player = static_cast<I2SAudioPlayer*>(user);
+  size_t bytes_written = 0;
+  esp_err_t err = i2s_channel_write(player->_tx_handle, frames, count * 2, &bytes_written, pdMS_TO_TICKS(100));
+  if (err != ESP_OK && err != ESP_ERR_TIMEOUT) {
+    Serial.printf("[I2S] Write failed: %d\n", err);
+    return 0;
+  }
+  return bytes_written / 2;  // Short: DMA stalled for 100ms
+}
+
 void I2SAudioPlayer::stop() {
   if (!_initialized || _tx_handle == NULL) {
     return;
@@ -121,6 +162,27 @@ void I2SAudioPlayer::stop() {
   Serial.println("[I2S] Stopped");
 }
 
+void I2SAudioPlayer::flush() {
+  if (!_initialized || _tx_handle == NULL) {
+    return;
+  }
+  
+  // Disabled channel restarts from the first descriptor, overwrite all queued samples with silence
+  i2s_channel_disable(_tx_handle);
+  uint8_t zero_buf[256] = {0};
+  size_t bytes_loaded;
+  do {
+    bytes_loaded = 0;
+    if (i2s_channel_preload_data(_tx_handle, zero_buf, sizeof(zero_buf), &bytes_loaded) != ESP_OK) {
+      break;
+    }
+  } while (bytes_loaded == sizeof(zero_buf));
+  i2s_channel_enable(_tx_handle);
+  _resampler.reset();
+  
+  _isPlaying = false;
+}
+
 void I2SAudioPlayer::deinit() {
   if (!_initialized || _tx_handle == NULL) {
     return;
@@ -11,6 +11,7 @@
 #include <Arduino.h>
 #include <driver/i2s_std.h>
 #include <driver/gpio.h>
+#include "AudioResampler.h"
 
 /**
  * @class I2SAudioPlayer
@@ -18,6 +19,7 @@
  * 
  * Supports playing PCM format audio data (16-bit, 24kHz sample rate, mono)
  * Uses I2S_NUM_1 port to avoid conflict with microphone (I2S_NUM_0)
+ * Sources at another rate are resampled, see setSourceRate()
  */
 class I2SAudioPlayer {
 public:
@@ -40,12 +42,26 @@ public:
    * @return true if initialization successful, false if failed
    */
   bool init(int bclk, int lrc, int dout, int sample_rate = 24000);
+
+  /**
+   * @brief Set the sample rate of the data passed to play()
+   * @param rate Source rate in Hz, resampled to the I2S rate (0 or the I2S rate: no conversion)
+   * @param quality Resampling quality
+   * @return false if the resampler could not be allocated (data then plays unconverted)
+   * @note I2S keeps its rate, switching sources needs no reconfiguration
+   */
+  bool setSourceRate(int rate, ResampleQuality quality = RESAMPLE_MEDIUM);
+
+  /**
+   * @brief Get the I2S output sample rate
+   */
+  int getSampleRate() const { return _sampleRate; }
   
   /**
    * @brief Play PCM audio data
    * @param data PCM data pointer
    * @param len Data length (bytes)
-   * @return Actual bytes written
+   * @return Actual bytes written (consumed at the source rate when resampling)
    */
   size_t play(const uint8_t* data, size_t len);
   
@@ -53,12 +69,24 @@ public:
    * @brief Stop playback and clear buffer
    */
   void stop();
+
+  /**
+   * @brief Drop audio still queued in DMA so the speaker goes silent at once
+   * @note Call from the task that writes with play()
+   */
+  void flush();
   
   /**
    * @brief Check if currently playing
    * @return true if playing, false if not playing
    */
   bool isPlaying() const { return _isPlaying; }
+
+  /**
+   * @brief Get audio held in the DMA ring once it is full
+   * @return Worst-case time (ms) between a write returning and the samples reaching the DAC
+   */
+  uint32_t getBufferLatencyMs() const { return (DMA_DESC_NUM * DMA_FRAME_NUM * 1000UL) / _sampleRate; }
   
   /**
    * @brief Unload I2S driver
@@ -66,10 +94,18 @@ public:
   void deinit();
 
 private:
+  static const uint32_t DMA_DESC_NUM = 8;      ///< Number of DMA descriptors
+  static const uint32_t DMA_FRAME_NUM = 1024;  ///< Frames per DMA descriptor
+
   i2s_chan_handle_t _tx_handle;  ///< I2S transmit channel handle
   bool _isPlaying;               ///< Playback status flag
   bool _initialized;             ///< Initialization status flag
   int _sampleRate;               ///< Sample rate
+  int _sourceRate;               ///< Rate of the data passed to play(), 0: same as _sampleRate
+  ResampleQuality _quality;      ///< Resampling quality
+  AudioResampler _resampler;     ///< _sourceRate -> _sampleRate
+
+  static size_t writeResampled(const int16_t* frames, size_t count, void* user);  ///< AudioResampler sink
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,301 @@
+/**
+ * @file StreamDecoder.cpp
+ * @brief Incremental MP3 / Ogg Opus decoder Implementation
+ */
+
+#include "StreamDecoder.h"
+#include "mp3_decoder/mp3_decoder.h"
+#include "opus_decoder/opus_decoder.h"
+
+StreamDecoder::StreamDecoder()
+  : _codec(STREAM_CODEC_PCM)
+  , _ctx(nullptr)
+  , _in(nullptr)
+  , _inLen(0)
+  , _out(nullptr)
+  , _synced(false)
+  , _pageLeft(0)
+  , _opusContinue(false)
+  , _sampleRate(0)
+  , _errors(0)
+{
+}
+
+StreamDecoder::~StreamDecoder() {
+  end();
+}
+
+bool StreamDecoder::begin(StreamCodec codec) {
+  end();
+  if (codec == STREAM_CODEC_PCM) {
+    return true;
+  }
+
+  _in = (uint8_t*)AudioMemory::alloc(INPUT_SIZE, AUDIO_MEM_INTERNAL_PREFERRED);
+  _out = (int16_t*)AudioMemory::alloc(OUTPUT_SAMPLES * sizeof(int16_t), AUDIO_MEM_INTERNAL_PREFERRED);
+  if (_in == nullptr || _out == nullptr) {
+    Serial.println("StreamDecoder: buffer allocation failed");
+    end();
+    return false;
+  }
+
+  // Allocate the decoder buffers in the new context, then give the caller its own context back
+  bool ok = false;
+  if (codec == STREAM_CODEC_MP3) {
+    MP3Decoder_t* ctx = MP3Decoder_CreateContext();
+    if (ctx != nullptr) {
+      MP3Decoder_t* prev = MP3Decoder_GetContext();
+      MP3Decoder_SetContext(ctx);
+      ok = MP3Decoder_AllocateBuffers();
+      MP3Decoder_SetContext(prev);
+      _ctx = ctx;
+    }
+  } else {
+    OPUSDecoder_t* ctx = OPUSDecoder_CreateContext();
+    if (ctx != nullptr) {
+      OPUSDecoder_t* prev = OPUSDecoder_GetContext();
+      OPUSDecoder_SetContext(ctx);
+      ok = OPUSDecoder_AllocateBuffers();
+      OPUSDecoder_SetContext(prev);
+      _ctx = ctx;
+    }
+  }
+  _codec = codec;
+
+  if (!ok) {
+    Serial.printf("StreamDecoder: %s decoder could not be initialized\n", codec == STREAM_CODEC_MP3 ? "MP3" : "Opus");
+    end();
+    return false;
+  }
+  _inLen = 0;
+  _synced = false;
+  _pageLeft = 0;
+  _opusContinue = false;
+  _sampleRate = 0;
+  _errors = 0;
+  return true;
+}
+
+void StreamDecoder::end() {
+  if (_ctx != nullptr) {
+    if (_codec == STREAM_CODEC_MP3) {
+      MP3Decoder_DestroyContext((MP3Decoder_t*)_ctx);
+    } else {
+      OPUSDecoder_DestroyContext((OPUSDecoder_t*)_ctx);
+    }
+    _ctx = nullptr;
+  }
+  if (_in != nullptr) {
+    AudioMemory::release(_in);
+    _in = nullptr;
+  }
+  if (_out != nullptr) {
+    AudioMemory::release(_out);
+    _out = nullptr;
+  }
+  _codec = STREAM_CODEC_PCM;
+  _inLen = 0;
+}
+
+void StreamDecoder::bindContext() {
+  if (_codec == STREAM_CODEC_MP3) {
+    MP3Decoder_SetContext((MP3Decoder_t*)_ctx);
+  } else {
+    OPUSDecoder_SetContext((OPUSDecoder_t*)_ctx);
+  }
+}
+
+void StreamDecoder::reset() {
+  if (_ctx == nullptr) {
+    return;
+  }
+  bindContext();
+  if (_codec == STREAM_CODEC_MP3) {
+    MP3Decoder_ClearBuffer();
+  } else {
+    OPUSDecoder_ClearBuffers();
+    OPUSsetDefaults();  // Expect OpusHead again
+  }
+  _inLen = 0;
+  _synced = false;
+  _pageLeft = 0;
+  _opusContinue = false;
+}
+
+void StreamDecoder::fill(AudioRingBuffer& in) {
+  while (_inLen < INPUT_SIZE) {
+    size_t len;
+    const uint8_t* src = in.readSpan(len);
+    if (len == 0) {
+      break;
+    }
+    len = min(len, INPUT_SIZE - _inLen);
+    memcpy(_in + _inLen, src, len);
+    in.commitRead(len);
+    _inLen += len;
+  }
+}
+
+void StreamDecoder::consume(size_t len) {
+  if (len >= _inLen) {
+    _inLen = 0;
+    return;
+  }
+  memmove(_in, _in + len, _inLen - len);
+  _inLen -= len;
+}
+
+bool StreamDecoder::resync() {
+  int32_t offset = (_codec == STREAM_CODEC_MP3) ? MP3FindSyncWord(_in, _inLen) : OPUSFindSyncWord(_in, _inLen);
+  if (offset < 0) {
+    // Keep a possible partial sync word at the end
+    consume(_inLen > 3 ? _inLen - 3 : 0);
+    return false;
+  }
+  consume(offset);
+  _synced = true;
+  return true;
+}
+
+int32_t StreamDecoder::oggPageSize() const {
+  // RFC 3533: 27 byte header, segment table, then the segments
+  if (_inLen < 27) {
+    return 0;
+  }
+  if (memcmp(_in, "OggS", 4) != 0) {
+    return -1;
+  }
+  uint8_t segments = _in[26];
+  if (_inLen < 27 + (size_t)segments) {
+    return 0;
+  }
+  size_t size = 27 + segments;
+  for (uint8_t i = 0; i < segments; i++) {
+    size += _in[27 + i];
+  }
+  if (size > INPUT_SIZE) {
+    return -1;  // Cannot be staged, skip it
+  }
+  return size <= _inLen ? (int32_t)size : 0;
+}
+
+size_t StreamDecoder::toMono(int16_t* pcm, size_t samples, int channels) {
+  if (channels == 2) {
+    for (size_t i = 0; i < samples; i++) {
+      pcm[i] = (int16_t)(((int32_t)pcm[2 * i] + pcm[2 * i + 1]) >> 1);
+    }
+  }
+  return samples;
+}
+
+size_t StreamDecoder::decodeMP3(bool flush) {
+  if (_inLen < 64 && !flush) {
+    return 0;  // Header and side info not complete yet
+  }
+  int32_t left = _inLen;
+  int32_t ret = MP3Decode(_in, &left, _out, 0);
+
+  if (ret == ERR_MP3_INDATA_UNDERFLOW) {
+    // Frame not complete yet, nothing was consumed
+    if (flush) {
+      _inLen = 0;  // Truncated last frame
+    }
+    return 0;
+  }
+  if (ret < 0) {
+    // MAINDATA_UNDERFLOW is expected for the first frames after a sync, the rest is corruption
+    if (ret != ERR_MP3_MAINDATA_UNDERFLOW) {
+      _errors++;
+      _synced = false;
+      consume(1);
+      return 0;
+    }
+    consume(_inLen - left);
+    return 0;
+  }
+  if (left == (int32_t)_inLen) {
+    // Frame size 0: false sync word, skip it
+    _synced = false;
+    consume(1);
+    return 0;
+  }
+  consume(_inLen - left);
+
+  int channels = MP3GetChannels();
+  _sampleRate = MP3GetSampRate();
+  return toMono(_out, MP3GetOutputSamps() / channels, channels);
+}
+
+size_t StreamDecoder::decodeOpus(bool flush) {
+  if (_pageLeft == 0 && !_opusContinue) {
+    int32_t size = oggPageSize();
+    if (size < 0) {
+      _errors++;
+      _synced = false;
+      consume(1);
+      return 0;
+    }
+    if (size == 0) {
+      if (flush) {
+        _inLen = 0;  // Truncated last page
+      }
+      return 0;
+    }
+    if (_in[5] & 0x02) {
+      // Beginning of a new logical stream (e.g. next reply): start over at OpusHead
+      OPUSDecoder_ClearBuffers();
+      OPUSsetDefaults();
+    }
+    _pageLeft = size;
+  }
+
+  int32_t left = _pageLeft;
+  int32_t ret = OPUSDecode(_in, &left, _out);
+  consume(_pageLeft - left);
+  _pageLeft = left;
+  _opusContinue = (ret == OPUS_CONTINUE);
+
+  if (ret < 0) {
+    // Skip the rest of this page and continue with the next one
+    _errors++;
+    consume(_pageLeft);
+    _pageLeft = 0;
+    _opusContinue = false;
+    OPUSDecoder_ClearBuffers();
+    return 0;
+  }
+  if (ret == OPUS_PARSE_OGG_DONE) {
+    return 0;  // Header or comment, no audio
+  }
+
+  _sampleRate = OPUSGetSampRate();
+  return toMono(_out, OPUSGetOutputSamps(), OPUSGetChannels());
+}
+
+size_t StreamDecoder::decode(AudioRingBuffer& in, bool flush) {
+  if (_ctx == nullptr) {
+    return 0;
+  }
+  bindContext();
+  fill(in);
+
+  // A few attempts per call: headers and resyncs produce no samples
+  for (int attempt = 0; attempt < 4 && _inLen > 0; attempt++) {
+    if (!_synced && !resync()) {
+      if (flush) {
+        _inLen = 0;
+      }
+      return 0;
+    }
+    size_t staged = _inLen;
+    size_t samples = (_codec == STREAM_CODEC_MP3) ? decodeMP3(flush) : decodeOpus(flush);
+    if (samples > 0) {
+      return samples;
+    }
+    if (_inLen == staged && !_opusContinue) {
+      return 0;  // Waiting for more input
+    }
+    fill(in);
+  }
+  return 0;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file StreamDecoder.h
+ * @brief Incremental MP3 / Ogg Opus decoder fed from an AudioRingBuffer
+ */
+
+#ifndef StreamDecoder_h
+#define StreamDecoder_h
+
+#include <Arduino.h>
+#include "AudioMemory.h"
+#include "AudioRingBuffer.h"
+
+/**
+ * @brief Compressed format carried by a TTS stream
+ */
+enum StreamCodec {
+  STREAM_CODEC_PCM,   // Raw 16-bit PCM, no decoder needed
+  STREAM_CODEC_MP3,   // MPEG-1/2 layer 3 frames
+  STREAM_CODEC_OPUS   // Opus in an Ogg container
+};
+
+/**
+ * @class StreamDecoder
+ * @brief Turns compressed bytes from a jitter ring into mono PCM frames
+ *
+ * Owns its own decoder context, so it can run next to Audio or another
+ * StreamDecoder. All calls except begin()/end() must come from the task that
+ * drains the ring, since the decoders bind their state to the calling task.
+ * @code
+ * size_t n = dec.decode(ring, streamEnded);
+ * if (n > 0) i2s.write((const uint8_t*)dec.pcm(), n * 2);
+ * @endcode
+ */
+class StreamDecoder {
+public:
+  /**
+   * @brief Constructor
+   */
+  StreamDecoder();
+
+  /**
+   * @brief Destructor
+   */
+  ~StreamDecoder();
+
+  /**
+   * @brief Create the decoder context and buffers
+   * @param codec STREAM_CODEC_MP3 or STREAM_CODEC_OPUS
+   * @return Whether allocation succeeded
+   */
+  bool begin(StreamCodec codec);
+
+  /**
+   * @brief Release the decoder context and buffers
+   */
+  void end();
+
+  /**
+   * @brief Start a new stream: drop staged input and decoder state (consumer)
+   */
+  void reset();
+
+  /**
+   * @brief Decode the next frame (consumer)
+   * @param in Ring holding compressed bytes
+   * @param flush No more data will arrive, decode or drop what is staged
+   * @return Mono samples available through pcm(), 0 if more input is needed
+   */
+  size_t decode(AudioRingBuffer& in, bool flush);
+
+  /**
+   * @brief Get the samples of the last decoded frame
+   */
+  const int16_t* pcm() const { return _out; }
+
+  /**
+   * @brief Get compressed bytes taken from the ring but not yet decoded
+   */
+  size_t pending() const { return _inLen; }
+
+  /**
+   * @brief Get output sample rate of the stream (0 before the first frame)
+   */
+  uint32_t sampleRate() const { return _sampleRate; }
+
+  /**
+   * @brief Get the codec passed to begin()
+   */
+  StreamCodec codec() const { return _codec; }
+
+  /**
+   * @brief Get number of frames skipped because of decode errors
+   */
+  uint32_t errors() const { return _errors; }
+
+  static const size_t INPUT_SIZE = 8192;          ///< Staging buffer size, also the largest Ogg page accepted
+  static const size_t OUTPUT_SAMPLES = 2880 * 2;  ///< One 60 ms stereo Opus frame at 48 kHz
+
+private:
+  void bindContext();                    ///< Bind the decoder context to the calling task
+  void fill(AudioRingBuffer& in);        ///< Top up the staging buffer from the ring
+  void consume(size_t len);              ///< Drop bytes from the front of the staging buffer
+  bool resync();                         ///< Move to the next sync word, false if none staged
+  int32_t oggPageSize() const;           ///< Size of the staged page, 0 if incomplete, -1 if not a page
+  size_t decodeMP3(bool flush);          ///< Decode one MP3 frame
+  size_t decodeOpus(bool flush);         ///< Decode one Opus frame
+  size_t toMono(int16_t* pcm, size_t samples, int channels);  ///< Downmix interleaved stereo in place
+
+  StreamCodec _codec;     ///< Stream format
+  void* _ctx;             ///< MP3Decoder_t* or OPUSDecoder_t*
+  uint8_t* _in;           ///< Staging buffer (compressed bytes, linear)
+  size_t _inLen;          ///< Bytes staged
+  int16_t* _out;          ///< Decoded samples
+  bool _synced;           ///< Staging buffer starts at a frame / page
+  int32_t _pageLeft;      ///< Opus: bytes of the current page still to decode
+  bool _opusContinue;     ///< Opus: packet has further frames to return
+  uint32_t _sampleRate;   ///< Output sample rate
+  uint32_t _errors;       ///< Skipped frames
+};
+
+#endif
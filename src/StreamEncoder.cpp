@@ -0,0 +1,150 @@
+/**
+ * @file StreamEncoder.cpp
+ * @brief Incremental Ogg Opus encoder Implementation
+ */
+
+#include "StreamEncoder.h"
+#include "opus_encoder/opus_encoder.h"
+
+static const size_t PACKETS_SIZE = StreamEncoder::MAX_FRAMES * OPUS_ENC_MAX_PACKET;
+static const size_t OUTPUT_SIZE = OPUS_ENC_HEADERS_SIZE + 27 + StreamEncoder::MAX_FRAMES * 2 + PACKETS_SIZE;
+
+StreamEncoder::StreamEncoder()
+  : _codec(STREAM_CODEC_PCM)
+  , _ctx(nullptr)
+  , _bitrate(DEFAULT_BITRATE)
+  , _frame(nullptr)
+  , _frameLen(0)
+  , _packets(nullptr)
+  , _packetCount(0)
+  , _packetBytes(0)
+  , _out(nullptr)
+  , _headersSent(false)
+{
+}
+
+StreamEncoder::~StreamEncoder() {
+  end();
+}
+
+bool StreamEncoder::begin(StreamCodec codec, uint32_t bitrate) {
+  end();
+  _bitrate = bitrate;
+  if (codec == STREAM_CODEC_PCM) {
+    return true;
+  }
+  if (codec != STREAM_CODEC_OPUS) {
+    Serial.println("StreamEncoder: only Opus can be encoded");
+    return false;
+  }
+
+  _ctx = OPUSEncoder_CreateContext(bitrate);
+  _frame = (int16_t*)AudioMemory::alloc(FRAME_SAMPLES * sizeof(int16_t), AUDIO_MEM_INTERNAL_PREFERRED);
+  _packets = (uint8_t*)AudioMemory::alloc(PACKETS_SIZE, AUDIO_MEM_INTERNAL_PREFERRED);
+  _out = (uint8_t*)AudioMemory::alloc(OUTPUT_SIZE, AUDIO_MEM_INTERNAL_PREFERRED);
+  if (_ctx == nullptr || _frame == nullptr || _packets == nullptr || _out == nullptr) {
+    Serial.println("StreamEncoder: Opus encoder could not be initialized");
+    end();
+    return false;
+  }
+  _codec = codec;
+  reset();
+  return true;
+}
+
+void StreamEncoder::end() {
+  if (_ctx != nullptr) {
+    OPUSEncoder_DestroyContext(_ctx);
+    _ctx = nullptr;
+  }
+  if (_frame != nullptr) {
+    AudioMemory::release(_frame);
+    _frame = nullptr;
+  }
+  if (_packets != nullptr) {
+    AudioMemory::release(_packets);
+    _packets = nullptr;
+  }
+  if (_out != nullptr) {
+    AudioMemory::release(_out);
+    _out = nullptr;
+  }
+  _codec = STREAM_CODEC_PCM;
+}
+
+void StreamEncoder::reset() {
+  if (_ctx == nullptr) {
+    return;
+  }
+  OPUSEncoder_Reset(_ctx);
+  _frameLen = 0;
+  _packetCount = 0;
+  _packetBytes = 0;
+  _headersSent = false;
+}
+
+bool StreamEncoder::encodeFrame(const int16_t* frame) {
+  int32_t len = OPUSEncode(_ctx, frame, _packets + _packetBytes, OPUS_ENC_MAX_PACKET);
+  if (len < 0) {
+    Serial.printf("StreamEncoder: frame encoding failed (%d)\n", (int)len);
+    return false;
+  }
+  _packetLen[_packetCount++] = (uint16_t)len;
+  _packetBytes += len;
+  return true;
+}
+
+size_t StreamEncoder::encode(const int16_t* pcm, size_t samples, bool last) {
+  if (_ctx == nullptr) {
+    return 0;
+  }
+  if (samples > MAX_SAMPLES - _frameLen) {
+    Serial.printf("StreamEncoder: batch of %u samples too large, truncated\n", (unsigned)samples);
+    samples = MAX_SAMPLES - _frameLen;
+  }
+
+  // Whole frames, completing the one left over from the previous call first
+  _packetCount = 0;
+  _packetBytes = 0;
+  while (samples > 0) {
+    size_t n = min(samples, FRAME_SAMPLES - _frameLen);
+    memcpy(_frame + _frameLen, pcm, n * sizeof(int16_t));
+    _frameLen += n;
+    pcm += n;
+    samples -= n;
+    if (_frameLen == FRAME_SAMPLES) {
+      _frameLen = 0;
+      if (!encodeFrame(_frame)) {
+        return 0;
+      }
+    }
+  }
+
+  // The final page needs at least one packet: pad the partial frame, or send 20 ms of silence
+  if (last && (_frameLen > 0 || _packetCount == 0)) {
+    memset(_frame + _frameLen, 0, (FRAME_SAMPLES - _frameLen) * sizeof(int16_t));
+    _frameLen = 0;
+    if (!encodeFrame(_frame)) {
+      return 0;
+    }
+  }
+  if (_packetCount == 0) {
+    return 0;  // Less than a frame so far
+  }
+
+  size_t len = 0;
+  if (!_headersSent) {
+    int32_t ret = OPUSWriteOggHeaders(_ctx, _out, OUTPUT_SIZE);
+    if (ret < 0) {
+      return 0;
+    }
+    len = ret;
+    _headersSent = true;
+  }
+  int32_t ret = OPUSWriteOggPage(_ctx, _packets, _packetLen, _packetCount, last, _out + len, OUTPUT_SIZE - len);
+  if (ret < 0) {
+    Serial.printf("StreamEncoder: Ogg page could not be written (%d)\n", (int)ret);
+    return 0;
+  }
+  return len + ret;
+}
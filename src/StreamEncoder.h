@@ -0,0 +1,103 @@
+/**
+ * @file StreamEncoder.h
+ * @brief Incremental Ogg Opus encoder for the microphone uplink
+ */
+
+#ifndef StreamEncoder_h
+#define StreamEncoder_h
+
+#include <Arduino.h>
+#include "AudioMemory.h"
+#include "StreamDecoder.h"
+
+struct OPUSEncoder_t;
+
+/**
+ * @class StreamEncoder
+ * @brief Turns 16 kHz mono PCM batches into Ogg Opus pages
+ *
+ * Each encode() call returns one self-contained Ogg page, so every chunk on
+ * the wire can be sent as is. The OpusHead/OpusTags pages are put in front of
+ * the first page after begin() or reset(). Samples that do not fill a 20 ms
+ * frame are kept for the next call.
+ * @code
+ * size_t n = enc.encode(samples, count, isLastChunk);
+ * if (n > 0) sendAudioChunk(enc.data(), n);
+ * @endcode
+ */
+class StreamEncoder {
+public:
+  /**
+   * @brief Constructor
+   */
+  StreamEncoder();
+
+  /**
+   * @brief Destructor
+   */
+  ~StreamEncoder();
+
+  /**
+   * @brief Create the encoder context and buffers
+   * @param codec STREAM_CODEC_PCM (pass-through, nothing allocated) or STREAM_CODEC_OPUS
+   * @param bitrate Target bitrate in bit/s
+   * @return Whether allocation succeeded
+   */
+  bool begin(StreamCodec codec, uint32_t bitrate = DEFAULT_BITRATE);
+
+  /**
+   * @brief Release the encoder context and buffers
+   */
+  void end();
+
+  /**
+   * @brief Start a new stream: drop buffered samples, next page starts with the headers again
+   */
+  void reset();
+
+  /**
+   * @brief Encode a batch of samples into one Ogg page
+   * @param pcm 16 kHz mono samples
+   * @param samples Number of samples, at most MAX_SAMPLES
+   * @param last End of the stream: pad the last frame and mark the page as final
+   * @return Bytes available through data(), 0 if no page was produced
+   */
+  size_t encode(const int16_t* pcm, size_t samples, bool last);
+
+  /**
+   * @brief Get the page produced by the last encode() call
+   */
+  const uint8_t* data() const { return _out; }
+
+  /**
+   * @brief Get the codec passed to begin()
+   */
+  StreamCodec codec() const { return _codec; }
+
+  /**
+   * @brief Get the bitrate passed to begin()
+   */
+  uint32_t bitrate() const { return _bitrate; }
+
+  static const uint32_t DEFAULT_BITRATE = 24000;  ///< About a tenth of raw 16 kHz PCM
+  static const size_t FRAME_SAMPLES = 320;        ///< One 20 ms SILK frame at 16 kHz
+  static const size_t MAX_FRAMES = 16;            ///< Packets per page
+  static const size_t MAX_SAMPLES = MAX_FRAMES * FRAME_SAMPLES;  ///< Largest batch per encode() call
+
+private:
+  bool encodeFrame(const int16_t* frame);  ///< Append one packet to the staging buffer
+
+  StreamCodec _codec;          ///< Stream format
+  OPUSEncoder_t* _ctx;         ///< Encoder state
+  uint32_t _bitrate;           ///< Target bitrate
+  int16_t* _frame;             ///< Samples of the incomplete frame
+  size_t _frameLen;            ///< Samples in _frame
+  uint8_t* _packets;           ///< Packets of the page being built, back to back
+  uint16_t _packetLen[MAX_FRAMES];  ///< Size of each staged packet
+  uint8_t _packetCount;        ///< Packets staged
+  size_t _packetBytes;         ///< Bytes staged
+  uint8_t* _out;               ///< Finished page(s)
+  bool _headersSent;           ///< OpusHead/OpusTags already written for this stream
+};
+
+#endif
@@ -0,0 +1,367 @@
+/**
+ * @file TTSPhraseCache.cpp
+ * @brief Content-addressed LRU phrase cache Implementation
+ */
+
+#include "TTSPhraseCache.h"
+
+TTSPhraseCache::TTSPhraseCache()
+  : _fs(nullptr)
+  , _budget(0)
+  , _maxEntries(0)
+  , _entries(nullptr)
+  , _count(0)
+  , _used(0)
+  , _useCounter(0)
+  , _dirty(false)
+  , _writing(false)
+  , _writeKey(0)
+  , _writeSize(0)
+{
+  _writeExt[0] = '\0';
+}
+
+TTSPhraseCache::~TTSPhraseCache() {
+  end();
+}
+
+bool TTSPhraseCache::begin(fs::FS& fs, const char* dir, uint32_t budgetBytes, uint16_t maxEntries) {
+  end();
+
+  _fs = &fs;
+  _dir = dir;
+  if (_dir.endsWith("/")) {
+    _dir.remove(_dir.length() - 1);
+  }
+  _budget = budgetBytes;
+  _maxEntries = maxEntries > 0 ? maxEntries : 1;
+
+  _entries = (Entry*)AudioMemory::calloc(_maxEntries, sizeof(Entry), AUDIO_MEM_INTERNAL_PREFERRED);
+  if (_entries == nullptr) {
+    Serial.println("[TTS Cache] Index allocation failed");
+    _fs = nullptr;
+    return false;
+  }
+
+  if (!_fs->exists(_dir) && !_fs->mkdir(_dir)) {
+    Serial.printf("[TTS Cache] Cannot create %s\n", _dir.c_str());
+    end();
+    return false;
+  }
+
+  loadIndex();
+  removeOrphans();
+
+  // Budget or entry limit may have shrunk since the index was written
+  makeRoom(0);
+  if (_dirty) {
+    saveIndex();
+  }
+
+  Serial.printf("[TTS Cache] %u phrases, %u / %u bytes\n", (unsigned)_count, (unsigned)_used, (unsigned)_budget);
+  return true;
+}
+
+void TTSPhraseCache::end() {
+  if (_fs == nullptr) {
+    return;
+  }
+  abortWrite();
+  if (_dirty) {
+    saveIndex();
+  }
+  AudioMemory::release(_entries);
+  _entries = nullptr;
+  _count = 0;
+  _used = 0;
+  _fs = nullptr;
+}
+
+uint64_t TTSPhraseCache::makeKey(const char* text, const char* voice, float speed, int pitch, const char* format,
+                                 const char* extra) {
+  char params[48];
+  snprintf(params, sizeof(params), "%.2f|%d", speed, pitch);
+
+  // FNV-1a over the fields, separated by 0x1F so "ab"+"c" differs from "a"+"bc"
+  const char* fields[] = {text, voice, params, format, extra};
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++) {
+    for (const char* p = fields[f]; p != nullptr && *p != '\0'; p++) {
+      hash ^= (uint8_t)*p;
+      hash *= 0x100000001B3ULL;
+    }
+    hash ^= 0x1F;
+    hash *= 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+bool TTSPhraseCache::lookup(uint64_t key, String& path) {
+  int i = find(key);
+  if (i < 0) {
+    _stats.misses++;
+    return false;
+  }
+
+  path = entryPath(key, _entries[i].ext);
+  if (!_fs->exists(path)) {
+    // Removed behind our back (SD card swapped, file deleted)
+    removeEntry(i);
+    saveIndex();
+    _stats.misses++;
+    return false;
+  }
+
+  _entries[i].lastUse = ++_useCounter;
+  _dirty = true;
+  _stats.hits++;
+  return true;
+}
+
+bool TTSPhraseCache::beginWrite(uint64_t key, const char* format) {
+  if (_fs == nullptr) {
+    return false;
+  }
+  abortWrite();
+
+  _file = _fs->open(tempPath(), FILE_WRITE);
+  if (!_file) {
+    Serial.println("[TTS Cache] Cannot open temporary file");
+    return false;
+  }
+  _writing = true;
+  _writeKey = key;
+  strlcpy(_writeExt, format, 5);
+  _writeSize = 0;
+  return true;
+}
+
+bool TTSPhraseCache::write(const uint8_t* data, size_t len) {
+  if (!_writing) {
+    return false;
+  }
+  if (_writeSize + len > _budget || _file.write(data, len) != len) {
+    Serial.println("[TTS Cache] Phrase not cached (too large or write failed)");
+    abortWrite();
+    return false;
+  }
+  _writeSize += len;
+  return true;
+}
+
+bool TTSPhraseCache::commitWrite() {
+  if (!_writing) {
+    return false;
+  }
+  _file.close();
+  _writing = false;
+
+  String tmp = tempPath();
+  if (_writeSize == 0 || !makeRoom(_writeSize)) {
+    _fs->remove(tmp);
+    return false;
+  }
+
+  int existing = find(_writeKey);
+  if (existing >= 0) {
+    removeEntry(existing);
+  }
+
+  String path = entryPath(_writeKey, _writeExt);
+  _fs->remove(path);  // SPIFFS rename does not replace
+  if (!_fs->rename(tmp, path)) {
+    Serial.println("[TTS Cache] Rename failed");
+    _fs->remove(tmp);
+    return false;
+  }
+
+  Entry& e = _entries[_count++];
+  e.key = _writeKey;
+  e.size = _writeSize;
+  e.lastUse = ++_useCounter;
+  strlcpy(e.ext, _writeExt, sizeof(e.ext));
+  _used += _writeSize;
+  _stats.stored++;
+  saveIndex();
+  return true;
+}
+
+void TTSPhraseCache::abortWrite() {
+  if (!_writing) {
+    return;
+  }
+  _file.close();
+  _writing = false;
+  _fs->remove(tempPath());
+}
+
+bool TTSPhraseCache::store(uint64_t key, const char* format, const uint8_t* data, size_t len) {
+  if (!beginWrite(key, format)) {
+    return false;
+  }
+  if (!write(data, len)) {
+    return false;
+  }
+  return commitWrite();
+}
+
+void TTSPhraseCache::clear() {
+  if (_fs == nullptr) {
+    return;
+  }
+  abortWrite();
+  while (_count > 0) {
+    removeEntry(_count - 1);
+  }
+  saveIndex();
+}
+
+void TTSPhraseCache::flush() {
+  if (_fs != nullptr && _dirty) {
+    saveIndex();
+  }
+}
+
+TTSCacheStats TTSPhraseCache::getStats() const {
+  TTSCacheStats stats = _stats;
+  stats.usedBytes = _used;
+  stats.entries = _count;
+  return stats;
+}
+
+String TTSPhraseCache::entryPath(uint64_t key, const char* ext) const {
+  char name[32];
+  snprintf(name, sizeof(name), "/%08lx%08lx.%s", (unsigned long)(key >> 32), (unsigned long)(key & 0xFFFFFFFF), ext);
+  return _dir + name;
+}
+
+String TTSPhraseCache::indexPath() const {
+  return _dir + "/index.bin";
+}
+
+String TTSPhraseCache::tempPath() const {
+  return _dir + "/write.tmp";
+}
+
+int TTSPhraseCache::find(uint64_t key) const {
+  for (int i = 0; i < _count; i++) {
+    if (_entries[i].key == key) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void TTSPhraseCache::removeEntry(int index) {
+  _fs->remove(entryPath(_entries[index].key, _entries[index].ext));
+  _used -= _entries[index].size;
+  _entries[index] = _entries[--_count];  // Order does not matter, LRU uses lastUse
+  _dirty = true;
+}
+
+bool TTSPhraseCache::makeRoom(uint32_t size) {
+  if (size > _budget) {
+    return false;
+  }
+  // An incoming phrase needs a free slot, at startup only the limits are enforced
+  uint16_t slots = size > 0 ? _maxEntries - 1 : _maxEntries;
+  while (_count > 0 && (_used + size > _budget || _count > slots)) {
+    int oldest = 0;
+    for (int i = 1; i < _count; i++) {
+      // Wrap-safe comparison of the LRU clock
+      if ((int32_t)(_entries[i].lastUse - _entries[oldest].lastUse) < 0) {
+        oldest = i;
+      }
+    }
+    removeEntry(oldest);
+    _stats.evicted++;
+  }
+  return true;
+}
+
+void TTSPhraseCache::loadIndex() {
+  _count = 0;
+  _used = 0;
+  _useCounter = 0;
+  _dirty = false;
+
+  File f = _fs->open(indexPath(), FILE_READ);
+  if (!f) {
+    return;
+  }
+
+  uint32_t header[2];
+  if (f.read((uint8_t*)header, sizeof(header)) != sizeof(header) || header[0] != INDEX_MAGIC) {
+    Serial.println("[TTS Cache] Index invalid, starting empty");
+    f.close();
+    _dirty = true;
+    return;
+  }
+
+  size_t stored = header[1];
+  Entry e;
+  for (size_t i = 0; i < stored && f.read((uint8_t*)&e, sizeof(e)) == sizeof(e); i++) {
+    e.ext[sizeof(e.ext) - 1] = '\0';
+    if (_count >= _maxEntries) {
+      _fs->remove(entryPath(e.key, e.ext));  // Limit was lowered
+      _dirty = true;
+      continue;
+    }
+    File audio = _fs->open(entryPath(e.key, e.ext), FILE_READ);
+    if (!audio || audio.size() != e.size) {
+      _dirty = true;  // Missing or half written, the orphan pass deletes the file
+      continue;
+    }
+    audio.close();
+    _entries[_count++] = e;
+    _used += e.size;
+    if ((int32_t)(e.lastUse - _useCounter) > 0) {
+      _useCounter = e.lastUse;
+    }
+  }
+  f.close();
+}
+
+void TTSPhraseCache::removeOrphans() {
+  File root = _fs->open(_dir);
+  if (!root || !root.isDirectory()) {
+    return;
+  }
+
+  String index = indexPath();
+  String orphans[8];
+  size_t orphanCount = 0;
+  for (File f = root.openNextFile(); f; f = root.openNextFile()) {
+    String path = String(f.path());
+    bool isDir = f.isDirectory();
+    f.close();
+    if (isDir || path == index) {
+      continue;
+    }
+    bool known = false;
+    for (int i = 0; i < _count && !known; i++) {
+      known = path == entryPath(_entries[i].key, _entries[i].ext);
+    }
+    if (!known && orphanCount < 8) {
+      orphans[orphanCount++] = path;  // Removed after the directory is closed
+    }
+  }
+  root.close();
+
+  for (size_t i = 0; i < orphanCount; i++) {
+    _fs->remove(orphans[i]);
+  }
+}
+
+void TTSPhraseCache::saveIndex() {
+  File f = _fs->open(indexPath(), FILE_WRITE);
+  if (!f) {
+    Serial.println("[TTS Cache] Cannot write index");
+    return;
+  }
+  uint32_t header[2] = {INDEX_MAGIC, _count};
+  f.write((const uint8_t*)header, sizeof(header));
+  f.write((const uint8_t*)_entries, _count * sizeof(Entry));
+  f.close();
+  _dirty = false;
+}
@@ -0,0 +1,192 @@
+/**
+ * @file TTSPhraseCache.h
+ * @brief Content-addressed LRU cache of synthesized phrases on LittleFS / SD / SPIFFS
+ */
+
+#ifndef TTSPhraseCache_h
+#define TTSPhraseCache_h
+
+#include <Arduino.h>
+#include <FS.h>
+#include "AudioMemory.h"
+
+/**
+ * @brief Cache counters
+ */
+struct TTSCacheStats {
+  uint32_t hits = 0;          // Phrases served from the cache
+  uint32_t misses = 0;        // Lookups that went to the cloud
+  uint32_t stored = 0;        // Phrases written
+  uint32_t evicted = 0;       // Phrases removed to stay within the budget
+  uint32_t usedBytes = 0;     // Audio bytes currently stored
+  uint16_t entries = 0;       // Phrases currently stored
+};
+
+/**
+ * @class TTSPhraseCache
+ * @brief Stores encoded TTS audio under a hash of text and voice settings
+ *
+ * Each phrase is one file named after its 64-bit key with the audio format as
+ * extension, so a hit can be handed to Audio::connecttoFS() or read back as
+ * is. Files are written through while the audio streams in and only become
+ * visible on commitWrite(); an interrupted download never leaves a truncated
+ * phrase behind. The least recently used phrases are removed to keep the total
+ * within the byte budget.
+ *
+ * The index (key, size, last use) lives in RAM and in one small file in the
+ * cache directory. It is rewritten when phrases are added or removed, hits
+ * only update RAM, so playing cached phrases does not wear the flash.
+ * @code
+ * LittleFS.begin(true);
+ * cache.begin(LittleFS, "/tts", 512 * 1024);
+ * minimaxTTS.setCache(&cache);
+ * @endcode
+ */
+class TTSPhraseCache {
+public:
+  /**
+   * @brief Constructor
+   */
+  TTSPhraseCache();
+
+  /**
+   * @brief Destructor
+   */
+  ~TTSPhraseCache();
+
+  /**
+   * @brief Open (or create) the cache directory and load its index
+   * @param fs Mounted file system (LittleFS, SD, SPIFFS)
+   * @param dir Cache directory
+   * @param budgetBytes Maximum audio bytes kept
+   * @param maxEntries Maximum number of phrases kept
+   * @return Whether the cache is usable
+   */
+  bool begin(fs::FS& fs, const char* dir = "/ttscache", uint32_t budgetBytes = 1048576, uint16_t maxEntries = 64);
+
+  /**
+   * @brief Write the index and release the entry table
+   */
+  void end();
+
+  /**
+   * @brief Compute the key of a phrase
+   * @param text Text to synthesize
+   * @param voice Voice ID
+   * @param speed Speech speed
+   * @param pitch Pitch
+   * @param format Audio format ("mp3", "pcm", ...)
+   * @param extra Other settings that change the audio (model, volume, sample rate, ...), may be nullptr
+   * @return 64-bit FNV-1a hash
+   */
+  static uint64_t makeKey(const char* text, const char* voice, float speed, int pitch, const char* format,
+                          const char* extra = nullptr);
+
+  /**
+   * @brief Look up a phrase and mark it as recently used
+   * @param key Phrase key
+   * @param path Receives the file path on a hit
+   * @return Whether the phrase is cached
+   */
+  bool lookup(uint64_t key, String& path);
+
+  /**
+   * @brief Start writing a phrase (replaces a phrase write still in progress)
+   * @param key Phrase key
+   * @param format Audio format, used as file extension (at most 4 characters)
+   * @return Whether the temporary file was opened
+   */
+  bool beginWrite(uint64_t key, const char* format);
+
+  /**
+   * @brief Append audio to the phrase being written
+   * @return false if writing failed or the phrase outgrew the budget (the write is abandoned)
+   */
+  bool write(const uint8_t* data, size_t len);
+
+  /**
+   * @brief Finish the phrase being written, evicting old phrases as needed
+   * @return Whether the phrase was stored
+   */
+  bool commitWrite();
+
+  /**
+   * @brief Discard the phrase being written
+   */
+  void abortWrite();
+
+  /**
+   * @brief Check whether a phrase is being written
+   */
+  bool writing() const { return _writing; }
+
+  /**
+   * @brief Store a complete phrase in one call
+   * @return Whether the phrase was stored
+   */
+  bool store(uint64_t key, const char* format, const uint8_t* data, size_t len);
+
+  /**
+   * @brief Remove every phrase
+   */
+  void clear();
+
+  /**
+   * @brief Write the index now (also done on every add / remove)
+   */
+  void flush();
+
+  /**
+   * @brief File system the phrases live on (valid after begin())
+   */
+  fs::FS& fileSystem() { return *_fs; }
+
+  /**
+   * @brief Get cache counters
+   */
+  TTSCacheStats getStats() const;
+
+private:
+  /**
+   * @brief Index record, also the on-flash format
+   */
+  struct Entry {
+    uint64_t key;
+    uint32_t size;            // Audio bytes
+    uint32_t lastUse;         // Value of _useCounter at the last hit / store
+    char ext[8];              // File extension, NUL terminated
+  };
+
+  static const uint32_t INDEX_MAGIC = 0x31435054;  ///< "TPC1"
+
+  String entryPath(uint64_t key, const char* ext) const;  ///< Phrase file path
+  String indexPath() const;                               ///< Index file path
+  String tempPath() const;                                ///< Phrase being written
+  int find(uint64_t key) const;                           ///< Entry index, -1 if not cached
+  void removeEntry(int index);                            ///< Delete file and entry
+  bool makeRoom(uint32_t size);                           ///< Evict until size fits, false if it never will
+  void loadIndex();                                       ///< Read index, drop entries without a file
+  void removeOrphans();                                   ///< Delete files the index does not know
+  void saveIndex();                                       ///< Rewrite the index file
+
+  fs::FS* _fs;
+  String _dir;
+  uint32_t _budget;           ///< Maximum audio bytes
+  uint16_t _maxEntries;       ///< Size of _entries
+  Entry* _entries;            ///< Index, _count used
+  uint16_t _count;
+  uint32_t _used;             ///< Sum of entry sizes
+  uint32_t _useCounter;       ///< LRU clock
+  bool _dirty;                ///< RAM index differs from the file (hits only)
+
+  // Phrase being written
+  File _file;
+  bool _writing;
+  uint64_t _writeKey;
+  char _writeExt[8];
+  uint32_t _writeSize;
+
+  TTSCacheStats _stats;
+};
+
+#endif
@@ -0,0 +1,241 @@
+/**
+ * @file TextSegmenter.cpp
+ * @brief Streaming text segmenter Implementation
+ */
+
+#include "TextSegmenter.h"
+
+TextSegmenter::TextSegmenter()
+  : _buffer(nullptr)
+  , _capacity(0)
+  , _len(0)
+  , _scanPos(0)
+  , _clauseMin(60)
+  , _firstClauseMin(24)
+  , _segments(0)
+  , _callback(nullptr)
+  , _userData(nullptr)
+{
+}
+
+TextSegmenter::~TextSegmenter() {
+  if (_buffer) {
+    free(_buffer);
+    _buffer = nullptr;
+  }
+}
+
+bool TextSegmenter::begin(size_t maxSegmentBytes) {
+  if (_buffer) {
+    free(_buffer);
+    _buffer = nullptr;
+  }
+  if (maxSegmentBytes < 16) maxSegmentBytes = 16;
+
+  _buffer = (char*)malloc(maxSegmentBytes + 1);
+  if (!_buffer) {
+    Serial.println("Failed to allocate segment buffer");
+    _capacity = 0;
+    return false;
+  }
+  _capacity = maxSegmentBytes + 1;
+  reset();
+  return true;
+}
+
+void TextSegmenter::setCallback(SegmentCallback callback, void* userData) {
+  _callback = callback;
+  _userData = userData;
+}
+
+void TextSegmenter::setClauseBreak(size_t minBytes, size_t firstMinBytes) {
+  _clauseMin = minBytes;
+  _firstClauseMin = firstMinBytes;
+}
+
+void TextSegmenter::reset() {
+  _len = 0;
+  _scanPos = 0;
+  _segments = 0;
+}
+
+void TextSegmenter::feed(const char* text) {
+  if (!_buffer || !text) {
+    return;
+  }
+
+  while (*text) {
+    // Segments never start with whitespace
+    if (_len == 0 && (*text == ' ' || *text == '\n' || *text == '\r')) {
+      text++;
+      continue;
+    }
+
+    size_t space = _capacity - 1 - _len;
+    if (space == 0) {
+      // No break mark within the limit: split at the last space in the second half, else at a char boundary
+      size_t split = 0;
+      for (size_t i = _len; i > _len / 2; i--) {
+        if (_buffer[i - 1] == ' ') {
+          split = i;
+          break;
+        }
+      }
+      if (split == 0) split = utf8Boundary(_len);
+      if (split == 0) split = _len;
+      emit(split);
+      continue;
+    }
+
+    size_t n = strnlen(text, space);
+    memcpy(_buffer + _len, text, n);
+    _len += n;
+    text += n;
+    scan();
+  }
+}
+
+void TextSegmenter::flush() {
+  if (!_buffer || _len == 0) {
+    return;
+  }
+  emit(_len);
+}
+
+size_t TextSegmenter::breakMark(const char* p, size_t avail, bool& hard) {
+  const uint8_t* s = (const uint8_t*)p;
+  hard = false;
+
+  switch (s[0]) {
+    case '!': case '?': case ';': case '\n':
+      hard = true;
+      return 1;
+    case '.':
+      // Sentence end only before whitespace (not "3.14", "e.g")
+      if (avail >= 2 && (s[1] == ' ' || s[1] == '\n')) {
+        hard = true;
+        return 1;
+      }
+      return 0;
+    case ',': case ':':
+      return 1;
+  }
+
+  if (avail < 3) {
+    return 0;
+  }
+
+  if (s[0] == 0xE3 && s[1] == 0x80) {
+    if (s[2] == 0x82) { hard = true; return 3; }  // 。
+    if (s[2] == 0x81) { return 3; }               // 、
+  } else if (s[0] == 0xEF && s[1] == 0xBC) {
+    if (s[2] == 0x81 || s[2] == 0x9F || s[2] == 0x9B) { hard = true; return 3; }  // ！ ？ ；
+    if (s[2] == 0x8C || s[2] == 0x9A) { return 3; }  // ， ：
+  } else if (s[0] == 0xE2 && s[1] == 0x80 && s[2] == 0xA6) {
+    hard = true;  // …
+    return 3;
+  }
+  return 0;
+}
+
+void TextSegmenter::scan() {
+  size_t i = _scanPos;
+  while (i < _len) {
+    uint8_t c = (uint8_t)_buffer[i];
+
+    size_t charLen = 1;
+    if ((c & 0xE0) == 0xC0) charLen = 2;
+    else if ((c & 0xF0) == 0xE0) charLen = 3;
+    else if ((c & 0xF8) == 0xF0) charLen = 4;
+
+    // Incomplete character or '.' at the end: decide when more text arrives
+    if (i + charLen > _len || (c == '.' && i + 1 == _len)) {
+      break;
+    }
+
+    bool hard;
+    size_t mark = breakMark(_buffer + i, _len - i, hard);
+    if (mark > 0) {
+      size_t end = i + mark;
+      size_t minLen = (_segments == 0) ? _firstClauseMin : _clauseMin;
+      if (hard || (minLen > 0 && end >= minLen)) {
+        emit(end);
+        i = 0;
+        continue;
+      }
+      i = end;
+      continue;
+    }
+    i += charLen;
+  }
+  _scanPos = i;
+}
+
+void TextSegmenter::emit(size_t len) {
+  if (len > _len) len = _len;
+
+  if (len > 0 && isSpeakable(len)) {
+    char saved = _buffer[len];
+    _buffer[len] = '\0';
+    if (_callback) {
+      _callback(_buffer, _userData);
+    }
+    _buffer[len] = saved;
+    _segments++;
+  }
+
+  // Drop the segment and the whitespace that follows it
+  size_t start = len;
+  while (start < _len && (_buffer[start] == ' ' || _buffer[start] == '\n' || _buffer[start] == '\r')) {
+    start++;
+  }
+  memmove(_buffer, _buffer + start, _len - start);
+  _len -= start;
+  _scanPos = 0;
+}
+
+size_t TextSegmenter::utf8Boundary(size_t len) const {
+  // Find the lead byte of the last character
+  size_t lead = len;
+  while (lead > 0 && ((uint8_t)_buffer[lead - 1] & 0xC0) == 0x80) {
+    lead--;
+  }
+  if (lead == 0) {
+    return 0;
+  }
+  lead--;
+
+  uint8_t c = (uint8_t)_buffer[lead];
+  size_t charLen = 1;
+  if ((c & 0xE0) == 0xC0) charLen = 2;
+  else if ((c & 0xF0) == 0xE0) charLen = 3;
+  else if ((c & 0xF8) == 0xF0) charLen = 4;
+  return (lead + charLen <= len) ? len : lead;
+}
+
+bool TextSegmenter::isSpeakable(size_t len) const {
+  const uint8_t* s = (const uint8_t*)_buffer;
+  size_t i = 0;
+  while (i < len) {
+    uint8_t c = s[i];
+    if (c < 0x80) {
+      if (isalnum(c)) return true;
+      i++;
+      continue;
+    }
+    if (i + 3 <= len) {
+      // General punctuation (quotes, dashes, ellipsis) and CJK symbols (、。「」【】)
+      if ((c == 0xE2 || c == 0xE3) && s[i + 1] == 0x80) {
+        i += 3;
+        continue;
+      }
+      // Fullwidth punctuation, fullwidth digits and letters are speakable
+      if (c == 0xEF && s[i + 1] == 0xBC && ((s[i + 2] >= 0x81 && s[i + 2] <= 0x8F) || (s[i + 2] >= 0x9A && s[i + 2] <= 0xA0))) {
+        i += 3;
+        continue;
+      }
+    }
+    return true;
+  }
+  return false;
+}
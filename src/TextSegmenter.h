@@ -0,0 +1,108 @@
+/**
+ * @file TextSegmenter.h
+ * @brief Streaming text segmenter - splits incremental LLM output into speakable segments
+ */
+
+#ifndef TextSegmenter_h
+#define TextSegmenter_h
+
+#include <Arduino.h>
+
+/**
+ * @class TextSegmenter
+ * @brief Punctuation-based segmentation of streamed UTF-8 text
+ *
+ * Text is fed in arbitrary fragments (LLM tokens). A segment is emitted at
+ * sentence-final punctuation, ASCII (. ! ? ;) or CJK (。！？；…), once it is long
+ * enough at a clause break (, ， 、 ：), or when the segment reaches the maximum
+ * length. ASCII '.' only ends a sentence when followed by whitespace, so numbers
+ * and abbreviations inside a token stream are not split.
+ */
+class TextSegmenter {
+public:
+  /**
+   * @brief Segment callback
+   * @param segment Null-terminated segment text (valid only during the call)
+   * @param userData Pointer passed to setCallback()
+   */
+  typedef void (*SegmentCallback)(const char* segment, void* userData);
+
+  /**
+   * @brief Constructor
+   */
+  TextSegmenter();
+
+  /**
+   * @brief Destructor
+   */
+  ~TextSegmenter();
+
+  /**
+   * @brief Allocate segment buffer
+   * @param maxSegmentBytes Segment length limit in bytes, longer text is split (default 300)
+   * @return Whether allocation succeeded
+   */
+  bool begin(size_t maxSegmentBytes = 300);
+
+  /**
+   * @brief Set segment callback
+   * @param callback Function called for each completed segment
+   * @param userData Pointer passed through to the callback
+   */
+  void setCallback(SegmentCallback callback, void* userData = nullptr);
+
+  /**
+   * @brief Set clause break length
+   * @param minBytes Split at commas once the segment has at least this many bytes (0 disables, default 60)
+   * @param firstMinBytes Same for the first segment, kept short to start speech early (default 24)
+   */
+  void setClauseBreak(size_t minBytes, size_t firstMinBytes = 24);
+
+  /**
+   * @brief Feed a text fragment
+   * @param text Null-terminated UTF-8 text
+   */
+  void feed(const char* text);
+
+  /**
+   * @brief Emit any buffered text as the final segment
+   */
+  void flush();
+
+  /**
+   * @brief Discard buffered text and restart segment counting
+   */
+  void reset();
+
+  /**
+   * @brief Get number of segments emitted since reset()
+   */
+  uint32_t segmentCount() const { return _segments; }
+
+private:
+  /**
+   * @brief Classify a punctuation mark
+   * @param p Text position
+   * @param avail Bytes available from p
+   * @param hard Set true for sentence-final marks
+   * @return Length of the mark in bytes, 0 if p is not a break mark
+   */
+  static size_t breakMark(const char* p, size_t avail, bool& hard);
+
+  void scan();                        ///< Emit every complete segment in the buffer
+  void emit(size_t len);              ///< Emit the first len bytes and shift the rest
+  size_t utf8Boundary(size_t len) const;  ///< Largest char boundary <= len
+  bool isSpeakable(size_t len) const; ///< Segment contains more than spaces and punctuation
+
+  char* _buffer;              ///< Segment buffer
+  size_t _capacity;           ///< Buffer size (max segment + terminator)
+  size_t _len;                ///< Buffered bytes
+  size_t _scanPos;            ///< Bytes already checked for break marks
+  size_t _clauseMin;          ///< Clause break length
+  size_t _firstClauseMin;     ///< Clause break length for the first segment
+  uint32_t _segments;         ///< Segments emitted
+  SegmentCallback _callback;  ///< Segment callback
+  void* _userData;            ///< Callback user data
+};
+
+#endif
@@ -0,0 +1,169 @@
+/**
+ * @file TurnMetrics.cpp
+ * @brief Turn latency tracing Implementation
+ */
+
+#include "TurnMetrics.h"
+
+bool TurnMetrics::_enabled = false;
+
+static TurnReport s_current;
+static TurnReport s_last;
+static bool s_active = false;
+static uint32_t s_turns = 0;
+static TurnMetrics::ReportCallback s_callback = nullptr;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char* const EVENT_NAMES[TURN_EVENT_COUNT] = {
+  "tls_connect",
+  "ws_upgrade",
+  "first_audio_sent",
+  "vad_end",
+  "asr_final",
+  "llm_first_token",
+  "tts_first_byte",
+  "first_sample",
+  "last_sample"
+};
+
+// Caller holds s_lock
+static void startLocked(unsigned long now) {
+  s_current = TurnReport();
+  s_current.turn = ++s_turns;
+  s_current.startMs = now;
+  s_active = true;
+}
+
+// Caller holds s_lock, returns whether a report was moved to s_last
+static bool finishLocked() {
+  if (!s_active) {
+    return false;
+  }
+  s_active = false;
+  s_last = s_current;
+  return true;
+}
+
+static void publish(bool finished) {
+  if (finished && s_callback != nullptr) {
+    s_callback(s_last);
+  }
+}
+
+void TurnMetrics::enable(bool enable) {
+  portENTER_CRITICAL(&s_lock);
+  _enabled = enable;
+  s_active = false;
+  portEXIT_CRITICAL(&s_lock);
+}
+
+void TurnMetrics::beginTurn(bool restart) {
+  if (!_enabled) {
+    return;
+  }
+  unsigned long now = millis();
+  bool finished = false;
+  portENTER_CRITICAL(&s_lock);
+  if (!s_active || restart || now - s_current.startMs > TURN_TIMEOUT_MS) {
+    finished = finishLocked();
+    startLocked(now);
+  }
+  portEXIT_CRITICAL(&s_lock);
+  publish(finished);
+}
+
+void TurnMetrics::endTurn() {
+  portENTER_CRITICAL(&s_lock);
+  bool finished = finishLocked();
+  portEXIT_CRITICAL(&s_lock);
+  publish(finished);
+}
+
+bool TurnMetrics::active() {
+  return s_active;
+}
+
+void TurnMetrics::record(TurnEvent event) {
+  unsigned long now = millis();
+  bool finished = false;
+  portENTER_CRITICAL(&s_lock);
+  if (s_active && now - s_current.startMs > TURN_TIMEOUT_MS) {
+    s_active = false;  // Abandoned turn, never reported
+  }
+  if (!s_active && event > TURN_WS_UPGRADE && event != TURN_LAST_SAMPLE) {
+    startLocked(now);  // Without an explicit start (e.g. TTS only)
+  }
+  if (s_active) {
+    if (s_current.at[event] < 0) {
+      s_current.at[event] = (int32_t)(now - s_current.startMs);
+    }
+    if (event == TURN_LAST_SAMPLE) {
+      finished = finishLocked();
+    }
+  }
+  portEXIT_CRITICAL(&s_lock);
+  publish(finished);
+}
+
+void TurnMetrics::countUnderrun() {
+  portENTER_CRITICAL(&s_lock);
+  if (s_active) {
+    s_current.underruns++;
+  }
+  portEXIT_CRITICAL(&s_lock);
+}
+
+void TurnMetrics::countOverrun() {
+  portENTER_CRITICAL(&s_lock);
+  if (s_active) {
+    s_current.overruns++;
+  }
+  portEXIT_CRITICAL(&s_lock);
+}
+
+void TurnMetrics::trackFill(size_t used, size_t capacity) {
+  if (capacity == 0) {
+    return;
+  }
+  portENTER_CRITICAL(&s_lock);
+  // Compare fill ratios, different rings report here
+  if (s_active && (uint64_t)used * (s_current.ringCapacity ? s_current.ringCapacity : 1) >
+                      (uint64_t)s_current.ringHighWater * capacity) {
+    s_current.ringHighWater = used;
+    s_current.ringCapacity = capacity;
+  }
+  portEXIT_CRITICAL(&s_lock);
+}
+
+void TurnMetrics::onReport(ReportCallback callback) {
+  s_callback = callback;
+}
+
+TurnReport TurnMetrics::current() {
+  portENTER_CRITICAL(&s_lock);
+  TurnReport report = s_current;
+  portEXIT_CRITICAL(&s_lock);
+  return report;
+}
+
+TurnReport TurnMetrics::last() {
+  portENTER_CRITICAL(&s_lock);
+  TurnReport report = s_last;
+  portEXIT_CRITICAL(&s_lock);
+  return report;
+}
+
+void TurnMetrics::print(const TurnReport& report, Print& out) {
+  out.printf("[Turn %u]\n", (unsigned)report.turn);
+  for (int i = 0; i < TURN_EVENT_COUNT; i++) {
+    if (report.at[i] >= 0) {
+      out.printf("  %-17s +%ld ms\n", EVENT_NAMES[i], (long)report.at[i]);
+    }
+  }
+  out.printf("  underruns %u, overruns %u, ring high-water %u / %u bytes\n", (unsigned)report.underruns,
+             (unsigned)report.overruns, (unsigned)report.ringHighWater, (unsigned)report.ringCapacity);
+}
+
+const char* TurnMetrics::eventName(TurnEvent event) {
+  return event < TURN_EVENT_COUNT ? EVENT_NAMES[event] : "?";
+}
@@ -0,0 +1,176 @@
+/**
+ * @file TurnMetrics.h
+ * @brief Conversational turn latency tracing shared by the clients and Audio
+ */
+
+#ifndef TurnMetrics_h
+#define TurnMetrics_h
+
+#include <Arduino.h>
+
+/**
+ * @brief Points of a turn, in the order they normally occur
+ */
+enum TurnEvent {
+  TURN_TLS_CONNECT,        // TLS session established
+  TURN_WS_UPGRADE,         // WebSocket upgrade (HTTP 101) received
+  TURN_FIRST_AUDIO_SENT,   // First microphone audio sent
+  TURN_VAD_END,            // End of speech detected, recording stopped
+  TURN_ASR_FINAL,          // Final recognition result received
+  TURN_LLM_FIRST_TOKEN,    // First LLM reply text received
+  TURN_TTS_FIRST_BYTE,     // First synthesized audio byte received
+  TURN_FIRST_SAMPLE,       // First sample handed to I2S
+  TURN_LAST_SAMPLE,        // Last sample played, ends the turn
+  TURN_EVENT_COUNT
+};
+
+/**
+ * @brief Timeline and buffer health of one turn
+ */
+struct TurnReport {
+  uint32_t turn = 0;                   // Turn number, starts at 1
+  unsigned long startMs = 0;           // millis() when the turn began
+  int32_t at[TURN_EVENT_COUNT];        // ms after startMs, -1 if the event did not occur
+  uint32_t underruns = 0;              // Playback ran dry while more audio was expected
+  uint32_t overruns = 0;               // Audio dropped because a buffer was full
+  uint32_t ringHighWater = 0;          // Highest fill of the fullest reported ring (bytes)
+  uint32_t ringCapacity = 0;           // Capacity of that ring (bytes)
+
+  TurnReport() {
+    for (int i = 0; i < TURN_EVENT_COUNT; i++) {
+      at[i] = -1;
+    }
+  }
+
+  /**
+   * @brief Time between two events in ms, -1 if either did not occur
+   */
+  int32_t between(TurnEvent from, TurnEvent to) const {
+    return (at[from] < 0 || at[to] < 0) ? -1 : at[to] - at[from];
+  }
+};
+
+/**
+ * @class TurnMetrics
+ * @brief Records when each stage of a turn happened
+ *
+ * The clients mark events as they pass them; the first occurrence of each
+ * event per turn is kept. ASR recording starts a turn, TTS and LLM requests
+ * start one if none is running, and the last played sample ends it. The
+ * finished report goes to the callback and stays available through last().
+ *
+ * Disabled by default: every hook is an inline check of one flag. Events may
+ * be marked from any task.
+ * @code
+ * TurnMetrics::enable(true);
+ * TurnMetrics::onReport([](const TurnReport& r) { TurnMetrics::print(r); });
+ * @endcode
+ */
+class TurnMetrics {
+public:
+  /**
+   * @brief Report callback, called from the task that ended the turn
+   */
+  typedef void (*ReportCallback)(const TurnReport& report);
+
+  /**
+   * @brief Enable or disable recording (default disabled)
+   */
+  static void enable(bool enable);
+
+  /**
+   * @brief Check whether recording is enabled
+   */
+  static bool enabled() { return _enabled; }
+
+  /**
+   * @brief Start a turn
+   * @param restart true: always start a new turn, false: keep a running turn
+   * @note A turn running longer than TURN_TIMEOUT_MS is ended and replaced in either case
+   */
+  static void beginTurn(bool restart = true);
+
+  /**
+   * @brief End the running turn and publish its report (also done by TURN_LAST_SAMPLE)
+   */
+  static void endTurn();
+
+  /**
+   * @brief Check whether a turn is running
+   */
+  static bool active();
+
+  /**
+   * @brief Record an event of the running turn
+   * @note Connection events outside a turn are ignored, other events start one
+   */
+  static inline void mark(TurnEvent event) {
+    if (_enabled) {
+      record(event);
+    }
+  }
+
+  /**
+   * @brief Count a playback underrun
+   */
+  static inline void underrun() {
+    if (_enabled) {
+      countUnderrun();
+    }
+  }
+
+  /**
+   * @brief Count an overrun (audio dropped)
+   */
+  static inline void overrun() {
+    if (_enabled) {
+      countOverrun();
+    }
+  }
+
+  /**
+   * @brief Report the current fill of a ring buffer, the fullest ring of the turn is kept
+   */
+  static inline void ringFill(size_t used, size_t capacity) {
+    if (_enabled) {
+      trackFill(used, capacity);
+    }
+  }
+
+  /**
+   * @brief Set the callback for finished turns (nullptr to disable)
+   */
+  static void onReport(ReportCallback callback);
+
+  /**
+   * @brief Snapshot of the running turn
+   */
+  static TurnReport current();
+
+  /**
+   * @brief Report of the last finished turn
+   */
+  static TurnReport last();
+
+  /**
+   * @brief Print a report as a timeline
+   */
+  static void print(const TurnReport& report, Print& out = Serial);
+
+  /**
+   * @brief Short name of an event
+   */
+  static const char* eventName(TurnEvent event);
+
+  static const unsigned long TURN_TIMEOUT_MS = 120000;  ///< Turns without an end are dropped after this
+
+private:
+  static bool _enabled;
+
+  static void record(TurnEvent event);
+  static void countUnderrun();
+  static void countOverrun();
+  static void trackFill(size_t used, size_t capacity);
+};
+
+#endif
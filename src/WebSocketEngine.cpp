@@ -0,0 +1,412 @@
+/**
+ * @file WebSocketEngine.cpp
+ * @brief Non-blocking WebSocket frame parser and sender Implementation
+ */
+
+#include "WebSocketEngine.h"
+
+WebSocketEngine::WebSocketEngine()
+  : _rx(nullptr)
+  , _tx(nullptr)
+  , _msg(nullptr)
+  , _msgCapacity(0)
+  , _maxMessage(DEFAULT_MAX_MESSAGE)
+  , _region(AUDIO_MEM_PSRAM_PREFERRED)
+  , _messageCallback(nullptr)
+  , _fragmentCallback(nullptr)
+  , _user(nullptr)
+  , _polling(false)
+{
+  reset();
+}
+
+WebSocketEngine::~WebSocketEngine() {
+  end();
+}
+
+void WebSocketEngine::setMessageLimit(size_t maxMessage, AudioMemRegion region) {
+  _maxMessage = maxMessage;
+  _region = region;
+}
+
+void WebSocketEngine::onMessage(MessageCallback callback, void* user) {
+  _messageCallback = callback;
+  _fragmentCallback = nullptr;
+  _user = user;
+}
+
+void WebSocketEngine::onFragment(FragmentCallback callback, void* user) {
+  _fragmentCallback = callback;
+  _messageCallback = nullptr;
+  _user = user;
+}
+
+bool WebSocketEngine::begin() {
+  if (_rx == nullptr) {
+    _rx = (uint8_t*)AudioMemory::alloc(RX_CHUNK_SIZE, AUDIO_MEM_INTERNAL_PREFERRED);
+  }
+  if (_tx == nullptr) {
+    _tx = (uint8_t*)AudioMemory::alloc(TX_HEADROOM + SEND_BUFFER_SIZE, AUDIO_MEM_INTERNAL_PREFERRED);
+  }
+  if (_rx == nullptr || _tx == nullptr) {
+    Serial.println("WebSocket buffer allocation failed!");
+    end();
+    return false;
+  }
+  return true;
+}
+
+void WebSocketEngine::end() {
+  if (_rx != nullptr) {
+    AudioMemory::release(_rx);
+    _rx = nullptr;
+  }
+  if (_tx != nullptr) {
+    AudioMemory::release(_tx);
+    _tx = nullptr;
+  }
+  if (_msg != nullptr) {
+    AudioMemory::release(_msg);
+    _msg = nullptr;
+  }
+  _msgCapacity = 0;
+  reset();
+}
+
+void WebSocketEngine::reset() {
+  _inPayload = false;
+  _hdrLen = 0;
+  _hdrNeed = 2;
+  _fin = false;
+  _opcode = 0;
+  _masked = false;
+  _frameLen = 0;
+  _remaining = 0;
+  _skip = false;
+  _msgActive = false;
+  _msgOpcode = 0;
+  _msgLen = 0;
+  _msgDrop = false;
+  _msgFirst = false;
+  _direct = nullptr;
+  _ctrlLen = 0;
+}
+
+void WebSocketEngine::applyMask(uint8_t* data, size_t len, const uint8_t* key, size_t phase) {
+  // Single bytes up to a word boundary
+  while (len > 0 && ((uintptr_t)data & 3) != 0) {
+    *data++ ^= key[phase++ & 3];
+    len--;
+  }
+
+  // Whole words with the key rotated to the current phase (whole words keep the phase)
+  uint8_t rotated[4];
+  for (int i = 0; i < 4; i++) {
+    rotated[i] = key[(phase + i) & 3];
+  }
+  uint32_t word;
+  memcpy(&word, rotated, 4);
+  uint32_t* w = (uint32_t*)data;
+  size_t words = len >> 2;
+  for (size_t i = 0; i < words; i++) {
+    w[i] ^= word;
+  }
+  data += words << 2;
+  len &= 3;
+
+  while (len > 0) {
+    *data++ ^= key[phase++ & 3];
+    len--;
+  }
+}
+
+bool WebSocketEngine::reserve(size_t size) {
+  if (size <= _msgCapacity) {
+    return true;
+  }
+  // Grow geometrically so a stream of similar messages settles on one buffer
+  size_t capacity = _msgCapacity > 0 ? _msgCapacity : 4096;
+  while (capacity < size) {
+    capacity *= 2;
+  }
+  if (capacity > _maxMessage) {
+    capacity = _maxMessage;
+  }
+  uint8_t* grown = (uint8_t*)AudioMemory::alloc(capacity, _region);
+  if (grown == nullptr) {
+    return false;
+  }
+  if (_msg != nullptr) {
+    memcpy(grown, _msg, _msgLen);
+    AudioMemory::release(_msg);
+  }
+  _msg = grown;
+  _msgCapacity = capacity;
+  return true;
+}
+
+size_t WebSocketEngine::takeHeader(const uint8_t* p, size_t n) {
+  size_t used = 0;
+  while (used < n) {
+    _hdr[_hdrLen++] = p[used++];
+    if (_hdrLen == 2) {
+      uint8_t len7 = _hdr[1] & 0x7F;
+      _hdrNeed = 2 + (len7 == 126 ? 2 : (len7 == 127 ? 8 : 0)) + ((_hdr[1] & 0x80) ? 4 : 0);
+    }
+    if (_hdrLen >= 2 && _hdrLen == _hdrNeed) {
+      _inPayload = true;
+      break;
+    }
+  }
+  return used;
+}
+
+bool WebSocketEngine::startFrame() {
+  _fin = _hdr[0] & 0x80;
+  _opcode = _hdr[0] & 0x0F;
+  _masked = _hdr[1] & 0x80;
+
+  uint8_t len7 = _hdr[1] & 0x7F;
+  uint8_t pos = 2;
+  if (len7 == 126) {
+    _frameLen = ((uint16_t)_hdr[2] << 8) | _hdr[3];
+    pos = 4;
+  } else if (len7 == 127) {
+    _frameLen = 0;
+    for (int i = 0; i < 8; i++) {
+      _frameLen = (_frameLen << 8) | _hdr[2 + i];
+    }
+    pos = 10;
+  } else {
+    _frameLen = len7;
+  }
+  if (_masked) {
+    memcpy(_maskKey, _hdr + pos, 4);
+  }
+  _remaining = _frameLen;
+  _hdrLen = 0;
+  _hdrNeed = 2;
+  _skip = false;
+
+  // Control frames: at most 125 bytes, never fragmented
+  if (_opcode & 0x08) {
+    if (_frameLen > sizeof(_ctrl) || !_fin) {
+      Serial.printf("Invalid control frame (opcode 0x%X, %u bytes)\n", _opcode, (unsigned)_frameLen);
+      return false;
+    }
+    _ctrlLen = 0;
+    return true;
+  }
+
+  if (_opcode == WS_OP_CONTINUATION) {
+    if (!_msgActive) {
+      Serial.println("Unexpected continuation frame");
+      _skip = true;
+    }
+  } else if (_opcode == WS_OP_TEXT || _opcode == WS_OP_BINARY) {
+    if (_msgActive) {
+      Serial.println("New message before final fragment, previous message dropped");
+    }
+    _msgActive = true;
+    _msgOpcode = _opcode;
+    _msgLen = 0;
+    _msgDrop = false;
+    _msgFirst = true;
+  } else {
+    Serial.printf("Unknown WebSocket opcode 0x%X\n", _opcode);
+    return false;
+  }
+
+  // Assembly mode: make room for the whole frame now, or skip the message
+  if (!_skip && _messageCallback != nullptr && !_msgDrop) {
+    uint64_t total = _msgLen + _frameLen;
+    bool room = total <= _maxMessage;
+    if (room && !(_fin && _msgLen == 0)) {
+      room = reserve((size_t)total);  // Unfragmented frames may not need the buffer at all
+    }
+    if (!room) {
+      Serial.printf("WebSocket message too large (%llu bytes), skipped\n", (unsigned long long)total);
+      _msgDrop = true;
+    }
+  }
+  _direct = nullptr;
+  return true;
+}
+
+void WebSocketEngine::takePayload(uint8_t* p, size_t n) {
+  size_t offset = (size_t)(_frameLen - _remaining);
+  if (_masked) {
+    applyMask(p, n, _maskKey, offset);
+  }
+  _remaining -= n;
+
+  if (_opcode & 0x08) {
+    memcpy(_ctrl + _ctrlLen, p, n);
+    _ctrlLen += n;
+    return;
+  }
+  if (_skip) {
+    return;
+  }
+
+  if (_fragmentCallback != nullptr) {
+    _fragmentCallback(_msgOpcode, p, n, _msgFirst, _fin && _remaining == 0, _user);
+    _msgFirst = false;
+    return;
+  }
+  if (_msgDrop || _messageCallback == nullptr) {
+    return;
+  }
+
+  // A whole unfragmented frame in one read is dispatched from the read buffer
+  if (_fin && _msgLen == 0 && offset == 0 && _remaining == 0) {
+    _direct = p;
+    _msgLen = n;
+    return;
+  }
+  if (_msgCapacity < _msgLen + n && !reserve(_msgLen + n)) {
+    Serial.println("WebSocket message buffer allocation failed, message skipped");
+    _msgDrop = true;
+    return;
+  }
+  memcpy(_msg + _msgLen, p, n);
+  _msgLen += n;
+}
+
+bool WebSocketEngine::finishFrame(Client& client) {
+  _inPayload = false;
+
+  if (_opcode == WS_OP_PING) {
+    sendFrame(client, WS_OP_PONG, _ctrl, _ctrlLen);
+    return true;
+  }
+  if (_opcode == WS_OP_CLOSE) {
+    // Echo the status code, then the caller drops the connection
+    sendFrame(client, WS_OP_CLOSE, _ctrl, _ctrlLen >= 2 ? 2 : 0);
+    reset();
+    return false;
+  }
+  if (_opcode == WS_OP_PONG || _skip || !_fin) {
+    return true;
+  }
+
+  // Final fragment of a data message
+  if (_fragmentCallback != nullptr) {
+    if (_frameLen == 0) {
+      _fragmentCallback(_msgOpcode, _rx, 0, _msgFirst, true, _user);
+    }
+  } else if (_messageCallback != nullptr && !_msgDrop) {
+    _messageCallback(_msgOpcode, _direct != nullptr ? _direct : _msg, _msgLen, _user);
+  }
+  _msgActive = false;
+  _msgLen = 0;
+  _direct = nullptr;
+  return true;
+}
+
+int WebSocketEngine::poll(Client& client) {
+  if (_polling || !begin()) {
+    return 0;
+  }
+  _polling = true;
+
+  // Only what is already buffered, bounded so a fast sender cannot keep us here
+  int budget = client.available();
+  int consumed = 0;
+  int result = 0;
+  while (budget > 0 && result == 0) {
+    int got = client.read(_rx, budget < (int)RX_CHUNK_SIZE ? budget : RX_CHUNK_SIZE);
+    if (got <= 0) {
+      break;
+    }
+    budget -= got;
+    consumed += got;
+
+    uint8_t* p = _rx;
+    size_t n = got;
+    while (true) {
+      if (!_inPayload) {
+        if (n == 0) {
+          break;
+        }
+        size_t used = takeHeader(p, n);
+        p += used;
+        n -= used;
+        if (!_inPayload) {
+          break;  // Header continues in the next read
+        }
+        if (!startFrame()) {
+          reset();
+          result = -1;
+          break;
+        }
+      }
+      if (_remaining > 0) {
+        if (n == 0) {
+          break;
+        }
+        size_t take = _remaining < n ? (size_t)_remaining : n;
+        takePayload(p, take);
+        p += take;
+        n -= take;
+      }
+      if (_remaining == 0 && !finishFrame(client)) {
+        result = -1;
+        break;
+      }
+    }
+  }
+
+  _polling = false;
+  return result < 0 ? -1 : consumed;
+}
+
+bool WebSocketEngine::sendFrame(Client& client, uint8_t opcode, const uint8_t* data, size_t len) {
+  if (!begin()) {
+    return false;
+  }
+
+  // Header right in front of the payload, so small frames go out in one write
+  uint8_t* payload = _tx + TX_HEADROOM;
+  size_t header_len = 2 + (len < 126 ? 0 : (len < 65536 ? 2 : 8)) + 4;
+  uint8_t* header = payload - header_len;
+
+  header[0] = 0x80 | opcode;  // FIN=1 + opcode
+  header[1] = 0x80;           // MASK=1 (client to server must be masked)
+  if (len < 126) {
+    header[1] |= len;
+  } else if (len < 65536) {
+    header[1] |= 126;
+    header[2] = (len >> 8) & 0xFF;
+    header[3] = len & 0xFF;
+  } else {
+    header[1] |= 127;
+    for (int i = 0; i < 8; i++) {
+      header[2 + i] = ((uint64_t)len >> (56 - i * 8)) & 0xFF;
+    }
+  }
+  uint8_t* mask_key = payload - 4;
+  uint32_t key = esp_random();
+  memcpy(mask_key, &key, 4);
+
+  size_t chunk = len < SEND_BUFFER_SIZE ? len : SEND_BUFFER_SIZE;
+  if (chunk > 0) {
+    memcpy(payload, data, chunk);
+    applyMask(payload, chunk, mask_key, 0);
+  }
+  bool ok = client.write(header, header_len + chunk) == header_len + chunk;
+
+  // Larger payloads: mask and write one buffer at a time (SEND_BUFFER_SIZE keeps the key phase)
+  size_t sent = chunk;
+  while (ok && sent < len) {
+    chunk = (len - sent) < SEND_BUFFER_SIZE ? (len - sent) : SEND_BUFFER_SIZE;
+    memcpy(payload, data + sent, chunk);
+    applyMask(payload, chunk, mask_key, 0);
+    ok = client.write(payload, chunk) == chunk;
+    sent += chunk;
+  }
+  if (!ok) {
+    Serial.printf("WebSocket write failed (%u byte frame)\n", (unsigned)len);
+  }
+  return ok;
+}
@@ -0,0 +1,176 @@
+/**
+ * @file WebSocketEngine.h
+ * @brief Non-blocking WebSocket (RFC 6455) frame parser and sender shared by the WebSocket clients
+ */
+
+#ifndef WebSocketEngine_h
+#define WebSocketEngine_h
+
+#include <Arduino.h>
+#include <Client.h>
+#include "AudioMemory.h"
+
+/**
+ * @brief WebSocket opcodes
+ */
+enum WebSocketOpcode {
+  WS_OP_CONTINUATION = 0x00,
+  WS_OP_TEXT = 0x01,
+  WS_OP_BINARY = 0x02,
+  WS_OP_CLOSE = 0x08,
+  WS_OP_PING = 0x09,
+  WS_OP_PONG = 0x0A
+};
+
+/**
+ * @class WebSocketEngine
+ * @brief Frame state machine over an already upgraded connection
+ *
+ * poll() reads only the bytes the socket already has and keeps its position
+ * inside the frame between calls, so a server pausing mid-frame never stalls
+ * the caller. Pings are answered and close frames echoed by the engine.
+ *
+ * Data messages leave in one of two ways:
+ * - onMessage(): fragments are assembled into a reusable buffer that grows up
+ *   to the message limit, the callback gets the complete message. Unfragmented
+ *   frames that arrive in one read are passed straight from the read buffer.
+ * - onFragment(): payload bytes are passed on as they arrive, nothing is
+ *   assembled, for messages of any size.
+ *
+ * sendFrame() masks into a reusable send buffer, a word at a time.
+ * @code
+ * if (ws.poll(client) < 0) {
+ *   client.stop();  // Closed by the server or protocol error
+ * }
+ * @endcode
+ */
+class WebSocketEngine {
+public:
+  /**
+   * @brief Complete message callback, data stays valid until the callback returns
+   */
+  typedef void (*MessageCallback)(uint8_t opcode, uint8_t* data, size_t len, void* user);
+
+  /**
+   * @brief Streaming callback, first / last mark the message boundaries (len may be 0 with last)
+   */
+  typedef void (*FragmentCallback)(uint8_t opcode, const uint8_t* data, size_t len, bool first, bool last, void* user);
+
+  /**
+   * @brief Constructor
+   */
+  WebSocketEngine();
+
+  /**
+   * @brief Destructor
+   */
+  ~WebSocketEngine();
+
+  /**
+   * @brief Set the largest message assembled for onMessage(), larger ones are skipped
+   * @param maxMessage Limit in bytes
+   * @param region Placement of the message buffer
+   */
+  void setMessageLimit(size_t maxMessage, AudioMemRegion region = AUDIO_MEM_PSRAM_PREFERRED);
+
+  /**
+   * @brief Deliver assembled messages
+   */
+  void onMessage(MessageCallback callback, void* user);
+
+  /**
+   * @brief Deliver payload bytes as they arrive instead of assembling messages
+   */
+  void onFragment(FragmentCallback callback, void* user);
+
+  /**
+   * @brief Allocate the read and send buffers (also done by the first poll() / sendFrame())
+   * @return Whether allocation succeeded, true if already allocated
+   */
+  bool begin();
+
+  /**
+   * @brief Release all buffers
+   */
+  void end();
+
+  /**
+   * @brief Forget any partially received frame or message (call after reconnecting)
+   */
+  void reset();
+
+  /**
+   * @brief Process the bytes currently available on the connection
+   * @param client Connected socket
+   * @return Bytes consumed (any data proves the connection alive), or -1 if the server closed it or broke the protocol
+   */
+  int poll(Client& client);
+
+  /**
+   * @brief Send one unfragmented, masked frame
+   * @param client Connected socket
+   * @param opcode WebSocketOpcode
+   * @param data Payload (not modified)
+   * @param len Payload length
+   * @return Whether the whole frame was written
+   */
+  bool sendFrame(Client& client, uint8_t opcode, const uint8_t* data, size_t len);
+
+  /**
+   * @brief XOR data with a 4-byte mask key, starting at key position phase
+   */
+  static void applyMask(uint8_t* data, size_t len, const uint8_t* key, size_t phase);
+
+  static const size_t RX_CHUNK_SIZE = 2048;         ///< Socket read size
+  static const size_t SEND_BUFFER_SIZE = 4096;      ///< Payload bytes masked per write
+  static const size_t DEFAULT_MAX_MESSAGE = 65536;  ///< Default assembled message limit
+
+private:
+  static const size_t TX_HEADROOM = 16;  ///< Header space before the payload, keeps it word aligned
+
+  size_t takeHeader(const uint8_t* p, size_t n);        ///< Collect header bytes, returns bytes used
+  bool startFrame();                                    ///< Header complete, false on protocol error
+  void takePayload(uint8_t* p, size_t n);               ///< Unmask and route payload bytes
+  bool finishFrame(Client& client);                     ///< Frame complete, false if the connection closes
+  bool reserve(size_t size);                            ///< Grow the message buffer
+
+  uint8_t* _rx;               ///< Socket read buffer (RX_CHUNK_SIZE)
+  uint8_t* _tx;               ///< Send buffer (TX_HEADROOM + SEND_BUFFER_SIZE)
+  uint8_t* _msg;              ///< Assembled message
+  size_t _msgCapacity;        ///< Allocated size of _msg
+  size_t _maxMessage;         ///< Message limit
+  AudioMemRegion _region;     ///< Placement of _msg
+
+  MessageCallback _messageCallback;
+  FragmentCallback _fragmentCallback;
+  void* _user;
+
+  // Current frame
+  bool _inPayload;            ///< Header done, payload bytes outstanding
+  uint8_t _hdr[14];           ///< Header bytes collected so far
+  uint8_t _hdrLen;            ///< Bytes in _hdr
+  uint8_t _hdrNeed;           ///< Header size announced by the first two bytes
+  bool _fin;                  ///< Final fragment
+  uint8_t _opcode;            ///< Frame opcode
+  bool _masked;               ///< Payload masked (servers should not, but may)
+  uint8_t _maskKey[4];        ///< Mask key
+  uint64_t _frameLen;         ///< Payload length
+  uint64_t _remaining;        ///< Payload bytes not yet received
+  bool _skip;                 ///< Discard this frame's payload
+
+  // Current message
+  bool _msgActive;            ///< Started, final fragment not yet received
+  uint8_t _msgOpcode;         ///< Opcode of the first fragment
+  size_t _msgLen;             ///< Bytes assembled
+  bool _msgDrop;              ///< Too large, discard until the final fragment
+  bool _msgFirst;             ///< No fragment callback yet for this message
+  uint8_t* _direct;           ///< Whole message inside _rx, no copy made
+
+  // Control frame payload (at most 125 bytes)
+  uint8_t _ctrl[125];
+  uint8_t _ctrlLen;
+
+  bool _polling;              ///< Inside poll(), nested calls return immediately
+};
+
+#endif
@@ -13,60 +13,90 @@
 #include <stdio.h>
 #include <time.h>
 #include "libfaad/neaacdec.h"
+#include "../AudioMemory.h"
+#include <new>
 
-
-// Declaration of the required global variables
-
-NeAACDecHandle hAac;
-NeAACDecFrameInfo frameInfo;
-NeAACDecConfigurationPtr conf;
 const uint8_t  SYNCWORDH = 0xff; /* 12-bit syncword */
 const uint8_t  SYNCWORDL = 0xf0;
-bool f_decoderIsInit = false;
-bool f_firstCall = false;
-bool f_setRaWBlockParams = false;
-uint32_t aacSamplerate = 0;
-uint8_t aacChannels = 0;
-uint8_t aacProfile = 0;
-static uint16_t validSamples = 0;
-clock_t before;
-float compressionRatio = 1;
-mp4AudioSpecificConfig* mp4ASC;
+
+// Decoder state, one per stream (see AACDecoder_CreateContext)
+struct AACDecoder_t {
+    NeAACDecHandle hAac = NULL;
+    NeAACDecFrameInfo frameInfo = {};
+    NeAACDecConfigurationPtr conf = NULL;
+    bool f_decoderIsInit = false;
+    bool f_firstCall = false;
+    bool f_setRaWBlockParams = false;
+    uint32_t aacSamplerate = 0;
+    uint8_t aacChannels = 0;
+    uint8_t aacProfile = 0;
+    uint16_t validSamples = 0;
+    clock_t before = 0;
+    float compressionRatio = 1;
+};
+
+static AACDecoder_t s_aacDefault;                      // used by tasks that never call AACDecoder_SetContext()
+static thread_local AACDecoder_t* s_aac = &s_aacDefault;
+
+//----------------------------------------------------------------------------------------------------------------------
+AACDecoder_t* AACDecoder_CreateContext(){
+    void* mem = AudioMemory::alloc(sizeof(AACDecoder_t), AUDIO_MEM_INTERNAL_PREFERRED);
+    if(!mem) return NULL;
+    return new (mem) AACDecoder_t();
+}
+//----------------------------------------------------------------------------------------------------------------------
+void AACDecoder_DestroyContext(AACDecoder_t* ctx){
+    if(!ctx || ctx == &s_aacDefault) return;
+    AACDecoder_t* prev = s_aac;
+    s_aac = ctx;
+    if(ctx->f_decoderIsInit) AACDecoder_FreeBuffers();
+    s_aac = (prev == ctx) ? &s_aacDefault : prev;
+    ctx->~AACDecoder_t();
+    AudioMemory::release(ctx);
+}
+//----------------------------------------------------------------------------------------------------------------------
+void AACDecoder_SetContext(AACDecoder_t* ctx){
+    s_aac = ctx ? ctx : &s_aacDefault;
+}
+//----------------------------------------------------------------------------------------------------------------------
+AACDecoder_t* AACDecoder_GetContext(){
+    return s_aac;
+}
 
 //----------------------------------------------------------------------------------------------------------------------
 bool AACDecoder_IsInit(){
-    return f_decoderIsInit;
+    return s_aac->f_decoderIsInit;
 }
 //----------------------------------------------------------------------------------------------------------------------
 bool AACDecoder_AllocateBuffers(){
-    before = clock();
-    hAac = NeAACDecOpen();
-    conf = NeAACDecGetCurrentConfiguration(hAac);
+    s_aac->before = clock();
+    s_aac->hAac = NeAACDecOpen();
+    s_aac->conf = NeAACDecGetCurrentConfiguration(s_aac->hAac);
 
-    if(hAac) f_decoderIsInit = true;
-    f_firstCall = false;
-    f_setRaWBlockParams = false;
-    return f_decoderIsInit;
+    if(s_aac->hAac) s_aac->f_decoderIsInit = true;
+    s_aac->f_firstCall = false;
+    s_aac->f_setRaWBlockParams = false;
+    return s_aac->f_decoderIsInit;
 }
 //----------------------------------------------------------------------------------------------------------------------
 void AACDecoder_FreeBuffers(){
-    NeAACDecClose(hAac);
-    hAac = NULL;
-    f_decoderIsInit = false;
-    f_firstCall = false;
-    clock_t difference = clock() - before;
+    NeAACDecClose(s_aac->hAac);
+    s_aac->hAac = NULL;
+    s_aac->f_decoderIsInit = false;
+    s_aac->f_firstCall = false;
+    clock_t difference = clock() - s_aac->before;
     int msec = difference  / CLOCKS_PER_SEC; (void)msec;
 //    printf("ms %li\n", difference);
 }
 //----------------------------------------------------------------------------------------------------------------------
 uint8_t AACGetFormat(){
-    return frameInfo.header_type;  // RAW        0 /* No header */
+    return s_aac->frameInfo.header_type;  // RAW        0 /* No header */
                                    // ADIF       1 /* single ADIF header at the beginning of the file */
                                    // ADTS       2 /* ADTS header at the beginning of each frame */
 }
 //----------------------------------------------------------------------------------------------------------------------
 uint8_t AACGetSBR(){
-    return frameInfo.sbr;          // NO_SBR           0 /* no SBR used in this file */
+    return s_aac->frameInfo.sbr;          // NO_SBR           0 /* no SBR used in this file */
                                    // SBR_UPSAMPLED    1 /* upsampled SBR used */
                                    // SBR_DOWNSAMPLED  2 /* downsampled SBR used */
                                    // NO_SBR_UPSAMPLED 3 /* no SBR used, but file is upsampled by a factor 2 anyway */
@@ -74,7 +104,7 @@ uint8_t AACGetSBR(){
 //----------------------------------------------------------------------------------------------------------------------
 uint8_t AACGetParametricStereo(){  // not used (0) or used (1)
 //    log_w("frameInfo.ps %i", frameInfo.isPS);
-    return frameInfo.isPS;
+    return s_aac->frameInfo.isPS;
 }
 //----------------------------------------------------------------------------------------------------------------------
 int AACFindSyncWord(uint8_t *buf, int nBytes){
@@ -91,28 +121,28 @@ int AACFindSyncWord(uint8_t *buf, int nBytes){
 }
 //----------------------------------------------------------------------------------------------------------------------
 int AACSetRawBlockParams(int nChans, int sampRateCore, int profile){
-    f_setRaWBlockParams = true;
-    aacChannels = nChans;  // 1: Mono, 2: Stereo
-    aacSamplerate = (uint32_t)sampRateCore; // 8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000
-    aacProfile = profile; //1: AAC Main, 2: AAC LC (Low Complexity), 3: AAC SSR (Scalable Sample Rate), 4: AAC LTP (Long Term Prediction)
+    s_aac->f_setRaWBlockParams = true;
+    s_aac->aacChannels = nChans;  // 1: Mono, 2: Stereo
+    s_aac->aacSamplerate = (uint32_t)sampRateCore; // 8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000
+    s_aac->aacProfile = profile; //1: AAC Main, 2: AAC LC (Low Complexity), 3: AAC SSR (Scalable Sample Rate), 4: AAC LTP (Long Term Prediction)
     return 0;
 }
 //----------------------------------------------------------------------------------------------------------------------
 int16_t AACGetOutputSamps(){
-    return validSamples;
+    return s_aac->validSamples;
 }
 //----------------------------------------------------------------------------------------------------------------------
 int AACGetBitrate(){
     uint32_t br = AACGetBitsPerSample() * AACGetChannels() *  AACGetSampRate();
-    return (br / compressionRatio);;
+    return (br / s_aac->compressionRatio);;
 }
 //----------------------------------------------------------------------------------------------------------------------
 int AACGetChannels(){
-    return aacChannels;
+    return s_aac->aacChannels;
 }
 //----------------------------------------------------------------------------------------------------------------------
 int AACGetSampRate(){
-    return aacSamplerate;
+    return s_aac->aacSamplerate;
 }
 //----------------------------------------------------------------------------------------------------------------------
 int AACGetBitsPerSample(){
@@ -128,31 +158,31 @@ extern uint8_t get_sr_index(const uint32_t samplerate);
 
 int AACDecode(uint8_t *inbuf, int32_t *bytesLeft, short *outbuf){
     uint8_t* ob = (uint8_t*)outbuf;
-    if (f_firstCall == false){
-        if(f_setRaWBlockParams){ // set raw AAC values, e.g. for M4A config.
-            f_setRaWBlockParams = false;
-            conf->defSampleRate = aacSamplerate;
-            conf->outputFormat = FAAD_FMT_16BIT;
-            conf->useOldADTSFormat = 1;
-            conf->defObjectType = 2;
-            int8_t ret = NeAACDecSetConfiguration(hAac, conf); (void)ret;
+    if (s_aac->f_firstCall == false){
+        if(s_aac->f_setRaWBlockParams){ // set raw AAC values, e.g. for M4A config.
+            s_aac->f_setRaWBlockParams = false;
+            s_aac->conf->defSampleRate = s_aac->aacSamplerate;
+            s_aac->conf->outputFormat = FAAD_FMT_16BIT;
+            s_aac->conf->useOldADTSFormat = 1;
+            s_aac->conf->defObjectType = 2;
+            int8_t ret = NeAACDecSetConfiguration(s_aac->hAac, s_aac->conf); (void)ret;
 
             uint8_t specificInfo[2];
-            createAudioSpecificConfig(specificInfo, aacProfile, get_sr_index(aacSamplerate), aacChannels);
-            int8_t err = NeAACDecInit2(hAac, specificInfo, 2, &aacSamplerate, &aacChannels);(void)err;
+            createAudioSpecificConfig(specificInfo, s_aac->aacProfile, get_sr_index(s_aac->aacSamplerate), s_aac->aacChannels);
+            int8_t err = NeAACDecInit2(s_aac->hAac, specificInfo, 2, &s_aac->aacSamplerate, &s_aac->aacChannels);(void)err;
         }
         else{
-            NeAACDecSetConfiguration(hAac, conf);
-            int8_t err = NeAACDecInit(hAac, inbuf, *bytesLeft, &aacSamplerate, &aacChannels); (void)err;
+            NeAACDecSetConfiguration(s_aac->hAac, s_aac->conf);
+            int8_t err = NeAACDecInit(s_aac->hAac, inbuf, *bytesLeft, &s_aac->aacSamplerate, &s_aac->aacChannels); (void)err;
         }
-        f_firstCall = true;
+        s_aac->f_firstCall = true;
     }
 
-    NeAACDecDecode2(hAac, &frameInfo, inbuf, *bytesLeft, (void**)&ob, 2048 * 2 * sizeof(int16_t));
-    *bytesLeft -= frameInfo.bytesconsumed;
-    validSamples = frameInfo.samples;
-    int8_t err = 0 - frameInfo.error;
-    compressionRatio = (float)frameInfo.samples * 2 / frameInfo.bytesconsumed;
+    NeAACDecDecode2(s_aac->hAac, &s_aac->frameInfo, inbuf, *bytesLeft, (void**)&ob, 2048 * 2 * sizeof(int16_t));
+    *bytesLeft -= s_aac->frameInfo.bytesconsumed;
+    s_aac->validSamples = s_aac->frameInfo.samples;
+    int8_t err = 0 - s_aac->frameInfo.error;
+    s_aac->compressionRatio = (float)s_aac->frameInfo.samples * 2 / s_aac->frameInfo.bytesconsumed;
     return err;
 }
 //----------------------------------------------------------------------------------------------------------------------
@@ -17,6 +17,15 @@ struct AudioSpecificConfig {
     uint8_t channelConfiguration;
 };
 
+// All functions below work on the decoder context bound to the calling task. Tasks that never bind one share a
+// default context, so a single stream needs no setup. Create a context per stream to decode several at once.
+struct AACDecoder_t;
+
+AACDecoder_t* AACDecoder_CreateContext();                 // NULL if out of memory
+void          AACDecoder_DestroyContext(AACDecoder_t* ctx); // frees the buffers, too
+void          AACDecoder_SetContext(AACDecoder_t* ctx);     // bind ctx to the calling task, NULL: default context
+AACDecoder_t* AACDecoder_GetContext();
+
 bool        AACDecoder_IsInit();
 bool        AACDecoder_AllocateBuffers();
 void        AACDecoder_FreeBuffers();
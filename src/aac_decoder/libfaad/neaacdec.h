@@ -377,6 +377,7 @@ typedef const int8_t (*drm_ps_huff_tab)[2];
 //        *y2 = (_MulHigh(x2, c1) - _MulHigh(x1, c2)) << (FRAC_SIZE - FRAC_BITS);
 //    }
 static inline void ComplexMult(int32_t* y1, int32_t* y2, int32_t x1, int32_t x2, int32_t c1, int32_t c2) {
+#ifdef __XTENSA__
     asm volatile (
         //  y1 = (x1 * c1) + (x2 * c2)
         "mulsh a2, %2, %4\n"        // a2 = x1 * c1 (Low 32 bits)
@@ -394,6 +395,11 @@ static inline void ComplexMult(int32_t* y1, int32_t* y2, int32_t x1, int32_t x2,
         : "r" (x1), "r" (x2), "r" (c1), "r" (c2)  // Input
         : "a2", "a3"                              // Clobbers
     );
+#else
+    // same result as mulsh: high words of the products, summed in 32 bits
+    *y1 = (int32_t)((uint32_t)((int32_t)(((int64_t)x1 * c1) >> 32) + (int32_t)(((int64_t)x2 * c2) >> 32)) << 1);
+    *y2 = (int32_t)((uint32_t)((int32_t)(((int64_t)x2 * c1) >> 32) - (int32_t)(((int64_t)x1 * c2) >> 32)) << 1);
+#endif
 }
 
 
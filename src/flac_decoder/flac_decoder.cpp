@@ -10,153 +10,182 @@
  *
  */
 #include "flac_decoder.h"
+#include "../AudioMemory.h"
 #include "vector"
+#include <new>
 using namespace std;
 
-FLACFrameHeader_t*   FLACFrameHeader;
-FLACMetadataBlock_t* FLACMetadataBlock;
-
-vector<uint32_t> s_flacSegmTableVec;
-vector<int32_t>  coefs;
-vector<uint32_t> s_flacBlockPicItem;
-uint64_t         s_flac_bitBuffer = 0;
-uint32_t         s_flacBitrate = 0;
-uint32_t         s_flacBlockPicLenUntilFrameEnd = 0;
-uint32_t         s_flacCurrentFilePos = 0;
-uint32_t         s_flacBlockPicPos = 0;
-uint32_t         s_flacBlockPicLen = 0;
-uint32_t         s_flacAudioDataStart = 0;
-int32_t          s_flacRemainBlockPicLen = 0;
 const uint16_t   s_flacOutBuffSize = 2048;
-uint16_t         s_numOfOutSamples = 0;
-uint16_t         s_flacValidSamples = 0;
-uint16_t         s_rIndex = 0;
-uint16_t         s_offset = 0;
-uint8_t          s_flacStatus = 0;
-uint8_t*         s_flacInptr;
-float            s_flacCompressionRatio = 0;
-uint8_t          s_flacBitBufferLen = 0;
-bool             s_f_flacParseOgg = false;
-bool             s_f_bitReaderError = false;
-uint8_t          s_flac_pageSegments = 0;
-char*            s_flacStreamTitle = NULL;
-char*            s_flacVendorString = NULL;
-bool             s_f_flacNewStreamtitle = false;
-bool             s_f_flacFirstCall = true;
-bool             s_f_oggWrapper = false;
-bool             s_f_lastMetaDataBlock = false;
-bool             s_f_flacNewMetadataBlockPicture = false;
-uint8_t          s_flacPageNr = 0;
-int32_t**        s_samplesBuffer = NULL;
-uint16_t         s_maxBlocksize = MAX_BLOCKSIZE;
-int32_t          s_nBytes = 0;
+
+// Decoder state, one per stream (see FLACDecoder_CreateContext)
+struct FLACDecoder_t {
+    FLACFrameHeader_t*   FLACFrameHeader = NULL;
+    FLACMetadataBlock_t* FLACMetadataBlock = NULL;
+
+    vector<uint32_t>     s_flacSegmTableVec;
+    int32_t              coefs[32];                    // predictor of the current subframe, newest sample first
+    uint8_t              numCoefs = 0;
+    vector<uint32_t>     s_flacBlockPicItem;
+    uint64_t             s_flac_bitBuffer = 0;
+    uint32_t             s_flacBitrate = 0;
+    uint32_t             s_flacBlockPicLenUntilFrameEnd = 0;
+    uint32_t             s_flacCurrentFilePos = 0;
+    uint32_t             s_flacBlockPicPos = 0;
+    uint32_t             s_flacBlockPicLen = 0;
+    uint32_t             s_flacAudioDataStart = 0;
+    int32_t              s_flacRemainBlockPicLen = 0;
+    uint16_t             s_numOfOutSamples = 0;
+    uint16_t             s_flacValidSamples = 0;
+    uint16_t             s_rIndex = 0;
+    uint16_t             s_offset = 0;
+    uint8_t              s_flacStatus = 0;
+    uint8_t*             s_flacInptr = NULL;
+    float                s_flacCompressionRatio = 0;
+    uint8_t              s_flacBitBufferLen = 0;
+    bool                 s_f_flacParseOgg = false;
+    bool                 s_f_bitReaderError = false;
+    uint8_t              s_flac_pageSegments = 0;
+    char*                s_flacStreamTitle = NULL;
+    char*                s_flacVendorString = NULL;
+    bool                 s_f_flacNewStreamtitle = false;
+    bool                 s_f_flacFirstCall = true;
+    bool                 s_f_oggWrapper = false;
+    bool                 s_f_lastMetaDataBlock = false;
+    bool                 s_f_flacNewMetadataBlockPicture = false;
+    uint8_t              s_flacPageNr = 0;
+    int32_t**            s_samplesBuffer = NULL;
+    uint16_t             s_maxBlocksize = MAX_BLOCKSIZE;
+    int32_t              s_nBytes = 0;
+    uint32_t             s_flacSegmLenTmp = 0;
+    int32_t              s_flacSbl = 0;
+};
+
+static FLACDecoder_t s_flacDefault;                      // used by tasks that never call FLACDecoder_SetContext()
+static thread_local FLACDecoder_t* s_flac = &s_flacDefault;
 
 //----------------------------------------------------------------------------------------------------------------------
 //          FLAC INI SECTION
 //----------------------------------------------------------------------------------------------------------------------
 
+FLACDecoder_t* FLACDecoder_CreateContext(){
+    void* mem = AudioMemory::alloc(sizeof(FLACDecoder_t), AUDIO_MEM_INTERNAL_PREFERRED);
+    if(!mem) return NULL;
+    return new (mem) FLACDecoder_t();
+}
+//----------------------------------------------------------------------------------------------------------------------
+void FLACDecoder_DestroyContext(FLACDecoder_t* ctx){
+    if(!ctx || ctx == &s_flacDefault) return;
+    FLACDecoder_t* prev = s_flac;
+    s_flac = ctx;
+    FLACDecoder_FreeBuffers();
+    s_flac = (prev == ctx) ? &s_flacDefault : prev;
+    ctx->~FLACDecoder_t();
+    AudioMemory::release(ctx);
+}
+//----------------------------------------------------------------------------------------------------------------------
+void FLACDecoder_SetContext(FLACDecoder_t* ctx){
+    s_flac = ctx ? ctx : &s_flacDefault;
+}
+//----------------------------------------------------------------------------------------------------------------------
+FLACDecoder_t* FLACDecoder_GetContext(){
+    return s_flac;
+}
+//----------------------------------------------------------------------------------------------------------------------
+
 // prefer PSRAM
 #define __malloc_heap_psram(size) \
-    heap_caps_malloc_prefer(size, 2, MALLOC_CAP_DEFAULT|MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT|MALLOC_CAP_INTERNAL)
+    AudioMemory::alloc(size, AUDIO_MEM_PSRAM_PREFERRED)
 
 bool FLACDecoder_AllocateBuffers(void){
 
-    if(!FLACFrameHeader)    {FLACFrameHeader    = (FLACFrameHeader_t*)    __malloc_heap_psram(sizeof(FLACFrameHeader_t));}
-    if(!FLACMetadataBlock)  {FLACMetadataBlock  = (FLACMetadataBlock_t*)  __malloc_heap_psram(sizeof(FLACMetadataBlock_t));}
-    if(!s_flacStreamTitle)  {s_flacStreamTitle  = (char*)                 __malloc_heap_psram(256);}
+    if(!s_flac->FLACFrameHeader)    {s_flac->FLACFrameHeader    = (FLACFrameHeader_t*)    __malloc_heap_psram(sizeof(FLACFrameHeader_t));}
+    if(!s_flac->FLACMetadataBlock)  {s_flac->FLACMetadataBlock  = (FLACMetadataBlock_t*)  __malloc_heap_psram(sizeof(FLACMetadataBlock_t));}
+    if(!s_flac->s_flacStreamTitle)  {s_flac->s_flacStreamTitle  = (char*)                 __malloc_heap_psram(256);}
 
-    if(!FLACFrameHeader || !FLACMetadataBlock || !s_flacStreamTitle){
+    if(!s_flac->FLACFrameHeader || !s_flac->FLACMetadataBlock || !s_flac->s_flacStreamTitle){
         log_e("not enough memory to allocate flacdecoder buffers");
         return false;
     }
 
-    if(psramFound()){
-        s_samplesBuffer = (int32_t**)ps_malloc(MAX_CHANNELS * sizeof(int32_t*));
-        for (int32_t i = 0; i < MAX_CHANNELS; i++){
-            s_samplesBuffer[i] = (int32_t*)ps_malloc(s_maxBlocksize * sizeof(int32_t));
-            if(!s_samplesBuffer[i]){
-                log_e("not enough memory to allocate flacdecoder buffers");
-                return false;
-            }
-        }
+    s_flac->s_samplesBuffer = (int32_t**)AudioMemory::calloc(MAX_CHANNELS, sizeof(int32_t*), AUDIO_MEM_PSRAM_PREFERRED);
+    if(!s_flac->s_samplesBuffer){
+        log_e("not enough memory to allocate flacdecoder buffers");
+        return false;
     }
-    else  {
-        s_samplesBuffer = (int32_t**)malloc(MAX_CHANNELS * sizeof(int32_t*));
-        for (int32_t i = 0; i < MAX_CHANNELS; i++){
-            s_samplesBuffer[i] = (int32_t*)malloc(s_maxBlocksize * sizeof(int32_t));
-            if(!s_samplesBuffer[i]){
-                log_e("not enough memory to allocate flacdecoder buffers");
-                return false;
-            }
+    for (int32_t i = 0; i < MAX_CHANNELS; i++){
+        s_flac->s_samplesBuffer[i] = (int32_t*)__malloc_heap_psram(s_flac->s_maxBlocksize * sizeof(int32_t));
+        if(!s_flac->s_samplesBuffer[i]){
+            log_e("not enough memory to allocate flacdecoder buffers");
+            return false;
         }
     }
 
     FLACDecoder_ClearBuffer();
     FLACDecoder_setDefaults();
-    s_flacPageNr = 0;
+    s_flac->s_flacPageNr = 0;
     return true;
 }
 //----------------------------------------------------------------------------------------------------------------------
 void FLACDecoder_ClearBuffer(){
-    memset(FLACFrameHeader,   0, sizeof(FLACFrameHeader_t));
-    memset(FLACMetadataBlock, 0, sizeof(FLACMetadataBlock_t));
+    memset(s_flac->FLACFrameHeader,   0, sizeof(FLACFrameHeader_t));
+    memset(s_flac->FLACMetadataBlock, 0, sizeof(FLACMetadataBlock_t));
 
-    if(s_samplesBuffer) {
+    if(s_flac->s_samplesBuffer) {
         for (int32_t i = 0; i < MAX_CHANNELS; i++){
-            memset(s_samplesBuffer[i], 0, s_maxBlocksize * sizeof(int32_t));
+            memset(s_flac->s_samplesBuffer[i], 0, s_flac->s_maxBlocksize * sizeof(int32_t));
         }
     }
 
-    s_flacSegmTableVec.clear(); s_flacSegmTableVec.shrink_to_fit();
-    s_flacStatus = DECODE_FRAME;
+    s_flac->s_flacSegmTableVec.clear(); s_flac->s_flacSegmTableVec.shrink_to_fit();
+    s_flac->s_flacStatus = DECODE_FRAME;
     return;
 }
 //----------------------------------------------------------------------------------------------------------------------
 void FLACDecoder_FreeBuffers(){
-    if(FLACFrameHeader)    {free(FLACFrameHeader);    FLACFrameHeader    = NULL;}
-    if(FLACMetadataBlock)  {free(FLACMetadataBlock);  FLACMetadataBlock  = NULL;}
-    if(s_flacStreamTitle)  {free(s_flacStreamTitle);  s_flacStreamTitle  = NULL;}
-    if(s_flacVendorString) {free(s_flacVendorString); s_flacVendorString = NULL;}
+    if(s_flac->FLACFrameHeader)    {AudioMemory::release(s_flac->FLACFrameHeader);    s_flac->FLACFrameHeader    = NULL;}
+    if(s_flac->FLACMetadataBlock)  {AudioMemory::release(s_flac->FLACMetadataBlock);  s_flac->FLACMetadataBlock  = NULL;}
+    if(s_flac->s_flacStreamTitle)  {AudioMemory::release(s_flac->s_flacStreamTitle);  s_flac->s_flacStreamTitle  = NULL;}
+    if(s_flac->s_flacVendorString) {AudioMemory::release(s_flac->s_flacVendorString); s_flac->s_flacVendorString = NULL;}
 
-    if(s_samplesBuffer){
+    if(s_flac->s_samplesBuffer){
         for (int32_t i = 0; i < MAX_CHANNELS; i++){
-            if(s_samplesBuffer[i]){free(s_samplesBuffer[i]);}
+            if(s_flac->s_samplesBuffer[i]){AudioMemory::release(s_flac->s_samplesBuffer[i]);}
         }
-        free(s_samplesBuffer); s_samplesBuffer = NULL;
+        AudioMemory::release(s_flac->s_samplesBuffer); s_flac->s_samplesBuffer = NULL;
     }
-    coefs.clear(); coefs.shrink_to_fit();
-    s_flacSegmTableVec.clear(); s_flacSegmTableVec.shrink_to_fit();
-    s_flacBlockPicItem.clear(); s_flacBlockPicItem.shrink_to_fit();
+    s_flac->numCoefs = 0;
+    s_flac->s_flacSegmTableVec.clear(); s_flac->s_flacSegmTableVec.shrink_to_fit();
+    s_flac->s_flacBlockPicItem.clear(); s_flac->s_flacBlockPicItem.shrink_to_fit();
 }
 //----------------------------------------------------------------------------------------------------------------------
 void FLACDecoder_setDefaults(){
-    coefs.clear(); coefs.shrink_to_fit();
-    s_flacSegmTableVec.clear(); s_flacSegmTableVec.shrink_to_fit();
-    s_flacBlockPicItem.clear(); s_flacBlockPicItem.shrink_to_fit();
-    s_flac_bitBuffer = 0;
-    s_flacBitrate = 0;
-    s_flacBlockPicLenUntilFrameEnd = 0;
-    s_flacCurrentFilePos = 0;
-    s_flacBlockPicPos = 0;
-    s_flacBlockPicLen = 0;
-    s_flacRemainBlockPicLen = 0;
-    s_flacAudioDataStart = 0;
-    s_numOfOutSamples = 0;
-    s_offset = 0;
-    s_flacValidSamples = 0;
-    s_rIndex = 0;
-    s_flacStatus = DECODE_FRAME;
-    s_flacCompressionRatio = 0;
-    s_flacBitBufferLen = 0;
-    s_flac_pageSegments = 0;
-    s_f_flacNewStreamtitle = false;
-    s_f_flacFirstCall = true;
-    s_f_oggWrapper = false;
-    s_f_lastMetaDataBlock = false;
-    s_f_flacNewMetadataBlockPicture = false;
-    s_f_flacParseOgg = false;
-    s_f_bitReaderError = false;
-    s_nBytes = 0;
+    s_flac->numCoefs = 0;
+    s_flac->s_flacSegmTableVec.clear(); s_flac->s_flacSegmTableVec.shrink_to_fit();
+    s_flac->s_flacBlockPicItem.clear(); s_flac->s_flacBlockPicItem.shrink_to_fit();
+    s_flac->s_flac_bitBuffer = 0;
+    s_flac->s_flacBitrate = 0;
+    s_flac->s_flacBlockPicLenUntilFrameEnd = 0;
+    s_flac->s_flacCurrentFilePos = 0;
+    s_flac->s_flacBlockPicPos = 0;
+    s_flac->s_flacBlockPicLen = 0;
+    s_flac->s_flacRemainBlockPicLen = 0;
+    s_flac->s_flacAudioDataStart = 0;
+    s_flac->s_numOfOutSamples = 0;
+    s_flac->s_offset = 0;
+    s_flac->s_flacValidSamples = 0;
+    s_flac->s_rIndex = 0;
+    s_flac->s_flacStatus = DECODE_FRAME;
+    s_flac->s_flacCompressionRatio = 0;
+    s_flac->s_flacBitBufferLen = 0;
+    s_flac->s_flac_pageSegments = 0;
+    s_flac->s_f_flacNewStreamtitle = false;
+    s_flac->s_f_flacFirstCall = true;
+    s_flac->s_f_oggWrapper = false;
+    s_flac->s_f_lastMetaDataBlock = false;
+    s_flac->s_f_flacNewMetadataBlockPicture = false;
+    s_flac->s_f_flacParseOgg = false;
+    s_flac->s_f_bitReaderError = false;
+    s_flac->s_nBytes = 0;
 }
 //----------------------------------------------------------------------------------------------------------------------
 //            B I T R E A D E R
@@ -168,16 +197,16 @@ const uint32_t mask[] = {0x00000000, 0x00000001, 0x00000003, 0x00000007, 0x00000
                          0x0fffffff, 0x1fffffff, 0x3fffffff, 0x7fffffff, 0xffffffff};
 
 uint32_t readUint(uint8_t nBits, int32_t *bytesLeft){
-    while (s_flacBitBufferLen < nBits){
-        uint8_t temp = *(s_flacInptr + s_rIndex);
-        s_rIndex++;
+    while (s_flac->s_flacBitBufferLen < nBits){
+        uint8_t temp = *(s_flac->s_flacInptr + s_flac->s_rIndex);
+        s_flac->s_rIndex++;
         (*bytesLeft)--;
-        if(*bytesLeft < 0) { log_e("error in bitreader"); s_f_bitReaderError = true; break;}
-        s_flac_bitBuffer = (s_flac_bitBuffer << 8) | temp;
-        s_flacBitBufferLen += 8;
+        if(*bytesLeft < 0) { log_e("error in bitreader"); s_flac->s_f_bitReaderError = true; break;}
+        s_flac->s_flac_bitBuffer = (s_flac->s_flac_bitBuffer << 8) | temp;
+        s_flac->s_flacBitBufferLen += 8;
     }
-    s_flacBitBufferLen -= nBits;
-    uint32_t result = s_flac_bitBuffer >> s_flacBitBufferLen;
+    s_flac->s_flacBitBufferLen -= nBits;
+    uint32_t result = s_flac->s_flac_bitBuffer >> s_flac->s_flacBitBufferLen;
     if (nBits < 32)
         result &= mask[nBits];
     return result;
@@ -198,17 +227,17 @@ int64_t readRiceSignedInt(uint8_t param, int32_t* bytesLeft){
 }
 
 void alignToByte() {
-    s_flacBitBufferLen -= s_flacBitBufferLen % 8;
+    s_flac->s_flacBitBufferLen -= s_flac->s_flacBitBufferLen % 8;
 }
 //----------------------------------------------------------------------------------------------------------------------
 //              F L A C - D E C O D E R
 //----------------------------------------------------------------------------------------------------------------------
 void FLACSetRawBlockParams(uint8_t Chans, uint32_t SampRate, uint8_t BPS, uint32_t tsis, uint32_t AuDaLength){
-    FLACMetadataBlock->numChannels = Chans;
-    FLACMetadataBlock->sampleRate = SampRate;
-    FLACMetadataBlock->bitsPerSample = BPS;
-    FLACMetadataBlock->totalSamples = tsis;  // total samples in stream
-    FLACMetadataBlock->audioDataLength = AuDaLength;
+    s_flac->FLACMetadataBlock->numChannels = Chans;
+    s_flac->FLACMetadataBlock->sampleRate = SampRate;
+    s_flac->FLACMetadataBlock->bitsPerSample = BPS;
+    s_flac->FLACMetadataBlock->totalSamples = tsis;  // total samples in stream
+    s_flac->FLACMetadataBlock->audioDataLength = AuDaLength;
 }
 //----------------------------------------------------------------------------------------------------------------------
 void FLACDecoderReset(){ // set var to default
@@ -219,10 +248,10 @@ void FLACDecoderReset(){ // set var to default
 int32_t FLACFindSyncWord(unsigned char *buf, int32_t nBytes) {
 
     int32_t i = FLAC_specialIndexOf(buf, "OggS", nBytes);
-    if(i == 0) {s_f_bitReaderError = false; return 0;}  // flag has ogg wrapper
+    if(i == 0) {s_flac->s_f_bitReaderError = false; return 0;}  // flag has ogg wrapper
 
-    if(s_f_oggWrapper && i > 0){
-        s_f_bitReaderError = false;
+    if(s_flac->s_f_oggWrapper && i > 0){
+        s_flac->s_f_bitReaderError = false;
         return i;
     }
     else{
@@ -256,16 +285,16 @@ boolean FLACFindMagicWord(unsigned char* buf, int32_t nBytes){
 }
 //----------------------------------------------------------------------------------------------------------------------
 char* FLACgetStreamTitle(){
-    if(s_f_flacNewStreamtitle){
-        s_f_flacNewStreamtitle = false;
-        return s_flacStreamTitle;
+    if(s_flac->s_f_flacNewStreamtitle){
+        s_flac->s_f_flacNewStreamtitle = false;
+        return s_flac->s_flacStreamTitle;
     }
     return NULL;
 }
 //----------------------------------------------------------------------------------------------------------------------
 int32_t FLACparseOGG(uint8_t *inbuf, int32_t *bytesLeft){  // reference https://www.xiph.org/ogg/doc/rfc3533.txt
 
-    s_f_flacParseOgg = false;
+    s_flac->s_f_flacParseOgg = false;
     int32_t idx = FLAC_specialIndexOf(inbuf, "OggS", 6);
     if(idx != 0) return ERR_FLAC_DECODER_ASYNC;
 
@@ -295,8 +324,8 @@ int32_t FLACparseOGG(uint8_t *inbuf, int32_t *bytesLeft){  // reference https://
 
     // read the segment table (contains pageSegments bytes),  1...251: Length of the frame in bytes,
     // 255: A second byte is needed.  The total length is first_byte + second byte
-    s_flacSegmTableVec.clear();
-    s_flacSegmTableVec.shrink_to_fit();
+    s_flac->s_flacSegmTableVec.clear();
+    s_flac->s_flacSegmTableVec.shrink_to_fit();
     for(int32_t i = 0; i < pageSegments; i++){
         int32_t n = *(inbuf + 27 + i);
         while(*(inbuf + 27 + i) == 255){
@@ -304,7 +333,7 @@ int32_t FLACparseOGG(uint8_t *inbuf, int32_t *bytesLeft){  // reference https://
             if(i == pageSegments) break;
             n+= *(inbuf + 27 + i);
         }
-        s_flacSegmTableVec.insert(s_flacSegmTableVec.begin(), n);
+        s_flac->s_flacSegmTableVec.insert(s_flac->s_flacSegmTableVec.begin(), n);
     }
     // for(int32_t i = 0; i< s_flacSegmTableVec.size(); i++){log_w("%i", s_flacSegmTableVec[i]);}
 
@@ -316,26 +345,26 @@ int32_t FLACparseOGG(uint8_t *inbuf, int32_t *bytesLeft){  // reference https://
 
     // log_w("firstPage %i, continuedPage %i, lastPage %i", firstPage, continuedPage, lastPage);
 
-    if(firstPage) s_flacPageNr = 0;
+    if(firstPage) s_flac->s_flacPageNr = 0;
 
     uint32_t headerSize = pageSegments + 27;
 
     *bytesLeft -= headerSize;
-    s_flacCurrentFilePos += headerSize;
+    s_flac->s_flacCurrentFilePos += headerSize;
     return ERR_FLAC_NONE; // no error
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------------------------
 vector<uint32_t> FLACgetMetadataBlockPicture(){
-    if(s_f_flacNewMetadataBlockPicture){
-        s_f_flacNewMetadataBlockPicture = false;
-        return s_flacBlockPicItem;
+    if(s_flac->s_f_flacNewMetadataBlockPicture){
+        s_flac->s_f_flacNewMetadataBlockPicture = false;
+        return s_flac->s_flacBlockPicItem;
     }
-    if(s_flacBlockPicItem.size() > 0){
-        s_flacBlockPicItem.clear();
-        s_flacBlockPicItem.shrink_to_fit();
+    if(s_flac->s_flacBlockPicItem.size() > 0){
+        s_flac->s_flacBlockPicItem.clear();
+        s_flac->s_flacBlockPicItem.shrink_to_fit();
     }
-    return s_flacBlockPicItem;
+    return s_flac->s_flacBlockPicItem;
 }
 //----------------------------------------------------------------------------------------------------------------------------------------------------
 int32_t parseFlacFirstPacket(uint8_t *inbuf, int16_t nBytes){ // 4.2.2. Identification header   https://xiph.org/flac/ogg_mapping.html
@@ -378,7 +407,7 @@ int32_t parseMetaDataBlockHeader(uint8_t *inbuf, int16_t nBytes){
 
     while(true){
         mdBlockHeader         = *(inbuf + pos);
-        s_f_lastMetaDataBlock = mdBlockHeader & 0b10000000; //log_w("lastMdBlockFlag %i", s_f_lastMetaDataBlock);
+        s_flac->s_f_lastMetaDataBlock = mdBlockHeader & 0b10000000; //log_w("lastMdBlockFlag %i", s_f_lastMetaDataBlock);
         blockType             = mdBlockHeader & 0b01111111; //log_w("blockType %i", blockType);
 
         blockLength        = *(inbuf + pos + 1) << 16;
@@ -432,10 +461,10 @@ int32_t parseMetaDataBlockHeader(uint8_t *inbuf, int16_t nBytes){
                 maxBlocksize += *(inbuf + pos + 3);
                 //log_i("minBlocksize %i", minBlocksize);
                 //log_i("maxBlocksize %i", maxBlocksize);
-                FLACMetadataBlock->minblocksize = minBlocksize;
-                FLACMetadataBlock->maxblocksize = maxBlocksize;
+                s_flac->FLACMetadataBlock->minblocksize = minBlocksize;
+                s_flac->FLACMetadataBlock->maxblocksize = maxBlocksize;
 
-                if(maxBlocksize > s_maxBlocksize){log_e("s_blocksize is too big"); return ERR_FLAC_BLOCKSIZE_TOO_BIG;}
+                if(maxBlocksize > s_flac->s_maxBlocksize){log_e("s_blocksize is too big"); return ERR_FLAC_BLOCKSIZE_TOO_BIG;}
 
                 minFrameSize  = *(inbuf + pos + 4) << 16;
                 minFrameSize += *(inbuf + pos + 5) << 8;
@@ -445,22 +474,22 @@ int32_t parseMetaDataBlockHeader(uint8_t *inbuf, int16_t nBytes){
                 maxFrameSize += *(inbuf + pos + 9);
                 //log_i("minFrameSize %i", minFrameSize);
                 //log_i("maxFrameSize %i", maxFrameSize);
-                FLACMetadataBlock->minframesize = minFrameSize;
-                FLACMetadataBlock->maxframesize = maxFrameSize;
+                s_flac->FLACMetadataBlock->minframesize = minFrameSize;
+                s_flac->FLACMetadataBlock->maxframesize = maxFrameSize;
 
                 sampleRate   =  *(inbuf + pos + 10) << 12;
                 sampleRate  +=  *(inbuf + pos + 11) << 4;
                 sampleRate  += (*(inbuf + pos + 12) & 0xF0) >> 4;
                 //log_i("sampleRate %i", sampleRate);
-                FLACMetadataBlock->sampleRate = sampleRate;
+                s_flac->FLACMetadataBlock->sampleRate = sampleRate;
 
                 nrOfChannels = ((*(inbuf + pos + 12) & 0x0E) >> 1) + 1;
                 //log_i("nrOfChannels %i", nrOfChannels);
-                FLACMetadataBlock->numChannels = nrOfChannels;
+                s_flac->FLACMetadataBlock->numChannels = nrOfChannels;
 
                 bitsPerSample  =  (*(inbuf + pos + 12) & 0x01) << 5;
                 bitsPerSample += ((*(inbuf + pos + 13) & 0xF0) >> 4) + 1;
-                FLACMetadataBlock->bitsPerSample = bitsPerSample;
+                s_flac->FLACMetadataBlock->bitsPerSample = bitsPerSample;
                 //log_i("bitsPerSample %i", bitsPerSample);
 
                 totalSamplesInStream  = (uint64_t)(*(inbuf + pos + 17) & 0x0F) << 32;
@@ -469,7 +498,7 @@ int32_t parseMetaDataBlockHeader(uint8_t *inbuf, int16_t nBytes){
                 totalSamplesInStream += (*(inbuf + pos + 15)) << 8;
                 totalSamplesInStream += (*(inbuf + pos + 16));
                 //log_i("totalSamplesInStream %lli", totalSamplesInStream);
-                FLACMetadataBlock->totalSamples = totalSamplesInStream;
+                s_flac->FLACMetadataBlock->totalSamples = totalSamplesInStream;
 
                 //log_i("nBytes %i, blockLength %i", nBytes, blockLength);
                 pos += blockLength;
@@ -485,9 +514,9 @@ int32_t parseMetaDataBlockHeader(uint8_t *inbuf, int16_t nBytes){
                 if(vendorLength > 1024){
                     log_e("vendorLength > 1024 bytes");
                 }
-                if(s_flacVendorString) {free(s_flacVendorString); s_flacVendorString = NULL;}
-                s_flacVendorString = (char*) flac_x_ps_calloc(vendorLength + 1, sizeof(char));
-                memcpy(s_flacVendorString, inbuf + pos + 4, vendorLength);
+                if(s_flac->s_flacVendorString) {AudioMemory::release(s_flac->s_flacVendorString); s_flac->s_flacVendorString = NULL;}
+                s_flac->s_flacVendorString = (char*) flac_x_ps_calloc(vendorLength + 1, sizeof(char));
+                memcpy(s_flac->s_flacVendorString, inbuf + pos + 4, vendorLength);
                 //log_i("%s", s_flacVendorString);
 
                 pos += 4 + vendorLength;
@@ -534,44 +563,44 @@ int32_t parseMetaDataBlockHeader(uint8_t *inbuf, int16_t nBytes){
                     }
                     if((FLAC_specialIndexOf(inbuf + pos + 4, "METADATA_BLOCK_PICTURE", 23) == 0) || (FLAC_specialIndexOf(inbuf + pos + 4, "metadata_block_picture", 23) == 0)){
                         //log_w("METADATA_BLOCK_PICTURE found, commemtStringLength %i", commemtStringLength);
-                        s_flacBlockPicLen = commemtStringLength - 23;
-                        s_flacBlockPicPos = s_flacCurrentFilePos + pos + 4 + 23;
-                        s_flacBlockPicLenUntilFrameEnd = nBytes - (pos + 23);
-                        if(s_flacBlockPicLen < s_flacBlockPicLenUntilFrameEnd) s_flacBlockPicLenUntilFrameEnd = s_flacBlockPicLen;
-                        s_flacRemainBlockPicLen = s_flacBlockPicLen - s_flacBlockPicLenUntilFrameEnd;
+                        s_flac->s_flacBlockPicLen = commemtStringLength - 23;
+                        s_flac->s_flacBlockPicPos = s_flac->s_flacCurrentFilePos + pos + 4 + 23;
+                        s_flac->s_flacBlockPicLenUntilFrameEnd = nBytes - (pos + 23);
+                        if(s_flac->s_flacBlockPicLen < s_flac->s_flacBlockPicLenUntilFrameEnd) s_flac->s_flacBlockPicLenUntilFrameEnd = s_flac->s_flacBlockPicLen;
+                        s_flac->s_flacRemainBlockPicLen = s_flac->s_flacBlockPicLen - s_flac->s_flacBlockPicLenUntilFrameEnd;
                         //log_i("s_flacBlockPicPos %i, s_flacBlockPicLen %i", s_flacBlockPicPos, s_flacBlockPicLen);
                         //log_i("s_flacBlockPicLenUntilFrameEnd %i, s_flacRemainBlockPicLen %i", s_flacBlockPicLenUntilFrameEnd, s_flacRemainBlockPicLen);
-                        if(s_flacRemainBlockPicLen <= 0) s_f_lastMetaDataBlock = true; // exeption:: goto audiopage after commemt if lastMetaDataFlag is not set
-                        if(s_flacBlockPicLen){
-                            s_flacBlockPicItem.clear();
-                            s_flacBlockPicItem.shrink_to_fit();
-                            s_flacBlockPicItem.push_back(s_flacBlockPicPos);
-                            s_flacBlockPicItem.push_back(s_flacBlockPicLenUntilFrameEnd);
+                        if(s_flac->s_flacRemainBlockPicLen <= 0) s_flac->s_f_lastMetaDataBlock = true; // exeption:: goto audiopage after commemt if lastMetaDataFlag is not set
+                        if(s_flac->s_flacBlockPicLen){
+                            s_flac->s_flacBlockPicItem.clear();
+                            s_flac->s_flacBlockPicItem.shrink_to_fit();
+                            s_flac->s_flacBlockPicItem.push_back(s_flac->s_flacBlockPicPos);
+                            s_flac->s_flacBlockPicItem.push_back(s_flac->s_flacBlockPicLenUntilFrameEnd);
                         }
                     }
                     pos += 4 + commemtStringLength;
                     //log_i("nBytes %i, pos %i, commemtStringLength %i", nBytes, pos, commemtStringLength);
                 }
-                memset(s_flacStreamTitle, 0, 256);
+                memset(s_flac->s_flacStreamTitle, 0, 256);
                 if(vb[1] && vb[0]){ // artist and title
-                    strcpy(s_flacStreamTitle, vb[1]);
-                    strcat(s_flacStreamTitle, " - ");
-                    strcat(s_flacStreamTitle, vb[0]);
-                    s_f_flacNewStreamtitle = true;
+                    strcpy(s_flac->s_flacStreamTitle, vb[1]);
+                    strcat(s_flac->s_flacStreamTitle, " - ");
+                    strcat(s_flac->s_flacStreamTitle, vb[0]);
+                    s_flac->s_f_flacNewStreamtitle = true;
                 }
                 else if(vb[1]){
-                    strcpy(s_flacStreamTitle, vb[1]);
-                    s_f_flacNewStreamtitle = true;
+                    strcpy(s_flac->s_flacStreamTitle, vb[1]);
+                    s_flac->s_f_flacNewStreamtitle = true;
                 }
                 else if(vb[0]){
-                    strcpy(s_flacStreamTitle, vb[0]);
-                    s_f_flacNewStreamtitle = true;
+                    strcpy(s_flac->s_flacStreamTitle, vb[0]);
+                    s_flac->s_f_flacNewStreamtitle = true;
                 }
                 for(int32_t i = 0; i < 8; i++){
-                    if(vb[i]){free(vb[i]); vb[i] = NULL;}
+                    if(vb[i]){AudioMemory::release(vb[i]); vb[i] = NULL;}
                 }
 
-                if(!s_flacBlockPicLen && s_flacSegmTableVec.size() == 1) s_f_lastMetaDataBlock = true; // exeption:: goto audiopage after commemt if lastMetaDataFlag is not set
+                if(!s_flac->s_flacBlockPicLen && s_flac->s_flacSegmTableVec.size() == 1) s_flac->s_f_lastMetaDataBlock = true; // exeption:: goto audiopage after commemt if lastMetaDataFlag is not set
                 if(ret == FLAC_PARSE_OGG_DONE) return ret;
                 break;
 
@@ -591,75 +620,74 @@ int8_t FLACDecode(uint8_t *inbuf, int32_t *bytesLeft, int16_t *outbuf){ //  MAIN
 
     int32_t                ret = 0;
     uint32_t           segmLen = 0;
-    static uint32_t segmLenTmp = 0;
 
-    if(s_f_flacFirstCall){ // determine if ogg or flag
-        s_f_flacFirstCall = false;
-        s_nBytes = 0;
-        segmLenTmp = 0;
+    if(s_flac->s_f_flacFirstCall){ // determine if ogg or flag
+        s_flac->s_f_flacFirstCall = false;
+        s_flac->s_nBytes = 0;
+        s_flac->s_flacSegmLenTmp = 0;
         if(FLAC_specialIndexOf(inbuf, "OggS", 5) == 0){
-            s_f_oggWrapper = true;
-            s_f_flacParseOgg = true;
+            s_flac->s_f_oggWrapper = true;
+            s_flac->s_f_flacParseOgg = true;
         }
     }
 
-    if(s_f_oggWrapper){
+    if(s_flac->s_f_oggWrapper){
 
-        if(segmLenTmp){ // can't skip more than 16K
-            if(segmLenTmp > 16384){
-                s_flacCurrentFilePos += 16384;
+        if(s_flac->s_flacSegmLenTmp){ // can't skip more than 16K
+            if(s_flac->s_flacSegmLenTmp > 16384){
+                s_flac->s_flacCurrentFilePos += 16384;
                 *bytesLeft -= 16384;
-                segmLenTmp -= 16384;
+                s_flac->s_flacSegmLenTmp -= 16384;
             }
             else{
-                s_flacCurrentFilePos += segmLenTmp;
-                *bytesLeft -= segmLenTmp;
-                segmLenTmp  = 0;
+                s_flac->s_flacCurrentFilePos += s_flac->s_flacSegmLenTmp;
+                *bytesLeft -= s_flac->s_flacSegmLenTmp;
+                s_flac->s_flacSegmLenTmp  = 0;
             }
             return FLAC_PARSE_OGG_DONE;
         }
 
-        if(s_nBytes > 0){
-            int16_t diff = s_nBytes;
-            if(s_flacAudioDataStart == 0){
-                s_flacAudioDataStart = s_flacCurrentFilePos;
+        if(s_flac->s_nBytes > 0){
+            int16_t diff = s_flac->s_nBytes;
+            if(s_flac->s_flacAudioDataStart == 0){
+                s_flac->s_flacAudioDataStart = s_flac->s_flacCurrentFilePos;
             }
-            ret = FLACDecodeNative(inbuf, &s_nBytes, outbuf);
-            diff -= s_nBytes;
-            s_flacCurrentFilePos += diff;
+            ret = FLACDecodeNative(inbuf, &s_flac->s_nBytes, outbuf);
+            diff -= s_flac->s_nBytes;
+            s_flac->s_flacCurrentFilePos += diff;
             *bytesLeft -= diff;
             return ret;
         }
-        if(s_nBytes < 0){return ERR_FLAC_DECODER_ASYNC;}
+        if(s_flac->s_nBytes < 0){return ERR_FLAC_DECODER_ASYNC;}
 
-        if(s_f_flacParseOgg == true){
-            s_f_flacParseOgg = false;
+        if(s_flac->s_f_flacParseOgg == true){
+            s_flac->s_f_flacParseOgg = false;
             ret = FLACparseOGG(inbuf, bytesLeft);
             if(ret == ERR_FLAC_NONE) return FLAC_PARSE_OGG_DONE; // ok
             else return ret;  // error
         }
         //-------------------------------------------------------
-        if(!s_flacSegmTableVec.size()) log_e("size is 0");
-        segmLen = s_flacSegmTableVec.back();
-        s_flacSegmTableVec.pop_back();
-        if(!s_flacSegmTableVec.size()) s_f_flacParseOgg = true;
+        if(!s_flac->s_flacSegmTableVec.size()) log_e("size is 0");
+        segmLen = s_flac->s_flacSegmTableVec.back();
+        s_flac->s_flacSegmTableVec.pop_back();
+        if(!s_flac->s_flacSegmTableVec.size()) s_flac->s_f_flacParseOgg = true;
         //-------------------------------------------------------
 
-        if(s_flacRemainBlockPicLen <= 0 && !s_f_flacNewMetadataBlockPicture) {
-            if(s_flacBlockPicItem.size() > 0) { // get blockpic data
+        if(s_flac->s_flacRemainBlockPicLen <= 0 && !s_flac->s_f_flacNewMetadataBlockPicture) {
+            if(s_flac->s_flacBlockPicItem.size() > 0) { // get blockpic data
                 // log_i("---------------------------------------------------------------------------");
                 // log_i("metadata blockpic found at pos %i, size %i bytes", s_flacBlockPicPos, s_flacBlockPicLen);
                 // for(int32_t i = 0; i < s_flacBlockPicItem.size(); i += 2) { log_i("segment %02i, pos %07i, len %05i", i / 2, s_flacBlockPicItem[i], s_flacBlockPicItem[i + 1]); }
                 // log_i("---------------------------------------------------------------------------");
-                s_f_flacNewMetadataBlockPicture = true;
+                s_flac->s_f_flacNewMetadataBlockPicture = true;
             }
         }
 
-        switch(s_flacPageNr) {
+        switch(s_flac->s_flacPageNr) {
             case 0:
                 ret = parseFlacFirstPacket(inbuf, segmLen);
                 if(ret == segmLen) {
-                    s_flacPageNr = 1;
+                    s_flac->s_flacPageNr = 1;
                     ret = FLAC_PARSE_OGG_DONE;
                     break;
                 }
@@ -669,34 +697,34 @@ int8_t FLACDecode(uint8_t *inbuf, int32_t *bytesLeft, int16_t *outbuf){ //  MAIN
                 if(ret < segmLen){
                     segmLen -= ret;
                     *bytesLeft -= ret;
-                    s_flacCurrentFilePos += ret;
+                    s_flac->s_flacCurrentFilePos += ret;
                     inbuf += ret;
-                    s_flacPageNr = 1;
+                    s_flac->s_flacPageNr = 1;
                 } /* fallthrough */
             case 1:
-                if(s_flacRemainBlockPicLen > 0){
-                    s_flacRemainBlockPicLen -= segmLen;
+                if(s_flac->s_flacRemainBlockPicLen > 0){
+                    s_flac->s_flacRemainBlockPicLen -= segmLen;
                     //log_i("s_flacCurrentFilePos %i, len %i, s_flacRemainBlockPicLen %i", s_flacCurrentFilePos, segmLen, s_flacRemainBlockPicLen);
-                    s_flacBlockPicItem.push_back(s_flacCurrentFilePos);
-                    s_flacBlockPicItem.push_back(segmLen);
-                    if(s_flacRemainBlockPicLen <= 0){s_flacPageNr = 2;}
+                    s_flac->s_flacBlockPicItem.push_back(s_flac->s_flacCurrentFilePos);
+                    s_flac->s_flacBlockPicItem.push_back(segmLen);
+                    if(s_flac->s_flacRemainBlockPicLen <= 0){s_flac->s_flacPageNr = 2;}
                     ret = FLAC_PARSE_OGG_DONE;
                     break;
                 }
                 ret = parseMetaDataBlockHeader(inbuf, segmLen);
-                if(s_f_lastMetaDataBlock) s_flacPageNr = 2;
+                if(s_flac->s_f_lastMetaDataBlock) s_flac->s_flacPageNr = 2;
                 break;
             case 2:
-                s_nBytes = segmLen;
+                s_flac->s_nBytes = segmLen;
                 return FLAC_PARSE_OGG_DONE;
                 break;
         }
         if(segmLen > 16384){
-            segmLenTmp = segmLen;
+            s_flac->s_flacSegmLenTmp = segmLen;
             return FLAC_PARSE_OGG_DONE;
         }
         *bytesLeft -= segmLen;
-        s_flacCurrentFilePos += segmLen;
+        s_flac->s_flacCurrentFilePos += segmLen;
         return ret;
     }
     ret = FLACDecodeNative(inbuf, bytesLeft, outbuf);
@@ -706,55 +734,54 @@ int8_t FLACDecode(uint8_t *inbuf, int32_t *bytesLeft, int16_t *outbuf){ //  MAIN
 int8_t FLACDecodeNative(uint8_t *inbuf, int32_t *bytesLeft, int16_t *outbuf){
 
     int32_t bl = *bytesLeft;
-    static int32_t sbl = 0;
 
-    if(s_flacStatus != OUT_SAMPLES){
-        s_rIndex = 0;
-        s_flacInptr = inbuf;
+    if(s_flac->s_flacStatus != OUT_SAMPLES){
+        s_flac->s_rIndex = 0;
+        s_flac->s_flacInptr = inbuf;
     }
 
-    while(s_flacStatus == DECODE_FRAME){// Read a ton of header fields, and ignore most of them
+    while(s_flac->s_flacStatus == DECODE_FRAME){// Read a ton of header fields, and ignore most of them
         int32_t ret = flacDecodeFrame (inbuf, bytesLeft);
         if(ret != 0) return ret;
         if(*bytesLeft < MAX_BLOCKSIZE) return FLAC_DECODE_FRAMES_LOOP; // need more data
-        sbl += bl - *bytesLeft;
+        s_flac->s_flacSbl += bl - *bytesLeft;
     }
 
-    if(s_flacStatus == DECODE_SUBFRAMES){
+    if(s_flac->s_flacStatus == DECODE_SUBFRAMES){
         // Decode each channel's subframe, then skip footer
         int32_t ret = decodeSubframes(bytesLeft);
         if(ret != 0) return ret;
-        s_flacStatus = OUT_SAMPLES;
-        sbl += bl - *bytesLeft;
+        s_flac->s_flacStatus = OUT_SAMPLES;
+        s_flac->s_flacSbl += bl - *bytesLeft;
     }
 
-    if(s_flacStatus == OUT_SAMPLES){  // Write the decoded samples
+    if(s_flac->s_flacStatus == OUT_SAMPLES){  // Write the decoded samples
         // blocksize can be much greater than outbuff, so we can't stuff all in once
         // therefore we need often more than one loop (split outputblock into pieces)
         uint16_t blockSize;
-        if(s_numOfOutSamples < s_flacOutBuffSize + s_offset) blockSize = s_numOfOutSamples - s_offset;
+        if(s_flac->s_numOfOutSamples < s_flacOutBuffSize + s_flac->s_offset) blockSize = s_flac->s_numOfOutSamples - s_flac->s_offset;
         else blockSize = s_flacOutBuffSize;
 
         for (int32_t i = 0; i < blockSize; i++) {
-            for (int32_t j = 0; j < FLACMetadataBlock->numChannels; j++) {
-                int32_t val = s_samplesBuffer[j][i + s_offset];
-                if (FLACMetadataBlock->bitsPerSample == 8) val += 128;
+            for (int32_t j = 0; j < s_flac->FLACMetadataBlock->numChannels; j++) {
+                int32_t val = s_flac->s_samplesBuffer[j][i + s_flac->s_offset];
+                if (s_flac->FLACMetadataBlock->bitsPerSample == 8) val += 128;
                 outbuf[2*i+j] = val;
             }
         }
 
-        s_flacValidSamples = blockSize * FLACMetadataBlock->numChannels;
-        s_offset += blockSize;
-        if(sbl > 0){
-            s_flacCompressionRatio = (float)((s_flacValidSamples * 2) * FLACMetadataBlock->numChannels) / sbl; // valid samples are 16 bit
-            sbl = 0;
-            s_flacBitrate = FLACMetadataBlock->sampleRate * FLACMetadataBlock->bitsPerSample * FLACMetadataBlock->numChannels;
-            s_flacBitrate /= s_flacCompressionRatio;
+        s_flac->s_flacValidSamples = blockSize * s_flac->FLACMetadataBlock->numChannels;
+        s_flac->s_offset += blockSize;
+        if(s_flac->s_flacSbl > 0){
+            s_flac->s_flacCompressionRatio = (float)((s_flac->s_flacValidSamples * 2) * s_flac->FLACMetadataBlock->numChannels) / s_flac->s_flacSbl; // valid samples are 16 bit
+            s_flac->s_flacSbl = 0;
+            s_flac->s_flacBitrate = s_flac->FLACMetadataBlock->sampleRate * s_flac->FLACMetadataBlock->bitsPerSample * s_flac->FLACMetadataBlock->numChannels;
+            s_flac->s_flacBitrate /= s_flac->s_flacCompressionRatio;
       //      log_e("s_flacBitrate %i, s_flacCompressionRatio %f, FLACMetadataBlock->sampleRate %i ", s_flacBitrate, s_flacCompressionRatio, FLACMetadataBlock->sampleRate);
         }
-        if(s_offset != s_numOfOutSamples) return GIVE_NEXT_LOOP;
-        if(s_offset > s_numOfOutSamples) { log_e("offset has a wrong value"); }
-        s_offset = 0;
+        if(s_flac->s_offset != s_flac->s_numOfOutSamples) return GIVE_NEXT_LOOP;
+        if(s_flac->s_offset > s_flac->s_numOfOutSamples) { log_e("offset has a wrong value"); }
+        s_flac->s_offset = 0;
     }
 
     alignToByte();
@@ -762,49 +789,49 @@ int8_t FLACDecodeNative(uint8_t *inbuf, int32_t *bytesLeft, int16_t *outbuf){
 
 //    s_flacCompressionRatio = (float)m_bytesDecoded / (float)s_numOfOutSamples * FLACMetadataBlock->numChannels * (16/8);
 //    log_i("s_flacCompressionRatio % f", s_flacCompressionRatio);
-    s_flacStatus = DECODE_FRAME;
+    s_flac->s_flacStatus = DECODE_FRAME;
     return ERR_FLAC_NONE;
 }
 //----------------------------------------------------------------------------------------------------------------------
 int8_t flacDecodeFrame(uint8_t *inbuf, int32_t *bytesLeft){
-    if(FLAC_specialIndexOf(inbuf, "OggS", *bytesLeft) == 0){ // async? => new sync is OggS => reset and decode (not page 0 or 1)
+    if(*bytesLeft >= 4 && memcmp(inbuf, "OggS", 4) == 0){ // async? => new sync is OggS => reset and decode (not page 0 or 1)
         FLACDecoderReset();
-        s_flacPageNr = 2;
+        s_flac->s_flacPageNr = 2;
         return OGG_SYNC_FOUND;
     }
     readUint(14 + 1, bytesLeft); // synccode + reserved bit
-    FLACFrameHeader->blockingStrategy = readUint(1, bytesLeft);
-    FLACFrameHeader->blockSizeCode = readUint(4, bytesLeft);
-    FLACFrameHeader->sampleRateCode = readUint(4, bytesLeft);
-    FLACFrameHeader->chanAsgn = readUint(4, bytesLeft);
-    FLACFrameHeader->sampleSizeCode = readUint(3, bytesLeft);
-    if(!FLACMetadataBlock->numChannels){
-        if(FLACFrameHeader->chanAsgn == 0) FLACMetadataBlock->numChannels = 1;
-        if(FLACFrameHeader->chanAsgn == 1) FLACMetadataBlock->numChannels = 2;
-        if(FLACFrameHeader->chanAsgn > 7)  FLACMetadataBlock->numChannels = 2;
+    s_flac->FLACFrameHeader->blockingStrategy = readUint(1, bytesLeft);
+    s_flac->FLACFrameHeader->blockSizeCode = readUint(4, bytesLeft);
+    s_flac->FLACFrameHeader->sampleRateCode = readUint(4, bytesLeft);
+    s_flac->FLACFrameHeader->chanAsgn = readUint(4, bytesLeft);
+    s_flac->FLACFrameHeader->sampleSizeCode = readUint(3, bytesLeft);
+    if(!s_flac->FLACMetadataBlock->numChannels){
+        if(s_flac->FLACFrameHeader->chanAsgn == 0) s_flac->FLACMetadataBlock->numChannels = 1;
+        if(s_flac->FLACFrameHeader->chanAsgn == 1) s_flac->FLACMetadataBlock->numChannels = 2;
+        if(s_flac->FLACFrameHeader->chanAsgn > 7)  s_flac->FLACMetadataBlock->numChannels = 2;
     }
-    if(FLACMetadataBlock->numChannels < 1) return ERR_FLAC_UNKNOWN_CHANNEL_ASSIGNMENT;
-    if(!FLACMetadataBlock->bitsPerSample){
-        if(FLACFrameHeader->sampleSizeCode == 1) FLACMetadataBlock->bitsPerSample =  8;
-        if(FLACFrameHeader->sampleSizeCode == 2) FLACMetadataBlock->bitsPerSample = 12;
-        if(FLACFrameHeader->sampleSizeCode == 4) FLACMetadataBlock->bitsPerSample = 16;
-        if(FLACFrameHeader->sampleSizeCode == 5) FLACMetadataBlock->bitsPerSample = 20;
-        if(FLACFrameHeader->sampleSizeCode == 6) FLACMetadataBlock->bitsPerSample = 24;
+    if(s_flac->FLACMetadataBlock->numChannels < 1) return ERR_FLAC_UNKNOWN_CHANNEL_ASSIGNMENT;
+    if(!s_flac->FLACMetadataBlock->bitsPerSample){
+        if(s_flac->FLACFrameHeader->sampleSizeCode == 1) s_flac->FLACMetadataBlock->bitsPerSample =  8;
+        if(s_flac->FLACFrameHeader->sampleSizeCode == 2) s_flac->FLACMetadataBlock->bitsPerSample = 12;
+        if(s_flac->FLACFrameHeader->sampleSizeCode == 4) s_flac->FLACMetadataBlock->bitsPerSample = 16;
+        if(s_flac->FLACFrameHeader->sampleSizeCode == 5) s_flac->FLACMetadataBlock->bitsPerSample = 20;
+        if(s_flac->FLACFrameHeader->sampleSizeCode == 6) s_flac->FLACMetadataBlock->bitsPerSample = 24;
     }
-    if(FLACMetadataBlock->bitsPerSample > 16) return ERR_FLAC_BITS_PER_SAMPLE_TOO_BIG;
-    if(FLACMetadataBlock->bitsPerSample < 8 ) return ERR_FLAC_BITS_PER_SAMPLE_UNKNOWN;
-    if(!FLACMetadataBlock->sampleRate){
-        if(FLACFrameHeader->sampleRateCode == 1)  FLACMetadataBlock->sampleRate =  88200;
-        if(FLACFrameHeader->sampleRateCode == 2)  FLACMetadataBlock->sampleRate = 176400;
-        if(FLACFrameHeader->sampleRateCode == 3)  FLACMetadataBlock->sampleRate = 192000;
-        if(FLACFrameHeader->sampleRateCode == 4)  FLACMetadataBlock->sampleRate =   8000;
-        if(FLACFrameHeader->sampleRateCode == 5)  FLACMetadataBlock->sampleRate =  16000;
-        if(FLACFrameHeader->sampleRateCode == 6)  FLACMetadataBlock->sampleRate =  22050;
-        if(FLACFrameHeader->sampleRateCode == 7)  FLACMetadataBlock->sampleRate =  24000;
-        if(FLACFrameHeader->sampleRateCode == 8)  FLACMetadataBlock->sampleRate =  32000;
-        if(FLACFrameHeader->sampleRateCode == 9)  FLACMetadataBlock->sampleRate =  44100;
-        if(FLACFrameHeader->sampleRateCode == 10) FLACMetadataBlock->sampleRate =  48000;
-        if(FLACFrameHeader->sampleRateCode == 11) FLACMetadataBlock->sampleRate =  96000;
+    if(s_flac->FLACMetadataBlock->bitsPerSample > 16) return ERR_FLAC_BITS_PER_SAMPLE_TOO_BIG;
+    if(s_flac->FLACMetadataBlock->bitsPerSample < 8 ) return ERR_FLAC_BITS_PER_SAMPLE_UNKNOWN;
+    if(!s_flac->FLACMetadataBlock->sampleRate){
+        if(s_flac->FLACFrameHeader->sampleRateCode == 1)  s_flac->FLACMetadataBlock->sampleRate =  88200;
+        if(s_flac->FLACFrameHeader->sampleRateCode == 2)  s_flac->FLACMetadataBlock->sampleRate = 176400;
+        if(s_flac->FLACFrameHeader->sampleRateCode == 3)  s_flac->FLACMetadataBlock->sampleRate = 192000;
+        if(s_flac->FLACFrameHeader->sampleRateCode == 4)  s_flac->FLACMetadataBlock->sampleRate =   8000;
+        if(s_flac->FLACFrameHeader->sampleRateCode == 5)  s_flac->FLACMetadataBlock->sampleRate =  16000;
+        if(s_flac->FLACFrameHeader->sampleRateCode == 6)  s_flac->FLACMetadataBlock->sampleRate =  22050;
+        if(s_flac->FLACFrameHeader->sampleRateCode == 7)  s_flac->FLACMetadataBlock->sampleRate =  24000;
+        if(s_flac->FLACFrameHeader->sampleRateCode == 8)  s_flac->FLACMetadataBlock->sampleRate =  32000;
+        if(s_flac->FLACFrameHeader->sampleRateCode == 9)  s_flac->FLACMetadataBlock->sampleRate =  44100;
+        if(s_flac->FLACFrameHeader->sampleRateCode == 10) s_flac->FLACMetadataBlock->sampleRate =  48000;
+        if(s_flac->FLACFrameHeader->sampleRateCode == 11) s_flac->FLACMetadataBlock->sampleRate =  96000;
     }
     readUint(1, bytesLeft);
     uint32_t temp = (readUint(8, bytesLeft) << 24);
@@ -817,66 +844,66 @@ int8_t flacDecodeFrame(uint8_t *inbuf, int32_t *bytesLeft){
     }
     count--;
     for (int32_t i = 0; i < count; i++) readUint(8, bytesLeft);
-    s_numOfOutSamples = 0;
-    if (FLACFrameHeader->blockSizeCode == 1)
-        s_numOfOutSamples = 192;
-    else if (2 <= FLACFrameHeader->blockSizeCode && FLACFrameHeader->blockSizeCode <= 5)
-        s_numOfOutSamples = 576 << (FLACFrameHeader->blockSizeCode - 2);
-    else if (FLACFrameHeader->blockSizeCode == 6)
-        s_numOfOutSamples = readUint(8, bytesLeft) + 1;
-    else if (FLACFrameHeader->blockSizeCode == 7)
-        s_numOfOutSamples = readUint(16, bytesLeft) + 1;
-    else if (8 <= FLACFrameHeader->blockSizeCode && FLACFrameHeader->blockSizeCode <= 15)
-        s_numOfOutSamples = 256 << (FLACFrameHeader->blockSizeCode - 8);
+    s_flac->s_numOfOutSamples = 0;
+    if (s_flac->FLACFrameHeader->blockSizeCode == 1)
+        s_flac->s_numOfOutSamples = 192;
+    else if (2 <= s_flac->FLACFrameHeader->blockSizeCode && s_flac->FLACFrameHeader->blockSizeCode <= 5)
+        s_flac->s_numOfOutSamples = 576 << (s_flac->FLACFrameHeader->blockSizeCode - 2);
+    else if (s_flac->FLACFrameHeader->blockSizeCode == 6)
+        s_flac->s_numOfOutSamples = readUint(8, bytesLeft) + 1;
+    else if (s_flac->FLACFrameHeader->blockSizeCode == 7)
+        s_flac->s_numOfOutSamples = readUint(16, bytesLeft) + 1;
+    else if (8 <= s_flac->FLACFrameHeader->blockSizeCode && s_flac->FLACFrameHeader->blockSizeCode <= 15)
+        s_flac->s_numOfOutSamples = 256 << (s_flac->FLACFrameHeader->blockSizeCode - 8);
     else{
         return ERR_FLAC_RESERVED_BLOCKSIZE_UNSUPPORTED;
     }
-    if(s_numOfOutSamples > MAX_OUTBUFFSIZE){
-        log_e("Error: blockSizeOut too big ,%i bytes", s_numOfOutSamples);
+    if(s_flac->s_numOfOutSamples > MAX_OUTBUFFSIZE){
+        log_e("Error: blockSizeOut too big ,%i bytes", s_flac->s_numOfOutSamples);
         return ERR_FLAC_BLOCKSIZE_TOO_BIG;
     }
-    if(FLACFrameHeader->sampleRateCode == 12)
+    if(s_flac->FLACFrameHeader->sampleRateCode == 12)
         readUint(8, bytesLeft);
-    else if (FLACFrameHeader->sampleRateCode == 13 || FLACFrameHeader->sampleRateCode == 14){
+    else if (s_flac->FLACFrameHeader->sampleRateCode == 13 || s_flac->FLACFrameHeader->sampleRateCode == 14){
         readUint(16, bytesLeft);
     }
     readUint(8, bytesLeft);
-    s_flacStatus = DECODE_SUBFRAMES;
+    s_flac->s_flacStatus = DECODE_SUBFRAMES;
     return ERR_FLAC_NONE;
 }
 //----------------------------------------------------------------------------------------------------------------------
 uint16_t FLACGetOutputSamps(){
-    int32_t vs = s_flacValidSamples;
-    s_flacValidSamples=0;
+    int32_t vs = s_flac->s_flacValidSamples;
+    s_flac->s_flacValidSamples=0;
     return vs;
 }
 //----------------------------------------------------------------------------------------------------------------------
 uint64_t FLACGetTotoalSamplesInStream(){
-    if(!FLACMetadataBlock) return 0;
-    return FLACMetadataBlock->totalSamples;
+    if(!s_flac->FLACMetadataBlock) return 0;
+    return s_flac->FLACMetadataBlock->totalSamples;
 }
 //----------------------------------------------------------------------------------------------------------------------
 uint8_t FLACGetBitsPerSample(){
-    if(!FLACMetadataBlock) return 0;
-    return FLACMetadataBlock->bitsPerSample;
+    if(!s_flac->FLACMetadataBlock) return 0;
+    return s_flac->FLACMetadataBlock->bitsPerSample;
 }
 //----------------------------------------------------------------------------------------------------------------------
 uint8_t FLACGetChannels(){
-    if(!FLACMetadataBlock) return 0;
-    return FLACMetadataBlock->numChannels;
+    if(!s_flac->FLACMetadataBlock) return 0;
+    return s_flac->FLACMetadataBlock->numChannels;
 }
 //----------------------------------------------------------------------------------------------------------------------
 uint32_t FLACGetSampRate(){
-    if(!FLACMetadataBlock) return 0;
-    return FLACMetadataBlock->sampleRate;
+    if(!s_flac->FLACMetadataBlock) return 0;
+    return s_flac->FLACMetadataBlock->sampleRate;
 }
 //----------------------------------------------------------------------------------------------------------------------
 uint32_t FLACGetBitRate(){
-    return s_flacBitrate;
+    return s_flac->s_flacBitrate;
 }
 //----------------------------------------------------------------------------------------------------------------------
 uint32_t FLACGetAudioDataStart(){
-    return s_flacAudioDataStart;
+    return s_flac->s_flacAudioDataStart;
 }
 //----------------------------------------------------------------------------------------------------------------------
 uint32_t FLACGetAudioFileDuration() {
@@ -888,38 +915,38 @@ uint32_t FLACGetAudioFileDuration() {
 }
 //----------------------------------------------------------------------------------------------------------------------
 int8_t decodeSubframes(int32_t* bytesLeft){
-    if(FLACFrameHeader->chanAsgn <= 7) {
-        for (int32_t ch = 0; ch < FLACMetadataBlock->numChannels; ch++)
-            decodeSubframe(FLACMetadataBlock->bitsPerSample, ch, bytesLeft);
+    if(s_flac->FLACFrameHeader->chanAsgn <= 7) {
+        for (int32_t ch = 0; ch < s_flac->FLACMetadataBlock->numChannels; ch++)
+            decodeSubframe(s_flac->FLACMetadataBlock->bitsPerSample, ch, bytesLeft);
     }
-    else if (8 <= FLACFrameHeader->chanAsgn && FLACFrameHeader->chanAsgn <= 10) {
-        decodeSubframe(FLACMetadataBlock->bitsPerSample + (FLACFrameHeader->chanAsgn == 9 ? 1 : 0), 0, bytesLeft);
-        decodeSubframe(FLACMetadataBlock->bitsPerSample + (FLACFrameHeader->chanAsgn == 9 ? 0 : 1), 1, bytesLeft);
-        if(FLACFrameHeader->chanAsgn == 8) {
-            for (int32_t i = 0; i < s_numOfOutSamples; i++)
-                s_samplesBuffer[1][i] = (
-                        s_samplesBuffer[0][i] -
-                        s_samplesBuffer[1][i]);
+    else if (8 <= s_flac->FLACFrameHeader->chanAsgn && s_flac->FLACFrameHeader->chanAsgn <= 10) {
+        decodeSubframe(s_flac->FLACMetadataBlock->bitsPerSample + (s_flac->FLACFrameHeader->chanAsgn == 9 ? 1 : 0), 0, bytesLeft);
+        decodeSubframe(s_flac->FLACMetadataBlock->bitsPerSample + (s_flac->FLACFrameHeader->chanAsgn == 9 ? 0 : 1), 1, bytesLeft);
+        if(s_flac->FLACFrameHeader->chanAsgn == 8) {
+            for (int32_t i = 0; i < s_flac->s_numOfOutSamples; i++)
+                s_flac->s_samplesBuffer[1][i] = (
+                        s_flac->s_samplesBuffer[0][i] -
+                        s_flac->s_samplesBuffer[1][i]);
         }
-        else if (FLACFrameHeader->chanAsgn == 9) {
-            for (int32_t i = 0; i < s_numOfOutSamples; i++)
-                s_samplesBuffer[0][i] += s_samplesBuffer[1][i];
+        else if (s_flac->FLACFrameHeader->chanAsgn == 9) {
+            for (int32_t i = 0; i < s_flac->s_numOfOutSamples; i++)
+                s_flac->s_samplesBuffer[0][i] += s_flac->s_samplesBuffer[1][i];
         }
-        else if (FLACFrameHeader->chanAsgn == 10) {
-            for (int32_t i = 0; i < s_numOfOutSamples; i++) {
-                int32_t side =  s_samplesBuffer[1][i];
-                int32_t right = s_samplesBuffer[0][i] - (side >> 1);
-                s_samplesBuffer[1][i] = right;
-                s_samplesBuffer[0][i] = right + side;
+        else if (s_flac->FLACFrameHeader->chanAsgn == 10) {
+            for (int32_t i = 0; i < s_flac->s_numOfOutSamples; i++) {
+                int32_t side =  s_flac->s_samplesBuffer[1][i];
+                int32_t right = s_flac->s_samplesBuffer[0][i] - (side >> 1);
+                s_flac->s_samplesBuffer[1][i] = right;
+                s_flac->s_samplesBuffer[0][i] = right + side;
             }
         }
         else {
-            log_e("unknown channel assignment, %i", FLACFrameHeader->chanAsgn);
+            log_e("unknown channel assignment, %i", s_flac->FLACFrameHeader->chanAsgn);
             return ERR_FLAC_UNKNOWN_CHANNEL_ASSIGNMENT;
         }
     }
     else{
-        log_e("Reserved channel assignment, %i", FLACFrameHeader->chanAsgn);
+        log_e("Reserved channel assignment, %i", s_flac->FLACFrameHeader->chanAsgn);
         return ERR_FLAC_RESERVED_CHANNEL_ASSIGNMENT;
     }
     return ERR_FLAC_NONE;
@@ -946,13 +973,13 @@ int8_t decodeSubframe(uint8_t sampleDepth, uint8_t ch, int32_t* bytesLeft) {
 
     if(type == 0){  // Constant coding
         int32_t s= readSignedInt(sampleDepth, bytesLeft);                                    // SUBFRAME_CONSTANT
-        for(int32_t i = 0; i < s_numOfOutSamples; i++){
-            s_samplesBuffer[ch][i] = s;
+        for(int32_t i = 0; i < s_flac->s_numOfOutSamples; i++){
+            s_flac->s_samplesBuffer[ch][i] = s;
         }
     }
     else if (type == 1) {  // Verbatim coding
-        for (int32_t i = 0; i < s_numOfOutSamples; i++)
-            s_samplesBuffer[ch][i] = readSignedInt(sampleDepth, bytesLeft);                  // SUBFRAME_VERBATIM
+        for (int32_t i = 0; i < s_flac->s_numOfOutSamples; i++)
+            s_flac->s_samplesBuffer[ch][i] = readSignedInt(sampleDepth, bytesLeft);                  // SUBFRAME_VERBATIM
     }
     else if (8 <= type && type <= 12){
         ret = decodeFixedPredictionSubframe(type - 8, sampleDepth, ch, bytesLeft);           // SUBFRAME_FIXED
@@ -966,8 +993,8 @@ int8_t decodeSubframe(uint8_t sampleDepth, uint8_t ch, int32_t* bytesLeft) {
         return ERR_FLAC_RESERVED_SUB_TYPE;
     }
     if(shift>0){
-        for (int32_t i = 0; i < s_numOfOutSamples; i++){
-            s_samplesBuffer[ch][i] <<= shift;
+        for (int32_t i = 0; i < s_flac->s_numOfOutSamples; i++){
+            s_flac->s_samplesBuffer[ch][i] <<= shift;
         }
     }
     return ERR_FLAC_NONE;
@@ -977,16 +1004,13 @@ int8_t decodeFixedPredictionSubframe(uint8_t predOrder, uint8_t sampleDepth, uin
 
     uint8_t ret = 0;
     for(uint8_t i = 0; i < predOrder; i++)
-        s_samplesBuffer[ch][i] = readSignedInt(sampleDepth, bytesLeft); // Unencoded warm-up samples (n = frame's bits-per-sample * predictor order).
+        s_flac->s_samplesBuffer[ch][i] = readSignedInt(sampleDepth, bytesLeft); // Unencoded warm-up samples (n = frame's bits-per-sample * predictor order).
     ret = decodeResiduals(predOrder, ch, bytesLeft);
     if(ret) return ret;
-    coefs.clear(); coefs.shrink_to_fit();
-    if(predOrder == 0) coefs.resize(0);
-    if(predOrder == 1) coefs.push_back(1);  // FIXED_PREDICTION_COEFFICIENTS
-    if(predOrder == 2){coefs.push_back(2); coefs.push_back(-1);}
-    if(predOrder == 3){coefs.push_back(3); coefs.push_back(-3); coefs.push_back(1);}
-    if(predOrder == 4){coefs.push_back(4); coefs.push_back(-6); coefs.push_back(4); coefs.push_back(-1);}
     if(predOrder > 4) return ERR_FLAC_PREORDER_TOO_BIG; // Error: preorder > 4"
+    static const int32_t fixedCoefs[5][4] = {{0}, {1}, {2, -1}, {3, -3, 1}, {4, -6, 4, -1}}; // FIXED_PREDICTION_COEFFICIENTS
+    memcpy(s_flac->coefs, fixedCoefs[predOrder], predOrder * sizeof(int32_t));
+    s_flac->numCoefs = predOrder;
     restoreLinearPrediction(ch, 0);
     return ERR_FLAC_NONE;
 }
@@ -995,68 +1019,195 @@ int8_t decodeLinearPredictiveCodingSubframe(int32_t lpcOrder, int32_t sampleDept
 
     int8_t ret = 0;
     for (int32_t i = 0; i < lpcOrder; i++){
-        s_samplesBuffer[ch][i] = readSignedInt(sampleDepth, bytesLeft); // Unencoded warm-up samples (n = frame's bits-per-sample * lpc order).
+        s_flac->s_samplesBuffer[ch][i] = readSignedInt(sampleDepth, bytesLeft); // Unencoded warm-up samples (n = frame's bits-per-sample * lpc order).
     }
     int32_t precision = readUint(4, bytesLeft) + 1;                         // (Quantized linear predictor coefficients' precision in bits)-1 (1111 = invalid).
     int32_t shift = readSignedInt(5, bytesLeft);                            // Quantized linear predictor coefficient shift needed in bits (NOTE: this number is signed two's-complement).
-    coefs.clear(); coefs.shrink_to_fit();
     for (uint8_t i = 0; i < lpcOrder; i++){
-        coefs.push_back(readSignedInt(precision, bytesLeft));           // Unencoded predictor coefficients (n = qlp coeff precision * lpc order) (NOTE: the coefficients are signed two's-complement).
+        s_flac->coefs[i] = readSignedInt(precision, bytesLeft);                 // Unencoded predictor coefficients (n = qlp coeff precision * lpc order) (NOTE: the coefficients are signed two's-complement).
     }
+    s_flac->numCoefs = lpcOrder;
     ret = decodeResiduals(lpcOrder, ch, bytesLeft);
     if(ret) return ret;
     restoreLinearPrediction(ch, shift);
     return ERR_FLAC_NONE;
 }
 //----------------------------------------------------------------------------------------------------------------------
+// Residuals are read through a local copy of the bit reader: a 64 bit cache refilled 32 bits at a time, so a Rice
+// code costs a count-leading-zeros and two shifts instead of one readUint() call per bit. Whole bytes still in the
+// cache are handed back at the end, so readUint() continues exactly where the residuals ended.
+struct FLACBitCache {
+    uint64_t       cache;  // the low 'bits' bits are unread, oldest first
+    int32_t        bits;
+    const uint8_t* ptr;
+    int32_t        avail;  // input bytes not yet in the cache
+};
+
+static inline void bitCacheRefill(FLACBitCache& b){
+    if(b.bits <= 32 && b.avail >= 4){
+        uint32_t w = ((uint32_t)b.ptr[0] << 24) | ((uint32_t)b.ptr[1] << 16) | ((uint32_t)b.ptr[2] << 8) | b.ptr[3];
+        b.cache = (b.cache << 32) | w;
+        b.ptr += 4; b.avail -= 4; b.bits += 32;
+        return;
+    }
+    while(b.bits <= 56 && b.avail > 0){ // end of the input
+        b.cache = (b.cache << 8) | *b.ptr++;
+        b.avail--; b.bits += 8;
+    }
+}
+
+static inline bool bitCacheRead(FLACBitCache& b, int32_t nBits, uint32_t* val){ // nBits <= 32
+    if(b.bits < nBits){
+        bitCacheRefill(b);
+        if(b.bits < nBits) return false;
+    }
+    b.bits -= nBits;
+    *val = nBits ? (uint32_t)(b.cache >> b.bits) & mask[nBits] : 0;
+    return true;
+}
+
+// Write the cache back to the readUint() state, whole bytes read ahead are returned to the input
+static void bitCacheStore(FLACBitCache& b, int32_t* bytesLeft){
+    int32_t unread = b.bits >> 3;
+    b.cache  = unread < 8 ? b.cache >> (unread * 8) : 0;
+    b.bits  -= unread * 8;
+    b.ptr   -= unread;
+    b.avail += unread;
+    s_flac->s_flac_bitBuffer   = b.cache;
+    s_flac->s_flacBitBufferLen = b.bits;
+    s_flac->s_rIndex = b.ptr - s_flac->s_flacInptr;
+    *bytesLeft = b.avail;
+}
+
+// Decode one Rice partition, returns false on input underflow
+static bool decodeRicePartition(FLACBitCache& b, int32_t* out, int32_t count, int32_t param){
+    for(int32_t j = 0; j < count; j++){
+        uint32_t q = 0;
+        for(;;){ // unary quotient: count zeros up to the stop bit
+            if(b.bits == 0){
+                bitCacheRefill(b);
+                if(b.bits == 0) return false;
+            }
+            uint64_t w = b.cache << (64 - b.bits);
+            if(w){
+                int32_t zeros = __builtin_clzll(w);
+                q += zeros;
+                b.bits -= zeros + 1;
+                break;
+            }
+            q += b.bits;
+            b.bits = 0;
+        }
+        uint32_t low;
+        if(!bitCacheRead(b, param, &low)) return false;
+        uint32_t v = (q << param) | low;
+        out[j] = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+    }
+    return true;
+}
+
+// Escaped partition: residuals stored as nBits signed binary
+static bool decodeEscapedPartition(FLACBitCache& b, int32_t* out, int32_t count, int32_t nBits){
+    for(int32_t j = 0; j < count; j++){
+        uint32_t v;
+        if(!bitCacheRead(b, nBits, &v)) return false;
+        out[j] = nBits ? (int32_t)(v << (32 - nBits)) >> (32 - nBits) : 0;
+    }
+    return true;
+}
+
 int8_t decodeResiduals(uint8_t warmup, uint8_t ch, int32_t* bytesLeft) {
 
-    int32_t method = readUint(2, bytesLeft);                          // Residual coding method:
+    FLACBitCache b;
+    b.cache = s_flac->s_flac_bitBuffer;
+    b.bits  = s_flac->s_flacBitBufferLen;
+    b.ptr   = s_flac->s_flacInptr + s_flac->s_rIndex;
+    b.avail = *bytesLeft;
+
+    uint32_t method = 0, partitionOrder = 0;
+    bool ok = bitCacheRead(b, 2, &method);                        // Residual coding method:
                                                                   // 00 : partitioned Rice coding with 4-bit Rice parameter; RESIDUAL_CODING_METHOD_PARTITIONED_RICE follows
                                                                   // 01 : partitioned Rice coding with 5-bit Rice parameter; RESIDUAL_CODING_METHOD_PARTITIONED_RICE2 follows
                                                                   // 10-11 : reserved
-    if (method >= 2) {return ERR_FLAC_RESERVED_RESIDUAL_CODING;}
+    if (ok && method >= 2) {bitCacheStore(b, bytesLeft); return ERR_FLAC_RESERVED_RESIDUAL_CODING;}
     uint8_t paramBits = method == 0 ? 4 : 5;                      // RESIDUAL_CODING_METHOD_PARTITIONED_RICE || RESIDUAL_CODING_METHOD_PARTITIONED_RICE2
-    int32_t escapeParam = ( method == 0 ? 0xF : 0x1F);
-    int32_t partitionOrder = readUint(4, bytesLeft);                  // Partition order
-    int32_t numPartitions = 1 << partitionOrder;                      // There will be 2^order partitions.
+    uint32_t escapeParam = ( method == 0 ? 0xF : 0x1F);
+    ok = ok && bitCacheRead(b, 4, &partitionOrder);               // Partition order
+    int32_t numPartitions = 1 << partitionOrder;                  // There will be 2^order partitions.
 
-    if (s_numOfOutSamples % numPartitions != 0){
+    if (s_flac->s_numOfOutSamples % numPartitions != 0){
+        bitCacheStore(b, bytesLeft);
         return ERR_FLAC_WRONG_RICE_PARTITION_NR;                  //Error: Block size not divisible by number of Rice partitions
     }
-    int32_t partitionSize = s_numOfOutSamples / numPartitions;
+    int32_t partitionSize = s_flac->s_numOfOutSamples / numPartitions;
+    int32_t* samples = s_flac->s_samplesBuffer[ch];
 
-    for (int32_t i = 0; i < numPartitions; i++) {
+    for (int32_t i = 0; i < numPartitions && ok; i++) {
         int32_t start = i * partitionSize + (i == 0 ? warmup : 0);
         int32_t end = (i + 1) * partitionSize;
 
-        int32_t param = readUint(paramBits, bytesLeft);
-        if (param < escapeParam) {
-            for (int32_t j = start; j < end; j++){
-                if(s_f_bitReaderError) break;
-                s_samplesBuffer[ch][j] = readRiceSignedInt(param, bytesLeft);
-            }
+        uint32_t param = 0, numBits = 0;
+        ok = bitCacheRead(b, paramBits, &param);
+        if (ok && param < escapeParam) {
+            ok = decodeRicePartition(b, samples + start, end - start, param);
         }
-        else {
-            int32_t numBits = readUint(5, bytesLeft);                 // Escape code, meaning the partition is in unencoded binary form using n bits per sample; n follows as a 5-bit number.
-            for (int32_t j = start; j < end; j++){
-                if(s_f_bitReaderError) break;
-                s_samplesBuffer[ch][j] = readSignedInt(numBits, bytesLeft);
-            }
+        else if (ok) {                                            // Escape code, meaning the partition is in unencoded binary form using n bits per sample; n follows as a 5-bit number.
+            ok = bitCacheRead(b, 5, &numBits) && decodeEscapedPartition(b, samples + start, end - start, numBits);
         }
     }
-    if(s_f_bitReaderError) return ERR_FLAC_BITREADER_UNDERFLOW;
+
+    bitCacheStore(b, bytesLeft);
+    if(!ok){
+        log_e("error in bitreader");
+        s_flac->s_f_bitReaderError = true;
+        *bytesLeft = -1;
+        return ERR_FLAC_BITREADER_UNDERFLOW;
+    }
     return ERR_FLAC_NONE;
 }
 //----------------------------------------------------------------------------------------------------------------------
+// Predictors unrolled for a fixed order, the compiler keeps the coefficients in registers
+template <int32_t ORDER>
+static void restoreLinearPredictionN(int32_t* s, const int32_t* c, int32_t n, uint8_t shift) {
+    for (int32_t i = ORDER; i < n; i++) {
+        int32_t sum = 0;
+        #pragma GCC unroll 32
+        for (int32_t j = 0; j < ORDER; j++){
+            sum += s[i - 1 - j] * c[j];
+        }
+        s[i] += (sum >> shift);
+    }
+}
+
 void restoreLinearPrediction(uint8_t ch, uint8_t shift) {
 
-    for (int32_t i = coefs.size(); i < s_numOfOutSamples; i++) {
+    int32_t*       s = s_flac->s_samplesBuffer[ch];
+    const int32_t* c = s_flac->coefs;
+    int32_t        n = s_flac->s_numOfOutSamples;
+
+    switch(s_flac->numCoefs){ // fixed predictors use 1..4, common LPC orders are 8 (flac -5) and 12 (flac -8)
+        case 0:  return;
+        case 1:  restoreLinearPredictionN<1>(s, c, n, shift);  return;
+        case 2:  restoreLinearPredictionN<2>(s, c, n, shift);  return;
+        case 3:  restoreLinearPredictionN<3>(s, c, n, shift);  return;
+        case 4:  restoreLinearPredictionN<4>(s, c, n, shift);  return;
+        case 5:  restoreLinearPredictionN<5>(s, c, n, shift);  return;
+        case 6:  restoreLinearPredictionN<6>(s, c, n, shift);  return;
+        case 7:  restoreLinearPredictionN<7>(s, c, n, shift);  return;
+        case 8:  restoreLinearPredictionN<8>(s, c, n, shift);  return;
+        case 9:  restoreLinearPredictionN<9>(s, c, n, shift);  return;
+        case 10: restoreLinearPredictionN<10>(s, c, n, shift); return;
+        case 11: restoreLinearPredictionN<11>(s, c, n, shift); return;
+        case 12: restoreLinearPredictionN<12>(s, c, n, shift); return;
+        case 32: restoreLinearPredictionN<32>(s, c, n, shift); return;
+        default: break;
+    }
+    for (int32_t i = s_flac->numCoefs; i < n; i++) {
         int32_t sum = 0;
-        for (int32_t j = 0; j < coefs.size(); j++){
-            sum += s_samplesBuffer[ch][i - 1 - j] * coefs[j];
+        for (int32_t j = 0; j < s_flac->numCoefs; j++){
+            sum += s[i - 1 - j] * c[j];
         }
-        s_samplesBuffer[ch][i] += (sum >> shift);
+        s[i] += (sum >> shift);
     }
 }
 //----------------------------------------------------------------------------------------------------------------------
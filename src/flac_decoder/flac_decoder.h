@@ -148,6 +148,15 @@ typedef struct FLACFrameHeader_t {
 
 }FLACFrameHeader_t;
 
+// All functions below work on the decoder context bound to the calling task. Tasks that never bind one share a
+// default context, so a single stream needs no setup. Create a context per stream to decode several at once.
+struct FLACDecoder_t;
+
+FLACDecoder_t*   FLACDecoder_CreateContext();                  // NULL if out of memory
+void             FLACDecoder_DestroyContext(FLACDecoder_t* ctx); // frees the buffers, too
+void             FLACDecoder_SetContext(FLACDecoder_t* ctx);     // bind ctx to the calling task, NULL: default context
+FLACDecoder_t*   FLACDecoder_GetContext();
+
 int32_t          FLACFindSyncWord(unsigned char* buf, int32_t nBytes);
 boolean          FLACFindMagicWord(unsigned char* buf, int32_t nBytes);
 char*            FLACgetStreamTitle();
@@ -6,6 +6,9 @@
  *  Updated on: 09.09.2024
  */
 #include "mp3_decoder.h"
+#include "../AudioMemory.h"
+#include <new>
+#include "esp_cpu.h"
 /* clip to range [-2^n, 2^n - 1] */
 #if 0 //Fast on ARM:
 #define CLIP_2N(y, n) { \
@@ -37,21 +40,29 @@ const uint8_t  m_NGRANS_MPEG2           =1;
 const uint32_t m_SQRTHALF               =0x5a82799a;  // sqrt(0.5) in Q31 format
 
 
-MP3FrameInfo_t *m_MP3FrameInfo;
-SFBandTable_t m_SFBandTable;
-StereoMode_t m_sMode;  /* mono/stereo mode */
-MPEGVersion_t m_MPEGVersion;  /* version ID */
-FrameHeader_t *m_FrameHeader;
-SideInfoSub_t m_SideInfoSub[m_MAX_NGRAN][m_MAX_NCHAN];
-SideInfo_t *m_SideInfo;
-CriticalBandInfo_t m_CriticalBandInfo[m_MAX_NCHAN];  /* filled in dequantizer, used in joint stereo reconstruction */
-DequantInfo_t *m_DequantInfo;
-HuffmanInfo_t *m_HuffmanInfo;
-IMDCTInfo_t *m_IMDCTInfo;
-ScaleFactorInfoSub_t m_ScaleFactorInfoSub[m_MAX_NGRAN][m_MAX_NCHAN];
-ScaleFactorJS_t *m_ScaleFactorJS;
-SubbandInfo_t *m_SubbandInfo;
-MP3DecInfo_t *m_MP3DecInfo;
+// Decoder state, one per stream (see MP3Decoder_CreateContext)
+struct MP3Decoder_t {
+    MP3FrameInfo_t*      m_MP3FrameInfo = NULL;
+    SFBandTable_t        m_SFBandTable;
+    StereoMode_t         m_sMode;       /* mono/stereo mode */
+    MPEGVersion_t        m_MPEGVersion; /* version ID */
+    FrameHeader_t*       m_FrameHeader = NULL;
+    SideInfoSub_t        m_SideInfoSub[m_MAX_NGRAN][m_MAX_NCHAN] = {};
+    SideInfo_t*          m_SideInfo = NULL;
+    CriticalBandInfo_t   m_CriticalBandInfo[m_MAX_NCHAN] = {}; /* filled in dequantizer, used in joint stereo reconstruction */
+    DequantInfo_t*       m_DequantInfo = NULL;
+    HuffmanInfo_t*       m_HuffmanInfo = NULL;
+    IMDCTInfo_t*         m_IMDCTInfo = NULL;
+    ScaleFactorInfoSub_t m_ScaleFactorInfoSub[m_MAX_NGRAN][m_MAX_NCHAN] = {};
+    ScaleFactorJS_t*     m_ScaleFactorJS = NULL;
+    SubbandInfo_t*       m_SubbandInfo = NULL;
+    MP3DecInfo_t*        m_MP3DecInfo = NULL;
+    uint8_t              m_underflowCounter = 0; // http://macslons-irish-pub-radio.stream.laut.fm/macslons-irish-pub-radio
+    MP3FrameCycles_t     m_frameCycles = {};     // filled by MP3Decode()
+};
+
+static MP3Decoder_t s_mp3Default;                      // used by tasks that never call MP3Decoder_SetContext()
+static thread_local MP3Decoder_t* s_mp3 = &s_mp3Default;
 
 const uint16_t huffTable[4242] PROGMEM = {
     /* huffTable01[9] */
@@ -749,7 +760,7 @@ int32_t CalcBitsUsed(BitStreamInfo_t *bsi, uint8_t *startBuf, int32_t startOffse
 }
 //----------------------------------------------------------------------------------------------------------------------
 int32_t CheckPadBit(){
-    return (m_FrameHeader->paddingBit ? 1 : 0);
+    return (s_mp3->m_FrameHeader->paddingBit ? 1 : 0);
 }
 //----------------------------------------------------------------------------------------------------------------------
 int32_t UnpackFrameHeader(uint8_t *buf){
@@ -758,49 +769,49 @@ int32_t UnpackFrameHeader(uint8_t *buf){
     if ((buf[0] & m_SYNCWORDH) != m_SYNCWORDH || (buf[1] & m_SYNCWORDL) != m_SYNCWORDL){return -1;}
     /* read header fields - use bitmasks instead of GetBits() for speed, since format never varies */
     verIdx = (buf[1] >> 3) & 0x03;
-    m_MPEGVersion = (MPEGVersion_t) (verIdx == 0 ? MPEG25 : ((verIdx & 0x01) ? MPEG1 : MPEG2));
-    m_FrameHeader->layer = 4 - ((buf[1] >> 1) & 0x03); /* easy mapping of index to layer number, 4 = error */
-    m_FrameHeader->crc = 1 - ((buf[1] >> 0) & 0x01);
-    m_FrameHeader->brIdx = (buf[2] >> 4) & 0x0f;
-    m_FrameHeader->srIdx = (buf[2] >> 2) & 0x03;
-    m_FrameHeader->paddingBit = (buf[2] >> 1) & 0x01;
-    m_FrameHeader->privateBit = (buf[2] >> 0) & 0x01;
-    m_sMode = (StereoMode_t) ((buf[3] >> 6) & 0x03); /* maps to correct enum (see definition) */
-    m_FrameHeader->modeExt = (buf[3] >> 4) & 0x03;
-    m_FrameHeader->copyFlag = (buf[3] >> 3) & 0x01;
-    m_FrameHeader->origFlag = (buf[3] >> 2) & 0x01;
-    m_FrameHeader->emphasis = (buf[3] >> 0) & 0x03;
+    s_mp3->m_MPEGVersion = (MPEGVersion_t) (verIdx == 0 ? MPEG25 : ((verIdx & 0x01) ? MPEG1 : MPEG2));
+    s_mp3->m_FrameHeader->layer = 4 - ((buf[1] >> 1) & 0x03); /* easy mapping of index to layer number, 4 = error */
+    s_mp3->m_FrameHeader->crc = 1 - ((buf[1] >> 0) & 0x01);
+    s_mp3->m_FrameHeader->brIdx = (buf[2] >> 4) & 0x0f;
+    s_mp3->m_FrameHeader->srIdx = (buf[2] >> 2) & 0x03;
+    s_mp3->m_FrameHeader->paddingBit = (buf[2] >> 1) & 0x01;
+    s_mp3->m_FrameHeader->privateBit = (buf[2] >> 0) & 0x01;
+    s_mp3->m_sMode = (StereoMode_t) ((buf[3] >> 6) & 0x03); /* maps to correct enum (see definition) */
+    s_mp3->m_FrameHeader->modeExt = (buf[3] >> 4) & 0x03;
+    s_mp3->m_FrameHeader->copyFlag = (buf[3] >> 3) & 0x01;
+    s_mp3->m_FrameHeader->origFlag = (buf[3] >> 2) & 0x01;
+    s_mp3->m_FrameHeader->emphasis = (buf[3] >> 0) & 0x03;
     /* check parameters to avoid indexing tables with bad values */
-    if (m_FrameHeader->srIdx == 3 || m_FrameHeader->layer == 4 || m_FrameHeader->brIdx == 15) {return -1;}
+    if (s_mp3->m_FrameHeader->srIdx == 3 || s_mp3->m_FrameHeader->layer == 4 || s_mp3->m_FrameHeader->brIdx == 15) {return -1;}
     /* for readability (we reference sfBandTable many times in decoder) */
-    m_SFBandTable = sfBandTable[m_MPEGVersion][m_FrameHeader->srIdx];
-    if (m_sMode != Joint) /* just to be safe (dequant, stproc check fh->modeExt) */
-        m_FrameHeader->modeExt = 0;
+    s_mp3->m_SFBandTable = sfBandTable[s_mp3->m_MPEGVersion][s_mp3->m_FrameHeader->srIdx];
+    if (s_mp3->m_sMode != Joint) /* just to be safe (dequant, stproc check fh->modeExt) */
+        s_mp3->m_FrameHeader->modeExt = 0;
     /* init user-accessible data */
-    m_MP3DecInfo->nChans = (m_sMode == Mono ? 1 : 2);
-    m_MP3DecInfo->samprate = samplerateTab[m_MPEGVersion][m_FrameHeader->srIdx];
-    m_MP3DecInfo->nGrans = (m_MPEGVersion == MPEG1 ? m_NGRANS_MPEG1 : m_NGRANS_MPEG2);
-    m_MP3DecInfo->nGranSamps = ((int32_t) samplesPerFrameTab[m_MPEGVersion][m_FrameHeader->layer - 1])/m_MP3DecInfo->nGrans;
-    m_MP3DecInfo->layer = m_FrameHeader->layer;
+    s_mp3->m_MP3DecInfo->nChans = (s_mp3->m_sMode == Mono ? 1 : 2);
+    s_mp3->m_MP3DecInfo->samprate = samplerateTab[s_mp3->m_MPEGVersion][s_mp3->m_FrameHeader->srIdx];
+    s_mp3->m_MP3DecInfo->nGrans = (s_mp3->m_MPEGVersion == MPEG1 ? m_NGRANS_MPEG1 : m_NGRANS_MPEG2);
+    s_mp3->m_MP3DecInfo->nGranSamps = ((int32_t) samplesPerFrameTab[s_mp3->m_MPEGVersion][s_mp3->m_FrameHeader->layer - 1])/s_mp3->m_MP3DecInfo->nGrans;
+    s_mp3->m_MP3DecInfo->layer = s_mp3->m_FrameHeader->layer;
 
     /* get bitrate and nSlots from table, unless brIdx == 0 (free mode) in which case caller must figure it out himself
      * question - do we want to overwrite mp3DecInfo->bitrate with 0 each time if it's free mode, and
      *  copy the pre-calculated actual free bitrate into it in mp3dec.c (according to the spec,
      *  this shouldn't be necessary, since it should be either all frames free or none free)
      */
-    if (m_FrameHeader->brIdx) {
-        m_MP3DecInfo->bitrate=((int32_t) bitrateTab[m_MPEGVersion][m_FrameHeader->layer - 1][m_FrameHeader->brIdx]) * 1000;
+    if (s_mp3->m_FrameHeader->brIdx) {
+        s_mp3->m_MP3DecInfo->bitrate=((int32_t) bitrateTab[s_mp3->m_MPEGVersion][s_mp3->m_FrameHeader->layer - 1][s_mp3->m_FrameHeader->brIdx]) * 1000;
         /* nSlots = total frame bytes (from table) - sideInfo bytes - header - CRC (if present) + pad (if present) */
-        m_MP3DecInfo->nSlots= (int32_t) slotTab[m_MPEGVersion][m_FrameHeader->srIdx][m_FrameHeader->brIdx]
-                - (int32_t) sideBytesTab[m_MPEGVersion][(m_sMode == Mono ? 0 : 1)] - 4
-                - (m_FrameHeader->crc ? 2 : 0) + (m_FrameHeader->paddingBit ? 1 : 0);
+        s_mp3->m_MP3DecInfo->nSlots= (int32_t) slotTab[s_mp3->m_MPEGVersion][s_mp3->m_FrameHeader->srIdx][s_mp3->m_FrameHeader->brIdx]
+                - (int32_t) sideBytesTab[s_mp3->m_MPEGVersion][(s_mp3->m_sMode == Mono ? 0 : 1)] - 4
+                - (s_mp3->m_FrameHeader->crc ? 2 : 0) + (s_mp3->m_FrameHeader->paddingBit ? 1 : 0);
     }
     /* load crc word, if enabled, and return length of frame header (in bytes) */
-    if (m_FrameHeader->crc) {
-        m_FrameHeader->CRCWord = ((int32_t) buf[4] << 8 | (int32_t) buf[5] << 0);
+    if (s_mp3->m_FrameHeader->crc) {
+        s_mp3->m_FrameHeader->CRCWord = ((int32_t) buf[4] << 8 | (int32_t) buf[5] << 0);
         return 6;
     } else {
-        m_FrameHeader->CRCWord = 0;
+        s_mp3->m_FrameHeader->CRCWord = 0;
         return 4;
     }
 }
@@ -812,28 +823,28 @@ int32_t UnpackSideInfo( uint8_t *buf) {
     SideInfoSub_t *sis;
     /* validate pointers and sync word */
     bsi = &bitStreamInfo;
-    if (m_MPEGVersion == MPEG1) {
+    if (s_mp3->m_MPEGVersion == MPEG1) {
         /* MPEG 1 */
-        nBytes=(m_sMode == Mono ? m_SIBYTES_MPEG1_MONO : m_SIBYTES_MPEG1_STEREO);
+        nBytes=(s_mp3->m_sMode == Mono ? m_SIBYTES_MPEG1_MONO : m_SIBYTES_MPEG1_STEREO);
         SetBitstreamPointer(bsi, nBytes, buf);
-        m_SideInfo->mainDataBegin = GetBits(bsi, 9);
-        m_SideInfo->privateBits= GetBits(bsi, (m_sMode == Mono ? 5 : 3));
-        for (ch = 0; ch < m_MP3DecInfo->nChans; ch++)
-            for (bd = 0; bd < m_MAX_SCFBD; bd++) m_SideInfo->scfsi[ch][bd] = GetBits(bsi, 1);
+        s_mp3->m_SideInfo->mainDataBegin = GetBits(bsi, 9);
+        s_mp3->m_SideInfo->privateBits= GetBits(bsi, (s_mp3->m_sMode == Mono ? 5 : 3));
+        for (ch = 0; ch < s_mp3->m_MP3DecInfo->nChans; ch++)
+            for (bd = 0; bd < m_MAX_SCFBD; bd++) s_mp3->m_SideInfo->scfsi[ch][bd] = GetBits(bsi, 1);
     } else {
         /* MPEG 2, MPEG 2.5 */
-        nBytes=(m_sMode == Mono ? m_SIBYTES_MPEG2_MONO : m_SIBYTES_MPEG2_STEREO);
+        nBytes=(s_mp3->m_sMode == Mono ? m_SIBYTES_MPEG2_MONO : m_SIBYTES_MPEG2_STEREO);
         SetBitstreamPointer(bsi, nBytes, buf);
-        m_SideInfo->mainDataBegin = GetBits(bsi, 8);
-        m_SideInfo->privateBits = GetBits(bsi, (m_sMode == Mono ? 1 : 2));
+        s_mp3->m_SideInfo->mainDataBegin = GetBits(bsi, 8);
+        s_mp3->m_SideInfo->privateBits = GetBits(bsi, (s_mp3->m_sMode == Mono ? 1 : 2));
     }
-    for (gr = 0; gr < m_MP3DecInfo->nGrans; gr++) {
-        for (ch = 0; ch < m_MP3DecInfo->nChans; ch++) {
-            sis = &m_SideInfoSub[gr][ch]; /* side info subblock for this granule, channel */
+    for (gr = 0; gr < s_mp3->m_MP3DecInfo->nGrans; gr++) {
+        for (ch = 0; ch < s_mp3->m_MP3DecInfo->nChans; ch++) {
+            sis = &s_mp3->m_SideInfoSub[gr][ch]; /* side info subblock for this granule, channel */
             sis->part23Length = GetBits(bsi, 12);
             sis->nBigvals = GetBits(bsi, 9);
             sis->globalGain = GetBits(bsi, 8);
-            sis->sfCompress = GetBits(bsi, (m_MPEGVersion == MPEG1 ? 4 : 9));
+            sis->sfCompress = GetBits(bsi, (s_mp3->m_MPEGVersion == MPEG1 ? 4 : 9));
             sis->winSwitchFlag = GetBits(bsi, 1);
             if (sis->winSwitchFlag) {
                 /* this is a start, stop, short, or mixed block */
@@ -868,12 +879,12 @@ int32_t UnpackSideInfo( uint8_t *buf) {
                 sis->region0Count = GetBits(bsi, 4);
                 sis->region1Count = GetBits(bsi, 3);
             }
-            sis->preFlag = (m_MPEGVersion == MPEG1 ? GetBits(bsi, 1) : 0);
+            sis->preFlag = (s_mp3->m_MPEGVersion == MPEG1 ? GetBits(bsi, 1) : 0);
             sis->sfactScale = GetBits(bsi, 1);
             sis->count1TableSelect = GetBits(bsi, 1);
         }
     }
-    m_MP3DecInfo->mainDataBegin = m_SideInfo->mainDataBegin; /* needed by main decode loop */
+    s_mp3->m_MP3DecInfo->mainDataBegin = s_mp3->m_SideInfo->mainDataBegin; /* needed by main decode loop */
     assert(nBytes == CalcBitsUsed(bsi, buf, 0) >> 3);
     return nBytes;
 }
@@ -1147,14 +1158,14 @@ int32_t UnpackScaleFactors( uint8_t *buf, int32_t *bitOffset, int32_t bitsAvail,
     if (*bitOffset)
         GetBits(bsi, *bitOffset);
 
-    if (m_MPEGVersion == MPEG1)
-        UnpackSFMPEG1(bsi, &m_SideInfoSub[gr][ch], &m_ScaleFactorInfoSub[gr][ch],
-                      m_SideInfo->scfsi[ch], gr, &m_ScaleFactorInfoSub[0][ch]);
+    if (s_mp3->m_MPEGVersion == MPEG1)
+        UnpackSFMPEG1(bsi, &s_mp3->m_SideInfoSub[gr][ch], &s_mp3->m_ScaleFactorInfoSub[gr][ch],
+                      s_mp3->m_SideInfo->scfsi[ch], gr, &s_mp3->m_ScaleFactorInfoSub[0][ch]);
     else
-        UnpackSFMPEG2(bsi, &m_SideInfoSub[gr][ch], &m_ScaleFactorInfoSub[gr][ch],
-                      gr, ch, m_FrameHeader->modeExt, m_ScaleFactorJS);
+        UnpackSFMPEG2(bsi, &s_mp3->m_SideInfoSub[gr][ch], &s_mp3->m_ScaleFactorInfoSub[gr][ch],
+                      gr, ch, s_mp3->m_FrameHeader->modeExt, s_mp3->m_ScaleFactorJS);
 
-    m_MP3DecInfo->part23Length[gr][ch] = m_SideInfoSub[gr][ch].part23Length;
+    s_mp3->m_MP3DecInfo->part23Length[gr][ch] = s_mp3->m_SideInfoSub[gr][ch].part23Length;
 
     bitsUsed = CalcBitsUsed(bsi, buf, *bitOffset);
     buf += (bitsUsed + *bitOffset) >> 3;
@@ -1296,33 +1307,34 @@ int32_t MP3FindFreeSync(uint8_t *buf, uint8_t firstFH[4], int32_t nBytes){
  * Notes:       call this right after calling MP3Decode
  **********************************************************************************************************************/
 void MP3GetLastFrameInfo() {
-    if (m_MP3DecInfo->layer != 3){
-        m_MP3FrameInfo->bitrate=0;
-        m_MP3FrameInfo->nChans=0;
-        m_MP3FrameInfo->samprate=0;
-        m_MP3FrameInfo->bitsPerSample=0;
-        m_MP3FrameInfo->outputSamps=0;
-        m_MP3FrameInfo->layer=0;
-        m_MP3FrameInfo->version=0;
+    if (s_mp3->m_MP3DecInfo->layer != 3){
+        s_mp3->m_MP3FrameInfo->bitrate=0;
+        s_mp3->m_MP3FrameInfo->nChans=0;
+        s_mp3->m_MP3FrameInfo->samprate=0;
+        s_mp3->m_MP3FrameInfo->bitsPerSample=0;
+        s_mp3->m_MP3FrameInfo->outputSamps=0;
+        s_mp3->m_MP3FrameInfo->layer=0;
+        s_mp3->m_MP3FrameInfo->version=0;
     }
     else{
-        m_MP3FrameInfo->bitrate=m_MP3DecInfo->bitrate;
-        m_MP3FrameInfo->nChans=m_MP3DecInfo->nChans;
-        m_MP3FrameInfo->samprate=m_MP3DecInfo->samprate;
-        m_MP3FrameInfo->bitsPerSample=16;
-        m_MP3FrameInfo->outputSamps=m_MP3DecInfo->nChans
-                * (int32_t) samplesPerFrameTab[m_MPEGVersion][m_MP3DecInfo->layer-1];
-        m_MP3FrameInfo->layer=m_MP3DecInfo->layer;
-        m_MP3FrameInfo->version=m_MPEGVersion;
+        s_mp3->m_MP3FrameInfo->bitrate=s_mp3->m_MP3DecInfo->bitrate;
+        s_mp3->m_MP3FrameInfo->nChans=s_mp3->m_MP3DecInfo->nChans;
+        s_mp3->m_MP3FrameInfo->samprate=s_mp3->m_MP3DecInfo->samprate;
+        s_mp3->m_MP3FrameInfo->bitsPerSample=16;
+        s_mp3->m_MP3FrameInfo->outputSamps=s_mp3->m_MP3DecInfo->nChans
+                * (int32_t) samplesPerFrameTab[s_mp3->m_MPEGVersion][s_mp3->m_MP3DecInfo->layer-1];
+        s_mp3->m_MP3FrameInfo->layer=s_mp3->m_MP3DecInfo->layer;
+        s_mp3->m_MP3FrameInfo->version=s_mp3->m_MPEGVersion;
     }
 }
-int32_t MP3GetSampRate(){return m_MP3FrameInfo->samprate;}
-int32_t MP3GetChannels(){return m_MP3FrameInfo->nChans;}
-int32_t MP3GetBitsPerSample(){return m_MP3FrameInfo->bitsPerSample;}
-int32_t MP3GetBitrate(){return m_MP3FrameInfo->bitrate;}
-int32_t MP3GetOutputSamps(){return m_MP3FrameInfo->outputSamps;}
-int32_t MP3GetLayer(){return m_MP3FrameInfo->layer;}     // 0: Reserviert, 1: Layer III, 2: Layer II, 3: Layer I
-int32_t MP3GetVersion(){return m_MP3FrameInfo->version;} // 0: MPEG-2.5, 1: Reserviert, 2: MPEG-2 (ISO/IEC 13818-3), 3: MPEG-1 (ISO/IEC 11172-3)
+int32_t MP3GetSampRate(){return s_mp3->m_MP3FrameInfo->samprate;}
+int32_t MP3GetChannels(){return s_mp3->m_MP3FrameInfo->nChans;}
+int32_t MP3GetBitsPerSample(){return s_mp3->m_MP3FrameInfo->bitsPerSample;}
+int32_t MP3GetBitrate(){return s_mp3->m_MP3FrameInfo->bitrate;}
+int32_t MP3GetOutputSamps(){return s_mp3->m_MP3FrameInfo->outputSamps;}
+int32_t MP3GetLayer(){return s_mp3->m_MP3FrameInfo->layer;}     // 0: Reserviert, 1: Layer III, 2: Layer II, 3: Layer I
+const MP3FrameCycles_t* MP3GetFrameCycles(){return &s_mp3->m_frameCycles;}
+int32_t MP3GetVersion(){return s_mp3->m_MP3FrameInfo->version;} // 0: MPEG-2.5, 1: Reserviert, 2: MPEG-2 (ISO/IEC 13818-3), 3: MPEG-1 (ISO/IEC 11172-3)
 /***********************************************************************************************************************
  * Function:    MP3GetNextFrameInfo
  *
@@ -1337,7 +1349,7 @@ int32_t MP3GetVersion(){return m_MP3FrameInfo->version;} // 0: MPEG-2.5, 1: Rese
  **********************************************************************************************************************/
 int32_t MP3GetNextFrameInfo(uint8_t *buf) {
 
-    if (UnpackFrameHeader( buf) == -1 || m_MP3DecInfo->layer != 3)
+    if (UnpackFrameHeader( buf) == -1 || s_mp3->m_MP3DecInfo->layer != 3)
         return ERR_MP3_INVALID_FRAMEHEADER;
 
     MP3GetLastFrameInfo();
@@ -1358,7 +1370,7 @@ int32_t MP3GetNextFrameInfo(uint8_t *buf) {
  **********************************************************************************************************************/
 void MP3ClearBadFrame(int16_t *outbuf) {
    int32_t i;
-    for (i = 0; i < m_MP3DecInfo->nGrans * m_MP3DecInfo->nGranSamps * m_MP3DecInfo->nChans; i++)
+    for (i = 0; i < s_mp3->m_MP3DecInfo->nGrans * s_mp3->m_MP3DecInfo->nGranSamps * s_mp3->m_MP3DecInfo->nChans; i++)
         outbuf[i] = 0;
 }
 /***********************************************************************************************************************
@@ -1384,7 +1396,9 @@ int32_t MP3Decode( uint8_t *inbuf, int32_t *bytesLeft, int16_t *outbuf, int32_t
    int32_t offset, bitOffset, mainBits, gr, ch, fhBytes, siBytes, freeFrameBytes;
    int32_t prevBitOffset, sfBlockBits, huffBlockBits;
     uint8_t *mainPtr;
-    static uint8_t underflowCounter = 0; // http://macslons-irish-pub-radio.stream.laut.fm/macslons-irish-pub-radio
+    MP3FrameCycles_t *fc = &s_mp3->m_frameCycles;
+    uint32_t t0 = esp_cpu_get_cycle_count(), t;
+    *fc = {};
 
     /* unpack frame header */
     fhBytes = UnpackFrameHeader(inbuf);
@@ -1402,21 +1416,21 @@ int32_t MP3Decode( uint8_t *inbuf, int32_t *bytesLeft, int16_t *outbuf, int32_t
     *bytesLeft -= (fhBytes + siBytes);
 
     /* if free mode, need to calculate bitrate and nSlots manually, based on frame size */
-    if (m_MP3DecInfo->bitrate == 0 || m_MP3DecInfo->freeBitrateFlag) {
-        if(!m_MP3DecInfo->freeBitrateFlag){
+    if (s_mp3->m_MP3DecInfo->bitrate == 0 || s_mp3->m_MP3DecInfo->freeBitrateFlag) {
+        if(!s_mp3->m_MP3DecInfo->freeBitrateFlag){
             /* first time through, need to scan for next sync word and figure out frame size */
-            m_MP3DecInfo->freeBitrateFlag=1;
-            m_MP3DecInfo->freeBitrateSlots=MP3FindFreeSync(inbuf, inbuf - fhBytes - siBytes, *bytesLeft);
-            if(m_MP3DecInfo->freeBitrateSlots < 0){
+            s_mp3->m_MP3DecInfo->freeBitrateFlag=1;
+            s_mp3->m_MP3DecInfo->freeBitrateSlots=MP3FindFreeSync(inbuf, inbuf - fhBytes - siBytes, *bytesLeft);
+            if(s_mp3->m_MP3DecInfo->freeBitrateSlots < 0){
                 MP3ClearBadFrame(outbuf);
-                m_MP3DecInfo->freeBitrateFlag = 0;
+                s_mp3->m_MP3DecInfo->freeBitrateFlag = 0;
                 return ERR_MP3_FREE_BITRATE_SYNC;
             }
-            freeFrameBytes=m_MP3DecInfo->freeBitrateSlots + fhBytes + siBytes;
-            m_MP3DecInfo->bitrate=(freeFrameBytes * m_MP3DecInfo->samprate * 8)
-                    / (m_MP3DecInfo->nGrans * m_MP3DecInfo->nGranSamps);
+            freeFrameBytes=s_mp3->m_MP3DecInfo->freeBitrateSlots + fhBytes + siBytes;
+            s_mp3->m_MP3DecInfo->bitrate=(freeFrameBytes * s_mp3->m_MP3DecInfo->samprate * 8)
+                    / (s_mp3->m_MP3DecInfo->nGrans * s_mp3->m_MP3DecInfo->nGranSamps);
         }
-        m_MP3DecInfo->nSlots = m_MP3DecInfo->freeBitrateSlots + CheckPadBit(); /* add pad byte, if required */
+        s_mp3->m_MP3DecInfo->nSlots = s_mp3->m_MP3DecInfo->freeBitrateSlots + CheckPadBit(); /* add pad byte, if required */
     }
 
     /* useSize != 0 means we're getting reformatted (RTP) packets (see RFC 3119)
@@ -1426,46 +1440,46 @@ int32_t MP3Decode( uint8_t *inbuf, int32_t *bytesLeft, int16_t *outbuf, int32_t
      *      frame is (in bytesLeft)
      */
     if (useSize) {
-        m_MP3DecInfo->nSlots = *bytesLeft;
-        if (m_MP3DecInfo->mainDataBegin != 0 || m_MP3DecInfo->nSlots <= 0) {
+        s_mp3->m_MP3DecInfo->nSlots = *bytesLeft;
+        if (s_mp3->m_MP3DecInfo->mainDataBegin != 0 || s_mp3->m_MP3DecInfo->nSlots <= 0) {
             /* error - non self-contained frame, or missing frame (size <= 0), could do loss concealment here */
             MP3ClearBadFrame(outbuf);
             return ERR_MP3_INVALID_FRAMEHEADER;
         }
 
         /* can operate in-place on reformatted frames */
-        m_MP3DecInfo->mainDataBytes = m_MP3DecInfo->nSlots;
+        s_mp3->m_MP3DecInfo->mainDataBytes = s_mp3->m_MP3DecInfo->nSlots;
         mainPtr = inbuf;
-        inbuf += m_MP3DecInfo->nSlots;
-        *bytesLeft -= (m_MP3DecInfo->nSlots);
+        inbuf += s_mp3->m_MP3DecInfo->nSlots;
+        *bytesLeft -= (s_mp3->m_MP3DecInfo->nSlots);
     } else {
         /* out of data - assume last or truncated frame */
-        if (m_MP3DecInfo->nSlots > *bytesLeft) {
+        if (s_mp3->m_MP3DecInfo->nSlots > *bytesLeft) {
             MP3ClearBadFrame(outbuf);
             return ERR_MP3_INDATA_UNDERFLOW;
         }
         /* fill main data buffer with enough new data for this frame */
-        if (m_MP3DecInfo->mainDataBytes >= m_MP3DecInfo->mainDataBegin) {
+        if (s_mp3->m_MP3DecInfo->mainDataBytes >= s_mp3->m_MP3DecInfo->mainDataBegin) {
             /* adequate "old" main data available (i.e. bit reservoir) */
-            underflowCounter = 0;
-            memmove(m_MP3DecInfo->mainBuf,
-                    m_MP3DecInfo->mainBuf + m_MP3DecInfo->mainDataBytes - m_MP3DecInfo->mainDataBegin,
-                    m_MP3DecInfo->mainDataBegin);
-            memcpy (m_MP3DecInfo->mainBuf + m_MP3DecInfo->mainDataBegin, inbuf,
-                    m_MP3DecInfo->nSlots);
-
-            m_MP3DecInfo->mainDataBytes = m_MP3DecInfo->mainDataBegin + m_MP3DecInfo->nSlots;
-            inbuf += m_MP3DecInfo->nSlots;
-            *bytesLeft -= (m_MP3DecInfo->nSlots);
-            mainPtr = m_MP3DecInfo->mainBuf;
+            s_mp3->m_underflowCounter = 0;
+            memmove(s_mp3->m_MP3DecInfo->mainBuf,
+                    s_mp3->m_MP3DecInfo->mainBuf + s_mp3->m_MP3DecInfo->mainDataBytes - s_mp3->m_MP3DecInfo->mainDataBegin,
+                    s_mp3->m_MP3DecInfo->mainDataBegin);
+            memcpy (s_mp3->m_MP3DecInfo->mainBuf + s_mp3->m_MP3DecInfo->mainDataBegin, inbuf,
+                    s_mp3->m_MP3DecInfo->nSlots);
+
+            s_mp3->m_MP3DecInfo->mainDataBytes = s_mp3->m_MP3DecInfo->mainDataBegin + s_mp3->m_MP3DecInfo->nSlots;
+            inbuf += s_mp3->m_MP3DecInfo->nSlots;
+            *bytesLeft -= (s_mp3->m_MP3DecInfo->nSlots);
+            mainPtr = s_mp3->m_MP3DecInfo->mainBuf;
         } else {
             /* not enough data in bit reservoir from previous frames (perhaps starting in middle of file) */
-            underflowCounter ++;
-            memcpy(m_MP3DecInfo->mainBuf + m_MP3DecInfo->mainDataBytes, inbuf, m_MP3DecInfo->nSlots);
-            m_MP3DecInfo->mainDataBytes += m_MP3DecInfo->nSlots;
-            inbuf += m_MP3DecInfo->nSlots;
-            *bytesLeft -= (m_MP3DecInfo->nSlots);
-            if(underflowCounter < 4){
+            s_mp3->m_underflowCounter ++;
+            memcpy(s_mp3->m_MP3DecInfo->mainBuf + s_mp3->m_MP3DecInfo->mainDataBytes, inbuf, s_mp3->m_MP3DecInfo->nSlots);
+            s_mp3->m_MP3DecInfo->mainDataBytes += s_mp3->m_MP3DecInfo->nSlots;
+            inbuf += s_mp3->m_MP3DecInfo->nSlots;
+            *bytesLeft -= (s_mp3->m_MP3DecInfo->nSlots);
+            if(s_mp3->m_underflowCounter < 4){
                 return ERR_MP3_NONE;
             }
             MP3ClearBadFrame( outbuf);
@@ -1473,17 +1487,18 @@ int32_t MP3Decode( uint8_t *inbuf, int32_t *bytesLeft, int16_t *outbuf, int32_t
         }
     }
     bitOffset = 0;
-    mainBits = m_MP3DecInfo->mainDataBytes * 8;
+    mainBits = s_mp3->m_MP3DecInfo->mainDataBytes * 8;
 
     /* decode one complete frame */
-    for (gr = 0; gr < m_MP3DecInfo->nGrans; gr++) {
-        for (ch = 0; ch < m_MP3DecInfo->nChans; ch++) {
+    for (gr = 0; gr < s_mp3->m_MP3DecInfo->nGrans; gr++) {
+        t = esp_cpu_get_cycle_count();
+        for (ch = 0; ch < s_mp3->m_MP3DecInfo->nChans; ch++) {
             /* unpack scale factors and compute size of scale factor block */
             prevBitOffset = bitOffset;
             offset = UnpackScaleFactors( mainPtr, &bitOffset,
                     mainBits, gr, ch);
             sfBlockBits = 8 * offset - prevBitOffset + bitOffset;
-            huffBlockBits = m_MP3DecInfo->part23Length[gr][ch] - sfBlockBits;
+            huffBlockBits = s_mp3->m_MP3DecInfo->part23Length[gr][ch] - sfBlockBits;
             mainPtr += offset;
             mainBits -= sfBlockBits;
 
@@ -1501,28 +1516,36 @@ int32_t MP3Decode( uint8_t *inbuf, int32_t *bytesLeft, int16_t *outbuf, int32_t
             mainPtr += offset;
             mainBits -= (8 * offset - prevBitOffset + bitOffset);
         }
+        fc->huffman += esp_cpu_get_cycle_count() - t;
         /* dequantize coefficients, decode stereo, reorder int16_t blocks */
+        t = esp_cpu_get_cycle_count();
         if (MP3Dequantize( gr) < 0) {
             MP3ClearBadFrame(outbuf);
             return ERR_MP3_INVALID_DEQUANTIZE;
         }
+        fc->dequant += esp_cpu_get_cycle_count() - t;
 
         /* alias reduction, inverse MDCT, overlap-add, frequency inversion */
-        for (ch = 0; ch < m_MP3DecInfo->nChans; ch++) {
+        t = esp_cpu_get_cycle_count();
+        for (ch = 0; ch < s_mp3->m_MP3DecInfo->nChans; ch++) {
             if (IMDCT( gr, ch) < 0) {
                 MP3ClearBadFrame(outbuf);
                 return ERR_MP3_INVALID_IMDCT;
             }
         }
+        fc->imdct += esp_cpu_get_cycle_count() - t;
         /* subband transform - if stereo, interleaves pcm LRLRLR */
+        t = esp_cpu_get_cycle_count();
         if (Subband(
-                outbuf + gr * m_MP3DecInfo->nGranSamps * m_MP3DecInfo->nChans)
+                outbuf + gr * s_mp3->m_MP3DecInfo->nGranSamps * s_mp3->m_MP3DecInfo->nChans)
                 < 0) {
             MP3ClearBadFrame(outbuf);
             return ERR_MP3_INVALID_SUBBAND;
         }
+        fc->subband += esp_cpu_get_cycle_count() - t;
     }
     MP3GetLastFrameInfo();
+    fc->total = esp_cpu_get_cycle_count() - t0;
     return ERR_MP3_NONE;
 }
 
@@ -1541,23 +1564,54 @@ int32_t MP3Decode( uint8_t *inbuf, int32_t *bytesLeft, int16_t *outbuf, int32_t
 void MP3Decoder_ClearBuffer(void) {
 
     /* important to do this - DSP primitives assume a bunch of state variables are 0 on first use */
-    memset( m_MP3DecInfo,         0, sizeof(MP3DecInfo_t));                                    //Clear MP3DecInfo
-    memset(&m_ScaleFactorInfoSub, 0, sizeof(ScaleFactorInfoSub_t)*(m_MAX_NGRAN *m_MAX_NCHAN)); //Clear ScaleFactorInfo
-    memset( m_SideInfo,           0, sizeof(SideInfo_t));                                      //Clear SideInfo
-    memset( m_FrameHeader,        0, sizeof(FrameHeader_t));                                   //Clear FrameHeader
-    memset( m_HuffmanInfo,        0, sizeof(HuffmanInfo_t));                                   //Clear HuffmanInfo
-    memset( m_DequantInfo,        0, sizeof(DequantInfo_t));                                   //Clear DequantInfo
-    memset( m_IMDCTInfo,          0, sizeof(IMDCTInfo_t));                                     //Clear IMDCTInfo
-    memset( m_SubbandInfo,        0, sizeof(SubbandInfo_t));                                   //Clear SubbandInfo
-    memset(&m_CriticalBandInfo,   0, sizeof(CriticalBandInfo_t)*m_MAX_NCHAN);                  //Clear CriticalBandInfo
-    memset( m_ScaleFactorJS,      0, sizeof(ScaleFactorJS_t));                                 //Clear ScaleFactorJS
-    memset(&m_SideInfoSub,        0, sizeof(SideInfoSub_t)*(m_MAX_NGRAN *m_MAX_NCHAN));        //Clear SideInfoSub
-    memset(&m_SFBandTable,        0, sizeof(SFBandTable_t));                                   //Clear SFBandTable
-    memset( m_MP3FrameInfo,       0, sizeof(MP3FrameInfo_t));                                  //Clear MP3FrameInfo
+    memset( s_mp3->m_MP3DecInfo,         0, sizeof(MP3DecInfo_t));                                    //Clear MP3DecInfo
+    memset(&s_mp3->m_ScaleFactorInfoSub, 0, sizeof(ScaleFactorInfoSub_t)*(m_MAX_NGRAN *m_MAX_NCHAN)); //Clear ScaleFactorInfo
+    memset( s_mp3->m_SideInfo,           0, sizeof(SideInfo_t));                                      //Clear SideInfo
+    memset( s_mp3->m_FrameHeader,        0, sizeof(FrameHeader_t));                                   //Clear FrameHeader
+    memset( s_mp3->m_HuffmanInfo,        0, sizeof(HuffmanInfo_t));                                   //Clear HuffmanInfo
+    memset( s_mp3->m_DequantInfo,        0, sizeof(DequantInfo_t));                                   //Clear DequantInfo
+    memset( s_mp3->m_IMDCTInfo,          0, sizeof(IMDCTInfo_t));                                     //Clear IMDCTInfo
+    memset( s_mp3->m_SubbandInfo,        0, sizeof(SubbandInfo_t));                                   //Clear SubbandInfo
+    memset(&s_mp3->m_CriticalBandInfo,   0, sizeof(CriticalBandInfo_t)*m_MAX_NCHAN);                  //Clear CriticalBandInfo
+    memset( s_mp3->m_ScaleFactorJS,      0, sizeof(ScaleFactorJS_t));                                 //Clear ScaleFactorJS
+    memset(&s_mp3->m_SideInfoSub,        0, sizeof(SideInfoSub_t)*(m_MAX_NGRAN *m_MAX_NCHAN));        //Clear SideInfoSub
+    memset(&s_mp3->m_SFBandTable,        0, sizeof(SFBandTable_t));                                   //Clear SFBandTable
+    memset( s_mp3->m_MP3FrameInfo,       0, sizeof(MP3FrameInfo_t));                                  //Clear MP3FrameInfo
 
     return;
 
 }
+/***********************************************************************************************************************
+ * Function:    MP3Decoder_CreateContext, MP3Decoder_DestroyContext, MP3Decoder_SetContext, MP3Decoder_GetContext
+ *
+ * Description: decoder contexts, all other functions work on the context bound to the calling task
+ *
+ * Notes:       tasks that never bind a context share a default one, DestroyContext frees the buffers, too
+ *
+ **********************************************************************************************************************/
+MP3Decoder_t* MP3Decoder_CreateContext(){
+    void* mem = AudioMemory::alloc(sizeof(MP3Decoder_t), AUDIO_MEM_INTERNAL_PREFERRED);
+    if(!mem) return NULL;
+    return new (mem) MP3Decoder_t();
+}
+
+void MP3Decoder_DestroyContext(MP3Decoder_t* ctx){
+    if(!ctx || ctx == &s_mp3Default) return;
+    MP3Decoder_t* prev = s_mp3;
+    s_mp3 = ctx;
+    MP3Decoder_FreeBuffers();
+    s_mp3 = (prev == ctx) ? &s_mp3Default : prev;
+    ctx->~MP3Decoder_t();
+    AudioMemory::release(ctx);
+}
+
+void MP3Decoder_SetContext(MP3Decoder_t* ctx){
+    s_mp3 = ctx ? ctx : &s_mp3Default;
+}
+
+MP3Decoder_t* MP3Decoder_GetContext(){
+    return s_mp3;
+}
 /***********************************************************************************************************************
  * Function:    MP3Decoder_AllocateBuffers
  *
@@ -1578,26 +1632,26 @@ void MP3Decoder_ClearBuffer(void) {
 #ifdef CONFIG_IDF_TARGET_ESP32S3
     // ESP32-S3: If there is PSRAM, prefer it
     #define __malloc_heap_psram(size) \
-        heap_caps_malloc_prefer(size, 2, MALLOC_CAP_DEFAULT|MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT|MALLOC_CAP_INTERNAL)
+        AudioMemory::alloc(size, AUDIO_MEM_PSRAM_PREFERRED)
 #else
     // ESP32, PSRAM is too slow, prefer SRAM
     #define __malloc_heap_psram(size) \
-        heap_caps_malloc_prefer(size, 2, MALLOC_CAP_DEFAULT|MALLOC_CAP_INTERNAL, MALLOC_CAP_DEFAULT|MALLOC_CAP_SPIRAM)
+        AudioMemory::alloc(size, AUDIO_MEM_INTERNAL_PREFERRED)
 #endif
 
 bool MP3Decoder_AllocateBuffers(void) {
-    if(!m_MP3DecInfo)       {m_MP3DecInfo    = (MP3DecInfo_t*)    __malloc_heap_psram(sizeof(MP3DecInfo_t)   );}
-    if(!m_FrameHeader)      {m_FrameHeader   = (FrameHeader_t*)   __malloc_heap_psram(sizeof(FrameHeader_t)  );}
-    if(!m_SideInfo)         {m_SideInfo      = (SideInfo_t*)      __malloc_heap_psram(sizeof(SideInfo_t)     );}
-    if(!m_ScaleFactorJS)    {m_ScaleFactorJS = (ScaleFactorJS_t*) __malloc_heap_psram(sizeof(ScaleFactorJS_t));}
-    if(!m_HuffmanInfo)      {m_HuffmanInfo   = (HuffmanInfo_t*)   __malloc_heap_psram(sizeof(HuffmanInfo_t)  );}
-    if(!m_DequantInfo)      {m_DequantInfo   = (DequantInfo_t*)   __malloc_heap_psram(sizeof(DequantInfo_t)  );}
-    if(!m_IMDCTInfo)        {m_IMDCTInfo     = (IMDCTInfo_t*)     __malloc_heap_psram(sizeof(IMDCTInfo_t)    );}
-    if(!m_SubbandInfo)      {m_SubbandInfo   = (SubbandInfo_t*)   __malloc_heap_psram(sizeof(SubbandInfo_t)  );}
-    if(!m_MP3FrameInfo)     {m_MP3FrameInfo  = (MP3FrameInfo_t*)  __malloc_heap_psram(sizeof(MP3FrameInfo_t) );}
-
-    if(!m_MP3DecInfo || !m_FrameHeader || !m_SideInfo || !m_ScaleFactorJS || !m_HuffmanInfo ||
-       !m_DequantInfo || !m_IMDCTInfo || !m_SubbandInfo || !m_MP3FrameInfo) {
+    if(!s_mp3->m_MP3DecInfo)       {s_mp3->m_MP3DecInfo    = (MP3DecInfo_t*)    __malloc_heap_psram(sizeof(MP3DecInfo_t)   );}
+    if(!s_mp3->m_FrameHeader)      {s_mp3->m_FrameHeader   = (FrameHeader_t*)   __malloc_heap_psram(sizeof(FrameHeader_t)  );}
+    if(!s_mp3->m_SideInfo)         {s_mp3->m_SideInfo      = (SideInfo_t*)      __malloc_heap_psram(sizeof(SideInfo_t)     );}
+    if(!s_mp3->m_ScaleFactorJS)    {s_mp3->m_ScaleFactorJS = (ScaleFactorJS_t*) __malloc_heap_psram(sizeof(ScaleFactorJS_t));}
+    if(!s_mp3->m_HuffmanInfo)      {s_mp3->m_HuffmanInfo   = (HuffmanInfo_t*)   __malloc_heap_psram(sizeof(HuffmanInfo_t)  );}
+    if(!s_mp3->m_DequantInfo)      {s_mp3->m_DequantInfo   = (DequantInfo_t*)   __malloc_heap_psram(sizeof(DequantInfo_t)  );}
+    if(!s_mp3->m_IMDCTInfo)        {s_mp3->m_IMDCTInfo     = (IMDCTInfo_t*)     __malloc_heap_psram(sizeof(IMDCTInfo_t)    );}
+    if(!s_mp3->m_SubbandInfo)      {s_mp3->m_SubbandInfo   = (SubbandInfo_t*)   __malloc_heap_psram(sizeof(SubbandInfo_t)  );}
+    if(!s_mp3->m_MP3FrameInfo)     {s_mp3->m_MP3FrameInfo  = (MP3FrameInfo_t*)  __malloc_heap_psram(sizeof(MP3FrameInfo_t) );}
+
+    if(!s_mp3->m_MP3DecInfo || !s_mp3->m_FrameHeader || !s_mp3->m_SideInfo || !s_mp3->m_ScaleFactorJS || !s_mp3->m_HuffmanInfo ||
+       !s_mp3->m_DequantInfo || !s_mp3->m_IMDCTInfo || !s_mp3->m_SubbandInfo || !s_mp3->m_MP3FrameInfo) {
         MP3Decoder_FreeBuffers();
         log_e("not enough memory to allocate mp3decoder buffers");
         return false;
@@ -1618,8 +1672,8 @@ bool MP3Decoder_AllocateBuffers(void) {
 
  **********************************************************************************************************************/
 bool MP3Decoder_IsInit(void) {
-    if(!m_MP3DecInfo || !m_FrameHeader || !m_SideInfo || !m_ScaleFactorJS || !m_HuffmanInfo ||
-       !m_DequantInfo || !m_IMDCTInfo || !m_SubbandInfo || !m_MP3FrameInfo) {
+    if(!s_mp3->m_MP3DecInfo || !s_mp3->m_FrameHeader || !s_mp3->m_SideInfo || !s_mp3->m_ScaleFactorJS || !s_mp3->m_HuffmanInfo ||
+       !s_mp3->m_DequantInfo || !s_mp3->m_IMDCTInfo || !s_mp3->m_SubbandInfo || !s_mp3->m_MP3FrameInfo) {
         return false;
     }
     return true;
@@ -1641,15 +1695,15 @@ void MP3Decoder_FreeBuffers()
 {
 //    uint32_t i = ESP.getFreeHeap();
 
-    if(m_MP3DecInfo)        {free(m_MP3DecInfo);      m_MP3DecInfo=NULL;}
-    if(m_FrameHeader)       {free(m_FrameHeader);     m_FrameHeader=NULL;}
-    if(m_SideInfo)          {free(m_SideInfo);        m_SideInfo=NULL;}
-    if(m_ScaleFactorJS )    {free(m_ScaleFactorJS);   m_ScaleFactorJS=NULL;}
-    if(m_HuffmanInfo)       {free(m_HuffmanInfo);     m_HuffmanInfo=NULL;}
-    if(m_DequantInfo)       {free(m_DequantInfo);     m_DequantInfo=NULL;}
-    if(m_IMDCTInfo)         {free(m_IMDCTInfo);       m_IMDCTInfo=NULL;}
-    if(m_SubbandInfo)       {free(m_SubbandInfo);     m_SubbandInfo=NULL;}
-    if(m_MP3FrameInfo)      {free(m_MP3FrameInfo);    m_MP3FrameInfo=NULL;}
+    if(s_mp3->m_MP3DecInfo)        {AudioMemory::release(s_mp3->m_MP3DecInfo);      s_mp3->m_MP3DecInfo=NULL;}
+    if(s_mp3->m_FrameHeader)       {AudioMemory::release(s_mp3->m_FrameHeader);     s_mp3->m_FrameHeader=NULL;}
+    if(s_mp3->m_SideInfo)          {AudioMemory::release(s_mp3->m_SideInfo);        s_mp3->m_SideInfo=NULL;}
+    if(s_mp3->m_ScaleFactorJS )    {AudioMemory::release(s_mp3->m_ScaleFactorJS);   s_mp3->m_ScaleFactorJS=NULL;}
+    if(s_mp3->m_HuffmanInfo)       {AudioMemory::release(s_mp3->m_HuffmanInfo);     s_mp3->m_HuffmanInfo=NULL;}
+    if(s_mp3->m_DequantInfo)       {AudioMemory::release(s_mp3->m_DequantInfo);     s_mp3->m_DequantInfo=NULL;}
+    if(s_mp3->m_IMDCTInfo)         {AudioMemory::release(s_mp3->m_IMDCTInfo);       s_mp3->m_IMDCTInfo=NULL;}
+    if(s_mp3->m_SubbandInfo)       {AudioMemory::release(s_mp3->m_SubbandInfo);     s_mp3->m_SubbandInfo=NULL;}
+    if(s_mp3->m_MP3FrameInfo)      {AudioMemory::release(s_mp3->m_MP3FrameInfo);    s_mp3->m_MP3FrameInfo=NULL;}
 
 //    log_i("MP3Decoder: %lu bytes memory was freed", ESP.getFreeHeap() - i);
 }
@@ -2036,7 +2090,7 @@ int32_t DecodeHuffman(uint8_t *buf, int32_t *bitOffset, int32_t huffBlockBits, i
     uint8_t *startBuf = buf;
 
     SideInfoSub_t *sis;
-    sis = &m_SideInfoSub[gr][ch];
+    sis = &s_mp3->m_SideInfoSub[gr][ch];
     //hi = (HuffmanInfo_t*) (m_MP3DecInfo->HuffmanInfoPS);
 
     if (huffBlockBits < 0)
@@ -2045,20 +2099,20 @@ int32_t DecodeHuffman(uint8_t *buf, int32_t *bitOffset, int32_t huffBlockBits, i
     /* figure out region boundaries (the first 2*bigVals coefficients divided into 3 regions) */
     if (sis->winSwitchFlag && sis->blockType == 2) {
         if (sis->mixedBlock == 0) {
-            r1Start = m_SFBandTable.s[(sis->region0Count + 1) / 3] * 3;
+            r1Start = s_mp3->m_SFBandTable.s[(sis->region0Count + 1) / 3] * 3;
         } else {
-            if (m_MPEGVersion == MPEG1) {
-                r1Start = m_SFBandTable.l[sis->region0Count + 1];
+            if (s_mp3->m_MPEGVersion == MPEG1) {
+                r1Start = s_mp3->m_SFBandTable.l[sis->region0Count + 1];
             } else {
                 /* see MPEG2 spec for explanation */
-                w = m_SFBandTable.s[4] - m_SFBandTable.s[3];
-                r1Start = m_SFBandTable.l[6] + 2 * w;
+                w = s_mp3->m_SFBandTable.s[4] - s_mp3->m_SFBandTable.s[3];
+                r1Start = s_mp3->m_SFBandTable.l[6] + 2 * w;
             }
         }
         r2Start = m_MAX_NSAMP; /* short blocks don't have region 2 */
     } else {
-        r1Start = m_SFBandTable.l[sis->region0Count + 1];
-        r2Start = m_SFBandTable.l[sis->region0Count + 1 + sis->region1Count + 1];
+        r1Start = s_mp3->m_SFBandTable.l[sis->region0Count + 1];
+        r2Start = s_mp3->m_SFBandTable.l[sis->region0Count + 1 + sis->region1Count + 1];
     }
 
     /* offset rEnd index by 1 so first region = rEnd[1] - rEnd[0], etc. */
@@ -2068,12 +2122,12 @@ int32_t DecodeHuffman(uint8_t *buf, int32_t *bitOffset, int32_t huffBlockBits, i
     rEnd[0] = 0;
 
     /* rounds up to first all-zero pair (we don't check last pair for (x,y) == (non-zero, zero)) */
-    m_HuffmanInfo->nonZeroBound[ch] = rEnd[3];
+    s_mp3->m_HuffmanInfo->nonZeroBound[ch] = rEnd[3];
 
     /* decode Huffman pairs (rEnd[i] are always even numbers) */
     bitsLeft = huffBlockBits;
     for (i = 0; i < 3; i++) {
-        bitsUsed = DecodeHuffmanPairs(m_HuffmanInfo->huffDecBuf[ch] + rEnd[i],
+        bitsUsed = DecodeHuffmanPairs(s_mp3->m_HuffmanInfo->huffDecBuf[ch] + rEnd[i],
                 rEnd[i + 1] - rEnd[i], sis->tableSelect[i], bitsLeft, buf,
                 *bitOffset);
         if (bitsUsed < 0 || bitsUsed > bitsLeft) /* error - overran end of bitstream */
@@ -2086,13 +2140,13 @@ int32_t DecodeHuffman(uint8_t *buf, int32_t *bitOffset, int32_t huffBlockBits, i
     }
 
     /* decode Huffman quads (if any) */
-    m_HuffmanInfo->nonZeroBound[ch] += DecodeHuffmanQuads(m_HuffmanInfo->huffDecBuf[ch] + rEnd[3],
+    s_mp3->m_HuffmanInfo->nonZeroBound[ch] += DecodeHuffmanQuads(s_mp3->m_HuffmanInfo->huffDecBuf[ch] + rEnd[3],
             m_MAX_NSAMP - rEnd[3], sis->count1TableSelect, bitsLeft, buf,
             *bitOffset);
 
-    assert(m_HuffmanInfo->nonZeroBound[ch] <= m_MAX_NSAMP);
-    for (i = m_HuffmanInfo->nonZeroBound[ch]; i < m_MAX_NSAMP; i++)
-        m_HuffmanInfo->huffDecBuf[ch][i] = 0;
+    assert(s_mp3->m_HuffmanInfo->nonZeroBound[ch] <= m_MAX_NSAMP);
+    for (i = s_mp3->m_HuffmanInfo->nonZeroBound[ch]; i < m_MAX_NSAMP; i++)
+        s_mp3->m_HuffmanInfo->huffDecBuf[ch][i] = 0;
 
     /* If bits used for 576 samples < huffBlockBits, then the extras are considered
      *  to be stuffing bits (throw away, but need to return correct bitstream position)
@@ -2133,13 +2187,13 @@ int32_t DecodeHuffman(uint8_t *buf, int32_t *bitOffset, int32_t huffBlockBits, i
 int32_t MP3Dequantize(int32_t gr){
    int32_t i, ch, nSamps, mOut[2];
     CriticalBandInfo_t *cbi;
-    cbi = &m_CriticalBandInfo[0];
+    cbi = &s_mp3->m_CriticalBandInfo[0];
     mOut[0] = mOut[1] = 0;
 
     /* dequantize all the samples in each channel */
-    for (ch = 0; ch < m_MP3DecInfo->nChans; ch++) {
-        m_HuffmanInfo->gb[ch] = DequantChannel(m_HuffmanInfo->huffDecBuf[ch], m_DequantInfo->workBuf,
-                &m_HuffmanInfo->nonZeroBound[ch], &m_SideInfoSub[gr][ch], &m_ScaleFactorInfoSub[gr][ch], &cbi[ch]);
+    for (ch = 0; ch < s_mp3->m_MP3DecInfo->nChans; ch++) {
+        s_mp3->m_HuffmanInfo->gb[ch] = DequantChannel(s_mp3->m_HuffmanInfo->huffDecBuf[ch], s_mp3->m_DequantInfo->workBuf,
+                &s_mp3->m_HuffmanInfo->nonZeroBound[ch], &s_mp3->m_SideInfoSub[gr][ch], &s_mp3->m_ScaleFactorInfoSub[gr][ch], &cbi[ch]);
     }
 
     /* joint stereo processing assumes one guard bit in input samples
@@ -2147,53 +2201,53 @@ int32_t MP3Dequantize(int32_t gr){
      *   just make a pass over the data and clip to [-2^30+1, 2^30-1]
      * in practice this may never happen
      */
-    if (m_FrameHeader->modeExt && (m_HuffmanInfo->gb[0] < 1 || m_HuffmanInfo->gb[1] < 1)) {
-        for (i = 0; i < m_HuffmanInfo->nonZeroBound[0]; i++) {
-            if (m_HuffmanInfo->huffDecBuf[0][i] < -0x3fffffff)  m_HuffmanInfo->huffDecBuf[0][i] = -0x3fffffff;
-            if (m_HuffmanInfo->huffDecBuf[0][i] >  0x3fffffff)  m_HuffmanInfo->huffDecBuf[0][i] =  0x3fffffff;
+    if (s_mp3->m_FrameHeader->modeExt && (s_mp3->m_HuffmanInfo->gb[0] < 1 || s_mp3->m_HuffmanInfo->gb[1] < 1)) {
+        for (i = 0; i < s_mp3->m_HuffmanInfo->nonZeroBound[0]; i++) {
+            if (s_mp3->m_HuffmanInfo->huffDecBuf[0][i] < -0x3fffffff)  s_mp3->m_HuffmanInfo->huffDecBuf[0][i] = -0x3fffffff;
+            if (s_mp3->m_HuffmanInfo->huffDecBuf[0][i] >  0x3fffffff)  s_mp3->m_HuffmanInfo->huffDecBuf[0][i] =  0x3fffffff;
         }
-        for (i = 0; i < m_HuffmanInfo->nonZeroBound[1]; i++) {
-            if (m_HuffmanInfo->huffDecBuf[1][i] < -0x3fffffff)  m_HuffmanInfo->huffDecBuf[1][i] = -0x3fffffff;
-            if (m_HuffmanInfo->huffDecBuf[1][i] >  0x3fffffff)  m_HuffmanInfo->huffDecBuf[1][i] =  0x3fffffff;
+        for (i = 0; i < s_mp3->m_HuffmanInfo->nonZeroBound[1]; i++) {
+            if (s_mp3->m_HuffmanInfo->huffDecBuf[1][i] < -0x3fffffff)  s_mp3->m_HuffmanInfo->huffDecBuf[1][i] = -0x3fffffff;
+            if (s_mp3->m_HuffmanInfo->huffDecBuf[1][i] >  0x3fffffff)  s_mp3->m_HuffmanInfo->huffDecBuf[1][i] =  0x3fffffff;
         }
     }
 
     /* do mid-side stereo processing, if enabled */
-    if (m_FrameHeader->modeExt >> 1) {
-        if (m_FrameHeader->modeExt & 0x01) {
+    if (s_mp3->m_FrameHeader->modeExt >> 1) {
+        if (s_mp3->m_FrameHeader->modeExt & 0x01) {
             /* intensity stereo enabled - run mid-side up to start of right zero region */
             if (cbi[1].cbType == 0)
-                nSamps = m_SFBandTable.l[cbi[1].cbEndL + 1];
+                nSamps = s_mp3->m_SFBandTable.l[cbi[1].cbEndL + 1];
             else
-                nSamps = 3 * m_SFBandTable.s[cbi[1].cbEndSMax + 1];
+                nSamps = 3 * s_mp3->m_SFBandTable.s[cbi[1].cbEndSMax + 1];
         } else {
             /* intensity stereo disabled - run mid-side on whole spectrum */
-            nSamps = (m_HuffmanInfo->nonZeroBound[0] > m_HuffmanInfo->nonZeroBound[1] ?
-                                                       m_HuffmanInfo->nonZeroBound[0] : m_HuffmanInfo->nonZeroBound[1]);
+            nSamps = (s_mp3->m_HuffmanInfo->nonZeroBound[0] > s_mp3->m_HuffmanInfo->nonZeroBound[1] ?
+                                                       s_mp3->m_HuffmanInfo->nonZeroBound[0] : s_mp3->m_HuffmanInfo->nonZeroBound[1]);
         }
-        MidSideProc(m_HuffmanInfo->huffDecBuf, nSamps, mOut);
+        MidSideProc(s_mp3->m_HuffmanInfo->huffDecBuf, nSamps, mOut);
     }
 
     /* do intensity stereo processing, if enabled */
-    if (m_FrameHeader->modeExt & 0x01) {
-        nSamps = m_HuffmanInfo->nonZeroBound[0];
-        if (m_MPEGVersion == MPEG1) {
-            IntensityProcMPEG1(m_HuffmanInfo->huffDecBuf, nSamps, &m_ScaleFactorInfoSub[gr][1], &m_CriticalBandInfo[0],
-                    m_FrameHeader->modeExt >> 1, m_SideInfoSub[gr][1].mixedBlock, mOut);
+    if (s_mp3->m_FrameHeader->modeExt & 0x01) {
+        nSamps = s_mp3->m_HuffmanInfo->nonZeroBound[0];
+        if (s_mp3->m_MPEGVersion == MPEG1) {
+            IntensityProcMPEG1(s_mp3->m_HuffmanInfo->huffDecBuf, nSamps, &s_mp3->m_ScaleFactorInfoSub[gr][1], &s_mp3->m_CriticalBandInfo[0],
+                    s_mp3->m_FrameHeader->modeExt >> 1, s_mp3->m_SideInfoSub[gr][1].mixedBlock, mOut);
         } else {
-            IntensityProcMPEG2(m_HuffmanInfo->huffDecBuf, nSamps, &m_ScaleFactorInfoSub[gr][1], &m_CriticalBandInfo[0],
-                    m_ScaleFactorJS, m_FrameHeader->modeExt >> 1, m_SideInfoSub[gr][1].mixedBlock, mOut);
+            IntensityProcMPEG2(s_mp3->m_HuffmanInfo->huffDecBuf, nSamps, &s_mp3->m_ScaleFactorInfoSub[gr][1], &s_mp3->m_CriticalBandInfo[0],
+                    s_mp3->m_ScaleFactorJS, s_mp3->m_FrameHeader->modeExt >> 1, s_mp3->m_SideInfoSub[gr][1].mixedBlock, mOut);
         }
     }
 
     /* adjust guard bit count and nonZeroBound if we did any stereo processing */
-    if (m_FrameHeader->modeExt) {
-        m_HuffmanInfo->gb[0] = CLZ(mOut[0]) - 1;
-        m_HuffmanInfo->gb[1] = CLZ(mOut[1]) - 1;
-        nSamps = (m_HuffmanInfo->nonZeroBound[0] > m_HuffmanInfo->nonZeroBound[1] ?
-                                                       m_HuffmanInfo->nonZeroBound[0] : m_HuffmanInfo->nonZeroBound[1]);
-        m_HuffmanInfo->nonZeroBound[0] = nSamps;
-        m_HuffmanInfo->nonZeroBound[1] = nSamps;
+    if (s_mp3->m_FrameHeader->modeExt) {
+        s_mp3->m_HuffmanInfo->gb[0] = CLZ(mOut[0]) - 1;
+        s_mp3->m_HuffmanInfo->gb[1] = CLZ(mOut[1]) - 1;
+        nSamps = (s_mp3->m_HuffmanInfo->nonZeroBound[0] > s_mp3->m_HuffmanInfo->nonZeroBound[1] ?
+                                                       s_mp3->m_HuffmanInfo->nonZeroBound[0] : s_mp3->m_HuffmanInfo->nonZeroBound[1]);
+        s_mp3->m_HuffmanInfo->nonZeroBound[0] = nSamps;
+        s_mp3->m_HuffmanInfo->nonZeroBound[1] = nSamps;
     }
 
     /* output format Q(DQ_FRACBITS_OUT) */
@@ -2336,7 +2390,7 @@ int32_t DequantChannel(int32_t *sampleBuf, int32_t *workBuf, int32_t *nonZeroBou
     if (sis->blockType == 2) {
         // cbStartL = 0;
         if (sis->mixedBlock) {
-            cbEndL = (m_MPEGVersion == MPEG1 ? 8 : 6);
+            cbEndL = (s_mp3->m_MPEGVersion == MPEG1 ? 8 : 6);
             cbStartS = 3;
         } else {
             cbEndL = 0;
@@ -2365,7 +2419,7 @@ int32_t DequantChannel(int32_t *sampleBuf, int32_t *workBuf, int32_t *nonZeroBou
      *   dividing every sample by sqrt(2) = multiplying by 2^-.5)
      */
     globalGain = sis->globalGain;
-    if (m_FrameHeader->modeExt >> 1)
+    if (s_mp3->m_FrameHeader->modeExt >> 1)
          globalGain -= 2;
     globalGain += m_IMDCT_SCALE;      /* scale everything by sqrt(2), for fast IMDCT36 */
 
@@ -2373,7 +2427,7 @@ int32_t DequantChannel(int32_t *sampleBuf, int32_t *workBuf, int32_t *nonZeroBou
     for (cb = 0; cb < cbEndL; cb++) {
 
         nonZero = 0;
-        nSamps = m_SFBandTable.l[cb + 1] - m_SFBandTable.l[cb];
+        nSamps = s_mp3->m_SFBandTable.l[cb + 1] - s_mp3->m_SFBandTable.l[cb];
         gainI = 210 - globalGain + sfactMultiplier * (sfis->l[cb] + (sis->preFlag ? (int32_t)preTab[cb] : 0));
 
         nonZero |= DequantBlock(sampleBuf + i, sampleBuf + i, nSamps, gainI);
@@ -2402,7 +2456,7 @@ int32_t DequantChannel(int32_t *sampleBuf, int32_t *workBuf, int32_t *nonZeroBou
     cbMax[2] = cbMax[1] = cbMax[0] = cbStartS;
     for (cb = cbStartS; cb < cbEndS; cb++) {
 
-        nSamps = m_SFBandTable.s[cb + 1] - m_SFBandTable.s[cb];
+        nSamps = s_mp3->m_SFBandTable.s[cb + 1] - s_mp3->m_SFBandTable.s[cb];
         for (w = 0; w < 3; w++) {
             nonZero =  0;
             gainI = 210 - globalGain + 8*sis->subBlockGain[w] + sfactMultiplier*(sfis->s[cb][w]);
@@ -2533,13 +2587,13 @@ void IntensityProcMPEG1(int32_t x[m_MAX_NCHAN][m_MAX_NSAMP], int32_t nSamps,  Sc
         cbStartL = cbi[1].cbEndL + 1;
         cbEndL = cbi[0].cbEndL + 1;
         cbStartS = cbEndS = 0;
-        i = m_SFBandTable.l[cbStartL];
+        i = s_mp3->m_SFBandTable.l[cbStartL];
     } else if (cbi[1].cbType == 1 || cbi[1].cbType == 2) {
         /* short or mixed block */
         cbStartS = cbi[1].cbEndSMax + 1;
         cbEndS = cbi[0].cbEndSMax + 1;
         cbStartL = cbEndL = 0;
-        i = 3 * m_SFBandTable.s[cbStartS];
+        i = 3 * s_mp3->m_SFBandTable.s[cbStartS];
     }
     sampsLeft = nSamps - i; /* process to length of left */
     isfTab = (int32_t *) ISFMpeg1[midSideFlag];
@@ -2556,7 +2610,7 @@ void IntensityProcMPEG1(int32_t x[m_MAX_NCHAN][m_MAX_NSAMP], int32_t nSamps,  Sc
             fr = isfTab[6] - isfTab[isf];
         }
 
-        n = m_SFBandTable.l[cb + 1] - m_SFBandTable.l[cb];
+        n = s_mp3->m_SFBandTable.l[cb + 1] - s_mp3->m_SFBandTable.l[cb];
         for (j = 0; j < n && sampsLeft > 0; j++, i++) {
             xr = MULSHIFT32(fr, x[0][i]) << 2;
             x[1][i] = xr;
@@ -2579,7 +2633,7 @@ void IntensityProcMPEG1(int32_t x[m_MAX_NCHAN][m_MAX_NSAMP], int32_t nSamps,  Sc
                 frs[w] = isfTab[6] - isfTab[isf];
             }
         }
-        n = m_SFBandTable.s[cb + 1] - m_SFBandTable.s[cb];
+        n = s_mp3->m_SFBandTable.s[cb + 1] - s_mp3->m_SFBandTable.s[cb];
         for (j = 0; j < n && sampsLeft >= 3; j++, i += 3) {
             xr = MULSHIFT32(frs[0], x[0][i + 0]) << 2;
             x[1][i + 0] = xr;
@@ -2655,7 +2709,7 @@ void IntensityProcMPEG2(int32_t x[m_MAX_NCHAN][m_MAX_NSAMP], int32_t nSamps,
         il[21] = il[22] = 1;
         cbStartL = cbi[1].cbEndL + 1; /* start at end of right */
         cbEndL = cbi[0].cbEndL + 1; /* process to end of left */
-        i = m_SFBandTable.l[cbStartL];
+        i = s_mp3->m_SFBandTable.l[cbStartL];
         sampsLeft = nSamps - i;
 
         for (cb = cbStartL; cb < cbEndL; cb++) {
@@ -2668,7 +2722,7 @@ void IntensityProcMPEG2(int32_t x[m_MAX_NCHAN][m_MAX_NSAMP], int32_t nSamps,
                 fl = isfTab[(sfIdx & 0x01 ? isf : 0)];
                 fr = isfTab[(sfIdx & 0x01 ? 0 : isf)];
             }
-           int32_t r=m_SFBandTable.l[cb + 1] - m_SFBandTable.l[cb];
+           int32_t r=s_mp3->m_SFBandTable.l[cb + 1] - s_mp3->m_SFBandTable.l[cb];
             n=(r < sampsLeft ? r : sampsLeft);
             //n = MIN(fh->sfBand->l[cb + 1] - fh->sfBand->l[cb], sampsLeft);
             for (j = 0; j < n; j++, i++) {
@@ -2691,7 +2745,7 @@ void IntensityProcMPEG2(int32_t x[m_MAX_NCHAN][m_MAX_NSAMP], int32_t nSamps,
         for (w = 0; w < 3; w++) {
             cbStartS = cbi[1].cbEndS[w] + 1; /* start at end of right */
             cbEndS = cbi[0].cbEndS[w] + 1; /* process to end of left */
-            i = 3 * m_SFBandTable.s[cbStartS] + w;
+            i = 3 * s_mp3->m_SFBandTable.s[cbStartS] + w;
 
             /* skip through sample array by 3, so early-exit logic would be more tricky */
             for (cb = cbStartS; cb < cbEndS; cb++) {
@@ -2704,7 +2758,7 @@ void IntensityProcMPEG2(int32_t x[m_MAX_NCHAN][m_MAX_NSAMP], int32_t nSamps,
                     fl = isfTab[(sfIdx & 0x01 ? isf : 0)];
                     fr = isfTab[(sfIdx & 0x01 ? 0 : isf)];
                 }
-                n = m_SFBandTable.s[cb + 1] - m_SFBandTable.s[cb];
+                n = s_mp3->m_SFBandTable.s[cb + 1] - s_mp3->m_SFBandTable.s[cb];
 
                 for (j = 0; j < n; j++, i += 3) {
                     xr = MULSHIFT32(fr, x[0][i]) << 2;
@@ -3440,14 +3494,14 @@ int32_t IMDCT(int32_t gr, int32_t ch) {
      *   nLongBlocks = number of blocks with (possibly) non-zero power
      *   nBfly = number of butterflies to do (nLongBlocks - 1, unless no long blocks)
      */
-    blockCutoff = m_SFBandTable.l[(m_MPEGVersion == MPEG1 ? 8 : 6)] / 18; /* same as 3* num short sfb's in spec */
-    if (m_SideInfoSub[gr][ch].blockType != 2) {
+    blockCutoff = s_mp3->m_SFBandTable.l[(s_mp3->m_MPEGVersion == MPEG1 ? 8 : 6)] / 18; /* same as 3* num short sfb's in spec */
+    if (s_mp3->m_SideInfoSub[gr][ch].blockType != 2) {
         /* all long transforms */
-       int32_t x=(m_HuffmanInfo->nonZeroBound[ch] + 7) / 18 + 1;
+       int32_t x=(s_mp3->m_HuffmanInfo->nonZeroBound[ch] + 7) / 18 + 1;
         bc.nBlocksLong=(x<32 ? x : 32);
         //bc.nBlocksLong = min((hi->nonZeroBound[ch] + 7) / 18 + 1, 32);
         nBfly = bc.nBlocksLong - 1;
-    } else if (m_SideInfoSub[gr][ch].blockType == 2 && m_SideInfoSub[gr][ch].mixedBlock) {
+    } else if (s_mp3->m_SideInfoSub[gr][ch].blockType == 2 && s_mp3->m_SideInfoSub[gr][ch].mixedBlock) {
         /* mixed block - long transforms until cutoff, then short transforms */
         bc.nBlocksLong = blockCutoff;
         nBfly = bc.nBlocksLong - 1;
@@ -3457,29 +3511,29 @@ int32_t IMDCT(int32_t gr, int32_t ch) {
         nBfly = 0;
     }
 
-    AntiAlias(m_HuffmanInfo->huffDecBuf[ch], nBfly);
-   int32_t x=m_HuffmanInfo->nonZeroBound[ch];
+    AntiAlias(s_mp3->m_HuffmanInfo->huffDecBuf[ch], nBfly);
+   int32_t x=s_mp3->m_HuffmanInfo->nonZeroBound[ch];
    int32_t y=nBfly * 18 + 8;
-    m_HuffmanInfo->nonZeroBound[ch]=(x>y ? x: y);
+    s_mp3->m_HuffmanInfo->nonZeroBound[ch]=(x>y ? x: y);
 
-    assert(m_HuffmanInfo->nonZeroBound[ch] <= m_MAX_NSAMP);
+    assert(s_mp3->m_HuffmanInfo->nonZeroBound[ch] <= m_MAX_NSAMP);
 
     /* for readability, use a struct instead of passing a million parameters to HybridTransform() */
-    bc.nBlocksTotal = (m_HuffmanInfo->nonZeroBound[ch] + 17) / 18;
-    bc.nBlocksPrev = m_IMDCTInfo->numPrevIMDCT[ch];
-    bc.prevType = m_IMDCTInfo->prevType[ch];
-    bc.prevWinSwitch = m_IMDCTInfo->prevWinSwitch[ch];
+    bc.nBlocksTotal = (s_mp3->m_HuffmanInfo->nonZeroBound[ch] + 17) / 18;
+    bc.nBlocksPrev = s_mp3->m_IMDCTInfo->numPrevIMDCT[ch];
+    bc.prevType = s_mp3->m_IMDCTInfo->prevType[ch];
+    bc.prevWinSwitch = s_mp3->m_IMDCTInfo->prevWinSwitch[ch];
     /* where WINDOW switches (not nec. transform) */
-    bc.currWinSwitch = (m_SideInfoSub[gr][ch].mixedBlock ? blockCutoff : 0);
-    bc.gbIn = m_HuffmanInfo->gb[ch];
+    bc.currWinSwitch = (s_mp3->m_SideInfoSub[gr][ch].mixedBlock ? blockCutoff : 0);
+    bc.gbIn = s_mp3->m_HuffmanInfo->gb[ch];
 
-    m_IMDCTInfo->numPrevIMDCT[ch] = HybridTransform(m_HuffmanInfo->huffDecBuf[ch], m_IMDCTInfo->overBuf[ch],
-            m_IMDCTInfo->outBuf[ch], &m_SideInfoSub[gr][ch], &bc);
-    m_IMDCTInfo->prevType[ch] = m_SideInfoSub[gr][ch].blockType;
-    m_IMDCTInfo->prevWinSwitch[ch] = bc.currWinSwitch; /* 0 means not a mixed block (either all short or all long) */
-    m_IMDCTInfo->gb[ch] = bc.gbOut;
+    s_mp3->m_IMDCTInfo->numPrevIMDCT[ch] = HybridTransform(s_mp3->m_HuffmanInfo->huffDecBuf[ch], s_mp3->m_IMDCTInfo->overBuf[ch],
+            s_mp3->m_IMDCTInfo->outBuf[ch], &s_mp3->m_SideInfoSub[gr][ch], &bc);
+    s_mp3->m_IMDCTInfo->prevType[ch] = s_mp3->m_SideInfoSub[gr][ch].blockType;
+    s_mp3->m_IMDCTInfo->prevWinSwitch[ch] = bc.currWinSwitch; /* 0 means not a mixed block (either all short or all long) */
+    s_mp3->m_IMDCTInfo->gb[ch] = bc.gbOut;
 
-    assert(m_IMDCTInfo->numPrevIMDCT[ch] <= m_NBANDS);
+    assert(s_mp3->m_IMDCTInfo->numPrevIMDCT[ch] <= m_NBANDS);
 
     /* output has gained 2int32_t bits */
     return 0;
@@ -3503,26 +3557,26 @@ int32_t IMDCT(int32_t gr, int32_t ch) {
  **********************************************************************************************************************/
 int32_t Subband(int16_t *pcmBuf) {
    int32_t b;
-    if (m_MP3DecInfo->nChans == 2) {
+    if (s_mp3->m_MP3DecInfo->nChans == 2) {
         /* stereo */
         for (b = 0; b < m_BLOCK_SIZE; b++) {
-            FDCT32(m_IMDCTInfo->outBuf[0][b], m_SubbandInfo->vbuf + 0 * 32, m_SubbandInfo->vindex,
-                    (b & 0x01), m_IMDCTInfo->gb[0]);
-            FDCT32(m_IMDCTInfo->outBuf[1][b], m_SubbandInfo->vbuf + 1 * 32, m_SubbandInfo->vindex,
-                    (b & 0x01), m_IMDCTInfo->gb[1]);
+            FDCT32(s_mp3->m_IMDCTInfo->outBuf[0][b], s_mp3->m_SubbandInfo->vbuf + 0 * 32, s_mp3->m_SubbandInfo->vindex,
+                    (b & 0x01), s_mp3->m_IMDCTInfo->gb[0]);
+            FDCT32(s_mp3->m_IMDCTInfo->outBuf[1][b], s_mp3->m_SubbandInfo->vbuf + 1 * 32, s_mp3->m_SubbandInfo->vindex,
+                    (b & 0x01), s_mp3->m_IMDCTInfo->gb[1]);
             PolyphaseStereo(pcmBuf,
-                    m_SubbandInfo->vbuf + m_SubbandInfo->vindex + m_VBUF_LENGTH * (b & 0x01),
+                    s_mp3->m_SubbandInfo->vbuf + s_mp3->m_SubbandInfo->vindex + m_VBUF_LENGTH * (b & 0x01),
                     polyCoef);
-            m_SubbandInfo->vindex = (m_SubbandInfo->vindex - (b & 0x01)) & 7;
+            s_mp3->m_SubbandInfo->vindex = (s_mp3->m_SubbandInfo->vindex - (b & 0x01)) & 7;
             pcmBuf += (2 * m_NBANDS);
         }
     } else {
         /* mono */
         for (b = 0; b < m_BLOCK_SIZE; b++) {
-            FDCT32(m_IMDCTInfo->outBuf[0][b], m_SubbandInfo->vbuf + 0 * 32, m_SubbandInfo->vindex,
-                    (b & 0x01), m_IMDCTInfo->gb[0]);
-            PolyphaseMono(pcmBuf, m_SubbandInfo->vbuf + m_SubbandInfo->vindex + m_VBUF_LENGTH * (b & 0x01), polyCoef);
-            m_SubbandInfo->vindex = (m_SubbandInfo->vindex - (b & 0x01)) & 7;
+            FDCT32(s_mp3->m_IMDCTInfo->outBuf[0][b], s_mp3->m_SubbandInfo->vbuf + 0 * 32, s_mp3->m_SubbandInfo->vindex,
+                    (b & 0x01), s_mp3->m_IMDCTInfo->gb[0]);
+            PolyphaseMono(pcmBuf, s_mp3->m_SubbandInfo->vbuf + s_mp3->m_SubbandInfo->vindex + m_VBUF_LENGTH * (b & 0x01), polyCoef);
+            s_mp3->m_SubbandInfo->vindex = (s_mp3->m_SubbandInfo->vindex - (b & 0x01)) & 7;
             pcmBuf += m_NBANDS;
         }
     }
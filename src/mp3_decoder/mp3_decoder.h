@@ -3,6 +3,9 @@
 
 #include "Arduino.h"
 #include "assert.h"
+#if defined(__XTENSA__) && !defined(MP3_GENERIC_C) // define MP3_GENERIC_C to build the plain C kernels for comparison
+#include <xtensa/config/core-isa.h>
+#endif
 
 static const uint8_t  m_HUFF_PAIRTABS          =32;
 static const uint8_t  m_BLOCK_SIZE             =18;
@@ -43,6 +46,14 @@ typedef struct MP3FrameInfo {
     int32_t version;
 } MP3FrameInfo_t;
 
+typedef struct MP3FrameCycles {  // CPU cycles spent in the last MP3Decode() call
+    uint32_t total;
+    uint32_t huffman;             // scale factors and Huffman decoding
+    uint32_t dequant;             // dequantization and stereo processing
+    uint32_t imdct;               // alias reduction, IMDCT, overlap-add
+    uint32_t subband;             // FDCT32 and polyphase synthesis
+} MP3FrameCycles_t;
+
 typedef struct SFBandTable {
     int32_t l[23];
     int32_t s[14];
@@ -455,6 +466,13 @@ const uint32_t csa[8][2] PROGMEM = {
  */
 
 // prototypes
+// All functions below work on the decoder context bound to the calling task. Tasks that never bind one share a
+// default context, so a single stream needs no setup. Create a context per stream to decode several at once.
+struct MP3Decoder_t;
+MP3Decoder_t* MP3Decoder_CreateContext();                 // NULL if out of memory
+void MP3Decoder_DestroyContext(MP3Decoder_t* ctx);        // frees the buffers, too
+void MP3Decoder_SetContext(MP3Decoder_t* ctx);            // bind ctx to the calling task, NULL: default context
+MP3Decoder_t* MP3Decoder_GetContext();
 bool MP3Decoder_AllocateBuffers(void);
 bool MP3Decoder_IsInit();
 void MP3Decoder_FreeBuffers();
@@ -469,6 +487,7 @@ int32_t  MP3GetBitrate();
 int32_t  MP3GetOutputSamps();
 int32_t  MP3GetLayer();
 int32_t  MP3GetVersion();
+const MP3FrameCycles_t* MP3GetFrameCycles();               // per-stage cycle counts of the last frame
 
 //internally used
 void MP3Decoder_ClearBuffer(void);
@@ -508,8 +527,14 @@ void imdct12(int32_t *x, int32_t *out);
 int32_t IMDCT12x3(int32_t *xCurr, int32_t *xPrev, int32_t *y, int32_t btPrev, int32_t blockIdx, int32_t gb);
 int32_t HybridTransform(int32_t *xCurr, int32_t *xPrev, int32_t y[m_BLOCK_SIZE][m_NBANDS], SideInfoSub_t *sis, BlockCount_t *bc);
 inline uint64_t SAR64(uint64_t x, int32_t n) {return x >> n;}
+#if defined(__XTENSA__) && !defined(MP3_GENERIC_C) && XCHAL_HAVE_MUL32_HIGH
+// ESP32 / ESP32-S3: high word of the signed product in one instruction, used by dequant, IMDCT36/12 and FDCT32
+inline int32_t MULSHIFT32(int32_t x, int32_t y) { int32_t z; asm ("mulsh %0, %1, %2" : "=a" (z) : "a" (x), "a" (y)); return z;}
+#else
 inline int32_t MULSHIFT32(int32_t x, int32_t y) { int32_t z; z = (uint64_t) x * (uint64_t) y >> 32; return z;}
-inline uint64_t MADD64(uint64_t sum64, int32_t x, int32_t y) {sum64 += (uint64_t) x * (uint64_t) y; return sum64;}/* returns 64-bit value in [edx:eax] */
+#endif
+// signed 32x32 widening product: mull + mulsh on xtensa instead of a full 64x64 multiply
+inline uint64_t MADD64(uint64_t sum64, int32_t x, int32_t y) {sum64 += (uint64_t)((int64_t) x * y); return sum64;}
 inline uint64_t xSAR64(uint64_t x, int32_t n){return x >> n;}
 inline int32_t FASTABS(int32_t x){ return __builtin_abs(x);} //xtensa has a fast abs instruction //fb
 #define CLZ(x) __builtin_clz(x) //fb
@@ -33,20 +33,7 @@
 
 #include "celt.h"
 #include "opus_decoder.h"
-
-CELTDecoder  *s_celtDec;
-band_ctx_t    s_band_ctx;
-ec_ctx_t      s_ec;
-int32_t*      s_freqBuff;           // mem in celt_synthesis
-int32_t*      s_iyBuff;             // mem in alg_unquant
-int16_t*      s_normBuff;           // mem in quant_all_bands
-int16_t*      s_XBuff;              // mem in celt_decode_with_ec
-int32_t*      s_bits1Buff;          // mem in clt_compute_allocation
-int32_t*      s_bits2Buff;          // mem in clt_compute_allocation
-int32_t*      s_threshBuff;         // mem in clt_compute_allocation
-int32_t*      s_trim_offsetBuff;    // mem in clt_compute_allocation
-uint8_t*      s_collapse_masksBuff; // mem n celt_decode_with_ec
-int16_t*      s_tmpBuff;            // mem in deinterleave_hadamard and interleave_hadamard
+#include "../AudioMemory.h"
 
 const uint32_t CELT_GET_AND_CLEAR_ERROR_REQUEST = 10007;
 const uint32_t CELT_SET_CHANNELS_REQUEST        = 10008;
@@ -770,7 +757,7 @@ uint32_t alg_unquant(int16_t *X, int32_t N, int32_t K, int32_t spread, int32_t B
     if(K <= 0) log_e("alg_unquant() needs at least one pulse");
     if(N <= 1) log_e("alg_unquant() needs at least two dimensions");
 
-    int32_t* iy = s_iyBuff; assert(N <= 176);
+    int32_t* iy = s_celt->s_iyBuff; assert(N <= 176);
     Ryy = decode_pulses(iy, N, K);
     normalise_residual(iy, X, N, Ryy, gain);
     exp_rotation(X, N, -1, B, K, spread);
@@ -1006,7 +993,7 @@ void anti_collapse(int16_t *X_, uint8_t *collapse_masks, int32_t LM, int32_t C,
                    const int16_t *logE, const int16_t *prev1logE, const int16_t *prev2logE, const int32_t *pulses,
                    uint32_t seed){
     int32_t c, i, j, k;
-    const uint8_t  end = s_celtDec->end;  // 21
+    const uint8_t  end = s_celt->s_celtDec->end;  // 21
     for (i = 0; i < end; i++) {
         int32_t N0;
         int16_t thresh, sqrt_1;
@@ -1177,7 +1164,7 @@ void deinterleave_hadamard(int16_t *X, int32_t N0, int32_t stride, int32_t hadam
     N = N0 * stride;
 
     assert(N <= 176);
-    int16_t* tmp = s_tmpBuff;
+    int16_t* tmp = s_celt->s_tmpBuff;
 
     assert(stride > 0);
     if (hadamard) {
@@ -1202,7 +1189,7 @@ void interleave_hadamard(int16_t *X, int32_t N0, int32_t stride, int32_t hadamar
     N = N0 * stride;
 
     assert(N <= 176);
-    int16_t* tmp = s_tmpBuff;
+    int16_t* tmp = s_celt->s_tmpBuff;
 
     if (hadamard) {
         const int32_t *ordery = ordery_table + stride - 2;
@@ -1273,8 +1260,8 @@ void compute_theta(struct split_ctx *sctx, int16_t *X, int16_t *Y, int32_t N, in
     int32_t inv = 0;
     int32_t i;
     int32_t intensity;
-    i = s_band_ctx.i;
-    intensity = s_band_ctx.intensity;
+    i = s_celt->s_band_ctx.i;
+    intensity = s_celt->s_band_ctx.intensity;
 
     /* Decide on the resolution to give to the split parameter theta */
     pulse_cap = logN400[i] + LM * (1 << BITRES);
@@ -1337,13 +1324,13 @@ void compute_theta(struct split_ctx *sctx, int16_t *X, int16_t *Y, int32_t N, in
                  Let's do that at higher complexity */
     }
     else if (stereo) {
-        if (*b > 2 << BITRES && s_band_ctx.remaining_bits > 2 << BITRES) {
+        if (*b > 2 << BITRES && s_celt->s_band_ctx.remaining_bits > 2 << BITRES) {
             inv = ec_dec_bit_logp(2);
         }
         else
             inv = 0;
         /* inv flag override to avoid problems with downmixing. */
-        if (s_band_ctx.disable_inv)
+        if (s_celt->s_band_ctx.disable_inv)
             inv = 0;
         itheta = 0;
     }
@@ -1388,11 +1375,11 @@ uint32_t quant_band_n1(int16_t *X, int16_t *Y, int32_t b,  int16_t *lowband_out)
     stereo = Y != NULL;
     c = 0;
     do {
-        if (s_band_ctx.remaining_bits >= 1 << BITRES) {
-            s_band_ctx.remaining_bits -= 1 << BITRES;
+        if (s_celt->s_band_ctx.remaining_bits >= 1 << BITRES) {
+            s_celt->s_band_ctx.remaining_bits -= 1 << BITRES;
             b -= 1 << BITRES;
         }
-        if (s_band_ctx.resynth)
+        if (s_celt->s_band_ctx.resynth)
             x[0] = 16384;  // NORM_SCALING
         x = Y;
     } while (++c < 1 + stereo);
@@ -1417,8 +1404,8 @@ uint32_t quant_partition(int16_t *X, int32_t N, int32_t b, int32_t B, int16_t *l
     int16_t *Y = NULL;
     int32_t i;
     int32_t spread;
-    i = s_band_ctx.i;
-    spread = s_band_ctx.spread;
+    i = s_celt->s_band_ctx.i;
+    spread = s_celt->s_band_ctx.spread;
 
     /* If we need 1.5 more bit than we can produce, split the band in two. */
     cache = cache_bits50 + cache_index50[(LM + 1) * m_CELTMode.nbEBands + i];
@@ -1458,16 +1445,16 @@ uint32_t quant_partition(int16_t *X, int32_t N, int32_t b, int32_t B, int16_t *l
         }
         mbits = _max(0, _min(b, (b - delta) / 2));
         sbits = b - mbits;
-        s_band_ctx.remaining_bits -= qalloc;
+        s_celt->s_band_ctx.remaining_bits -= qalloc;
 
         if (lowband)
             next_lowband2 = lowband + N; /* >32-bit split case */
 
-        rebalance = s_band_ctx.remaining_bits;
+        rebalance = s_celt->s_band_ctx.remaining_bits;
         if (mbits >= sbits)  {
             cm = quant_partition(X, N, mbits, B, lowband, LM,
                                  MULT16_16_P15(gain, mid), fill);
-            rebalance = mbits - (rebalance - s_band_ctx.remaining_bits);
+            rebalance = mbits - (rebalance - s_celt->s_band_ctx.remaining_bits);
             if (rebalance > 3 << BITRES && itheta != 0)
                 sbits += rebalance - (3 << BITRES);
             cm |= quant_partition(Y, N, sbits, B, next_lowband2, LM,
@@ -1478,7 +1465,7 @@ uint32_t quant_partition(int16_t *X, int32_t N, int32_t b, int32_t B, int16_t *l
             cm = quant_partition(Y, N, sbits, B, next_lowband2, LM,
                                  MULT16_16_P15(gain, side), fill >> B)
                  << (_B0 >> 1);
-            rebalance = sbits - (rebalance - s_band_ctx.remaining_bits);
+            rebalance = sbits - (rebalance - s_celt->s_band_ctx.remaining_bits);
             if (rebalance > 3 << BITRES && itheta != 16384)
                 mbits += rebalance - (3 << BITRES);
             cm |= quant_partition(X, N, mbits, B, lowband, LM,
@@ -1489,14 +1476,14 @@ uint32_t quant_partition(int16_t *X, int32_t N, int32_t b, int32_t B, int16_t *l
         /* This is the basic no-split case */
         q = bits2pulses(i, LM, b);
         curr_bits = pulses2bits(i, LM, q);
-        s_band_ctx.remaining_bits -= curr_bits;
+        s_celt->s_band_ctx.remaining_bits -= curr_bits;
 
         /* Ensures we can never bust the budget */
-        while (s_band_ctx.remaining_bits < 0 && q > 0) {
-            s_band_ctx.remaining_bits += curr_bits;
+        while (s_celt->s_band_ctx.remaining_bits < 0 && q > 0) {
+            s_celt->s_band_ctx.remaining_bits += curr_bits;
             q--;
             curr_bits = pulses2bits(i, LM, q);
-            s_band_ctx.remaining_bits -= curr_bits;
+            s_celt->s_band_ctx.remaining_bits -= curr_bits;
         }
 
         if (q != 0) {
@@ -1509,7 +1496,7 @@ uint32_t quant_partition(int16_t *X, int32_t N, int32_t b, int32_t B, int16_t *l
         else {
             /* If there's no pulse, fill the band anyway */
             int32_t j;
-            if (s_band_ctx.resynth)
+            if (s_celt->s_band_ctx.resynth)
             {
                 uint32_t cm_mask;
                 /* B can be as large as 16, so this shift might overflow an int32_t on a
@@ -1523,8 +1510,8 @@ uint32_t quant_partition(int16_t *X, int32_t N, int32_t b, int32_t B, int16_t *l
                     if (lowband == NULL) {
                         /* Noise */
                         for (j = 0; j < N; j++) {
-                            s_band_ctx.seed = celt_lcg_rand(s_band_ctx.seed);
-                            X[j] = (int16_t)((int32_t)s_band_ctx.seed >> 20);
+                            s_celt->s_band_ctx.seed = celt_lcg_rand(s_celt->s_band_ctx.seed);
+                            X[j] = (int16_t)((int32_t)s_celt->s_band_ctx.seed >> 20);
                         }
                         cm = cm_mask;
                     }
@@ -1532,10 +1519,10 @@ uint32_t quant_partition(int16_t *X, int32_t N, int32_t b, int32_t B, int16_t *l
                         /* Folded spectrum */
                         for (j = 0; j < N; j++) {
                             int16_t tmp;
-                            s_band_ctx.seed = celt_lcg_rand(s_band_ctx.seed);
+                            s_celt->s_band_ctx.seed = celt_lcg_rand(s_celt->s_band_ctx.seed);
                             /* About 48 dB below the "normal" folding level */
                             tmp = QCONST16(1.0f / 256, 10);
-                            tmp = (s_band_ctx.seed) & 0x8000 ? tmp : -tmp;
+                            tmp = (s_celt->s_band_ctx.seed) & 0x8000 ? tmp : -tmp;
                             X[j] = lowband[j] + tmp;
                         }
                         cm = fill;
@@ -1563,7 +1550,7 @@ uint32_t quant_band(int16_t *X, int32_t N, int32_t b, int32_t B, int16_t *lowban
     uint32_t cm = 0;
     int32_t k;
     int32_t tf_change;
-    tf_change = s_band_ctx.tf_change;
+    tf_change = s_celt->s_band_ctx.tf_change;
 
     longBlocks = _B0 == 1;
 
@@ -1615,7 +1602,7 @@ uint32_t quant_band(int16_t *X, int32_t N, int32_t b, int32_t B, int16_t *lowban
 
     cm = quant_partition(X, N, b, B, lowband, LM, gain, fill);
 
-    if (s_band_ctx.resynth) {
+    if (s_celt->s_band_ctx.resynth) {
         /* Undo the sample reorganization going from time order to frequency order */
         if (_B0 > 1)
             interleave_hadamard(X, N_B >> recombine, _B0 << recombine, longBlocks);
@@ -1698,7 +1685,7 @@ uint32_t quant_band_stereo(int16_t *X, int16_t *Y, int32_t N, int32_t b, int32_t
             sbits = 1 << BITRES;
         mbits -= sbits;
         c = itheta > 8192;
-        s_band_ctx.remaining_bits -= qalloc + sbits;
+        s_celt->s_band_ctx.remaining_bits -= qalloc + sbits;
 
         x2 = c ? Y : X;
         y2 = c ? X : Y;
@@ -1714,7 +1701,7 @@ uint32_t quant_band_stereo(int16_t *X, int16_t *Y, int32_t N, int32_t b, int32_t
            and there's no need to worry about mixing with the other channel. */
         y2[0] = -sign * x2[1];
         y2[1] = sign * x2[0];
-        if (s_band_ctx.resynth) {
+        if (s_celt->s_band_ctx.resynth) {
             int16_t tmp;
             X[0] = MULT16_16_Q15(mid, X[0]);
             X[1] = MULT16_16_Q15(mid, X[1]);
@@ -1734,15 +1721,15 @@ uint32_t quant_band_stereo(int16_t *X, int16_t *Y, int32_t N, int32_t b, int32_t
 
         mbits = _max(0, _min(b, (b - delta) / 2));
         sbits = b - mbits;
-        s_band_ctx.remaining_bits -= qalloc;
+        s_celt->s_band_ctx.remaining_bits -= qalloc;
 
-        rebalance = s_band_ctx.remaining_bits;
+        rebalance = s_celt->s_band_ctx.remaining_bits;
         if (mbits >= sbits) {
             /* In stereo mode, we do not apply a scaling to the mid because we need the normalized
                mid for folding later. */
             cm = quant_band(X, N, mbits, B, lowband, LM, lowband_out, 32767,
                             lowband_scratch, fill);
-            rebalance = mbits - (rebalance - s_band_ctx.remaining_bits);
+            rebalance = mbits - (rebalance - s_celt->s_band_ctx.remaining_bits);
             if (rebalance > 3 << BITRES && itheta != 0)
                 sbits += rebalance - (3 << BITRES);
 
@@ -1754,7 +1741,7 @@ uint32_t quant_band_stereo(int16_t *X, int16_t *Y, int32_t N, int32_t b, int32_t
             /* For a stereo split, the high bits of fill are always zero, so no
                folding will be done to the side. */
             cm = quant_band(Y, N, sbits, B, NULL, LM, NULL, side, NULL, fill >> B);
-            rebalance = sbits - (rebalance - s_band_ctx.remaining_bits);
+            rebalance = sbits - (rebalance - s_celt->s_band_ctx.remaining_bits);
             if (rebalance > 3 << BITRES && itheta != 16384)
                 mbits += rebalance - (3 << BITRES);
             /* In stereo mode, we do not apply a scaling to the mid because we need the normalized
@@ -1763,7 +1750,7 @@ uint32_t quant_band_stereo(int16_t *X, int16_t *Y, int32_t N, int32_t b, int32_t
                              lowband_scratch, fill);
         }
     }
-    if (s_band_ctx.resynth) {
+    if (s_celt->s_band_ctx.resynth) {
         if (N != 2)
             stereo_merge(X, Y, mid, N);
         if (inv)
@@ -1807,8 +1794,8 @@ void quant_all_bands(int16_t *X_, int16_t *Y_, uint8_t *collapse_masks, int32_t
     int32_t C = Y_ != NULL ? 2 : 1;
     int32_t norm_offset;
     int32_t resynth = 1;
-    const uint8_t end = s_celtDec->end;  // 21
-    uint8_t disable_inv = s_celtDec->disable_inv; // 1- mono, 0- stereo
+    const uint8_t end = s_celt->s_celtDec->end;  // 21
+    uint8_t disable_inv = s_celt->s_celtDec->disable_inv; // 1- mono, 0- stereo
 
     M = 1 << LM;
     B = shortBlocks ? M : 1;
@@ -1817,7 +1804,7 @@ void quant_all_bands(int16_t *X_, int16_t *Y_, uint8_t *collapse_masks, int32_t
        output in that band. */
 
 //    assert(C * (M * eBands[m_CELTMode.nbEBands - 1] - norm_offset) >= 1248);
-    norm = s_normBuff;
+    norm = s_celt->s_normBuff;
 
     norm2 = norm + M * eBands[m_CELTMode.nbEBands - 1] - norm_offset;
 
@@ -1828,15 +1815,15 @@ void quant_all_bands(int16_t *X_, int16_t *Y_, uint8_t *collapse_masks, int32_t
     lowband_scratch = X_ + M * eBands[m_CELTMode.nbEBands - 1];
 
     lowband_offset = 0;
-    s_band_ctx.encode = 0;
-    s_band_ctx.intensity = intensity;
-    s_band_ctx.seed = 0;
-    s_band_ctx.spread = spread;
-    s_band_ctx.disable_inv = disable_inv; // 0 - stereo, 1 - mono
-    s_band_ctx.resynth = resynth;
-    s_band_ctx.theta_round = 0;
+    s_celt->s_band_ctx.encode = 0;
+    s_celt->s_band_ctx.intensity = intensity;
+    s_celt->s_band_ctx.seed = 0;
+    s_celt->s_band_ctx.spread = spread;
+    s_celt->s_band_ctx.disable_inv = disable_inv; // 0 - stereo, 1 - mono
+    s_celt->s_band_ctx.resynth = resynth;
+    s_celt->s_band_ctx.theta_round = 0;
     /* Avoid injecting noise in the first band on transients. */
-    s_band_ctx.avoid_split_noise = B > 1;
+    s_celt->s_band_ctx.avoid_split_noise = B > 1;
     for (i = 0; i < end; i++){
         int32_t tell;
         int32_t b;
@@ -1849,7 +1836,7 @@ void quant_all_bands(int16_t *X_, int16_t *Y_, uint8_t *collapse_masks, int32_t
         uint32_t y_cm;
         int32_t last;
 
-        s_band_ctx.i = i;
+        s_celt->s_band_ctx.i = i;
         last = (i == end - 1);
 
         X = X_ + M * eBands[i];
@@ -1865,7 +1852,7 @@ void quant_all_bands(int16_t *X_, int16_t *Y_, uint8_t *collapse_masks, int32_t
         if (i != 0)
             balance -= tell;
         remaining_bits = total_bits - tell - 1;
-        s_band_ctx.remaining_bits = remaining_bits;
+        s_celt->s_band_ctx.remaining_bits = remaining_bits;
         if (i <= codedBands - 1){
             curr_balance = celt_sudiv(balance, _min(3, codedBands - i));
             b = _max(0, _min(16383, _min(remaining_bits + 1, pulses[i] + curr_balance)));
@@ -1880,7 +1867,7 @@ void quant_all_bands(int16_t *X_, int16_t *Y_, uint8_t *collapse_masks, int32_t
             special_hybrid_folding(norm, norm2, M, dual_stereo);
 
         tf_change = tf_res[i];
-        s_band_ctx.tf_change = tf_change;
+        s_celt->s_band_ctx.tf_change = tf_change;
         if (i >= m_CELTMode.effEBands) {
             X = norm;
             if (Y_ != NULL)
@@ -1937,7 +1924,7 @@ void quant_all_bands(int16_t *X_, int16_t *Y_, uint8_t *collapse_masks, int32_t
         }
         else {
             if (Y != NULL) {
-                s_band_ctx.theta_round = 0;
+                s_celt->s_band_ctx.theta_round = 0;
                 x_cm = quant_band_stereo(X, Y, N, b, B,
                                     effective_lowband != -1 ? norm + effective_lowband : NULL, LM,
                                     last ? NULL : norm + M * eBands[i] - norm_offset, lowband_scratch, x_cm | y_cm);
@@ -1958,15 +1945,14 @@ void quant_all_bands(int16_t *X_, int16_t *Y_, uint8_t *collapse_masks, int32_t
         update_lowband = b > (N << BITRES);
         /* We only need to avoid noise on a split for the first band. After that, we
            have folding. */
-        s_band_ctx.avoid_split_noise = 0;
+        s_celt->s_band_ctx.avoid_split_noise = 0;
     }
 
 }
 //----------------------------------------------------------------------------------------------------------------------
 
 int32_t celt_decoder_get_size(int32_t channels){
-    static int32_t size;
-    size = sizeof(struct CELTDecoder) + (channels * (DECODE_BUFFER_SIZE + m_CELTMode.overlap) - 1) * sizeof(int32_t)
+    int32_t size = sizeof(struct CELTDecoder) + (channels * (DECODE_BUFFER_SIZE + m_CELTMode.overlap) - 1) * sizeof(int32_t)
            + channels * 24 * sizeof(int16_t) + 4 * 2 * m_CELTMode.nbEBands * sizeof(int16_t);
     return size;
 }
@@ -1977,34 +1963,33 @@ int32_t celt_decoder_init(int32_t channels){
     if (channels < 0 || channels > 2){
         return ERR_OPUS_CHANNELS_OUT_OF_RANGE;
     }
-    if (s_celtDec == NULL){
+    if (s_celt->s_celtDec == NULL){
         return ERR_OPUS_CELT_ALLOC_FAIL;
     }
 
     int32_t n = celt_decoder_get_size(channels);
-    memset(s_celtDec, 0, n * sizeof(char));
-
-    s_celtDec->channels = channels;
-    if(channels == 1) s_celtDec->disable_inv = 1; else s_celtDec->disable_inv = 0; // 1 mono ,  0 stereo
-    s_celtDec->end = s_celtDec->mode->effEBands; // 21
-    s_celtDec->error = 0;
-    s_celtDec->mode = &m_CELTMode;
-    s_celtDec->overlap = m_CELTMode.overlap;
-
-    s_celtDec->postfilter_gain = 0;
-    s_celtDec->postfilter_gain_old = 0;
-
-    s_celtDec->postfilter_period = 0;
-    s_celtDec->postfilter_tapset = 0;
-    s_celtDec->postfilter_tapset_old = 0;
-    s_celtDec->preemph_memD[0] = 0;
-    s_celtDec->preemph_memD[1] = 0;
-    s_celtDec->rng = 0;
-    s_celtDec->signalling = 1;
-    s_celtDec->start = 0;
-    s_celtDec->stream_channels = channels;
-    s_celtDec->_decode_mem[0] = 0;
-    s_celtDec->end = s_celtDec->mode->effEBands; // 21
+    memset(s_celt->s_celtDec, 0, n * sizeof(char));
+
+    s_celt->s_celtDec->channels = channels;
+    if(channels == 1) s_celt->s_celtDec->disable_inv = 1; else s_celt->s_celtDec->disable_inv = 0; // 1 mono ,  0 stereo
+    s_celt->s_celtDec->error = 0;
+    s_celt->s_celtDec->mode = &m_CELTMode;
+    s_celt->s_celtDec->overlap = m_CELTMode.overlap;
+
+    s_celt->s_celtDec->postfilter_gain = 0;
+    s_celt->s_celtDec->postfilter_gain_old = 0;
+
+    s_celt->s_celtDec->postfilter_period = 0;
+    s_celt->s_celtDec->postfilter_tapset = 0;
+    s_celt->s_celtDec->postfilter_tapset_old = 0;
+    s_celt->s_celtDec->preemph_memD[0] = 0;
+    s_celt->s_celtDec->preemph_memD[1] = 0;
+    s_celt->s_celtDec->rng = 0;
+    s_celt->s_celtDec->signalling = 1;
+    s_celt->s_celtDec->start = 0;
+    s_celt->s_celtDec->stream_channels = channels;
+    s_celt->s_celtDec->_decode_mem[0] = 0;
+    s_celt->s_celtDec->end = s_celt->s_celtDec->mode->effEBands; // 21
 
     int32_t ret = celt_decoder_ctl(OPUS_RESET_STATE);
     if(ret < 0) return ret;
@@ -2014,26 +1999,26 @@ int32_t celt_decoder_init(int32_t channels){
 
 // save stack arrays in heap, prefer PSRAM
 #ifdef BOARD_HAS_PSRAM
-    #define __heap_caps_malloc(size) heap_caps_malloc(size, MALLOC_CAP_SPIRAM)
+    #define __heap_caps_malloc(size) AudioMemory::alloc(size, AUDIO_MEM_PSRAM_PREFERRED)
 #else
-    #define __heap_caps_malloc(size) heap_caps_malloc(size, MALLOC_CAP_DEFAULT)
+    #define __heap_caps_malloc(size) AudioMemory::alloc(size, AUDIO_MEM_INTERNAL_PREFERRED)
 #endif
 
 bool CELTDecoder_AllocateBuffers(void) {
     size_t omd = celt_decoder_get_size(2);
-    if(!s_celtDec)              {s_celtDec = (CELTDecoder*)       __heap_caps_malloc(omd);}
-    if(!s_freqBuff)             {s_freqBuff = (int32_t*)          __heap_caps_malloc(960  * sizeof(int32_t));}
-    if(!s_iyBuff)               {s_iyBuff = (int32_t*)            __heap_caps_malloc(176  * sizeof(int32_t));}
-    if(!s_normBuff)             {s_normBuff = (int16_t*)          __heap_caps_malloc(1248 * sizeof(int16_t));}
-    if(!s_XBuff)                {s_XBuff = (int16_t*)             __heap_caps_malloc(1920 * sizeof(int16_t));}
-    if(!s_bits1Buff)            {s_bits1Buff = (int32_t*)         __heap_caps_malloc(21   * sizeof(int32_t));}
-    if(!s_bits2Buff)            {s_bits2Buff = (int32_t*)         __heap_caps_malloc(21   * sizeof(int32_t));}
-    if(!s_threshBuff)           {s_threshBuff = (int32_t*)        __heap_caps_malloc(21   * sizeof(int32_t));}
-    if(!s_trim_offsetBuff)      {s_trim_offsetBuff = (int32_t*)   __heap_caps_malloc(21   * sizeof(int32_t));}
-    if(!s_collapse_masksBuff)   {s_collapse_masksBuff = (uint8_t*)__heap_caps_malloc(42   * sizeof(uint8_t));}
-    if(!s_tmpBuff)              {s_tmpBuff = (int16_t*)           __heap_caps_malloc(176  * sizeof(int16_t));}
-
-    if(!s_celtDec) {
+    if(!s_celt->s_celtDec)              {s_celt->s_celtDec = (CELTDecoder*)       __heap_caps_malloc(omd);}
+    if(!s_celt->s_freqBuff)             {s_celt->s_freqBuff = (int32_t*)          __heap_caps_malloc(960  * sizeof(int32_t));}
+    if(!s_celt->s_iyBuff)               {s_celt->s_iyBuff = (int32_t*)            __heap_caps_malloc(176  * sizeof(int32_t));}
+    if(!s_celt->s_normBuff)             {s_celt->s_normBuff = (int16_t*)          __heap_caps_malloc(1248 * sizeof(int16_t));}
+    if(!s_celt->s_XBuff)                {s_celt->s_XBuff = (int16_t*)             __heap_caps_malloc(1920 * sizeof(int16_t));}
+    if(!s_celt->s_bits1Buff)            {s_celt->s_bits1Buff = (int32_t*)         __heap_caps_malloc(21   * sizeof(int32_t));}
+    if(!s_celt->s_bits2Buff)            {s_celt->s_bits2Buff = (int32_t*)         __heap_caps_malloc(21   * sizeof(int32_t));}
+    if(!s_celt->s_threshBuff)           {s_celt->s_threshBuff = (int32_t*)        __heap_caps_malloc(21   * sizeof(int32_t));}
+    if(!s_celt->s_trim_offsetBuff)      {s_celt->s_trim_offsetBuff = (int32_t*)   __heap_caps_malloc(21   * sizeof(int32_t));}
+    if(!s_celt->s_collapse_masksBuff)   {s_celt->s_collapse_masksBuff = (uint8_t*)__heap_caps_malloc(42   * sizeof(uint8_t));}
+    if(!s_celt->s_tmpBuff)              {s_celt->s_tmpBuff = (int16_t*)           __heap_caps_malloc(176  * sizeof(int16_t));}
+
+    if(!s_celt->s_celtDec) {
         CELTDecoder_FreeBuffers();
         log_e("not enough memory to allocate celtdecoder buffers");
         return false;
@@ -2042,22 +2027,22 @@ bool CELTDecoder_AllocateBuffers(void) {
 }
 //----------------------------------------------------------------------------------------------------------------------
 void CELTDecoder_FreeBuffers(){
-    if(s_celtDec)            { free(s_celtDec);            s_celtDec =            NULL; }
-    if(s_freqBuff)           { free(s_freqBuff),           s_freqBuff =           NULL; }
-    if(s_iyBuff)             { free(s_iyBuff),             s_iyBuff =             NULL; }
-    if(s_normBuff)           { free(s_normBuff),           s_normBuff =           NULL; }
-    if(s_XBuff)              { free(s_XBuff),              s_XBuff =              NULL; }
-    if(s_bits1Buff)          { free(s_bits1Buff),          s_bits1Buff =          NULL; }
-    if(s_bits2Buff)          { free(s_bits2Buff),          s_bits2Buff =          NULL; }
-    if(s_threshBuff)         { free(s_threshBuff),         s_threshBuff =         NULL; }
-    if(s_trim_offsetBuff)    { free(s_trim_offsetBuff),    s_trim_offsetBuff =    NULL; }
-    if(s_collapse_masksBuff) { free(s_collapse_masksBuff), s_collapse_masksBuff = NULL; }
-    if(s_tmpBuff)            { free(s_tmpBuff),            s_tmpBuff =            NULL; }
+    if(s_celt->s_celtDec)            { AudioMemory::release(s_celt->s_celtDec);            s_celt->s_celtDec =            NULL; }
+    if(s_celt->s_freqBuff)           { AudioMemory::release(s_celt->s_freqBuff),           s_celt->s_freqBuff =           NULL; }
+    if(s_celt->s_iyBuff)             { AudioMemory::release(s_celt->s_iyBuff),             s_celt->s_iyBuff =             NULL; }
+    if(s_celt->s_normBuff)           { AudioMemory::release(s_celt->s_normBuff),           s_celt->s_normBuff =           NULL; }
+    if(s_celt->s_XBuff)              { AudioMemory::release(s_celt->s_XBuff),              s_celt->s_XBuff =              NULL; }
+    if(s_celt->s_bits1Buff)          { AudioMemory::release(s_celt->s_bits1Buff),          s_celt->s_bits1Buff =          NULL; }
+    if(s_celt->s_bits2Buff)          { AudioMemory::release(s_celt->s_bits2Buff),          s_celt->s_bits2Buff =          NULL; }
+    if(s_celt->s_threshBuff)         { AudioMemory::release(s_celt->s_threshBuff),         s_celt->s_threshBuff =         NULL; }
+    if(s_celt->s_trim_offsetBuff)    { AudioMemory::release(s_celt->s_trim_offsetBuff),    s_celt->s_trim_offsetBuff =    NULL; }
+    if(s_celt->s_collapse_masksBuff) { AudioMemory::release(s_celt->s_collapse_masksBuff), s_celt->s_collapse_masksBuff = NULL; }
+    if(s_celt->s_tmpBuff)            { AudioMemory::release(s_celt->s_tmpBuff),            s_celt->s_tmpBuff =            NULL; }
 }
 //----------------------------------------------------------------------------------------------------------------------
 void CELTDecoder_ClearBuffer(void){
     size_t omd = celt_decoder_get_size(2);
-    memset(s_celtDec, 0, omd * sizeof(char));
+    memset(s_celt->s_celtDec, 0, omd * sizeof(char));
 }
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -2091,9 +2076,9 @@ void deemphasis(int32_t *in[], int16_t *pcm, int32_t N) {
     int32_t        Nd;
     int32_t        apply_downsampling = 0;
     int16_t        coef0;
-    const int32_t  CC = s_celtDec->channels;
+    const int32_t  CC = s_celt->s_celtDec->channels;
     const int16_t *coef = m_CELTMode.preemph;
-    int32_t       *mem = s_celtDec->preemph_memD;
+    int32_t       *mem = s_celt->s_celtDec->preemph_memD;
 
     /* Short version for common case. */
     if(CC == 2) {
@@ -2140,13 +2125,13 @@ void celt_synthesis(int16_t *X, int32_t *out_syn[], int16_t *oldBandE, int32_t C
     int32_t shift;
     int32_t nbEBands;
     int32_t overlap;
-    const int32_t  CC = s_celtDec->channels;
-    const uint8_t effEnd = s_celtDec->end;  // 21
+    const int32_t  CC = s_celt->s_celtDec->channels;
+    const uint8_t effEnd = s_celt->s_celtDec->end;  // 21
 
     overlap = m_CELTMode.overlap;
     nbEBands = m_CELTMode.nbEBands;
     N = m_CELTMode.shortMdctSize << LM;
-    int32_t* freq = s_freqBuff; assert(N <= 960); /**< Interleaved signal MDCTs */
+    int32_t* freq = s_celt->s_freqBuff; assert(N <= 960); /**< Interleaved signal MDCTs */
     M = 1 << LM;
 
     if(isTransient) {
@@ -2203,9 +2188,9 @@ void tf_decode(int32_t isTransient, int32_t *tf_res, int32_t LM){
     int32_t logp;
     uint32_t budget;
     uint32_t tell;
-    const uint8_t end = s_celtDec->end;
+    const uint8_t end = s_celt->s_celtDec->end;
 
-    budget = s_ec.storage * 8;
+    budget = s_celt->s_ec.storage * 8;
     tell = ec_tell();
     logp = isTransient ? 2 : 4;
     tf_select_rsv = LM > 0 && tell + logp + 1 <= budget;
@@ -2245,9 +2230,9 @@ int32_t celt_decode_with_ec(int16_t *outbuf, int32_t frame_size) {
     int32_t        shortBlocks;
     int32_t        isTransient;
     int32_t        intra_ener;
-    const uint8_t  CC = s_celtDec->channels;
+    const uint8_t  CC = s_celt->s_celtDec->channels;
     int32_t        LM, M;
-    const uint8_t  end = s_celtDec->end;  // 21
+    const uint8_t  end = s_celt->s_celtDec->end;  // 21
     int32_t        codedBands;
     int32_t        alloc_trim;
     int32_t        postfilter_pitch;
@@ -2262,12 +2247,12 @@ int32_t celt_decode_with_ec(int16_t *outbuf, int32_t frame_size) {
     int32_t        anti_collapse_rsv;
     int32_t        anti_collapse_on = 0;
     int32_t        silence;
-    const uint8_t  C = s_celtDec->stream_channels; // =channels=2
+    const uint8_t  C = s_celt->s_celtDec->stream_channels; // =channels=2
     const uint8_t  nbEBands = m_CELTMode.nbEBands; // =21
     const uint8_t  overlap = m_CELTMode.overlap; // =120
     const int16_t *eBands = eband5ms;
 
-    lpc = (int16_t *)(s_celtDec->_decode_mem + (DECODE_BUFFER_SIZE + overlap) * CC);
+    lpc = (int16_t *)(s_celt->s_celtDec->_decode_mem + (DECODE_BUFFER_SIZE + overlap) * CC);
     oldBandE = lpc + CC * 24;
     oldLogE = oldBandE + 2 * nbEBands;
     oldLogE2 = oldLogE + 2 * nbEBands;
@@ -2281,23 +2266,23 @@ int32_t celt_decode_with_ec(int16_t *outbuf, int32_t frame_size) {
 
     M = 1 << LM; // LM=3 -> M = 8
 
-    if(s_ec.storage > 1275 || outbuf == NULL) {log_e("OPUS_BAD_ARG"); return ERR_OPUS_CELT_BAD_ARG;}
+    if(s_celt->s_ec.storage > 1275 || outbuf == NULL) {log_e("OPUS_BAD_ARG"); return ERR_OPUS_CELT_BAD_ARG;}
 
     N = M * m_CELTMode.shortMdctSize; // const m_CELTMode.shortMdctSize == 120, M == 8 -> N = 960
 
     c = 0;
     do {
-        decode_mem[c] = s_celtDec->_decode_mem + c * (DECODE_BUFFER_SIZE + overlap);
+        decode_mem[c] = s_celt->s_celtDec->_decode_mem + c * (DECODE_BUFFER_SIZE + overlap);
         out_syn[c] = decode_mem[c] + DECODE_BUFFER_SIZE - N;
     } while(++c < CC);
 
-    if(s_ec.storage <= 1) {log_e("OPUS_BAD_ARG"); return ERR_OPUS_CELT_BAD_ARG;}
+    if(s_celt->s_ec.storage <= 1) {log_e("OPUS_BAD_ARG"); return ERR_OPUS_CELT_BAD_ARG;}
 
     if(C == 1) {
         for(i = 0; i < nbEBands; i++) oldBandE[i] = _max(oldBandE[i], oldBandE[nbEBands + i]);
     }
 
-    total_bits = s_ec.storage * 8;
+    total_bits = s_celt->s_ec.storage * 8;
     tell = ec_tell();
 
     if(tell >= total_bits) silence = 1;
@@ -2307,8 +2292,8 @@ int32_t celt_decode_with_ec(int16_t *outbuf, int32_t frame_size) {
         silence = 0;
     if(silence) {
         /* Pretend we've read all the remaining bits */
-        tell = s_ec.storage * 8;
-        s_ec.nbits_total += tell - ec_tell();
+        tell = s_celt->s_ec.storage * 8;
+        s_celt->s_ec.nbits_total += tell - ec_tell();
     }
 
     postfilter_gain = 0;
@@ -2382,7 +2367,7 @@ int32_t celt_decode_with_ec(int16_t *outbuf, int32_t frame_size) {
     int32_t fine_quant[nbEBands];
     alloc_trim = tell + (6 << BITRES) <= total_bits ? ec_dec_icdf(trim_icdf, 7) : 5;
 
-    bits = (((int32_t)s_ec.storage * 8) << BITRES) - ec_tell_frac() - 1;
+    bits = (((int32_t)s_celt->s_ec.storage * 8) << BITRES) - ec_tell_frac() - 1;
     anti_collapse_rsv = isTransient && LM >= 2 && bits >= ((LM + 2) << BITRES) ? (1 << BITRES) : 0;
     bits -= anti_collapse_rsv;
 
@@ -2399,19 +2384,19 @@ int32_t celt_decode_with_ec(int16_t *outbuf, int32_t frame_size) {
 
     /* Decode fixed codebook */
     assert(C * nbEBands <= 42);
-    uint8_t* collapse_masks = s_collapse_masksBuff;
+    uint8_t* collapse_masks = s_celt->s_collapse_masksBuff;
 
     assert(C * N <= 1920);
-    int16_t* X = s_XBuff;
+    int16_t* X = s_celt->s_XBuff;
 
     quant_all_bands(X, C == 2 ? X + N : NULL, collapse_masks, pulses, shortBlocks, spread_decision,
-                    dual_stereo, intensity, tf_res, s_ec.storage * (8 << BITRES) - anti_collapse_rsv, balance, LM, codedBands);
+                    dual_stereo, intensity, tf_res, s_celt->s_ec.storage * (8 << BITRES) - anti_collapse_rsv, balance, LM, codedBands);
 
     if(anti_collapse_rsv > 0) { anti_collapse_on = ec_dec_bits(1); }
 
-    unquant_energy_finalise(oldBandE, fine_quant, fine_priority, s_ec.storage * 8 - ec_tell(), C);
+    unquant_energy_finalise(oldBandE, fine_quant, fine_priority, s_celt->s_ec.storage * 8 - ec_tell(), C);
 
-    if(anti_collapse_on) anti_collapse(X, collapse_masks, LM, C, N, oldBandE, oldLogE, oldLogE2, pulses, s_celtDec->rng);
+    if(anti_collapse_on) anti_collapse(X, collapse_masks, LM, C, N, oldBandE, oldLogE, oldLogE2, pulses, s_celt->s_celtDec->rng);
 
     if(silence) {
         for(i = 0; i < C * nbEBands; i++) oldBandE[i] = -QCONST16(28.f, 10);
@@ -2422,27 +2407,27 @@ int32_t celt_decode_with_ec(int16_t *outbuf, int32_t frame_size) {
     c = 0;
     const uint8_t COMBFILTER_MINPERIOD = 15;
     do {
-        s_celtDec->postfilter_period = _max(s_celtDec->postfilter_period, COMBFILTER_MINPERIOD);
-        s_celtDec->postfilter_period_old = _max(s_celtDec->postfilter_period_old, COMBFILTER_MINPERIOD);
-        comb_filter(out_syn[c], out_syn[c], s_celtDec->postfilter_period_old, s_celtDec->postfilter_period,
-                    m_CELTMode.shortMdctSize, s_celtDec->postfilter_gain_old, s_celtDec->postfilter_gain,
-                    s_celtDec->postfilter_tapset_old, s_celtDec->postfilter_tapset);
+        s_celt->s_celtDec->postfilter_period = _max(s_celt->s_celtDec->postfilter_period, COMBFILTER_MINPERIOD);
+        s_celt->s_celtDec->postfilter_period_old = _max(s_celt->s_celtDec->postfilter_period_old, COMBFILTER_MINPERIOD);
+        comb_filter(out_syn[c], out_syn[c], s_celt->s_celtDec->postfilter_period_old, s_celt->s_celtDec->postfilter_period,
+                    m_CELTMode.shortMdctSize, s_celt->s_celtDec->postfilter_gain_old, s_celt->s_celtDec->postfilter_gain,
+                    s_celt->s_celtDec->postfilter_tapset_old, s_celt->s_celtDec->postfilter_tapset);
         if(LM != 0)
             comb_filter(out_syn[c] + m_CELTMode.shortMdctSize, out_syn[c] + m_CELTMode.shortMdctSize,
-                        s_celtDec->postfilter_period, postfilter_pitch, N - m_CELTMode.shortMdctSize, s_celtDec->postfilter_gain,
-                        postfilter_gain, s_celtDec->postfilter_tapset, postfilter_tapset);
+                        s_celt->s_celtDec->postfilter_period, postfilter_pitch, N - m_CELTMode.shortMdctSize, s_celt->s_celtDec->postfilter_gain,
+                        postfilter_gain, s_celt->s_celtDec->postfilter_tapset, postfilter_tapset);
 
     } while(++c < CC);
-    s_celtDec->postfilter_period_old = s_celtDec->postfilter_period;
-    s_celtDec->postfilter_gain_old = s_celtDec->postfilter_gain;
-    s_celtDec->postfilter_tapset_old = s_celtDec->postfilter_tapset;
-    s_celtDec->postfilter_period = postfilter_pitch;
-    s_celtDec->postfilter_gain = postfilter_gain;
-    s_celtDec->postfilter_tapset = postfilter_tapset;
+    s_celt->s_celtDec->postfilter_period_old = s_celt->s_celtDec->postfilter_period;
+    s_celt->s_celtDec->postfilter_gain_old = s_celt->s_celtDec->postfilter_gain;
+    s_celt->s_celtDec->postfilter_tapset_old = s_celt->s_celtDec->postfilter_tapset;
+    s_celt->s_celtDec->postfilter_period = postfilter_pitch;
+    s_celt->s_celtDec->postfilter_gain = postfilter_gain;
+    s_celt->s_celtDec->postfilter_tapset = postfilter_tapset;
     if(LM != 0) {
-        s_celtDec->postfilter_period_old = s_celtDec->postfilter_period;
-        s_celtDec->postfilter_gain_old = s_celtDec->postfilter_gain;
-        s_celtDec->postfilter_tapset_old = s_celtDec->postfilter_tapset;
+        s_celt->s_celtDec->postfilter_period_old = s_celt->s_celtDec->postfilter_period;
+        s_celt->s_celtDec->postfilter_gain_old = s_celt->s_celtDec->postfilter_gain;
+        s_celt->s_celtDec->postfilter_tapset_old = s_celt->s_celtDec->postfilter_tapset;
     }
 
     if(C == 1) memcpy(&oldBandE[nbEBands], oldBandE, nbEBands * sizeof(*oldBandE));
@@ -2469,12 +2454,12 @@ int32_t celt_decode_with_ec(int16_t *outbuf, int32_t frame_size) {
             oldLogE[c * nbEBands + i] = oldLogE2[c * nbEBands + i] = -QCONST16(28.f, 10);
         }
     } while(++c < 2);
-    s_celtDec->rng = 0; //dec->rng;
+    s_celt->s_celtDec->rng = 0; //dec->rng;
 
     deemphasis(out_syn, outbuf, N);
 
-    if(ec_tell() > 8 * s_ec.storage) return ERR_CELT_OPUS_INTERNAL_ERROR;
-    if(s_ec.error) s_celtDec->error = 1;
+    if(ec_tell() > 8 * s_celt->s_ec.storage) return ERR_CELT_OPUS_INTERNAL_ERROR;
+    if(s_celt->s_ec.error) s_celt->s_celtDec->error = 1;
 
     return frame_size;
 }
@@ -2487,48 +2472,48 @@ int32_t celt_decoder_ctl(int32_t request, ...) {
     switch (request) {
         case CELT_SET_START_BAND_REQUEST: {
             int32_t value = va_arg(ap, int32_t);
-            if (value < 1 || value > s_celtDec->mode->nbEBands) {va_end(ap); return ERR_OPUS_CELT_START_BAND;}
-            s_celtDec->start = value;
+            if (value < 1 || value > s_celt->s_celtDec->mode->nbEBands) {va_end(ap); return ERR_OPUS_CELT_START_BAND;}
+            s_celt->s_celtDec->start = value;
         } break;
         case CELT_SET_END_BAND_REQUEST: {
             int32_t value = va_arg(ap, int32_t);
-            if (value < 1 || value > s_celtDec->mode->nbEBands) {va_end(ap); return ERR_OPUS_CELT_END_BAND;}
-            s_celtDec->end = value;
+            if (value < 1 || value > s_celt->s_celtDec->mode->nbEBands) {va_end(ap); return ERR_OPUS_CELT_END_BAND;}
+            s_celt->s_celtDec->end = value;
         } break;
         case CELT_SET_CHANNELS_REQUEST: {
             int32_t value = va_arg(ap, int32_t);
             if (value < 1 || value > 2) {va_end(ap); return ERR_OPUS_CELT_SET_CHANNELS;}
-            s_celtDec->stream_channels = value;
+            s_celt->s_celtDec->stream_channels = value;
         } break;
         case CELT_GET_AND_CLEAR_ERROR_REQUEST: {
             int32_t *value = va_arg(ap, int32_t *);
             if (value == NULL)  {va_end(ap); return ERR_OPUS_CELT_CLEAR_REQUEST;}
-            *value = s_celtDec->error;
-            s_celtDec->error = 0;
+            *value = s_celt->s_celtDec->error;
+            s_celt->s_celtDec->error = 0;
         } break;
         case OPUS_RESET_STATE: {
             int32_t i;
             int16_t *lpc, *oldBandE, *oldLogE, *oldLogE2;
-            lpc = (int16_t *)(s_celtDec->_decode_mem + (DECODE_BUFFER_SIZE + s_celtDec->overlap) * s_celtDec->channels);
-            oldBandE = lpc + s_celtDec->channels * 24;
-            oldLogE = oldBandE + 2 * s_celtDec->mode->nbEBands;
-            oldLogE2 = oldLogE + 2 * s_celtDec->mode->nbEBands;
+            lpc = (int16_t *)(s_celt->s_celtDec->_decode_mem + (DECODE_BUFFER_SIZE + s_celt->s_celtDec->overlap) * s_celt->s_celtDec->channels);
+            oldBandE = lpc + s_celt->s_celtDec->channels * 24;
+            oldLogE = oldBandE + 2 * s_celt->s_celtDec->mode->nbEBands;
+            oldLogE2 = oldLogE + 2 * s_celt->s_celtDec->mode->nbEBands;
 
-            int32_t n = celt_decoder_get_size(s_celtDec->channels);
-            char* dest   = (char*)&s_celtDec->rng;
-            char* offset = (char*)s_celtDec;
-            memset(dest, 0,  n - (dest - offset) * sizeof(s_celtDec));
+            int32_t n = celt_decoder_get_size(s_celt->s_celtDec->channels);
+            char* dest   = (char*)&s_celt->s_celtDec->rng;
+            char* offset = (char*)s_celt->s_celtDec;
+            memset(dest, 0,  n - (dest - offset) * sizeof(s_celt->s_celtDec));
 
-            for (i = 0; i < 2 * s_celtDec->mode->nbEBands; i++) oldLogE[i] = oldLogE2[i] = -QCONST16(28.f, 10);
+            for (i = 0; i < 2 * s_celt->s_celtDec->mode->nbEBands; i++) oldLogE[i] = oldLogE2[i] = -QCONST16(28.f, 10);
         } break;
         case CELT_GET_MODE_REQUEST: {
             const CELTMode **value = va_arg(ap, const CELTMode **);
             if (value == 0){va_end(ap); return ERR_OPUS_CELT_GET_MODE_REQUEST;}
-            *value = s_celtDec->mode;
+            *value = s_celt->s_celtDec->mode;
         } break;
         case CELT_SET_SIGNALLING_REQUEST: {
             int32_t value = va_arg(ap, int32_t);
-            s_celtDec->signalling = value;
+            s_celt->s_celtDec->signalling = value;
         } break;
         default:
             va_end(ap);
@@ -2631,9 +2616,9 @@ uint32_t ec_tell_frac() {
     uint32_t r;
     int32_t l;
     uint32_t b;
-    nbits = s_ec.nbits_total << BITRES;
-    l = EC_ILOG(s_ec.rng);
-    r = s_ec.rng >> (l - 16);
+    nbits = s_celt->s_ec.nbits_total << BITRES;
+    l = EC_ILOG(s_celt->s_ec.rng);
+    r = s_celt->s_ec.rng >> (l - 16);
     b = (r >> 12) - 8;
     b += r > correction[b];
     l = (l << 3) + b;
@@ -2641,46 +2626,46 @@ uint32_t ec_tell_frac() {
 }
 //----------------------------------------------------------------------------------------------------------------------
 
-int32_t ec_read_byte() { return s_ec.offs < s_ec.storage ? s_ec.buf[s_ec.offs++] : 0; }
+int32_t ec_read_byte() { return s_celt->s_ec.offs < s_celt->s_ec.storage ? s_celt->s_ec.buf[s_celt->s_ec.offs++] : 0; }
 
 //----------------------------------------------------------------------------------------------------------------------
 
 int32_t ec_read_byte_from_end() {
-    return s_ec.end_offs < s_ec.storage ? s_ec.buf[s_ec.storage - ++(s_ec.end_offs)] : 0;
+    return s_celt->s_ec.end_offs < s_celt->s_ec.storage ? s_celt->s_ec.buf[s_celt->s_ec.storage - ++(s_celt->s_ec.end_offs)] : 0;
 }
 //----------------------------------------------------------------------------------------------------------------------
 
 /*Normalizes the contents of val and rng so that rng lies entirely in the high-order symbol.*/
 void ec_dec_normalize() {
     /*If the range is too small, rescale it and input some bits.*/
-    while (s_ec.rng <= EC_CODE_BOT) {
+    while (s_celt->s_ec.rng <= EC_CODE_BOT) {
         int32_t sym;
-        s_ec.nbits_total += EC_SYM_BITS;
-        s_ec.rng <<= EC_SYM_BITS;
+        s_celt->s_ec.nbits_total += EC_SYM_BITS;
+        s_celt->s_ec.rng <<= EC_SYM_BITS;
         /*Use up the remaining bits from our last symbol.*/
-        sym = s_ec.rem;
+        sym = s_celt->s_ec.rem;
         /*Read the next value from the input.*/
-        s_ec.rem = ec_read_byte();
+        s_celt->s_ec.rem = ec_read_byte();
         /*Take the rest of the bits we need from this new symbol.*/
-        sym = (sym << EC_SYM_BITS | s_ec.rem) >> (EC_SYM_BITS - EC_CODE_EXTRA);
+        sym = (sym << EC_SYM_BITS | s_celt->s_ec.rem) >> (EC_SYM_BITS - EC_CODE_EXTRA);
         /*And subtract them from val, capped to be less than EC_CODE_TOP.*/
-        s_ec.val = ((s_ec.val << EC_SYM_BITS) + (EC_SYM_MAX & ~sym)) & (EC_CODE_TOP - 1);
+        s_celt->s_ec.val = ((s_celt->s_ec.val << EC_SYM_BITS) + (EC_SYM_MAX & ~sym)) & (EC_CODE_TOP - 1);
     }
 }
 //----------------------------------------------------------------------------------------------------------------------
 
 void ec_dec_init(uint8_t *_buf, uint32_t _storage) {
-    s_ec.buf = _buf;
-    s_ec.storage = _storage;
-    s_ec.end_offs = 0;
-    s_ec.end_window = 0;
-    s_ec.nend_bits = 0;
-    s_ec.nbits_total = EC_CODE_BITS + 1 - ((EC_CODE_BITS - EC_CODE_EXTRA) / EC_SYM_BITS) * EC_SYM_BITS;
-    s_ec.offs = 0;
-    s_ec.rng = 1U << EC_CODE_EXTRA;
-    s_ec.rem = ec_read_byte();
-    s_ec.val = s_ec.rng - 1 - (s_ec.rem >> (EC_SYM_BITS - EC_CODE_EXTRA));
-    s_ec.error = 0;
+    s_celt->s_ec.buf = _buf;
+    s_celt->s_ec.storage = _storage;
+    s_celt->s_ec.end_offs = 0;
+    s_celt->s_ec.end_window = 0;
+    s_celt->s_ec.nend_bits = 0;
+    s_celt->s_ec.nbits_total = EC_CODE_BITS + 1 - ((EC_CODE_BITS - EC_CODE_EXTRA) / EC_SYM_BITS) * EC_SYM_BITS;
+    s_celt->s_ec.offs = 0;
+    s_celt->s_ec.rng = 1U << EC_CODE_EXTRA;
+    s_celt->s_ec.rem = ec_read_byte();
+    s_celt->s_ec.val = s_celt->s_ec.rng - 1 - (s_celt->s_ec.rem >> (EC_SYM_BITS - EC_CODE_EXTRA));
+    s_celt->s_ec.error = 0;
     /*Normalize the interval.*/
     ec_dec_normalize();
 }
@@ -2689,30 +2674,30 @@ void ec_dec_init(uint8_t *_buf, uint32_t _storage) {
 uint32_t ec_decode(uint32_t _ft) {
     uint32_t s;
     assert(_ft > 0);
-    s_ec.ext = s_ec.rng / _ft;
-    s = (uint32_t)(s_ec.val / s_ec.ext);
+    s_celt->s_ec.ext = s_celt->s_ec.rng / _ft;
+    s = (uint32_t)(s_celt->s_ec.val / s_celt->s_ec.ext);
     return _ft - EC_MINI(s + 1, _ft);
 }
 //----------------------------------------------------------------------------------------------------------------------
 
 uint32_t ec_decode_bin(uint32_t _bits) {
     uint32_t s;
-    s_ec.ext = s_ec.rng >> _bits;
-    s = (uint32_t)(s_ec.val / s_ec.ext);
+    s_celt->s_ec.ext = s_celt->s_ec.rng >> _bits;
+    s = (uint32_t)(s_celt->s_ec.val / s_celt->s_ec.ext);
     return (1U << _bits) - EC_MINI(s + 1U, 1U << _bits);
 }
 //----------------------------------------------------------------------------------------------------------------------
 
 void ec_dec_update(uint32_t _fl, uint32_t _fh, uint32_t _ft) {
     uint32_t s;
-    s = s_ec.ext *  (_ft - _fh);
-    s_ec.val -= s;
+    s = s_celt->s_ec.ext *  (_ft - _fh);
+    s_celt->s_ec.val -= s;
 
     if(_fl > 0){
-        s_ec.rng = s_ec.ext * (_fh - _fl);
+        s_celt->s_ec.rng = s_celt->s_ec.ext * (_fh - _fl);
     }
     else{
-        s_ec.rng = s_ec.rng - s;
+        s_celt->s_ec.rng = s_celt->s_ec.rng - s;
     }
     ec_dec_normalize();
 }
@@ -2724,12 +2709,12 @@ int32_t ec_dec_bit_logp(uint32_t _logp) {
     uint32_t d;
     uint32_t s;
     int32_t ret;
-    r = s_ec.rng;
-    d = s_ec.val;
+    r = s_celt->s_ec.rng;
+    d = s_celt->s_ec.val;
     s = r >> _logp;
     ret = d < s;
-    if (!ret) s_ec.val = d - s;
-    s_ec.rng = ret ? s : r - s;
+    if (!ret) s_celt->s_ec.val = d - s;
+    s_celt->s_ec.rng = ret ? s : r - s;
     ec_dec_normalize();
     return ret;
 }
@@ -2741,16 +2726,16 @@ int32_t ec_dec_icdf(const uint8_t *_icdf, uint32_t _ftb) {
     uint32_t s;
     uint32_t t;
     int32_t ret;
-    s = s_ec.rng;
-    d = s_ec.val;
+    s = s_celt->s_ec.rng;
+    d = s_celt->s_ec.val;
     r = s >> _ftb;
     ret = -1;
     do {
         t = s;
         s = r * _icdf[++ret];
     } while (d < s);
-    s_ec.val = d - s;
-    s_ec.rng = t - s;
+    s_celt->s_ec.val = d - s;
+    s_celt->s_ec.rng = t - s;
     ec_dec_normalize();
     return ret;
 }
@@ -2772,7 +2757,7 @@ uint32_t ec_dec_uint(uint32_t _ft) {
         ec_dec_update(s, s + 1, ft);
         t = (uint32_t)s << ftb | ec_dec_bits(ftb);
         if (t <= _ft) return t;
-        s_ec.error = 1;
+        s_celt->s_ec.error = 1;
         return _ft;
     } else {
         _ft++;
@@ -2787,8 +2772,8 @@ uint32_t ec_dec_bits(uint32_t _bits) {
     uint32_t window;
     int32_t available;
     uint32_t ret;
-    window = s_ec.end_window;
-    available = s_ec.nend_bits;
+    window = s_celt->s_ec.end_window;
+    available = s_celt->s_ec.nend_bits;
     if ((uint32_t)available < _bits) {
         do {
             window |= (uint32_t)ec_read_byte_from_end() << available;
@@ -2798,9 +2783,9 @@ uint32_t ec_dec_bits(uint32_t _bits) {
     ret = (uint32_t)window & (((uint32_t)1 << _bits) - 1U);
     window >>= _bits;
     available -= _bits;
-    s_ec.end_window = window;
-    s_ec.nend_bits = available;
-    s_ec.nbits_total += _bits;
+    s_celt->s_ec.end_window = window;
+    s_celt->s_ec.nend_bits = available;
+    s_celt->s_ec.nbits_total += _bits;
     return ret;
 }
 //----------------------------------------------------------------------------------------------------------------------
@@ -2948,7 +2933,7 @@ void kf_bfly5(kiss_fft_cpx *Fout, const size_t fstride, const kiss_fft_state *st
     kiss_fft_cpx *Fout0, *Fout1, *Fout2, *Fout3, *Fout4;
     int32_t i, u;
     kiss_fft_cpx scratch[13];
-    const kiss_twiddle_cpx *tw;
+    const kiss_twiddle_cpx *tw1, *tw2, *tw3, *tw4;
     kiss_twiddle_cpx ya, yb;
     kiss_fft_cpx *Fout_beg = Fout;
 
@@ -2956,7 +2941,6 @@ void kf_bfly5(kiss_fft_cpx *Fout, const size_t fstride, const kiss_fft_state *st
     ya.i = -31164;
     yb.r = -26510;
     yb.i = -19261;
-    tw = st->twiddles;
 
     for (i = 0; i < N; i++) {
         Fout = Fout_beg + i * mm;
@@ -2965,15 +2949,20 @@ void kf_bfly5(kiss_fft_cpx *Fout, const size_t fstride, const kiss_fft_state *st
         Fout2 = Fout0 + 2 * m;
         Fout3 = Fout0 + 3 * m;
         Fout4 = Fout0 + 4 * m;
+        tw1 = tw2 = tw3 = tw4 = st->twiddles; /* stepped like in kf_bfly4, no index multiplies */
 
         /* For non-custom modes, m is guaranteed to be a multiple of 4. */
         for (u = 0; u < m; ++u) {
             scratch[0] = *Fout0;
 
-            C_MUL(scratch[1], *Fout1, tw[u * fstride]);
-            C_MUL(scratch[2], *Fout2, tw[2 * u * fstride]);
-            C_MUL(scratch[3], *Fout3, tw[3 * u * fstride]);
-            C_MUL(scratch[4], *Fout4, tw[4 * u * fstride]);
+            C_MUL(scratch[1], *Fout1, *tw1);
+            C_MUL(scratch[2], *Fout2, *tw2);
+            C_MUL(scratch[3], *Fout3, *tw3);
+            C_MUL(scratch[4], *Fout4, *tw4);
+            tw1 += fstride;
+            tw2 += 2 * fstride;
+            tw3 += 3 * fstride;
+            tw4 += 4 * fstride;
 
             C_ADD(scratch[7], scratch[1], scratch[4]);
             C_SUB(scratch[10], scratch[1], scratch[4]);
@@ -3563,7 +3552,7 @@ int32_t clt_compute_allocation(const int32_t *offsets, const int32_t *cap, int32
     int32_t skip_rsv;
     int32_t intensity_rsv;
     int32_t dual_stereo_rsv;
-    const uint8_t end = s_celtDec->end;  // 21
+    const uint8_t end = s_celt->s_celtDec->end;  // 21
 
     total = _max(total, 0);
     len = m_CELTMode.nbEBands; // =21
@@ -3584,10 +3573,10 @@ int32_t clt_compute_allocation(const int32_t *offsets, const int32_t *cap, int32
     }
 
     assert(len <= 21);
-    int32_t* bits1       = s_bits1Buff;
-    int32_t* bits2       = s_bits2Buff;
-    int32_t* thresh      = s_threshBuff;
-    int32_t* trim_offset = s_trim_offsetBuff;
+    int32_t* bits1       = s_celt->s_bits1Buff;
+    int32_t* bits2       = s_celt->s_bits2Buff;
+    int32_t* thresh      = s_celt->s_threshBuff;
+    int32_t* trim_offset = s_celt->s_trim_offsetBuff;
 
     for (j = 0; j < end; j++) {
         /* Below this threshold, we're sure not to allocate any PVQ bits */
@@ -3657,7 +3646,7 @@ void unquant_coarse_energy(int16_t *oldEBands, int32_t intra, int32_t C, int32_t
     int16_t beta;
     int32_t budget;
     int32_t tell;
-    const uint8_t end = s_celtDec->end;  // 21
+    const uint8_t end = s_celt->s_celtDec->end;  // 21
 
     if (intra) {
         coef = 0;
@@ -3667,7 +3656,7 @@ void unquant_coarse_energy(int16_t *oldEBands, int32_t intra, int32_t C, int32_t
         coef = pred_coef[LM];
     }
 
-    budget = s_ec.storage * 8;
+    budget = s_celt->s_ec.storage * 8;
 
     /* Decode at a fixed coarse resolution */
     for (i = 0; i < end; i++) {
@@ -3706,7 +3695,7 @@ void unquant_coarse_energy(int16_t *oldEBands, int32_t intra, int32_t C, int32_t
 
 void unquant_fine_energy(int16_t *oldEBands, int32_t *fine_quant, int32_t C) {
     int32_t i, c;
-    const uint8_t end = s_celtDec->end;  // 21
+    const uint8_t end = s_celt->s_celtDec->end;  // 21
     /* Decode finer resolution */
     for (i = 0; i < end; i++) {
         if (fine_quant[i] <= 0) continue;
@@ -3726,7 +3715,7 @@ void unquant_fine_energy(int16_t *oldEBands, int32_t *fine_quant, int32_t C) {
 void unquant_energy_finalise(int16_t *oldEBands, int32_t *fine_quant,
                              int32_t *fine_priority, int32_t bits_left, int32_t C) {
     int32_t i, prio, c;
-    const uint8_t  end = s_celtDec->end;  // 21
+    const uint8_t  end = s_celt->s_celtDec->end;  // 21
 
     /* Use up the remaining bits */
     for (prio = 0; prio < 2; prio++) {
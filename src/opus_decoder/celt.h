@@ -39,6 +39,17 @@
 #include <stdint.h>
 //#include <cstddef>
 #include <assert.h>
+#if defined(__XTENSA__) && !defined(OPUS_GENERIC_C) // define OPUS_GENERIC_C to build the exact C multiplies for comparison
+#include <xtensa/config/core-isa.h>
+#endif
+
+// The context pointers are used across files: an extern thread_local that is not known to be constant initialized
+// is read through a TLS init wrapper on every access
+#if defined(__cpp_constinit)
+#define OPUS_CONSTINIT constinit
+#else
+#define OPUS_CONSTINIT
+#endif
 
 #define OPUS_RESET_STATE             4028
 #define OPUS_GET_SAMPLE_RATE_REQUEST 4029
@@ -82,7 +93,6 @@ typedef struct _ec_ctx {
     int32_t  error; /*Nonzero if an error occurred.*/
 } ec_ctx_t;
 
-extern ec_ctx_t s_ec;
 extern const uint8_t cache_bits50[392];
 extern const int16_t cache_index50[105];
 
@@ -100,6 +110,25 @@ typedef struct _band_ctx{
     int32_t avoid_split_noise;
 } band_ctx_t;
 
+// CELT state of one Opus stream, part of the OPUSDecoder_t context (see OPUSDecoder_CreateContext)
+typedef struct _celt_ctx{
+    CELTDecoder* s_celtDec = NULL;
+    band_ctx_t   s_band_ctx;
+    ec_ctx_t     s_ec;
+    int32_t*     s_freqBuff = NULL;           // mem in celt_synthesis
+    int32_t*     s_iyBuff = NULL;             // mem in alg_unquant
+    int16_t*     s_normBuff = NULL;           // mem in quant_all_bands
+    int16_t*     s_XBuff = NULL;              // mem in celt_decode_with_ec
+    int32_t*     s_bits1Buff = NULL;          // mem in clt_compute_allocation
+    int32_t*     s_bits2Buff = NULL;          // mem in clt_compute_allocation
+    int32_t*     s_threshBuff = NULL;         // mem in clt_compute_allocation
+    int32_t*     s_trim_offsetBuff = NULL;    // mem in clt_compute_allocation
+    uint8_t*     s_collapse_masksBuff = NULL; // mem n celt_decode_with_ec
+    int16_t*     s_tmpBuff = NULL;            // mem in deinterleave_hadamard and interleave_hadamard
+} celt_ctx_t;
+
+extern thread_local OPUS_CONSTINIT celt_ctx_t* s_celt; // bound with OPUSDecoder_SetContext()
+
 struct split_ctx{
     int32_t inv;
     int32_t imid;
@@ -192,7 +221,14 @@ extern const CELTMode m_CELTMode;
     #define _max(a,b) ((a)>(b)?(a):(b))
 #endif
 
+#if defined(__XTENSA__) && !defined(OPUS_GENERIC_C) && XCHAL_HAVE_MUL32_HIGH
+/* 32x16 -> Q15 as the high word of a * (b << 16), shifted back by one. Drops the lowest result bit like the
+   libopus ARMv5E path (SMULWB); used by the FFT butterflies, the MDCT rotations and the comb filter */
+inline int32_t MULSH_Q16(int32_t a, int16_t b){int32_t z; asm ("mulsh %0, %1, %2" : "=a" (z) : "a" (a), "a" ((int32_t)b << 16)); return z;}
+inline int32_t S_MUL(int32_t a, int16_t b){return MULSH_Q16(a, b) << 1;}
+#else
 inline int32_t S_MUL(int32_t a, int16_t b){return (int64_t)b * a >> 15;}
+#endif
 #define C_MUL(m,a,b)  do{ (m).r = SUB32_ovflw(S_MUL((a).r,(b).r) , S_MUL((a).i,(b).i)); \
                           (m).i = ADD32_ovflw(S_MUL((a).r,(b).i) , S_MUL((a).i,(b).r)); }while(0)
 
@@ -227,7 +263,11 @@ inline int32_t MULT16_32_Q16(int64_t a, int64_t b){return (int32_t) (a * b) >> 1
 #define MULT16_32_P16(a,b) ((int32_t)PSHR((int64_t)((int16_t)(a))*(b),16))
 
 /** 16x32 multiplication, followed by a 15-bit shift right. Results fits in 32 bits */
+#if defined(__XTENSA__) && !defined(OPUS_GENERIC_C) && XCHAL_HAVE_MUL32_HIGH
+inline int32_t MULT16_32_Q15(int16_t a, int32_t b){return MULSH_Q16(b, a) << 1;}
+#else
 inline int32_t MULT16_32_Q15(int16_t a, int32_t b){return (int64_t)a * b >> 15;}
+#endif
 
 /** 32x32 multiplication, followed by a 31-bit shift right. Results fits in 32 bits */
 #define MULT32_32_Q31(a,b) ((int32_t)((int64_t)(a)*(int64_t)(b) >> 31))
@@ -358,7 +398,7 @@ inline int16_t sig2word16(int32_t x){
 }
 
 inline int32_t ec_tell(){
-  return s_ec.nbits_total-EC_ILOG(s_ec.rng);
+  return s_celt->s_ec.nbits_total-EC_ILOG(s_celt->s_ec.rng);
 }
 
 /* Atan approximation using a 4th order polynomial. Input is in Q15 format and normalized by pi/4. Output is in
@@ -11,13 +11,16 @@
 #include "opus_decoder.h"
 #include "celt.h"
 #include "silk.h"
+#include "../AudioMemory.h"
 #include "Arduino.h"
 #include <vector>
+#include <new>
+#include "esp_cpu.h"
 
 #define __malloc_heap_psram(size) \
-    heap_caps_malloc_prefer(size, 2, MALLOC_CAP_DEFAULT | MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL)
+    AudioMemory::alloc(size, AUDIO_MEM_PSRAM_PREFERRED)
 #define __calloc_heap_psram(ch, size) \
-    heap_caps_calloc_prefer(ch, size, 2, MALLOC_CAP_DEFAULT | MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL)
+    AudioMemory::calloc(ch, size, AUDIO_MEM_PSRAM_PREFERRED)
 
 // global vars
 const uint32_t CELT_SET_END_BAND_REQUEST   = 10012;
@@ -29,57 +32,105 @@ enum {OPUS_BANDWIDTH_NARROWBAND = 1101,    OPUS_BANDWIDTH_MEDIUMBAND = 1102, OPU
       OPUS_BANDWIDTH_SUPERWIDEBAND = 1104, OPUS_BANDWIDTH_FULLBAND = 1105};
 enum {MODE_NONE = 0, MODE_SILK_ONLY = 1000, MODE_HYBRID = 1001,  MODE_CELT_ONLY = 1002};
 
-bool      s_f_opusParseOgg = false;
-bool      s_f_newSteamTitle = false;  // streamTitle
-bool      s_f_opusNewMetadataBlockPicture = false; // new metadata block picture
-bool      s_f_opusStereoFlag = false;
-bool      s_f_continuedPage = false;
-bool      s_f_firstPage = false;
-bool      s_f_lastPage = false;
-bool      s_f_nextChunk = false;
-
-uint8_t   s_opusChannels = 0;
-uint16_t  s_mode = 0;
-uint8_t   s_opusCountCode =  0;
-uint8_t   s_opusPageNr = 0;
-uint8_t   s_frameCount = 0;
-uint16_t  s_opusOggHeaderSize = 0;
-uint16_t  s_bandWidth = 0;
-uint16_t  s_internalSampleRate = 0;
-uint16_t  s_endband =0;
-uint32_t  s_opusSamplerate = 0;
-uint32_t  s_opusSegmentLength = 0;
-uint32_t  s_opusCurrentFilePos = 0;
-uint32_t  s_opusAudioDataStart = 0;
-int32_t   s_opusBlockPicLen = 0;
-int32_t   s_blockPicLenUntilFrameEnd = 0;
-int32_t   s_opusRemainBlockPicLen = 0;
-int32_t   s_opusCommentBlockSize = 0;
-uint32_t  s_opusBlockPicPos = 0;
-uint32_t  s_opusBlockLen = 0;
-char     *s_opusChbuf = NULL;
-int32_t   s_opusValidSamples = 0;
-
-uint16_t *s_opusSegmentTable;
-uint8_t   s_opusSegmentTableSize = 0;
-int16_t   s_opusSegmentTableRdPtr = -1;
-int8_t    s_opusError = 0;
-int8_t    s_prev_mode = 0;
-float     s_opusCompressionRatio = 0;
-
-std::vector <uint32_t>s_opusBlockPicItem;
-
+// Decoder state, one per stream (see OPUSDecoder_CreateContext)
+struct OPUSDecoder_t {
+    bool                  s_f_opusParseOgg = false;
+    bool                  s_f_newSteamTitle = false; // streamTitle
+    bool                  s_f_opusNewMetadataBlockPicture = false; // new metadata block picture
+    bool                  s_f_opusStereoFlag = false;
+    bool                  s_f_continuedPage = false;
+    bool                  s_f_firstPage = false;
+    bool                  s_f_lastPage = false;
+    bool                  s_f_nextChunk = false;
+
+    uint8_t               s_opusChannels = 0;
+    uint16_t              s_mode = 0;
+    uint8_t               s_opusCountCode = 0;
+    uint8_t               s_opusPageNr = 0;
+    uint8_t               s_frameCount = 0;
+    uint16_t              s_opusOggHeaderSize = 0;
+    uint16_t              s_bandWidth = 0;
+    uint16_t              s_internalSampleRate = 0;
+    uint16_t              s_endband = 0;
+    uint32_t              s_opusSamplerate = 0;
+    uint32_t              s_opusSegmentLength = 0;
+    uint32_t              s_opusCurrentFilePos = 0;
+    uint32_t              s_opusAudioDataStart = 0;
+    int32_t               s_opusBlockPicLen = 0;
+    int32_t               s_blockPicLenUntilFrameEnd = 0;
+    int32_t               s_opusRemainBlockPicLen = 0;
+    int32_t               s_opusCommentBlockSize = 0;
+    uint32_t              s_opusBlockPicPos = 0;
+    uint32_t              s_opusBlockLen = 0;
+    char*                 s_opusChbuf = NULL;
+    int32_t               s_opusValidSamples = 0;
+
+    uint16_t*             s_opusSegmentTable = NULL;
+    uint8_t               s_opusSegmentTableSize = 0;
+    int16_t               s_opusSegmentTableRdPtr = -1;
+    int8_t                s_opusError = 0;
+    int8_t                s_prev_mode = 0;
+    float                 s_opusCompressionRatio = 0;
+
+    std::vector<uint32_t> s_opusBlockPicItem;
+
+    int8_t                s_configNr = 0;
+    uint16_t              s_samplesPerFrame = 0;
+    uint16_t              s_code1FrameSize = 0;
+    uint16_t              s_code2FirstFrameLength = 0;
+    uint16_t              s_code2SecondFrameLength = 0;
+    bool                  s_code3FirstCall = true;
+    bool                  s_code3Vbr = false; // VBR indicator
+    bool                  s_code3Padding = false; // padding exists
+    int16_t               s_code3FrameSize = 0; // frame size
+    uint8_t               s_code3FrameCount = 0; // nr of frames
+    int32_t               s_code3SamplesPerFrame = 0; // static samples per frame
+    int32_t               s_code3PaddingLength = 0;
+
+    OPUSDecodeStats_t     s_stats = {};
+
+    celt_ctx_t            celt;
+    silk_ctx_t            silk;
+};
+
+static OPUSDecoder_t s_opusDefault;                      // used by tasks that never call OPUSDecoder_SetContext()
+static thread_local OPUSDecoder_t* s_opus = &s_opusDefault;
+thread_local OPUS_CONSTINIT celt_ctx_t* s_celt = &s_opusDefault.celt;
+thread_local OPUS_CONSTINIT silk_ctx_t* s_silk = &s_opusDefault.silk;
+
+OPUSDecoder_t* OPUSDecoder_CreateContext(){
+    void* mem = AudioMemory::alloc(sizeof(OPUSDecoder_t), AUDIO_MEM_INTERNAL_PREFERRED);
+    if(!mem) return NULL;
+    return new (mem) OPUSDecoder_t();
+}
+void OPUSDecoder_DestroyContext(OPUSDecoder_t* ctx){
+    if(!ctx || ctx == &s_opusDefault) return;
+    OPUSDecoder_t* prev = s_opus;
+    OPUSDecoder_SetContext(ctx);
+    OPUSDecoder_FreeBuffers();
+    OPUSDecoder_SetContext(prev == ctx ? NULL : prev);
+    ctx->~OPUSDecoder_t();
+    AudioMemory::release(ctx);
+}
+void OPUSDecoder_SetContext(OPUSDecoder_t* ctx){
+    s_opus = ctx ? ctx : &s_opusDefault;
+    s_celt = &s_opus->celt;
+    s_silk = &s_opus->silk;
+}
+OPUSDecoder_t* OPUSDecoder_GetContext(){
+    return s_opus;
+}
 bool OPUSDecoder_AllocateBuffers(){
-    s_opusChbuf = (char*)__malloc_heap_psram(512);
+    s_opus->s_opusChbuf = (char*)__malloc_heap_psram(512);
     if(!CELTDecoder_AllocateBuffers()) {log_e("CELT not init"); return false;}
-    s_opusSegmentTable = (uint16_t*)__malloc_heap_psram(256 * sizeof(uint16_t));
-    if(!s_opusSegmentTable) {log_e("CELT not init"); return false;}
+    s_opus->s_opusSegmentTable = (uint16_t*)__malloc_heap_psram(256 * sizeof(uint16_t));
+    if(!s_opus->s_opusSegmentTable) {log_e("CELT not init"); return false;}
     CELTDecoder_ClearBuffer();
     OPUSDecoder_ClearBuffers();
     // allocate CELT buffers after OPUS head (nr of channels is needed)
-    s_opusError = celt_decoder_init(2); if(s_opusError < 0) {log_e("CELT not init"); return false;}
-    s_opusError = celt_decoder_ctl(CELT_SET_SIGNALLING_REQUEST,  0); if(s_opusError < 0) {log_e("CELT not init"); return false;}
-    s_opusError = celt_decoder_ctl(CELT_SET_END_BAND_REQUEST,   21); if(s_opusError < 0) {log_e("CELT not init"); return false;}
+    s_opus->s_opusError = celt_decoder_init(2); if(s_opus->s_opusError < 0) {log_e("CELT not init"); return false;}
+    s_opus->s_opusError = celt_decoder_ctl(CELT_SET_SIGNALLING_REQUEST,  0); if(s_opus->s_opusError < 0) {log_e("CELT not init"); return false;}
+    s_opus->s_opusError = celt_decoder_ctl(CELT_SET_END_BAND_REQUEST,   21); if(s_opus->s_opusError < 0) {log_e("CELT not init"); return false;}
     OPUSsetDefaults();
 
     int32_t ret = 0, silkDecSizeBytes = 0;
@@ -96,58 +147,58 @@ bool OPUSDecoder_AllocateBuffers(){
     return true;
 }
 void OPUSDecoder_FreeBuffers(){
-    if(s_opusChbuf)        {free(s_opusChbuf);        s_opusChbuf = NULL;}
-    if(s_opusSegmentTable) {free(s_opusSegmentTable); s_opusSegmentTable = NULL;}
-    s_frameCount = 0;
-    s_opusSegmentLength = 0;
-    s_opusValidSamples = 0;
-    s_opusSegmentTableSize = 0;
-    s_opusOggHeaderSize = 0;
-    s_opusSegmentTableRdPtr = -1;
-    s_opusCountCode = 0;
+    if(s_opus->s_opusChbuf)        {AudioMemory::release(s_opus->s_opusChbuf);        s_opus->s_opusChbuf = NULL;}
+    if(s_opus->s_opusSegmentTable) {AudioMemory::release(s_opus->s_opusSegmentTable); s_opus->s_opusSegmentTable = NULL;}
+    s_opus->s_frameCount = 0;
+    s_opus->s_opusSegmentLength = 0;
+    s_opus->s_opusValidSamples = 0;
+    s_opus->s_opusSegmentTableSize = 0;
+    s_opus->s_opusOggHeaderSize = 0;
+    s_opus->s_opusSegmentTableRdPtr = -1;
+    s_opus->s_opusCountCode = 0;
     CELTDecoder_FreeBuffers();
 }
 void OPUSDecoder_ClearBuffers(){
-    if(s_opusChbuf)        memset(s_opusChbuf, 0, 512);
-    if(s_opusSegmentTable) memset(s_opusSegmentTable, 0, 256 * sizeof(int16_t));
-    s_frameCount = 0;
-    s_opusSegmentLength = 0;
-    s_opusValidSamples = 0;
-    s_opusSegmentTableSize = 0;
-    s_opusOggHeaderSize = 0;
-    s_opusSegmentTableRdPtr = -1;
-    s_opusCountCode = 0;
+    if(s_opus->s_opusChbuf)        memset(s_opus->s_opusChbuf, 0, 512);
+    if(s_opus->s_opusSegmentTable) memset(s_opus->s_opusSegmentTable, 0, 256 * sizeof(int16_t));
+    s_opus->s_frameCount = 0;
+    s_opus->s_opusSegmentLength = 0;
+    s_opus->s_opusValidSamples = 0;
+    s_opus->s_opusSegmentTableSize = 0;
+    s_opus->s_opusOggHeaderSize = 0;
+    s_opus->s_opusSegmentTableRdPtr = -1;
+    s_opus->s_opusCountCode = 0;
 }
 void OPUSsetDefaults(){
-    s_f_opusParseOgg = false;
-    s_f_newSteamTitle = false;  // streamTitle
-    s_f_opusNewMetadataBlockPicture = false;
-    s_f_opusStereoFlag = false;
-    s_opusChannels = 0;
-    s_frameCount = 0;
-    s_mode = 0;
-    s_opusSamplerate = 0;
-    s_internalSampleRate = 0;
-    s_bandWidth = 0;
-    s_opusSegmentLength = 0;
-    s_opusValidSamples = 0;
-    s_opusSegmentTableSize = 0;
-    s_opusOggHeaderSize = 0;
-    s_opusSegmentTableRdPtr = -1;
-    s_opusCountCode = 0;
-    s_opusBlockPicPos = 0;
-    s_opusCurrentFilePos = 0;
-    s_opusAudioDataStart = 0;
-    s_opusBlockPicLen = 0;
-    s_opusCommentBlockSize = 0;
-    s_opusRemainBlockPicLen = 0;
-    s_blockPicLenUntilFrameEnd = 0;
-    s_opusBlockLen = 0;
-    s_opusPageNr = 0;
-    s_opusError = 0;
-    s_endband = 0;
-    s_prev_mode = 0;
-    s_opusBlockPicItem.clear(); s_opusBlockPicItem.shrink_to_fit();
+    s_opus->s_f_opusParseOgg = false;
+    s_opus->s_f_newSteamTitle = false;  // streamTitle
+    s_opus->s_f_opusNewMetadataBlockPicture = false;
+    s_opus->s_f_opusStereoFlag = false;
+    s_opus->s_opusChannels = 0;
+    s_opus->s_frameCount = 0;
+    s_opus->s_mode = 0;
+    s_opus->s_opusSamplerate = 0;
+    s_opus->s_internalSampleRate = 0;
+    s_opus->s_bandWidth = 0;
+    s_opus->s_opusSegmentLength = 0;
+    s_opus->s_opusValidSamples = 0;
+    s_opus->s_opusSegmentTableSize = 0;
+    s_opus->s_opusOggHeaderSize = 0;
+    s_opus->s_opusSegmentTableRdPtr = -1;
+    s_opus->s_opusCountCode = 0;
+    s_opus->s_opusBlockPicPos = 0;
+    s_opus->s_opusCurrentFilePos = 0;
+    s_opus->s_opusAudioDataStart = 0;
+    s_opus->s_opusBlockPicLen = 0;
+    s_opus->s_opusCommentBlockSize = 0;
+    s_opus->s_opusRemainBlockPicLen = 0;
+    s_opus->s_blockPicLenUntilFrameEnd = 0;
+    s_opus->s_opusBlockLen = 0;
+    s_opus->s_opusPageNr = 0;
+    s_opus->s_opusError = 0;
+    s_opus->s_endband = 0;
+    s_opus->s_prev_mode = 0;
+    s_opus->s_opusBlockPicItem.clear(); s_opus->s_opusBlockPicItem.shrink_to_fit();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -157,72 +208,72 @@ int32_t OPUSDecode(uint8_t* inbuf, int32_t* bytesLeft, int16_t* outbuf) {
     int32_t ret = ERR_OPUS_NONE;
     int32_t segmLen = 0;
 
-    if(s_opusCommentBlockSize) {
-        if(s_opusCommentBlockSize > 8192) {
-            s_opusRemainBlockPicLen -= 8192;
+    if(s_opus->s_opusCommentBlockSize) {
+        if(s_opus->s_opusCommentBlockSize > 8192) {
+            s_opus->s_opusRemainBlockPicLen -= 8192;
             *bytesLeft -= 8192;
-            s_opusCurrentFilePos += 8192;
-            s_opusCommentBlockSize -= 8192;
+            s_opus->s_opusCurrentFilePos += 8192;
+            s_opus->s_opusCommentBlockSize -= 8192;
         }
         else {
-            s_opusRemainBlockPicLen -= s_opusCommentBlockSize;
-            *bytesLeft -= s_opusCommentBlockSize;
-            s_opusCurrentFilePos += s_opusCommentBlockSize;
-            s_opusCommentBlockSize = 0;
+            s_opus->s_opusRemainBlockPicLen -= s_opus->s_opusCommentBlockSize;
+            *bytesLeft -= s_opus->s_opusCommentBlockSize;
+            s_opus->s_opusCurrentFilePos += s_opus->s_opusCommentBlockSize;
+            s_opus->s_opusCommentBlockSize = 0;
         }
-        if(s_opusRemainBlockPicLen <= 0) {
-            if(s_opusBlockPicItem.size() > 0) { // get blockpic data
+        if(s_opus->s_opusRemainBlockPicLen <= 0) {
+            if(s_opus->s_opusBlockPicItem.size() > 0) { // get blockpic data
                 // log_i("---------------------------------------------------------------------------");
                 // log_i("metadata blockpic found at pos %i, size %i bytes", s_vorbisBlockPicPos, s_vorbisBlockPicLen);
                 // for(int32_t i = 0; i < s_vorbisBlockPicItem.size(); i += 2) { log_i("segment %02i, pos %07i, len %05i", i / 2, s_vorbisBlockPicItem[i], s_vorbisBlockPicItem[i + 1]); }
                 // log_i("---------------------------------------------------------------------------");
-                s_f_opusNewMetadataBlockPicture = true;
+                s_opus->s_f_opusNewMetadataBlockPicture = true;
             }
         }
         return OPUS_PARSE_OGG_DONE;
     }
 
-    if(s_frameCount > 0) return opusDecodePage3(inbuf, bytesLeft, segmLen, outbuf); // decode audio, next part
+    if(s_opus->s_frameCount > 0) return opusDecodePage3(inbuf, bytesLeft, segmLen, outbuf); // decode audio, next part
 
-    if(!s_opusSegmentTableSize) {
-        s_f_opusParseOgg = false;
-        s_opusCountCode = 0;
+    if(!s_opus->s_opusSegmentTableSize) {
+        s_opus->s_f_opusParseOgg = false;
+        s_opus->s_opusCountCode = 0;
         ret = OPUSparseOGG(inbuf, bytesLeft);
         if(ret != ERR_OPUS_NONE) return ret; // error
-        inbuf += s_opusOggHeaderSize;
+        inbuf += s_opus->s_opusOggHeaderSize;
     }
 
-    if(s_opusSegmentTableSize > 0) {
-        s_opusSegmentTableRdPtr++;
-        s_opusSegmentTableSize--;
-        segmLen = s_opusSegmentTable[s_opusSegmentTableRdPtr];
+    if(s_opus->s_opusSegmentTableSize > 0) {
+        s_opus->s_opusSegmentTableRdPtr++;
+        s_opus->s_opusSegmentTableSize--;
+        segmLen = s_opus->s_opusSegmentTable[s_opus->s_opusSegmentTableRdPtr];
     }
 
-    if(s_opusPageNr == 0) { // OpusHead
+    if(s_opus->s_opusPageNr == 0) { // OpusHead
         ret = opusDecodePage0(inbuf, bytesLeft, segmLen);
     }
-    else if(s_opusPageNr == 1) { // OpusComment
+    else if(s_opus->s_opusPageNr == 1) { // OpusComment
         ret = parseOpusComment(inbuf, segmLen);
         if(ret == 0) log_e("OpusCommemtPage not found");
-        s_opusRemainBlockPicLen = s_opusBlockPicLen;
-        *bytesLeft -= (segmLen - s_blockPicLenUntilFrameEnd);
-        s_opusCommentBlockSize = s_blockPicLenUntilFrameEnd;
-        s_opusPageNr++;
+        s_opus->s_opusRemainBlockPicLen = s_opus->s_opusBlockPicLen;
+        *bytesLeft -= (segmLen - s_opus->s_blockPicLenUntilFrameEnd);
+        s_opus->s_opusCommentBlockSize = s_opus->s_blockPicLenUntilFrameEnd;
+        s_opus->s_opusPageNr++;
         ret = OPUS_PARSE_OGG_DONE;
     }
-    else if(s_opusPageNr == 2) { // OpusComment Subsequent Pages
-        s_opusCommentBlockSize = segmLen;
-        if(s_opusRemainBlockPicLen <= segmLen) s_opusPageNr++;
+    else if(s_opus->s_opusPageNr == 2) { // OpusComment Subsequent Pages
+        s_opus->s_opusCommentBlockSize = segmLen;
+        if(s_opus->s_opusRemainBlockPicLen <= segmLen) s_opus->s_opusPageNr++;
         ;
         ret = OPUS_PARSE_OGG_DONE;
     }
-    else if(s_opusPageNr == 3) {
+    else if(s_opus->s_opusPageNr == 3) {
         ret = opusDecodePage3(inbuf, bytesLeft, segmLen, outbuf); // decode audio
     }
     else { ; }
 
-    if(s_opusSegmentTableSize == 0) {
-        s_opusSegmentTableRdPtr = -1; // back to the parking position
+    if(s_opus->s_opusSegmentTableSize == 0) {
+        s_opus->s_opusSegmentTableRdPtr = -1; // back to the parking position
     }
     return ret;
 }
@@ -232,8 +283,8 @@ int32_t opusDecodePage0(uint8_t* inbuf, int32_t* bytesLeft, uint32_t segmentLeng
     int32_t ret = 0;
     ret = parseOpusHead(inbuf, segmentLength);
     *bytesLeft           -= segmentLength;
-    s_opusCurrentFilePos += segmentLength;
-    if(ret == 1){ s_opusPageNr++;}
+    s_opus->s_opusCurrentFilePos += segmentLength;
+    if(ret == 1){ s_opus->s_opusPageNr++;}
     if(ret == 0){ log_e("OpusHead not found"); }
     if(ret < 0) return ret;
     return OPUS_PARSE_OGG_DONE;
@@ -241,121 +292,131 @@ int32_t opusDecodePage0(uint8_t* inbuf, int32_t* bytesLeft, uint32_t segmentLeng
 //----------------------------------------------------------------------------------------------------------------------------------------------------
 int32_t opusDecodePage3(uint8_t* inbuf, int32_t* bytesLeft, uint32_t segmentLength, int16_t *outbuf){
 
-    if(s_opusAudioDataStart == 0){
-        s_opusAudioDataStart = s_opusCurrentFilePos;
+    if(s_opus->s_opusAudioDataStart == 0){
+        s_opus->s_opusAudioDataStart = s_opus->s_opusCurrentFilePos;
     }
 
 
-    s_endband = 21;
-    static int8_t configNr = 0;
-    static uint16_t samplesPerFrame = 0;
+    s_opus->s_endband = 21;
 
     int32_t ret = 0;
 
-    if(s_frameCount > 0) goto FramePacking; // more than one frame in the packet
+    if(s_opus->s_frameCount > 0) goto FramePacking; // more than one frame in the packet
 
-    configNr = parseOpusTOC(inbuf[0]);
-    if(configNr < 0) {log_e("something went wrong");  return configNr;} // SILK or Hybrid mode
+    s_opus->s_configNr = parseOpusTOC(inbuf[0]);
+    if(s_opus->s_configNr < 0) {log_e("something went wrong");  return s_opus->s_configNr;} // SILK or Hybrid mode
 
-    switch(configNr){
-        case  0 ... 3:  s_endband  = 0; // OPUS_BANDWIDTH_SILK_NARROWBAND
-                        s_mode = MODE_SILK_ONLY;
-                        s_bandWidth = OPUS_BANDWIDTH_NARROWBAND;
-                        s_internalSampleRate = 8000;
+    switch(s_opus->s_configNr){
+        case  0 ... 3:  s_opus->s_endband  = 0; // OPUS_BANDWIDTH_SILK_NARROWBAND
+                        s_opus->s_mode = MODE_SILK_ONLY;
+                        s_opus->s_bandWidth = OPUS_BANDWIDTH_NARROWBAND;
+                        s_opus->s_internalSampleRate = 8000;
                         break;
-        case  4 ... 7:  s_endband  = 0; // OPUS_BANDWIDTH_SILK_MEDIUMBAND
-                        s_mode = MODE_SILK_ONLY;
-                        s_bandWidth = OPUS_BANDWIDTH_MEDIUMBAND;
-                        s_internalSampleRate = 12000;
+        case  4 ... 7:  s_opus->s_endband  = 0; // OPUS_BANDWIDTH_SILK_MEDIUMBAND
+                        s_opus->s_mode = MODE_SILK_ONLY;
+                        s_opus->s_bandWidth = OPUS_BANDWIDTH_MEDIUMBAND;
+                        s_opus->s_internalSampleRate = 12000;
                         break;
-        case  8 ... 11: s_endband  = 0; // OPUS_BANDWIDTH_SILK_WIDEBAND
-                        s_mode = MODE_SILK_ONLY;
-                        s_bandWidth = OPUS_BANDWIDTH_WIDEBAND;
-                        s_internalSampleRate = 16000;
+        case  8 ... 11: s_opus->s_endband  = 0; // OPUS_BANDWIDTH_SILK_WIDEBAND
+                        s_opus->s_mode = MODE_SILK_ONLY;
+                        s_opus->s_bandWidth = OPUS_BANDWIDTH_WIDEBAND;
+                        s_opus->s_internalSampleRate = 16000;
                         break;
-        case 12 ... 13: s_endband  = 0; // OPUS_BANDWIDTH_HYBRID_SUPERWIDEBAND
-                        s_mode = MODE_HYBRID;
-                        s_bandWidth = OPUS_BANDWIDTH_SUPERWIDEBAND;
+        case 12 ... 13: s_opus->s_endband  = 0; // OPUS_BANDWIDTH_HYBRID_SUPERWIDEBAND
+                        s_opus->s_mode = MODE_HYBRID;
+                        s_opus->s_bandWidth = OPUS_BANDWIDTH_SUPERWIDEBAND;
                         break;
-        case 14 ... 15: s_endband  = 0; // OPUS_BANDWIDTH_HYBRID_FULLBAND
-                        s_mode = MODE_HYBRID;
-                        s_bandWidth = OPUS_BANDWIDTH_FULLBAND;
+        case 14 ... 15: s_opus->s_endband  = 0; // OPUS_BANDWIDTH_HYBRID_FULLBAND
+                        s_opus->s_mode = MODE_HYBRID;
+                        s_opus->s_bandWidth = OPUS_BANDWIDTH_FULLBAND;
                         break;
-        case 16 ... 19: s_endband = 13; // OPUS_BANDWIDTH_CELT_NARROWBAND
-                        s_mode = MODE_CELT_ONLY;
-                        s_bandWidth = OPUS_BANDWIDTH_NARROWBAND;
+        case 16 ... 19: s_opus->s_endband = 13; // OPUS_BANDWIDTH_CELT_NARROWBAND
+                        s_opus->s_mode = MODE_CELT_ONLY;
+                        s_opus->s_bandWidth = OPUS_BANDWIDTH_NARROWBAND;
                         break;
-        case 20 ... 23: s_endband = 17; // OPUS_BANDWIDTH_CELT_WIDEBAND
-                        s_mode = MODE_CELT_ONLY;
-                        s_bandWidth = OPUS_BANDWIDTH_WIDEBAND;
+        case 20 ... 23: s_opus->s_endband = 17; // OPUS_BANDWIDTH_CELT_WIDEBAND
+                        s_opus->s_mode = MODE_CELT_ONLY;
+                        s_opus->s_bandWidth = OPUS_BANDWIDTH_WIDEBAND;
                         break;
-        case 24 ... 27: s_endband = 19; // OPUS_BANDWIDTH_CELT_SUPERWIDEBAND
-                        s_mode = MODE_CELT_ONLY;
-                        s_bandWidth = OPUS_BANDWIDTH_SUPERWIDEBAND;
+        case 24 ... 27: s_opus->s_endband = 19; // OPUS_BANDWIDTH_CELT_SUPERWIDEBAND
+                        s_opus->s_mode = MODE_CELT_ONLY;
+                        s_opus->s_bandWidth = OPUS_BANDWIDTH_SUPERWIDEBAND;
                         break;
-        case 28 ... 31: s_endband = 21; // OPUS_BANDWIDTH_CELT_FULLBAND
-                        s_mode = MODE_CELT_ONLY;
-                        s_bandWidth = OPUS_BANDWIDTH_FULLBAND;
+        case 28 ... 31: s_opus->s_endband = 21; // OPUS_BANDWIDTH_CELT_FULLBAND
+                        s_opus->s_mode = MODE_CELT_ONLY;
+                        s_opus->s_bandWidth = OPUS_BANDWIDTH_FULLBAND;
                         break;
-        default:        log_e("unknown bandwidth, configNr is: %d", configNr);
-                        s_endband = 21; // assume OPUS_BANDWIDTH_FULLBAND
+        default:        log_e("unknown bandwidth, configNr is: %d", s_opus->s_configNr);
+                        s_opus->s_endband = 21; // assume OPUS_BANDWIDTH_FULLBAND
                         break;
     }
 
 //    celt_decoder_ctl(CELT_SET_START_BAND_REQUEST, s_endband);
-    if (s_mode == MODE_CELT_ONLY){
-        celt_decoder_ctl(CELT_SET_END_BAND_REQUEST, s_endband);
+    if (s_opus->s_mode == MODE_CELT_ONLY){
+        celt_decoder_ctl(CELT_SET_END_BAND_REQUEST, s_opus->s_endband);
     }
-    else if(s_mode == MODE_SILK_ONLY){
+    else if(s_opus->s_mode == MODE_SILK_ONLY){
         // silk_InitDecoder();
     }
 
-    samplesPerFrame = opus_packet_get_samples_per_frame(inbuf, /*s_opusSamplerate*/ 48000);
+    s_opus->s_samplesPerFrame = opus_packet_get_samples_per_frame(inbuf, /*s_opusSamplerate*/ 48000);
 
 FramePacking:            // https://www.tech-invite.com/y65/tinv-ietf-rfc-6716-2.html   3.2. Frame Packing
 //log_i("s_opusCountCode %i, configNr %i", s_opusCountCode, configNr);
 
-    switch(s_opusCountCode){
+    switch(s_opus->s_opusCountCode){
         case 0:  // Code 0: One Frame in the Packet
-            ret = opus_FramePacking_Code0(inbuf, bytesLeft, outbuf, segmentLength, samplesPerFrame);
+            ret = opus_FramePacking_Code0(inbuf, bytesLeft, outbuf, segmentLength, s_opus->s_samplesPerFrame);
             break;
         case 1:  // Code 1: Two Frames in the Packet, Each with Equal Compressed Size
-            ret = opus_FramePacking_Code1(inbuf, bytesLeft, outbuf, segmentLength, samplesPerFrame, &s_frameCount);
+            ret = opus_FramePacking_Code1(inbuf, bytesLeft, outbuf, segmentLength, s_opus->s_samplesPerFrame, &s_opus->s_frameCount);
             break;
         case 2:  // Code 2: Two Frames in the Packet, with Different Compressed Sizes
-            ret = opus_FramePacking_Code2(inbuf, bytesLeft, outbuf, segmentLength, samplesPerFrame, &s_frameCount);
+            ret = opus_FramePacking_Code2(inbuf, bytesLeft, outbuf, segmentLength, s_opus->s_samplesPerFrame, &s_opus->s_frameCount);
             break;
         case 3: // Code 3: A Signaled Number of Frames in the Packet
-            ret = opus_FramePacking_Code3(inbuf, bytesLeft, outbuf, segmentLength, samplesPerFrame, &s_frameCount);
+            ret = opus_FramePacking_Code3(inbuf, bytesLeft, outbuf, segmentLength, s_opus->s_samplesPerFrame, &s_opus->s_frameCount);
             break;
         default:
-            log_e("unknown countCode %i", s_opusCountCode);
+            log_e("unknown countCode %i", s_opus->s_opusCountCode);
             break;
     }
     return ret;
 }
 //----------------------------------------------------------------------------------------------------------------------------------------------------
+const OPUSDecodeStats_t* OPUSGetDecodeStats() {
+    return &s_opus->s_stats;
+}
+//----------------------------------------------------------------------------------------------------------------------------------------------------
+void OPUSResetDecodeStats() {
+    s_opus->s_stats = {};
+}
+//----------------------------------------------------------------------------------------------------------------------------------------------------
 int32_t opus_decode_frame(uint8_t *inbuf, int16_t *outbuf, int32_t packetLen, uint16_t samplesPerFrame) {
 
     int32_t   ret = 0;
+    uint32_t  t0 = esp_cpu_get_cycle_count();
+    uint8_t   m = s_opus->s_mode == MODE_SILK_ONLY ? 0 : s_opus->s_mode == MODE_CELT_ONLY ? 1 : 2;
+    s_opus->s_stats.frames[m]++;
 
-    if (s_mode == MODE_CELT_ONLY){
-        celt_decoder_ctl(CELT_SET_END_BAND_REQUEST, s_endband);
+    if (s_opus->s_mode == MODE_CELT_ONLY){
+        celt_decoder_ctl(CELT_SET_END_BAND_REQUEST, s_opus->s_endband);
         ec_dec_init((uint8_t *)inbuf, packetLen);
         ret = celt_decode_with_ec((int16_t*)outbuf, samplesPerFrame);
+        s_opus->s_stats.cycles[m] += esp_cpu_get_cycle_count() - t0;
     }
 
-    if(s_mode == MODE_SILK_ONLY) {
+    if(s_opus->s_mode == MODE_SILK_ONLY) {
         int decodedSamples = 0;
         int32_t silk_frame_size;
         uint16_t payloadSize_ms = max(10, 1000 * samplesPerFrame / 48000);
-        if(s_bandWidth == OPUS_BANDWIDTH_NARROWBAND) { s_internalSampleRate = 8000; }
-        else if(s_bandWidth == OPUS_BANDWIDTH_MEDIUMBAND) { s_internalSampleRate = 12000; }
-        else if(s_bandWidth == OPUS_BANDWIDTH_WIDEBAND) { s_internalSampleRate = 16000; }
-        else { s_internalSampleRate = 16000; }
+        if(s_opus->s_bandWidth == OPUS_BANDWIDTH_NARROWBAND) { s_opus->s_internalSampleRate = 8000; }
+        else if(s_opus->s_bandWidth == OPUS_BANDWIDTH_MEDIUMBAND) { s_opus->s_internalSampleRate = 12000; }
+        else if(s_opus->s_bandWidth == OPUS_BANDWIDTH_WIDEBAND) { s_opus->s_internalSampleRate = 16000; }
+        else { s_opus->s_internalSampleRate = 16000; }
         ec_dec_init((uint8_t *)inbuf, packetLen);
         uint8_t APIchannels = 2;
-        silk_setRawParams(s_opusChannels, APIchannels, payloadSize_ms, s_internalSampleRate, 48000);
+        silk_setRawParams(s_opus->s_opusChannels, APIchannels, payloadSize_ms, s_opus->s_internalSampleRate, 48000);
         do{
             /* Call SILK decoder */
             int lost_flag = 0;
@@ -365,9 +426,10 @@ int32_t opus_decode_frame(uint8_t *inbuf, int16_t *outbuf, int32_t packetLen, ui
             decodedSamples += silk_frame_size;
         } while(decodedSamples < samplesPerFrame);
         ret = decodedSamples;
+        s_opus->s_stats.cycles[m] += esp_cpu_get_cycle_count() - t0;
     }
 
-    if(s_mode == MODE_HYBRID){
+    if(s_opus->s_mode == MODE_HYBRID){
         log_w("Hybrid mode not yet supported");
         return samplesPerFrame;
         int decodedSamples = 0;
@@ -380,21 +442,21 @@ int32_t opus_decode_frame(uint8_t *inbuf, int16_t *outbuf, int32_t packetLen, ui
         F2_5 = F5 >> 1;
         if(packetLen < F2_5) { return ERR_OPUS_BUFFER_TOO_SMALL; }
         ec_dec_init((uint8_t *)inbuf, packetLen);
-        s_internalSampleRate = 16000;
+        s_opus->s_internalSampleRate = 16000;
         uint8_t APIchannels = 2;
         uint16_t payloadSize_ms = max(10, 1000 * samplesPerFrame / 48000);
         int lost_flag = 0;
         int first_frame = decodedSamples == 0;
-        silk_setRawParams(s_opusChannels, APIchannels, payloadSize_ms, s_internalSampleRate, 48000);
+        silk_setRawParams(s_opus->s_opusChannels, APIchannels, payloadSize_ms, s_opus->s_internalSampleRate, 48000);
         silk_Decode(lost_flag, first_frame, (int16_t*)outbuf + decodedSamples, &silk_frame_size);
-        if(s_bandWidth) {
-            s_endband = 21;
-            switch(s_bandWidth) {
-                case OPUS_BANDWIDTH_NARROWBAND: s_endband = 13; break;
+        if(s_opus->s_bandWidth) {
+            s_opus->s_endband = 21;
+            switch(s_opus->s_bandWidth) {
+                case OPUS_BANDWIDTH_NARROWBAND: s_opus->s_endband = 13; break;
                 case OPUS_BANDWIDTH_MEDIUMBAND:
-                case OPUS_BANDWIDTH_WIDEBAND: s_endband = 17; break;
-                case OPUS_BANDWIDTH_SUPERWIDEBAND: s_endband = 19; break;
-                case OPUS_BANDWIDTH_FULLBAND: s_endband = 21; break;
+                case OPUS_BANDWIDTH_WIDEBAND: s_opus->s_endband = 17; break;
+                case OPUS_BANDWIDTH_SUPERWIDEBAND: s_opus->s_endband = 19; break;
+                case OPUS_BANDWIDTH_FULLBAND: s_opus->s_endband = 21; break;
                 default: break;
             }
         }
@@ -402,6 +464,7 @@ int32_t opus_decode_frame(uint8_t *inbuf, int16_t *outbuf, int32_t packetLen, ui
         celt_decoder_ctl(CELT_SET_START_BAND_REQUEST, start_band);
     //    celt_decoder_ctl(CELT_SET_END_BAND_REQUEST, s_endband);
         ret = celt_decode_with_ec((int16_t*)outbuf, samplesPerFrame);
+        s_opus->s_stats.cycles[m] += esp_cpu_get_cycle_count() - t0;
     }
     return ret;
 }
@@ -425,7 +488,7 @@ int8_t opus_FramePacking_Code0(uint8_t *inbuf, int32_t *bytesLeft, int16_t *outb
 */
     int32_t ret = 0;
     *bytesLeft -= packetLen;
-    s_opusCurrentFilePos += packetLen;
+    s_opus->s_opusCurrentFilePos += packetLen;
     packetLen--;
     inbuf++;
     ret = opus_decode_frame(inbuf, outbuf, packetLen, samplesPerFrame);
@@ -433,7 +496,7 @@ int8_t opus_FramePacking_Code0(uint8_t *inbuf, int32_t *bytesLeft, int16_t *outb
     if(ret < 0){
         return ret; // decode err
     }
-    s_opusValidSamples = ret;
+    s_opus->s_opusValidSamples = ret;
     return ERR_OPUS_NONE;
 }
 
@@ -460,26 +523,25 @@ int8_t opus_FramePacking_Code1(uint8_t *inbuf, int32_t *bytesLeft, int16_t *outb
      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
 */
     int32_t ret = 0;
-    static uint16_t c1fs = 0;
     if(*frameCount == 0){
         packetLen--;
         inbuf++;
         *bytesLeft -= 1;
-        s_opusCurrentFilePos += 1;
-        c1fs = packetLen / 2;
+        s_opus->s_opusCurrentFilePos += 1;
+        s_opus->s_code1FrameSize = packetLen / 2;
         // log_w("OPUS countCode 1 len %i, c1fs %i", len, c1fs);
         *frameCount = 2;
     }
     if(*frameCount > 0){
-        ret = opus_decode_frame(inbuf, outbuf, c1fs, samplesPerFrame);
+        ret = opus_decode_frame(inbuf, outbuf, s_opus->s_code1FrameSize, samplesPerFrame);
         // log_w("code 1, ret %i", ret);
         if(ret < 0){
             *frameCount = 0;
             return ret;  // decode err
         }
-        s_opusValidSamples = ret;
-        *bytesLeft -= c1fs;
-        s_opusCurrentFilePos += c1fs;
+        s_opus->s_opusValidSamples = ret;
+        *bytesLeft -= s_opus->s_code1FrameSize;
+        s_opus->s_opusCurrentFilePos += s_opus->s_code1FrameSize;
     }
     *frameCount -= 1;
     return ERR_OPUS_NONE;
@@ -515,50 +577,48 @@ int8_t opus_FramePacking_Code2(uint8_t *inbuf, int32_t *bytesLeft, int16_t *outb
      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
 */
     int32_t ret = 0;
-    static uint16_t firstFrameLength = 0;
-    static uint16_t secondFrameLength = 0;
 
     if(*frameCount == 0){
         uint8_t b1 = inbuf[1];
         uint8_t b2 = inbuf[2];
         if(b1 < 252){
-            firstFrameLength = b1;
+            s_opus->s_code2FirstFrameLength = b1;
             packetLen -= 2;
             *bytesLeft -= 2;
-            s_opusCurrentFilePos += 2;
+            s_opus->s_opusCurrentFilePos += 2;
             inbuf += 2;
         }
         else{
-            firstFrameLength = b1 + (b2 * 4);
+            s_opus->s_code2FirstFrameLength = b1 + (b2 * 4);
             packetLen -= 3;
             *bytesLeft -= 3;
-            s_opusCurrentFilePos += 3;
+            s_opus->s_opusCurrentFilePos += 3;
             inbuf += 3;
         }
-        secondFrameLength = packetLen - firstFrameLength;
+        s_opus->s_code2SecondFrameLength = packetLen - s_opus->s_code2FirstFrameLength;
         *frameCount = 2;
     }
     if(*frameCount == 2){
-        ret = opus_decode_frame(inbuf, outbuf, firstFrameLength, samplesPerFrame);
+        ret = opus_decode_frame(inbuf, outbuf, s_opus->s_code2FirstFrameLength, samplesPerFrame);
         // log_w("code 2, ret %i", ret);
         if(ret < 0){
             *frameCount = 0;
             return ret;  // decode err
         }
-        s_opusValidSamples = ret;
-        *bytesLeft -= firstFrameLength;
-        s_opusCurrentFilePos += firstFrameLength;
+        s_opus->s_opusValidSamples = ret;
+        *bytesLeft -= s_opus->s_code2FirstFrameLength;
+        s_opus->s_opusCurrentFilePos += s_opus->s_code2FirstFrameLength;
     }
     if(*frameCount == 1){
-        ret = opus_decode_frame(inbuf, outbuf, secondFrameLength, samplesPerFrame);
+        ret = opus_decode_frame(inbuf, outbuf, s_opus->s_code2SecondFrameLength, samplesPerFrame);
         // log_w("code 2, ret %i", ret);
         if(ret < 0){
             *frameCount = 0;
             return ret;  // decode err
         }
-        s_opusValidSamples = ret;
-        *bytesLeft -= secondFrameLength;
-        s_opusCurrentFilePos += secondFrameLength;
+        s_opus->s_opusValidSamples = ret;
+        *bytesLeft -= s_opus->s_code2SecondFrameLength;
+        s_opus->s_opusCurrentFilePos += s_opus->s_code2SecondFrameLength;
     }
     *frameCount -= 1;
     return ERR_OPUS_NONE;
@@ -664,37 +724,30 @@ int8_t opus_FramePacking_Code3(uint8_t *inbuf, int32_t *bytesLeft, int16_t *outb
      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
 
 */
-    static bool    firstCall = true;
-    static bool    v = false; // VBR indicator
-    static bool    p = false; // padding exists
-    static int16_t fs = 0;    // frame size
-    static uint8_t M = 0;     // nr of frames
-    static int32_t spf = 0;   // static samples per frame
-    static int32_t paddingLength = 0;
     uint32_t       idx = 0;   // includes TOC byte
     int32_t        ret = 0;
     int32_t        remainingBytes = 0;
     uint16_t       vfs[48] = {0}; // variable frame size
 
-    if (firstCall) {
-        firstCall = false;
-        s_opusCurrentFilePos += packetLen;
-        paddingLength = 0;
+    if (s_opus->s_code3FirstCall) {
+        s_opus->s_code3FirstCall = false;
+        s_opus->s_opusCurrentFilePos += packetLen;
+        s_opus->s_code3PaddingLength = 0;
         idx = 1; // skip TOC byte
-        spf = samplesPerFrame;
-        if (inbuf[idx] & 0b10000000) v = true; // VBR indicator
-        if (inbuf[idx] & 0b01000000) p = true; // padding bit
-        M = inbuf[idx] & 0b00111111;           // framecount
-        *frameCount = M;
+        s_opus->s_code3SamplesPerFrame = samplesPerFrame;
+        if (inbuf[idx] & 0b10000000) s_opus->s_code3Vbr = true; // VBR indicator
+        if (inbuf[idx] & 0b01000000) s_opus->s_code3Padding = true; // padding bit
+        s_opus->s_code3FrameCount = inbuf[idx] & 0b00111111;           // framecount
+        *frameCount = s_opus->s_code3FrameCount;
         idx++;
-        if (p) {
-            while (inbuf[idx] == 255) { paddingLength += 255, idx++; }
-            paddingLength += inbuf[idx];
+        if (s_opus->s_code3Padding) {
+            while (inbuf[idx] == 255) { s_opus->s_code3PaddingLength += 255, idx++; }
+            s_opus->s_code3PaddingLength += inbuf[idx];
             idx++;
         }
-        if (v && M) { // variable frame size
+        if (s_opus->s_code3Vbr && s_opus->s_code3FrameCount) { // variable frame size
             uint8_t m = 0;
-            while(m <  M) {
+            while(m <  s_opus->s_code3FrameCount) {
                 vfs[m] = inbuf[idx];
                 if(vfs[m] == 255) {vfs[m] = 255; idx++;}
                 idx++;
@@ -702,38 +755,38 @@ int8_t opus_FramePacking_Code3(uint8_t *inbuf, int32_t *bytesLeft, int16_t *outb
                 // log_e("vfs[m] %i", vfs[m]);
             }
         }
-        remainingBytes = packetLen - paddingLength - idx;
+        remainingBytes = packetLen - s_opus->s_code3PaddingLength - idx;
         if (remainingBytes < 0) {
             // log_e("fs %i", fs);
             *bytesLeft -= packetLen;
             *frameCount = 0;
-            firstCall = true;
+            s_opus->s_code3FirstCall = true;
             return ERR_OPUS_NONE;
         }
-        if(!v){
-            fs = remainingBytes / M;
+        if(!s_opus->s_code3Vbr){
+            s_opus->s_code3FrameSize = remainingBytes / s_opus->s_code3FrameCount;
         }
-        if (fs > remainingBytes) {
+        if (s_opus->s_code3FrameSize > remainingBytes) {
             *bytesLeft -= packetLen;
             *frameCount = 0;
-            firstCall = true;
+            s_opus->s_code3FirstCall = true;
             return ERR_OPUS_NONE;
         }
         //  log_w("remainingBytes %i, packetLen %i, paddingLength %i, idx %i, fs %i, frameCount %i", remainingBytes, packetLen, paddingLength, idx, fs, *frameCount);
         *bytesLeft -= idx;
     }
     if(*frameCount > 0){
-        if(v){ret = opus_decode_frame(inbuf + idx, outbuf, vfs[M - (*frameCount)], spf); *bytesLeft -= vfs[M - (*frameCount)]; /* log_e("code 3, vfs[M - (*frameCount)], spf) %i",  vfs[M - (*frameCount)], spf); */ }
-        else{ ret = opus_decode_frame(inbuf + idx, outbuf, fs, spf); *bytesLeft -= fs; /* log_e("code 3, fs, spf) %i", fs, spf); */ }
+        if(s_opus->s_code3Vbr){ret = opus_decode_frame(inbuf + idx, outbuf, vfs[s_opus->s_code3FrameCount - (*frameCount)], s_opus->s_code3SamplesPerFrame); *bytesLeft -= vfs[s_opus->s_code3FrameCount - (*frameCount)]; /* log_e("code 3, vfs[M - (*frameCount)], spf) %i",  vfs[M - (*frameCount)], spf); */ }
+        else{ ret = opus_decode_frame(inbuf + idx, outbuf, s_opus->s_code3FrameSize, s_opus->s_code3SamplesPerFrame); *bytesLeft -= s_opus->s_code3FrameSize; /* log_e("code 3, fs, spf) %i", fs, spf); */ }
         // log_w("code 3, ret %i", ret);
         *frameCount -= 1;
-        s_opusValidSamples = ret;
+        s_opus->s_opusValidSamples = ret;
         if(*frameCount > 0) return OPUS_CONTINUE;
     }
-    *bytesLeft -= paddingLength;
+    *bytesLeft -= s_opus->s_code3PaddingLength;
     *frameCount = 0;
-    s_opusValidSamples = samplesPerFrame;
-    firstCall = true;
+    s_opus->s_opusValidSamples = samplesPerFrame;
+    s_opus->s_code3FirstCall = true;
     return ERR_OPUS_NONE;
 }
 
@@ -760,7 +813,7 @@ int32_t opus_packet_get_samples_per_frame(const uint8_t *data, int32_t Fs) {
 //----------------------------------------------------------------------------------------------------------------------
 
 uint8_t OPUSGetChannels(){
-    return s_opusChannels;
+    return s_opus->s_opusChannels;
 }
 uint32_t OPUSGetSampRate(){
     return 48000;
@@ -769,34 +822,34 @@ uint8_t OPUSGetBitsPerSample(){
     return 16;
 }
 uint32_t OPUSGetBitRate(){
-    if(s_opusCompressionRatio != 0){
-        return (16 * 2 * 48000) / s_opusCompressionRatio;  //bitsPerSample * channel* SampleRate/CompressionRatio
+    if(s_opus->s_opusCompressionRatio != 0){
+        return (16 * 2 * 48000) / s_opus->s_opusCompressionRatio;  //bitsPerSample * channel* SampleRate/CompressionRatio
     }
     else return 0;
 }
 uint16_t OPUSGetOutputSamps(){
-    return s_opusValidSamples; // 1024
+    return s_opus->s_opusValidSamples; // 1024
 }
 uint32_t OPUSGetAudioDataStart(){
-    return s_opusAudioDataStart;
+    return s_opus->s_opusAudioDataStart;
 }
 char* OPUSgetStreamTitle(){
-    if(s_f_newSteamTitle){
-        s_f_newSteamTitle = false;
-        return s_opusChbuf;
+    if(s_opus->s_f_newSteamTitle){
+        s_opus->s_f_newSteamTitle = false;
+        return s_opus->s_opusChbuf;
     }
     return NULL;
 }
 vector<uint32_t> OPUSgetMetadataBlockPicture(){
-    if(s_f_opusNewMetadataBlockPicture){
-        s_f_opusNewMetadataBlockPicture = false;
-        return s_opusBlockPicItem;
+    if(s_opus->s_f_opusNewMetadataBlockPicture){
+        s_opus->s_f_opusNewMetadataBlockPicture = false;
+        return s_opus->s_opusBlockPicItem;
     }
-    if(s_opusBlockPicItem.size() > 0){
-        s_opusBlockPicItem.clear();
-        s_opusBlockPicItem.shrink_to_fit();
+    if(s_opus->s_opusBlockPicItem.size() > 0){
+        s_opus->s_opusBlockPicItem.clear();
+        s_opus->s_opusBlockPicItem.shrink_to_fit();
     }
-    return s_opusBlockPicItem;
+    return s_opus->s_opusBlockPicItem;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -832,8 +885,8 @@ int8_t parseOpusTOC(uint8_t TOC_Byte){  // https://www.rfc-editor.org/rfc/rfc671
         c = 2: 2 frames in the packet, with different compressed sizes
         c = 3: an arbitrary number of frames in the packet
     */
-    s_opusCountCode = c;
-    s_f_opusStereoFlag = s;
+    s_opus->s_opusCountCode = c;
+    s_opus->s_f_opusStereoFlag = s;
 
     // if(configNr < 12) return ERR_OPUS_SILK_MODE_UNSUPPORTED;
     // if(configNr < 16) return ERR_OPUS_HYBRID_MODE_UNSUPPORTED;
@@ -884,36 +937,36 @@ int32_t parseOpusComment(uint8_t *inbuf, int32_t nBytes){      // reference http
         idx = OPUS_specialIndexOf(inbuf + pos, "metadata_block_picture=", 25);
         if(idx == -1) idx = OPUS_specialIndexOf(inbuf + pos, "METADATA_BLOCK_PICTURE=", 25);
         if(idx == 0){
-            s_opusBlockPicLen = commentStringLen - 23;
-            s_opusCurrentFilePos += pos + 23;
-            s_opusBlockPicPos += s_opusCurrentFilePos;
-            s_blockPicLenUntilFrameEnd = nBytes - 23;
+            s_opus->s_opusBlockPicLen = commentStringLen - 23;
+            s_opus->s_opusCurrentFilePos += pos + 23;
+            s_opus->s_opusBlockPicPos += s_opus->s_opusCurrentFilePos;
+            s_opus->s_blockPicLenUntilFrameEnd = nBytes - 23;
         //  log_i("metadata block picture found at pos %i, length %i", s_opusBlockPicPos, s_opusBlockPicLen);
-            uint32_t pLen = _min(s_blockPicLenUntilFrameEnd, s_opusBlockPicLen);
+            uint32_t pLen = _min(s_opus->s_blockPicLenUntilFrameEnd, s_opus->s_opusBlockPicLen);
             if(pLen){
-                s_opusBlockPicItem.push_back(s_opusBlockPicPos);
-                s_opusBlockPicItem.push_back(pLen);
+                s_opus->s_opusBlockPicItem.push_back(s_opus->s_opusBlockPicPos);
+                s_opus->s_opusBlockPicItem.push_back(pLen);
             }
         }
         pos += commentStringLen;
         nBytes -= commentStringLen;
     }
     if(artist && title){
-        strcpy(s_opusChbuf, artist);
-        strcat(s_opusChbuf, " - ");
-        strcat(s_opusChbuf, title);
-        s_f_newSteamTitle = true;
+        strcpy(s_opus->s_opusChbuf, artist);
+        strcat(s_opus->s_opusChbuf, " - ");
+        strcat(s_opus->s_opusChbuf, title);
+        s_opus->s_f_newSteamTitle = true;
     }
     else if(artist){
-        strcpy(s_opusChbuf, artist);
-        s_f_newSteamTitle = true;
+        strcpy(s_opus->s_opusChbuf, artist);
+        s_opus->s_f_newSteamTitle = true;
     }
     else if(title){
-        strcpy(s_opusChbuf, title);
-        s_f_newSteamTitle = true;
+        strcpy(s_opus->s_opusChbuf, title);
+        s_opus->s_f_newSteamTitle = true;
     }
-    if(artist){free(artist); artist = NULL;}
-    if(title) {free(title);  title = NULL;}
+    if(artist){AudioMemory::release(artist); artist = NULL;}
+    if(title) {AudioMemory::release(title);  title = NULL;}
 
     return 1;
 }
@@ -938,18 +991,18 @@ int32_t parseOpusHead(uint8_t *inbuf, int32_t nBytes){  // reference https://wik
     uint8_t  channelMap         = *(inbuf + 18);
 
     if(channelCount == 0 || channelCount >2) return ERR_OPUS_CHANNELS_OUT_OF_RANGE;
-    s_opusChannels = channelCount;
+    s_opus->s_opusChannels = channelCount;
 //    log_e("sampleRate %i", sampleRate);
 //    if(sampleRate != 48000 && sampleRate != 44100) return ERR_OPUS_INVALID_SAMPLERATE;
-    s_opusSamplerate = sampleRate;
+    s_opus->s_opusSamplerate = sampleRate;
     if(channelMap > 1) return ERR_OPUS_EXTRA_CHANNELS_UNSUPPORTED;
 
     (void)outputGain;
 
     CELTDecoder_ClearBuffer();
-    s_opusError = celt_decoder_init(s_opusChannels); if(s_opusError < 0) {log_e("CELT not init"); return false;}
-    s_opusError = celt_decoder_ctl(CELT_SET_SIGNALLING_REQUEST,  0); if(s_opusError < 0) {log_e("CELT not init"); return false;}
-    s_opusError = celt_decoder_ctl(CELT_SET_END_BAND_REQUEST,   21); if(s_opusError < 0) {log_e("CELT not init"); return false;}
+    s_opus->s_opusError = celt_decoder_init(s_opus->s_opusChannels); if(s_opus->s_opusError < 0) {log_e("CELT not init"); return false;}
+    s_opus->s_opusError = celt_decoder_ctl(CELT_SET_SIGNALLING_REQUEST,  0); if(s_opus->s_opusError < 0) {log_e("CELT not init"); return false;}
+    s_opus->s_opusError = celt_decoder_ctl(CELT_SET_END_BAND_REQUEST,   21); if(s_opus->s_opusError < 0) {log_e("CELT not init"); return false;}
 
     return 1;
 }
@@ -988,7 +1041,7 @@ int32_t OPUSparseOGG(uint8_t *inbuf, int32_t *bytesLeft){  // reference https://
 
     // read the segment table (contains pageSegments bytes),  1...251: Length of the frame in bytes,
     // 255: A second byte is needed.  The total length is first_byte + second byte
-    s_opusSegmentLength = 0;
+    s_opus->s_opusSegmentLength = 0;
     segmentTableWrPtr = -1;
 
     for(int32_t i = 0; i < pageSegments; i++){
@@ -999,28 +1052,28 @@ int32_t OPUSparseOGG(uint8_t *inbuf, int32_t *bytesLeft){  // reference https://
             n+= *(inbuf + 27 + i);
         }
         segmentTableWrPtr++;
-        s_opusSegmentTable[segmentTableWrPtr] = n;
-        s_opusSegmentLength += n;
+        s_opus->s_opusSegmentTable[segmentTableWrPtr] = n;
+        s_opus->s_opusSegmentLength += n;
     }
-    s_opusSegmentTableSize = segmentTableWrPtr + 1;
-    s_opusCompressionRatio = (float)(960 * 2 * pageSegments)/s_opusSegmentLength;  // const 960 validBytes out
+    s_opus->s_opusSegmentTableSize = segmentTableWrPtr + 1;
+    s_opus->s_opusCompressionRatio = (float)(960 * 2 * pageSegments)/s_opus->s_opusSegmentLength;  // const 960 validBytes out
 
-    s_f_continuedPage = headerType & 0x01; // set: page contains data of a packet continued from the previous page
-    s_f_firstPage     = headerType & 0x02; // set: this is the first page of a logical bitstream (bos)
-    s_f_lastPage      = headerType & 0x04; // set: this is the last page of a logical bitstream (eos)
+    s_opus->s_f_continuedPage = headerType & 0x01; // set: page contains data of a packet continued from the previous page
+    s_opus->s_f_firstPage     = headerType & 0x02; // set: this is the first page of a logical bitstream (bos)
+    s_opus->s_f_lastPage      = headerType & 0x04; // set: this is the last page of a logical bitstream (eos)
 
 //  log_i("firstPage %i, continuedPage %i, lastPage %i",s_f_firstPage, s_f_continuedPage, s_f_lastPage);
 
     uint16_t headerSize   = pageSegments + 27;
     *bytesLeft           -= headerSize;
-    s_opusCurrentFilePos += headerSize;
-    s_opusOggHeaderSize   = headerSize;
+    s_opus->s_opusCurrentFilePos += headerSize;
+    s_opus->s_opusOggHeaderSize   = headerSize;
 
-    int32_t pLen = _min((int32_t)s_opusSegmentLength, s_opusRemainBlockPicLen);
+    int32_t pLen = _min((int32_t)s_opus->s_opusSegmentLength, s_opus->s_opusRemainBlockPicLen);
 //  log_i("s_opusSegmentLength %i, s_opusRemainBlockPicLen %i", s_opusSegmentLength, s_opusRemainBlockPicLen);
-    if(s_opusBlockPicLen && pLen > 0){
-        s_opusBlockPicItem.push_back(s_opusCurrentFilePos);
-        s_opusBlockPicItem.push_back(pLen);
+    if(s_opus->s_opusBlockPicLen && pLen > 0){
+        s_opus->s_opusBlockPicItem.push_back(s_opus->s_opusCurrentFilePos);
+        s_opus->s_opusBlockPicItem.push_back(pLen);
     }
     return ERR_OPUS_NONE;
 }
@@ -1031,11 +1084,11 @@ int32_t OPUSFindSyncWord(unsigned char *buf, int32_t nBytes){
     int32_t idx = OPUS_specialIndexOf(buf, "OggS", nBytes);
     if(idx >= 0){ // Magic Word found
     //    log_i("OggS found at %i", idx);
-        s_f_opusParseOgg = true;
+        s_opus->s_f_opusParseOgg = true;
         return idx;
     }
     log_i("find sync");
-    s_f_opusParseOgg = false;
+    s_opus->s_f_opusParseOgg = false;
     return ERR_OPUS_OGG_SYNC_NOT_FOUND;
 }
 //----------------------------------------------------------------------------------------------------------------------
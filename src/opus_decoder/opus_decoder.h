@@ -34,11 +34,26 @@ enum : int8_t  {OPUS_CONTINUE = 110,
                 ERR_OPUS_CELT_START_BAND = -27,
                 ERR_CELT_OPUS_INTERNAL_ERROR = -28};
 
+typedef struct _OPUSDecodeStats {  // accumulated per mode: [0] SILK, [1] CELT, [2] hybrid
+    uint32_t frames[3];
+    uint64_t cycles[3];             // CPU cycles in opus_decode_frame(), hybrid frames are skipped undecoded: always 0
+} OPUSDecodeStats_t;
+
+// All functions below work on the decoder context bound to the calling task. Tasks that never bind one share a
+// default context, so a single stream needs no setup. Create a context per stream to decode several at once.
+struct OPUSDecoder_t;
+OPUSDecoder_t*   OPUSDecoder_CreateContext();                  // NULL if out of memory
+void             OPUSDecoder_DestroyContext(OPUSDecoder_t* ctx); // frees the buffers, too
+void             OPUSDecoder_SetContext(OPUSDecoder_t* ctx);     // bind ctx to the calling task, NULL: default context
+OPUSDecoder_t*   OPUSDecoder_GetContext();
+
 bool             OPUSDecoder_AllocateBuffers();
 void             OPUSDecoder_FreeBuffers();
 void             OPUSDecoder_ClearBuffers();
 void             OPUSsetDefaults();
 int32_t          OPUSDecode(uint8_t* inbuf, int32_t* bytesLeft, int16_t* outbuf);
+const OPUSDecodeStats_t* OPUSGetDecodeStats();
+void             OPUSResetDecodeStats();
 int32_t          opusDecodePage0(uint8_t* inbuf, int32_t* bytesLeft, uint32_t segmentLength);
 int32_t          opusDecodePage3(uint8_t* inbuf, int32_t* bytesLeft, uint32_t segmentLength, int16_t *outbuf);
 int8_t           opus_FramePacking_Code0(uint8_t *inbuf, int32_t *bytesLeft, int16_t *outbuf, int32_t packetLen, uint16_t samplesPerFrame);
@@ -13,28 +13,18 @@ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 ********************************************************************************************************************************************************************************************************/
 
 #include "silk.h"
+#include "../AudioMemory.h"
 #include <stdint.h>
 
 #define __malloc_heap_psram(size) \
-    heap_caps_malloc_prefer(size, 2, MALLOC_CAP_DEFAULT | MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL)
+    AudioMemory::alloc(size, AUDIO_MEM_PSRAM_PREFERRED)
 #define __calloc_heap_psram(ch, size) \
-    heap_caps_calloc_prefer(ch, size, 2, MALLOC_CAP_DEFAULT | MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL)
+    AudioMemory::calloc(ch, size, AUDIO_MEM_PSRAM_PREFERRED)
 
 
-silk_decoder_state s_channel_state[2];
-silk_decoder       s_decState;
-extern ec_ctx_t    s_ec;
-
-uint8_t  s_channelsInternal = 0;
-uint8_t  s_payloadSize_ms = 0;
-uint8_t  s_API_channels = 0;
-uint32_t s_silk_internalSampleRate = 0;
-uint32_t s_API_sampleRate = 0;
-uint32_t s_prevPitchLag = 0;
-
 /* Coefficients for 2-band filter bank based on first-order allpass filters */
-int16_t A_fb1_20 = 5394 << 1;
-int16_t A_fb1_21 = -24290; /* (int16_t)(20623 << 1) */
+const int16_t A_fb1_20 = 5394 << 1;
+const int16_t A_fb1_21 = -24290; /* (int16_t)(20623 << 1) */
 
 const int16_t HARM_ATT_Q15[NB_ATT] = {32440, 31130};              /* 0.99, 0.95 */
 const int16_t PLC_RAND_ATTENUATE_V_Q15[NB_ATT] = {31130, 26214};  /* 0.95, 0.8 */
@@ -884,10 +874,10 @@ void silk_NLSF2A(int16_t* a_Q12, const int16_t* NLSF, const int32_t d) {
         silk_bwexpander_32(a32_QA1, d, 65536 - silk_LSHIFT(2, i));
         for (k = 0; k < d; k++) { a_Q12[k] = (int16_t)silk_RSHIFT_ROUND(a32_QA1[k], QA16 + 1 - 12); /* QA16+1 -> Q12 */ }
     }
-    free(cos_LSF_QA);
-    free(P);
-    free(Q);
-    free(a32_QA1);
+    AudioMemory::release(cos_LSF_QA);
+    AudioMemory::release(P);
+    AudioMemory::release(Q);
+    AudioMemory::release(a32_QA1);
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 /* Decode side-information parameters from payload (State, Compressor data structure, Frame number, Flag indicating LBRR data is being decoded, The type of conditional coding to use) */
@@ -1601,7 +1591,7 @@ void silk_CNG(silk_decoder_state*   psDec,     /* I/O  Decoder state
             frame[i] = (int16_t)silk_ADD_SAT16(frame[i], silk_SAT16(silk_RSHIFT_ROUND(silk_SMULWW(CNG_sig_Q14[MAX_LPC_ORDER + i], gain_Q10), 8)));
         }
         memcpy(psCNG->CNG_synth_state, &CNG_sig_Q14[length], MAX_LPC_ORDER * sizeof(int32_t));
-        free(CNG_sig_Q14);
+        AudioMemory::release(CNG_sig_Q14);
     } else {
         memset(psCNG->CNG_synth_state, 0, psDec->LPC_order * sizeof(int32_t));
     }
@@ -1642,15 +1632,15 @@ void silk_decode_signs(int16_t       pulses[],                       /* I/O  pul
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void silk_setRawParams(uint8_t channels, uint8_t API_channels, uint8_t payloadSize_ms, uint32_t internalSampleRate, uint32_t API_samleRate) {
-    s_channelsInternal = channels;
-    s_API_channels = API_channels;
-    s_payloadSize_ms = payloadSize_ms;
-    s_silk_internalSampleRate = internalSampleRate;
-    s_API_sampleRate = API_samleRate;
+    s_silk->s_channelsInternal = channels;
+    s_silk->s_API_channels = API_channels;
+    s_silk->s_payloadSize_ms = payloadSize_ms;
+    s_silk->s_silk_internalSampleRate = internalSampleRate;
+    s_silk->s_API_sampleRate = API_samleRate;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 uint32_t silk_getPrevPitchLag() {
-    return s_prevPitchLag;
+    return s_silk->s_prevPitchLag;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 /* Decode a frame */
@@ -1668,107 +1658,107 @@ int32_t silk_Decode(int32_t  lostFlag,      /* I    0: no loss, 1 loss, 2 decode
     int16_t* samplesOut2_tmp = NULL;
     int32_t       MS_pred_Q13[2] = {0};
     int16_t*      resample_out_ptr;
-    silk_decoder* psDec = (silk_decoder*)&s_decState;
+    silk_decoder* psDec = (silk_decoder*)&s_silk->s_decState;
     int32_t       has_side;
     int32_t       stereo_to_mono;
     int           delay_stack_alloc;
 
-    assert(s_channelsInternal == 1 || s_channelsInternal == 2);
+    assert(s_silk->s_channelsInternal == 1 || s_silk->s_channelsInternal == 2);
 
     /**********************************/
     /* Test if first frame in payload */
     /**********************************/
     if (newPacketFlag) {
-        for (n = 0; n < s_channelsInternal; n++) { s_channel_state[n].nFramesDecoded = 0; /* Used to count frames in packet */ }
+        for (n = 0; n < s_silk->s_channelsInternal; n++) { s_silk->s_channel_state[n].nFramesDecoded = 0; /* Used to count frames in packet */ }
     }
 
     /* If Mono -> Stereo transition in bitstream: init state of second channel */
-    if (s_channelsInternal > psDec->nChannelsInternal) { ret += silk_init_decoder(&s_channel_state[1]); }
+    if (s_silk->s_channelsInternal > psDec->nChannelsInternal) { ret += silk_init_decoder(&s_silk->s_channel_state[1]); }
 
-    stereo_to_mono = s_channelsInternal == 1 && psDec->nChannelsInternal == 2 && (s_silk_internalSampleRate == 1000 * s_channel_state[0].fs_kHz);
+    stereo_to_mono = s_silk->s_channelsInternal == 1 && psDec->nChannelsInternal == 2 && (s_silk->s_silk_internalSampleRate == 1000 * s_silk->s_channel_state[0].fs_kHz);
 
-    if (s_channel_state[0].nFramesDecoded == 0) {
-        for (n = 0; n < s_channelsInternal; n++) {
+    if (s_silk->s_channel_state[0].nFramesDecoded == 0) {
+        for (n = 0; n < s_silk->s_channelsInternal; n++) {
             int32_t fs_kHz_dec;
-            if (s_payloadSize_ms == 0) {
+            if (s_silk->s_payloadSize_ms == 0) {
                 /* Assuming packet loss, use 10 ms */
-                s_channel_state[n].nFramesPerPacket = 1;
-                s_channel_state[n].nb_subfr = 2;
-            } else if (s_payloadSize_ms == 10) {
-                s_channel_state[n].nFramesPerPacket = 1;
-                s_channel_state[n].nb_subfr = 2;
-            } else if (s_payloadSize_ms == 20) {
-                s_channel_state[n].nFramesPerPacket = 1;
-                s_channel_state[n].nb_subfr = 4;
-            } else if (s_payloadSize_ms == 40) {
-                s_channel_state[n].nFramesPerPacket = 2;
-                s_channel_state[n].nb_subfr = 4;
-            } else if (s_payloadSize_ms == 60) {
-                s_channel_state[n].nFramesPerPacket = 3;
-                s_channel_state[n].nb_subfr = 4;
+                s_silk->s_channel_state[n].nFramesPerPacket = 1;
+                s_silk->s_channel_state[n].nb_subfr = 2;
+            } else if (s_silk->s_payloadSize_ms == 10) {
+                s_silk->s_channel_state[n].nFramesPerPacket = 1;
+                s_silk->s_channel_state[n].nb_subfr = 2;
+            } else if (s_silk->s_payloadSize_ms == 20) {
+                s_silk->s_channel_state[n].nFramesPerPacket = 1;
+                s_silk->s_channel_state[n].nb_subfr = 4;
+            } else if (s_silk->s_payloadSize_ms == 40) {
+                s_silk->s_channel_state[n].nFramesPerPacket = 2;
+                s_silk->s_channel_state[n].nb_subfr = 4;
+            } else if (s_silk->s_payloadSize_ms == 60) {
+                s_silk->s_channel_state[n].nFramesPerPacket = 3;
+                s_silk->s_channel_state[n].nb_subfr = 4;
             } else {
                 return SILK_DEC_INVALID_FRAME_SIZE;
             }
-            fs_kHz_dec = (s_silk_internalSampleRate >> 10) + 1;
+            fs_kHz_dec = (s_silk->s_silk_internalSampleRate >> 10) + 1;
             if (fs_kHz_dec != 8 && fs_kHz_dec != 12 && fs_kHz_dec != 16) { return SILK_DEC_INVALID_SAMPLING_FREQUENCY; }
-            ret += silk_decoder_set_fs(&s_channel_state[n], fs_kHz_dec, s_API_sampleRate);
+            ret += silk_decoder_set_fs(&s_silk->s_channel_state[n], fs_kHz_dec, s_silk->s_API_sampleRate);
         }
     }
 
-    if (s_API_channels == 2 && s_channelsInternal == 2 && (psDec->nChannelsAPI == 1 || psDec->nChannelsInternal == 1)) {
+    if (s_silk->s_API_channels == 2 && s_silk->s_channelsInternal == 2 && (psDec->nChannelsAPI == 1 || psDec->nChannelsInternal == 1)) {
         memset(psDec->sStereo.pred_prev_Q13, 0, sizeof(psDec->sStereo.pred_prev_Q13));
         memset(psDec->sStereo.sSide, 0, sizeof(psDec->sStereo.sSide));
-        memcpy(&s_channel_state[1].resampler_state, &s_channel_state[0].resampler_state, sizeof(silk_resampler_state_struct));
+        memcpy(&s_silk->s_channel_state[1].resampler_state, &s_silk->s_channel_state[0].resampler_state, sizeof(silk_resampler_state_struct));
     }
-    psDec->nChannelsAPI = s_API_channels;
-    psDec->nChannelsInternal = s_channelsInternal;
+    psDec->nChannelsAPI = s_silk->s_API_channels;
+    psDec->nChannelsInternal = s_silk->s_channelsInternal;
 
-    if (s_API_sampleRate > (int32_t)MAX_API_FS_KHZ * 1000 || s_API_sampleRate < 8000) {
+    if (s_silk->s_API_sampleRate > (int32_t)MAX_API_FS_KHZ * 1000 || s_silk->s_API_sampleRate < 8000) {
         ret = SILK_DEC_INVALID_SAMPLING_FREQUENCY;
 
         return (ret);
     }
 
-    if (lostFlag != FLAG_PACKET_LOST && s_channel_state[0].nFramesDecoded == 0) {
+    if (lostFlag != FLAG_PACKET_LOST && s_silk->s_channel_state[0].nFramesDecoded == 0) {
         /* First decoder call for this payload */
         /* Decode VAD flags and LBRR flag */
-        for (n = 0; n < s_channelsInternal; n++) {
-            for (i = 0; i < s_channel_state[n].nFramesPerPacket; i++) { s_channel_state[n].VAD_flags[i] = ec_dec_bit_logp(1); }
-            s_channel_state[n].LBRR_flag = ec_dec_bit_logp(1);
+        for (n = 0; n < s_silk->s_channelsInternal; n++) {
+            for (i = 0; i < s_silk->s_channel_state[n].nFramesPerPacket; i++) { s_silk->s_channel_state[n].VAD_flags[i] = ec_dec_bit_logp(1); }
+            s_silk->s_channel_state[n].LBRR_flag = ec_dec_bit_logp(1);
         }
         /* Decode LBRR flags */
-        for (n = 0; n < s_channelsInternal; n++) {
-            memset(s_channel_state[n].LBRR_flags, 0, sizeof(s_channel_state[n].LBRR_flags));
-            if (s_channel_state[n].LBRR_flag) {
-                if (s_channel_state[n].nFramesPerPacket == 1) {
-                    s_channel_state[n].LBRR_flags[0] = 1;
+        for (n = 0; n < s_silk->s_channelsInternal; n++) {
+            memset(s_silk->s_channel_state[n].LBRR_flags, 0, sizeof(s_silk->s_channel_state[n].LBRR_flags));
+            if (s_silk->s_channel_state[n].LBRR_flag) {
+                if (s_silk->s_channel_state[n].nFramesPerPacket == 1) {
+                    s_silk->s_channel_state[n].LBRR_flags[0] = 1;
                 } else {
-                    LBRR_symbol = ec_dec_icdf(silk_LBRR_flags_iCDF_ptr[s_channel_state[n].nFramesPerPacket - 2], 8) + 1;
-                    for (i = 0; i < s_channel_state[n].nFramesPerPacket; i++) { s_channel_state[n].LBRR_flags[i] = silk_RSHIFT(LBRR_symbol, i) & 1; }
+                    LBRR_symbol = ec_dec_icdf(silk_LBRR_flags_iCDF_ptr[s_silk->s_channel_state[n].nFramesPerPacket - 2], 8) + 1;
+                    for (i = 0; i < s_silk->s_channel_state[n].nFramesPerPacket; i++) { s_silk->s_channel_state[n].LBRR_flags[i] = silk_RSHIFT(LBRR_symbol, i) & 1; }
                 }
             }
         }
 
         if (lostFlag == FLAG_DECODE_NORMAL) {
             /* Regular decoding: skip all LBRR data */
-            for (i = 0; i < s_channel_state[0].nFramesPerPacket; i++) {
-                for (n = 0; n < s_channelsInternal; n++) {
-                    if (s_channel_state[n].LBRR_flags[i]) {
+            for (i = 0; i < s_silk->s_channel_state[0].nFramesPerPacket; i++) {
+                for (n = 0; n < s_silk->s_channelsInternal; n++) {
+                    if (s_silk->s_channel_state[n].LBRR_flags[i]) {
                         int16_t pulses[MAX_FRAME_LENGTH];
                         int32_t condCoding;
 
-                        if (s_channelsInternal == 2 && n == 0) {
+                        if (s_silk->s_channelsInternal == 2 && n == 0) {
                             silk_stereo_decode_pred(MS_pred_Q13);
-                            if (s_channel_state[1].LBRR_flags[i] == 0) { silk_stereo_decode_mid_only(&decode_only_middle); }
+                            if (s_silk->s_channel_state[1].LBRR_flags[i] == 0) { silk_stereo_decode_mid_only(&decode_only_middle); }
                         }
                         /* Use conditional coding if previous frame available */
-                        if (i > 0 && s_channel_state[n].LBRR_flags[i - 1]) {
+                        if (i > 0 && s_silk->s_channel_state[n].LBRR_flags[i - 1]) {
                             condCoding = CODE_CONDITIONALLY;
                         } else {
                             condCoding = CODE_INDEPENDENTLY;
                         }
-                        silk_decode_indices(&s_channel_state[n], i, 1, condCoding);
-                        silk_decode_pulses(pulses, s_channel_state[n].indices.signalType, s_channel_state[n].indices.quantOffsetType, s_channel_state[n].frame_length);
+                        silk_decode_indices(&s_silk->s_channel_state[n], i, 1, condCoding);
+                        silk_decode_pulses(pulses, s_silk->s_channel_state[n].indices.signalType, s_silk->s_channel_state[n].indices.quantOffsetType, s_silk->s_channel_state[n].frame_length);
                     }
                 }
             }
@@ -1776,12 +1766,12 @@ int32_t silk_Decode(int32_t  lostFlag,      /* I    0: no loss, 1 loss, 2 decode
     }
 
     /* Get MS predictor index */
-    if (s_channelsInternal == 2) {
-        if (lostFlag == FLAG_DECODE_NORMAL || (lostFlag == FLAG_DECODE_LBRR && s_channel_state[0].LBRR_flags[s_channel_state[0].nFramesDecoded] == 1)) {
+    if (s_silk->s_channelsInternal == 2) {
+        if (lostFlag == FLAG_DECODE_NORMAL || (lostFlag == FLAG_DECODE_LBRR && s_silk->s_channel_state[0].LBRR_flags[s_silk->s_channel_state[0].nFramesDecoded] == 1)) {
             silk_stereo_decode_pred(MS_pred_Q13);
             /* For LBRR data, decode mid-only flag only if side-channel's LBRR flag is false */
-            if ((lostFlag == FLAG_DECODE_NORMAL && s_channel_state[1].VAD_flags[s_channel_state[0].nFramesDecoded] == 0) ||
-                (lostFlag == FLAG_DECODE_LBRR && s_channel_state[1].LBRR_flags[s_channel_state[0].nFramesDecoded] == 0)) {
+            if ((lostFlag == FLAG_DECODE_NORMAL && s_silk->s_channel_state[1].VAD_flags[s_silk->s_channel_state[0].nFramesDecoded] == 0) ||
+                (lostFlag == FLAG_DECODE_LBRR && s_silk->s_channel_state[1].LBRR_flags[s_silk->s_channel_state[0].nFramesDecoded] == 0)) {
                 silk_stereo_decode_mid_only(&decode_only_middle);
             } else {
                 decode_only_middle = 0;
@@ -1792,47 +1782,47 @@ int32_t silk_Decode(int32_t  lostFlag,      /* I    0: no loss, 1 loss, 2 decode
     }
 
     /* Reset side channel decoder prediction memory for first frame with side coding */
-    if (s_channelsInternal == 2 && decode_only_middle == 0 && psDec->prev_decode_only_middle == 1) {
-        memset(s_channel_state[1].outBuf, 0, sizeof(s_channel_state[1].outBuf));
-        memset(s_channel_state[1].sLPC_Q14_buf, 0, sizeof(s_channel_state[1].sLPC_Q14_buf));
-        s_channel_state[1].lagPrev = 100;
-        s_channel_state[1].LastGainIndex = 10;
-        s_channel_state[1].prevSignalType = TYPE_NO_VOICE_ACTIVITY;
-        s_channel_state[1].first_frame_after_reset = 1;
+    if (s_silk->s_channelsInternal == 2 && decode_only_middle == 0 && psDec->prev_decode_only_middle == 1) {
+        memset(s_silk->s_channel_state[1].outBuf, 0, sizeof(s_silk->s_channel_state[1].outBuf));
+        memset(s_silk->s_channel_state[1].sLPC_Q14_buf, 0, sizeof(s_silk->s_channel_state[1].sLPC_Q14_buf));
+        s_silk->s_channel_state[1].lagPrev = 100;
+        s_silk->s_channel_state[1].LastGainIndex = 10;
+        s_silk->s_channel_state[1].prevSignalType = TYPE_NO_VOICE_ACTIVITY;
+        s_silk->s_channel_state[1].first_frame_after_reset = 1;
     }
 
     /* Check if the temp buffer fits into the output PCM buffer. If it fits, we can delay allocating the temp buffer until after the SILK peak stack
        usage. We need to use a < and not a <= because of the two extra samples. */
-    delay_stack_alloc = s_silk_internalSampleRate * s_channelsInternal < s_API_sampleRate * s_API_channels;
+    delay_stack_alloc = s_silk->s_silk_internalSampleRate * s_silk->s_channelsInternal < s_silk->s_API_sampleRate * s_silk->s_API_channels;
 //    ALLOC(samplesOut1_tmp_storage1, delay_stack_alloc ? ALLOC_NONE : s_channelsInternal * (s_channel_state[0].frame_length + 2), int16_t);
-    int size = delay_stack_alloc ? ALLOC_NONE : s_channelsInternal * (s_channel_state[0].frame_length + 2);
+    int size = delay_stack_alloc ? ALLOC_NONE : s_silk->s_channelsInternal * (s_silk->s_channel_state[0].frame_length + 2);
     samplesOut1_tmp_storage1 = (int16_t*) __malloc_heap_psram(size * sizeof(int16_t));
 
     if (delay_stack_alloc) {
         samplesOut1_tmp[0] = samplesOut;
-        samplesOut1_tmp[1] = samplesOut + s_channel_state[0].frame_length + 2;
+        samplesOut1_tmp[1] = samplesOut + s_silk->s_channel_state[0].frame_length + 2;
     } else {
         samplesOut1_tmp[0] = samplesOut1_tmp_storage1;
-        samplesOut1_tmp[1] = samplesOut1_tmp_storage1 + s_channel_state[0].frame_length + 2;
+        samplesOut1_tmp[1] = samplesOut1_tmp_storage1 + s_silk->s_channel_state[0].frame_length + 2;
     }
 
     if (lostFlag == FLAG_DECODE_NORMAL) {
         has_side = !decode_only_middle;
     } else {
-        has_side = !psDec->prev_decode_only_middle || (s_channelsInternal == 2 && lostFlag == FLAG_DECODE_LBRR && s_channel_state[1].LBRR_flags[s_channel_state[1].nFramesDecoded] == 1);
+        has_side = !psDec->prev_decode_only_middle || (s_silk->s_channelsInternal == 2 && lostFlag == FLAG_DECODE_LBRR && s_silk->s_channel_state[1].LBRR_flags[s_silk->s_channel_state[1].nFramesDecoded] == 1);
     }
     /* Call decoder for one frame */
-    for (n = 0; n < s_channelsInternal; n++) {
+    for (n = 0; n < s_silk->s_channelsInternal; n++) {
         if (n == 0 || has_side) {
             int32_t FrameIndex;
             int32_t condCoding;
 
-            FrameIndex = s_channel_state[0].nFramesDecoded - n;
+            FrameIndex = s_silk->s_channel_state[0].nFramesDecoded - n;
             /* Use independent coding if no previous frame available */
             if (FrameIndex <= 0) {
                 condCoding = CODE_INDEPENDENTLY;
             } else if (lostFlag == FLAG_DECODE_LBRR) {
-                condCoding = s_channel_state[n].LBRR_flags[FrameIndex - 1] ? CODE_CONDITIONALLY : CODE_INDEPENDENTLY;
+                condCoding = s_silk->s_channel_state[n].LBRR_flags[FrameIndex - 1] ? CODE_CONDITIONALLY : CODE_INDEPENDENTLY;
             } else if (n > 0 && psDec->prev_decode_only_middle) {
                 /* If we skipped a side frame in this packet, we don't
                    need LTP scaling; the LTP state is well-defined. */
@@ -1840,16 +1830,16 @@ int32_t silk_Decode(int32_t  lostFlag,      /* I    0: no loss, 1 loss, 2 decode
             } else {
                 condCoding = CODE_CONDITIONALLY;
             }
-            ret += silk_decode_frame(&s_channel_state[n], &samplesOut1_tmp[n][2], &nSamplesOutDec, lostFlag, condCoding);
+            ret += silk_decode_frame(&s_silk->s_channel_state[n], &samplesOut1_tmp[n][2], &nSamplesOutDec, lostFlag, condCoding);
         } else {
             memset(&samplesOut1_tmp[n][2], 0, nSamplesOutDec * sizeof(int16_t));
         }
-        s_channel_state[n].nFramesDecoded++;
+        s_silk->s_channel_state[n].nFramesDecoded++;
     }
 
-    if (s_API_channels == 2 && s_channelsInternal == 2) {
+    if (s_silk->s_API_channels == 2 && s_silk->s_channelsInternal == 2) {
         /* Convert Mid/Side to Left/Right */
-        silk_stereo_MS_to_LR(&psDec->sStereo, samplesOut1_tmp[0], samplesOut1_tmp[1], MS_pred_Q13, s_channel_state[0].fs_kHz, nSamplesOutDec);
+        silk_stereo_MS_to_LR(&psDec->sStereo, samplesOut1_tmp[0], samplesOut1_tmp[1], MS_pred_Q13, s_silk->s_channel_state[0].fs_kHz, nSamplesOutDec);
     } else {
         /* Buffering */
         memcpy(samplesOut1_tmp[0], psDec->sStereo.sMid, 2 * sizeof(int16_t));
@@ -1857,45 +1847,45 @@ int32_t silk_Decode(int32_t  lostFlag,      /* I    0: no loss, 1 loss, 2 decode
     }
 
     /* Number of output samples */
-    *nSamplesOut = silk_DIV32(nSamplesOutDec * s_API_sampleRate, silk_SMULBB(s_channel_state[0].fs_kHz, 1000));
+    *nSamplesOut = silk_DIV32(nSamplesOutDec * s_silk->s_API_sampleRate, silk_SMULBB(s_silk->s_channel_state[0].fs_kHz, 1000));
 
     /* Set up pointers to temp buffers */
     // ALLOC(samplesOut2_tmp, s_API_channels == 2 ? *nSamplesOut : ALLOC_NONE, int16_t);
-    size = s_API_channels == 2 ? *nSamplesOut : ALLOC_NONE;
+    size = s_silk->s_API_channels == 2 ? *nSamplesOut : ALLOC_NONE;
     samplesOut2_tmp = (int16_t*) __malloc_heap_psram(size * sizeof(int16_t));
 
-    if (s_API_channels == 2) {
+    if (s_silk->s_API_channels == 2) {
         resample_out_ptr = samplesOut2_tmp;
     } else {
         resample_out_ptr = samplesOut;
     }
 
     // ALLOC(samplesOut1_tmp_storage2, delay_stack_alloc ? s_channelsInternal * (s_channel_state[0].frame_length + 2) : ALLOC_NONE, int16_t);
-    size = delay_stack_alloc ? s_channelsInternal * (s_channel_state[0].frame_length + 2) : ALLOC_NONE;
+    size = delay_stack_alloc ? s_silk->s_channelsInternal * (s_silk->s_channel_state[0].frame_length + 2) : ALLOC_NONE;
     samplesOut1_tmp_storage2 = (int16_t*) __malloc_heap_psram(size * sizeof(int16_t));
 
     if (delay_stack_alloc) {
         memcpy(samplesOut1_tmp_storage2, samplesOut, size * sizeof(int16_t));
         samplesOut1_tmp[0] = samplesOut1_tmp_storage2;
-        samplesOut1_tmp[1] = samplesOut1_tmp_storage2 + s_channel_state[0].frame_length + 2;
+        samplesOut1_tmp[1] = samplesOut1_tmp_storage2 + s_silk->s_channel_state[0].frame_length + 2;
     }
-    for (n = 0; n < silk_min(s_API_channels, s_channelsInternal); n++) {
+    for (n = 0; n < silk_min(s_silk->s_API_channels, s_silk->s_channelsInternal); n++) {
 
         /* Resample decoded signal to API_sampleRate */
-        ret += silk_resampler(&s_channel_state[n].resampler_state, resample_out_ptr, &samplesOut1_tmp[n][1], nSamplesOutDec);
+        ret += silk_resampler(&s_silk->s_channel_state[n].resampler_state, resample_out_ptr, &samplesOut1_tmp[n][1], nSamplesOutDec);
 
         /* Interleave if stereo output and stereo stream */
-        if (s_API_channels == 2) {
+        if (s_silk->s_API_channels == 2) {
             for (i = 0; i < *nSamplesOut; i++) { samplesOut[n + 2 * i] = resample_out_ptr[i]; }
         }
     }
 
     /* Create two channel output from mono stream */
-    if (s_API_channels == 2 && s_channelsInternal == 1) {
+    if (s_silk->s_API_channels == 2 && s_silk->s_channelsInternal == 1) {
         if (stereo_to_mono) {
             /* Resample right channel for newly collapsed stereo just in case
                we weren't doing collapsing when switching to mono */
-            ret += silk_resampler(&s_channel_state[1].resampler_state, resample_out_ptr, &samplesOut1_tmp[0][1], nSamplesOutDec);
+            ret += silk_resampler(&s_silk->s_channel_state[1].resampler_state, resample_out_ptr, &samplesOut1_tmp[0][1], nSamplesOutDec);
 
             for (i = 0; i < *nSamplesOut; i++) { samplesOut[1 + 2 * i] = resample_out_ptr[i]; }
         } else {
@@ -1904,24 +1894,24 @@ int32_t silk_Decode(int32_t  lostFlag,      /* I    0: no loss, 1 loss, 2 decode
     }
 
     /* Export pitch lag, measured at 48 kHz sampling rate */
-    if (s_channel_state[0].prevSignalType == TYPE_VOICED) {
+    if (s_silk->s_channel_state[0].prevSignalType == TYPE_VOICED) {
         int mult_tab[3] = {6, 4, 3};
-        s_prevPitchLag = s_channel_state[0].lagPrev * mult_tab[(s_channel_state[0].fs_kHz - 8) >> 2];
+        s_silk->s_prevPitchLag = s_silk->s_channel_state[0].lagPrev * mult_tab[(s_silk->s_channel_state[0].fs_kHz - 8) >> 2];
     } else {
-        s_prevPitchLag = 0;
+        s_silk->s_prevPitchLag = 0;
     }
 
     if (lostFlag == FLAG_PACKET_LOST) {
         /* On packet loss, remove the gain clamping to prevent having the energy "bounce back"
            if we lose packets when the energy is going down */
-        for (i = 0; i < psDec->nChannelsInternal; i++) s_channel_state[i].LastGainIndex = 10;
+        for (i = 0; i < psDec->nChannelsInternal; i++) s_silk->s_channel_state[i].LastGainIndex = 10;
     } else {
         psDec->prev_decode_only_middle = decode_only_middle;
     }
 
-    free(samplesOut1_tmp_storage1);
-    free(samplesOut2_tmp);
-    free(samplesOut1_tmp_storage2);
+    AudioMemory::release(samplesOut1_tmp_storage1);
+    AudioMemory::release(samplesOut2_tmp);
+    AudioMemory::release(samplesOut1_tmp_storage2);
 
     return ret;
 }
@@ -1940,10 +1930,10 @@ int32_t silk_Get_Decoder_Size(int32_t* decSizeBytes) {
 int32_t silk_InitDecoder() {
 
     int32_t n, ret = SILK_NO_ERROR;
-    for (n = 0; n < DECODER_NUM_CHANNELS; n++) { ret = silk_init_decoder(&s_channel_state[n]); }
-    memset(&s_decState.sStereo, 0, sizeof(s_decState.sStereo));
+    for (n = 0; n < DECODER_NUM_CHANNELS; n++) { ret = silk_init_decoder(&s_silk->s_channel_state[n]); }
+    memset(&s_silk->s_decState.sStereo, 0, sizeof(s_silk->s_decState.sStereo));
     /* Not strictly needed, but it's cleaner that way */
-    s_decState.prev_decode_only_middle = 0;
+    s_silk->s_decState.prev_decode_only_middle = 0;
 
     return ret;
 }
@@ -3140,7 +3130,7 @@ void silk_PLC_energy(int32_t* energy1, int32_t* shift1, int32_t* energy2, int32_
     silk_sum_sqr_shift(energy1, shift1, exc_buf, subfr_length);
     silk_sum_sqr_shift(energy2, shift2, &exc_buf[subfr_length], subfr_length);
 
-    free(exc_buf);
+    AudioMemory::release(exc_buf);
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 
@@ -3316,8 +3306,8 @@ void silk_PLC_conceal(silk_decoder_state*   psDec,     /* I/O Decoder state
     psPLC->randScale_Q14 = rand_scale_Q14;
     for (i = 0; i < MAX_NB_SUBFR; i++) { psDecCtrl->pitchL[i] = lag; }
 
-    free(sLTP_Q14);
-    free(sLTP);
+    AudioMemory::release(sLTP_Q14);
+    AudioMemory::release(sLTP);
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 /* Glues concealed frames with new good received frames */
@@ -777,6 +777,21 @@ typedef struct {
     int32_t prevPitchLag;
 } silk_DecControlStruct;
 
+// SILK state of one Opus stream, part of the OPUSDecoder_t context (see OPUSDecoder_CreateContext)
+typedef struct _silk_ctx{
+    silk_decoder_state s_channel_state[2] = {};
+    silk_decoder       s_decState;
+
+    uint8_t            s_channelsInternal = 0;
+    uint8_t            s_payloadSize_ms = 0;
+    uint8_t            s_API_channels = 0;
+    uint32_t           s_silk_internalSampleRate = 0;
+    uint32_t           s_API_sampleRate = 0;
+    uint32_t           s_prevPitchLag = 0;
+} silk_ctx_t;
+
+extern thread_local OPUS_CONSTINIT silk_ctx_t* s_silk; // bound with OPUSDecoder_SetContext()
+
 extern const int16_t silk_Quantization_Offsets_Q10[2][2];
 extern const uint8_t silk_stereo_pred_joint_iCDF[25];
 extern const uint8_t silk_uniform3_iCDF[3];
@@ -787,6 +802,25 @@ extern const uint8_t silk_uniform8_iCDF[8];
 extern const uint8_t silk_NLSF_EXT_iCDF[7];
 extern const uint8_t silk_stereo_only_code_mid_iCDF[2];
 
+// tables shared with the encoder (../opus_encoder/silk_enc.cpp)
+extern const uint8_t silk_gain_iCDF[3][N_LEVELS_QGAIN / 8];
+extern const uint8_t silk_delta_gain_iCDF[MAX_DELTA_GAIN_QUANT - MIN_DELTA_GAIN_QUANT + 1];
+extern const uint8_t silk_type_offset_VAD_iCDF[4];
+extern const uint8_t silk_type_offset_no_VAD_iCDF[2];
+extern const uint8_t silk_NLSF_interpolation_factor_iCDF[5];
+extern const uint8_t silk_pulses_per_block_iCDF[N_RATE_LEVELS][SILK_MAX_PULSES + 2];
+extern const uint8_t silk_rate_levels_iCDF[2][N_RATE_LEVELS - 1];
+extern const uint8_t silk_rate_levels_BITS_Q5[2][N_RATE_LEVELS - 1];
+extern const uint8_t silk_shell_code_table0[152];
+extern const uint8_t silk_shell_code_table1[152];
+extern const uint8_t silk_shell_code_table2[152];
+extern const uint8_t silk_shell_code_table3[152];
+extern const uint8_t silk_shell_code_table_offsets[SILK_MAX_PULSES + 1];
+extern const uint8_t silk_sign_iCDF[42];
+extern const uint8_t silk_lsb_iCDF[2];
+extern const uint8_t silk_max_pulses_table[4];
+extern const silk_NLSF_CB_struct silk_NLSF_CB_WB;
+
 // prototypes and inlines
 
 /* silk_min() versions with typecast in the function call */
@@ -0,0 +1,150 @@
+/*
+ * opus_encoder.cpp
+ * SILK-only Opus packets (RFC 6716) in an Ogg container (RFC 7845) for the microphone uplink
+ */
+//----------------------------------------------------------------------------------------------------------------------
+//                                     O G G / O P U S     E N C O D E R
+//----------------------------------------------------------------------------------------------------------------------
+#include "opus_encoder.h"
+#include "silk_enc.h"
+#include "../AudioMemory.h"
+#include "Arduino.h"
+#include <new>
+
+static const uint8_t  OPUS_TOC_SILK_WB_20MS = (9 << 3) | (0 << 2) | 0;  // config 9: SILK WB 20 ms, mono, code 0 (one frame)
+static const uint32_t OPUS_GRANULE_PER_FRAME = 960;                    // granule positions count 48 kHz samples
+static const char     OPUS_VENDOR[] = "DAZI-AI SILK";
+
+// Encoder state, one per stream (see OPUSEncoder_CreateContext)
+struct OPUSEncoder_t {
+    silk_encoder_state s_silk;
+    uint32_t           s_bitrate = 0;
+    uint32_t           s_serial = 0;
+    uint32_t           s_pageSeq = 0;
+    uint64_t           s_granule = 0;   // end of the last packet put into a page
+    uint32_t           s_frames = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+OPUSEncoder_t* OPUSEncoder_CreateContext(uint32_t bitrate){
+    void* mem = AudioMemory::alloc(sizeof(OPUSEncoder_t), AUDIO_MEM_INTERNAL_PREFERRED);
+    if(!mem) return NULL;
+    OPUSEncoder_t* ctx = new (mem) OPUSEncoder_t();
+    ctx->s_bitrate = bitrate;
+    OPUSEncoder_Reset(ctx);
+    return ctx;
+}
+void OPUSEncoder_DestroyContext(OPUSEncoder_t* ctx){
+    if(!ctx) return;
+    ctx->~OPUSEncoder_t();
+    AudioMemory::release(ctx);
+}
+//----------------------------------------------------------------------------------------------------------------------
+void OPUSEncoder_Reset(OPUSEncoder_t* ctx){
+    silk_init_encoder(&ctx->s_silk, ctx->s_bitrate);
+    ctx->s_serial = esp_random();
+    ctx->s_pageSeq = 0;
+    ctx->s_granule = 0;
+    ctx->s_frames = 0;
+}
+//----------------------------------------------------------------------------------------------------------------------
+void OPUSEncoder_SetBitrate(OPUSEncoder_t* ctx, uint32_t bitrate){
+    ctx->s_bitrate = bitrate;
+    silk_encoder_set_bitrate(&ctx->s_silk, bitrate);
+}
+//----------------------------------------------------------------------------------------------------------------------
+uint32_t OPUSEncoderGetFrames(OPUSEncoder_t* ctx){
+    return ctx->s_frames;
+}
+//----------------------------------------------------------------------------------------------------------------------
+int32_t OPUSEncode(OPUSEncoder_t* ctx, const int16_t* pcm, uint8_t* outbuf, int32_t maxBytes){
+    if(maxBytes < 2) return ERR_OPUS_ENC_BUFFER_TOO_SMALL;
+    outbuf[0] = OPUS_TOC_SILK_WB_20MS;
+    int32_t len = silk_Encode(&ctx->s_silk, pcm, outbuf + 1, maxBytes - 1);
+    if(len < 0) return ERR_OPUS_ENC_FRAME_FAILED;
+    ctx->s_frames++;
+    return len + 1;
+}
+//----------------------------------------------------------------------------------------------------------------------
+static uint32_t ogg_crc(const uint8_t* data, int32_t len, uint32_t crc){
+    // CRC-32, polynomial 0x04c11db7, no reflection, initial value 0 (RFC 3533)
+    for(int32_t i = 0; i < len; i++){
+        crc ^= (uint32_t)data[i] << 24;
+        for(int b = 0; b < 8; b++) crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+    }
+    return crc;
+}
+//----------------------------------------------------------------------------------------------------------------------
+static void ogg_put_le(uint8_t* p, uint64_t v, int bytes){
+    for(int i = 0; i < bytes; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+//----------------------------------------------------------------------------------------------------------------------
+static int32_t ogg_write_page(OPUSEncoder_t* ctx, uint8_t headerType, uint64_t granule, const uint8_t* packets, const uint16_t* packetLen,
+                              uint8_t nPackets, uint8_t* outbuf, int32_t maxBytes){
+    int32_t segments = 0, bodyLen = 0;
+    for(uint8_t i = 0; i < nPackets; i++){
+        segments += packetLen[i] / 255 + 1;
+        bodyLen += packetLen[i];
+    }
+    if(segments > 255) return ERR_OPUS_ENC_TOO_MANY_PACKETS;
+    int32_t pageLen = 27 + segments + bodyLen;
+    if(pageLen > maxBytes) return ERR_OPUS_ENC_BUFFER_TOO_SMALL;
+
+    memcpy(outbuf, "OggS", 4);
+    outbuf[4] = 0;                              // stream structure version
+    outbuf[5] = headerType;                     // 0x02 first page, 0x04 last page
+    ogg_put_le(outbuf + 6, granule, 8);
+    ogg_put_le(outbuf + 14, ctx->s_serial, 4);
+    ogg_put_le(outbuf + 18, ctx->s_pageSeq++, 4);
+    ogg_put_le(outbuf + 22, 0, 4);              // CRC, filled in below
+    outbuf[26] = (uint8_t)segments;
+
+    // Lacing values: 255 for each full segment, the remainder (possibly 0) ends the packet
+    uint8_t* lacing = outbuf + 27;
+    for(uint8_t i = 0; i < nPackets; i++){
+        for(uint16_t n = packetLen[i]; ; n -= 255){
+            if(n < 255){ *lacing++ = (uint8_t)n; break; }
+            *lacing++ = 255;
+        }
+    }
+    memcpy(outbuf + 27 + segments, packets, bodyLen);
+    ogg_put_le(outbuf + 22, ogg_crc(outbuf, pageLen, 0), 4);
+    return pageLen;
+}
+//----------------------------------------------------------------------------------------------------------------------
+int32_t OPUSWriteOggHeaders(OPUSEncoder_t* ctx, uint8_t* outbuf, int32_t maxBytes){
+    // OpusHead: version 1, mono, no pre-skip (the encoder has no look-ahead), 16 kHz input, 0 dB, mapping family 0
+    uint8_t head[19];
+    memcpy(head, "OpusHead", 8);
+    head[8] = 1;
+    head[9] = 1;
+    ogg_put_le(head + 10, 0, 2);
+    ogg_put_le(head + 12, OPUS_ENC_SAMPLE_RATE, 4);
+    ogg_put_le(head + 16, 0, 2);
+    head[18] = 0;
+
+    // OpusTags: vendor string, no user comments
+    uint8_t  tags[8 + 4 + sizeof(OPUS_VENDOR) - 1 + 4];
+    uint32_t vendorLen = sizeof(OPUS_VENDOR) - 1;
+    memcpy(tags, "OpusTags", 8);
+    ogg_put_le(tags + 8, vendorLen, 4);
+    memcpy(tags + 12, OPUS_VENDOR, vendorLen);
+    ogg_put_le(tags + 12 + vendorLen, 0, 4);
+
+    uint16_t len = sizeof(head);
+    int32_t  n1 = ogg_write_page(ctx, 0x02, 0, head, &len, 1, outbuf, maxBytes);
+    if(n1 < 0) return n1;
+    len = sizeof(tags);
+    int32_t  n2 = ogg_write_page(ctx, 0x00, 0, tags, &len, 1, outbuf + n1, maxBytes - n1);
+    if(n2 < 0) return n2;
+    return n1 + n2;
+}
+//----------------------------------------------------------------------------------------------------------------------
+int32_t OPUSWriteOggPage(OPUSEncoder_t* ctx, const uint8_t* packets, const uint16_t* packetLen, uint8_t nPackets, bool lastPage,
+                         uint8_t* outbuf, int32_t maxBytes){
+    if(nPackets > OPUS_ENC_MAX_PAGE_PACKETS) return ERR_OPUS_ENC_TOO_MANY_PACKETS;
+    uint64_t granule = ctx->s_granule + (uint64_t)nPackets * OPUS_GRANULE_PER_FRAME;
+    int32_t  ret = ogg_write_page(ctx, lastPage ? 0x04 : 0x00, granule, packets, packetLen, nPackets, outbuf, maxBytes);
+    if(ret > 0) ctx->s_granule = granule;
+    return ret;
+}
@@ -0,0 +1,29 @@
+// Ogg Opus encoder for the microphone uplink, counterpart of ../opus_decoder
+// 16 kHz mono PCM in, SILK-only wideband packets (one 20 ms frame each) out, optionally muxed into Ogg pages.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+enum : int8_t  {ERR_OPUS_ENC_NONE = 0,
+                ERR_OPUS_ENC_BUFFER_TOO_SMALL = -1,
+                ERR_OPUS_ENC_TOO_MANY_PACKETS = -2,
+                ERR_OPUS_ENC_FRAME_FAILED = -3};
+
+#define OPUS_ENC_SAMPLE_RATE      16000
+#define OPUS_ENC_FRAME_SAMPLES    320    // 20 ms at 16 kHz
+#define OPUS_ENC_MAX_PACKET       256    // bytes, far above what the rate control asks for
+#define OPUS_ENC_MAX_PAGE_PACKETS 50     // one second per Ogg page at most
+#define OPUS_ENC_HEADERS_SIZE     128    // OpusHead + OpusTags pages
+
+// Unlike the decoder every call takes its context explicitly, so each client can own one without binding it to a task.
+struct OPUSEncoder_t;
+OPUSEncoder_t* OPUSEncoder_CreateContext(uint32_t bitrate);     // NULL if out of memory
+void           OPUSEncoder_DestroyContext(OPUSEncoder_t* ctx);
+void           OPUSEncoder_Reset(OPUSEncoder_t* ctx);           // new stream: fresh SILK state, next pages start a new Ogg stream
+void           OPUSEncoder_SetBitrate(OPUSEncoder_t* ctx, uint32_t bitrate);
+int32_t        OPUSEncode(OPUSEncoder_t* ctx, const int16_t* pcm, uint8_t* outbuf, int32_t maxBytes);  // one frame -> one packet, returns its size
+int32_t        OPUSWriteOggHeaders(OPUSEncoder_t* ctx, uint8_t* outbuf, int32_t maxBytes);          // OpusHead and OpusTags pages
+int32_t        OPUSWriteOggPage(OPUSEncoder_t* ctx, const uint8_t* packets, const uint16_t* packetLen, uint8_t nPackets, bool lastPage,
+                                uint8_t* outbuf, int32_t maxBytes);                                 // packets back to back, returns page size
+uint32_t       OPUSEncoderGetFrames(OPUSEncoder_t* ctx);        // frames encoded since the last reset
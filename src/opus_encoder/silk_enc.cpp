@@ -0,0 +1,610 @@
+/*
+ * silk_enc.cpp
+ * SILK wideband encoder for the microphone uplink, built on the quantizers and tables of ../opus_decoder/silk.cpp
+ *
+ * Per 20 ms frame: DC blocker, LPC analysis (autocorrelation + Levinson), NLSF quantization, one gain per subframe
+ * from the LPC residual, then the excitation is quantized sample by sample through the decoder's own synthesis
+ * filter, so encoder and decoder states never drift apart. Bitstream order follows silk_decode_indices() and
+ * silk_decode_pulses().
+ */
+#include "silk_enc.h"
+#include <string.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+//                                          R A N G E   E N C O D E R
+//----------------------------------------------------------------------------------------------------------------------
+static const uint32_t EC_ENC_SYM_BITS   = 8;
+static const uint32_t EC_ENC_SYM_MAX    = 255;
+static const uint32_t EC_ENC_CODE_BITS  = 32;
+static const uint32_t EC_ENC_CODE_TOP   = 2147483648; // 1U << (EC_CODE_BITS - 1)
+static const uint32_t EC_ENC_CODE_BOT   = 8388608;    // EC_CODE_TOP >> EC_SYM_BITS
+static const uint32_t EC_ENC_CODE_SHIFT = 23;         // EC_CODE_BITS - EC_SYM_BITS - 1
+
+static void ec_enc_write_byte(ec_ctx_t* enc, uint32_t value) {
+    if (enc->offs + enc->end_offs >= enc->storage) {
+        enc->error = -1;
+        return;
+    }
+    enc->buf[enc->offs++] = (uint8_t)value;
+}
+//----------------------------------------------------------------------------------------------------------------------
+/* Outputs a symbol, with a carry bit. If there is a potential to propagate a carry over several symbols, they are
+   buffered until it can be determined whether or not an actual carry will occur. */
+static void ec_enc_carry_out(ec_ctx_t* enc, int32_t c) {
+    if (c != (int32_t)EC_ENC_SYM_MAX) {
+        int32_t carry = c >> EC_ENC_SYM_BITS;
+        if (enc->rem >= 0) ec_enc_write_byte(enc, enc->rem + carry);
+        if (enc->ext > 0) {
+            uint32_t sym = (EC_ENC_SYM_MAX + carry) & EC_ENC_SYM_MAX;
+            do ec_enc_write_byte(enc, sym);
+            while (--(enc->ext) > 0);
+        }
+        enc->rem = c & EC_ENC_SYM_MAX;
+    } else {
+        enc->ext++;
+    }
+}
+//----------------------------------------------------------------------------------------------------------------------
+static void ec_enc_normalize(ec_ctx_t* enc) {
+    while (enc->rng <= EC_ENC_CODE_BOT) {
+        ec_enc_carry_out(enc, (int32_t)(enc->val >> EC_ENC_CODE_SHIFT));
+        enc->val = (enc->val << EC_ENC_SYM_BITS) & (EC_ENC_CODE_TOP - 1);
+        enc->rng <<= EC_ENC_SYM_BITS;
+        enc->nbits_total += EC_ENC_SYM_BITS;
+    }
+}
+//----------------------------------------------------------------------------------------------------------------------
+void ec_enc_init(ec_ctx_t* enc, uint8_t* buf, uint32_t size) {
+    enc->buf = buf;
+    enc->storage = size;
+    enc->end_offs = 0;
+    enc->end_window = 0;
+    enc->nend_bits = 0;
+    enc->nbits_total = EC_ENC_CODE_BITS + 1;
+    enc->offs = 0;
+    enc->rng = EC_ENC_CODE_TOP;
+    enc->rem = -1;
+    enc->val = 0;
+    enc->ext = 0;
+    enc->error = 0;
+}
+//----------------------------------------------------------------------------------------------------------------------
+/* Encodes symbol s with the inverse CDF used by ec_dec_icdf() */
+void ec_enc_icdf(ec_ctx_t* enc, int32_t s, const uint8_t* icdf, uint32_t ftb) {
+    uint32_t r = enc->rng >> ftb;
+    if (s > 0) {
+        enc->val += enc->rng - r * icdf[s - 1];
+        enc->rng = r * (icdf[s - 1] - icdf[s]);
+    } else {
+        enc->rng -= r * icdf[s];
+    }
+    ec_enc_normalize(enc);
+}
+//----------------------------------------------------------------------------------------------------------------------
+/* Encodes a bit that is 1 with probability 1/(1<<logp), counterpart of ec_dec_bit_logp() */
+void ec_enc_bit_logp(ec_ctx_t* enc, int32_t val, uint32_t logp) {
+    uint32_t r = enc->rng;
+    uint32_t l = enc->val;
+    uint32_t s = r >> logp;
+    r -= s;
+    if (val) enc->val = l + r;
+    enc->rng = val ? s : r;
+    ec_enc_normalize(enc);
+}
+//----------------------------------------------------------------------------------------------------------------------
+/* Bits used so far, rounded up */
+int32_t ec_enc_tell(const ec_ctx_t* enc) {
+    return enc->nbits_total - EC_ILOG(enc->rng);
+}
+//----------------------------------------------------------------------------------------------------------------------
+/* Flushes the minimum number of bits that still decode to the symbols written so far */
+void ec_enc_done(ec_ctx_t* enc) {
+    int32_t  l = EC_ENC_CODE_BITS - EC_ILOG(enc->rng);
+    uint32_t msk = (EC_ENC_CODE_TOP - 1) >> l;
+    uint32_t end = (enc->val + msk) & ~msk;
+    if ((end | msk) >= enc->val + enc->rng) {
+        l++;
+        msk >>= 1;
+        end = (enc->val + msk) & ~msk;
+    }
+    while (l > 0) {
+        ec_enc_carry_out(enc, (int32_t)(end >> EC_ENC_CODE_SHIFT));
+        end = (end << EC_ENC_SYM_BITS) & (EC_ENC_CODE_TOP - 1);
+        l -= EC_ENC_SYM_BITS;
+    }
+    /* If we have a buffered byte flush it into the output buffer */
+    if (enc->rem >= 0 || enc->ext > 0) ec_enc_carry_out(enc, 0);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+//                                          S I L K   E N C O D E R
+//----------------------------------------------------------------------------------------------------------------------
+static const int32_t HP_COEF_Q15 = 32511;                          /* DC blocker pole, ~40 Hz at 16 kHz            */
+static const int32_t VAD_ENERGY_THRESHOLD = 16 * 16;               /* mean square below this is coded as inactive  */
+static const int32_t NLSF_MU_Q20 = SILK_FIX_CONST(0.0025, 20);     /* NLSF rate/distortion trade-off               */
+static const int32_t NLSF_SURVIVORS = 4;                           /* first stage candidates for the trellis       */
+static const int32_t NOISE_SHAPING_CHIRP_Q16 = SILK_FIX_CONST(0.94, 16);  /* 1: noise follows the full envelope, 0: white */
+static const int32_t MIN_GAIN_SCALE_Q8 = 32;                       /* 0.125: finest step the rate control may use  */
+static const int32_t MAX_GAIN_SCALE_Q8 = 8192;                     /* 32: coarsest                                 */
+
+void silk_encoder_set_bitrate(silk_encoder_state* psEnc, int32_t bitRate) {
+    psEnc->targetBits = bitRate / (1000 / (SILK_ENC_NB_SUBFR * SUB_FRAME_LENGTH_MS));
+}
+//----------------------------------------------------------------------------------------------------------------------
+void silk_init_encoder(silk_encoder_state* psEnc, int32_t bitRate) {
+    memset(psEnc, 0, sizeof(silk_encoder_state));
+    /* same start values as silk_decoder_set_fs() / silk_init_decoder() */
+    psEnc->prev_gain_Q16 = 65536;
+    psEnc->LastGainIndex = 10;
+    psEnc->gainScale_Q8 = 256;
+    silk_encoder_set_bitrate(psEnc, bitRate);
+}
+//----------------------------------------------------------------------------------------------------------------------
+/* First order DC blocker, y[n] = x[n] - x[n-1] + a * y[n-1] */
+static void silk_enc_highpass(silk_encoder_state* psEnc, int16_t out[], const int16_t in[], int32_t len) {
+    int32_t x1 = psEnc->HP_state[0], y1_Q8 = psEnc->HP_state[1];
+    for (int32_t i = 0; i < len; i++) {
+        y1_Q8 = silk_LSHIFT((int32_t)in[i] - x1, 8) + (int32_t)(((int64_t)y1_Q8 * HP_COEF_Q15) >> 15);
+        x1 = in[i];
+        out[i] = (int16_t)silk_SAT16(silk_RSHIFT_ROUND(y1_Q8, 8));
+    }
+    psEnc->HP_state[0] = x1;
+    psEnc->HP_state[1] = y1_Q8;
+}
+//----------------------------------------------------------------------------------------------------------------------
+static uint32_t silk_enc_isqrt64(uint64_t x) {
+    uint64_t r = 0, bit = (uint64_t)1 << 62;
+    while (bit > x) bit >>= 2;
+    while (bit) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)r;
+}
+//----------------------------------------------------------------------------------------------------------------------
+/* LPC analysis of the windowed history + frame, result as NLSFs */
+static void silk_enc_find_NLSF(const int16_t x[], int16_t NLSF_Q15[]) {
+    const int32_t len = SILK_ENC_HISTORY + SILK_ENC_FRAME_LENGTH;
+    const int32_t ramp = SILK_ENC_SUBFR_LENGTH;
+    int16_t xw[SILK_ENC_HISTORY + SILK_ENC_FRAME_LENGTH];
+    int64_t r64[SILK_ENC_LPC_ORDER + 1];
+    int32_t r[SILK_ENC_LPC_ORDER + 1];
+    int64_t a_Q20[SILK_ENC_LPC_ORDER + 1] = {0}, tmp_Q20[SILK_ENC_LPC_ORDER + 1];
+    int32_t a_Q16[SILK_ENC_LPC_ORDER];
+    int32_t i, j, shift;
+
+    /* Trapezoid window, linear ramps of one subframe at both ends */
+    for (i = 0; i < len; i++) {
+        int32_t w_Q15 = 32767;
+        if (i < ramp) {
+            w_Q15 = ((2 * i + 1) << 15) / (2 * ramp);
+        } else if (i >= len - ramp) {
+            w_Q15 = ((2 * (len - i) - 1) << 15) / (2 * ramp);
+        }
+        xw[i] = (int16_t)silk_RSHIFT((int32_t)x[i] * w_Q15, 15);
+    }
+
+    /* Autocorrelation with -40 dB white noise floor */
+    for (j = 0; j <= SILK_ENC_LPC_ORDER; j++) {
+        int64_t acc = 0;
+        for (i = j; i < len; i++) acc += (int32_t)xw[i] * xw[i - j];
+        r64[j] = acc;
+    }
+    r64[0] += (r64[0] >> 13) + 1;
+
+    /* Normalize to r[0] in [2^29, 2^30) */
+    shift = 63 - __builtin_clzll((uint64_t)r64[0]) - 29;
+    for (j = 0; j <= SILK_ENC_LPC_ORDER; j++) { r[j] = (int32_t)(shift >= 0 ? r64[j] >> shift : r64[j] << -shift); }
+
+    /* Levinson-Durbin, predictor convention x[n] ~ sum a[k] x[n-k], coefficients in Q20 */
+    int64_t err = r[0];
+    for (i = 1; i <= SILK_ENC_LPC_ORDER; i++) {
+        int64_t acc = (int64_t)r[i] << 20;
+        for (j = 1; j < i; j++) acc -= a_Q20[j] * r[i - j];
+        int64_t k_Q20 = acc / err;
+        if (k_Q20 > SILK_FIX_CONST(0.999, 20)) k_Q20 = SILK_FIX_CONST(0.999, 20);
+        if (k_Q20 < -SILK_FIX_CONST(0.999, 20)) k_Q20 = -SILK_FIX_CONST(0.999, 20);
+        for (j = 1; j < i; j++) tmp_Q20[j] = a_Q20[j] - ((k_Q20 * a_Q20[i - j]) >> 20);
+        for (j = 1; j < i; j++) a_Q20[j] = tmp_Q20[j];
+        a_Q20[i] = k_Q20;
+        err -= (((k_Q20 * k_Q20) >> 20) * err) >> 20;
+        if (err < 1) err = 1;
+    }
+    for (i = 0; i < SILK_ENC_LPC_ORDER; i++) { a_Q16[i] = (int32_t)silk_RSHIFT_ROUND(a_Q20[i + 1], 4); }
+
+    /* Slight bandwidth expansion keeps the NLSFs of sharp resonances apart */
+    silk_bwexpander_32(a_Q16, SILK_ENC_LPC_ORDER, SILK_FIX_CONST(0.995, 16));
+    silk_A2NLSF(NLSF_Q15, a_Q16, SILK_ENC_LPC_ORDER);
+}
+//----------------------------------------------------------------------------------------------------------------------
+/* NLSF vector quantizer, two stages with a trellis on the residual. Returns the quantized (decoded) vector in pNLSF_Q15 */
+static void silk_enc_NLSF_encode(int8_t* NLSFIndices, int16_t* pNLSF_Q15, const silk_NLSF_CB_struct* psNLSF_CB, const int16_t* pW_Q2, const int32_t signalType) {
+    int32_t        i, s, ind1, bestIndex, prob_Q8, bits_q7;
+    int32_t        W_tmp_Q9;
+    int32_t        err_Q24[NLSF_VQ_MAX_VECTORS];
+    int32_t        RD_Q25[NLSF_SURVIVORS];
+    int32_t        tempIndices1[NLSF_SURVIVORS];
+    int8_t         tempIndices2[NLSF_SURVIVORS * MAX_LPC_ORDER];
+    int16_t        res_Q10[MAX_LPC_ORDER];
+    int16_t        NLSF_tmp_Q15[MAX_LPC_ORDER];
+    int16_t        W_adj_Q5[MAX_LPC_ORDER];
+    uint8_t        pred_Q8[MAX_LPC_ORDER];
+    int16_t        ec_ix[MAX_LPC_ORDER];
+    const uint8_t* pCB_element;
+    const uint8_t* iCDF_ptr;
+    const int16_t* pCB_Wght_Q9;
+
+    silk_NLSF_stabilize(pNLSF_Q15, psNLSF_CB->deltaMin_Q15, psNLSF_CB->order);
+
+    /* First stage: VQ */
+    silk_NLSF_VQ(err_Q24, pNLSF_Q15, psNLSF_CB->CB1_NLSF_Q8, psNLSF_CB->CB1_Wght_Q9, psNLSF_CB->nVectors, psNLSF_CB->order);
+    silk_insertion_sort_increasing(err_Q24, tempIndices1, psNLSF_CB->nVectors, NLSF_SURVIVORS);
+
+    for (s = 0; s < NLSF_SURVIVORS; s++) {
+        ind1 = tempIndices1[s];
+
+        /* Residual after first stage */
+        pCB_element = &psNLSF_CB->CB1_NLSF_Q8[ind1 * psNLSF_CB->order];
+        pCB_Wght_Q9 = &psNLSF_CB->CB1_Wght_Q9[ind1 * psNLSF_CB->order];
+        for (i = 0; i < psNLSF_CB->order; i++) {
+            NLSF_tmp_Q15[i] = (int16_t)silk_LSHIFT((int16_t)pCB_element[i], 7);
+            W_tmp_Q9 = pCB_Wght_Q9[i];
+            res_Q10[i] = (int16_t)silk_RSHIFT(silk_SMULBB(pNLSF_Q15[i] - NLSF_tmp_Q15[i], W_tmp_Q9), 14);
+            W_adj_Q5[i] = (int16_t)silk_DIV32_varQ((int32_t)pW_Q2[i], silk_SMULBB(W_tmp_Q9, W_tmp_Q9), 21);
+        }
+
+        /* Trellis quantizer on the residual */
+        silk_NLSF_unpack(ec_ix, pred_Q8, psNLSF_CB, ind1);
+        RD_Q25[s] = silk_NLSF_del_dec_quant(&tempIndices2[s * MAX_LPC_ORDER], res_Q10, W_adj_Q5, pred_Q8, ec_ix, psNLSF_CB->ec_Rates_Q5, psNLSF_CB->quantStepSize_Q16,
+                                            psNLSF_CB->invQuantStepSize_Q6, NLSF_MU_Q20, psNLSF_CB->order);
+
+        /* Add rate for first stage */
+        iCDF_ptr = &psNLSF_CB->CB1_iCDF[(signalType >> 1) * psNLSF_CB->nVectors];
+        if (ind1 == 0) {
+            prob_Q8 = 256 - iCDF_ptr[ind1];
+        } else {
+            prob_Q8 = iCDF_ptr[ind1 - 1] - iCDF_ptr[ind1];
+        }
+        bits_q7 = (8 << 7) - silk_lin2log(prob_Q8);
+        RD_Q25[s] = silk_SMLABB(RD_Q25[s], bits_q7, silk_RSHIFT(NLSF_MU_Q20, 2));
+    }
+
+    silk_insertion_sort_increasing(RD_Q25, &bestIndex, NLSF_SURVIVORS, 1);
+    NLSFIndices[0] = (int8_t)tempIndices1[bestIndex];
+    memcpy(&NLSFIndices[1], &tempIndices2[bestIndex * MAX_LPC_ORDER], psNLSF_CB->order * sizeof(int8_t));
+
+    /* What the decoder will see */
+    silk_NLSF_decode(pNLSF_Q15, NLSFIndices, psNLSF_CB);
+}
+//----------------------------------------------------------------------------------------------------------------------
+/* Closed loop excitation quantizer: the exact inverse of silk_decode_core() for unvoiced frames */
+static void silk_enc_quant_excitation(silk_encoder_state* psEnc, const int16_t x[], const int16_t A_Q12[], const int32_t Gains_Q16[], int32_t offset_Q10, int32_t seed) {
+    int32_t  sLPC_Q14[SILK_ENC_SUBFR_LENGTH + MAX_LPC_ORDER];
+    int32_t  sErr_Q14[SILK_ENC_SUBFR_LENGTH + MAX_LPC_ORDER];
+    int16_t  NF_Q12[MAX_LPC_ORDER];
+    int32_t  rand_seed = seed;
+    int32_t  i, j, k;
+    int16_t* pulses = psEnc->pulses;
+
+    memcpy(sLPC_Q14, psEnc->sLPC_Q14, MAX_LPC_ORDER * sizeof(int32_t));
+    memcpy(sErr_Q14, psEnc->sErr_Q14, MAX_LPC_ORDER * sizeof(int32_t));
+
+    /* Noise feedback filter: the coding noise comes out shaped like 1 / A(z / NOISE_SHAPING_CHIRP), i.e. it follows the formants */
+    memcpy(NF_Q12, A_Q12, sizeof(NF_Q12));
+    silk_bwexpander(NF_Q12, SILK_ENC_LPC_ORDER, NOISE_SHAPING_CHIRP_Q16);
+
+    for (k = 0; k < SILK_ENC_NB_SUBFR; k++) {
+        int32_t Gain_Q10 = silk_RSHIFT(Gains_Q16[k], 6);
+        int64_t inv_gain_Q40 = ((int64_t)1 << 40) / silk_max_int(Gain_Q10, 1);
+
+        /* Scale short term state like the decoder does */
+        if (Gains_Q16[k] != psEnc->prev_gain_Q16) {
+            int32_t gain_adj_Q16 = silk_DIV32_varQ(psEnc->prev_gain_Q16, Gains_Q16[k], 16);
+            for (i = 0; i < MAX_LPC_ORDER; i++) {
+                sLPC_Q14[i] = silk_SMULWW(gain_adj_Q16, sLPC_Q14[i]);
+                sErr_Q14[i] = silk_SMULWW(gain_adj_Q16, sErr_Q14[i]);
+            }
+        }
+        psEnc->prev_gain_Q16 = Gains_Q16[k];
+
+        for (i = 0; i < SILK_ENC_SUBFR_LENGTH; i++) {
+            rand_seed = silk_RAND(rand_seed);
+
+            /* Short-term prediction, same rounding as silk_decode_core() */
+            int32_t LPC_pred_Q10 = silk_RSHIFT(SILK_ENC_LPC_ORDER, 1);
+            for (j = 0; j < SILK_ENC_LPC_ORDER; j++) { LPC_pred_Q10 = silk_SMLAWB(LPC_pred_Q10, sLPC_Q14[MAX_LPC_ORDER + i - 1 - j], A_Q12[j]); }
+            int32_t pred_Q14 = silk_LSHIFT_SAT32(LPC_pred_Q10, 4);
+            int32_t NF_Q10 = 0;
+            for (j = 0; j < SILK_ENC_LPC_ORDER; j++) { NF_Q10 = silk_SMLAWB(NF_Q10, sErr_Q14[MAX_LPC_ORDER + i - 1 - j], NF_Q12[j]); }
+
+            /* Excitation that would reproduce x exactly plus the filtered past coding noise, in units of the quantizer step */
+            int64_t x_Q14 = ((int64_t)x[k * SILK_ENC_SUBFR_LENGTH + i] * inv_gain_Q40) >> 16;
+            int64_t target_Q14 = x_Q14 - pred_Q14 - ((int64_t)NF_Q10 << 4);
+            if (rand_seed < 0) target_Q14 = -target_Q14;
+
+            /* Nearest reconstruction level: q - sign(q) * QUANT_LEVEL_ADJUST + offset */
+            int32_t q = (int32_t)((target_Q14 - (offset_Q10 << 4) + (1 << 13)) >> 14);
+            int64_t best = INT64_MAX;
+            int32_t bestQ = 0;
+            for (int32_t c = q - 1; c <= q + 1; c++) {
+                int32_t cq = silk_LIMIT(c, -SILK_ENC_MAX_PULSE, SILK_ENC_MAX_PULSE);
+                int64_t level = ((int64_t)cq << 14) + (offset_Q10 << 4);
+                if (cq > 0) level -= QUANT_LEVEL_ADJUST_Q10 << 4;
+                if (cq < 0) level += QUANT_LEVEL_ADJUST_Q10 << 4;
+                int64_t d = target_Q14 - level;
+                if (d < 0) d = -d;
+                if (d < best) {
+                    best = d;
+                    bestQ = cq;
+                }
+            }
+
+            int32_t exc_Q14 = silk_LSHIFT(bestQ, 14);
+            if (exc_Q14 > 0) {
+                exc_Q14 -= QUANT_LEVEL_ADJUST_Q10 << 4;
+            } else if (exc_Q14 < 0) {
+                exc_Q14 += QUANT_LEVEL_ADJUST_Q10 << 4;
+            }
+            exc_Q14 += offset_Q10 << 4;
+            if (rand_seed < 0) exc_Q14 = -exc_Q14;
+
+            sLPC_Q14[MAX_LPC_ORDER + i] = silk_ADD_SAT32(exc_Q14, pred_Q14);
+            sErr_Q14[MAX_LPC_ORDER + i] = (int32_t)silk_LIMIT(x_Q14 - sLPC_Q14[MAX_LPC_ORDER + i], -(1 << 28), 1 << 28);
+            pulses[k * SILK_ENC_SUBFR_LENGTH + i] = (int16_t)bestQ;
+            rand_seed = silk_ADD32_ovflw(rand_seed, bestQ);
+        }
+        memcpy(sLPC_Q14, &sLPC_Q14[SILK_ENC_SUBFR_LENGTH], MAX_LPC_ORDER * sizeof(int32_t));
+        memcpy(sErr_Q14, &sErr_Q14[SILK_ENC_SUBFR_LENGTH], MAX_LPC_ORDER * sizeof(int32_t));
+    }
+    memcpy(psEnc->sLPC_Q14, sLPC_Q14, MAX_LPC_ORDER * sizeof(int32_t));
+    memcpy(psEnc->sErr_Q14, sErr_Q14, MAX_LPC_ORDER * sizeof(int32_t));
+}
+//----------------------------------------------------------------------------------------------------------------------
+static int32_t silk_enc_combine_and_check(int32_t* pulses_comb, const int32_t* pulses_in, int32_t max_pulses, int32_t len) {
+    for (int32_t k = 0; k < len; k++) {
+        int32_t sum = pulses_in[2 * k] + pulses_in[2 * k + 1];
+        if (sum > max_pulses) return 1;
+        pulses_comb[k] = sum;
+    }
+    return 0;
+}
+//----------------------------------------------------------------------------------------------------------------------
+static inline void silk_enc_encode_split(ec_ctx_t* psRangeEnc, const int32_t p_child1, const int32_t p, const uint8_t* shell_table) {
+    if (p > 0) { ec_enc_icdf(psRangeEnc, p_child1, &shell_table[silk_shell_code_table_offsets[p]], 8); }
+}
+//----------------------------------------------------------------------------------------------------------------------
+/* Counterpart of silk_shell_decoder(), one block of 16 pulse magnitudes */
+static void silk_enc_shell_encoder(ec_ctx_t* psRangeEnc, const int32_t* pulses0) {
+    int32_t pulses1[8], pulses2[4], pulses3[2], pulses4[1];
+
+    combine_pulses(pulses1, pulses0, 8);
+    combine_pulses(pulses2, pulses1, 4);
+    combine_pulses(pulses3, pulses2, 2);
+    combine_pulses(pulses4, pulses3, 1);
+
+    silk_enc_encode_split(psRangeEnc, pulses3[0], pulses4[0], silk_shell_code_table3);
+    silk_enc_encode_split(psRangeEnc, pulses2[0], pulses3[0], silk_shell_code_table2);
+    silk_enc_encode_split(psRangeEnc, pulses1[0], pulses2[0], silk_shell_code_table1);
+    silk_enc_encode_split(psRangeEnc, pulses0[0], pulses1[0], silk_shell_code_table0);
+    silk_enc_encode_split(psRangeEnc, pulses0[2], pulses1[1], silk_shell_code_table0);
+    silk_enc_encode_split(psRangeEnc, pulses1[2], pulses2[1], silk_shell_code_table1);
+    silk_enc_encode_split(psRangeEnc, pulses0[4], pulses1[2], silk_shell_code_table0);
+    silk_enc_encode_split(psRangeEnc, pulses0[6], pulses1[3], silk_shell_code_table0);
+    silk_enc_encode_split(psRangeEnc, pulses2[2], pulses3[1], silk_shell_code_table2);
+    silk_enc_encode_split(psRangeEnc, pulses1[4], pulses2[2], silk_shell_code_table1);
+    silk_enc_encode_split(psRangeEnc, pulses0[8], pulses1[4], silk_shell_code_table0);
+    silk_enc_encode_split(psRangeEnc, pulses0[10], pulses1[5], silk_shell_code_table0);
+    silk_enc_encode_split(psRangeEnc, pulses1[6], pulses2[3], silk_shell_code_table1);
+    silk_enc_encode_split(psRangeEnc, pulses0[12], pulses1[6], silk_shell_code_table0);
+    silk_enc_encode_split(psRangeEnc, pulses0[14], pulses1[7], silk_shell_code_table0);
+}
+//----------------------------------------------------------------------------------------------------------------------
+/* Cost of symbol s in Q7 bits */
+static int32_t silk_enc_icdf_bits_Q7(const uint8_t* icdf, int32_t s) {
+    int32_t prob_Q8 = (s == 0) ? 256 - icdf[0] : icdf[s - 1] - icdf[s];
+    return (8 << 7) - silk_lin2log(silk_max_int(prob_Q8, 1));
+}
+//----------------------------------------------------------------------------------------------------------------------
+/* Counterpart of silk_decode_pulses(): rate level, pulse counts, shell code, LSBs, signs */
+static void silk_enc_encode_pulses(silk_encoder_state* psEnc, ec_ctx_t* psRangeEnc, const int32_t signalType, const int32_t quantOffsetType) {
+    const int32_t  iter = SILK_ENC_FRAME_LENGTH / SHELL_CODEC_FRAME_LENGTH;
+    int32_t        i, k, j, scale_down, RateLevelIndex = 0, sumBits_Q7, minSumBits_Q7 = silk_int32_MAX;
+    int32_t        sum_pulses[MAX_NB_SHELL_BLOCKS], nRshifts[MAX_NB_SHELL_BLOCKS];
+    int32_t        pulses_comb[8];
+    int32_t*       abs_pulses = psEnc->abs_pulses;
+    const int16_t* pulses = psEnc->pulses;
+
+    for (i = 0; i < SILK_ENC_FRAME_LENGTH; i++) { abs_pulses[i] = silk_abs(pulses[i]); }
+
+    /* Sum pulses per shell code frame, right-shift until every partial sum fits its table */
+    for (i = 0; i < iter; i++) {
+        int32_t* abs_pulses_ptr = &abs_pulses[i * SHELL_CODEC_FRAME_LENGTH];
+        nRshifts[i] = 0;
+        while (1) {
+            scale_down = silk_enc_combine_and_check(pulses_comb, abs_pulses_ptr, silk_max_pulses_table[0], 8);
+            scale_down += silk_enc_combine_and_check(pulses_comb, pulses_comb, silk_max_pulses_table[1], 4);
+            scale_down += silk_enc_combine_and_check(pulses_comb, pulses_comb, silk_max_pulses_table[2], 2);
+            scale_down += silk_enc_combine_and_check(&sum_pulses[i], pulses_comb, silk_max_pulses_table[3], 1);
+            if (!scale_down) break;
+            nRshifts[i]++;
+            for (k = 0; k < SHELL_CODEC_FRAME_LENGTH; k++) { abs_pulses_ptr[k] = silk_RSHIFT(abs_pulses_ptr[k], 1); }
+        }
+    }
+
+    /* Rate level with the fewest bits for the pulse counts */
+    for (k = 0; k < N_RATE_LEVELS - 1; k++) {
+        const uint8_t* cdf_ptr = silk_pulses_per_block_iCDF[k];
+        sumBits_Q7 = silk_LSHIFT(silk_rate_levels_BITS_Q5[signalType >> 1][k], 2);
+        for (i = 0; i < iter; i++) { sumBits_Q7 += silk_enc_icdf_bits_Q7(cdf_ptr, nRshifts[i] > 0 ? SILK_MAX_PULSES + 1 : sum_pulses[i]); }
+        if (sumBits_Q7 < minSumBits_Q7) {
+            minSumBits_Q7 = sumBits_Q7;
+            RateLevelIndex = k;
+        }
+    }
+    ec_enc_icdf(psRangeEnc, RateLevelIndex, silk_rate_levels_iCDF[signalType >> 1], 8);
+
+    /* Sum-weighted pulses */
+    for (i = 0; i < iter; i++) {
+        if (nRshifts[i] == 0) {
+            ec_enc_icdf(psRangeEnc, sum_pulses[i], silk_pulses_per_block_iCDF[RateLevelIndex], 8);
+        } else {
+            ec_enc_icdf(psRangeEnc, SILK_MAX_PULSES + 1, silk_pulses_per_block_iCDF[RateLevelIndex], 8);
+            for (k = 0; k < nRshifts[i] - 1; k++) { ec_enc_icdf(psRangeEnc, SILK_MAX_PULSES + 1, silk_pulses_per_block_iCDF[N_RATE_LEVELS - 1], 8); }
+            ec_enc_icdf(psRangeEnc, sum_pulses[i], silk_pulses_per_block_iCDF[N_RATE_LEVELS - 1], 8);
+        }
+    }
+
+    /* Shell coding */
+    for (i = 0; i < iter; i++) {
+        if (sum_pulses[i] > 0) { silk_enc_shell_encoder(psRangeEnc, &abs_pulses[i * SHELL_CODEC_FRAME_LENGTH]); }
+    }
+
+    /* LSBs, most significant first */
+    for (i = 0; i < iter; i++) {
+        if (nRshifts[i] > 0) {
+            const int16_t* pulses_ptr = &pulses[i * SHELL_CODEC_FRAME_LENGTH];
+            for (k = 0; k < SHELL_CODEC_FRAME_LENGTH; k++) {
+                int32_t abs_q = silk_abs(pulses_ptr[k]);
+                for (j = nRshifts[i] - 1; j > 0; j--) { ec_enc_icdf(psRangeEnc, silk_RSHIFT(abs_q, j) & 1, silk_lsb_iCDF, 8); }
+                ec_enc_icdf(psRangeEnc, abs_q & 1, silk_lsb_iCDF, 8);
+            }
+        }
+    }
+
+    /* Signs, counterpart of silk_decode_signs() */
+    uint8_t        icdf[2] = {0, 0};
+    const uint8_t* icdf_ptr = &silk_sign_iCDF[silk_SMULBB(7, silk_ADD_LSHIFT(quantOffsetType, signalType, 1))];
+    for (i = 0; i < iter; i++) {
+        if (sum_pulses[i] > 0) {
+            const int16_t* q_ptr = &pulses[i * SHELL_CODEC_FRAME_LENGTH];
+            icdf[0] = icdf_ptr[silk_min(sum_pulses[i] & 0x1F, 6)];
+            for (j = 0; j < SHELL_CODEC_FRAME_LENGTH; j++) {
+                if (q_ptr[j] != 0) { ec_enc_icdf(psRangeEnc, silk_enc_map(q_ptr[j]), icdf, 8); }
+            }
+        }
+    }
+}
+//----------------------------------------------------------------------------------------------------------------------
+/* Counterpart of silk_decode_indices() for one independently coded, non-voiced frame */
+static void silk_enc_encode_indices(ec_ctx_t* psRangeEnc, const int8_t GainsIndices[], const int8_t NLSFIndices[], int32_t signalType, int32_t quantOffsetType,
+                                    int32_t vad, int32_t seed) {
+    const silk_NLSF_CB_struct* psNLSF_CB = &silk_NLSF_CB_WB;
+    int16_t                    ec_ix[MAX_LPC_ORDER];
+    uint8_t                    pred_Q8[MAX_LPC_ORDER];
+    int32_t                    i, typeOffset = 2 * signalType + quantOffsetType;
+
+    /* Signal type and quantizer offset */
+    if (vad) {
+        ec_enc_icdf(psRangeEnc, typeOffset - 2, silk_type_offset_VAD_iCDF, 8);
+    } else {
+        ec_enc_icdf(psRangeEnc, typeOffset, silk_type_offset_no_VAD_iCDF, 8);
+    }
+
+    /* Gains: first one absolute (MSBs, then 3 LSBs), the rest as deltas */
+    ec_enc_icdf(psRangeEnc, silk_RSHIFT(GainsIndices[0], 3), silk_gain_iCDF[signalType], 8);
+    ec_enc_icdf(psRangeEnc, GainsIndices[0] & 7, silk_uniform8_iCDF, 8);
+    for (i = 1; i < SILK_ENC_NB_SUBFR; i++) { ec_enc_icdf(psRangeEnc, GainsIndices[i], silk_delta_gain_iCDF, 8); }
+
+    /* NLSFs */
+    ec_enc_icdf(psRangeEnc, NLSFIndices[0], &psNLSF_CB->CB1_iCDF[(signalType >> 1) * psNLSF_CB->nVectors], 8);
+    silk_NLSF_unpack(ec_ix, pred_Q8, psNLSF_CB, NLSFIndices[0]);
+    for (i = 0; i < psNLSF_CB->order; i++) {
+        int32_t ind = NLSFIndices[i + 1];
+        if (ind >= NLSF_QUANT_MAX_AMPLITUDE) {
+            ec_enc_icdf(psRangeEnc, 2 * NLSF_QUANT_MAX_AMPLITUDE, &psNLSF_CB->ec_iCDF[ec_ix[i]], 8);
+            ec_enc_icdf(psRangeEnc, ind - NLSF_QUANT_MAX_AMPLITUDE, silk_NLSF_EXT_iCDF, 8);
+        } else if (ind <= -NLSF_QUANT_MAX_AMPLITUDE) {
+            ec_enc_icdf(psRangeEnc, 0, &psNLSF_CB->ec_iCDF[ec_ix[i]], 8);
+            ec_enc_icdf(psRangeEnc, -ind - NLSF_QUANT_MAX_AMPLITUDE, silk_NLSF_EXT_iCDF, 8);
+        } else {
+            ec_enc_icdf(psRangeEnc, ind + NLSF_QUANT_MAX_AMPLITUDE, &psNLSF_CB->ec_iCDF[ec_ix[i]], 8);
+        }
+    }
+
+    /* No interpolation with the previous frame */
+    ec_enc_icdf(psRangeEnc, 4, silk_NLSF_interpolation_factor_iCDF, 8);
+
+    /* Seed */
+    ec_enc_icdf(psRangeEnc, seed, silk_uniform4_iCDF, 8);
+}
+//----------------------------------------------------------------------------------------------------------------------
+/* Encode one 20 ms frame into a SILK payload (VAD and LBRR header bits first, as silk_Decode() reads them) */
+int32_t silk_Encode(silk_encoder_state* psEnc, const int16_t samplesIn[SILK_ENC_FRAME_LENGTH], uint8_t* outbuf, int32_t maxBytes) {
+    const silk_NLSF_CB_struct* psNLSF_CB = &silk_NLSF_CB_WB;
+    int16_t*                   x = &psEnc->x_buf[SILK_ENC_HISTORY];
+    int16_t                    NLSF_Q15[MAX_LPC_ORDER], pNLSFW_Q2[MAX_LPC_ORDER], A_Q12[MAX_LPC_ORDER];
+    int8_t                     NLSFIndices[MAX_LPC_ORDER + 1], GainsIndices[SILK_ENC_NB_SUBFR];
+    int32_t                    Gains_Q16[SILK_ENC_NB_SUBFR], resRms_Q8[SILK_ENC_NB_SUBFR];
+    int32_t                    i, k, vad, signalType, quantOffsetType = 0;
+    int64_t                    energy = 0;
+    ec_ctx_t                   enc;
+
+    /* New frame behind one subframe of history */
+    memmove(psEnc->x_buf, &psEnc->x_buf[SILK_ENC_FRAME_LENGTH], SILK_ENC_HISTORY * sizeof(int16_t));
+    silk_enc_highpass(psEnc, x, samplesIn, SILK_ENC_FRAME_LENGTH);
+
+    for (i = 0; i < SILK_ENC_FRAME_LENGTH; i++) energy += (int32_t)x[i] * x[i];
+    vad = energy > (int64_t)VAD_ENERGY_THRESHOLD * SILK_ENC_FRAME_LENGTH;
+    signalType = vad ? TYPE_UNVOICED : TYPE_NO_VOICE_ACTIVITY;
+
+    /* Spectral envelope */
+    silk_enc_find_NLSF(psEnc->x_buf, NLSF_Q15);
+    silk_NLSF_VQ_weights_laroia(pNLSFW_Q2, NLSF_Q15, psNLSF_CB->order);
+    silk_enc_NLSF_encode(NLSFIndices, NLSF_Q15, psNLSF_CB, pNLSFW_Q2, signalType);
+    silk_NLSF2A(A_Q12, NLSF_Q15, psNLSF_CB->order);
+
+    /* Residual RMS per subframe with the quantized filter */
+    silk_LPC_analysis_filter(psEnc->res, x - MAX_LPC_ORDER, A_Q12, MAX_LPC_ORDER + SILK_ENC_FRAME_LENGTH, MAX_LPC_ORDER);
+    for (k = 0; k < SILK_ENC_NB_SUBFR; k++) {
+        const int16_t* r = &psEnc->res[MAX_LPC_ORDER + k * SILK_ENC_SUBFR_LENGTH];
+        uint64_t       nrg = 0;
+        for (i = 0; i < SILK_ENC_SUBFR_LENGTH; i++) nrg += (int32_t)r[i] * r[i];
+        resRms_Q8[k] = silk_enc_isqrt64((nrg << 16) / SILK_ENC_SUBFR_LENGTH);
+    }
+
+    /* Quantize; if the payload does not fit, retry with a coarser step */
+    int32_t sLPC_Q14[MAX_LPC_ORDER], sErr_Q14[MAX_LPC_ORDER], prev_gain_Q16 = psEnc->prev_gain_Q16;
+    int8_t  LastGainIndex = psEnc->LastGainIndex;
+    memcpy(sLPC_Q14, psEnc->sLPC_Q14, sizeof(sLPC_Q14));
+    memcpy(sErr_Q14, psEnc->sErr_Q14, sizeof(sErr_Q14));
+    int32_t seed = psEnc->frameCounter & 3;
+    int32_t scale_Q8 = psEnc->gainScale_Q8;
+    for (int32_t attempt = 0; attempt < 4; attempt++) {
+        for (k = 0; k < SILK_ENC_NB_SUBFR; k++) {
+            int64_t g = ((int64_t)resRms_Q8[k] * scale_Q8);  /* Q16 */
+            Gains_Q16[k] = (int32_t)silk_min_64(silk_max_64(g, 1), silk_int32_MAX >> 1);
+        }
+        silk_gains_quant(GainsIndices, Gains_Q16, &psEnc->LastGainIndex, 0, SILK_ENC_NB_SUBFR);
+        silk_enc_quant_excitation(psEnc, x, A_Q12, Gains_Q16, silk_Quantization_Offsets_Q10[signalType >> 1][quantOffsetType], seed);
+
+        ec_enc_init(&enc, outbuf, maxBytes);
+        ec_enc_bit_logp(&enc, vad, 1);  /* VAD flag */
+        ec_enc_bit_logp(&enc, 0, 1);    /* no LBRR */
+        silk_enc_encode_indices(&enc, GainsIndices, NLSFIndices, signalType, quantOffsetType, vad, seed);
+        silk_enc_encode_pulses(psEnc, &enc, signalType, quantOffsetType);
+        ec_enc_done(&enc);
+        if (!enc.error) break;
+
+        /* Roll the mirrored decoder state back */
+        memcpy(psEnc->sLPC_Q14, sLPC_Q14, sizeof(sLPC_Q14));
+        memcpy(psEnc->sErr_Q14, sErr_Q14, sizeof(sErr_Q14));
+        psEnc->prev_gain_Q16 = prev_gain_Q16;
+        psEnc->LastGainIndex = LastGainIndex;
+        scale_Q8 = silk_min_int(scale_Q8 * 4, MAX_GAIN_SCALE_Q8 * 4);
+    }
+    if (enc.error) return -1;
+    psEnc->frameCounter++;
+
+    /* Rate control: steer the step size towards the target, only on active frames */
+    if (vad && psEnc->targetBits > 0) {
+        int32_t bits = ec_enc_tell(&enc);
+        int32_t adj_Q8 = silk_LIMIT(((bits - psEnc->targetBits) * 64) / psEnc->targetBits, -32, 32);
+        psEnc->gainScale_Q8 = silk_LIMIT(silk_RSHIFT(psEnc->gainScale_Q8 * (256 + adj_Q8), 8), MIN_GAIN_SCALE_Q8, MAX_GAIN_SCALE_Q8);
+    }
+    return enc.offs;
+}
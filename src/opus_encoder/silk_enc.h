@@ -0,0 +1,45 @@
+// SILK wideband encoder, counterpart of ../opus_decoder/silk.cpp
+// Mono, 16 kHz, one 20 ms frame per packet. Only unvoiced / inactive frames are produced (no pitch analysis, no LTP),
+// the excitation is quantized in closed loop against an exact copy of the decoder's synthesis filter, with noise feedback
+// so that the coding noise follows the spectral envelope.
+#pragma once
+
+#include "../opus_decoder/silk.h"
+#include <stdint.h>
+
+#define SILK_ENC_FS_KHZ        16
+#define SILK_ENC_NB_SUBFR      4
+#define SILK_ENC_SUBFR_LENGTH  (SUB_FRAME_LENGTH_MS * SILK_ENC_FS_KHZ)       /* 80 samples */
+#define SILK_ENC_FRAME_LENGTH  (SILK_ENC_NB_SUBFR * SILK_ENC_SUBFR_LENGTH)   /* 320 samples */
+#define SILK_ENC_LPC_ORDER     MAX_LPC_ORDER
+#define SILK_ENC_HISTORY       SILK_ENC_SUBFR_LENGTH                         /* LPC window reaches one subframe back */
+#define SILK_ENC_MAX_PULSE     511                                           /* keeps the LSB count well below the 10 allowed */
+
+/* Range encoder (RFC 6716 section 5.1), writes the stream that ec_dec_*() in celt.cpp reads. No raw bits, SILK needs none */
+void    ec_enc_init(ec_ctx_t* enc, uint8_t* buf, uint32_t size);
+void    ec_enc_icdf(ec_ctx_t* enc, int32_t s, const uint8_t* icdf, uint32_t ftb);
+void    ec_enc_bit_logp(ec_ctx_t* enc, int32_t val, uint32_t logp);
+void    ec_enc_done(ec_ctx_t* enc);
+int32_t ec_enc_tell(const ec_ctx_t* enc);
+
+/* Encoder state, one per stream */
+typedef struct {
+    int16_t x_buf[SILK_ENC_HISTORY + SILK_ENC_FRAME_LENGTH];  /* high-passed input, previous subframe first      */
+    int32_t HP_state[2];                                      /* DC blocker: last input, last output (Q8)        */
+    int32_t sLPC_Q14[MAX_LPC_ORDER];                          /* mirrors silk_decoder_state::sLPC_Q14_buf        */
+    int32_t sErr_Q14[MAX_LPC_ORDER];                          /* past coding noise for the noise feedback filter */
+    int32_t prev_gain_Q16;                                    /* mirrors silk_decoder_state::prev_gain_Q16       */
+    int8_t  LastGainIndex;                                    /* mirrors silk_decoder_state::LastGainIndex       */
+    uint8_t frameCounter;                                     /* selects the excitation seed                     */
+    int32_t gainScale_Q8;                                     /* quantizer step / residual RMS, set by rate ctrl */
+    int32_t targetBits;                                       /* bits per frame the rate control aims for        */
+
+    /* per frame scratch, kept here to spare the caller's stack */
+    int16_t res[MAX_LPC_ORDER + SILK_ENC_FRAME_LENGTH];
+    int16_t pulses[SILK_ENC_FRAME_LENGTH];
+    int32_t abs_pulses[SILK_ENC_FRAME_LENGTH];
+} silk_encoder_state;
+
+void    silk_init_encoder(silk_encoder_state* psEnc, int32_t bitRate);
+void    silk_encoder_set_bitrate(silk_encoder_state* psEnc, int32_t bitRate);
+int32_t silk_Encode(silk_encoder_state* psEnc, const int16_t samplesIn[SILK_ENC_FRAME_LENGTH], uint8_t* outbuf, int32_t maxBytes);  // bytes written, <0 on error
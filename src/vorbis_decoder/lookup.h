@@ -6,7 +6,15 @@
 
 #pragma once
 
-const int32_t FLOOR_fromdB_LOOKUP[256] = {
+// const tables stay in flash. VORBIS_LOW_MEMORY moves only the small ones read for every sample (floor curve,
+// inverse square root, cosine, bit masks) to internal RAM, where they do not compete for the flash cache.
+#if defined(VORBIS_LOW_MEMORY) && defined(DRAM_ATTR)
+    #define VORBIS_HOT DRAM_ATTR
+#else
+    #define VORBIS_HOT
+#endif
+
+VORBIS_HOT const int32_t FLOOR_fromdB_LOOKUP[256] = {
     0x000000e5, 0x000000f4, 0x00000103, 0x00000114, 0x00000126, 0x00000139, 0x0000014e, 0x00000163, 0x0000017a,
     0x00000193, 0x000001ad, 0x000001c9, 0x000001e7, 0x00000206, 0x00000228, 0x0000024c, 0x00000272, 0x0000029b,
     0x000002c6, 0x000002f4, 0x00000326, 0x0000035a, 0x00000392, 0x000003cd, 0x0000040c, 0x00000450, 0x00000497,
@@ -1208,7 +1216,7 @@ const int32_t sincos_lookup1[1024] = {
     0x5afe8a8b, 0x5a29727b, 0x5adb297d, 0x5a4d1960, 0x5ab7ba6c, 0x5a70b258, 0x5a943d5e,
 };
 
-const int32_t INVSQ_LOOKUP_I[64 + 1] = {
+VORBIS_HOT const int32_t INVSQ_LOOKUP_I[64 + 1] = {
     92682, 91966, 91267, 90583, 89915, 89261, 88621, 87995, 87381, 86781, 86192, 85616, 85051,
     84497, 83953, 83420, 82897, 82384, 81880, 81385, 80899, 80422, 79953, 79492, 79039, 78594,
     78156, 77726, 77302, 76885, 76475, 76072, 75674, 75283, 74898, 74519, 74146, 73778, 73415,
@@ -1216,13 +1224,13 @@ const int32_t INVSQ_LOOKUP_I[64 + 1] = {
     68842, 68548, 68256, 67969, 67685, 67405, 67128, 66855, 66585, 66318, 66054, 65794, 65536,
 };
 
-const int32_t INVSQ_LOOKUP_IDel[64] = {
+VORBIS_HOT const int32_t INVSQ_LOOKUP_IDel[64] = {
     716, 699, 684, 668, 654, 640, 626, 614, 600, 589, 576, 565, 554, 544, 533, 523, 513, 504, 495, 486, 477, 469,
     461, 453, 445, 438, 430, 424, 417, 410, 403, 398, 391, 385, 379, 373, 368, 363, 357, 352, 347, 343, 337, 332,
     328, 324, 319, 315, 311, 306, 303, 299, 294, 292, 287, 284, 280, 277, 273, 270, 267, 264, 260, 258,
 };
 
-static const int32_t COS_LOOKUP_I[COS_LOOKUP_I_SZ + 1] = {
+VORBIS_HOT static const int32_t COS_LOOKUP_I[COS_LOOKUP_I_SZ + 1] = {
     16384,  16379,  16364,  16340,  16305,  16261,  16207,  16143,  16069,  15986,  15893,  15791,  15679,
     15557,  15426,  15286,  15137,  14978,  14811,  14635,  14449,  14256,  14053,  13842,  13623,  13395,
     13160,  12916,  12665,  12406,  12140,  11866,  11585,  11297,  11003,  10702,  10394,  10080,  9760,
@@ -22,170 +22,226 @@
 //----------------------------------------------------------------------------------------------------------------------
 #include "vorbis_decoder.h"
 #include "lookup.h"
+#include "../AudioMemory.h"
 #include "alloca.h"
 #include <vector>
+#include <new>
 using namespace std;
 
 #define __malloc_heap_psram(size) \
-    heap_caps_malloc_prefer(size, 2, MALLOC_CAP_DEFAULT | MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL)
+    vorbis_alloc(size)
 #define __calloc_heap_psram(ch, size) \
-    heap_caps_calloc_prefer(ch, size, 2, MALLOC_CAP_DEFAULT | MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL)
-
-
-// global vars
-bool      s_f_vorbisNewSteamTitle = false;  // streamTitle
-bool      s_f_vorbisNewMetadataBlockPicture = false;
-bool      s_f_oggFirstPage = false;
-bool      s_f_oggContinuedPage = false;
-bool      s_f_oggLastPage = false;
-bool      s_f_parseOggDone = true;
-bool      s_f_lastSegmentTable = false;
-bool      s_f_vorbisStr_found = false;
-uint16_t  s_identificatonHeaderLength = 0;
-uint16_t  s_vorbisCommentHeaderLength = 0;
-uint16_t  s_setupHeaderLength = 0;
-uint8_t   s_pageNr = 0;
-uint16_t  s_oggHeaderSize = 0;
-uint8_t   s_vorbisChannels = 0;
-uint16_t  s_vorbisSamplerate = 0;
-uint16_t  s_lastSegmentTableLen = 0;
-uint8_t  *s_lastSegmentTable = NULL;
-uint32_t  s_vorbisBitRate = 0;
-uint32_t  s_vorbisSegmentLength = 0;
-uint32_t  s_vorbisBlockPicLenUntilFrameEnd = 0;
-uint32_t  s_vorbisCurrentFilePos = 0;
-uint32_t  s_vorbisAudioDataStart = 0;
-char     *s_vorbisChbuf = NULL;
-int32_t   s_vorbisValidSamples = 0;
-int32_t   s_commentBlockSegmentSize = 0;
-uint8_t   s_vorbisOldMode = 0;
-uint32_t  s_blocksizes[2];
-uint32_t  s_vorbisBlockPicPos = 0;
-uint32_t  s_vorbisBlockPicLen = 0;
-int32_t   s_vorbisRemainBlockPicLen = 0;
-int32_t   s_commentLength = 0;
-
-uint8_t   s_nrOfCodebooks = 0;
-uint8_t   s_nrOfFloors = 0;
-uint8_t   s_nrOfResidues = 0;
-uint8_t   s_nrOfMaps = 0;
-uint8_t   s_nrOfModes = 0;
-
-uint16_t *s_vorbisSegmentTable = NULL;
-uint16_t  s_oggPage3Len = 0; // length of the current audio segment
-uint8_t   s_vorbisSegmentTableSize = 0;
-int16_t   s_vorbisSegmentTableRdPtr = -1;
-int8_t    s_vorbisError = 0;
-float     s_vorbisCompressionRatio = 0;
-
-bitReader_t            s_bitReader;
-
-codebook_t            *s_codebooks = NULL;
-vorbis_info_floor_t  **s_floor_param = NULL;
-int8_t                *s_floor_type = NULL;
-vorbis_info_residue_t *s_residue_param = NULL;
-vorbis_info_mapping_t *s_map_param = NULL;
-vorbis_info_mode_t    *s_mode_param = NULL;
-vorbis_dsp_state_t    *s_dsp_state = NULL;
-
-vector<uint32_t>s_vorbisBlockPicItem;
+    vorbis_calloc(ch, size)
+
+
+// Decoder state, one per stream (see VORBISDecoder_CreateContext)
+struct VORBISDecoder_t {
+    bool                   s_f_vorbisNewSteamTitle = false; // streamTitle
+    bool                   s_f_vorbisNewMetadataBlockPicture = false;
+    bool                   s_f_oggFirstPage = false;
+    bool                   s_f_oggContinuedPage = false;
+    bool                   s_f_oggLastPage = false;
+    bool                   s_f_parseOggDone = true;
+    bool                   s_f_lastSegmentTable = false;
+    bool                   s_f_vorbisStr_found = false;
+    uint16_t               s_identificatonHeaderLength = 0;
+    uint16_t               s_vorbisCommentHeaderLength = 0;
+    uint16_t               s_setupHeaderLength = 0;
+    uint8_t                s_pageNr = 0;
+    uint16_t               s_oggHeaderSize = 0;
+    uint8_t                s_vorbisChannels = 0;
+    uint16_t               s_vorbisSamplerate = 0;
+    uint16_t               s_lastSegmentTableLen = 0;
+    uint8_t*               s_lastSegmentTable = NULL;
+    uint32_t               s_vorbisBitRate = 0;
+    uint32_t               s_vorbisSegmentLength = 0;
+    uint32_t               s_vorbisBlockPicLenUntilFrameEnd = 0;
+    uint32_t               s_vorbisCurrentFilePos = 0;
+    uint32_t               s_vorbisAudioDataStart = 0;
+    char*                  s_vorbisChbuf = NULL;
+    int32_t                s_vorbisValidSamples = 0;
+    int32_t                s_commentBlockSegmentSize = 0;
+    uint8_t                s_vorbisOldMode = 0;
+    uint32_t               s_blocksizes[2] = {};
+    uint32_t               s_vorbisBlockPicPos = 0;
+    uint32_t               s_vorbisBlockPicLen = 0;
+    int32_t                s_vorbisRemainBlockPicLen = 0;
+    int32_t                s_commentLength = 0;
+
+    uint8_t                s_nrOfCodebooks = 0;
+    uint8_t                s_nrOfFloors = 0;
+    uint8_t                s_nrOfResidues = 0;
+    uint8_t                s_nrOfMaps = 0;
+    uint8_t                s_nrOfModes = 0;
+
+    uint16_t*              s_vorbisSegmentTable = NULL;
+    uint16_t               s_oggPage3Len = 0; // length of the current audio segment
+    uint8_t                s_vorbisSegmentTableSize = 0;
+    int16_t                s_vorbisSegmentTableRdPtr = -1;
+    int8_t                 s_vorbisError = 0;
+    float                  s_vorbisCompressionRatio = 0;
+
+    bitReader_t            s_bitReader;
+
+    codebook_t*            s_codebooks = NULL;
+    vorbis_info_floor_t**  s_floor_param = NULL;
+    int8_t*                s_floor_type = NULL;
+    vorbis_info_residue_t* s_residue_param = NULL;
+    vorbis_info_mapping_t* s_map_param = NULL;
+    vorbis_info_mode_t*    s_mode_param = NULL;
+    vorbis_dsp_state_t*    s_dsp_state = NULL;
+
+    vector<uint32_t>       s_vorbisBlockPicItem;
+
+    size_t                 s_memInUse = 0;      // bytes held through vorbis_alloc()
+    size_t                 s_memPeak = 0;       // high-water mark since the stream started
+    uint32_t               s_setupStart = 0;    // micros() at the identification header
+    uint32_t               s_setupTime = 0;     // µs until the decoder was ready
+};
+
+static VORBISDecoder_t s_vorbisDefault;                      // used by tasks that never call VORBISDecoder_SetContext()
+static thread_local VORBISDecoder_t* s_vorbis = &s_vorbisDefault;
 
 
+VORBISDecoder_t* VORBISDecoder_CreateContext(){
+    void* mem = AudioMemory::alloc(sizeof(VORBISDecoder_t), AUDIO_MEM_INTERNAL_PREFERRED);
+    if(!mem) return NULL;
+    return new (mem) VORBISDecoder_t();
+}
+void VORBISDecoder_DestroyContext(VORBISDecoder_t* ctx){
+    if(!ctx || ctx == &s_vorbisDefault) return;
+    VORBISDecoder_t* prev = s_vorbis;
+    s_vorbis = ctx;
+    VORBISDecoder_FreeBuffers();
+    VORBISsetDefaults(); // releases the dsp state
+    s_vorbis = (prev == ctx) ? &s_vorbisDefault : prev;
+    ctx->~VORBISDecoder_t();
+    AudioMemory::release(ctx);
+}
+void VORBISDecoder_SetContext(VORBISDecoder_t* ctx){
+    s_vorbis = ctx ? ctx : &s_vorbisDefault;
+}
+VORBISDecoder_t* VORBISDecoder_GetContext(){
+    return s_vorbis;
+}
+// all decoder buffers go through these, so the peak of each stream can be reported
+void* vorbis_alloc(size_t size){
+    void* ptr = AudioMemory::alloc(size, AUDIO_MEM_PSRAM_PREFERRED);
+    if(ptr){
+        s_vorbis->s_memInUse += AudioMemory::sizeOf(ptr);
+        if(s_vorbis->s_memInUse > s_vorbis->s_memPeak) s_vorbis->s_memPeak = s_vorbis->s_memInUse;
+    }
+    return ptr;
+}
+void* vorbis_calloc(size_t count, size_t size){
+    void* ptr = AudioMemory::calloc(count, size, AUDIO_MEM_PSRAM_PREFERRED);
+    if(ptr){
+        s_vorbis->s_memInUse += AudioMemory::sizeOf(ptr);
+        if(s_vorbis->s_memInUse > s_vorbis->s_memPeak) s_vorbis->s_memPeak = s_vorbis->s_memInUse;
+    }
+    return ptr;
+}
+void vorbis_free(void* ptr){
+    if(!ptr) return;
+    size_t size = AudioMemory::sizeOf(ptr);
+    s_vorbis->s_memInUse -= (size < s_vorbis->s_memInUse ? size : s_vorbis->s_memInUse);
+    AudioMemory::release(ptr);
+}
 bool VORBISDecoder_AllocateBuffers(){
-    s_vorbisSegmentTable = (uint16_t*)__calloc_heap_psram(256, sizeof(uint16_t));
-    s_vorbisChbuf = (char*)__calloc_heap_psram(256, sizeof(char));
-    s_lastSegmentTable = (uint8_t*)__malloc_heap_psram(4096);
+    s_vorbis->s_vorbisSegmentTable = (uint16_t*)__calloc_heap_psram(256, sizeof(uint16_t));
+    s_vorbis->s_vorbisChbuf = (char*)__calloc_heap_psram(256, sizeof(char));
+    s_vorbis->s_lastSegmentTable = (uint8_t*)__malloc_heap_psram(4096);
     VORBISsetDefaults();
     return true;
 }
 void VORBISDecoder_FreeBuffers(){
-    if(s_vorbisSegmentTable) {free(s_vorbisSegmentTable); s_vorbisSegmentTable = NULL;}
-    if(s_vorbisChbuf){free(s_vorbisChbuf); s_vorbisChbuf = NULL;}
-    if(s_lastSegmentTable){free(s_lastSegmentTable); s_lastSegmentTable = NULL;}
+    if(s_vorbis->s_vorbisSegmentTable) {vorbis_free(s_vorbis->s_vorbisSegmentTable); s_vorbis->s_vorbisSegmentTable = NULL;}
+    if(s_vorbis->s_vorbisChbuf){vorbis_free(s_vorbis->s_vorbisChbuf); s_vorbis->s_vorbisChbuf = NULL;}
+    if(s_vorbis->s_lastSegmentTable){vorbis_free(s_vorbis->s_lastSegmentTable); s_vorbis->s_lastSegmentTable = NULL;}
 
     clearGlobalConfigurations();
 }
 void VORBISDecoder_ClearBuffers(){
-    if(s_vorbisChbuf) memset(s_vorbisChbuf, 0, 256);
+    if(s_vorbis->s_vorbisChbuf) memset(s_vorbis->s_vorbisChbuf, 0, 256);
     bitReader_clear();
-    if(s_lastSegmentTable) memset(s_lastSegmentTable, 0, 4096);
-    if(s_vorbisSegmentTable) memset(s_vorbisSegmentTable, 0, 256);
-    s_vorbisSegmentTableSize = 0;
-    s_vorbisSegmentTableRdPtr = -1;}
+    if(s_vorbis->s_lastSegmentTable) memset(s_vorbis->s_lastSegmentTable, 0, 4096);
+    if(s_vorbis->s_vorbisSegmentTable) memset(s_vorbis->s_vorbisSegmentTable, 0, 256);
+    s_vorbis->s_vorbisSegmentTableSize = 0;
+    s_vorbis->s_vorbisSegmentTableRdPtr = -1;}
 void VORBISsetDefaults(){
-    s_pageNr = 0;
-    s_f_vorbisNewSteamTitle = false;  // streamTitle
-    s_f_vorbisNewMetadataBlockPicture = false;
-    s_f_lastSegmentTable = false;
-    s_f_parseOggDone = false;
-    s_f_oggFirstPage = false;
-    s_f_oggContinuedPage = false;
-    s_f_oggLastPage = false;
-    s_f_vorbisStr_found = false;
-    if(s_dsp_state){vorbis_dsp_destroy(s_dsp_state); s_dsp_state = NULL;}
-    s_vorbisChannels = 0;
-    s_vorbisSamplerate = 0;
-    s_vorbisBitRate = 0;
-    s_vorbisSegmentLength = 0;
-    s_vorbisValidSamples = 0;
-    s_vorbisSegmentTableSize = 0;
-    s_vorbisCurrentFilePos = 0;
-    s_vorbisAudioDataStart = 0;
-    s_vorbisOldMode = 0xFF;
-    s_vorbisSegmentTableRdPtr = -1;
-    s_vorbisError = 0;
-    s_lastSegmentTableLen = 0;
-    s_vorbisBlockPicPos = 0;
-    s_vorbisBlockPicLen = 0;
-    s_vorbisBlockPicLenUntilFrameEnd = 0;
-    s_commentBlockSegmentSize = 0;
-    s_vorbisBlockPicItem.clear();
-    s_vorbisBlockPicItem.shrink_to_fit();
+    s_vorbis->s_pageNr = 0;
+    s_vorbis->s_f_vorbisNewSteamTitle = false;  // streamTitle
+    s_vorbis->s_f_vorbisNewMetadataBlockPicture = false;
+    s_vorbis->s_f_lastSegmentTable = false;
+    s_vorbis->s_f_parseOggDone = false;
+    s_vorbis->s_f_oggFirstPage = false;
+    s_vorbis->s_f_oggContinuedPage = false;
+    s_vorbis->s_f_oggLastPage = false;
+    s_vorbis->s_f_vorbisStr_found = false;
+    if(s_vorbis->s_dsp_state){vorbis_dsp_destroy(s_vorbis->s_dsp_state); s_vorbis->s_dsp_state = NULL;}
+    s_vorbis->s_vorbisChannels = 0;
+    s_vorbis->s_vorbisSamplerate = 0;
+    s_vorbis->s_vorbisBitRate = 0;
+    s_vorbis->s_vorbisSegmentLength = 0;
+    s_vorbis->s_vorbisValidSamples = 0;
+    s_vorbis->s_vorbisSegmentTableSize = 0;
+    s_vorbis->s_vorbisCurrentFilePos = 0;
+    s_vorbis->s_vorbisAudioDataStart = 0;
+    s_vorbis->s_vorbisOldMode = 0xFF;
+    s_vorbis->s_vorbisSegmentTableRdPtr = -1;
+    s_vorbis->s_vorbisError = 0;
+    s_vorbis->s_lastSegmentTableLen = 0;
+    s_vorbis->s_vorbisBlockPicPos = 0;
+    s_vorbis->s_vorbisBlockPicLen = 0;
+    s_vorbis->s_vorbisBlockPicLenUntilFrameEnd = 0;
+    s_vorbis->s_commentBlockSegmentSize = 0;
+    s_vorbis->s_vorbisBlockPicItem.clear();
+    s_vorbis->s_vorbisBlockPicItem.shrink_to_fit();
 
     VORBISDecoder_ClearBuffers();
 }
 
 void clearGlobalConfigurations() { // mode, mapping, floor etc
-    if(s_nrOfCodebooks) {  // if we have a stream with changing codebooks, delete the old one
-        for(int32_t i = 0; i < s_nrOfCodebooks; i++) { vorbis_book_clear(s_codebooks + i); }
-        s_nrOfCodebooks = 0;
+    if(s_vorbis->s_nrOfCodebooks) {  // if we have a stream with changing codebooks, delete the old one
+        for(int32_t i = 0; i < s_vorbis->s_nrOfCodebooks; i++) { vorbis_book_clear(s_vorbis->s_codebooks + i); }
+        s_vorbis->s_nrOfCodebooks = 0;
     }
-    if(s_codebooks) {
-        free(s_codebooks);
-        s_codebooks = NULL;
+    if(s_vorbis->s_codebooks) {
+        vorbis_free(s_vorbis->s_codebooks);
+        s_vorbis->s_codebooks = NULL;
     }
-    if(s_dsp_state) {
-        vorbis_dsp_destroy(s_dsp_state);
-        s_dsp_state = NULL;
+    if(s_vorbis->s_dsp_state) {
+        vorbis_dsp_destroy(s_vorbis->s_dsp_state);
+        s_vorbis->s_dsp_state = NULL;
     }
-    if(s_nrOfFloors) {
-        for(int32_t i = 0; i < s_nrOfFloors; i++) floor_free_info(s_floor_param[i]);
-        free(s_floor_param);
-        s_nrOfFloors = 0;
+    if(s_vorbis->s_nrOfFloors) {
+        for(int32_t i = 0; i < s_vorbis->s_nrOfFloors; i++) floor_free_info(s_vorbis->s_floor_param[i]);
+        vorbis_free(s_vorbis->s_floor_param);
+        s_vorbis->s_nrOfFloors = 0;
     }
-    if(s_nrOfResidues) {
-        for(int32_t i = 0; i < s_nrOfResidues; i++) res_clear_info(s_residue_param + i);
-        s_nrOfResidues = 0;
+    if(s_vorbis->s_nrOfResidues) {
+        for(int32_t i = 0; i < s_vorbis->s_nrOfResidues; i++) res_clear_info(s_vorbis->s_residue_param + i);
+        s_vorbis->s_nrOfResidues = 0;
     }
-    if(s_nrOfMaps) {
-        for(int32_t i = 0; i < s_nrOfMaps; i++) { mapping_clear_info(s_map_param + i); }
-        s_nrOfMaps = 0;
+    if(s_vorbis->s_nrOfMaps) {
+        for(int32_t i = 0; i < s_vorbis->s_nrOfMaps; i++) { mapping_clear_info(s_vorbis->s_map_param + i); }
+        s_vorbis->s_nrOfMaps = 0;
     }
-    if(s_floor_type) {
-        free(s_floor_type);
-        s_floor_type = NULL;
+    if(s_vorbis->s_floor_type) {
+        vorbis_free(s_vorbis->s_floor_type);
+        s_vorbis->s_floor_type = NULL;
     }
-    if(s_residue_param) {
-        free(s_residue_param);
-        s_residue_param = NULL;
+    if(s_vorbis->s_residue_param) {
+        vorbis_free(s_vorbis->s_residue_param);
+        s_vorbis->s_residue_param = NULL;
     }
-    if(s_map_param) {
-        free(s_map_param);
-        s_map_param = NULL;
+    if(s_vorbis->s_map_param) {
+        vorbis_free(s_vorbis->s_map_param);
+        s_vorbis->s_map_param = NULL;
     }
-    if(s_mode_param) {
-        free(s_mode_param);
-        s_mode_param = NULL;
+    if(s_vorbis->s_mode_param) {
+        vorbis_free(s_vorbis->s_mode_param);
+        s_vorbis->s_mode_param = NULL;
     }
 }
 
@@ -196,36 +252,36 @@ int32_t VORBISDecode(uint8_t* inbuf, int32_t* bytesLeft, int16_t* outbuf) {
     int32_t ret = 0;
     int32_t segmentLength = 0;
 
-    if(s_commentBlockSegmentSize) {
-        if(s_commentBlockSegmentSize > 8192) {
-            s_commentBlockSegmentSize -= 8192;
-            s_commentLength -= 8192;
+    if(s_vorbis->s_commentBlockSegmentSize) {
+        if(s_vorbis->s_commentBlockSegmentSize > 8192) {
+            s_vorbis->s_commentBlockSegmentSize -= 8192;
+            s_vorbis->s_commentLength -= 8192;
             *bytesLeft -= 8192;
-            s_vorbisCurrentFilePos += 8192;
+            s_vorbis->s_vorbisCurrentFilePos += 8192;
         }
         else {
-            *bytesLeft -= s_commentBlockSegmentSize;
-            s_vorbisCurrentFilePos += s_commentBlockSegmentSize;
-            s_commentLength -= s_commentBlockSegmentSize;
-            s_commentBlockSegmentSize = 0;
+            *bytesLeft -= s_vorbis->s_commentBlockSegmentSize;
+            s_vorbis->s_vorbisCurrentFilePos += s_vorbis->s_commentBlockSegmentSize;
+            s_vorbis->s_commentLength -= s_vorbis->s_commentBlockSegmentSize;
+            s_vorbis->s_commentBlockSegmentSize = 0;
         }
-        if(s_vorbisRemainBlockPicLen <= 0 && !s_f_vorbisNewMetadataBlockPicture) {
-            if(s_vorbisBlockPicItem.size() > 0) { // get blockpic data
+        if(s_vorbis->s_vorbisRemainBlockPicLen <= 0 && !s_vorbis->s_f_vorbisNewMetadataBlockPicture) {
+            if(s_vorbis->s_vorbisBlockPicItem.size() > 0) { // get blockpic data
                 // log_i("---------------------------------------------------------------------------");
                 // log_i("metadata blockpic found at pos %i, size %i bytes", s_vorbisBlockPicPos, s_vorbisBlockPicLen);
                 // for(int32_t i = 0; i < s_vorbisBlockPicItem.size(); i += 2) { log_i("segment %02i, pos %07i, len %05i", i / 2, s_vorbisBlockPicItem[i], s_vorbisBlockPicItem[i + 1]); }
                 // log_i("---------------------------------------------------------------------------");
-                s_f_vorbisNewMetadataBlockPicture = true;
+                s_vorbis->s_f_vorbisNewMetadataBlockPicture = true;
             }
         }
         return VORBIS_PARSE_OGG_DONE;
     }
 
-    if(!s_vorbisSegmentTableSize) {
-        s_vorbisSegmentTableRdPtr = -1; // back to the parking position
+    if(!s_vorbis->s_vorbisSegmentTableSize) {
+        s_vorbis->s_vorbisSegmentTableRdPtr = -1; // back to the parking position
         ret = VORBISparseOGG(inbuf, bytesLeft);
-        s_f_parseOggDone = true;
-        if(!s_vorbisSegmentTableSize) { log_w("OggS without segments?"); }
+        s_vorbis->s_f_parseOggDone = true;
+        if(!s_vorbis->s_vorbisSegmentTableSize) { log_w("OggS without segments?"); }
         return ret;
     }
 
@@ -233,18 +289,18 @@ int32_t VORBISDecode(uint8_t* inbuf, int32_t* bytesLeft, int16_t* outbuf) {
     // So the last segment is saved. s_lastSegmentTableLen specifies the size of the last saved segment.
     // If the next Ogg Page does not contain a 'continuedPage', the last segment is played first. However,
     // if 'continuedPage' is set, the first segment of the new page is added to the saved segment and played.
-    if(!s_lastSegmentTableLen){
-        if(s_vorbisSegmentTableSize) {
-            s_vorbisSegmentTableRdPtr++;
-            s_vorbisSegmentTableSize--;
-            segmentLength = s_vorbisSegmentTable[s_vorbisSegmentTableRdPtr];
+    if(!s_vorbis->s_lastSegmentTableLen){
+        if(s_vorbis->s_vorbisSegmentTableSize) {
+            s_vorbis->s_vorbisSegmentTableRdPtr++;
+            s_vorbis->s_vorbisSegmentTableSize--;
+            segmentLength = s_vorbis->s_vorbisSegmentTable[s_vorbis->s_vorbisSegmentTableRdPtr];
         }
     }
 
-    if(s_pageNr < 4)
-        if(VORBIS_specialIndexOf(inbuf, "vorbis", 10) == 1) s_pageNr++;
+    if(s_vorbis->s_pageNr < 4)
+        if(VORBIS_specialIndexOf(inbuf, "vorbis", 10) == 1) s_vorbis->s_pageNr++;
 
-    switch(s_pageNr) {
+    switch(s_vorbis->s_pageNr) {
         case 0:
             ret = VORBIS_PARSE_OGG_DONE; // do nothing
             break;
@@ -260,7 +316,7 @@ int32_t VORBISDecode(uint8_t* inbuf, int32_t* bytesLeft, int16_t* outbuf) {
         case 4:
             ret = vorbisDecodePage4(inbuf, bytesLeft, segmentLength, outbuf); // decode audio
             break;
-        default: log_e("unknown page %s", s_pageNr); break;
+        default: log_e("unknown page %s", s_vorbis->s_pageNr); break;
     }
     return ret;
 }
@@ -268,10 +324,13 @@ int32_t VORBISDecode(uint8_t* inbuf, int32_t* bytesLeft, int16_t* outbuf) {
 int32_t vorbisDecodePage1(uint8_t* inbuf, int32_t* bytesLeft, uint32_t segmentLength){
     int32_t ret = VORBIS_PARSE_OGG_DONE;
     clearGlobalConfigurations(); // if a new codebook is required, delete the old one
+    s_vorbis->s_setupStart = micros();
+    s_vorbis->s_setupTime = 0;
+    s_vorbis->s_memPeak = s_vorbis->s_memInUse;
     int32_t idx = VORBIS_specialIndexOf(inbuf, "vorbis", 10);
     if(idx == 1) {
         // log_i("first packet (identification segmentLength) %i", segmentLength);
-        s_identificatonHeaderLength = segmentLength;
+        s_vorbis->s_identificatonHeaderLength = segmentLength;
         ret = parseVorbisFirstPacket(inbuf, segmentLength);
     }
     else {
@@ -279,7 +338,7 @@ int32_t vorbisDecodePage1(uint8_t* inbuf, int32_t* bytesLeft, uint32_t segmentLe
     }
 
     *bytesLeft -= segmentLength;
-    s_vorbisCurrentFilePos += segmentLength;
+    s_vorbis->s_vorbisCurrentFilePos += segmentLength;
     return ret;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -287,28 +346,28 @@ int32_t vorbisDecodePage2(uint8_t* inbuf, int32_t* bytesLeft, uint32_t segmentLe
     int32_t ret = VORBIS_PARSE_OGG_DONE;
     int32_t idx = VORBIS_specialIndexOf(inbuf, "vorbis", 10);
     if(idx == 1) {
-        s_vorbisBlockPicItem.clear();
-        s_vorbisBlockPicItem.shrink_to_fit();
-        s_f_vorbisStr_found = true;
-        s_vorbisCommentHeaderLength = segmentLength;
+        s_vorbis->s_vorbisBlockPicItem.clear();
+        s_vorbis->s_vorbisBlockPicItem.shrink_to_fit();
+        s_vorbis->s_f_vorbisStr_found = true;
+        s_vorbis->s_vorbisCommentHeaderLength = segmentLength;
         ret = parseVorbisComment(inbuf, segmentLength);
-        s_commentBlockSegmentSize = segmentLength;
-         int32_t pLen = _min((int32_t)s_vorbisBlockPicLen, s_vorbisBlockPicLenUntilFrameEnd);
-        if(s_vorbisBlockPicLen && pLen > 0){
-            s_vorbisBlockPicItem.push_back(s_vorbisBlockPicPos);
-            s_vorbisBlockPicItem.push_back(pLen);
+        s_vorbis->s_commentBlockSegmentSize = segmentLength;
+         int32_t pLen = _min((int32_t)s_vorbis->s_vorbisBlockPicLen, s_vorbis->s_vorbisBlockPicLenUntilFrameEnd);
+        if(s_vorbis->s_vorbisBlockPicLen && pLen > 0){
+            s_vorbis->s_vorbisBlockPicItem.push_back(s_vorbis->s_vorbisBlockPicPos);
+            s_vorbis->s_vorbisBlockPicItem.push_back(pLen);
         }
-        s_vorbisRemainBlockPicLen = s_vorbisBlockPicLen - pLen;
+        s_vorbis->s_vorbisRemainBlockPicLen = s_vorbis->s_vorbisBlockPicLen - pLen;
         ret = VORBIS_PARSE_OGG_DONE;
     }
     else {
-        s_commentBlockSegmentSize = segmentLength;
-        uint32_t pLen = min(s_vorbisRemainBlockPicLen, (int32_t)segmentLength);
-        if(s_vorbisRemainBlockPicLen && pLen > 0){
-            s_vorbisBlockPicItem.push_back(s_vorbisCurrentFilePos);
-            s_vorbisBlockPicItem.push_back(pLen);
+        s_vorbis->s_commentBlockSegmentSize = segmentLength;
+        uint32_t pLen = min(s_vorbis->s_vorbisRemainBlockPicLen, (int32_t)segmentLength);
+        if(s_vorbis->s_vorbisRemainBlockPicLen && pLen > 0){
+            s_vorbis->s_vorbisBlockPicItem.push_back(s_vorbis->s_vorbisCurrentFilePos);
+            s_vorbis->s_vorbisBlockPicItem.push_back(pLen);
         }
-        s_vorbisRemainBlockPicLen -= segmentLength;
+        s_vorbis->s_vorbisRemainBlockPicLen -= segmentLength;
         ret = VORBIS_PARSE_OGG_DONE;
     }
     return ret;
@@ -317,109 +376,115 @@ int32_t vorbisDecodePage2(uint8_t* inbuf, int32_t* bytesLeft, uint32_t segmentLe
 int32_t vorbisDecodePage3(uint8_t* inbuf, int32_t* bytesLeft, uint32_t segmentLength){
     int32_t ret = VORBIS_PARSE_OGG_DONE;
     int32_t idx = VORBIS_specialIndexOf(inbuf, "vorbis", 10);
-    s_oggPage3Len = segmentLength;
+    s_vorbis->s_oggPage3Len = segmentLength;
     if(idx == 1) {
         // log_i("third packet (setup segmentLength) %i", segmentLength);
-        s_setupHeaderLength = segmentLength;
+        s_vorbis->s_setupHeaderLength = segmentLength;
         bitReader_setData(inbuf, segmentLength);
         if(segmentLength == 4080) {
             // that is 16*255 bytes and thus the maximum segment size
             // it is possible that there is another block starting with 'OggS' in which there is information
             // about codebooks. It is possible that there is another block starting with 'OggS' in which
             // there is information about codebooks.
-            int32_t l = continuedOggPackets(inbuf + s_oggPage3Len);
+            int32_t l = continuedOggPackets(inbuf + s_vorbis->s_oggPage3Len);
             *bytesLeft -= l;
-            s_vorbisCurrentFilePos += l;
-            s_oggPage3Len += l;
-            s_setupHeaderLength += l;
-            bitReader_setData(inbuf, s_oggPage3Len);
-            log_w("s_oggPage3Len %i", s_oggPage3Len);
-            s_pageNr++;
+            s_vorbis->s_vorbisCurrentFilePos += l;
+            s_vorbis->s_oggPage3Len += l;
+            s_vorbis->s_setupHeaderLength += l;
+            bitReader_setData(inbuf, s_vorbis->s_oggPage3Len);
+            log_w("s_oggPage3Len %i", s_vorbis->s_oggPage3Len);
+            s_vorbis->s_pageNr++;
         }
         ret = parseVorbisCodebook();
     }
     else { log_e("no \"vorbis\" something went wrong %i", segmentLength); }
-    s_pageNr = 4;
-    s_dsp_state = vorbis_dsp_create();
+    s_vorbis->s_pageNr = 4;
+    if(ret == VORBIS_PARSE_OGG_DONE) s_vorbis->s_dsp_state = vorbis_dsp_create(); // sized from the setup just parsed
+    if(s_vorbis->s_dsp_state) {
+        s_vorbis->s_setupTime = micros() - s_vorbis->s_setupStart;
+        log_i("setup %lu us, %i codebooks, peak memory %lu bytes", (long unsigned int)s_vorbis->s_setupTime, s_vorbis->s_nrOfCodebooks,
+              (long unsigned int)s_vorbis->s_memPeak);
+    }
 
     *bytesLeft -= segmentLength;
-    s_vorbisCurrentFilePos += segmentLength;
+    s_vorbis->s_vorbisCurrentFilePos += segmentLength;
     return ret;
 }
 //------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 int32_t vorbisDecodePage4(uint8_t* inbuf, int32_t* bytesLeft, uint32_t segmentLength, int16_t* outbuf){
 
-    if(s_vorbisAudioDataStart == 0){
-        s_vorbisAudioDataStart = s_vorbisCurrentFilePos;
+    if(s_vorbis->s_vorbisAudioDataStart == 0){
+        s_vorbis->s_vorbisAudioDataStart = s_vorbis->s_vorbisCurrentFilePos;
     }
+    if(!s_vorbis->s_dsp_state) return ERR_VORBIS_BAD_HEADER; // setup failed or out of memory
 
     int32_t ret = 0;
-    if(s_f_parseOggDone) { // first loop after VORBISparseOGG()
-        if(s_f_oggContinuedPage) {
-            if(s_lastSegmentTableLen > 0 || segmentLength > 0) {
-                if(s_lastSegmentTableLen + segmentLength > 1024) log_e("continued page too big");
-                memcpy(s_lastSegmentTable + s_lastSegmentTableLen, inbuf, segmentLength);
-                bitReader_setData(s_lastSegmentTable, s_lastSegmentTableLen + segmentLength);
-                ret = vorbis_dsp_synthesis(s_lastSegmentTable, s_lastSegmentTableLen + segmentLength, outbuf);
+    if(s_vorbis->s_f_parseOggDone) { // first loop after VORBISparseOGG()
+        if(s_vorbis->s_f_oggContinuedPage) {
+            if(s_vorbis->s_lastSegmentTableLen > 0 || segmentLength > 0) {
+                if(s_vorbis->s_lastSegmentTableLen + segmentLength > 1024) log_e("continued page too big");
+                memcpy(s_vorbis->s_lastSegmentTable + s_vorbis->s_lastSegmentTableLen, inbuf, segmentLength);
+                bitReader_setData(s_vorbis->s_lastSegmentTable, s_vorbis->s_lastSegmentTableLen + segmentLength);
+                ret = vorbis_dsp_synthesis(s_vorbis->s_lastSegmentTable, s_vorbis->s_lastSegmentTableLen + segmentLength, outbuf);
                 uint16_t outBuffSize = 2048 * 2;
-                s_vorbisValidSamples = vorbis_dsp_pcmout(outbuf, outBuffSize);
-                s_lastSegmentTableLen = 0;
+                s_vorbis->s_vorbisValidSamples = vorbis_dsp_pcmout(outbuf, outBuffSize);
+                s_vorbis->s_lastSegmentTableLen = 0;
                 if(!ret && !segmentLength) ret = VORBIS_CONTINUE;
             }
             else { // s_lastSegmentTableLen is 0 and segmentLength is 0
-                s_vorbisValidSamples = 0;
+                s_vorbis->s_vorbisValidSamples = 0;
                 ret = VORBIS_CONTINUE;
             }
-            s_f_oggContinuedPage = false;
+            s_vorbis->s_f_oggContinuedPage = false;
         }
         else { // last segment without continued Page
-            if(s_lastSegmentTableLen) {
-                bitReader_setData(s_lastSegmentTable, s_lastSegmentTableLen);
-                ret = vorbis_dsp_synthesis(s_lastSegmentTable, s_lastSegmentTableLen, outbuf);
+            if(s_vorbis->s_lastSegmentTableLen) {
+                bitReader_setData(s_vorbis->s_lastSegmentTable, s_vorbis->s_lastSegmentTableLen);
+                ret = vorbis_dsp_synthesis(s_vorbis->s_lastSegmentTable, s_vorbis->s_lastSegmentTableLen, outbuf);
                 uint16_t outBuffSize = 2048 * 2;
-                s_vorbisValidSamples = vorbis_dsp_pcmout(outbuf, outBuffSize);
-                s_lastSegmentTableLen = 0;
+                s_vorbis->s_vorbisValidSamples = vorbis_dsp_pcmout(outbuf, outBuffSize);
+                s_vorbis->s_lastSegmentTableLen = 0;
                 if(ret == OV_ENOTAUDIO || ret == 0) ret = VORBIS_CONTINUE; // if no error send continue
             }
             else {
                 bitReader_setData(inbuf, segmentLength);
                 ret = vorbis_dsp_synthesis(inbuf, segmentLength, outbuf);
                 uint16_t outBuffSize = 2048 * 2;
-                s_vorbisValidSamples = vorbis_dsp_pcmout(outbuf, outBuffSize);
+                s_vorbis->s_vorbisValidSamples = vorbis_dsp_pcmout(outbuf, outBuffSize);
                 ret = 0;
             }
         }
     }
     else { // not s_f_parseOggDone
-        if(s_vorbisSegmentTableSize || s_f_lastSegmentTable) {
+        if(s_vorbis->s_vorbisSegmentTableSize || s_vorbis->s_f_lastSegmentTable) {
             // if(s_f_oggLastPage) log_i("last page");
             bitReader_setData(inbuf, segmentLength);
             ret = vorbis_dsp_synthesis(inbuf, segmentLength, outbuf);
             uint16_t outBuffSize = 2048 * 2;
-            s_vorbisValidSamples = vorbis_dsp_pcmout(outbuf, outBuffSize);
+            s_vorbis->s_vorbisValidSamples = vorbis_dsp_pcmout(outbuf, outBuffSize);
             ret = 0;
         }
         else { // last segment
             if(segmentLength) {
-                memcpy(s_lastSegmentTable, inbuf, segmentLength);
-                s_lastSegmentTableLen = segmentLength;
-                s_vorbisValidSamples = 0;
+                memcpy(s_vorbis->s_lastSegmentTable, inbuf, segmentLength);
+                s_vorbis->s_lastSegmentTableLen = segmentLength;
+                s_vorbis->s_vorbisValidSamples = 0;
                 ret = 0;
             }
             else {
-                s_lastSegmentTableLen = 0;
-                s_vorbisValidSamples = 0;
+                s_vorbis->s_lastSegmentTableLen = 0;
+                s_vorbis->s_vorbisValidSamples = 0;
                 ret = VORBIS_PARSE_OGG_DONE;
             }
         }
-        s_f_oggFirstPage = false;
+        s_vorbis->s_f_oggFirstPage = false;
     }
-    s_f_parseOggDone = false;
-    if(s_f_oggLastPage && !s_vorbisSegmentTableSize) { VORBISsetDefaults(); }
+    s_vorbis->s_f_parseOggDone = false;
+    if(s_vorbis->s_f_oggLastPage && !s_vorbis->s_vorbisSegmentTableSize) { VORBISsetDefaults(); }
 
     if(ret != VORBIS_CONTINUE){ // nothing to do here, is playing from lastSegmentBuff
         *bytesLeft -= segmentLength;
-        s_vorbisCurrentFilePos += segmentLength;
+        s_vorbis->s_vorbisCurrentFilePos += segmentLength;
     }
     return ret;
 }
@@ -427,40 +492,46 @@ int32_t vorbisDecodePage4(uint8_t* inbuf, int32_t* bytesLeft, uint32_t segmentLe
 //----------------------------------------------------------------------------------------------------------------------
 
 uint8_t VORBISGetChannels(){
-    return s_vorbisChannels;
+    return s_vorbis->s_vorbisChannels;
 }
 uint32_t VORBISGetSampRate(){
-    return s_vorbisSamplerate;
+    return s_vorbis->s_vorbisSamplerate;
 }
 uint8_t VORBISGetBitsPerSample(){
     return 16;
 }
 uint32_t VORBISGetBitRate(){
-    return s_vorbisBitRate;
+    return s_vorbis->s_vorbisBitRate;
 }
 uint32_t VORBISGetAudioDataStart(){
-    return s_vorbisAudioDataStart;
+    return s_vorbis->s_vorbisAudioDataStart;
 }
 uint16_t VORBISGetOutputSamps(){
-    return s_vorbisValidSamples; // 1024
+    return s_vorbis->s_vorbisValidSamples; // 1024
+}
+uint32_t VORBISGetSetupTime(){
+    return s_vorbis->s_setupTime;
+}
+uint32_t VORBISGetPeakMemory(){
+    return s_vorbis->s_memPeak;
 }
 char* VORBISgetStreamTitle(){
-    if(s_f_vorbisNewSteamTitle){
-        s_f_vorbisNewSteamTitle = false;
-        return s_vorbisChbuf;
+    if(s_vorbis->s_f_vorbisNewSteamTitle){
+        s_vorbis->s_f_vorbisNewSteamTitle = false;
+        return s_vorbis->s_vorbisChbuf;
     }
     return NULL;
 }
 vector<uint32_t> VORBISgetMetadataBlockPicture(){
-    if(s_f_vorbisNewMetadataBlockPicture){
-        s_f_vorbisNewMetadataBlockPicture = false;
-        return s_vorbisBlockPicItem;
+    if(s_vorbis->s_f_vorbisNewMetadataBlockPicture){
+        s_vorbis->s_f_vorbisNewMetadataBlockPicture = false;
+        return s_vorbis->s_vorbisBlockPicItem;
     }
-    if(s_vorbisBlockPicItem.size() > 0){
-        s_vorbisBlockPicItem.clear();
-        s_vorbisBlockPicItem.shrink_to_fit();
+    if(s_vorbis->s_vorbisBlockPicItem.size() > 0){
+        s_vorbis->s_vorbisBlockPicItem.clear();
+        s_vorbis->s_vorbisBlockPicItem.shrink_to_fit();
     }
-    return s_vorbisBlockPicItem;
+    return s_vorbis->s_vorbisBlockPicItem;
 }
 //----------------------------------------------------------------------------------------------------------------------
 int32_t parseVorbisFirstPacket(uint8_t *inbuf, int16_t nBytes){ // 4.2.2. Identification header
@@ -496,18 +567,18 @@ int32_t parseVorbisFirstPacket(uint8_t *inbuf, int16_t nBytes){ // 4.2.2. Identi
 
     uint8_t  blocksize   = *(inbuf + pos + 21);
 
-    s_blocksizes[0] = 1 << ( blocksize & 0x0F);
-    s_blocksizes[1] = 1 << ((blocksize & 0xF0) >> 4);
+    s_vorbis->s_blocksizes[0] = 1 << ( blocksize & 0x0F);
+    s_vorbis->s_blocksizes[1] = 1 << ((blocksize & 0xF0) >> 4);
 
-    if(s_blocksizes[0] < 64){
+    if(s_vorbis->s_blocksizes[0] < 64){
         log_e("blocksize[0] too low");
         return -1;
     }
-    if(s_blocksizes[1] < s_blocksizes[0]){
+    if(s_vorbis->s_blocksizes[1] < s_vorbis->s_blocksizes[0]){
         log_e("s_blocksizes[1] is smaller than s_blocksizes[0]");
         return -1;
     }
-    if(s_blocksizes[1] > 8192){
+    if(s_vorbis->s_blocksizes[1] > 8192){
         log_e("s_blocksizes[1] is too big");
         return -1;
     }
@@ -516,15 +587,15 @@ int32_t parseVorbisFirstPacket(uint8_t *inbuf, int16_t nBytes){ // 4.2.2. Identi
         log_e("nr of channels is not valid ch=%i", channels);
         return -1;
     }
-    s_vorbisChannels = channels;
+    s_vorbis->s_vorbisChannels = channels;
 
     if(sampleRate < 4096 || sampleRate > 64000){
         log_e("sampleRate is not valid sr=%i", sampleRate);
         return -1;
     }
-    s_vorbisSamplerate = sampleRate;
+    s_vorbis->s_vorbisSamplerate = sampleRate;
 
-    s_vorbisBitRate = br_nominal;
+    s_vorbis->s_vorbisBitRate = br_nominal;
 
     return VORBIS_PARSE_OGG_DONE;
 
@@ -544,10 +615,10 @@ int32_t parseVorbisComment(uint8_t *inbuf, int16_t nBytes){      // reference ht
        return 0;
     }
 
-    memcpy(s_vorbisChbuf, inbuf + 11, vendorLength);
-    s_vorbisChbuf[vendorLength] = '\0';
+    memcpy(s_vorbis->s_vorbisChbuf, inbuf + 11, vendorLength);
+    s_vorbis->s_vorbisChbuf[vendorLength] = '\0';
     pos += 4 + vendorLength;
-    s_vorbisCommentHeaderLength -= (7 + 4 + vendorLength);
+    s_vorbis->s_vorbisCommentHeaderLength -= (7 + 4 + vendorLength);
 
     // log_i("vendorLength %x", vendorLength);
     // log_i("vendorString %s", s_vorbisChbuf);
@@ -555,7 +626,7 @@ int32_t parseVorbisComment(uint8_t *inbuf, int16_t nBytes){      // reference ht
     uint8_t nrOfComments = *(inbuf + pos);
     // log_i("nrOfComments %i", nrOfComments);
     pos += 4;
-    s_vorbisCommentHeaderLength -= 4;
+    s_vorbis->s_vorbisCommentHeaderLength -= 4;
 
     int32_t idx = 0;
     char* artist = NULL;
@@ -567,65 +638,65 @@ int32_t parseVorbisComment(uint8_t *inbuf, int16_t nBytes){      // reference ht
         commentLength += *(inbuf + pos + 2) << 16;
         commentLength += *(inbuf + pos + 1) << 8;
         commentLength += *(inbuf + pos);
-        s_commentLength = commentLength;
+        s_vorbis->s_commentLength = commentLength;
 
         uint8_t cl = min((uint32_t)254, commentLength);
-        memcpy(s_vorbisChbuf, inbuf + pos +  4, cl);
-        s_vorbisChbuf[cl] = '\0';
+        memcpy(s_vorbis->s_vorbisChbuf, inbuf + pos +  4, cl);
+        s_vorbis->s_vorbisChbuf[cl] = '\0';
 
         // log_i("commentLength %i comment %s", commentLength, s_vorbisChbuf);
 
-        idx =        VORBIS_specialIndexOf((uint8_t*)s_vorbisChbuf, "artist=", 10);
-        if(idx != 0) idx =  VORBIS_specialIndexOf((uint8_t*)s_vorbisChbuf, "ARTIST=", 10);
-        if(idx == 0){ artist = strndup((const char*)(s_vorbisChbuf + 7), commentLength - 7); s_commentLength = 0;}
+        idx =        VORBIS_specialIndexOf((uint8_t*)s_vorbis->s_vorbisChbuf, "artist=", 10);
+        if(idx != 0) idx =  VORBIS_specialIndexOf((uint8_t*)s_vorbis->s_vorbisChbuf, "ARTIST=", 10);
+        if(idx == 0){ artist = strndup((const char*)(s_vorbis->s_vorbisChbuf + 7), commentLength - 7); s_vorbis->s_commentLength = 0;}
 
-        idx =        VORBIS_specialIndexOf((uint8_t*)s_vorbisChbuf, "title=", 10);
-        if(idx != 0) idx =  VORBIS_specialIndexOf((uint8_t*)s_vorbisChbuf, "TITLE=", 10);
-        if(idx == 0){ title = strndup((const char*)(s_vorbisChbuf + 6), commentLength - 6); s_commentLength = 0;}
+        idx =        VORBIS_specialIndexOf((uint8_t*)s_vorbis->s_vorbisChbuf, "title=", 10);
+        if(idx != 0) idx =  VORBIS_specialIndexOf((uint8_t*)s_vorbis->s_vorbisChbuf, "TITLE=", 10);
+        if(idx == 0){ title = strndup((const char*)(s_vorbis->s_vorbisChbuf + 6), commentLength - 6); s_vorbis->s_commentLength = 0;}
 
-        idx =        VORBIS_specialIndexOf((uint8_t*)s_vorbisChbuf, "metadata_block_picture=", 25);
-        if(idx != 0) idx =  VORBIS_specialIndexOf((uint8_t*)s_vorbisChbuf, "METADATA_BLOCK_PICTURE", 25);
+        idx =        VORBIS_specialIndexOf((uint8_t*)s_vorbis->s_vorbisChbuf, "metadata_block_picture=", 25);
+        if(idx != 0) idx =  VORBIS_specialIndexOf((uint8_t*)s_vorbis->s_vorbisChbuf, "METADATA_BLOCK_PICTURE", 25);
         if(idx == 0){
-            s_vorbisBlockPicLen = commentLength - 23;
-            s_vorbisBlockPicPos += s_vorbisCurrentFilePos + 4 +pos + 23;
-            s_vorbisBlockPicLenUntilFrameEnd = s_vorbisCommentHeaderLength - 4 - 23;
+            s_vorbis->s_vorbisBlockPicLen = commentLength - 23;
+            s_vorbis->s_vorbisBlockPicPos += s_vorbis->s_vorbisCurrentFilePos + 4 +pos + 23;
+            s_vorbis->s_vorbisBlockPicLenUntilFrameEnd = s_vorbis->s_vorbisCommentHeaderLength - 4 - 23;
         }
         pos += commentLength + 4;
-        s_vorbisCommentHeaderLength -= (4 + commentLength);
+        s_vorbis->s_vorbisCommentHeaderLength -= (4 + commentLength);
     }
     if(artist && title){
-        strcpy(s_vorbisChbuf, artist);
-        strcat(s_vorbisChbuf, " - ");
-        strcat(s_vorbisChbuf, title);
-        s_f_vorbisNewSteamTitle = true;
+        strcpy(s_vorbis->s_vorbisChbuf, artist);
+        strcat(s_vorbis->s_vorbisChbuf, " - ");
+        strcat(s_vorbis->s_vorbisChbuf, title);
+        s_vorbis->s_f_vorbisNewSteamTitle = true;
     }
     else if(artist){
-        strcpy(s_vorbisChbuf, artist);
-        s_f_vorbisNewSteamTitle = true;
+        strcpy(s_vorbis->s_vorbisChbuf, artist);
+        s_vorbis->s_f_vorbisNewSteamTitle = true;
     }
     else if(title){
-        strcpy(s_vorbisChbuf, title);
-        s_f_vorbisNewSteamTitle = true;
+        strcpy(s_vorbis->s_vorbisChbuf, title);
+        s_vorbis->s_f_vorbisNewSteamTitle = true;
     }
-    if(artist){free(artist); artist = NULL;}
-    if(title) {free(title);  title = NULL;}
+    if(artist){AudioMemory::release(artist); artist = NULL;}
+    if(title) {AudioMemory::release(title);  title = NULL;}
 
     return VORBIS_PARSE_OGG_DONE;
 }
 //----------------------------------------------------------------------------------------------------------------------
 int32_t parseVorbisCodebook(){
 
-    s_bitReader.headptr += 7;
-    s_bitReader.length = s_oggPage3Len;
+    s_vorbis->s_bitReader.headptr += 7;
+    s_vorbis->s_bitReader.length = s_vorbis->s_oggPage3Len;
 
     int32_t i;
     int32_t ret = 0;
 
-    s_nrOfCodebooks = bitReader(8) +1;
-    s_codebooks = (codebook_t*) __calloc_heap_psram(s_nrOfCodebooks, sizeof(*s_codebooks));
+    s_vorbis->s_nrOfCodebooks = bitReader(8) +1;
+    s_vorbis->s_codebooks = (codebook_t*) __calloc_heap_psram(s_vorbis->s_nrOfCodebooks, sizeof(*s_vorbis->s_codebooks));
 
-    for(i = 0; i < s_nrOfCodebooks; i++){
-        ret = vorbis_book_unpack(s_codebooks + i);
+    for(i = 0; i < s_vorbis->s_nrOfCodebooks; i++){
+        ret = vorbis_book_unpack(s_vorbis->s_codebooks + i);
         if(ret) log_e("codebook %i returned err", i);
         if(ret) goto err_out;
     }
@@ -640,58 +711,58 @@ int32_t parseVorbisCodebook(){
         }
     }
     /* floor backend settings */
-    s_nrOfFloors  = bitReader(6) + 1;
+    s_vorbis->s_nrOfFloors  = bitReader(6) + 1;
 
-    s_floor_param = (vorbis_info_floor_t **)__malloc_heap_psram(sizeof(*s_floor_param) * s_nrOfFloors);
-    s_floor_type  = (int8_t *)__malloc_heap_psram(sizeof(int8_t) * s_nrOfFloors);
-    for(i = 0; i < s_nrOfFloors; i++) {
-        s_floor_type[i] = bitReader(16);
-        if(s_floor_type[i] < 0 || s_floor_type[i] >= VI_FLOORB) {
+    s_vorbis->s_floor_param = (vorbis_info_floor_t **)__calloc_heap_psram(s_vorbis->s_nrOfFloors, sizeof(*s_vorbis->s_floor_param));
+    s_vorbis->s_floor_type  = (int8_t *)__malloc_heap_psram(sizeof(int8_t) * s_vorbis->s_nrOfFloors);
+    for(i = 0; i < s_vorbis->s_nrOfFloors; i++) {
+        s_vorbis->s_floor_type[i] = bitReader(16);
+        if(s_vorbis->s_floor_type[i] < 0 || s_vorbis->s_floor_type[i] >= VI_FLOORB) {
             log_e("err while reading floors");
             goto err_out;
         }
-        if(s_floor_type[i]){
-            s_floor_param[i] = floor1_info_unpack();
+        if(s_vorbis->s_floor_type[i]){
+            s_vorbis->s_floor_param[i] = floor1_info_unpack();
         }
         else{
-            s_floor_param[i] = floor0_info_unpack();
+            s_vorbis->s_floor_param[i] = floor0_info_unpack();
         }
-        if(!s_floor_param[i]){
+        if(!s_vorbis->s_floor_param[i]){
             log_e("floor parameter not found");
             goto err_out;
         }
     }
 
     /* residue backend settings */
-    s_nrOfResidues = bitReader(6) + 1;
-    s_residue_param = (vorbis_info_residue_t *)__malloc_heap_psram(sizeof(*s_residue_param) * s_nrOfResidues);
-    for(i = 0; i < s_nrOfResidues; i++){
-         if(res_unpack(s_residue_param + i)){
+    s_vorbis->s_nrOfResidues = bitReader(6) + 1;
+    s_vorbis->s_residue_param = (vorbis_info_residue_t *)__malloc_heap_psram(sizeof(*s_vorbis->s_residue_param) * s_vorbis->s_nrOfResidues);
+    for(i = 0; i < s_vorbis->s_nrOfResidues; i++){
+         if(res_unpack(s_vorbis->s_residue_param + i)){
             log_e("err while unpacking residues");
             goto err_out;
          }
     }
 
     // /* map backend settings */
-    s_nrOfMaps = bitReader(6) + 1;
-    s_map_param = (vorbis_info_mapping_t *)__malloc_heap_psram(sizeof(*s_map_param) * s_nrOfMaps);
-    for(i = 0; i < s_nrOfMaps; i++) {
+    s_vorbis->s_nrOfMaps = bitReader(6) + 1;
+    s_vorbis->s_map_param = (vorbis_info_mapping_t *)__malloc_heap_psram(sizeof(*s_vorbis->s_map_param) * s_vorbis->s_nrOfMaps);
+    for(i = 0; i < s_vorbis->s_nrOfMaps; i++) {
         if(bitReader(16) != 0) goto err_out;
-        if(mapping_info_unpack(s_map_param + i)){
+        if(mapping_info_unpack(s_vorbis->s_map_param + i)){
             log_e("err while unpacking mappings");
             goto err_out;
         }
     }
 
     /* mode settings */
-    s_nrOfModes = bitReader(6) + 1;
-    s_mode_param = (vorbis_info_mode_t *)__malloc_heap_psram(s_nrOfModes* sizeof(*s_mode_param));
-    for(i = 0; i < s_nrOfModes; i++) {
-        s_mode_param[i].blockflag = bitReader(1);
+    s_vorbis->s_nrOfModes = bitReader(6) + 1;
+    s_vorbis->s_mode_param = (vorbis_info_mode_t *)__malloc_heap_psram(s_vorbis->s_nrOfModes* sizeof(*s_vorbis->s_mode_param));
+    for(i = 0; i < s_vorbis->s_nrOfModes; i++) {
+        s_vorbis->s_mode_param[i].blockflag = bitReader(1);
         if(bitReader(16)) goto err_out;
         if(bitReader(16)) goto err_out;
-        s_mode_param[i].mapping = bitReader(8);
-        if(s_mode_param[i].mapping >= s_nrOfMaps){
+        s_vorbis->s_mode_param[i].mapping = bitReader(8);
+        if(s_vorbis->s_mode_param[i].mapping >= s_vorbis->s_nrOfMaps){
             log_e("too many modes");
             goto err_out;
         }
@@ -711,7 +782,7 @@ int32_t parseVorbisCodebook(){
 
 err_out:
 //    vorbis_info_clear(vi);
-    log_e("err in codebook!  at pos %d", s_bitReader.headptr - s_bitReader.data);
+    log_e("err in codebook!  at pos %d", s_vorbis->s_bitReader.headptr - s_vorbis->s_bitReader.data);
     return (OV_EBADHEADER);
 }
 //----------------------------------------------------------------------------------------------------------------------
@@ -721,10 +792,10 @@ int32_t VORBISparseOGG(uint8_t *inbuf, int32_t *bytesLeft){
 
     int32_t idx = VORBIS_specialIndexOf(inbuf, "OggS", 8192);
     if(idx != 0){
-        if(s_f_oggContinuedPage) return ERR_VORBIS_DECODER_ASYNC;
+        if(s_vorbis->s_f_oggContinuedPage) return ERR_VORBIS_DECODER_ASYNC;
         inbuf += idx;
         *bytesLeft -= idx;
-        s_vorbisCurrentFilePos += idx;
+        s_vorbis->s_vorbisCurrentFilePos += idx;
     }
 
     int16_t segmentTableWrPtr = -1;
@@ -755,7 +826,7 @@ int32_t VORBISparseOGG(uint8_t *inbuf, int32_t *bytesLeft){
 
     // read the segment table (contains pageSegments bytes),  1...251: Length of the frame in bytes,
     // 255: A second byte is needed.  The total length is first_byte + second byte
-    s_vorbisSegmentLength = 0;
+    s_vorbis->s_vorbisSegmentLength = 0;
     segmentTableWrPtr = -1;
 
     for(int32_t i = 0; i < pageSegments; i++){
@@ -766,11 +837,11 @@ int32_t VORBISparseOGG(uint8_t *inbuf, int32_t *bytesLeft){
             n+= *(inbuf + 27 + i);
         }
         segmentTableWrPtr++;
-        s_vorbisSegmentTable[segmentTableWrPtr] = n;
-        s_vorbisSegmentLength += n;
+        s_vorbis->s_vorbisSegmentTable[segmentTableWrPtr] = n;
+        s_vorbis->s_vorbisSegmentLength += n;
     }
-    s_vorbisSegmentTableSize = segmentTableWrPtr + 1;
-    s_vorbisCompressionRatio = (float)(960 * 2 * pageSegments)/s_vorbisSegmentLength;  // const 960 validBytes out
+    s_vorbis->s_vorbisSegmentTableSize = segmentTableWrPtr + 1;
+    s_vorbis->s_vorbisCompressionRatio = (float)(960 * 2 * pageSegments)/s_vorbis->s_vorbisSegmentLength;  // const 960 validBytes out
 
     bool     continuedPage = headerType & 0x01; // set: page contains data of a packet continued from the previous page
     bool     firstPage     = headerType & 0x02; // set: this is the first page of a logical bitstream (bos)
@@ -785,15 +856,15 @@ int32_t VORBISparseOGG(uint8_t *inbuf, int32_t *bytesLeft){
 
     *bytesLeft -= headerSize;
     inbuf += headerSize;
-    s_vorbisCurrentFilePos += headerSize;
+    s_vorbis->s_vorbisCurrentFilePos += headerSize;
  //   if(s_pageNr < 4 && !continuedPage) s_pageNr++;
 
-    s_f_oggFirstPage = firstPage;
-    s_f_oggContinuedPage = continuedPage;
-    s_f_oggLastPage = lastPage;
-    s_oggHeaderSize = headerSize;
+    s_vorbis->s_f_oggFirstPage = firstPage;
+    s_vorbis->s_f_oggContinuedPage = continuedPage;
+    s_vorbis->s_f_oggLastPage = lastPage;
+    s_vorbis->s_oggHeaderSize = headerSize;
 
-    if(firstPage) s_pageNr = 0;
+    if(firstPage) s_vorbis->s_pageNr = 0;
 
     return VORBIS_PARSE_OGG_DONE; // no error
 }
@@ -944,10 +1015,6 @@ int32_t vorbis_book_unpack(codebook_t *s) {
             s->dec_nodeb = _determine_node_bytes(s->used_entries, _ilog(s->entries) / 8 + 1);
             s->dec_leafw = _determine_leaf_words(s->dec_nodeb, _ilog(s->entries) / 8 + 1);
             s->dec_type = 0;
-            ret = _make_decode_table(s, lengthlist, quantvals, maptype);
-            if(ret != 0) {
-                 goto _errout;
-            }
             break;
 
         case 1:
@@ -963,25 +1030,15 @@ int32_t vorbis_book_unpack(codebook_t *s) {
 
                 if(total1 <= 4 && total1 <= total2) {
                     /* use dec_type 1: vector of packed values */
-                    /* need quantized values before  */
+                    /* need quantized values before, vorbis_book_expand() releases them once they are packed */
                     s->q_val = __malloc_heap_psram(sizeof(uint16_t) * quantvals);
                     for(i = 0; i < quantvals; i++) ((uint16_t *)s->q_val)[i] = bitReader(s->q_bits);
 
-                    if(oggpack_eop()) {
-                        if(s->q_val) {free(s->q_val), s->q_val = NULL;}
-                        goto _eofout;
-                    }
+                    if(oggpack_eop()) goto _eofout;
 
                     s->dec_type = 1;
                     s->dec_nodeb = _determine_node_bytes(s->used_entries, (s->q_bits * s->dim + 8) / 8);
                     s->dec_leafw = _determine_leaf_words(s->dec_nodeb, (s->q_bits * s->dim + 8) / 8);
-                    ret = _make_decode_table(s, lengthlist, quantvals, maptype);
-                    if(ret) {
-                        if(s->q_val) {free(s->q_val), s->q_val = NULL;}
-                        goto _errout;
-                    }
-
-                    if(s->q_val) {free(s->q_val), s->q_val = NULL;} /* about to go out of scope; _make_decode_table was using it */
                 }
                 else {
                     /* use dec_type 2: packed vector of column offsets */
@@ -1001,11 +1058,6 @@ int32_t vorbis_book_unpack(codebook_t *s) {
                     s->dec_type = 2;
                     s->dec_nodeb = _determine_node_bytes(s->used_entries, (_ilog(quantvals - 1) * s->dim + 8) / 8);
                     s->dec_leafw = _determine_leaf_words(s->dec_nodeb, (_ilog(quantvals - 1) * s->dim + 8) / 8);
-
-                    ret = _make_decode_table(s, lengthlist, quantvals, maptype);
-                    if(ret){
-                        goto _errout;
-                    }
                 }
             }
             break;
@@ -1020,6 +1072,7 @@ int32_t vorbis_book_unpack(codebook_t *s) {
                 s->dec_type = 1;
                 s->dec_nodeb = _determine_node_bytes(s->used_entries, (s->q_bits * s->dim + 8) / 8);
                 s->dec_leafw = _determine_leaf_words(s->dec_nodeb, (s->q_bits * s->dim + 8) / 8);
+                /* the values are read from the packet while the table is built, so this one cannot wait */
                 if(_make_decode_table(s, lengthlist, quantvals, maptype)) goto _errout;
             }
             else {
@@ -1028,7 +1081,6 @@ int32_t vorbis_book_unpack(codebook_t *s) {
                 s->dec_type = 3;
                 s->dec_nodeb = _determine_node_bytes(s->used_entries, _ilog(s->used_entries - 1) / 8 + 1);
                 s->dec_leafw = _determine_leaf_words(s->dec_nodeb, _ilog(s->used_entries - 1) / 8 + 1);
-                if(_make_decode_table(s, lengthlist, quantvals, maptype)) goto _errout;
 
                 /* get the vals & pack them */
                 s->q_pack = (s->q_bits + 7) / 8 * s->dim;
@@ -1049,17 +1101,44 @@ int32_t vorbis_book_unpack(codebook_t *s) {
             goto _errout;
     }
     if(oggpack_eop()) goto _eofout;
-    if(lengthlist) {free(lengthlist); lengthlist = NULL;}
-    if(s->q_val)   {free(s->q_val), s->q_val = NULL;}
+
+    s->quantvals = quantvals;
+    s->maptype = maptype;
+    if(!s->dec_table) { /* the table needs nothing more from the packet */
+        s->lengthlist = lengthlist;
+        lengthlist = NULL;
+#ifndef VORBIS_LOW_MEMORY
+        if(vorbis_book_expand(s)) goto _errout;
+#endif
+    }
+    if(lengthlist) {vorbis_free(lengthlist); lengthlist = NULL;}
     return 0; // ok
 _errout:
 _eofout:
     vorbis_book_clear(s);
-    if(lengthlist) {free(lengthlist); lengthlist = NULL;}
-    if(s->q_val)   {free(s->q_val), s->q_val = NULL;}
+    if(lengthlist) {vorbis_free(lengthlist); lengthlist = NULL;}
     return -1; // error
 }
 //---------------------------------------------------------------------------------------------------------------------
+/* build the decode table from the length list kept by vorbis_book_unpack(). With VORBIS_LOW_MEMORY this runs on the
+ first read from the book, so books a stream never uses are never expanded */
+int32_t vorbis_book_expand(codebook_t *b) {
+    if(b->dec_table) return 0;
+    if(!b->lengthlist) return -1; /* expanded before and failed */
+
+    int32_t ret = _make_decode_table(b, b->lengthlist, b->quantvals, b->maptype);
+    vorbis_free(b->lengthlist);
+    b->lengthlist = NULL;
+    if(b->dec_type == 1 && b->q_val) {vorbis_free(b->q_val); b->q_val = NULL;} /* lattice values are in the table now */
+    if(ret) {
+        log_e("codebook expansion failed");
+        vorbis_free(b->dec_table);
+        b->dec_table = NULL;
+        return -1;
+    }
+    return 0;
+}
+//---------------------------------------------------------------------------------------------------------------------
 
 //----------------------------------------------------------------------------------------------------------------------
 int32_t VORBIS_specialIndexOf(uint8_t* base, const char* str, int32_t baselen, bool exact){
@@ -1079,7 +1158,7 @@ int32_t VORBIS_specialIndexOf(uint8_t* base, const char* str, int32_t baselen, b
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-const uint32_t mask[] = {0x00000000, 0x00000001, 0x00000003, 0x00000007, 0x0000000f, 0x0000001f, 0x0000003f,
+VORBIS_HOT const uint32_t mask[] = {0x00000000, 0x00000001, 0x00000003, 0x00000007, 0x0000000f, 0x0000001f, 0x0000003f,
                          0x0000007f, 0x000000ff, 0x000001ff, 0x000003ff, 0x000007ff, 0x00000fff, 0x00001fff,
                          0x00003fff, 0x00007fff, 0x0000ffff, 0x0001ffff, 0x0003ffff, 0x0007ffff, 0x000fffff,
                          0x001fffff, 0x003fffff, 0x007fffff, 0x00ffffff, 0x01ffffff, 0x03ffffff, 0x07ffffff,
@@ -1087,19 +1166,19 @@ const uint32_t mask[] = {0x00000000, 0x00000001, 0x00000003, 0x00000007, 0x00000
 
 
 void bitReader_clear(){
-    s_bitReader.data = NULL;
-    s_bitReader.headptr = NULL;
-    s_bitReader.length = 0;
-    s_bitReader.headend = 0;
-    s_bitReader.headbit = 0;
+    s_vorbis->s_bitReader.data = NULL;
+    s_vorbis->s_bitReader.headptr = NULL;
+    s_vorbis->s_bitReader.length = 0;
+    s_vorbis->s_bitReader.headend = 0;
+    s_vorbis->s_bitReader.headbit = 0;
 }
 
 void bitReader_setData(uint8_t *buff, uint16_t buffSize){
-    s_bitReader.data = buff;
-    s_bitReader.headptr = buff;
-    s_bitReader.length = buffSize;
-    s_bitReader.headend = buffSize * 8;
-    s_bitReader.headbit = 0;
+    s_vorbis->s_bitReader.data = buff;
+    s_vorbis->s_bitReader.headptr = buff;
+    s_vorbis->s_bitReader.length = buffSize;
+    s_vorbis->s_bitReader.headend = buffSize * 8;
+    s_vorbis->s_bitReader.headbit = 0;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -1108,20 +1187,20 @@ int32_t bitReader_look(uint16_t nBits){
     uint32_t m = mask[nBits];
     int32_t  ret = 0;
 
-    nBits += s_bitReader.headbit;
+    nBits += s_vorbis->s_bitReader.headbit;
 
-    if(nBits >= s_bitReader.headend << 3) {
-        uint8_t       *ptr = s_bitReader.headptr;
+    if(nBits >= s_vorbis->s_bitReader.headend << 3) {
+        uint8_t       *ptr = s_vorbis->s_bitReader.headptr;
         if(nBits) {
-            ret = *ptr++ >> s_bitReader.headbit;
+            ret = *ptr++ >> s_vorbis->s_bitReader.headbit;
             if(nBits > 8) {
-                ret |= *ptr++ << (8 - s_bitReader.headbit);
+                ret |= *ptr++ << (8 - s_vorbis->s_bitReader.headbit);
                 if(nBits > 16) {
-                    ret |= *ptr++ << (16 - s_bitReader.headbit);
+                    ret |= *ptr++ << (16 - s_vorbis->s_bitReader.headbit);
                     if(nBits > 24) {
-                         ret |= *ptr++ << (24 - s_bitReader.headbit);
-                        if(nBits > 32 && s_bitReader.headbit) {
-                            ret |= *ptr << (32 - s_bitReader.headbit);
+                         ret |= *ptr++ << (24 - s_vorbis->s_bitReader.headbit);
+                        if(nBits > 32 && s_vorbis->s_bitReader.headbit) {
+                            ret |= *ptr << (32 - s_vorbis->s_bitReader.headbit);
                         }
                     }
                 }
@@ -1130,14 +1209,14 @@ int32_t bitReader_look(uint16_t nBits){
     }
     else {
         /* make this a switch jump-table */
-        ret = s_bitReader.headptr[0] >> s_bitReader.headbit;
+        ret = s_vorbis->s_bitReader.headptr[0] >> s_vorbis->s_bitReader.headbit;
         if(nBits > 8) {
-            ret |= s_bitReader.headptr[1] << (8 - s_bitReader.headbit);
+            ret |= s_vorbis->s_bitReader.headptr[1] << (8 - s_vorbis->s_bitReader.headbit);
             if(nBits > 16) {
-                ret |= s_bitReader.headptr[2] << (16 - s_bitReader.headbit);
+                ret |= s_vorbis->s_bitReader.headptr[2] << (16 - s_vorbis->s_bitReader.headbit);
                 if(nBits > 24) {
-                    ret |= s_bitReader.headptr[3] << (24 - s_bitReader.headbit);
-                    if(nBits > 32 && s_bitReader.headbit) ret |= s_bitReader.headptr[4] << (32 - s_bitReader.headbit);
+                    ret |= s_vorbis->s_bitReader.headptr[3] << (24 - s_vorbis->s_bitReader.headbit);
+                    if(nBits > 32 && s_vorbis->s_bitReader.headbit) ret |= s_vorbis->s_bitReader.headptr[4] << (32 - s_vorbis->s_bitReader.headbit);
                 }
             }
         }
@@ -1156,11 +1235,11 @@ int32_t bitReader(uint16_t nBits) {
 
 /* limited to 32 at a time */
 int8_t bitReader_adv(uint16_t nBits) {
-    nBits += s_bitReader.headbit;
-    s_bitReader.headbit = nBits & 7;
-    s_bitReader.headend -= (nBits >> 3);
-    s_bitReader.headptr += (nBits >> 3);
-    if(s_bitReader.headend < 1){
+    nBits += s_vorbis->s_bitReader.headbit;
+    s_vorbis->s_bitReader.headbit = nBits & 7;
+    s_vorbis->s_bitReader.headend -= (nBits >> 3);
+    s_vorbis->s_bitReader.headptr += (nBits >> 3);
+    if(s_vorbis->s_bitReader.headend < 1){
         return -1;
         log_e("error in bitreader");
     }
@@ -1228,19 +1307,21 @@ int32_t _make_decode_table(codebook_t *s, char *lengthlist, uint8_t quantvals, i
     if(s->dec_nodeb == 4) {
         s->dec_table = __malloc_heap_psram((s->used_entries * 2 + 1) * sizeof(*work));
         /* +1 (rather than -2) is to accommodate 0 and 1 sized books, which are specialcased to nodeb==4 */
+        if(!s->dec_table) return 1;
         if(_make_words(lengthlist, s->entries, (uint32_t *)s->dec_table, quantvals, s, maptype)) return 1;
 
         return 0;
     }
 
     work = (uint32_t *)__calloc_heap_psram((uint32_t)(s->used_entries * 2 - 2) , sizeof(*work));
-    if(!work) log_e("oom");
+    if(!work) {log_e("oom"); return 1;}
 
     if(_make_words(lengthlist, s->entries, work, quantvals, s, maptype)) {
-        if(work) {free(work); work = NULL;}
+        if(work) {vorbis_free(work); work = NULL;}
         return 1;
     }
     s->dec_table = __malloc_heap_psram((s->used_entries * (s->dec_leafw + 1) - 2) * s->dec_nodeb);
+    if(!s->dec_table) {vorbis_free(work); return 1;}
     if(s->dec_leafw == 1) {
         switch(s->dec_nodeb) {
             case 1:
@@ -1326,7 +1407,7 @@ int32_t _make_decode_table(codebook_t *s, char *lengthlist, uint8_t quantvals, i
             }
         }
     }
-    if(work) {free(work); work = NULL;}
+    if(work) {vorbis_free(work); work = NULL;}
     return 0;
 }
 //---------------------------------------------------------------------------------------------------------------------
@@ -1471,8 +1552,8 @@ uint8_t _book_maptype1_quantvals(codebook_t *b) {
 }
 //---------------------------------------------------------------------------------------------------------------------
 int32_t oggpack_eop() {
-    if(s_bitReader.headptr -s_bitReader.data  > s_setupHeaderLength){
-        log_i("s_bitReader.headptr %i, s_setupHeaderLength %i", s_bitReader.headptr, s_setupHeaderLength);
+    if(s_vorbis->s_bitReader.headptr -s_vorbis->s_bitReader.data  > s_vorbis->s_setupHeaderLength){
+        log_i("s_bitReader.headptr %i, s_setupHeaderLength %i", s_vorbis->s_bitReader.headptr, s_vorbis->s_setupHeaderLength);
         log_i("ogg package 3 overflow");
          return -1;
     }
@@ -1482,8 +1563,9 @@ int32_t oggpack_eop() {
 void vorbis_book_clear(codebook_t *b) {
     /* static book is not cleared; we're likely called on the lookup and the static codebook beint32_ts to the
    info struct */
-    if(b->q_val) free(b->q_val);
-    if(b->dec_table) free(b->dec_table);
+    if(b->q_val) vorbis_free(b->q_val);
+    if(b->dec_table) vorbis_free(b->dec_table);
+    if(b->lengthlist) vorbis_free(b->lengthlist);
 
     memset(b, 0, sizeof(*b));
 }
@@ -1492,7 +1574,7 @@ void vorbis_book_clear(codebook_t *b) {
 
     int32_t               j;
 
-    vorbis_info_floor_t *info = (vorbis_info_floor_t *)__malloc_heap_psram(sizeof(*info));
+    vorbis_info_floor_t *info = (vorbis_info_floor_t *)__calloc_heap_psram(1, sizeof(*info)); // floor_free_info() checks the floor 1 fields
     info->order =    bitReader( 8);
     info->rate =     bitReader(16);
     info->barkmap =  bitReader(16);
@@ -1506,7 +1588,7 @@ void vorbis_book_clear(codebook_t *b) {
 
     for(j = 0; j < info->numbooks; j++) {
         info->books[j] = bitReader(8);
-        if(info->books[j] >= s_nrOfCodebooks) goto err_out;
+        if(info->books[j] >= s_vorbis->s_nrOfCodebooks) goto err_out;
     }
 
     if(oggpack_eop()) goto err_out;
@@ -1542,10 +1624,10 @@ vorbis_info_floor_t* floor1_info_unpack() {
         else{
             info->_class[j].class_book = 0;
         }
-        if(info->_class[j].class_book >= s_nrOfCodebooks) goto err_out;
+        if(info->_class[j].class_book >= s_vorbis->s_nrOfCodebooks) goto err_out;
         for(k = 0; k < (1 << info->_class[j].class_subs); k++) {
             info->_class[j].class_subbook[k] = (uint8_t)bitReader(8) - 1;
-            if(info->_class[j].class_subbook[k] >= s_nrOfCodebooks && info->_class[j].class_subbook[k] != 0xff) goto err_out;
+            if(info->_class[j].class_subbook[k] >= s_vorbis->s_nrOfCodebooks && info->_class[j].class_subbook[k] != 0xff) goto err_out;
         }
     }
 
@@ -1618,7 +1700,7 @@ int32_t res_unpack(vorbis_info_residue_t *info){
     info->grouping =   bitReader(24) + 1;
     info->partitions = bitReader(6) + 1;
     info->groupbook =  bitReader(8);
-    if(info->groupbook >= s_nrOfCodebooks) goto errout;
+    if(info->groupbook >= s_vorbis->s_nrOfCodebooks) goto errout;
 
     info->stagemasks = (uint8_t *)__malloc_heap_psram(info->partitions * sizeof(*info->stagemasks));
     info->stagebooks = (uint8_t *)__malloc_heap_psram(info->partitions * 8 * sizeof(*info->stagebooks));
@@ -1633,7 +1715,7 @@ int32_t res_unpack(vorbis_info_residue_t *info){
         for(k = 0; k < 8; k++) {
             if((info->stagemasks[j] >> k) & 1) {
                 uint8_t book = bitReader(8);
-                if(book >= s_nrOfCodebooks) goto errout;
+                if(book >= s_vorbis->s_nrOfCodebooks) goto errout;
                 info->stagebooks[j * 8 + k] = book;
                 if(k + 1 > info->stages) info->stages = k + 1;
             }
@@ -1664,10 +1746,10 @@ int32_t mapping_info_unpack(vorbis_info_mapping_t *info) {
         info->coupling = (coupling_step_t *)__malloc_heap_psram(info->coupling_steps * sizeof(*info->coupling));
 
         for(i = 0; i < info->coupling_steps; i++) {
-            int32_t testM = info->coupling[i].mag = bitReader(ilog(s_vorbisChannels));
-            int32_t testA = info->coupling[i].ang = bitReader(ilog(s_vorbisChannels));
+            int32_t testM = info->coupling[i].mag = bitReader(ilog(s_vorbis->s_vorbisChannels));
+            int32_t testA = info->coupling[i].ang = bitReader(ilog(s_vorbis->s_vorbisChannels));
 
-            if(testM < 0 || testA < 0 || testM == testA || testM >= s_vorbisChannels || testA >= s_vorbisChannels) goto err_out;
+            if(testM < 0 || testA < 0 || testM == testA || testM >= s_vorbis->s_vorbisChannels || testA >= s_vorbis->s_vorbisChannels) goto err_out;
         }
     }
 
@@ -1675,8 +1757,8 @@ int32_t mapping_info_unpack(vorbis_info_mapping_t *info) {
     /* 2,3:reserved */
 
     if(info->submaps > 1) {
-        info->chmuxlist = (uint8_t *)__malloc_heap_psram(sizeof(*info->chmuxlist) * s_vorbisChannels);
-        for(i = 0; i < s_vorbisChannels; i++) {
+        info->chmuxlist = (uint8_t *)__malloc_heap_psram(sizeof(*info->chmuxlist) * s_vorbis->s_vorbisChannels);
+        for(i = 0; i < s_vorbis->s_vorbisChannels; i++) {
             info->chmuxlist[i] = bitReader(4);
             if(info->chmuxlist[i] >= info->submaps) goto err_out;
         }
@@ -1687,9 +1769,9 @@ int32_t mapping_info_unpack(vorbis_info_mapping_t *info) {
         int32_t temp = bitReader(8);
         (void)temp;
         info->submaplist[i].floor = bitReader(8);
-        if(info->submaplist[i].floor >= s_nrOfFloors) goto err_out;
+        if(info->submaplist[i].floor >= s_vorbis->s_nrOfFloors) goto err_out;
         info->submaplist[i].residue = bitReader(8);
-        if(info->submaplist[i].residue >= s_nrOfResidues) goto err_out;
+        if(info->submaplist[i].residue >= s_vorbis->s_nrOfResidues) goto err_out;
     }
 
     return 0;
@@ -1727,39 +1809,39 @@ void vorbis_mergesort(uint8_t *index, uint16_t *vals, uint16_t n) {
 
     if(B == index) {
         for(j = 0; j < n; j++) B[j] = A[j];
-        free(A);
+        vorbis_free(A);
     }
     else
-        free(B);
+        vorbis_free(B);
 }
 //---------------------------------------------------------------------------------------------------------------------
 void floor_free_info(vorbis_info_floor_t *i) {
     vorbis_info_floor_t *info = (vorbis_info_floor_t *)i;
     if(info) {
-        if(info->_class)         {free(info->_class);        }
-        if(info->partitionclass) {free(info->partitionclass);}
-        if(info->postlist)       {free(info->postlist);      }
-        if(info->forward_index)  {free(info->forward_index); }
-        if(info->hineighbor)     {free(info->hineighbor);    }
-        if(info->loneighbor)     {free(info->loneighbor);    }
+        if(info->_class)         {vorbis_free(info->_class);        }
+        if(info->partitionclass) {vorbis_free(info->partitionclass);}
+        if(info->postlist)       {vorbis_free(info->postlist);      }
+        if(info->forward_index)  {vorbis_free(info->forward_index); }
+        if(info->hineighbor)     {vorbis_free(info->hineighbor);    }
+        if(info->loneighbor)     {vorbis_free(info->loneighbor);    }
         memset(info, 0, sizeof(*info));
-        if(info) free(info);
+        if(info) vorbis_free(info);
     }
 }
 //---------------------------------------------------------------------------------------------------------------------
 void res_clear_info(vorbis_info_residue_t *info) {
     if(info) {
-        if(info->stagemasks) free(info->stagemasks);
-        if(info->stagebooks) free(info->stagebooks);
+        if(info->stagemasks) vorbis_free(info->stagemasks);
+        if(info->stagebooks) vorbis_free(info->stagebooks);
         memset(info, 0, sizeof(*info));
     }
 }
 //---------------------------------------------------------------------------------------------------------------------
 void mapping_clear_info(vorbis_info_mapping_t *info) {
     if(info) {
-        if(info->chmuxlist) free(info->chmuxlist);
-        if(info->submaplist) free(info->submaplist);
-        if(info->coupling) free(info->coupling);
+        if(info->chmuxlist) vorbis_free(info->chmuxlist);
+        if(info->submaplist) vorbis_free(info->submaplist);
+        if(info->coupling) vorbis_free(info->coupling);
         memset(info, 0, sizeof(*info));
     }
 }
@@ -1767,19 +1849,70 @@ void mapping_clear_info(vorbis_info_mapping_t *info) {
 //      ⏫⏫⏫    O G G      I M P L     A B O V E  ⏫⏫⏫
 //      ⏬⏬⏬ V O R B I S   I M P L     B E L O W  ⏬⏬⏬
 //---------------------------------------------------------------------------------------------------------------------
-vorbis_dsp_state_t *vorbis_dsp_create() {
-    int32_t i;
-
-    vorbis_dsp_state_t *v = (vorbis_dsp_state_t *)__calloc_heap_psram(1, sizeof(vorbis_dsp_state_t));
-
-    v->work = (int32_t **)__malloc_heap_psram(s_vorbisChannels * sizeof(*v->work));
-    v->mdctright = (int32_t **)__malloc_heap_psram(s_vorbisChannels* sizeof(*v->mdctright));
-
-    for(i = 0; i < s_vorbisChannels; i++) {
-        v->work[i] = (int32_t *)__calloc_heap_psram(1, (s_blocksizes[1] >> 1) * sizeof(*v->work[i]));
-        v->mdctright[i] = (int32_t *)__calloc_heap_psram(1, (s_blocksizes[1] >> 2) * sizeof(*v->mdctright[i]));
+/* largest per-packet work areas of the parsed setup: floor curves, one decoded vector, floor 0 LSP coefficients and
+ residue partition classes per channel. They replace stack buffers, the decode task has little stack to spare */
+uint32_t vorbis_scratch_size(uint16_t *memoStride, uint16_t *partStride, uint16_t *vecLen, uint16_t *lspLen) {
+    uint32_t memo = 0, part = 0, dim = 0, order = 0;
+    uint8_t  ch = s_vorbis->s_vorbisChannels;
+
+    for(int32_t i = 0; i < s_vorbis->s_nrOfFloors; i++) {
+        vorbis_info_floor_t *info = s_vorbis->s_floor_param[i];
+        uint32_t size = s_vorbis->s_floor_type[i] ? floor1_memosize(info) : floor0_memosize(info);
+        if(size > memo) memo = size;
+        if(!s_vorbis->s_floor_type[i] && info->order > order) order = info->order;
+    }
+    for(int32_t i = 0; i < s_vorbis->s_nrOfCodebooks; i++) {
+        if(s_vorbis->s_codebooks[i].dim > dim) dim = s_vorbis->s_codebooks[i].dim;
+    }
+    for(int32_t i = 0; i < s_vorbis->s_nrOfResidues; i++) {
+        vorbis_info_residue_t *info = s_vorbis->s_residue_param + i;
+        uint32_t max = s_vorbis->s_blocksizes[1] >> 1;
+        if(info->type == 2) max *= ch;
+        uint32_t end = (info->end < max ? info->end : max);
+        uint32_t ppw = s_vorbis->s_codebooks[info->groupbook].dim;
+        if(end <= info->begin || !ppw) continue;
+        uint32_t partvals = (end - info->begin) / info->grouping;
+        uint32_t words = (partvals + ppw - 1) / ppw * ppw;
+        if(words > part) part = words;
     }
 
+    *memoStride = memo;
+    *partStride = part;
+    *vecLen = dim;
+    *lspLen = order;
+    return (ch * memo + dim + order) * sizeof(int32_t) + ch * part;
+}
+//---------------------------------------------------------------------------------------------------------------------
+vorbis_dsp_state_t *vorbis_dsp_create() {
+    int32_t  i;
+    uint8_t  ch = s_vorbis->s_vorbisChannels;
+    uint32_t n = s_vorbis->s_blocksizes[1];
+    uint16_t vecLen = 0, lspLen = 0;
+    uint16_t memoStride = 0, partStride = 0;
+    uint32_t scratch = vorbis_scratch_size(&memoStride, &partStride, &vecLen, &lspLen);
+
+    /* one block: the state, the channel pointers, pcm work and overlap per channel, then the scratch */
+    uint32_t size = sizeof(vorbis_dsp_state_t) + 2 * ch * sizeof(int32_t *) + ch * ((n >> 1) + (n >> 2)) * sizeof(int32_t) + scratch;
+    uint8_t *p = (uint8_t *)__calloc_heap_psram(1, size);
+    if(!p) {
+        log_e("oom, dsp state needs %lu bytes", (long unsigned int)size);
+        return NULL;
+    }
+
+    vorbis_dsp_state_t *v = (vorbis_dsp_state_t *)p;  p += sizeof(*v);
+    v->work = (int32_t **)p;                          p += ch * sizeof(*v->work);
+    v->mdctright = (int32_t **)p;                     p += ch * sizeof(*v->mdctright);
+    for(i = 0; i < ch; i++) {
+        v->work[i] = (int32_t *)p;                    p += (n >> 1) * sizeof(*v->work[i]);
+        v->mdctright[i] = (int32_t *)p;               p += (n >> 2) * sizeof(*v->mdctright[i]);
+    }
+    v->floormemo = (int32_t *)p;                      p += ch * memoStride * sizeof(*v->floormemo);
+    v->vec = (int32_t *)p;                            p += vecLen * sizeof(*v->vec);
+    v->lsp = (int32_t *)p;                            p += lspLen * sizeof(*v->lsp);
+    v->partword = (char *)p;
+    v->memoStride = memoStride;
+    v->partStride = partStride;
+
     v->lW = 0; /* previous window size */
     v->W = 0;  /* current window size  */
 
@@ -1790,23 +1923,7 @@ vorbis_dsp_state_t *vorbis_dsp_create() {
 }
 //---------------------------------------------------------------------------------------------------------------------
 void vorbis_dsp_destroy(vorbis_dsp_state_t *v) {
-    int32_t i;
-    if(v) {
-        if(v->work) {
-            for(i = 0; i < s_vorbisChannels; i++) {
-                if(v->work[i]) {free(v->work[i]); v->work[i] = NULL;}
-            }
-            if(v->work){free(v->work); v->work = NULL;}
-        }
-        if(v->mdctright) {
-            for(i = 0; i < s_vorbisChannels; i++) {
-                if(v->mdctright[i]){free(v->mdctright[i]); v->mdctright[i] = NULL;}
-            }
-            if(v->mdctright){free(v->mdctright); v->mdctright = NULL;}
-        }
-        free(v);
-        v = NULL;
-    }
+    vorbis_free(v); // buffers and scratch are part of the same block
 }
 //---------------------------------------------------------------------------------------------------------------------
 int32_t vorbis_dsp_synthesis(uint8_t* inbuf, uint16_t len, int16_t* outbuf) {
@@ -1820,16 +1937,16 @@ int32_t vorbis_dsp_synthesis(uint8_t* inbuf, uint16_t len, int16_t* outbuf) {
     }
 
     /* read our mode and pre/post windowsize */
-    mode = bitReader(ilog(s_nrOfModes));
-    if(mode == -1 || mode >= s_nrOfModes) return OV_EBADPACKET;
+    mode = bitReader(ilog(s_vorbis->s_nrOfModes));
+    if(mode == -1 || mode >= s_vorbis->s_nrOfModes) return OV_EBADPACKET;
 
     /* shift information we still need from last window */
-    s_dsp_state->lW = s_dsp_state->W;
-    s_dsp_state->W = s_mode_param[mode].blockflag;
-    for(i = 0; i < s_vorbisChannels; i++){
-        mdct_shift_right(s_blocksizes[s_dsp_state->lW], s_dsp_state->work[i], s_dsp_state->mdctright[i]);
+    s_vorbis->s_dsp_state->lW = s_vorbis->s_dsp_state->W;
+    s_vorbis->s_dsp_state->W = s_vorbis->s_mode_param[mode].blockflag;
+    for(i = 0; i < s_vorbis->s_vorbisChannels; i++){
+        mdct_shift_right(s_vorbis->s_blocksizes[s_vorbis->s_dsp_state->lW], s_vorbis->s_dsp_state->work[i], s_vorbis->s_dsp_state->mdctright[i]);
     }
-    if(s_dsp_state->W) {
+    if(s_vorbis->s_dsp_state->W) {
         int32_t temp;
         bitReader(1);
         temp = bitReader(1);
@@ -1838,15 +1955,15 @@ int32_t vorbis_dsp_synthesis(uint8_t* inbuf, uint16_t len, int16_t* outbuf) {
 
     /* packet decode and portions of synthesis that rely on only this block */
     {
-        mapping_inverse(s_map_param + s_mode_param[mode].mapping);
+        mapping_inverse(s_vorbis->s_map_param + s_vorbis->s_mode_param[mode].mapping);
 
-        if(s_dsp_state->out_begin == -1) {
-            s_dsp_state->out_begin = 0;
-            s_dsp_state->out_end = 0;
+        if(s_vorbis->s_dsp_state->out_begin == -1) {
+            s_vorbis->s_dsp_state->out_begin = 0;
+            s_vorbis->s_dsp_state->out_end = 0;
         }
         else {
-            s_dsp_state->out_begin = 0;
-            s_dsp_state->out_end = s_blocksizes[s_dsp_state->lW] / 4 + s_blocksizes[s_dsp_state->W] / 4;
+            s_vorbis->s_dsp_state->out_begin = 0;
+            s_vorbis->s_dsp_state->out_end = s_vorbis->s_blocksizes[s_vorbis->s_dsp_state->lW] / 4 + s_vorbis->s_blocksizes[s_vorbis->s_dsp_state->W] / 4;
         }
     }
 
@@ -1864,37 +1981,36 @@ void mdct_shift_right(int32_t n, int32_t *in, int32_t *right) {
 int32_t mapping_inverse(vorbis_info_mapping_t *info) {
 
     int32_t     i, j;
-    int32_t n = s_blocksizes[s_dsp_state->W];
+    int32_t n = s_vorbis->s_blocksizes[s_vorbis->s_dsp_state->W];
 
-    int32_t **pcmbundle = (int32_t **)alloca(sizeof(*pcmbundle) * s_vorbisChannels);
-    int32_t      *zerobundle = (int32_t *)alloca(sizeof(*zerobundle) * s_vorbisChannels);
-    int32_t      *nonzero = (int32_t *)alloca(sizeof(*nonzero) * s_vorbisChannels);
-    int32_t **floormemo = (int32_t **)alloca(sizeof(*floormemo) * s_vorbisChannels);
+    int32_t **pcmbundle = (int32_t **)alloca(sizeof(*pcmbundle) * s_vorbis->s_vorbisChannels);
+    int32_t      *zerobundle = (int32_t *)alloca(sizeof(*zerobundle) * s_vorbis->s_vorbisChannels);
+    int32_t      *nonzero = (int32_t *)alloca(sizeof(*nonzero) * s_vorbis->s_vorbisChannels);
+    int32_t **floormemo = (int32_t **)alloca(sizeof(*floormemo) * s_vorbis->s_vorbisChannels);
 
     /* recover the spectral envelope; store it in the PCM vector for now */
-    for(i = 0; i < s_vorbisChannels; i++) {
+    for(i = 0; i < s_vorbis->s_vorbisChannels; i++) {
 
         int32_t submap = 0;
         int32_t floorno;
+        int32_t *memo = s_vorbis->s_dsp_state->floormemo + i * s_vorbis->s_dsp_state->memoStride;
 
         if(info->submaps > 1) submap = info->chmuxlist[i];
         floorno = info->submaplist[submap].floor;
 
-        if(s_floor_type[floorno]) {
+        if(s_vorbis->s_floor_type[floorno]) {
             /* floor 1 */
-            floormemo[i] = (int32_t *)alloca(sizeof(*floormemo[i]) * floor1_memosize(s_floor_param[floorno]));
-            floormemo[i] = floor1_inverse1(s_floor_param[floorno], floormemo[i]);
+            floormemo[i] = floor1_inverse1(s_vorbis->s_floor_param[floorno], memo);
         }
         else {
             /* floor 0 */
-            floormemo[i] = (int32_t *)alloca(sizeof(*floormemo[i]) * floor0_memosize(s_floor_param[floorno]));
-            floormemo[i] = floor0_inverse1(s_floor_param[floorno], floormemo[i]);
+            floormemo[i] = floor0_inverse1(s_vorbis->s_floor_param[floorno], memo);
         }
 
         if(floormemo[i]) nonzero[i] = 1;
         else
             nonzero[i] = 0;
-        memset(s_dsp_state->work[i], 0, sizeof(*s_dsp_state->work[i]) * n / 2);
+        memset(s_vorbis->s_dsp_state->work[i], 0, sizeof(*s_vorbis->s_dsp_state->work[i]) * n / 2);
     }
 
     /* channel coupling can 'dirty' the nonzero listing */
@@ -1908,16 +2024,16 @@ int32_t mapping_inverse(vorbis_info_mapping_t *info) {
     /* recover the residue into our working vectors */
     for(i = 0; i < info->submaps; i++) {
         uint8_t ch_in_bundle = 0;
-        for(j = 0; j < s_vorbisChannels; j++) {
+        for(j = 0; j < s_vorbis->s_vorbisChannels; j++) {
             if(!info->chmuxlist || info->chmuxlist[j] == i) {
                 if(nonzero[j]) zerobundle[ch_in_bundle] = 1;
                 else
                     zerobundle[ch_in_bundle] = 0;
-                pcmbundle[ch_in_bundle++] = s_dsp_state->work[j];
+                pcmbundle[ch_in_bundle++] = s_vorbis->s_dsp_state->work[j];
             }
         }
 
-        res_inverse(s_residue_param + info->submaplist[i].residue, pcmbundle, zerobundle, ch_in_bundle);
+        res_inverse(s_vorbis->s_residue_param + info->submaplist[i].residue, pcmbundle, zerobundle, ch_in_bundle);
     }
 
     // for(j=0;j<vi->channels;j++)
@@ -1925,8 +2041,8 @@ int32_t mapping_inverse(vorbis_info_mapping_t *info) {
 
     /* channel coupling */
     for(i = info->coupling_steps - 1; i >= 0; i--) {
-        int32_t *pcmM = s_dsp_state->work[info->coupling[i].mag];
-        int32_t *pcmA = s_dsp_state->work[info->coupling[i].ang];
+        int32_t *pcmM = s_vorbis->s_dsp_state->work[info->coupling[i].mag];
+        int32_t *pcmA = s_vorbis->s_dsp_state->work[info->coupling[i].ang];
 
         for(j = 0; j < n / 2; j++) {
             int32_t mag = pcmM[j];
@@ -1957,21 +2073,21 @@ int32_t mapping_inverse(vorbis_info_mapping_t *info) {
 
     /* compute and apply spectral envelope */
 
-    for(i = 0; i < s_vorbisChannels; i++) {
-        int32_t *pcm = s_dsp_state->work[i];
+    for(i = 0; i < s_vorbis->s_vorbisChannels; i++) {
+        int32_t *pcm = s_vorbis->s_dsp_state->work[i];
         int32_t      submap = 0;
         int32_t      floorno;
 
         if(info->submaps > 1) submap = info->chmuxlist[i];
         floorno = info->submaplist[submap].floor;
 
-        if(s_floor_type[floorno]) {
+        if(s_vorbis->s_floor_type[floorno]) {
             /* floor 1 */
-            floor1_inverse2(s_floor_param[floorno], floormemo[i], pcm);
+            floor1_inverse2(s_vorbis->s_floor_param[floorno], floormemo[i], pcm);
         }
         else {
             /* floor 0 */
-            floor0_inverse2(s_floor_param[floorno], floormemo[i], pcm);
+            floor0_inverse2(s_vorbis->s_floor_param[floorno], floormemo[i], pcm);
         }
 
     }
@@ -1981,8 +2097,8 @@ int32_t mapping_inverse(vorbis_info_mapping_t *info) {
 
     /* transform the PCM data; takes PCM vector, vb; modifies PCM vector */
     /* only MDCT right now.... */
-    for(i = 0; i < s_vorbisChannels; i++){
-        mdct_backward(n, s_dsp_state->work[i]);
+    for(i = 0; i < s_vorbis->s_vorbisChannels; i++){
+        mdct_backward(n, s_vorbis->s_dsp_state->work[i]);
     }
 
     // for(j=0;j<vi->channels;j++)
@@ -2014,7 +2130,7 @@ int32_t *floor0_inverse1(vorbis_info_floor_t *i, int32_t *lsp) {
         int32_t     booknum = bitReader(_ilog(info->numbooks));
 
         if(booknum != -1 && booknum < info->numbooks) { /* be paranoid */
-            codebook_t        *b = s_codebooks + info->books[booknum];
+            codebook_t        *b = s_vorbis->s_codebooks + info->books[booknum];
             int32_t           last = 0;
 
             if(vorbis_book_decodev_set(b, lsp, info->order, -24) == -1) goto eop;
@@ -2037,7 +2153,7 @@ int32_t *floor1_inverse1(vorbis_info_floor_t *in, int32_t *fit_value) {
     int32_t                 quant_look[4] = {256, 128, 86, 64};
     int32_t                 i, j, k;
     int32_t                 quant_q = quant_look[info->mult - 1];
-    codebook_t         *books = s_codebooks;
+    codebook_t         *books = s_vorbis->s_codebooks;
 
     /* unpack wrapped/predicted values from stream */
     if(bitReader(1) == 1) {
@@ -2113,6 +2229,9 @@ int32_t vorbis_book_decode(codebook_t* book) {
 }
 //---------------------------------------------------------------------------------------------------------------------
 int32_t decode_packed_entry_number(codebook_t *book) {
+#ifdef VORBIS_LOW_MEMORY
+    if(!book->dec_table && vorbis_book_expand(book)) return -1;
+#endif
     uint32_t chase = 0;
     int32_t      read = book->dec_maxlength;
     int32_t  lok = bitReader_look(read), i;
@@ -2219,7 +2338,7 @@ int32_t render_point(int32_t x0, int32_t x1, int32_t y0, int32_t y1, int32_t x)
  layer (called only by * floor0) */
 int32_t vorbis_book_decodev_set(codebook_t *book, int32_t *a, int32_t n, int32_t point) {
     if(book->used_entries > 0) {
-        int32_t *v = (int32_t *)alloca(sizeof(*v) * book->dim);
+        int32_t *v = s_vorbis->s_dsp_state->vec;
         int32_t      i;
 
         for(i = 0; i < n;) {
@@ -2240,7 +2359,7 @@ int32_t decode_map(codebook_t *s, int32_t *v, int32_t point) {
 
     uint32_t entry = decode_packed_entry_number(s);
 
-    if(oggpack_eop()) return (-1);
+    if(oggpack_eop() || !s->dec_table) return (-1);
 
     /* according to decode type */
     switch(s->dec_type) {
@@ -2266,7 +2385,7 @@ int32_t decode_map(codebook_t *s, int32_t *v, int32_t point) {
         }
         case 3: {
             /* offset into array */
-            void *ptr = (int32_t *)s->q_val + entry * s->q_pack;
+            void *ptr = (uint8_t *)s->q_val + entry * s->q_pack; /* q_pack is in bytes */
 
             if(s->q_bits <= 8) {
                 for(uint8_t i = 0; i < s->dim; i++) v[i] = ((uint8_t *)ptr)[i];
@@ -2304,20 +2423,19 @@ int32_t res_inverse(vorbis_info_residue_t *info, int32_t **in, int32_t *nonzero,
     int32_t               j, k, s;
     uint8_t           m = 0, n = 0;
     uint8_t           used = 0;
-    codebook_t         *phrasebook = s_codebooks + info->groupbook;
+    codebook_t         *phrasebook = s_vorbis->s_codebooks + info->groupbook;
     uint32_t          samples_per_partition = info->grouping;
     uint8_t           partitions_per_word = phrasebook->dim;
-    uint32_t          pcmend = s_blocksizes[s_dsp_state->W];
+    uint32_t          pcmend = s_vorbis->s_blocksizes[s_vorbis->s_dsp_state->W];
 
 
     if(info->type < 2) {
         uint32_t max = pcmend >> 1;
         uint32_t end = (info->end < max ? info->end : max);
-        uint32_t n1 = end - info->begin;
+        uint32_t n1 = end > info->begin ? end - info->begin : 0;
 
         if(n1 > 0) {
             uint32_t partvals = n1 / samples_per_partition;
-            uint32_t partwords = (partvals + partitions_per_word - 1) / partitions_per_word;
 
             for(uint8_t i = 0; i < ch; i++) {
                 if(nonzero[i]) in[used++] = in[i];
@@ -2327,7 +2445,7 @@ int32_t res_inverse(vorbis_info_residue_t *info, int32_t **in, int32_t *nonzero,
             if(used) {
                 char **partword = (char **)alloca(ch * sizeof(*partword));
                 for(j = 0; j < ch; j++) {
-                    partword[j] = (char *)alloca(partwords * partitions_per_word * sizeof(*partword[j]));
+                    partword[j] = s_vorbis->s_dsp_state->partword + j * s_vorbis->s_dsp_state->partStride;
                 }
                 for(s = 0; s < info->stages; s++) {
                     for(uint32_t i = 0; i < partvals;) {
@@ -2360,7 +2478,7 @@ int32_t res_inverse(vorbis_info_residue_t *info, int32_t **in, int32_t *nonzero,
                             for(j = 0; j < ch; j++) {
                                 uint32_t offset = info->begin + i * samples_per_partition;
                                 if(info->stagemasks[(int32_t)partword[j][i]] & (1 << s)) {
-                                    codebook_t *stagebook = s_codebooks + info->stagebooks[(partword[j][i] << 3) + s];
+                                    codebook_t *stagebook = s_vorbis->s_codebooks + info->stagebooks[(partword[j][i] << 3) + s];
                                     if(info->type) {
                                         if(vorbis_book_decodev_add(stagebook, in[j] + offset,
                                                                    samples_per_partition, -8) == -1)
@@ -2382,13 +2500,12 @@ int32_t res_inverse(vorbis_info_residue_t *info, int32_t **in, int32_t *nonzero,
     else {
         uint32_t max = (pcmend * ch) >> 1;
         uint32_t end = (info->end < max ? info->end : max);
-        uint32_t n = end - info->begin;
+        uint32_t n = end > info->begin ? end - info->begin : 0;
 
         if(n > 0) {
             uint32_t partvals = n / samples_per_partition;
-            uint32_t partwords = (partvals + partitions_per_word - 1) / partitions_per_word;
 
-            char *partword = (char *)alloca(partwords * partitions_per_word * sizeof(*partword));
+            char *partword = s_vorbis->s_dsp_state->partword;
             int32_t   beginoff = info->begin / ch;
 
             uint8_t i = 0;
@@ -2421,7 +2538,7 @@ int32_t res_inverse(vorbis_info_residue_t *info, int32_t **in, int32_t *nonzero,
                     /* now we decode residual values for the partitions */
                     for(k = 0; k < partitions_per_word && i < partvals; k++, i++)
                         if(info->stagemasks[(int32_t)partword[i]] & (1 << s)) {
-                            codebook_t *stagebook = s_codebooks + info->stagebooks[(partword[i] << 3) + s];
+                            codebook_t *stagebook = s_vorbis->s_codebooks + info->stagebooks[(partword[i] << 3) + s];
                             if(vorbis_book_decodevv_add(stagebook, in, i * samples_per_partition + beginoff, ch,
                                                         samples_per_partition, -8) == -1)
                                 goto eopbreak;
@@ -2438,7 +2555,7 @@ eopbreak:
 /* decode vector / dim granularity guarding is done in the upper layer */
 int32_t vorbis_book_decodev_add(codebook_t *book, int32_t *a, int32_t n, int32_t point) {
     if(book->used_entries > 0) {
-        int32_t *v = (int32_t *)alloca(sizeof(*v) * book->dim);
+        int32_t *v = s_vorbis->s_dsp_state->vec;
         uint32_t i;
 
         for(i = 0; i < n;) {
@@ -2454,7 +2571,7 @@ int32_t vorbis_book_decodev_add(codebook_t *book, int32_t *a, int32_t n, int32_t
 int32_t vorbis_book_decodevs_add(codebook_t *book, int32_t *a, int32_t n, int32_t point) {
     if(book->used_entries > 0) {
         int32_t      step = n / book->dim;
-        int32_t *v = (int32_t *)alloca(sizeof(*v) * book->dim);
+        int32_t *v = s_vorbis->s_dsp_state->vec;
         int32_t      j;
 
         for(j = 0; j < step; j++) {
@@ -2473,11 +2590,11 @@ int32_t floor0_inverse2(vorbis_info_floor_t *i, int32_t *lsp, int32_t *out) {
         int32_t amp = lsp[info->order];
 
         /* take the coefficients back to a spectral envelope curve */
-        vorbis_lsp_to_curve(out, s_blocksizes[s_dsp_state->W] / 2, info->barkmap, lsp, info->order, amp, info->ampdB,
+        vorbis_lsp_to_curve(out, s_vorbis->s_blocksizes[s_vorbis->s_dsp_state->W] / 2, info->barkmap, lsp, info->order, amp, info->ampdB,
                             info->rate >> 1);
         return (1);
     }
-    memset(out, 0, sizeof(*out) * s_blocksizes[s_dsp_state->W] / 2);
+    memset(out, 0, sizeof(*out) * s_vorbis->s_blocksizes[s_vorbis->s_dsp_state->W] / 2);
     return (0);
 }
 
@@ -2485,7 +2602,7 @@ int32_t floor0_inverse2(vorbis_info_floor_t *i, int32_t *lsp, int32_t *out) {
 int32_t floor1_inverse2(vorbis_info_floor_t *in, int32_t *fit_value, int32_t *out) {
     vorbis_info_floor_t *info = (vorbis_info_floor_t *)in;
 
-    int32_t               n = s_blocksizes[s_dsp_state->W] / 2;
+    int32_t               n = s_vorbis->s_blocksizes[s_vorbis->s_dsp_state->W] / 2;
     int32_t               j;
 
     if(fit_value) {
@@ -2542,7 +2659,7 @@ void render_line(int32_t n, int32_t x0, int32_t x1, int32_t y0, int32_t y1, int3
     }
 }
 //---------------------------------------------------------------------------------------------------------------------
-const uint16_t barklook[54] = {0,    51,    102,   154,   206,   258,   311,   365,   420,   477,  535,
+VORBIS_HOT const uint16_t barklook[54] = {0,    51,    102,   154,   206,   258,   311,   365,   420,   477,  535,
                                594,  656,   719,   785,   854,   926,   1002,  1082,  1166,  1256, 1352,
                                1454, 1564,  1683,  1812,  1953,  2107,  2276,  2463,  2670,  2900, 3155,
                                3440, 3756,  4106,  4493,  4919,  5387,  5901,  6466,  7094,  7798, 8599,
@@ -2563,7 +2680,7 @@ const uint8_t MLOOP_2[64] = {
 const uint8_t MLOOP_3[8] = {0, 1, 2, 2, 3, 3, 3, 3};
 
 /* interpolated 1./sqrt(p) where .5 <= a < 1. (.100000... to .111111...) in 16.16 format returns in m.8 format */
-int32_t ADJUST_SQRT2[2] = {8192, 5792};
+const int32_t ADJUST_SQRT2[2] = {8192, 5792};
 
 //---------------------------------------------------------------------------------------------------------------------
 void vorbis_lsp_to_curve(int32_t *curve, int32_t n, int32_t ln, int32_t *lsp, int32_t m, int32_t amp, int32_t ampoffset,
@@ -2574,7 +2691,7 @@ void vorbis_lsp_to_curve(int32_t *curve, int32_t n, int32_t ln, int32_t *lsp, in
     int32_t      i;
     int32_t      ampoffseti = ampoffset * 4096;
     int32_t      ampi = amp;
-    int32_t *ilsp = (int32_t *)alloca(m * sizeof(*ilsp));
+    int32_t *ilsp = s_vorbis->s_dsp_state->lsp;
     uint32_t imap = (1UL << 31) / ln;
     uint32_t tBnyq1 = toBARK(nyq) << 1;
 
@@ -3149,7 +3266,7 @@ void mdct_step8(int32_t *x, int32_t n, int32_t step) {
 /* decode vector / dim granularity guarding is done in the upper layer */
 int32_t vorbis_book_decodevv_add(codebook_t *book, int32_t **a, int32_t offset, uint8_t ch, int32_t n, int32_t point) {
     if(book->used_entries > 0) {
-        int32_t *v = (int32_t *)alloca(sizeof(*v) * book->dim);
+        int32_t *v = s_vorbis->s_dsp_state->vec;
         int32_t  i;
         uint8_t  chptr = 0;
         int32_t  m = offset + n;
@@ -3171,8 +3288,8 @@ int32_t vorbis_book_decodevv_add(codebook_t *book, int32_t **a, int32_t offset,
 //---------------------------------------------------------------------------------------------------------------------
 /* pcm==0 indicates we just want the pending samples, no more */
 int32_t vorbis_dsp_pcmout(int16_t *outBuff, int32_t outBuffSize) {
-    if(s_dsp_state->out_begin > -1 && s_dsp_state->out_begin < s_dsp_state->out_end) {
-        int32_t n = s_dsp_state->out_end - s_dsp_state->out_begin;
+    if(s_vorbis->s_dsp_state->out_begin > -1 && s_vorbis->s_dsp_state->out_begin < s_vorbis->s_dsp_state->out_end) {
+        int32_t n = s_vorbis->s_dsp_state->out_end - s_vorbis->s_dsp_state->out_begin;
 
         if(outBuff) {
             int32_t i;
@@ -3180,14 +3297,14 @@ int32_t vorbis_dsp_pcmout(int16_t *outBuff, int32_t outBuffSize) {
                 n = outBuffSize;
                 log_e("outBufferSize too small, must be min %i (int16_t) words", n);
             }
-            for(i = 0; i < s_vorbisChannels; i++){
-                mdct_unroll_lap(s_blocksizes[0], s_blocksizes[1],
-                                s_dsp_state->lW, s_dsp_state->W, s_dsp_state->work[i],
-                                s_dsp_state->mdctright[i], _vorbis_window(s_blocksizes[0] >> 1),
-                                _vorbis_window(s_blocksizes[1] >> 1),
-                                outBuff + i, s_vorbisChannels,
-                                s_dsp_state->out_begin,
-                                s_dsp_state->out_begin + n);
+            for(i = 0; i < s_vorbis->s_vorbisChannels; i++){
+                mdct_unroll_lap(s_vorbis->s_blocksizes[0], s_vorbis->s_blocksizes[1],
+                                s_vorbis->s_dsp_state->lW, s_vorbis->s_dsp_state->W, s_vorbis->s_dsp_state->work[i],
+                                s_vorbis->s_dsp_state->mdctright[i], _vorbis_window(s_vorbis->s_blocksizes[0] >> 1),
+                                _vorbis_window(s_vorbis->s_blocksizes[1] >> 1),
+                                outBuff + i, s_vorbis->s_vorbisChannels,
+                                s_vorbis->s_dsp_state->out_begin,
+                                s_vorbis->s_dsp_state->out_begin + n);
             }
         }
         return (n);
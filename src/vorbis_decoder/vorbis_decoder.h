@@ -29,6 +29,12 @@
 #include "Arduino.h"
 #include <vector>
 using namespace std;
+
+// Build with -DVORBIS_LOW_MEMORY for a lean setup: codebook decode tables are built on first use instead of at stream
+// start (books that are never used cost only their length list), and the small lookup tables read for every sample are
+// kept in internal RAM while the large ones stay in flash. VORBISGetSetupTime() and VORBISGetPeakMemory() report the
+// result for each stream.
+
 #define VI_FLOORB       2
 #define VIF_POSIT      63
 
@@ -89,6 +95,9 @@ typedef struct _codebook{
     int32_t     q_bits;
     uint8_t q_pack;
     void   *q_val;
+    char   *lengthlist;    /* VORBIS_LOW_MEMORY: kept until the decode table is built */
+    uint8_t quantvals;
+    uint8_t maptype;
 } codebook_t;
 
 typedef struct{
@@ -159,6 +168,12 @@ typedef struct _vorbis_dsp_state{  // vorbis_dsp_state buffers the current vorbi
 //    oggpack_buffer_t opb;
     int32_t        **work;
     int32_t        **mdctright;
+    int32_t         *floormemo;  // scratch, channels * memoStride, floor curves of one packet
+    int32_t         *vec;        // scratch, one decoded vector (largest book dimension)
+    int32_t         *lsp;        // scratch, floor 0 LSP coefficients
+    char            *partword;   // scratch, channels * partStride, residue partition classes
+    uint16_t         memoStride;
+    uint16_t         partStride;
     int32_t              out_begin;
     int32_t              out_end;
     int32_t          lW;        // last window
@@ -216,6 +231,14 @@ inline int32_t CLIP_TO_15(int32_t x) {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+// All functions below work on the decoder context bound to the calling task. Tasks that never bind one share a
+// default context, so a single stream needs no setup. Create a context per stream to decode several at once.
+struct VORBISDecoder_t;
+VORBISDecoder_t*      VORBISDecoder_CreateContext();                    // NULL if out of memory
+void                  VORBISDecoder_DestroyContext(VORBISDecoder_t* ctx); // frees the buffers, too
+void                  VORBISDecoder_SetContext(VORBISDecoder_t* ctx);     // bind ctx to the calling task, NULL: default context
+VORBISDecoder_t*      VORBISDecoder_GetContext();
+
 // ogg impl
 bool                  VORBISDecoder_AllocateBuffers();
 void                  VORBISDecoder_FreeBuffers();
@@ -229,6 +252,8 @@ uint32_t              VORBISGetAudioDataStart();
 uint8_t               VORBISGetBitsPerSample();
 uint32_t              VORBISGetBitRate();
 uint16_t              VORBISGetOutputSamps();
+uint32_t              VORBISGetSetupTime();                             // µs from the identification header to the first packet
+uint32_t              VORBISGetPeakMemory();                            // bytes, highest decoder allocation of this stream
 char*                 VORBISgetStreamTitle();
 vector<uint32_t>      VORBISgetMetadataBlockPicture();
 int32_t               VORBISFindSyncWord(unsigned char* buf, int32_t nBytes);
@@ -310,5 +335,10 @@ int32_t  _determine_leaf_words(int32_t nodeb, int32_t leafwidth);
 int32_t  _make_decode_table(codebook_t *s, char *lengthlist, uint8_t quantvals, int32_t maptype);
 int32_t  _make_words(char *l, uint16_t n, uint32_t *r, uint8_t quantvals, codebook_t *b, int32_t maptype);
 uint8_t  _book_maptype1_quantvals(codebook_t *b);
+int32_t  vorbis_book_expand(codebook_t *b);
 void     vorbis_book_clear(codebook_t *b);
+uint32_t vorbis_scratch_size(uint16_t *memoStride, uint16_t *partStride, uint16_t *vecLen, uint16_t *lspLen);
+void*    vorbis_alloc(size_t size);
+void*    vorbis_calloc(size_t count, size_t size);
+void     vorbis_free(void *ptr);
 int32_t *_vorbis_window(int32_t left);